@@ -59,6 +59,26 @@ if(CMAKE_SYSTEM_NAME STREQUAL "Linux")
 		}"
 		HAVE_LINUX_IF_BONDING_H
 	)
+	#
+	# dumpcap's fanout capture uses TPACKET_V3 rings in a
+	# PACKET_FANOUT group.
+	#
+	check_c_source_compiles(
+		"#include <sys/socket.h>
+		#include <linux/if_packet.h>
+		int main(void)
+		{
+			struct tpacket_req3 req;
+			int version = TPACKET_V3;
+			int fanout = PACKET_FANOUT_HASH;
+
+			(void)req;
+			(void)version;
+			(void)fanout;
+			return 0;
+		}"
+		HAVE_TPACKET3
+	)
 endif()
 
 #Functions
@@ -119,9 +139,19 @@ endif()
 check_function_exists("getifaddrs"       HAVE_GETIFADDRS)
 check_function_exists("issetugid"        HAVE_ISSETUGID)
 check_function_exists("mkstemps"         HAVE_MKSTEMPS)
+check_function_exists("mmap"             HAVE_MMAP)
+check_function_exists("open_memstream"   HAVE_OPEN_MEMSTREAM)
 check_function_exists("setresgid"        HAVE_SETRESGID)
 check_function_exists("setresuid"        HAVE_SETRESUID)
 check_function_exists("strptime"         HAVE_STRPTIME)
+#
+# dumpcap's asynchronous writer hands its files to the writing code
+# as FILE *s made with fopencookie(), a GNU extension.
+#
+cmake_push_check_state()
+set(CMAKE_REQUIRED_DEFINITIONS -D_GNU_SOURCE)
+check_symbol_exists("fopencookie" "stdio.h" HAVE_FOPENCOOKIE)
+cmake_pop_check_state()
 if (APPLE)
 	cmake_push_check_state()
 	set(CMAKE_REQUIRED_LIBRARIES ${APPLE_CORE_FOUNDATION_LIBRARY})
@@ -59,6 +59,7 @@
 
 #include <wiretap/wtap.h>
 
+#include <ui/clopts_common.h>
 #include <ui/cmdarg_err.h>
 #include <wsutil/filesystem.h>
 #include <wsutil/privileges.h>
@@ -153,6 +154,9 @@ static gboolean cap_file_hashes    = TRUE;  /* Calculate file hashes */
 #define HASH_STR_SIZE (65) /* Max hash size * 2 + '\0' */
 #define HASH_BUF_SIZE (1024 * 1024)
 
+/* Number of records to read from the capture file at a time */
+#define RECORD_BATCH_SIZE 256
+
 
 static gchar file_sha256[HASH_STR_SIZE];
 static gchar file_rmd160[HASH_STR_SIZE];
@@ -1091,6 +1095,23 @@ count_decryption_secret(guint32 secrets_type _U_, const void *secrets _U_, guint
   num_decryption_secrets++;
 }
 
+/*
+ * Get the next record of the batch, reading another batch when we've
+ * been through this one; returns NULL at the end of the file or on an
+ * error.
+ */
+static wtap_rec *
+next_batch_rec(wtap *wth, wtap_rec_batch *batch, guint *rec_idx, int *err,
+               gchar **err_info)
+{
+  while (*rec_idx == batch->count) {
+    if (!wtap_read_batch(wth, batch, err, err_info))
+      return NULL;
+    *rec_idx = 0;
+  }
+  return &batch->recs[(*rec_idx)++];
+}
+
 static int
 process_cap_file(const char *filename, gboolean need_separator)
 {
@@ -1099,14 +1120,14 @@ process_cap_file(const char *filename, gboolean need_separator)
   int                   err;
   gchar                *err_info;
   gint64                size;
-  gint64                data_offset;
 
   guint32               packet = 0;
   gint64                bytes  = 0;
   guint32               snaplen_min_inferred = 0xffffffff;
   guint32               snaplen_max_inferred =          0;
-  wtap_rec              rec;
-  Buffer                buf;
+  wtap_rec_batch        batch;
+  wtap_rec             *rec;
+  guint                 rec_idx;
   capture_info          cf_info;
   gboolean              have_times = TRUE;
   nstime_t              start_time;
@@ -1164,30 +1185,34 @@ process_cap_file(const char *filename, gboolean need_separator)
   num_ipv6_addresses = 0;
   num_decryption_secrets = 0;
 
-  /* Tally up data that we need to parse through the file to find */
-  wtap_rec_init(&rec);
-  ws_buffer_init(&buf, 1514);
-  while (wtap_read(wth, &rec, &buf, &err, &err_info, &data_offset))  {
-    if (rec.presence_flags & WTAP_HAS_TS) {
+  /*
+   * Tally up data that we need to parse through the file to find.
+   * We only look at the record headers, so don't have the packet
+   * data read.
+   */
+  wtap_rec_batch_init(&batch, RECORD_BATCH_SIZE, WTAP_BATCH_HEADERS_ONLY);
+  rec_idx = 0;
+  while ((rec = next_batch_rec(wth, &batch, &rec_idx, &err, &err_info)) != NULL)  {
+    if (rec->presence_flags & WTAP_HAS_TS) {
       prev_time = cur_time;
-      cur_time = rec.ts;
+      cur_time = rec->ts;
       if (packet == 0) {
-        start_time = rec.ts;
-        start_time_tsprec = rec.tsprec;
-        stop_time  = rec.ts;
-        stop_time_tsprec = rec.tsprec;
-        prev_time  = rec.ts;
+        start_time = rec->ts;
+        start_time_tsprec = rec->tsprec;
+        stop_time  = rec->ts;
+        stop_time_tsprec = rec->tsprec;
+        prev_time  = rec->ts;
       }
       if (nstime_cmp(&cur_time, &prev_time) < 0) {
         order = NOT_IN_ORDER;
       }
       if (nstime_cmp(&cur_time, &start_time) < 0) {
         start_time = cur_time;
-        start_time_tsprec = rec.tsprec;
+        start_time_tsprec = rec->tsprec;
       }
       if (nstime_cmp(&cur_time, &stop_time) > 0) {
         stop_time = cur_time;
-        stop_time_tsprec = rec.tsprec;
+        stop_time_tsprec = rec->tsprec;
       }
     } else {
       have_times = FALSE; /* at least one packet has no time stamp */
@@ -1195,33 +1220,33 @@ process_cap_file(const char *filename, gboolean need_separator)
         order = ORDER_UNKNOWN;
     }
 
-    if (rec.rec_type == REC_TYPE_PACKET) {
-      bytes += rec.rec_header.packet_header.len;
+    if (rec->rec_type == REC_TYPE_PACKET) {
+      bytes += rec->rec_header.packet_header.len;
       packet++;
 
       /* If caplen < len for a rcd, then presumably           */
       /* 'Limit packet capture length' was done for this rcd. */
       /* Keep track as to the min/max actual snapshot lengths */
       /*  seen for this file.                                 */
-      if (rec.rec_header.packet_header.caplen < rec.rec_header.packet_header.len) {
-        if (rec.rec_header.packet_header.caplen < snaplen_min_inferred)
-          snaplen_min_inferred = rec.rec_header.packet_header.caplen;
-        if (rec.rec_header.packet_header.caplen > snaplen_max_inferred)
-          snaplen_max_inferred = rec.rec_header.packet_header.caplen;
+      if (rec->rec_header.packet_header.caplen < rec->rec_header.packet_header.len) {
+        if (rec->rec_header.packet_header.caplen < snaplen_min_inferred)
+          snaplen_min_inferred = rec->rec_header.packet_header.caplen;
+        if (rec->rec_header.packet_header.caplen > snaplen_max_inferred)
+          snaplen_max_inferred = rec->rec_header.packet_header.caplen;
       }
 
-      if ((rec.rec_header.packet_header.pkt_encap > 0) &&
-          (rec.rec_header.packet_header.pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
-        cf_info.encap_counts[rec.rec_header.packet_header.pkt_encap] += 1;
+      if ((rec->rec_header.packet_header.pkt_encap > 0) &&
+          (rec->rec_header.packet_header.pkt_encap < WTAP_NUM_ENCAP_TYPES)) {
+        cf_info.encap_counts[rec->rec_header.packet_header.pkt_encap] += 1;
       } else {
         fprintf(stderr, "capinfos: Unknown packet encapsulation %d in frame %u of file \"%s\"\n",
-                rec.rec_header.packet_header.pkt_encap, packet, filename);
+                rec->rec_header.packet_header.pkt_encap, packet, filename);
       }
 
       /* Packet interface_id info */
-      if (rec.presence_flags & WTAP_HAS_INTERFACE_ID) {
+      if (rec->presence_flags & WTAP_HAS_INTERFACE_ID) {
         /* cf_info.num_interfaces is size, not index, so it's one more than max index */
-        if (rec.rec_header.packet_header.interface_id >= cf_info.num_interfaces) {
+        if (rec->rec_header.packet_header.interface_id >= cf_info.num_interfaces) {
           /*
            * OK, re-fetch the number of interfaces, as there might have
            * been an interface that was in the middle of packets, and
@@ -1236,9 +1261,9 @@ process_cap_file(const char *filename, gboolean need_separator)
           g_free(idb_info);
           idb_info = NULL;
         }
-        if (rec.rec_header.packet_header.interface_id < cf_info.num_interfaces) {
+        if (rec->rec_header.packet_header.interface_id < cf_info.num_interfaces) {
           g_array_index(cf_info.interface_packet_counts, guint32,
-                        rec.rec_header.packet_header.interface_id) += 1;
+                        rec->rec_header.packet_header.interface_id) += 1;
         }
         else {
           cf_info.pkt_interface_id_unknown += 1;
@@ -1256,8 +1281,7 @@ process_cap_file(const char *filename, gboolean need_separator)
     }
 
   } /* while */
-  wtap_rec_cleanup(&rec);
-  ws_buffer_free(&buf);
+  wtap_rec_batch_cleanup(&batch);
 
   /*
    * Get IDB info strings.
@@ -1431,6 +1455,9 @@ print_usage(FILE *output)
   fprintf(output, "  -C cancel processing if file open fails (default is to continue)\n");
   fprintf(output, "  -A generate all infos (default)\n");
   fprintf(output, "  -K disable displaying the capture comment\n");
+  fprintf(output, "  --save-time-index\n");
+  fprintf(output, "     save a time index next to each pcap or pcapng file, which\n");
+  fprintf(output, "     editcap -A and -B use to skip to the selected time range\n");
   fprintf(output, "\n");
   fprintf(output, "Options are processed from left to right order with later options superseding\n");
   fprintf(output, "or adding to earlier options.\n");
@@ -1477,9 +1504,11 @@ main(int argc, char *argv[])
   gboolean need_separator = FALSE;
   int    opt;
   int    overall_error_status = EXIT_SUCCESS;
+#define LONGOPT_SAVE_TIME_INDEX LONGOPT_BASE_APPLICATION+1
   static const struct option long_options[] = {
       {"help", no_argument, NULL, 'h'},
       {"version", no_argument, NULL, 'v'},
+      {"save-time-index", no_argument, NULL, LONGOPT_SAVE_TIME_INDEX},
       {0, 0, 0, 0 }
   };
 
@@ -1702,6 +1731,10 @@ main(int argc, char *argv[])
         goto exit;
         break;
 
+      case LONGOPT_SAVE_TIME_INDEX:
+        wtap_set_save_time_index(TRUE);
+        break;
+
       case '?':              /* Bad flag - print usage message */
         print_usage(stderr);
         overall_error_status = BAD_FLAG;
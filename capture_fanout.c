@@ -0,0 +1,657 @@
+/* capture_fanout.c
+ * Capture on one Linux interface with a PACKET_FANOUT group of TPACKET_V3
+ * rings, one per worker thread, each worker writing its own pcapng file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * With one pcap_t, all of an interface's packets go through one ring and
+ * one thread, which becomes the bottleneck on fast links well before the
+ * disk does.  Here we open one AF_PACKET socket per worker and join them
+ * into a fanout group, so that the kernel spreads the packets over them
+ * by flow hash, and each worker drains its own TPACKET_V3 ring, a block
+ * of packets at a time, into its own file.
+ *
+ * The files are ordinary pcapng files with one interface each; since
+ * a flow always goes to the same queue, each file is a consistent
+ * capture of its flows, and mergecap can merge them into one file.
+ *
+ * We don't ask for PACKET_FANOUT_FLAG_DEFRAG: with it, the kernel
+ * reassembles IP fragments before hashing them, and the socket gets the
+ * reassembled datagram rather than the fragments that were on the wire.
+ * Without it, fragments aren't hashed like the unfragmented packets of
+ * their flow, so the fragments of one datagram may land in a different
+ * queue from the rest of the flow, and from each other.
+ */
+
+#include <config.h>
+
+#ifdef HAVE_TPACKET3
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <net/ethernet.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+
+#include <glib.h>
+
+#include "capture_fanout.h"
+
+#include "writecap/pcapio.h"
+#include <wsutil/file_util.h>
+#include <wsutil/time_util.h>
+
+/*
+ * Each ring is made of blocks of this size; a block is handed to us when
+ * it's full or when it's been open for FANOUT_BLOCK_TIMEOUT ms, so that
+ * packets on a quiet queue don't sit in the ring indefinitely.
+ */
+#define FANOUT_BLOCK_SIZE       (1U << 20)
+#define FANOUT_MIN_BLOCKS       4
+#define FANOUT_FRAME_SIZE       2048
+#define FANOUT_BLOCK_TIMEOUT    100
+
+/* How long a worker waits for a block before checking whether to stop, in ms */
+#define FANOUT_POLL_TIMEOUT     100
+
+#define FANOUT_IO_BUF_SIZE      (1024 * 1024)
+
+#define VLAN_TAG_LEN            4
+
+typedef struct {
+    struct _fanout_capture *fc;
+    guint               queue;
+    int                 fd;
+    guint8             *ring;
+    size_t              ring_size;
+    guint               num_blocks;
+    guint               cur_block;
+    GThread            *tid;
+    gchar              *file_name;
+    FILE               *pdh;
+    char               *io_buffer;
+    guint64             bytes_written;
+    guint8             *vlan_buf;       /**< packet with its VLAN tag put back */
+    guint               vlan_buf_size;
+    int                 err;
+    fanout_queue_stats  stats;
+} fanout_queue;
+
+struct _fanout_capture {
+    gchar              *if_name;
+    int                 snaplen;
+    guint               num_queues;
+    fanout_queue       *queues;
+    guint               packet_limit;
+    gint                packets;        /**< packets written by all workers */
+    gint                go;             /**< TRUE as long as the workers should keep capturing */
+};
+
+static gboolean
+fanout_queue_open(fanout_capture *fc, fanout_queue *q, int ifindex,
+                  int fanout_arg, gboolean promisc, guint num_blocks,
+                  const struct bpf_program *fcode,
+                  char *errmsg, size_t errmsg_len)
+{
+    int                 version = TPACKET_V3;
+    struct tpacket_req3 req;
+    struct sock_fprog   prog;
+    struct sockaddr_ll  sll;
+    struct packet_mreq  mreq;
+
+    /*
+     * Use protocol 0, so that nothing is queued to the socket before
+     * the ring and filter are set up and we bind it.
+     */
+    q->fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (q->fd == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't open a packet socket for queue %u: %s.",
+                   q->queue, g_strerror(errno));
+        return FALSE;
+    }
+
+    if (setsockopt(q->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof version) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't use TPACKET_V3 on queue %u: %s.",
+                   q->queue, g_strerror(errno));
+        return FALSE;
+    }
+
+    memset(&req, 0, sizeof req);
+    req.tp_block_size = FANOUT_BLOCK_SIZE;
+    req.tp_block_nr = num_blocks;
+    req.tp_frame_size = FANOUT_FRAME_SIZE;
+    req.tp_frame_nr = (FANOUT_BLOCK_SIZE / FANOUT_FRAME_SIZE) * num_blocks;
+    req.tp_retire_blk_tov = FANOUT_BLOCK_TIMEOUT;
+    if (setsockopt(q->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof req) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't set up a %u MiB ring on queue %u: %s.",
+                   num_blocks * (FANOUT_BLOCK_SIZE >> 20), q->queue,
+                   g_strerror(errno));
+        return FALSE;
+    }
+    q->num_blocks = num_blocks;
+    q->ring_size = (size_t)FANOUT_BLOCK_SIZE * num_blocks;
+    q->ring = (guint8 *)mmap(NULL, q->ring_size, PROT_READ|PROT_WRITE,
+                             MAP_SHARED, q->fd, 0);
+    if (q->ring == MAP_FAILED) {
+        q->ring = NULL;
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't map the ring of queue %u: %s.",
+                   q->queue, g_strerror(errno));
+        return FALSE;
+    }
+
+    /*
+     * The kernel's socket filters are classic BPF, as generated by
+     * pcap_compile(); the filter's return value also applies the
+     * snapshot length.
+     */
+    if (fcode != NULL) {
+        prog.len = fcode->bf_len;
+        prog.filter = (struct sock_filter *)fcode->bf_insns;
+        if (setsockopt(q->fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof prog) == -1) {
+            g_snprintf(errmsg, (gulong)errmsg_len,
+                       "Can't attach the capture filter to queue %u: %s.",
+                       q->queue, g_strerror(errno));
+            return FALSE;
+        }
+    }
+
+    memset(&sll, 0, sizeof sll);
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = g_htons(ETH_P_ALL);
+    sll.sll_ifindex = ifindex;
+    if (bind(q->fd, (struct sockaddr *)&sll, sizeof sll) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't bind queue %u to %s: %s.",
+                   q->queue, fc->if_name, g_strerror(errno));
+        return FALSE;
+    }
+
+    if (setsockopt(q->fd, SOL_PACKET, PACKET_FANOUT, &fanout_arg, sizeof fanout_arg) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't add queue %u to the fanout group: %s.",
+                   q->queue, g_strerror(errno));
+        return FALSE;
+    }
+
+    if (promisc) {
+        /* The interface stays promiscuous as long as any socket asks. */
+        memset(&mreq, 0, sizeof mreq);
+        mreq.mr_ifindex = ifindex;
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(q->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof mreq) == -1) {
+            g_snprintf(errmsg, (gulong)errmsg_len,
+                       "Can't put %s in promiscuous mode: %s.",
+                       fc->if_name, g_strerror(errno));
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+fanout_capture *
+fanout_capture_open(const char *if_name, guint num_queues, int snaplen,
+                    gboolean promisc, int buffer_size,
+                    const struct bpf_program *fcode,
+                    char *errmsg, size_t errmsg_len)
+{
+    fanout_capture *fc;
+    struct ifreq    ifr;
+    int             ifindex;
+    int             fd;
+    int             fanout_arg;
+    guint           num_blocks;
+    guint           i;
+
+    g_assert(num_queues > 0 && num_queues <= FANOUT_MAX_QUEUES);
+
+    ifindex = if_nametoindex(if_name);
+    if (ifindex == 0) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "There is no interface named \"%s\".", if_name);
+        return NULL;
+    }
+
+    /*
+     * We write the packets as they come from the socket, so the link
+     * layer has to be one we can write without a cooked header.
+     */
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't open a socket: %s.", g_strerror(errno));
+        return NULL;
+    }
+    memset(&ifr, 0, sizeof ifr);
+    g_strlcpy(ifr.ifr_name, if_name, sizeof ifr.ifr_name);
+    if (ioctl(fd, SIOCGIFHWADDR, &ifr) == -1) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "Can't get the link-layer type of %s: %s.",
+                   if_name, g_strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    if (ifr.ifr_hwaddr.sa_family != ARPHRD_ETHER) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "A fanout capture can only be done on an Ethernet interface.");
+        return NULL;
+    }
+
+    fc = g_new0(fanout_capture, 1);
+    fc->if_name = g_strdup(if_name);
+    fc->snaplen = snaplen;
+    fc->num_queues = num_queues;
+    fc->queues = g_new0(fanout_queue, num_queues);
+    for (i = 0; i < num_queues; i++) {
+        fc->queues[i].fc = fc;
+        fc->queues[i].queue = i;
+        fc->queues[i].fd = -1;
+    }
+
+    /*
+     * buffer_size is the size, in MiB, of each queue's ring.  The group
+     * ID only has to be unique among the fanout groups on the system.
+     */
+    num_blocks = MAX((guint)buffer_size, FANOUT_MIN_BLOCKS);
+    fanout_arg = (getpid() & 0xffff) | (PACKET_FANOUT_HASH << 16);
+    for (i = 0; i < num_queues; i++) {
+        if (!fanout_queue_open(fc, &fc->queues[i], ifindex, fanout_arg,
+                               promisc, num_blocks, fcode,
+                               errmsg, errmsg_len)) {
+            fanout_capture_free(fc);
+            return NULL;
+        }
+    }
+    return fc;
+}
+
+/*
+ * The kernel takes the VLAN tag out of the packets it hands us and puts
+ * it in the header; put it back, as libpcap does.
+ */
+static const guint8 *
+fanout_queue_add_vlan_tag(fanout_queue *q, const struct tpacket3_hdr *ppd,
+                          const guint8 *pd)
+{
+    guint16 tpid = ETH_P_8021Q;
+    guint8 *p;
+
+#ifdef TP_STATUS_VLAN_TPID_VALID
+    if (ppd->tp_status & TP_STATUS_VLAN_TPID_VALID)
+        tpid = ppd->hv1.tp_vlan_tpid;
+#endif
+    if (q->vlan_buf_size < ppd->tp_snaplen + VLAN_TAG_LEN) {
+        q->vlan_buf_size = ppd->tp_snaplen + VLAN_TAG_LEN;
+        q->vlan_buf = (guint8 *)g_realloc(q->vlan_buf, q->vlan_buf_size);
+    }
+    p = q->vlan_buf;
+    memcpy(p, pd, 2 * ETH_ALEN);
+    p += 2 * ETH_ALEN;
+    *p++ = tpid >> 8;
+    *p++ = tpid & 0xff;
+    *p++ = ppd->hv1.tp_vlan_tci >> 8;
+    *p++ = ppd->hv1.tp_vlan_tci & 0xff;
+    memcpy(p, pd + 2 * ETH_ALEN, ppd->tp_snaplen - 2 * ETH_ALEN);
+    return q->vlan_buf;
+}
+
+/* Write the packets in a block; returns FALSE if we should stop. */
+static gboolean
+fanout_queue_write_block(fanout_queue *q, const struct tpacket_block_desc *bd)
+{
+    fanout_capture            *fc = q->fc;
+    const struct tpacket3_hdr *ppd;
+    const guint8              *pd;
+    guint32                    caplen, len;
+    guint32                    i;
+    guint                      packet_num = 0;
+
+    ppd = (const struct tpacket3_hdr *)((const guint8 *)bd + bd->hdr.bh1.offset_to_first_pkt);
+    for (i = 0; i < bd->hdr.bh1.num_pkts; i++) {
+        if (fc->packet_limit != 0) {
+            packet_num = (guint)g_atomic_int_add(&fc->packets, 1) + 1;
+            if (packet_num > fc->packet_limit) {
+                /* Someone else wrote the last packet. */
+                g_atomic_int_add(&fc->packets, -1);
+                g_atomic_int_set(&fc->go, FALSE);
+                return FALSE;
+            }
+        }
+
+        pd = (const guint8 *)ppd + ppd->tp_mac;
+        caplen = ppd->tp_snaplen;
+        len = ppd->tp_len;
+        if ((ppd->hv1.tp_vlan_tci != 0 || (ppd->tp_status & TP_STATUS_VLAN_VALID)) &&
+            caplen >= 2 * ETH_ALEN) {
+            pd = fanout_queue_add_vlan_tag(q, ppd, pd);
+            caplen += VLAN_TAG_LEN;
+            len += VLAN_TAG_LEN;
+        }
+
+        if (!pcapng_write_enhanced_packet_block(q->pdh, NULL,
+                                                ppd->tp_sec, ppd->tp_nsec,
+                                                caplen, len, 0, 1000000000,
+                                                pd, 0, &q->bytes_written,
+                                                &q->err)) {
+            if (fc->packet_limit != 0)
+                g_atomic_int_add(&fc->packets, -1);
+            g_atomic_int_set(&fc->go, FALSE);
+            return FALSE;
+        }
+        q->stats.written++;
+        if (fc->packet_limit == 0) {
+            g_atomic_int_inc(&fc->packets);
+        } else if (packet_num == fc->packet_limit) {
+            /*
+             * That was the last one; stop now rather than when the
+             * next packet arrives, which may not be for a while.
+             */
+            g_atomic_int_set(&fc->go, FALSE);
+            return FALSE;
+        }
+
+        ppd = (const struct tpacket3_hdr *)((const guint8 *)ppd + ppd->tp_next_offset);
+    }
+    return TRUE;
+}
+
+static gpointer
+fanout_queue_thread(gpointer data)
+{
+    fanout_queue              *q = (fanout_queue *)data;
+    fanout_capture            *fc = q->fc;
+    struct tpacket_block_desc *bd;
+    struct pollfd              pfd;
+
+    pfd.fd = q->fd;
+    pfd.events = POLLIN | POLLERR;
+    while (g_atomic_int_get(&fc->go)) {
+        bd = (struct tpacket_block_desc *)(q->ring + (size_t)q->cur_block * FANOUT_BLOCK_SIZE);
+        if (!(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER)) {
+            /* Nothing yet; wait for the kernel to retire a block. */
+            pfd.revents = 0;
+            if (poll(&pfd, 1, FANOUT_POLL_TIMEOUT) == -1 && errno != EINTR) {
+                q->err = errno;
+                g_atomic_int_set(&fc->go, FALSE);
+            }
+            continue;
+        }
+        if (!fanout_queue_write_block(q, bd))
+            break;
+
+        /* Give the block back to the kernel. */
+        __atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        q->cur_block = (q->cur_block + 1) % q->num_blocks;
+    }
+    return NULL;
+}
+
+static gchar *
+fanout_file_name(const char *save_file, guint queue)
+{
+    const char *last_pathsep;
+    const char *sfx;
+
+    /* Put the queue number before the suffix, as ringbuffer.c does. */
+    last_pathsep = strrchr(save_file, G_DIR_SEPARATOR);
+    sfx = strrchr(save_file, '.');
+    if (sfx != NULL && (last_pathsep == NULL || sfx > last_pathsep)) {
+        return g_strdup_printf("%.*s_q%02u%s", (int)(sfx - save_file),
+                               save_file, queue, sfx);
+    }
+    return g_strdup_printf("%s_q%02u", save_file, queue);
+}
+
+static gboolean
+fanout_queue_open_file(fanout_queue *q, const char *save_file,
+                       gboolean group_read_access,
+                       const fanout_output_info *info,
+                       char *errmsg, size_t errmsg_len)
+{
+    fanout_capture *fc = q->fc;
+    int             fd;
+
+    q->file_name = fanout_file_name(save_file, q->queue);
+    fd = ws_open(q->file_name, O_WRONLY|O_BINARY|O_TRUNC|O_CREAT,
+                 group_read_access ? 0640 : 0600);
+    if (fd == -1 || (q->pdh = ws_fdopen(fd, "wb")) == NULL) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "The file to which the capture would be saved (\"%s\") "
+                   "could not be opened: %s.", q->file_name,
+                   g_strerror(errno));
+        if (fd != -1)
+            ws_close(fd);
+        return FALSE;
+    }
+    q->io_buffer = (char *)g_malloc(FANOUT_IO_BUF_SIZE);
+    setvbuf(q->pdh, q->io_buffer, _IOFBF, FANOUT_IO_BUF_SIZE);
+
+    if (!pcapng_write_section_header_block(q->pdh, info->comment,
+                                           info->hardware, info->os,
+                                           info->application, -1,
+                                           &q->bytes_written, &q->err) ||
+        !pcapng_write_interface_description_block(q->pdh,
+                                                  NULL,             /* OPT_COMMENT       1 */
+                                                  fc->if_name,      /* IDB_NAME          2 */
+                                                  info->if_descr,   /* IDB_DESCRIPTION   3 */
+                                                  info->cfilter,    /* IDB_FILTER       11 */
+                                                  info->os,         /* IDB_OS           12 */
+                                                  DLT_EN10MB,
+                                                  fc->snaplen,
+                                                  &q->bytes_written,
+                                                  0,                /* IDB_IF_SPEED      8 */
+                                                  9,                /* IDB_TSRESOL       9 */
+                                                  &q->err)) {
+        g_snprintf(errmsg, (gulong)errmsg_len,
+                   "The file to which the capture would be saved (\"%s\") "
+                   "could not be written: %s.", q->file_name,
+                   g_strerror(q->err));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean
+fanout_capture_start(fanout_capture *fc, const char *save_file,
+                     gboolean group_read_access,
+                     const fanout_output_info *info, guint packet_limit,
+                     char *errmsg, size_t errmsg_len)
+{
+    fanout_queue *q;
+    gchar        *name;
+    guint         i, j;
+
+    for (i = 0; i < fc->num_queues; i++) {
+        if (!fanout_queue_open_file(&fc->queues[i], save_file,
+                                    group_read_access, info,
+                                    errmsg, errmsg_len)) {
+            /* Don't leave the files we did create behind. */
+            for (j = 0; j <= i; j++) {
+                q = &fc->queues[j];
+                if (q->pdh != NULL) {
+                    fclose(q->pdh);
+                    q->pdh = NULL;
+                    g_free(q->io_buffer);
+                    q->io_buffer = NULL;
+                    ws_unlink(q->file_name);
+                }
+            }
+            return FALSE;
+        }
+    }
+
+    fc->packet_limit = packet_limit;
+    fc->packets = 0;
+    fc->go = TRUE;
+    for (i = 0; i < fc->num_queues; i++) {
+        name = g_strdup_printf("Fanout queue %u", i);
+        fc->queues[i].tid = g_thread_new(name, fanout_queue_thread, &fc->queues[i]);
+        g_free(name);
+    }
+    return TRUE;
+}
+
+guint
+fanout_capture_num_queues(const fanout_capture *fc)
+{
+    return fc->num_queues;
+}
+
+const char *
+fanout_capture_file_name(const fanout_capture *fc, guint queue)
+{
+    g_assert(queue < fc->num_queues);
+    return fc->queues[queue].file_name;
+}
+
+guint
+fanout_capture_packets(fanout_capture *fc)
+{
+    return (guint)g_atomic_int_get(&fc->packets);
+}
+
+gboolean
+fanout_capture_running(fanout_capture *fc)
+{
+    return g_atomic_int_get(&fc->go);
+}
+
+void
+fanout_capture_stop(fanout_capture *fc, guint64 start_time)
+{
+    struct tpacket_stats_v3  kstats;
+    socklen_t                len;
+    guint64                  end_time;
+    fanout_queue            *q;
+    guint                    i;
+
+    g_atomic_int_set(&fc->go, FALSE);
+    for (i = 0; i < fc->num_queues; i++) {
+        if (fc->queues[i].tid != NULL) {
+            g_thread_join(fc->queues[i].tid);
+            fc->queues[i].tid = NULL;
+        }
+    }
+
+    end_time = create_timestamp();
+    for (i = 0; i < fc->num_queues; i++) {
+        q = &fc->queues[i];
+
+        /* The counters are reset each time they're read. */
+        len = sizeof kstats;
+        if (q->fd != -1 &&
+            getsockopt(q->fd, SOL_PACKET, PACKET_STATISTICS, &kstats, &len) == 0) {
+            q->stats.kernel_received += kstats.tp_packets;
+            q->stats.kernel_dropped += kstats.tp_drops;
+            q->stats.freeze_count += kstats.tp_freeze_q_cnt;
+        }
+
+        if (q->pdh == NULL)
+            continue;
+        /*
+         * The times are in microseconds, but the interface's time stamps
+         * are in nanoseconds, which is what the ISB times are read in.
+         */
+        if (q->err == 0) {
+            pcapng_write_interface_statistics_block(q->pdh, 0,
+                                                    &q->bytes_written,
+                                                    "Counters provided by dumpcap for this fanout queue",
+                                                    start_time * 1000,
+                                                    end_time * 1000,
+                                                    q->stats.kernel_received,
+                                                    q->stats.kernel_dropped,
+                                                    &q->err);
+        }
+        if (fclose(q->pdh) == EOF && q->err == 0)
+            q->err = errno;
+        q->pdh = NULL;
+        g_free(q->io_buffer);
+        q->io_buffer = NULL;
+    }
+}
+
+int
+fanout_capture_get_error(const fanout_capture *fc, const char **file_name)
+{
+    guint i;
+
+    for (i = 0; i < fc->num_queues; i++) {
+        if (fc->queues[i].err != 0) {
+            *file_name = fc->queues[i].file_name;
+            return fc->queues[i].err;
+        }
+    }
+    return 0;
+}
+
+void
+fanout_capture_get_stats(const fanout_capture *fc, guint queue,
+                         fanout_queue_stats *stats)
+{
+    g_assert(queue < fc->num_queues);
+    *stats = fc->queues[queue].stats;
+}
+
+void
+fanout_capture_free(fanout_capture *fc)
+{
+    fanout_queue *q;
+    guint         i;
+
+    if (g_atomic_int_get(&fc->go))
+        fanout_capture_stop(fc, 0);
+    for (i = 0; i < fc->num_queues; i++) {
+        q = &fc->queues[i];
+        if (q->pdh != NULL) {
+            fclose(q->pdh);
+            g_free(q->io_buffer);
+        }
+        if (q->ring != NULL)
+            munmap(q->ring, q->ring_size);
+        if (q->fd != -1)
+            close(q->fd);
+        g_free(q->file_name);
+        g_free(q->vlan_buf);
+    }
+    g_free(fc->queues);
+    g_free(fc->if_name);
+    g_free(fc);
+}
+
+#endif /* HAVE_TPACKET3 */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
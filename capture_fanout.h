@@ -0,0 +1,126 @@
+/* capture_fanout.h
+ * Definitions for capturing on one Linux interface with a PACKET_FANOUT
+ * group of TPACKET_V3 rings, one per worker thread
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CAPTURE_FANOUT_H__
+#define __CAPTURE_FANOUT_H__
+
+#include <glib.h>
+
+#include "wspcap.h"
+
+#ifdef HAVE_TPACKET3
+
+/* Maximum number of queues (and worker threads) in a fanout capture */
+#define FANOUT_MAX_QUEUES 64
+
+typedef struct _fanout_capture fanout_capture;
+
+/*
+ * What goes in the section header and interface description block of
+ * each queue's output file.
+ */
+typedef struct {
+    const char *comment;        /**< capture comment, or NULL */
+    const char *hardware;       /**< shb_hardware */
+    const char *os;             /**< shb_os and if_os */
+    const char *application;    /**< shb_userappl */
+    const char *if_descr;       /**< if_description, or NULL */
+    const char *cfilter;        /**< if_filter, or NULL */
+} fanout_output_info;
+
+typedef struct {
+    guint64 written;            /**< packets the worker wrote to its file */
+    guint64 kernel_received;    /**< packets the kernel passed to the queue, including drops */
+    guint64 kernel_dropped;     /**< packets the kernel dropped because the queue's ring was full */
+    guint64 freeze_count;       /**< number of times the ring filled up */
+} fanout_queue_stats;
+
+/*
+ * Open num_queues AF_PACKET sockets on the Ethernet interface if_name,
+ * each with its own TPACKET_V3 ring of about buffer_size MiB, join them
+ * into one fanout group hashing on the flow, and attach the capture
+ * filter fcode, which may be NULL, with snaplen applied.
+ *
+ * This needs the privileges to capture; it's meant to be called before
+ * those are given up.  Returns NULL, with errmsg filled in, on failure.
+ */
+fanout_capture *fanout_capture_open(const char *if_name, guint num_queues,
+                                    int snaplen, gboolean promisc,
+                                    int buffer_size,
+                                    const struct bpf_program *fcode,
+                                    char *errmsg, size_t errmsg_len);
+
+/*
+ * Create one pcapng file per queue, named after save_file with "_qNN"
+ * inserted before the extension, and start a worker thread per queue
+ * that writes the packets from that queue's ring to its file.
+ *
+ * If packet_limit is non-zero, the workers stop after writing that many
+ * packets between them.
+ */
+gboolean fanout_capture_start(fanout_capture *fc, const char *save_file,
+                              gboolean group_read_access,
+                              const fanout_output_info *info,
+                              guint packet_limit,
+                              char *errmsg, size_t errmsg_len);
+
+/* Number of queues in the group. */
+guint fanout_capture_num_queues(const fanout_capture *fc);
+
+/* Name of the file a queue is written to, once the capture has started. */
+const char *fanout_capture_file_name(const fanout_capture *fc, guint queue);
+
+/* Number of packets written so far by all of the workers. */
+guint fanout_capture_packets(fanout_capture *fc);
+
+/*
+ * TRUE as long as all of the workers are still running; a worker stops
+ * if it gets an error writing its file or the packet limit is reached.
+ */
+gboolean fanout_capture_running(fanout_capture *fc);
+
+/*
+ * Stop the workers and wait for them to finish, then write an interface
+ * statistics block with the kernel's counters for the queue to each
+ * file and close it.  start_time is the ISB start time, in microseconds
+ * since the epoch, as returned by create_timestamp().
+ */
+void fanout_capture_stop(fanout_capture *fc, guint64 start_time);
+
+/*
+ * The first error a worker got writing or closing its file, or 0; if
+ * there was one, *file_name is set to the name of that file.
+ */
+int fanout_capture_get_error(const fanout_capture *fc, const char **file_name);
+
+/* Counters for one queue, as of when the capture was stopped. */
+void fanout_capture_get_stats(const fanout_capture *fc, guint queue,
+                              fanout_queue_stats *stats);
+
+/* Close the sockets and free everything. */
+void fanout_capture_free(fanout_capture *fc);
+
+#endif /* HAVE_TPACKET3 */
+
+#endif /* capture_fanout.h */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
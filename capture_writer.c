@@ -0,0 +1,535 @@
+/* capture_writer.c
+ * Write capture files from a separate thread, in large blocks, so that
+ * the capture loop doesn't wait for the disk
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * When the capture loop writes to the capture file itself, a slow write,
+ * or the open, close and unlink calls when switching ring buffer files,
+ * keep it from reading packets, and the kernel drops them once its
+ * buffer fills up.
+ *
+ * Here the capture loop only copies the data into one of a pool of large
+ * blocks; full blocks are queued to a writer thread, which writes them
+ * in order and returns them to the pool.  Closing files, removing old
+ * ring buffer files and creating the next one are also done by that
+ * thread, so the only thing that makes the capture loop wait for the
+ * disk is running out of free blocks.
+ *
+ * The files are handed to the existing writing code as FILE *s created
+ * with fopencookie(), so that it doesn't need to know about any of this.
+ */
+
+#include <config.h>
+
+#ifdef HAVE_FOPENCOOKIE
+#define _GNU_SOURCE /* Otherwise fopencookie() and fallocate() won't be defined */
+#endif
+
+#ifdef HAVE_FOPENCOOKIE
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "capture_writer.h"
+
+#include <wsutil/file_util.h>
+
+typedef enum {
+    WRITER_REQ_WRITE,           /* write a block to a file */
+    WRITER_REQ_CLOSE,           /* close a file */
+    WRITER_REQ_UNLINK,          /* remove a file */
+    WRITER_REQ_PREPARE,         /* create the spare file */
+    WRITER_REQ_SYNC,            /* tell the capture loop we got this far */
+    WRITER_REQ_QUIT             /* exit the thread */
+} writer_req_type;
+
+typedef struct _writer_file writer_file;
+
+typedef struct {
+    writer_req_type type;
+    writer_file    *wf;                 /* WRITE, CLOSE */
+    guint8         *block;              /* WRITE */
+    size_t          len;                /* WRITE */
+    gchar          *name;               /* UNLINK, PREPARE */
+    gboolean        group_read_access;  /* PREPARE */
+    gint64          prealloc_size;      /* PREPARE */
+} writer_req;
+
+/* The cookie for one file opened with capture_writer_fdopen(). */
+struct _writer_file {
+    capture_writer *cw;                 /* NULL once cw has been freed */
+    int             fd;
+    gboolean        truncate_on_close;
+    /* Used only by the capture loop */
+    guint8         *block;              /* block being filled, or NULL */
+    size_t          used;               /* bytes of it that are filled */
+    /* Used only by the writer thread */
+    guint64         written;
+    int             err;
+};
+
+typedef enum {
+    SPARE_NONE,                 /* there's no spare file */
+    SPARE_PENDING,              /* the writer thread is creating it */
+    SPARE_READY                 /* it's ready to be taken */
+} spare_state;
+
+struct _capture_writer {
+    GThread        *tid;
+    GAsyncQueue    *requests;           /* writer_req's, in order */
+    GAsyncQueue    *free_blocks;        /* blocks that can be filled */
+    guint8         *blocks;
+    GSList         *files;              /* open writer_file's */
+    guint64         syncs_requested;
+    gint            err;                /* first error the writer thread got */
+
+    GMutex          mtx;                /* protects the following */
+    GCond           cond;
+    guint64         syncs_done;
+    spare_state     spare;
+    gchar          *spare_name;
+    int             spare_fd;
+    gboolean        spare_preallocated;
+};
+
+static writer_req *
+writer_req_new(writer_req_type type)
+{
+    writer_req *req;
+
+    req = g_new0(writer_req, 1);
+    req->type = type;
+    return req;
+}
+
+/*
+ * Remember the first error; once there's been one, the capture loop sees
+ * it on all further writes, whichever file it was for.
+ */
+static void
+writer_set_error(capture_writer *cw, int err)
+{
+    g_atomic_int_compare_and_exchange(&cw->err, 0, err);
+}
+
+/* Writer thread: write one block to a file. */
+static void
+writer_do_write(writer_file *wf, const guint8 *data, size_t len)
+{
+    ssize_t nwritten;
+
+    while (len != 0 && wf->err == 0) {
+        nwritten = ws_write(wf->fd, data, len);
+        if (nwritten < 0) {
+            if (errno == EINTR)
+                continue;
+            wf->err = errno;
+        } else if (nwritten == 0) {
+            wf->err = ENOSPC;
+        } else {
+            data += nwritten;
+            len -= (size_t)nwritten;
+            wf->written += (guint64)nwritten;
+        }
+    }
+    if (wf->err != 0)
+        writer_set_error(wf->cw, wf->err);
+}
+
+/* Writer thread: close a file, and give back any space we allocated and didn't use. */
+static void
+writer_do_close(writer_file *wf)
+{
+    if (wf->truncate_on_close && wf->err == 0 &&
+        ftruncate(wf->fd, (off_t)wf->written) == -1) {
+        wf->err = errno;
+    }
+    if (ws_close(wf->fd) == -1 && wf->err == 0)
+        wf->err = errno;
+    if (wf->err != 0)
+        writer_set_error(wf->cw, wf->err);
+    g_free(wf);
+}
+
+/*
+ * Writer thread: create the spare file.  If that fails, the capture loop
+ * just creates the next file itself, as it would without us.
+ */
+static void
+writer_do_prepare(capture_writer *cw, writer_req *req)
+{
+    int      fd;
+    gboolean preallocated = FALSE;
+
+    fd = ws_open(req->name, O_RDWR|O_BINARY|O_TRUNC|O_CREAT,
+                 req->group_read_access ? 0640 : 0600);
+#ifdef FALLOC_FL_KEEP_SIZE
+    /*
+     * Allocate the disk space without changing the file size, so that
+     * somebody reading the file while it's being written doesn't see
+     * zeroes after the data.
+     */
+    if (fd != -1 && req->prealloc_size > 0 &&
+        fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)req->prealloc_size) == 0) {
+        preallocated = TRUE;
+    }
+#endif
+
+    g_mutex_lock(&cw->mtx);
+    if (fd == -1) {
+        cw->spare = SPARE_NONE;
+    } else {
+        cw->spare = SPARE_READY;
+        cw->spare_fd = fd;
+        cw->spare_preallocated = preallocated;
+    }
+    g_mutex_unlock(&cw->mtx);
+}
+
+static void *
+writer_thread(void *arg)
+{
+    capture_writer *cw = (capture_writer *)arg;
+    writer_req     *req;
+    gboolean        done = FALSE;
+
+    while (!done) {
+        req = (writer_req *)g_async_queue_pop(cw->requests);
+        switch (req->type) {
+
+        case WRITER_REQ_WRITE:
+            writer_do_write(req->wf, req->block, req->len);
+            g_async_queue_push(cw->free_blocks, req->block);
+            break;
+
+        case WRITER_REQ_CLOSE:
+            writer_do_close(req->wf);
+            break;
+
+        case WRITER_REQ_UNLINK:
+            /* It might already be gone, so ignore errors */
+            ws_unlink(req->name);
+            break;
+
+        case WRITER_REQ_PREPARE:
+            writer_do_prepare(cw, req);
+            break;
+
+        case WRITER_REQ_SYNC:
+            g_mutex_lock(&cw->mtx);
+            cw->syncs_done++;
+            g_cond_broadcast(&cw->cond);
+            g_mutex_unlock(&cw->mtx);
+            break;
+
+        case WRITER_REQ_QUIT:
+            done = TRUE;
+            break;
+        }
+        g_free(req->name);
+        g_free(req);
+    }
+    return NULL;
+}
+
+/* Queue the block being filled, if there's anything in it. */
+static void
+writer_file_submit(writer_file *wf)
+{
+    writer_req *req;
+
+    if (wf->block == NULL || wf->used == 0)
+        return;
+
+    req = writer_req_new(WRITER_REQ_WRITE);
+    req->wf = wf;
+    req->block = wf->block;
+    req->len = wf->used;
+    g_async_queue_push(wf->cw->requests, req);
+    wf->block = NULL;
+    wf->used = 0;
+}
+
+/* Wait until the writer thread has done everything queued so far. */
+static void
+writer_sync(capture_writer *cw)
+{
+    guint64 ticket;
+
+    ticket = ++cw->syncs_requested;
+    g_async_queue_push(cw->requests, writer_req_new(WRITER_REQ_SYNC));
+    g_mutex_lock(&cw->mtx);
+    while (cw->syncs_done < ticket)
+        g_cond_wait(&cw->cond, &cw->mtx);
+    g_mutex_unlock(&cw->mtx);
+}
+
+static ssize_t
+writer_file_write(void *cookie, const char *buf, size_t size)
+{
+    writer_file    *wf = (writer_file *)cookie;
+    capture_writer *cw = wf->cw;
+    size_t          left = size;
+    size_t          n;
+    int             err;
+
+    err = cw != NULL ? g_atomic_int_get(&cw->err) : EBADF;
+    if (err != 0) {
+        /* A short count makes stdio set the error indicator */
+        errno = err;
+        return 0;
+    }
+
+    while (left != 0) {
+        if (wf->block == NULL) {
+            /* This waits if all of the blocks are queued to be written */
+            wf->block = (guint8 *)g_async_queue_pop(cw->free_blocks);
+            wf->used = 0;
+        }
+        n = MIN(left, CAPTURE_WRITER_BLOCK_SIZE - wf->used);
+        memcpy(wf->block + wf->used, buf, n);
+        wf->used += n;
+        buf += n;
+        left -= n;
+        if (wf->used == CAPTURE_WRITER_BLOCK_SIZE)
+            writer_file_submit(wf);
+    }
+    return (ssize_t)size;
+}
+
+static int
+writer_file_close(void *cookie)
+{
+    writer_file    *wf = (writer_file *)cookie;
+    capture_writer *cw = wf->cw;
+    writer_req     *req;
+    int             err;
+
+    if (cw == NULL) {
+        /* capture_writer_free() has already closed it */
+        g_free(wf);
+        errno = EBADF;
+        return -1;
+    }
+
+    writer_file_submit(wf);
+    if (wf->block != NULL) {
+        /* Nothing was written to it */
+        g_async_queue_push(cw->free_blocks, wf->block);
+        wf->block = NULL;
+    }
+    cw->files = g_slist_remove(cw->files, wf);
+
+    /* From here on, wf belongs to the writer thread */
+    req = writer_req_new(WRITER_REQ_CLOSE);
+    req->wf = wf;
+    g_async_queue_push(cw->requests, req);
+
+    err = g_atomic_int_get(&cw->err);
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+capture_writer *
+capture_writer_new(guint num_blocks)
+{
+    capture_writer *cw;
+    guint           i;
+
+    cw = g_new0(capture_writer, 1);
+    cw->requests = g_async_queue_new();
+    cw->free_blocks = g_async_queue_new();
+    cw->blocks = (guint8 *)g_malloc((gsize)num_blocks * CAPTURE_WRITER_BLOCK_SIZE);
+    for (i = 0; i < num_blocks; i++)
+        g_async_queue_push(cw->free_blocks, cw->blocks + (gsize)i * CAPTURE_WRITER_BLOCK_SIZE);
+    g_mutex_init(&cw->mtx);
+    g_cond_init(&cw->cond);
+    cw->spare = SPARE_NONE;
+    cw->spare_fd = -1;
+    cw->tid = g_thread_new("capture_writer", writer_thread, cw);
+    return cw;
+}
+
+FILE *
+capture_writer_fdopen(capture_writer *cw, int fd, gboolean truncate_on_close,
+                      int *err)
+{
+    static const cookie_io_functions_t writer_file_funcs = {
+        NULL, writer_file_write, NULL, writer_file_close
+    };
+    writer_file *wf;
+    FILE        *fh;
+
+    wf = g_new0(writer_file, 1);
+    wf->cw = cw;
+    wf->fd = fd;
+    wf->truncate_on_close = truncate_on_close;
+
+    fh = fopencookie(wf, "wb", writer_file_funcs);
+    if (fh == NULL) {
+        if (err != NULL)
+            *err = errno;
+        g_free(wf);
+        return NULL;
+    }
+    /* We do our own buffering, in much bigger blocks than stdio would */
+    setvbuf(fh, NULL, _IONBF, 0);
+    cw->files = g_slist_prepend(cw->files, wf);
+    return fh;
+}
+
+guint64
+capture_writer_flush(capture_writer *cw)
+{
+    GSList *l;
+
+    for (l = cw->files; l != NULL; l = l->next)
+        writer_file_submit((writer_file *)l->data);
+    g_async_queue_push(cw->requests, writer_req_new(WRITER_REQ_SYNC));
+    return ++cw->syncs_requested;
+}
+
+guint64
+capture_writer_flushed(capture_writer *cw)
+{
+    guint64 flushed;
+
+    g_mutex_lock(&cw->mtx);
+    flushed = cw->syncs_done;
+    g_mutex_unlock(&cw->mtx);
+    return flushed;
+}
+
+void
+capture_writer_unlink(capture_writer *cw, const char *name)
+{
+    writer_req *req;
+
+    req = writer_req_new(WRITER_REQ_UNLINK);
+    req->name = g_strdup(name);
+    g_async_queue_push(cw->requests, req);
+}
+
+void
+capture_writer_prepare_file(capture_writer *cw, const char *spare_name,
+                            gboolean group_read_access, gint64 prealloc_size)
+{
+    writer_req *req;
+
+    g_mutex_lock(&cw->mtx);
+    if (cw->spare != SPARE_NONE) {
+        g_mutex_unlock(&cw->mtx);
+        return;
+    }
+    cw->spare = SPARE_PENDING;
+    g_free(cw->spare_name);
+    cw->spare_name = g_strdup(spare_name);
+    g_mutex_unlock(&cw->mtx);
+
+    req = writer_req_new(WRITER_REQ_PREPARE);
+    req->name = g_strdup(spare_name);
+    req->group_read_access = group_read_access;
+    req->prealloc_size = prealloc_size;
+    g_async_queue_push(cw->requests, req);
+}
+
+int
+capture_writer_take_file(capture_writer *cw, const char *name,
+                         gboolean *preallocated)
+{
+    int fd = -1;
+
+    g_mutex_lock(&cw->mtx);
+    if (cw->spare == SPARE_READY) {
+        fd = cw->spare_fd;
+        *preallocated = cw->spare_preallocated;
+        cw->spare = SPARE_NONE;
+        cw->spare_fd = -1;
+    }
+    g_mutex_unlock(&cw->mtx);
+
+    if (fd == -1)
+        return -1;
+
+    if (ws_rename(cw->spare_name, name) == -1) {
+        ws_close(fd);
+        ws_unlink(cw->spare_name);
+        return -1;
+    }
+    return fd;
+}
+
+int
+capture_writer_finish(capture_writer *cw)
+{
+    writer_sync(cw);
+    return g_atomic_int_get(&cw->err);
+}
+
+void
+capture_writer_free(capture_writer *cw)
+{
+    GSList      *l;
+    writer_file *wf;
+
+    g_async_queue_push(cw->requests, writer_req_new(WRITER_REQ_QUIT));
+    g_thread_join(cw->tid);
+
+    /*
+     * Close the files that weren't closed, as on an error.  Their FILE *s
+     * still point to them, so they're only freed by fclose().
+     */
+    for (l = cw->files; l != NULL; l = l->next) {
+        wf = (writer_file *)l->data;
+        ws_close(wf->fd);
+        wf->fd = -1;
+        wf->cw = NULL;
+        wf->block = NULL;   /* it's one of cw->blocks */
+        wf->used = 0;
+    }
+
+    /* A spare file that's still pending was created, or not, by now */
+    if (cw->spare == SPARE_READY) {
+        ws_close(cw->spare_fd);
+        ws_unlink(cw->spare_name);
+    }
+    g_free(cw->spare_name);
+
+    g_slist_free(cw->files);
+    g_async_queue_unref(cw->requests);
+    g_async_queue_unref(cw->free_blocks);
+    g_free(cw->blocks);
+    g_mutex_clear(&cw->mtx);
+    g_cond_clear(&cw->cond);
+    g_free(cw);
+}
+
+#endif /* HAVE_FOPENCOOKIE */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
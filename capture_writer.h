@@ -0,0 +1,112 @@
+/* capture_writer.h
+ * Definitions for writing capture files from a separate thread, in
+ * large blocks, so that the capture loop doesn't wait for the disk
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __CAPTURE_WRITER_H__
+#define __CAPTURE_WRITER_H__
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#ifdef HAVE_FOPENCOOKIE
+
+/* Size of the blocks handed to the writer thread */
+#define CAPTURE_WRITER_BLOCK_SIZE (1024 * 1024)
+
+/* Default number of blocks; the capture loop waits if they're all queued */
+#define CAPTURE_WRITER_DEFAULT_BLOCKS 32
+
+typedef struct _capture_writer capture_writer;
+
+/*
+ * Start a writer thread, with num_blocks blocks of
+ * CAPTURE_WRITER_BLOCK_SIZE bytes to buffer data in.
+ */
+capture_writer *capture_writer_new(guint num_blocks);
+
+/*
+ * Return a FILE * for fd whose data is copied into blocks that the
+ * writer thread writes to fd once they're full, or when
+ * capture_writer_flush() is called.  The FILE * isn't seekable.
+ *
+ * fclose() on it returns as soon as the last block is queued, and fd is
+ * closed by the writer thread; if truncate_on_close is TRUE, the file is
+ * also truncated to the amount of data written, for a file that was
+ * preallocated with capture_writer_prepare_file().
+ *
+ * Once writing any file fails, all further writes and fclose() calls
+ * fail with that error.
+ */
+FILE *capture_writer_fdopen(capture_writer *cw, int fd,
+                            gboolean truncate_on_close, int *err);
+
+/*
+ * Queue the partially-filled blocks of all open files, without waiting
+ * for them to be written.  Returns a number for the flush that
+ * capture_writer_flushed() returns once everything queued so far has
+ * been written.
+ */
+guint64 capture_writer_flush(capture_writer *cw);
+
+/* Return the number of the last flush that the writer thread has done. */
+guint64 capture_writer_flushed(capture_writer *cw);
+
+/* Have the writer thread remove a file. */
+void capture_writer_unlink(capture_writer *cw, const char *name);
+
+/*
+ * Have the writer thread create the file spare_name, ready to be taken
+ * by capture_writer_take_file(), and, if prealloc_size is non-zero,
+ * allocate that many bytes of disk space for it.  Does nothing if a
+ * spare file has already been asked for.
+ */
+void capture_writer_prepare_file(capture_writer *cw, const char *spare_name,
+                                 gboolean group_read_access,
+                                 gint64 prealloc_size);
+
+/*
+ * If the writer thread has finished creating the spare file, rename it
+ * to name and return its descriptor, setting *preallocated to TRUE if
+ * space was allocated for it; otherwise return -1.
+ */
+int capture_writer_take_file(capture_writer *cw, const char *name,
+                             gboolean *preallocated);
+
+/*
+ * Wait until everything queued has been written and closed; returns the
+ * first error the writer thread got, or 0.
+ */
+int capture_writer_finish(capture_writer *cw);
+
+/*
+ * Finish writing, remove any spare file that wasn't taken, stop the
+ * writer thread and free everything.  The descriptors of any files that
+ * are still open, as after an error, are closed; writes to their FILE *s
+ * fail, and fclose() on them just frees them.
+ */
+void capture_writer_free(capture_writer *cw);
+
+#endif /* HAVE_FOPENCOOKIE */
+
+#endif /* capture_writer.h */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -14,6 +14,7 @@
 #include <epan/epan.h>
 #include <epan/column-info.h>
 #include <epan/dfilter/dfilter.h>
+#include <epan/field_index.h>
 #include <epan/frame_data.h>
 #include <epan/frame_data_sequence.h>
 #include <wiretap/wtap.h>
@@ -60,6 +61,7 @@ struct packet_provider_data {
   frame_data  *prev_cap;
   frame_data_sequence *frames;       /* Sequence of frames, if we're keeping that information */
   GTree       *frames_user_comments; /* BST with user comments for frames (key = frame_data) */
+  GTree       *frames_shift_offsets; /* BST with time shift offsets for frames (key = frame_data) */
 };
 
 typedef struct _capture_file {
@@ -112,6 +114,8 @@ typedef struct _capture_file {
   /* frames */
   guint32                     first_displayed;      /* Frame number of first frame displayed */
   guint32                     last_displayed;       /* Frame number of last frame displayed */
+  field_index_t              *field_index;          /* Values of selected fields in each frame, if any */
+  struct filter_helper       *filter_helper;        /* Process that filters frames for us, if any */
   /* Data for currently selected frame */
   column_info                 cinfo;                /* Column formatting information */
   frame_data                 *current_frame;        /* Frame data */
@@ -133,6 +137,8 @@ const char *cap_file_provider_get_interface_name(struct packet_provider_data *pr
 const char *cap_file_provider_get_interface_description(struct packet_provider_data *prov, guint32 interface_id);
 const char *cap_file_provider_get_user_comment(struct packet_provider_data *prov, const frame_data *fd);
 void cap_file_provider_set_user_comment(struct packet_provider_data *prov, frame_data *fd, const char *new_comment);
+const nstime_t *cap_file_provider_get_shift_offset(struct packet_provider_data *prov, const frame_data *fd);
+void cap_file_provider_set_shift_offset(struct packet_provider_data *prov, frame_data *fd, const nstime_t *offset);
 
 #ifdef __cplusplus
 }
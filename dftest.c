@@ -16,11 +16,17 @@
 #include <string.h>
 #include <errno.h>
 
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
 #include <glib.h>
 
 #include <epan/epan.h>
+#include <epan/epan_dissect.h>
 #include <epan/timestamp.h>
 #include <epan/prefs.h>
+#include <epan/tvbuff.h>
 #include <epan/dfilter/dfilter.h>
 
 #ifdef HAVE_PLUGINS
@@ -33,6 +39,11 @@
 #include <wiretap/wtap.h>
 
 #include "ui/util.h"
+#include "ui/failure_message.h"
+
+#ifndef HAVE_GETOPT_LONG
+#include "wsutil/wsgetopt.h"
+#endif
 
 static void failure_warning_message(const char *msg_format, va_list ap);
 static void open_failure_message(const char *filename, int err,
@@ -40,13 +51,127 @@ static void open_failure_message(const char *filename, int err,
 static void read_failure_message(const char *filename, int err);
 static void write_failure_message(const char *filename, int err);
 
+static void
+print_usage(FILE *output)
+{
+	fprintf(output, "Usage: dftest [-b <capture file>] [-n <iterations>] <filter>\n");
+	fprintf(output, "  -b <capture file>  time the filter against the packets in a file\n");
+	fprintf(output, "  -n <iterations>    apply the filter this many times per packet (default 100)\n");
+}
+
+/* Dissects every packet of a capture file once, then times how long
+ * dfilter_apply_edt() takes on the resulting tree, both with the generic
+ * and with the specialized byte-code. */
+static int
+run_benchmark(const char *filename, dfilter_t *df_generic,
+	dfilter_t *df_specialized, int iterations)
+{
+	epan_t		*session;
+	epan_dissect_t	*edt;
+	struct packet_provider_funcs funcs;
+	wtap		*wth;
+	wtap_rec	rec;
+	Buffer		buf;
+	frame_data	fdata;
+	frame_data	ref_frame, prev_dis_frame;
+	const frame_data *ref = NULL, *prev_dis = NULL;
+	nstime_t	elapsed_time;
+	gint64		offset, start;
+	gint64		generic_us = 0, specialized_us = 0;
+	guint32		count = 0, cum_bytes = 0;
+	guint32		generic_passed = 0, specialized_passed = 0;
+	gboolean	passed = FALSE;
+	int		err, i;
+	gchar		*err_info = NULL;
+
+	wth = wtap_open_offline(filename, WTAP_TYPE_AUTO, &err, &err_info, FALSE);
+	if (wth == NULL) {
+		cfile_open_failure_message("dftest", filename, err, err_info);
+		return 2;
+	}
+
+	memset(&funcs, 0, sizeof(funcs));
+	session = epan_new(NULL, &funcs);
+	edt = epan_dissect_new(session, TRUE, FALSE);
+	wtap_rec_init(&rec);
+	ws_buffer_init(&buf, 1514);
+	nstime_set_zero(&elapsed_time);
+
+	while (wtap_read(wth, &rec, &buf, &err, &err_info, &offset)) {
+		count++;
+		frame_data_init(&fdata, count, &rec, offset, cum_bytes);
+		frame_data_set_before_dissect(&fdata, &elapsed_time, &ref, prev_dis);
+		if (ref == &fdata) {
+			ref_frame = fdata;
+			ref = &ref_frame;
+		}
+
+		epan_dissect_prime_with_dfilter(edt, df_generic);
+		epan_dissect_prime_with_dfilter(edt, df_specialized);
+		epan_dissect_run(edt, wtap_file_type_subtype(wth), &rec,
+			tvb_new_real_data(ws_buffer_start_ptr(&buf),
+				rec.rec_header.packet_header.caplen,
+				rec.rec_header.packet_header.len),
+			&fdata, NULL);
+
+		start = g_get_monotonic_time();
+		for (i = 0; i < iterations; i++)
+			passed = dfilter_apply_edt(df_generic, edt);
+		generic_us += g_get_monotonic_time() - start;
+		if (passed)
+			generic_passed++;
+
+		start = g_get_monotonic_time();
+		for (i = 0; i < iterations; i++)
+			passed = dfilter_apply_edt(df_specialized, edt);
+		specialized_us += g_get_monotonic_time() - start;
+		if (passed)
+			specialized_passed++;
+
+		frame_data_set_after_dissect(&fdata, &cum_bytes);
+		prev_dis_frame = fdata;
+		prev_dis = &prev_dis_frame;
+		epan_dissect_reset(edt);
+		frame_data_destroy(&fdata);
+	}
+	if (err != 0) {
+		cfile_read_failure_message("dftest", filename, err, err_info);
+	}
+
+	epan_dissect_free(edt);
+	epan_free(session);
+	ws_buffer_free(&buf);
+	wtap_rec_cleanup(&rec);
+	wtap_close(wth);
+
+	printf("Packets: %u, iterations: %d\n", count, iterations);
+	if (count == 0)
+		return err != 0 ? 2 : 0;
+	printf("Generic:     %8.1f ns/packet, %u passed\n",
+		(double)generic_us * 1000.0 / count / iterations,
+		generic_passed);
+	printf("Specialized: %8.1f ns/packet, %u passed\n",
+		(double)specialized_us * 1000.0 / count / iterations,
+		specialized_passed);
+
+	if (generic_passed != specialized_passed) {
+		fprintf(stderr, "dftest: generic and specialized filters disagree\n");
+		return 2;
+	}
+	return err != 0 ? 2 : 0;
+}
+
 int
 main(int argc, char **argv)
 {
 	char		*init_progfile_dir_error;
 	char		*text;
 	dfilter_t	*df;
+	dfilter_t	*df_generic = NULL;
 	gchar		*err_msg;
+	const char	*bench_file = NULL;
+	int		iterations = 100;
+	int		opt, ret = 0;
 
 	/*
 	 * Get credential information for later use.
@@ -91,14 +216,38 @@ main(int argc, char **argv)
 	line that its preferences have changed. */
 	prefs_apply_all();
 
+	/* "+" stops at the first non-option, so that filters like
+	   "-1 == foo" still reach the filter parser. */
+	while ((opt = getopt(argc, argv, "+b:hn:")) != -1) {
+		switch (opt) {
+			case 'b':
+				bench_file = optarg;
+				break;
+			case 'n':
+				iterations = atoi(optarg);
+				if (iterations <= 0) {
+					fprintf(stderr, "dftest: \"%s\" isn't a valid number of iterations\n",
+						optarg);
+					exit(1);
+				}
+				break;
+			case 'h':
+				print_usage(stdout);
+				exit(0);
+			default:
+				print_usage(stderr);
+				exit(1);
+		}
+	}
+
 	/* Check for filter on command line */
-	if (argc <= 1) {
-		fprintf(stderr, "Usage: dftest <filter>\n");
+	if (optind >= argc) {
+		print_usage(stderr);
 		exit(1);
 	}
 
 	/* Get filter text */
-	text = get_args_as_string(argc, argv, 1);
+	text = get_args_as_string(argc, argv, optind);
 
 	printf("Filter: \"%s\"\n", text);
 
@@ -118,10 +267,21 @@ main(int argc, char **argv)
 	else
 		dfilter_dump(df);
 
+	if (bench_file != NULL && df != NULL) {
+		/* Same filter again, without the specialized instructions. */
+		dfilter_set_specialize(FALSE);
+		dfilter_compile(text, &df_generic, NULL);
+		dfilter_set_specialize(TRUE);
+
+		printf("\n");
+		ret = run_benchmark(bench_file, df_generic, df, iterations);
+		dfilter_free(df_generic);
+	}
+
 	dfilter_free(df);
 	epan_cleanup();
 	g_free(text);
-	exit(0);
+	exit(ret);
 }
 
 /*
@@ -49,6 +49,8 @@
 #endif
 
 #include "ringbuffer.h"
+#include "capture_fanout.h"
+#include "capture_writer.h"
 
 #include "caputils/capture_ifinfo.h"
 #include "caputils/capture-pcap-util.h"
@@ -80,6 +82,7 @@
 #include "wsutil/str_util.h"
 #include "wsutil/inet_addr.h"
 #include "wsutil/time_util.h"
+#include "wsutil/time_index.h"
 #include "wsutil/please_report_bug.h"
 
 #include "caputils/ws80211_utils.h"
@@ -303,7 +306,13 @@ typedef struct _loop_data {
     FILE     *pdh;
     int       save_file_fd;
     char     *io_buffer;           /**< Our IO buffer if we increase the size from the standard size */
+#ifdef HAVE_FOPENCOOKIE
+    capture_writer *writer;        /**< Thread writing the output file(s), or NULL */
+    GQueue    pending_reports;     /**< pending_report's waiting for the writer thread */
+#endif
     guint64   bytes_written;       /**< Bytes written for the current file. */
+    time_index_builder *time_index; /**< Time index of the current file, or NULL */
+    time_index_counts time_index_counts; /**< Section headers and IDBs at the start of each file */
     /* autostop conditions */
     int       packets_written;     /**< Packets written for the current file. */
     int       file_count;
@@ -313,6 +322,18 @@ typedef struct _loop_data {
     int      interval_s;
 } loop_data;
 
+#ifdef HAVE_FOPENCOOKIE
+/*
+ * A report to our parent about packets, or a new capture file, that the
+ * writer thread hasn't finished writing yet.
+ */
+typedef struct {
+    guint64  flush;                /**< capture_writer_flush() after which to send it */
+    guint    packets;              /**< Packets to report, or 0 */
+    gchar   *new_file;             /**< New capture file to report, or NULL */
+} pending_report;
+#endif
+
 typedef struct _pcap_queue_element {
     capture_src        *pcap_src;
     union {
@@ -371,6 +392,13 @@ console_log_handler(const char *log_domain, GLogLevelFlags log_level,
 static capture_options global_capture_opts;
 static gboolean quiet = FALSE;
 static gboolean use_threads = FALSE;
+#ifdef HAVE_TPACKET3
+static guint fanout_workers = 0;  /* 0: don't do a fanout capture */
+#endif
+#ifdef HAVE_FOPENCOOKIE
+static guint async_write_blocks = 0;  /* 0: write the output file ourselves */
+#endif
+static gboolean save_time_index = FALSE;
 static guint64 start_time;
 
 static void capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
@@ -378,6 +406,9 @@ static void capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_p
 static void capture_loop_queue_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
                                          const u_char *pd);
 static void capture_loop_write_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t *bh, u_char *pd);
+#ifdef HAVE_TPACKET3
+static gboolean capture_loop_start_fanout(capture_options *capture_opts, gboolean *stats_known, struct pcap_stat *stats);
+#endif
 static void capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t *bh, u_char *pd);
 static void capture_loop_get_errmsg(char *errmsg, size_t errmsglen,
                                     char *secondary_errmsg,
@@ -387,6 +418,10 @@ static void capture_loop_get_errmsg(char *errmsg, size_t errmsglen,
 
 static void WS_NORETURN exit_main(int err);
 
+#ifdef HAVE_FOPENCOOKIE
+static void capture_loop_send_reports(loop_data *ld);
+#endif
+
 static void report_new_capture_file(const char *filename);
 static void report_packet_count(unsigned int packet_count);
 static void report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32 flushed, guint32 ps_ifdrop, gchar *name);
@@ -477,6 +512,17 @@ print_usage(FILE *output)
     fprintf(output, "  -C <byte_limit>          maximum number of bytes used for buffering packets\n");
     fprintf(output, "                           within dumpcap\n");
     fprintf(output, "  -t                       use a separate thread per interface\n");
+#ifdef HAVE_TPACKET3
+    fprintf(output, "  --fanout-workers <count> spread the packets over <count> threads, each\n");
+    fprintf(output, "                           writing its own file (one Ethernet interface only)\n");
+#endif
+#ifdef HAVE_FOPENCOOKIE
+    fprintf(output, "  --async-write[=<MiB>]    write the capture file(s) from a separate thread,\n");
+    fprintf(output, "                           buffering up to <MiB> megabytes (default: %u)\n",
+            CAPTURE_WRITER_DEFAULT_BLOCKS);
+#endif
+    fprintf(output, "  --time-index             save a time index next to each capture file,\n");
+    fprintf(output, "                           for editcap -A/-B to skip to a time range\n");
     fprintf(output, "  -q                       don't report packet capture counts\n");
     fprintf(output, "  -v, --version            print version information and exit\n");
     fprintf(output, "  -h, --help               display this help and exit\n");
@@ -3069,6 +3115,48 @@ capture_loop_init_pcapng_output(capture_options *capture_opts, loop_data *ld)
     return successful;
 }
 
+/*
+ * Start the time index of a new output file, if we're saving one.  All
+ * of the SHBs and IDBs are at the start of the file, and the packets we
+ * write are its only records, unless a pcapng source hands us blocks of
+ * its own; we don't index the file then.
+ */
+static void
+capture_loop_start_time_index(capture_options *capture_opts, loop_data *ld)
+{
+    guint i;
+
+    if (!save_time_index)
+        return;
+    for (i = 0; i < ld->pcaps->len; i++) {
+        if (g_array_index(ld->pcaps, capture_src *, i)->from_pcapng)
+            return;
+    }
+    ld->time_index_counts.sections = 1;
+    ld->time_index_counts.interfaces = capture_opts->use_pcapng ? ld->saved_idbs->len : 1;
+    ld->time_index_counts.metadata = 0;
+    ld->time_index = time_index_builder_new(0);
+}
+
+/*
+ * Save the time index of the file we've finished writing, which is
+ * bytes_written long.
+ */
+static void
+capture_loop_save_time_index(loop_data *ld, const char *save_file)
+{
+    int err;
+
+    if (ld->time_index == NULL)
+        return;
+    if (!time_index_builder_save(ld->time_index, save_file, ld->bytes_written, &err)) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+              "Couldn't save the time index for \"%s\": %s.", save_file, g_strerror(err));
+    }
+    time_index_builder_free(ld->time_index);
+    ld->time_index = NULL;
+}
+
 /* set up to write to the already-opened capture output file/files */
 static gboolean
 capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *errmsg, int errmsg_len)
@@ -3085,9 +3173,25 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
         return FALSE;
     }
 
+#ifdef HAVE_FOPENCOOKIE
+    if (async_write_blocks > 0 && ld->writer == NULL) {
+        ld->writer = capture_writer_new(async_write_blocks);
+        if (capture_opts->multi_files_on) {
+            /* Allocate the space for the next file ahead of time, if we know its size */
+            ringbuf_set_writer(ld->writer,
+                               capture_opts->has_autostop_filesize ?
+                                   (gint64)capture_opts->autostop_filesize * 1000 : 0);
+        }
+    }
+#endif
+
     /* Set up to write to the capture file. */
     if (capture_opts->multi_files_on) {
         ld->pdh = ringbuf_init_libpcap_fdopen(&err);
+#ifdef HAVE_FOPENCOOKIE
+    } else if (ld->writer != NULL) {
+        ld->pdh = capture_writer_fdopen(ld->writer, ld->save_file_fd, FALSE, &err);
+#endif
     } else {
         ld->pdh = ws_fdopen(ld->save_file_fd, "wb");
         if (ld->pdh == NULL) {
@@ -3124,7 +3228,12 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
                                                 pcap_src->ts_nsec, &ld->bytes_written, &err);
         }
         if (!successful) {
-            fclose(ld->pdh);
+            /* ringbuf_error_cleanup() closes a ring buffer file. */
+            if (!capture_opts->multi_files_on) {
+                fclose(ld->pdh);
+                /* That closed the file descriptor as well. */
+                ld->save_file_fd = -1;
+            }
             ld->pdh = NULL;
             g_free(ld->io_buffer);
             ld->io_buffer = NULL;
@@ -3148,6 +3257,7 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
         return FALSE;
     }
 
+    capture_loop_start_time_index(capture_opts, ld);
     return TRUE;
 }
 
@@ -3163,7 +3273,7 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_close_output");
 
     if (capture_opts->multi_files_on) {
-        return ringbuf_libpcap_dump_close(&capture_opts->save_file, err_close);
+        success = ringbuf_libpcap_dump_close(&capture_opts->save_file, err_close);
     } else {
         if (capture_opts->use_pcapng) {
             for (i = 0; i < global_ld.pcaps->len; i++) {
@@ -3201,10 +3311,110 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
         }
         g_free(ld->io_buffer);
         ld->io_buffer = NULL;
-        return success;
     }
+    capture_loop_save_time_index(ld, capture_opts->save_file);
+
+#ifdef HAVE_FOPENCOOKIE
+    if (ld->writer != NULL) {
+        int err;
+
+        /* Wait for the writer thread to write and close everything */
+        err = capture_writer_finish(ld->writer);
+        capture_loop_send_reports(ld);
+        if (err != 0 && success) {
+            if (err_close != NULL) {
+                *err_close = err;
+            }
+            success = FALSE;
+        }
+        capture_writer_free(ld->writer);
+        ld->writer = NULL;
+    }
+#endif
+    return success;
+}
+
+/*
+ * Make what we've written to the capture file so far visible to whoever
+ * reads it; then, if report_packets is TRUE, report the packets written
+ * since the last report, and, if new_file isn't NULL, report it as the
+ * new capture file.
+ *
+ * If a writer thread writes the file, our parent mustn't hear about
+ * anything until the writer thread has written it, as it reads the
+ * packets as soon as we report them.  Rather than waiting for the disk,
+ * we leave the reports to capture_loop_send_reports().
+ */
+static void
+capture_loop_flush_output(loop_data *ld, gboolean report_packets,
+                          const char *new_file)
+{
+    guint packets = 0;
+
+    fflush(ld->pdh);
+    if (report_packets) {
+        if (!quiet)
+            packets = ld->inpkts_to_sync_pipe;
+        ld->inpkts_to_sync_pipe = 0;
+    }
+#ifdef HAVE_FOPENCOOKIE
+    if (ld->writer != NULL) {
+        guint64 flush;
+        pending_report *report;
+
+        flush = capture_writer_flush(ld->writer);
+        if (packets != 0 || new_file != NULL) {
+            report = g_new(pending_report, 1);
+            report->flush = flush;
+            report->packets = packets;
+            report->new_file = g_strdup(new_file);
+            g_queue_push_tail(&ld->pending_reports, report);
+        }
+        return;
+    }
+#endif
+    if (packets != 0)
+        report_packet_count(packets);
+    if (new_file != NULL)
+        report_new_capture_file(new_file);
 }
 
+#ifdef HAVE_FOPENCOOKIE
+/* Send the reports about what the writer thread has written so far. */
+static void
+capture_loop_send_reports(loop_data *ld)
+{
+    guint64 flushed;
+    pending_report *report;
+
+    if (ld->writer == NULL || g_queue_is_empty(&ld->pending_reports))
+        return;
+    flushed = capture_writer_flushed(ld->writer);
+    while ((report = (pending_report *)g_queue_peek_head(&ld->pending_reports)) != NULL &&
+           report->flush <= flushed) {
+        g_queue_pop_head(&ld->pending_reports);
+        if (report->packets != 0)
+            report_packet_count(report->packets);
+        if (report->new_file != NULL)
+            report_new_capture_file(report->new_file);
+        g_free(report->new_file);
+        g_free(report);
+    }
+}
+
+/* Throw away the reports we didn't get to send, as after an error. */
+static void
+capture_loop_discard_reports(loop_data *ld)
+{
+    pending_report *report;
+
+    while ((report = (pending_report *)g_queue_pop_head(&ld->pending_reports)) != NULL) {
+        g_free(report->new_file);
+        g_free(report);
+    }
+}
+#endif
+
 /* dispatch incoming packets (pcap or capture pipe)
  *
  * Waits for incoming packets to be available, and calls pcap_dispatch()
@@ -3620,6 +3830,8 @@ do_file_switch_or_stop(capture_options *capture_opts)
             return FALSE;
         }
 
+        capture_loop_save_time_index(&global_ld, capture_opts->save_file);
+
         /* Switch to the next ringbuffer file */
         if (ringbuf_switch_file(&global_ld.pdh, &capture_opts->save_file,
                                 &global_ld.save_file_fd, &global_ld.err)) {
@@ -3644,17 +3856,14 @@ do_file_switch_or_stop(capture_options *capture_opts)
                 global_ld.io_buffer = NULL;
                 return FALSE;
             }
+            capture_loop_start_time_index(capture_opts, &global_ld);
             if (global_ld.file_duration_timer) {
                 g_timer_reset(global_ld.file_duration_timer);
             }
             if (global_ld.next_interval_time) {
                 global_ld.next_interval_time = get_next_time_interval(global_ld.interval_s);
             }
-            fflush(global_ld.pdh);
-            if (!quiet)
-                report_packet_count(global_ld.inpkts_to_sync_pipe);
-            global_ld.inpkts_to_sync_pipe = 0;
-            report_new_capture_file(capture_opts->save_file);
+            capture_loop_flush_output(&global_ld, TRUE, capture_opts->save_file);
         } else {
             /* File switch failed: stop here */
             global_ld.go = FALSE;
@@ -3756,6 +3965,11 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     *errmsg           = '\0';
     *secondary_errmsg = '\0';
 
+#ifdef HAVE_TPACKET3
+    if (fanout_workers > 0)
+        return capture_loop_start_fanout(capture_opts, stats_known, stats);
+#endif
+
     /* init the loop data */
     global_ld.go                  = TRUE;
     global_ld.packets_captured    = 0;
@@ -3767,6 +3981,11 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     global_ld.pdh                 = NULL;
     global_ld.save_file_fd        = -1;
     global_ld.io_buffer           = NULL;
+#ifdef HAVE_FOPENCOOKIE
+    global_ld.writer              = NULL;
+    g_queue_init(&global_ld.pending_reports);
+#endif
+    global_ld.time_index          = NULL;
     global_ld.file_count          = 0;
     global_ld.file_duration_timer = NULL;
     global_ld.next_interval_time  = 0;
@@ -3840,8 +4059,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
            message to our parent so that they'll open the capture file and
            update its windows to indicate that we have a live capture in
            progress. */
-        fflush(global_ld.pdh);
-        report_new_capture_file(capture_opts->save_file);
+        capture_loop_flush_output(&global_ld, FALSE, capture_opts->save_file);
     }
 
     if (capture_opts->has_file_interval) {
@@ -3935,10 +4153,15 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             global_ld.inpkts_to_sync_pipe += inpkts;
 
             if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
+                capture_loop_flush_output(&global_ld, FALSE, NULL);
             }
         } /* inpkts */
 
+#ifdef HAVE_FOPENCOOKIE
+        /* Tell our parent about whatever the writer thread has written. */
+        capture_loop_send_reports(&global_ld);
+#endif
+
         /* Only update once every 500ms so as not to overload slow displays.
          * This also prevents too much context-switching between the dumpcap
          * and wireshark processes.
@@ -3964,15 +4187,10 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 #endif
             /* Let the parent process know. */
             if (global_ld.inpkts_to_sync_pipe) {
-                /* do sync here */
-                fflush(global_ld.pdh);
-
-                /* Send our parent a message saying we've written out
-                   "global_ld.inpkts_to_sync_pipe" packets to the capture file. */
-                if (!quiet)
-                    report_packet_count(global_ld.inpkts_to_sync_pipe);
-
-                global_ld.inpkts_to_sync_pipe = 0;
+                /* Sync here, and send our parent a message saying we've
+                   written out "global_ld.inpkts_to_sync_pipe" packets to
+                   the capture file. */
+                capture_loop_flush_output(&global_ld, TRUE, NULL);
             }
 
             /* check capture duration condition */
@@ -4016,7 +4234,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             }
             global_ld.inpkts_to_sync_pipe += 1;
             if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
+                capture_loop_flush_output(&global_ld, FALSE, NULL);
             }
         }
     }
@@ -4159,6 +4377,18 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     return write_ok && close_ok;
 
 error:
+#ifdef HAVE_FOPENCOOKIE
+    if (global_ld.writer != NULL) {
+        /* Let the writer thread finish with the files before we remove them */
+        capture_writer_free(global_ld.writer);
+        global_ld.writer = NULL;
+        capture_loop_discard_reports(&global_ld);
+    }
+#endif
+    if (global_ld.time_index != NULL) {
+        time_index_builder_free(global_ld.time_index);
+        global_ld.time_index = NULL;
+    }
     if (capture_opts->multi_files_on) {
         /* cleanup ringbuffer */
         ringbuf_error_cleanup();
@@ -4189,6 +4419,189 @@ error:
 }
 
 
+#ifdef HAVE_TPACKET3
+/* Do a capture on one Linux interface with a fanout group of workers,
+   each writing its own file; see capture_fanout.c.
+   Returns TRUE if it succeeds, FALSE otherwise. */
+static gboolean
+capture_loop_start_fanout(capture_options *capture_opts, gboolean *stats_known, struct pcap_stat *stats)
+{
+    interface_options  *interface_opts;
+    pcap_t             *pcap_h;
+    struct bpf_program  fcode;
+    fanout_capture     *fc;
+    fanout_output_info  info;
+    fanout_queue_stats  qstats;
+    int                 buffer_size;
+    GString            *os_info_str;
+    GString            *cpu_info_str;
+    GTimer             *autostop_duration_timer = NULL;
+    gboolean            started;
+    guint               packets, packets_reported = 0;
+    const char         *err_file;
+    int                 err;
+    gchar              *queue_name;
+    char                errmsg[MSG_MAX_LENGTH+1];
+    char                secondary_errmsg[MSG_MAX_LENGTH+1];
+    guint               i;
+
+    global_ld.go               = TRUE;
+    global_ld.packets_captured = 0;
+    global_ld.err              = 0;
+    *stats_known               = FALSE;
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Fanout capture with %u workers starting ...",
+          fanout_workers);
+
+    interface_opts = &g_array_index(capture_opts->ifaces, interface_options, 0);
+
+    /*
+     * The filter goes into each queue's socket; always compile one, even
+     * if no capture filter was given, as it's also what applies the
+     * snapshot length.
+     */
+    pcap_h = pcap_open_dead(DLT_EN10MB, interface_opts->snaplen);
+    if (pcap_h == NULL) {
+        report_capture_error("Can't compile the capture filter.", please_report_bug());
+        return FALSE;
+    }
+    if (!compile_capture_filter(interface_opts->name, pcap_h, &fcode,
+                                interface_opts->cfilter ? interface_opts->cfilter : "")) {
+        report_cfilter_error(capture_opts, 0, pcap_geterr(pcap_h));
+        pcap_close(pcap_h);
+        return FALSE;
+    }
+    pcap_close(pcap_h);
+
+#ifdef CAN_SET_CAPTURE_BUFFER_SIZE
+    buffer_size = interface_opts->buffer_size;
+#else
+    buffer_size = DEFAULT_CAPTURE_BUFFER_SIZE;
+#endif
+    fc = fanout_capture_open(interface_opts->name, fanout_workers,
+                             interface_opts->snaplen,
+                             interface_opts->promisc_mode,
+                             buffer_size, &fcode,
+                             errmsg, sizeof(errmsg));
+#ifdef HAVE_PCAP_FREECODE
+    pcap_freecode(&fcode);
+#endif
+
+    /* We have our sockets; give up the privileges, as
+       capture_loop_open_input() does, before creating any files. */
+#ifndef HAVE_LIBCAP
+    relinquish_special_privs_perm();
+#else
+    relinquish_all_capabilities();
+#endif
+    if (fc == NULL) {
+        report_capture_error(errmsg, "");
+        return FALSE;
+    }
+
+    os_info_str = g_string_new("");
+    get_os_version_info(os_info_str);
+    cpu_info_str = g_string_new("");
+    get_cpu_info(cpu_info_str);
+    info.comment = capture_opts->capture_comment;
+    info.hardware = cpu_info_str->str;
+    info.os = os_info_str->str;
+    info.application = get_appname_and_version();
+    info.if_descr = interface_opts->descr;
+    info.cfilter = interface_opts->cfilter;
+
+    start_time = create_timestamp();
+    started = fanout_capture_start(fc, capture_opts->save_file,
+                                   capture_opts->group_read_access, &info,
+                                   capture_opts->has_autostop_packets ? capture_opts->autostop_packets : 0,
+                                   errmsg, sizeof(errmsg));
+    g_string_free(cpu_info_str, TRUE);
+    g_string_free(os_info_str, TRUE);
+    if (!started) {
+        report_capture_error(errmsg, "");
+        fanout_capture_free(fc);
+        return FALSE;
+    }
+    for (i = 0; i < fanout_capture_num_queues(fc); i++)
+        report_new_capture_file(fanout_capture_file_name(fc, i));
+
+    if (capture_opts->has_autostop_duration) {
+        autostop_duration_timer = g_timer_new();
+    }
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Fanout capture running.");
+
+    /*
+     * The workers do all of the capturing and writing; all we do is
+     * keep count and check the stop conditions.  A worker stops by
+     * itself if it gets a write error or the packet limit is reached.
+     */
+    while (global_ld.go && fanout_capture_running(fc)) {
+        g_usleep(DUMPCAP_UPD_TIME * 1000);
+
+        packets = fanout_capture_packets(fc);
+        global_ld.packets_captured = (gint)packets;
+        if (packets != packets_reported) {
+            if (!quiet)
+                report_packet_count(packets - packets_reported);
+            packets_reported = packets;
+        }
+#ifdef SIGINFO
+        if (global_ld.report_packet_count) {
+            fprintf(stderr, "%u packet%s captured\n", packets,
+                    plurality(packets, "", "s"));
+            global_ld.report_packet_count = FALSE;
+        }
+#endif
+        if (autostop_duration_timer != NULL &&
+            g_timer_elapsed(autostop_duration_timer, NULL) >= capture_opts->autostop_duration) {
+            global_ld.go = FALSE;
+        }
+    }
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Fanout capture stopping ...");
+    fanout_capture_stop(fc, start_time);
+    if (autostop_duration_timer != NULL)
+        g_timer_destroy(autostop_duration_timer);
+
+    packets = fanout_capture_packets(fc);
+    global_ld.packets_captured = (gint)packets;
+    if (packets != packets_reported && !quiet)
+        report_packet_count(packets - packets_reported);
+
+    err = fanout_capture_get_error(fc, &err_file);
+    if (err != 0) {
+        capture_loop_get_errmsg(errmsg, sizeof(errmsg), secondary_errmsg,
+                                sizeof(secondary_errmsg), err_file, err, FALSE);
+        report_capture_error(errmsg, secondary_errmsg);
+    }
+
+    report_capture_count(TRUE);
+
+    /* Report the drops per queue, so that an overloaded worker shows up. */
+    stats->ps_recv = 0;
+    stats->ps_drop = 0;
+    stats->ps_ifdrop = 0;
+    for (i = 0; i < fanout_capture_num_queues(fc); i++) {
+        fanout_capture_get_stats(fc, i, &qstats);
+        queue_name = g_strdup_printf("%s queue %u", interface_opts->display_name, i);
+        report_packet_drops((guint32)qstats.written, (guint32)qstats.kernel_dropped,
+                            0, 0, 0, queue_name);
+        g_free(queue_name);
+        stats->ps_recv += (u_int)qstats.kernel_received;
+        stats->ps_drop += (u_int)qstats.kernel_dropped;
+    }
+    *stats_known = TRUE;
+
+    fanout_capture_free(fc);
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Fanout capture stopped.");
+
+    return err == 0;
+}
+#endif /* HAVE_TPACKET3 */
+
+
 static void
 capture_loop_stop(void)
 {
@@ -4273,7 +4686,7 @@ capture_loop_wrote_one_packet(capture_src *pcap_src) {
 
     /* check -c NUM / -a packets:NUM */
     if (global_capture_opts.has_autostop_packets && global_ld.packets_captured >= global_capture_opts.autostop_packets) {
-        fflush(global_ld.pdh);
+        capture_loop_flush_output(&global_ld, FALSE, NULL);
         global_ld.go = FALSE;
         return;
     }
@@ -4362,6 +4775,7 @@ capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
     capture_src *pcap_src = (capture_src *) (void *) pcap_src_p;
     int          err;
     guint        ts_mul    = pcap_src->ts_nsec ? 1000000000 : 1000000;
+    guint64      offset    = global_ld.bytes_written;
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_write_packet_cb");
 
@@ -4405,6 +4819,15 @@ capture_loop_write_packet_cb(u_char *pcap_src_p, const struct pcap_pkthdr *phdr,
                   "Wrote a pcap packet of length %d captured on interface %u.",
                    phdr->caplen, pcap_src->interface_id);
 #endif
+            if (global_ld.time_index != NULL) {
+                nstime_t ts;
+
+                /* tv_usec is in nanoseconds for a nanosecond source */
+                ts.secs = phdr->ts.tv_sec;
+                ts.nsecs = pcap_src->ts_nsec ? (int)phdr->ts.tv_usec : (int)phdr->ts.tv_usec * 1000;
+                time_index_builder_add(global_ld.time_index, offset, &ts,
+                                       &global_ld.time_index_counts);
+            }
             capture_loop_wrote_one_packet(pcap_src);
         }
     }
@@ -4608,10 +5031,20 @@ main(int argc, char *argv[])
 {
     char             *err_msg;
     int               opt;
+#define LONGOPT_FANOUT_WORKERS LONGOPT_BASE_APPLICATION+1
+#define LONGOPT_ASYNC_WRITE    LONGOPT_BASE_APPLICATION+2
+#define LONGOPT_TIME_INDEX     LONGOPT_BASE_APPLICATION+3
     static const struct option long_options[] = {
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'v'},
         LONGOPT_CAPTURE_COMMON
+#ifdef HAVE_TPACKET3
+        {"fanout-workers", required_argument, NULL, LONGOPT_FANOUT_WORKERS},
+#endif
+#ifdef HAVE_FOPENCOOKIE
+        {"async-write", optional_argument, NULL, LONGOPT_ASYNC_WRITE},
+#endif
+        {"time-index", no_argument, NULL, LONGOPT_TIME_INDEX},
         {0, 0, 0, 0 }
     };
 
@@ -5013,6 +5446,28 @@ main(int argc, char *argv[])
         case 't':
             use_threads = TRUE;
             break;
+#ifdef HAVE_TPACKET3
+        case LONGOPT_FANOUT_WORKERS:
+            fanout_workers = get_positive_int(optarg, "number of fanout workers");
+            if (fanout_workers > FANOUT_MAX_QUEUES) {
+                cmdarg_err("At most %u fanout workers can be used.", FANOUT_MAX_QUEUES);
+                arg_error = TRUE;
+            }
+            break;
+#endif
+#ifdef HAVE_FOPENCOOKIE
+        case LONGOPT_ASYNC_WRITE:
+            if (optarg != NULL) {
+                /* each block is a MiB */
+                async_write_blocks = get_positive_int(optarg, "asynchronous write buffer size");
+            } else {
+                async_write_blocks = CAPTURE_WRITER_DEFAULT_BLOCKS;
+            }
+            break;
+#endif
+        case LONGOPT_TIME_INDEX:
+            save_time_index = TRUE;
+            break;
             /*** all non capture option specific ***/
         case 'D':        /* Print a list of capture devices and exit */
             if (!list_interfaces) {
@@ -5159,6 +5614,51 @@ main(int argc, char *argv[])
                 exit_main(1);
             }
         }
+
+#ifdef HAVE_TPACKET3
+        /*
+         * A fanout capture writes one file per worker, named after the
+         * -w file, so it needs a permanent pcapng file and can't switch
+         * files; nor is there a way to hand several files to our parent.
+         */
+        if (fanout_workers > 0) {
+            if (global_capture_opts.ifaces->len > 1) {
+                cmdarg_err("A fanout capture can only be done on one interface.");
+                exit_main(1);
+            }
+            if (capture_child) {
+                cmdarg_err("A fanout capture can't be done when dumpcap is run by another program.");
+                exit_main(1);
+            }
+            if (global_capture_opts.save_file == NULL ||
+                global_capture_opts.output_to_pipe) {
+                cmdarg_err("A fanout capture must be saved to a permanent file.");
+                exit_main(1);
+            }
+            if (!global_capture_opts.use_pcapng) {
+                cmdarg_err("A fanout capture can only be saved in pcapng format.");
+                exit_main(1);
+            }
+            if (global_capture_opts.multi_files_on ||
+                global_capture_opts.has_autostop_filesize ||
+                global_capture_opts.has_autostop_files) {
+                cmdarg_err("A fanout capture can't use a ring buffer or file size or file count limits.");
+                exit_main(1);
+            }
+            if (save_time_index) {
+                cmdarg_err("A fanout capture can't save a time index.");
+                exit_main(1);
+            }
+        }
+#endif
+
+        /* The index goes next to the capture file, so there has to be one. */
+        if (save_time_index &&
+            (global_capture_opts.save_file == NULL ||
+             global_capture_opts.output_to_pipe)) {
+            cmdarg_err("A time index can only be saved for a permanent file.");
+            exit_main(1);
+        }
     }
 
     /*
@@ -102,19 +102,42 @@ struct select_item {
 
 /*
  * Duplicate frame detection
+ *
+ * fd_hash[] is a ring holding the digests of the last dup_window frames,
+ * in the order they were read; fd_hash_set maps each digest in the ring
+ * to the number of ring entries with that digest and to the most
+ * recently added one, so looking for a duplicate doesn't depend on the
+ * size of the window.
  */
-typedef struct _fd_hash_t {
+typedef struct _fd_hash_key_t {
     guint8     digest[16];
     guint32    len;
+} fd_hash_key_t;
+
+typedef struct _fd_hash_t {
+    fd_hash_key_t key;
     nstime_t   frame_time;
+    gboolean   in_use;
 } fd_hash_t;
 
+typedef struct _fd_hash_set_entry_t {
+    guint      count;       /* number of fd_hash[] entries with this key */
+    int        newest;      /* index of the most recently added one */
+} fd_hash_set_entry_t;
+
+typedef enum {
+    DUP_DIGEST_MD5,
+    DUP_DIGEST_MURMUR3
+} dup_digest_e;
+
 #define DEFAULT_DUP_DEPTH       5   /* Used with -d */
 #define MAX_DUP_DEPTH     1000000   /* the maximum window (and actual size of fd_hash[]) for de-duplication */
 
-static fd_hash_t fd_hash[MAX_DUP_DEPTH];
-static int       dup_window    = DEFAULT_DUP_DEPTH;
-static int       cur_dup_entry = 0;
+static fd_hash_t   *fd_hash       = NULL;
+static GHashTable  *fd_hash_set   = NULL;
+static int          dup_window    = DEFAULT_DUP_DEPTH;
+static int          cur_dup_entry = 0;
+static dup_digest_e dup_digest    = DUP_DIGEST_MD5;
 
 static guint32   ignored_bytes  = 0;  /* Used with -I */
 
@@ -173,6 +196,7 @@ static gboolean               dup_detect                = FALSE;
 static gboolean               dup_detect_by_time        = FALSE;
 static gboolean               skip_radiotap             = FALSE;
 static gboolean               discard_all_secrets       = FALSE;
+static wtap_compression_type  out_compression_type      = WTAP_UNCOMPRESSED;
 
 static int                    do_strict_time_adjustment = FALSE;
 static struct time_adjustment strict_time_adj           = {NSTIME_INIT_ZERO, 0}; /* strict time adjustment */
@@ -586,57 +610,197 @@ remove_vlan_info(const wtap_packet_header *phdr, guint8* fd, guint32* len) {
     }
 }
 
-static gboolean
-is_duplicate(guint8* fd, guint32 len) {
-    int i;
-    const struct ieee80211_radiotap_header* tap_header;
+static const char *
+dup_digest_name(void)
+{
+    return dup_digest == DUP_DIGEST_MURMUR3 ? "MurmurHash3" : "MD5 Hash";
+}
 
-    /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
-    guint32 offset = ignored_bytes;
-    guint32 new_len;
-    guint8 *new_fd;
+static inline guint64
+rotl64(guint64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
 
-    if (len <= ignored_bytes) {
-        offset = 0;
+static inline guint64
+fmix64(guint64 k)
+{
+    k ^= k >> 33;
+    k *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+    k ^= k >> 33;
+    k *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+    k ^= k >> 33;
+    return k;
+}
+
+/*
+ * 128-bit MurmurHash3 (x64 variant) of a frame, with a seed of 0.
+ * Not cryptographic, but a good deal faster than MD5, which matters
+ * more than collision resistance when removing duplicates.
+ */
+static void
+murmur3_x64_128(const guint8 *data, guint32 len, guint8 digest[16])
+{
+    const guint64 c1 = G_GUINT64_CONSTANT(0x87c37b91114253d5);
+    const guint64 c2 = G_GUINT64_CONSTANT(0x4cf5ad432745937f);
+    const guint8 *tail;
+    guint64 h1 = 0;
+    guint64 h2 = 0;
+    guint64 k1;
+    guint64 k2;
+    guint32 i;
+
+    for (i = 0; i < len / 16; i++) {
+        k1 = pletoh64(data + i * 16);
+        k2 = pletoh64(data + i * 16 + 8);
+
+        k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
     }
 
-    /* Get the size of radiotap header and use that as offset (-p option) */
-    if (skip_radiotap == TRUE) {
-        tap_header = (const struct ieee80211_radiotap_header*)fd;
-        offset = pletoh16(&tap_header->it_len);
-        if (offset >= len)
-            offset = 0;
+    tail = data + (len & ~15U);
+    k1 = 0;
+    k2 = 0;
+    switch (len & 15) {
+    case 15: k2 ^= ((guint64)tail[14]) << 48; /* FALL THROUGH */
+    case 14: k2 ^= ((guint64)tail[13]) << 40; /* FALL THROUGH */
+    case 13: k2 ^= ((guint64)tail[12]) << 32; /* FALL THROUGH */
+    case 12: k2 ^= ((guint64)tail[11]) << 24; /* FALL THROUGH */
+    case 11: k2 ^= ((guint64)tail[10]) << 16; /* FALL THROUGH */
+    case 10: k2 ^= ((guint64)tail[9]) << 8;   /* FALL THROUGH */
+    case  9: k2 ^= ((guint64)tail[8]);
+             k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+             /* FALL THROUGH */
+    case  8: k1 ^= ((guint64)tail[7]) << 56;  /* FALL THROUGH */
+    case  7: k1 ^= ((guint64)tail[6]) << 48;  /* FALL THROUGH */
+    case  6: k1 ^= ((guint64)tail[5]) << 40;  /* FALL THROUGH */
+    case  5: k1 ^= ((guint64)tail[4]) << 32;  /* FALL THROUGH */
+    case  4: k1 ^= ((guint64)tail[3]) << 24;  /* FALL THROUGH */
+    case  3: k1 ^= ((guint64)tail[2]) << 16;  /* FALL THROUGH */
+    case  2: k1 ^= ((guint64)tail[1]) << 8;   /* FALL THROUGH */
+    case  1: k1 ^= ((guint64)tail[0]);
+             k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+             break;
+    default:
+             break;
     }
 
-    new_fd  = &fd[offset];
-    new_len = len - (offset);
+    h1 ^= len;
+    h2 ^= len;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+
+    phtole64(digest, h1);
+    phtole64(digest + 8, h2);
+}
+
+static guint
+fd_hash_key_hash(gconstpointer key)
+{
+    const fd_hash_key_t *fd_key = (const fd_hash_key_t *)key;
+
+    /* The digest is already well mixed; any 32 bits of it will do. */
+    return pletoh32(fd_key->digest) ^ fd_key->len;
+}
+
+static gboolean
+fd_hash_key_equal(gconstpointer a, gconstpointer b)
+{
+    const fd_hash_key_t *key_a = (const fd_hash_key_t *)a;
+    const fd_hash_key_t *key_b = (const fd_hash_key_t *)b;
+
+    return key_a->len == key_b->len &&
+           memcmp(key_a->digest, key_b->digest, sizeof key_a->digest) == 0;
+}
+
+static void
+fd_hash_init(void)
+{
+    /* A window of 0 still uses one entry, so that -v can print digests. */
+    fd_hash = g_new0(fd_hash_t, MAX(dup_window, 1));
+    fd_hash_set = g_hash_table_new_full(fd_hash_key_hash, fd_hash_key_equal,
+                                        g_free, g_free);
+}
+
+static void
+fd_hash_cleanup(void)
+{
+    if (fd_hash_set) {
+        g_hash_table_destroy(fd_hash_set);
+        fd_hash_set = NULL;
+    }
+    g_free(fd_hash);
+    fd_hash = NULL;
+}
+
+/*
+ * Advance to the next fd_hash[] entry, dropping the frame it held from
+ * fd_hash_set, and fill in its key with the digest and length of the
+ * given frame data.
+ */
+static fd_hash_t *
+fd_hash_next_entry(const guint8 *fd, guint32 digest_len, guint32 len)
+{
+    fd_hash_t *entry;
+    fd_hash_set_entry_t *set_entry;
 
     cur_dup_entry++;
     if (cur_dup_entry >= dup_window)
         cur_dup_entry = 0;
+    entry = &fd_hash[cur_dup_entry];
+
+    if (entry->in_use) {
+        set_entry = (fd_hash_set_entry_t *)g_hash_table_lookup(fd_hash_set, &entry->key);
+        if (set_entry && --set_entry->count == 0)
+            g_hash_table_remove(fd_hash_set, &entry->key);
+        entry->in_use = FALSE;
+    }
 
     /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
+    if (dup_digest == DUP_DIGEST_MURMUR3)
+        murmur3_x64_128(fd, digest_len, entry->key.digest);
+    else
+        gcry_md_hash_buffer(GCRY_MD_MD5, entry->key.digest, fd, digest_len);
 
-    fd_hash[cur_dup_entry].len = len;
+    entry->key.len = len;
+    nstime_set_unset(&entry->frame_time);
 
-    /* Look for duplicates */
-    for (i = 0; i < dup_window; i++) {
-        if (i == cur_dup_entry)
-            continue;
+    return entry;
+}
 
-        if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-            && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
-            return TRUE;
-        }
+/*
+ * Add the current fd_hash[] entry to fd_hash_set, now that it's been
+ * compared with the others.
+ */
+static void
+fd_hash_add_current_entry(void)
+{
+    fd_hash_t *entry = &fd_hash[cur_dup_entry];
+    fd_hash_set_entry_t *set_entry;
+
+    set_entry = (fd_hash_set_entry_t *)g_hash_table_lookup(fd_hash_set, &entry->key);
+    if (set_entry == NULL) {
+        set_entry = g_new0(fd_hash_set_entry_t, 1);
+        g_hash_table_insert(fd_hash_set,
+                            g_memdup(&entry->key, sizeof entry->key),
+                            set_entry);
     }
-
-    return FALSE;
+    set_entry->count++;
+    set_entry->newest = cur_dup_entry;
+    entry->in_use = TRUE;
 }
 
 static gboolean
-is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
-    int i;
+is_duplicate(guint8* fd, guint32 len) {
+    gboolean dup;
+    const struct ieee80211_radiotap_header* tap_header;
 
     /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
     guint32 offset = ignored_bytes;
@@ -647,40 +811,36 @@ is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
         offset = 0;
     }
 
+    /* Get the size of radiotap header and use that as offset (-p option) */
+    if (skip_radiotap == TRUE) {
+        tap_header = (const struct ieee80211_radiotap_header*)fd;
+        offset = pletoh16(&tap_header->it_len);
+        if (offset >= len)
+            offset = 0;
+    }
+
     new_fd  = &fd[offset];
     new_len = len - (offset);
 
-    cur_dup_entry++;
-    if (cur_dup_entry >= dup_window)
-        cur_dup_entry = 0;
+    fd_hash_next_entry(new_fd, new_len, len);
 
-    /* Calculate our digest */
-    gcry_md_hash_buffer(GCRY_MD_MD5, fd_hash[cur_dup_entry].digest, new_fd, new_len);
+    /* Look for duplicates among the other entries in the window */
+    dup = g_hash_table_contains(fd_hash_set, &fd_hash[cur_dup_entry].key);
 
-    fd_hash[cur_dup_entry].len = len;
-    fd_hash[cur_dup_entry].frame_time.secs = current->secs;
-    fd_hash[cur_dup_entry].frame_time.nsecs = current->nsecs;
+    fd_hash_add_current_entry();
 
-    /*
-     * Look for relative time related duplicates.
-     * This is hopefully a reasonably efficient mechanism for
-     * finding duplicates by rel time in the fd_hash[] cache.
-     * We check starting from the most recently added hash
-     * entries and work backwards towards older packets.
-     * This approach allows the dup test to be terminated
-     * when the relative time of a cached entry is found to
-     * be beyond the dup time window.
-     *
-     * Of course this assumes that the input trace file is
-     * "well-formed" in the sense that the packet timestamps are
-     * in strict chronologically increasing order (which is NOT
-     * always the case!!).
-     *
-     * The fd_hash[] table was deliberately created large (1,000,000).
-     * Looking for time related duplicates in large trace files with
-     * non-fractional dup time window values can potentially take
-     * a long time to complete.
-     */
+    return dup;
+}
+
+/*
+ * Look for a duplicate of the current entry, within the relative time
+ * window, by walking back through fd_hash[] from the most recently added
+ * entry.  This is only needed when the frames aren't in chronological
+ * order.
+ */
+static gboolean
+is_duplicate_rel_time_scan(const nstime_t *current) {
+    int i;
 
     for (i = cur_dup_entry - 1;; i--) {
         nstime_t delta;
@@ -697,7 +857,7 @@ is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
             break;
         }
 
-        if (nstime_is_unset(&(fd_hash[i].frame_time))) {
+        if (!fd_hash[i].in_use) {
             /*
              * We've decremented to an unused fd_hash[] entry.
              * Check no more!
@@ -738,8 +898,7 @@ is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
              * Check no more!
              */
             break;
-        } else if (fd_hash[i].len == fd_hash[cur_dup_entry].len
-                   && memcmp(fd_hash[i].digest, fd_hash[cur_dup_entry].digest, 16) == 0) {
+        } else if (fd_hash_key_equal(&fd_hash[i].key, &fd_hash[cur_dup_entry].key)) {
             return TRUE;
         }
     }
@@ -747,6 +906,59 @@ is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
     return FALSE;
 }
 
+static gboolean
+is_duplicate_rel_time(guint8* fd, guint32 len, const nstime_t *current) {
+    fd_hash_set_entry_t *set_entry;
+    gboolean dup = FALSE;
+
+    /*Hint to ignore some bytes at the start of the frame for the digest calculation(-I option) */
+    guint32 offset = ignored_bytes;
+    guint32 new_len;
+    guint8 *new_fd;
+
+    if (len <= ignored_bytes) {
+        offset = 0;
+    }
+
+    new_fd  = &fd[offset];
+    new_len = len - (offset);
+
+    fd_hash_next_entry(new_fd, new_len, len);
+    fd_hash[cur_dup_entry].frame_time.secs = current->secs;
+    fd_hash[cur_dup_entry].frame_time.nsecs = current->nsecs;
+
+    /*
+     * Look for relative time related duplicates.
+     *
+     * If the input trace file is "well-formed" in the sense that the
+     * packet timestamps are in strict chronologically increasing order,
+     * the most recently added frame with the same digest and length is
+     * also the latest one, so it's the only one we need to check.
+     *
+     * If it isn't, that frame may have a later time stamp than the
+     * current one, and we fall back on checking each cached frame in
+     * turn, from the most recently added one back to the first one
+     * beyond the dup time window.
+     *
+     * The fd_hash[] table was deliberately created large (1,000,000),
+     * so this can still take a while with out-of-order trace files.
+     */
+    set_entry = (fd_hash_set_entry_t *)g_hash_table_lookup(fd_hash_set, &fd_hash[cur_dup_entry].key);
+    if (set_entry != NULL) {
+        nstime_t delta;
+
+        nstime_delta(&delta, current, &fd_hash[set_entry->newest].frame_time);
+        if (delta.secs < 0 || delta.nsecs < 0)
+            dup = is_duplicate_rel_time_scan(current);
+        else
+            dup = nstime_cmp(&delta, &relative_time_window) <= 0;
+    }
+
+    fd_hash_add_current_entry();
+
+    return dup;
+}
+
 static void
 print_usage(FILE *output)
 {
@@ -770,6 +982,10 @@ print_usage(FILE *output)
     fprintf(output, "                         Valid <dup window> values are 0 to %d.\n", MAX_DUP_DEPTH);
     fprintf(output, "                         NOTE: A <dup window> of 0 with -v (verbose option) is\n");
     fprintf(output, "                         useful to print MD5 hashes.\n");
+    fprintf(output, "  --dup-digest md5|murmur3\n");
+    fprintf(output, "                         digest used to compare packets with -d, -D or -w;\n");
+    fprintf(output, "                         default is md5. murmur3 is not cryptographic, but\n");
+    fprintf(output, "                         is much faster.\n");
     fprintf(output, "  -w <dup time window>   remove packet if duplicate packet is found EQUAL TO OR\n");
     fprintf(output, "                         LESS THAN <dup time window> prior to current packet.\n");
     fprintf(output, "                         A <dup time window> is specified in relative seconds\n");
@@ -839,6 +1055,8 @@ print_usage(FILE *output)
     fprintf(output, "  -T <encap type>        set the output file encapsulation type; default is the\n");
     fprintf(output, "                         same as the input file. An empty \"-T\" option will\n");
     fprintf(output, "                         list the encapsulation types.\n");
+    fprintf(output, "  --compress gzip|zstd|lz4\n");
+    fprintf(output, "                         compress the output file(s) with the given method.\n");
     fprintf(output, "  --inject-secrets <type>,<file>  Insert decryption secrets from <file>. List\n");
     fprintf(output, "                         supported secret types with \"--inject-secrets help\".\n");
     fprintf(output, "  --discard-all-secrets  Discard all decryption secrets from the input file\n");
@@ -1000,10 +1218,10 @@ editcap_dump_open(const char *filename, const wtap_dump_params *params,
 
     if (strcmp(filename, "-") == 0) {
         /* Write to the standard output. */
-        pdh = wtap_dump_open_stdout(out_file_type_subtype, WTAP_UNCOMPRESSED,
+        pdh = wtap_dump_open_stdout(out_file_type_subtype, out_compression_type,
                                     params, write_err);
     } else {
-        pdh = wtap_dump_open(filename, out_file_type_subtype, WTAP_UNCOMPRESSED,
+        pdh = wtap_dump_open(filename, out_file_type_subtype, out_compression_type,
                              params, write_err);
     }
     return pdh;
@@ -1023,6 +1241,8 @@ main(int argc, char *argv[])
 #define LONGOPT_SEED                 LONGOPT_BASE_APPLICATION+3
 #define LONGOPT_INJECT_SECRETS       LONGOPT_BASE_APPLICATION+4
 #define LONGOPT_DISCARD_ALL_SECRETS  LONGOPT_BASE_APPLICATION+5
+#define LONGOPT_DUP_DIGEST           LONGOPT_BASE_APPLICATION+6
+#define LONGOPT_COMPRESS             LONGOPT_BASE_APPLICATION+7
 
     static const struct option long_options[] = {
         {"novlan", no_argument, NULL, LONGOPT_NO_VLAN},
@@ -1030,6 +1250,8 @@ main(int argc, char *argv[])
         {"seed", required_argument, NULL, LONGOPT_SEED},
         {"inject-secrets", required_argument, NULL, LONGOPT_INJECT_SECRETS},
         {"discard-all-secrets", no_argument, NULL, LONGOPT_DISCARD_ALL_SECRETS},
+        {"dup-digest", required_argument, NULL, LONGOPT_DUP_DIGEST},
+        {"compress", required_argument, NULL, LONGOPT_COMPRESS},
         {"help", no_argument, NULL, 'h'},
         {"version", no_argument, NULL, 'V'},
         {0, 0, 0, 0 }
@@ -1043,6 +1265,7 @@ main(int argc, char *argv[])
     unsigned int  count              = 1;
     unsigned int  duplicate_count    = 0;
     gint64        data_offset;
+    gint64        stop_offset        = -1;
     int           err_type;
     guint8       *buf;
     guint32       read_count         = 0;
@@ -1169,6 +1392,44 @@ main(int argc, char *argv[])
             break;
         }
 
+        case LONGOPT_DUP_DIGEST:
+        {
+            if (g_ascii_strcasecmp(optarg, "md5") == 0) {
+                dup_digest = DUP_DIGEST_MD5;
+            } else if (g_ascii_strcasecmp(optarg, "murmur3") == 0) {
+                dup_digest = DUP_DIGEST_MURMUR3;
+            } else {
+                fprintf(stderr, "editcap: \"%s\" isn't a valid duplicate digest; use md5 or murmur3.\n",
+                        optarg);
+                ret = INVALID_OPTION;
+                goto clean_exit;
+            }
+            break;
+        }
+
+        case LONGOPT_COMPRESS:
+        {
+            if (g_ascii_strcasecmp(optarg, "gzip") == 0) {
+                out_compression_type = WTAP_GZIP_COMPRESSED;
+            } else if (g_ascii_strcasecmp(optarg, "zstd") == 0) {
+                out_compression_type = WTAP_ZSTD_COMPRESSED;
+            } else if (g_ascii_strcasecmp(optarg, "lz4") == 0) {
+                out_compression_type = WTAP_LZ4_COMPRESSED;
+            } else {
+                fprintf(stderr, "editcap: \"%s\" isn't a valid compression method; use gzip, zstd or lz4.\n",
+                        optarg);
+                ret = INVALID_OPTION;
+                goto clean_exit;
+            }
+            if (wtap_compression_type_extension(out_compression_type) == NULL) {
+                fprintf(stderr, "editcap: this version of editcap can't write %s compressed files.\n",
+                        optarg);
+                ret = INVALID_OPTION;
+                goto clean_exit;
+            }
+            break;
+        }
+
         case 'a':
         {
             guint frame_number;
@@ -1575,11 +1836,35 @@ main(int argc, char *argv[])
         max_packet_number = G_MAXUINT;
 
     if (dup_detect || dup_detect_by_time) {
-        for (i = 0; i < dup_window; i++) {
-            memset(&fd_hash[i].digest, 0, 16);
-            fd_hash[i].len = 0;
-            nstime_set_unset(&fd_hash[i].frame_time);
+        fd_hash_init();
+    }
+
+    /*
+     * If only the packets in a time range are wanted, and the input file
+     * has a time index, skip the packets before the range and stop
+     * reading after it.  Splitting the output needs the first packet,
+     * to name the files and to start the intervals, so don't do it then.
+     */
+    if (check_startstop && split_packet_count == 0 &&
+        nstime_is_unset(&secs_per_block)) {
+        nstime_t start_ts, stop_ts;
+
+        start_ts.secs = starttime;
+        start_ts.nsecs = 0;
+        stop_ts.secs = stoptime;
+        stop_ts.nsecs = 0;
+        if (!wtap_seek_to_time(wth, argv[optind], &start_ts, &stop_ts,
+                               &read_count, &stop_offset, &read_err,
+                               &read_err_info)) {
+            cfile_read_failure_message("editcap", argv[optind], read_err,
+                                       read_err_info);
+            ret = INVALID_FILE;
+            goto clean_exit;
         }
+        count += read_count;
+        if (verbose && read_count != 0)
+            fprintf(stderr, "Skipped %u packet%s using the time index.\n",
+                    read_count, plurality(read_count, "", "s"));
     }
 
     /* Read all of the packets in turn */
@@ -1589,12 +1874,16 @@ main(int argc, char *argv[])
         if (max_packet_number <= read_count)
             break;
 
+        /* None of the packets from here on are in the time range */
+        if (stop_offset != -1 && data_offset >= stop_offset)
+            break;
+
         read_count++;
 
         rec = &read_rec;
 
         /* Extra actions for the first packet */
-        if (read_count == 1) {
+        if (pdh == NULL) {
             if (split_packet_count != 0 || !nstime_is_unset(&secs_per_block)) {
                 if (!fileset_extract_prefix_suffix(argv[optind+1], &fprefix, &fsuffix)) {
                     ret = CANT_EXTRACT_PREFIX;
@@ -1863,12 +2152,13 @@ main(int argc, char *argv[])
                 if (dup_detect) {
                     if (is_duplicate(buf, rec->rec_header.packet_header.caplen)) {
                         if (verbose) {
-                            fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
+                            fprintf(stderr, "Skipped: %u, Len: %u, %s: ",
                                     count,
-                                    rec->rec_header.packet_header.caplen);
+                                    rec->rec_header.packet_header.caplen,
+                                    dup_digest_name());
                             for (i = 0; i < 16; i++)
                                 fprintf(stderr, "%02x",
-                                        (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                        (unsigned char)fd_hash[cur_dup_entry].key.digest[i]);
                             fprintf(stderr, "\n");
                         }
                         duplicate_count++;
@@ -1876,12 +2166,13 @@ main(int argc, char *argv[])
                         continue;
                     } else {
                         if (verbose) {
-                            fprintf(stderr, "Packet: %u, Len: %u, MD5 Hash: ",
+                            fprintf(stderr, "Packet: %u, Len: %u, %s: ",
                                     count,
-                                    rec->rec_header.packet_header.caplen);
+                                    rec->rec_header.packet_header.caplen,
+                                    dup_digest_name());
                             for (i = 0; i < 16; i++)
                                 fprintf(stderr, "%02x",
-                                        (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                        (unsigned char)fd_hash[cur_dup_entry].key.digest[i]);
                             fprintf(stderr, "\n");
                         }
                     }
@@ -1899,12 +2190,13 @@ main(int argc, char *argv[])
                                                   rec->rec_header.packet_header.caplen,
                                                   &current)) {
                             if (verbose) {
-                                fprintf(stderr, "Skipped: %u, Len: %u, MD5 Hash: ",
+                                fprintf(stderr, "Skipped: %u, Len: %u, %s: ",
                                         count,
-                                        rec->rec_header.packet_header.caplen);
+                                        rec->rec_header.packet_header.caplen,
+                                        dup_digest_name());
                                 for (i = 0; i < 16; i++)
                                     fprintf(stderr, "%02x",
-                                            (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                            (unsigned char)fd_hash[cur_dup_entry].key.digest[i]);
                                 fprintf(stderr, "\n");
                             }
                             duplicate_count++;
@@ -1912,12 +2204,13 @@ main(int argc, char *argv[])
                             continue;
                         } else {
                             if (verbose) {
-                                fprintf(stderr, "Packet: %u, Len: %u, MD5 Hash: ",
+                                fprintf(stderr, "Packet: %u, Len: %u, %s: ",
                                         count,
-                                        rec->rec_header.packet_header.caplen);
+                                        rec->rec_header.packet_header.caplen,
+                                        dup_digest_name());
                                 for (i = 0; i < 16; i++)
                                     fprintf(stderr, "%02x",
-                                            (unsigned char)fd_hash[cur_dup_entry].digest[i]);
+                                            (unsigned char)fd_hash[cur_dup_entry].key.digest[i]);
                                 fprintf(stderr, "\n");
                             }
                         }
@@ -2106,6 +2399,7 @@ main(int argc, char *argv[])
     }
 
 clean_exit:
+    fd_hash_cleanup();
     if (dsb_filenames) {
         g_array_free(dsb_types, TRUE);
         g_ptr_array_free(dsb_filenames, TRUE);
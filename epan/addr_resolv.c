@@ -81,6 +81,7 @@
 #include "addr_and_mask.h"
 #include "ipv6.h"
 #include "addr_resolv.h"
+#include "addr_resolv_db.h"
 #include "wsutil/filesystem.h"
 
 #include <wsutil/report_message.h>
@@ -774,27 +775,43 @@ _serv_name_lookup(port_type proto, guint port, serv_port_t **value_ret)
 {
     serv_port_t *serv_port_table;
 
+    const gchar *name = NULL;
+    guint transport;
+
     serv_port_table = (serv_port_t *)wmem_map_lookup(serv_port_hashtable, GUINT_TO_POINTER(port));
 
     if (value_ret != NULL)
         *value_ret = serv_port_table;
 
-    if (serv_port_table == NULL)
-        return NULL;
-
     switch (proto) {
         case PT_UDP:
-            return serv_port_table->udp_name;
+            if (serv_port_table != NULL)
+                name = serv_port_table->udp_name;
+            transport = NAMES_DB_UDP;
+            break;
         case PT_TCP:
-            return serv_port_table->tcp_name;
+            if (serv_port_table != NULL)
+                name = serv_port_table->tcp_name;
+            transport = NAMES_DB_TCP;
+            break;
         case PT_SCTP:
-            return serv_port_table->sctp_name;
+            if (serv_port_table != NULL)
+                name = serv_port_table->sctp_name;
+            transport = NAMES_DB_SCTP;
+            break;
         case PT_DCCP:
-            return serv_port_table->dccp_name;
-        default:
+            if (serv_port_table != NULL)
+                name = serv_port_table->dccp_name;
+            transport = NAMES_DB_DCCP;
             break;
+        default:
+            return NULL;
     }
-    return NULL;
+
+    /* Names from the personal services file take precedence. */
+    if (name == NULL)
+        names_db_lookup(NAMES_DB_SERVICES, NAMES_DB_SERVICE_KEY(transport, port), &name, NULL);
+    return name;
 }
 
 const gchar *
@@ -835,7 +852,8 @@ initialize_services(void)
     if (g_services_path == NULL) {
         g_services_path = get_datafile_path(ENAME_SERVICES);
     }
-    parse_services_file(g_services_path);
+    if (!names_db_use_table(NAMES_DB_SERVICES, g_services_path))
+        parse_services_file(g_services_path);
 
     /* Compute the pathname of the personal services file */
     if (g_pservices_path == NULL) {
@@ -912,7 +930,8 @@ initialize_enterprises(void)
     if (g_enterprises_path == NULL) {
         g_enterprises_path = get_datafile_path(ENAME_ENTERPRISES);
     }
-    parse_enterprises_file(g_enterprises_path);
+    if (!names_db_use_table(NAMES_DB_ENTERPRISES, g_enterprises_path))
+        parse_enterprises_file(g_enterprises_path);
 
     if (g_penterprises_path == NULL) {
         g_penterprises_path = get_persconffile_path(ENAME_ENTERPRISES, FALSE);
@@ -923,7 +942,12 @@ initialize_enterprises(void)
 const gchar *
 try_enterprises_lookup(guint32 value)
 {
-    return (const gchar *)g_hash_table_lookup(enterprises_hashtable, GUINT_TO_POINTER(value));
+    const gchar *name;
+
+    name = (const gchar *)g_hash_table_lookup(enterprises_hashtable, GUINT_TO_POINTER(value));
+    if (name == NULL)
+        names_db_lookup(NAMES_DB_ENTERPRISES, value, &name, NULL);
+    return name;
 }
 
 const gchar *
@@ -1527,7 +1551,7 @@ get_ethbyaddr(const guint8 *addr)
 } /* get_ethbyaddr */
 
 static hashmanuf_t *
-manuf_hash_new_entry(const guint8 *addr, char* name, char* longname)
+manuf_hash_new_entry(const guint8 *addr, const char* name, const char* longname)
 {
     guint manuf_key;
     hashmanuf_t *manuf_value;
@@ -1600,6 +1624,8 @@ manuf_name_lookup(const guint8 *addr)
     guint32       manuf_key;
     guint8       oct;
     hashmanuf_t  *manuf_value;
+    guint8        masked_addr[3];
+    const char   *name, *longname;
 
     /* manuf needs only the 3 most significant octets of the ethernet address */
     manuf_key = addr[0];
@@ -1616,6 +1642,9 @@ manuf_name_lookup(const guint8 *addr)
     if (manuf_value != NULL) {
         return manuf_value;
     }
+    if (names_db_lookup(NAMES_DB_MANUF, NAMES_DB_MANUF_KEY(0, (guint64)manuf_key << 24), &name, &longname)) {
+        return manuf_hash_new_entry(addr, name, longname);
+    }
 
     /* Mask out the broadcast/multicast flag but not the locally
      * administered flag as locally administered means: not assigned
@@ -1628,6 +1657,14 @@ manuf_name_lookup(const guint8 *addr)
         if (manuf_value != NULL) {
             return manuf_value;
         }
+        if (names_db_lookup(NAMES_DB_MANUF, NAMES_DB_MANUF_KEY(0, (guint64)manuf_key << 24), &name, &longname)) {
+            /* Cache it under the ID without the flag, as it would have
+               been if the manuf file had been parsed. */
+            masked_addr[0] = addr[0] & 0xFE;
+            masked_addr[1] = addr[1];
+            masked_addr[2] = addr[2];
+            return manuf_hash_new_entry(masked_addr, name, longname);
+        }
     }
 
     /* Add the address as a hex string */
@@ -1642,6 +1679,7 @@ wka_name_lookup(const guint8 *addr, const unsigned int mask)
     guint      num;
     gint       i;
     gchar     *name;
+    const char *db_name;
 
     if (wka_hashtable == NULL) {
         return NULL;
@@ -1657,6 +1695,10 @@ wka_name_lookup(const guint8 *addr, const unsigned int mask)
         masked_addr[i] = 0;
 
     name = (gchar *)wmem_map_lookup(wka_hashtable, masked_addr);
+    if (name == NULL &&
+        names_db_lookup(NAMES_DB_MANUF, NAMES_DB_MANUF_KEY(mask, pntoh48(masked_addr)), &db_name, NULL)) {
+        name = (gchar *)db_name;
+    }
 
     return name;
 
@@ -1716,12 +1758,14 @@ initialize_ethers(void)
     if (g_manuf_path == NULL)
         g_manuf_path = get_datafile_path(ENAME_MANUF);
 
-    /* Read it and initialize the hash table */
-    set_ethent(g_manuf_path);
-    while ((eth = get_ethent(&mask, TRUE))) {
-        add_manuf_name(eth->addr, mask, eth->name, eth->longname);
+    /* Read it and initialize the hash table, unless it's in the names database */
+    if (!names_db_use_table(NAMES_DB_MANUF, g_manuf_path)) {
+        set_ethent(g_manuf_path);
+        while ((eth = get_ethent(&mask, TRUE))) {
+            add_manuf_name(eth->addr, mask, eth->name, eth->longname);
+        }
+        end_ethent();
     }
-    end_ethent();
 
     /* Compute the pathname of the wka file */
     if (g_wka_path == NULL)
@@ -1755,6 +1799,15 @@ eth_addr_resolve(hashether_t *tp) {
     ether_t      *eth;
     hashmanuf_t *manuf_value;
     const guint8 *addr = tp->addr;
+    const char   *db_name;
+
+    /* Well-known addresses in the manuf file take precedence over the
+       ethers files, as they do when they're read into the hash table. */
+    if (names_db_lookup(NAMES_DB_MANUF, NAMES_DB_MANUF_KEY(48, pntoh48(addr)), &db_name, NULL)) {
+        g_strlcpy(tp->resolved_name, db_name, MAXNAMELEN);
+        tp->status = HASHETHER_STATUS_RESOLVED_NAME;
+        return tp;
+    }
 
     if ( (eth = get_ethbyaddr(addr)) != NULL) {
         g_strlcpy(tp->resolved_name, eth->name, MAXNAMELEN);
@@ -3607,6 +3660,12 @@ get_ipv6_hash_table(void)
 void
 addr_resolv_init(void)
 {
+    gchar *names_db_path;
+
+    names_db_path = get_datafile_path(NAMES_DB_FILE);
+    names_db_open(names_db_path);
+    g_free(names_db_path);
+
     initialize_services();
     initialize_ethers();
     initialize_ipxnets();
@@ -3625,6 +3684,7 @@ addr_resolv_cleanup(void)
     ipx_name_lookup_cleanup();
     enterprises_cleanup();
     host_name_lookup_cleanup();
+    names_db_close();
 }
 
 gboolean
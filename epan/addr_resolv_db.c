@@ -0,0 +1,202 @@
+/* addr_resolv_db.c
+ * Lookups in the precompiled name resolution database
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+
+#include "addr_resolv_db.h"
+
+/*
+ * The file format is described in tools/make-names-db.py.  Everything
+ * is little-endian.
+ */
+#define NAMES_DB_MAGIC          "WSND"
+#define NAMES_DB_VERSION        1
+#define NAMES_DB_HEADER_LEN     16
+#define NAMES_DB_DIR_ENTRY_LEN  28
+#define NAMES_DB_SLOT_LEN       16
+
+typedef struct {
+    guint32 num_buckets;
+    guint32 num_slots;
+    guint32 source_size;
+    const guint8 *seeds;
+    const guint8 *slots;
+    gboolean in_use;
+} names_db_table_t;
+
+static GMappedFile *names_db_file = NULL;
+static const guint8 *names_db_contents = NULL;
+static gsize names_db_len = 0;
+static time_t names_db_mtime = 0;
+static names_db_table_t names_db_tables[NAMES_DB_NUM_TABLES];
+
+/* Must match mix() in tools/make-names-db.py. */
+static inline guint64
+names_db_mix(guint64 key, guint32 seed)
+{
+    guint64 z = key + ((guint64)seed + 1) * G_GUINT64_CONSTANT(0x9E3779B97F4A7C15);
+
+    z = (z ^ (z >> 30)) * G_GUINT64_CONSTANT(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * G_GUINT64_CONSTANT(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+static gboolean
+names_db_range_valid(guint32 offset, guint64 len)
+{
+    return offset <= names_db_len && len <= names_db_len - offset;
+}
+
+gboolean
+names_db_open(const char *path)
+{
+    ws_statb64 db_stat;
+    guint32 num_tables, i;
+
+    names_db_close();
+
+    if (ws_stat64(path, &db_stat) != 0)
+        return FALSE;
+    names_db_file = g_mapped_file_new(path, FALSE, NULL);
+    if (names_db_file == NULL)
+        return FALSE;
+    names_db_contents = (const guint8 *)g_mapped_file_get_contents(names_db_file);
+    names_db_len = g_mapped_file_get_length(names_db_file);
+    names_db_mtime = db_stat.st_mtime;
+
+    /*
+     * The strings are at the end, so if the last byte is a NUL none of
+     * them can run off the end of the file.
+     */
+    if (names_db_len < NAMES_DB_HEADER_LEN ||
+        memcmp(names_db_contents, NAMES_DB_MAGIC, 4) != 0 ||
+        pletoh32(names_db_contents + 4) != NAMES_DB_VERSION ||
+        names_db_contents[names_db_len - 1] != '\0')
+        goto invalid;
+
+    num_tables = pletoh32(names_db_contents + 8);
+    if (!names_db_range_valid(NAMES_DB_HEADER_LEN, (guint64)num_tables * NAMES_DB_DIR_ENTRY_LEN))
+        goto invalid;
+
+    for (i = 0; i < num_tables; i++) {
+        const guint8 *entry = names_db_contents + NAMES_DB_HEADER_LEN + i * NAMES_DB_DIR_ENTRY_LEN;
+        guint32 id = pletoh32(entry);
+        guint32 num_buckets = pletoh32(entry + 8);
+        guint32 num_slots = pletoh32(entry + 12);
+        guint32 seeds_offset = pletoh32(entry + 20);
+        guint32 slots_offset = pletoh32(entry + 24);
+        names_db_table_t *table;
+
+        /* Skip tables added by later versions of the generator. */
+        if (id < 1 || id > NAMES_DB_NUM_TABLES)
+            continue;
+        if (num_buckets == 0 || num_slots == 0 ||
+            !names_db_range_valid(seeds_offset, (guint64)num_buckets * 4) ||
+            !names_db_range_valid(slots_offset, (guint64)num_slots * NAMES_DB_SLOT_LEN))
+            goto invalid;
+
+        table = &names_db_tables[id - 1];
+        table->num_buckets = num_buckets;
+        table->num_slots = num_slots;
+        table->source_size = pletoh32(entry + 16);
+        table->seeds = names_db_contents + seeds_offset;
+        table->slots = names_db_contents + slots_offset;
+    }
+    return TRUE;
+
+invalid:
+    names_db_close();
+    return FALSE;
+}
+
+void
+names_db_close(void)
+{
+    if (names_db_file != NULL) {
+        g_mapped_file_unref(names_db_file);
+        names_db_file = NULL;
+    }
+    names_db_contents = NULL;
+    names_db_len = 0;
+    names_db_mtime = 0;
+    memset(names_db_tables, 0, sizeof(names_db_tables));
+}
+
+gboolean
+names_db_use_table(names_db_table_e table_id, const char *source_path)
+{
+    names_db_table_t *table = &names_db_tables[table_id - 1];
+    ws_statb64 source_stat;
+
+    if (table->slots == NULL)
+        return FALSE;
+
+    /*
+     * If the text file has been edited since the database was compiled,
+     * it has to be parsed: it's no longer the size of the file the table
+     * was compiled from, or it was modified after the database was
+     * written.  A file that isn't there at all doesn't matter.
+     */
+    if (source_path != NULL && ws_stat64(source_path, &source_stat) == 0 &&
+        ((guint64)source_stat.st_size != table->source_size ||
+         source_stat.st_mtime > names_db_mtime))
+        return FALSE;
+
+    table->in_use = TRUE;
+    return TRUE;
+}
+
+gboolean
+names_db_lookup(names_db_table_e table_id, guint64 key,
+    const char **name, const char **longname)
+{
+    const names_db_table_t *table = &names_db_tables[table_id - 1];
+    const guint8 *slot;
+    guint32 seed, name_offset, longname_offset;
+
+    if (!table->in_use)
+        return FALSE;
+
+    seed = pletoh32(table->seeds + 4 * (names_db_mix(key, 0) % table->num_buckets));
+    slot = table->slots + NAMES_DB_SLOT_LEN * (names_db_mix(key, seed) % table->num_slots);
+
+    /* Every key hashes to some slot; check that it's this key's. */
+    name_offset = pletoh32(slot + 8);
+    if (name_offset == 0 || pletoh64(slot) != key)
+        return FALSE;
+    longname_offset = pletoh32(slot + 12);
+    if (name_offset >= names_db_len || longname_offset >= names_db_len)
+        return FALSE;
+
+    *name = (const char *)names_db_contents + name_offset;
+    if (longname != NULL)
+        *longname = (const char *)names_db_contents + longname_offset;
+    return TRUE;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
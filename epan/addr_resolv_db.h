@@ -0,0 +1,93 @@
+/* addr_resolv_db.h
+ * Definitions for the precompiled name resolution database
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __ADDR_RESOLV_DB_H__
+#define __ADDR_RESOLV_DB_H__
+
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * tools/make-names-db.py compiles the global manuf, services and
+ * enterprises.tsv files into a file of perfect hash tables, which is
+ * mapped into memory and searched in place instead of parsing the text
+ * files at startup.
+ */
+#define NAMES_DB_FILE   "names.db"
+
+typedef enum {
+    NAMES_DB_MANUF = 1,
+    NAMES_DB_SERVICES = 2,
+    NAMES_DB_ENTERPRISES = 3
+} names_db_table_e;
+
+#define NAMES_DB_NUM_TABLES 3
+
+/*
+ * Keys of the manuf table.  The mask is 0 for a manufacturer ID, and
+ * addr is the address as a 48-bit number with the bits outside the mask
+ * cleared.
+ */
+#define NAMES_DB_MANUF_KEY(mask, addr)  (((guint64)(mask) << 48) | (addr))
+
+/* Keys of the services table. */
+#define NAMES_DB_TCP    1
+#define NAMES_DB_UDP    2
+#define NAMES_DB_SCTP   3
+#define NAMES_DB_DCCP   4
+#define NAMES_DB_SERVICE_KEY(transport, port)   (((guint64)(transport) << 16) | (port))
+
+/* The enterprises table is keyed by enterprise number. */
+
+/*
+ * Map the database into memory.  Returns FALSE if it doesn't exist or
+ * isn't valid, in which case every table is unusable.
+ */
+gboolean names_db_open(const char *path);
+
+void names_db_close(void);
+
+/*
+ * Start looking up names in a table, if the database has it, it was
+ * compiled from a file the same size as source_path, and source_path
+ * hasn't been modified since the database was written.  Returns FALSE
+ * if source_path has to be parsed instead.
+ */
+gboolean names_db_use_table(names_db_table_e table, const char *source_path);
+
+/*
+ * Look up a key in a table that names_db_use_table() accepted.  The
+ * names stay valid until names_db_close() is called; longname may be
+ * NULL.
+ */
+gboolean names_db_lookup(names_db_table_e table, guint64 key,
+    const char **name, const char **longname);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __ADDR_RESOLV_DB_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
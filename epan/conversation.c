@@ -42,25 +42,52 @@ struct conversation_key {
 	guint32	port2;
 };
 
+/*
+ * The conversation tables are open-addressing hash tables with linear
+ * probing.  A slot holds the hash of its key, so that the keys - whose
+ * addresses can be of any type - are only compared when the hashes are
+ * equal, and all the conversations with that key, in order of setup
+ * frame, so that the one for a given frame is found with a binary search
+ * rather than by walking a chain.  Everything is allocated in file scope,
+ * and the tables are emptied when that is freed.
+ */
+typedef struct {
+	guint			hash;
+	conversation_key_t	key;		/* NULL if the slot is empty */
+	conversation_t		**convs;	/* sorted by setup frame */
+	guint32			num_convs;
+	guint32			max_convs;
+} conversation_slot_t;
+
+typedef struct {
+	GHashFunc		hash_func;
+	GEqualFunc		equal_func;
+	conversation_slot_t	*slots;
+	guint32			num_slots;	/* 0 or a power of 2 */
+	guint32			count;		/* occupied slots */
+} conversation_table_t;
+
+#define CONVERSATION_TABLE_MIN_SLOTS	256
+
 /*
  * Hash table for conversations with no wildcards.
  */
-static wmem_map_t *conversation_hashtable_exact = NULL;
+static conversation_table_t conversation_hashtable_exact;
 
 /*
  * Hash table for conversations with one wildcard address.
  */
-static wmem_map_t *conversation_hashtable_no_addr2 = NULL;
+static conversation_table_t conversation_hashtable_no_addr2;
 
 /*
  * Hash table for conversations with one wildcard port.
  */
-static wmem_map_t *conversation_hashtable_no_port2 = NULL;
+static conversation_table_t conversation_hashtable_no_port2;
 
 /*
  * Hash table for conversations with one wildcard address and port.
  */
-static wmem_map_t *conversation_hashtable_no_addr2_or_port2 = NULL;
+static conversation_table_t conversation_hashtable_no_addr2_or_port2;
 
 
 static guint32 new_index;
@@ -169,7 +196,8 @@ conversation_create_from_template(conversation_t *conversation, const address *a
 
 /*
  * Compute the hash value for two given address/port pairs if the match
- * is to be exact.
+ * is to be exact.  The value is the same for both directions, as the
+ * match is, so one lookup finds the conversation either way round.
  */
 /* http://eternallyconfuzzled.com/tuts/algorithms/jsw_tut_hashing.aspx#existing
  * One-at-a-Time hash
@@ -178,7 +206,7 @@ guint
 conversation_hash_exact(gconstpointer v)
 {
 	const conversation_key_t key = (const conversation_key_t)v;
-	guint hash_val;
+	guint hash_val, hash_val2;
 	address tmp_addr;
 
 	hash_val = 0;
@@ -189,10 +217,12 @@ conversation_hash_exact(gconstpointer v)
 	tmp_addr.data = &key->port1;
 	hash_val = add_address_to_hash(hash_val, &tmp_addr);
 
-	hash_val = add_address_to_hash(hash_val, &key->addr2);
+	hash_val2 = add_address_to_hash(0, &key->addr2);
 
 	tmp_addr.data = &key->port2;
-	hash_val = add_address_to_hash(hash_val, &tmp_addr);
+	hash_val2 = add_address_to_hash(hash_val2, &tmp_addr);
+
+	hash_val += hash_val2;
 
 	hash_val += ( hash_val << 3 );
 	hash_val ^= ( hash_val >> 11 );
@@ -442,33 +472,62 @@ conversation_match_no_addr2_or_port2(gconstpointer v, gconstpointer w)
 	return 0;
 }
 
+static void
+conversation_table_init(conversation_table_t *table, GHashFunc hash_func, GEqualFunc equal_func)
+{
+	table->hash_func = hash_func;
+	table->equal_func = equal_func;
+	table->slots = NULL;
+	table->num_slots = 0;
+	table->count = 0;
+}
+
+/*
+ * Empty the hash tables when the file scope, in which everything in them
+ * was allocated, is freed.
+ */
+static gboolean
+conversation_tables_reset_cb(wmem_allocator_t *allocator _U_, wmem_cb_event_t event _U_,
+    void *user_data _U_)
+{
+	conversation_table_t *tables[] = {
+		&conversation_hashtable_exact,
+		&conversation_hashtable_no_addr2,
+		&conversation_hashtable_no_port2,
+		&conversation_hashtable_no_addr2_or_port2
+	};
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(tables); i++) {
+		tables[i]->slots = NULL;
+		tables[i]->num_slots = 0;
+		tables[i]->count = 0;
+	}
+
+	return TRUE;
+}
+
 /**
  * Create a new hash tables for conversations.
  */
 void
 conversation_init(void)
 {
-	/*
-	 * Free up any space allocated for conversation protocol data
-	 * areas.
-	 *
-	 * We can free the space, as the structures it contains are
-	 * pointed to by conversation data structures that were freed
-	 * above.
-	 */
-	conversation_hashtable_exact =
-	    wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), conversation_hash_exact,
-	      conversation_match_exact);
-	conversation_hashtable_no_addr2 =
-	    wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), conversation_hash_no_addr2,
-	      conversation_match_no_addr2);
-	conversation_hashtable_no_port2 =
-	    wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), conversation_hash_no_port2,
-	      conversation_match_no_port2);
-	conversation_hashtable_no_addr2_or_port2 =
-	    wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(), conversation_hash_no_addr2_or_port2,
-	      conversation_match_no_addr2_or_port2);
-
+	static gboolean reset_cb_registered = FALSE;
+
+	conversation_table_init(&conversation_hashtable_exact,
+	    conversation_hash_exact, conversation_match_exact);
+	conversation_table_init(&conversation_hashtable_no_addr2,
+	    conversation_hash_no_addr2, conversation_match_no_addr2);
+	conversation_table_init(&conversation_hashtable_no_port2,
+	    conversation_hash_no_port2, conversation_match_no_port2);
+	conversation_table_init(&conversation_hashtable_no_addr2_or_port2,
+	    conversation_hash_no_addr2_or_port2, conversation_match_no_addr2_or_port2);
+
+	if (!reset_cb_registered) {
+		wmem_register_callback(wmem_file_scope(), conversation_tables_reset_cb, NULL);
+		reset_cb_registered = TRUE;
+	}
 }
 
 /**
@@ -483,120 +542,154 @@ void conversation_epan_reset(void)
 }
 
 /*
- * Does the right thing when inserting into one of the conversation hash tables,
- * taking into account ordering and hash chains and all that good stuff.
- *
- * Mostly adapted from the old conversation_new().
+ * Find the slot holding the conversations with a key matching the given
+ * one, or, if there are none, the empty slot where they'd go.  Returns
+ * NULL if the table has no slots yet.
  */
-static void
-conversation_insert_into_hashtable(wmem_map_t *hashtable, conversation_t *conv)
+static conversation_slot_t *
+conversation_table_find_slot(conversation_table_t *table, const conversation_key_t key, guint hash)
 {
-	conversation_t *chain_head, *chain_tail, *cur, *prev;
+	conversation_slot_t *slot;
+	guint32 mask, i;
 
-	chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
+	if (table->slots == NULL)
+		return NULL;
 
-	if (NULL==chain_head) {
-		/* New entry */
-		conv->next = NULL;
-		conv->last = conv;
-		wmem_map_insert(hashtable, conv->key_ptr, conv);
-		DPRINT(("created a new conversation chain"));
+	/* The table is never more than half full, so this ends. */
+	mask = table->num_slots - 1;
+	for (i = hash & mask; ; i = (i + 1) & mask) {
+		slot = &table->slots[i];
+		if (slot->key == NULL)
+			return slot;
+		if (slot->hash == hash && table->equal_func(slot->key, key))
+			return slot;
+	}
+}
+
+static void
+conversation_table_grow(conversation_table_t *table)
+{
+	conversation_slot_t *old_slots = table->slots;
+	guint32 old_num_slots = table->num_slots;
+	guint32 mask, i, j;
+
+	table->num_slots = old_num_slots ? old_num_slots * 2 : CONVERSATION_TABLE_MIN_SLOTS;
+	table->slots = wmem_alloc0_array(wmem_file_scope(), conversation_slot_t, table->num_slots);
+
+	mask = table->num_slots - 1;
+	for (i = 0; i < old_num_slots; i++) {
+		if (old_slots[i].key == NULL)
+			continue;
+		for (j = old_slots[i].hash & mask; table->slots[j].key != NULL; j = (j + 1) & mask)
+			;
+		table->slots[j] = old_slots[i];
 	}
-	else {
-		/* There's an existing chain for this key */
-		DPRINT(("there's an existing conversation chain"));
 
-		chain_tail = chain_head->last;
+	wmem_free(wmem_file_scope(), old_slots);
+}
 
-		if (conv->setup_frame >= chain_tail->setup_frame) {
-			/* This convo belongs at the end of the chain */
-			conv->next = NULL;
-			conv->last = NULL;
-			chain_tail->next = conv;
-			chain_head->last = conv;
-		}
-		else {
-			/* Loop through the chain to find the right spot */
-			cur = chain_head;
-			prev = NULL;
-
-			for (; (conv->setup_frame > cur->setup_frame) && cur->next; prev=cur, cur=cur->next)
-				;
-
-			if (NULL==prev) {
-				/* Changing the head of the chain */
-				conv->next = chain_head;
-				conv->last = chain_tail;
-				chain_head->last = NULL;
-				wmem_map_insert(hashtable, conv->key_ptr, conv);
-			}
-			else {
-				/* Inserting into the middle of the chain */
-				conv->next = cur;
-				conv->last = NULL;
-				prev->next = conv;
-			}
+/*
+ * Empty a slot, moving later entries in its probe sequence back into
+ * the gap where they'd otherwise no longer be found.
+ */
+static void
+conversation_table_clear_slot(conversation_table_t *table, conversation_slot_t *slot)
+{
+	guint32 mask = table->num_slots - 1;
+	guint32 i, j, home;
+
+	i = (guint32)(slot - table->slots);
+	for (j = (i + 1) & mask; table->slots[j].key != NULL; j = (j + 1) & mask) {
+		home = table->slots[j].hash & mask;
+		/* Can the entry at j move to i without ending up before its home? */
+		if ((i <= j) ? (home <= i || home > j) : (home <= i && home > j)) {
+			table->slots[i] = table->slots[j];
+			i = j;
 		}
 	}
+	memset(&table->slots[i], 0, sizeof table->slots[i]);
+	table->count--;
 }
 
 /*
- * Does the right thing when removing from one of the conversation hash tables,
- * taking into account ordering and hash chains and all that good stuff.
+ * Inserts a conversation into one of the conversation hash tables, after
+ * any others with the same key and the same or an earlier setup frame.
  */
 static void
-conversation_remove_from_hashtable(wmem_map_t *hashtable, conversation_t *conv)
+conversation_insert_into_hashtable(conversation_table_t *table, conversation_t *conv)
 {
-	conversation_t *chain_head, *cur, *prev;
-
-	chain_head = (conversation_t *)wmem_map_lookup(hashtable, conv->key_ptr);
-
-	if (conv == chain_head) {
-		/* We are currently the front of the chain */
-		if (NULL == conv->next) {
-			/* We are the only conversation in the chain, no need to
-			 * update next pointer, but do not call
-			 * wmem_map_remove() either because the conv data
-			 * will be re-inserted. */
-			wmem_map_steal(hashtable, conv->key_ptr);
-		}
-		else {
-			/* Update the head of the chain */
-			chain_head = conv->next;
-			chain_head->last = conv->last;
+	conversation_slot_t *slot;
+	guint hash;
+	guint32 pos;
 
-			if (conv->latest_found == conv)
-				chain_head->latest_found = NULL;
-			else
-				chain_head->latest_found = conv->latest_found;
+	if ((table->count + 1) * 2 > table->num_slots)
+		conversation_table_grow(table);
 
-			wmem_map_insert(hashtable, chain_head->key_ptr, chain_head);
-		}
+	hash = table->hash_func(conv->key_ptr);
+	slot = conversation_table_find_slot(table, conv->key_ptr, hash);
+
+	if (slot->key == NULL) {
+		/* New entry */
+		slot->hash = hash;
+		slot->key = conv->key_ptr;
+		table->count++;
+		DPRINT(("created a new conversation chain"));
 	}
 	else {
-		/* We are not the front of the chain. Loop through to find us.
-		 * Start loop at chain_head->next rather than chain_head because
-		 * we already know we're not at the head. */
-		cur = chain_head->next;
-		prev = chain_head;
+		DPRINT(("there's an existing conversation chain"));
+	}
 
-		for (; (cur != conv) && cur->next; prev=cur, cur=cur->next)
-			;
+	if (slot->num_convs == slot->max_convs) {
+		slot->max_convs = slot->max_convs ? slot->max_convs * 2 : 1;
+		slot->convs = (conversation_t **)wmem_realloc(wmem_file_scope(), slot->convs,
+		    slot->max_convs * sizeof slot->convs[0]);
+	}
 
-		if (cur != conv) {
-			/* XXX: Conversation not found. Wrong hashtable? */
-			return;
-		}
+	/* Conversations are nearly always set up in frame order, so look
+	 * for the place for this one from the end. */
+	for (pos = slot->num_convs; pos > 0 && slot->convs[pos - 1]->setup_frame > conv->setup_frame; pos--)
+		;
+	memmove(&slot->convs[pos + 1], &slot->convs[pos],
+	    (slot->num_convs - pos) * sizeof slot->convs[0]);
+	slot->convs[pos] = conv;
+	slot->num_convs++;
+}
 
-		prev->next = conv->next;
+/*
+ * Removes a conversation from one of the conversation hash tables.
+ */
+static void
+conversation_remove_from_hashtable(conversation_table_t *table, conversation_t *conv)
+{
+	conversation_slot_t *slot;
+	guint32 pos;
 
-		if (NULL == conv->next) {
-			/* We're at the very end of the list. */
-			chain_head->last = prev;
-		}
+	slot = conversation_table_find_slot(table, conv->key_ptr, table->hash_func(conv->key_ptr));
+	if (slot == NULL || slot->key == NULL) {
+		/* XXX: Conversation not found. Wrong hashtable? */
+		return;
+	}
+
+	for (pos = 0; pos < slot->num_convs && slot->convs[pos] != conv; pos++)
+		;
+	if (pos == slot->num_convs) {
+		/* XXX: Conversation not found. Wrong hashtable? */
+		return;
+	}
+
+	slot->num_convs--;
+	memmove(&slot->convs[pos], &slot->convs[pos + 1],
+	    (slot->num_convs - pos) * sizeof slot->convs[0]);
 
-		if (chain_head->latest_found == conv)
-			chain_head->latest_found = prev;
+	if (slot->num_convs != 0) {
+		/* The slot's key has to belong to a conversation still in it,
+		 * as the caller is about to change this one's. */
+		if (slot->key == conv->key_ptr)
+			slot->key = slot->convs[0]->key_ptr;
+	}
+	else {
+		wmem_free(wmem_file_scope(), slot->convs);
+		conversation_table_clear_slot(table, slot);
 	}
 }
 
@@ -616,7 +709,7 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 	DISSECTOR_ASSERT(!(options | CONVERSATION_TEMPLATE) || ((options | (NO_ADDR2 | NO_PORT2 | NO_PORT2_FORCE))) &&
 				"A conversation template may not be constructed without wildcard options");
 */
-	wmem_map_t* hashtable;
+	conversation_table_t *hashtable;
 	conversation_t *conversation=NULL;
 	conversation_key_t new_key;
 
@@ -711,15 +804,15 @@ conversation_new(const guint32 setup_frame, const address *addr1, const address
 
 	if (options & NO_ADDR2) {
 		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_addr2_or_port2;
+			hashtable = &conversation_hashtable_no_addr2_or_port2;
 		} else {
-			hashtable = conversation_hashtable_no_addr2;
+			hashtable = &conversation_hashtable_no_addr2;
 		}
 	} else {
 		if (options & (NO_PORT2|NO_PORT2_FORCE)) {
-			hashtable = conversation_hashtable_no_port2;
+			hashtable = &conversation_hashtable_no_port2;
 		} else {
-			hashtable = conversation_hashtable_exact;
+			hashtable = &conversation_hashtable_exact;
 		}
 	}
 
@@ -786,16 +879,16 @@ conversation_set_port2(conversation_t *conv, const guint32 port)
 
 	DINDENT();
 	if (conv->options & NO_ADDR2) {
-		conversation_remove_from_hashtable(conversation_hashtable_no_addr2_or_port2, conv);
+		conversation_remove_from_hashtable(&conversation_hashtable_no_addr2_or_port2, conv);
 	} else {
-		conversation_remove_from_hashtable(conversation_hashtable_no_port2, conv);
+		conversation_remove_from_hashtable(&conversation_hashtable_no_port2, conv);
 	}
 	conv->options &= ~NO_PORT2;
 	conv->key_ptr->port2  = port;
 	if (conv->options & NO_ADDR2) {
-		conversation_insert_into_hashtable(conversation_hashtable_no_addr2, conv);
+		conversation_insert_into_hashtable(&conversation_hashtable_no_addr2, conv);
 	} else {
-		conversation_insert_into_hashtable(conversation_hashtable_exact, conv);
+		conversation_insert_into_hashtable(&conversation_hashtable_exact, conv);
 	}
 	DENDENT();
 }
@@ -823,16 +916,16 @@ conversation_set_addr2(conversation_t *conv, const address *addr)
 
 	DINDENT();
 	if (conv->options & NO_PORT2) {
-		conversation_remove_from_hashtable(conversation_hashtable_no_addr2_or_port2, conv);
+		conversation_remove_from_hashtable(&conversation_hashtable_no_addr2_or_port2, conv);
 	} else {
-		conversation_remove_from_hashtable(conversation_hashtable_no_port2, conv);
+		conversation_remove_from_hashtable(&conversation_hashtable_no_port2, conv);
 	}
 	conv->options &= ~NO_ADDR2;
 	copy_address_wmem(wmem_file_scope(), &conv->key_ptr->addr2, addr);
 	if (conv->options & NO_PORT2) {
-		conversation_insert_into_hashtable(conversation_hashtable_no_port2, conv);
+		conversation_insert_into_hashtable(&conversation_hashtable_no_port2, conv);
 	} else {
-		conversation_insert_into_hashtable(conversation_hashtable_exact, conv);
+		conversation_insert_into_hashtable(&conversation_hashtable_exact, conv);
 	}
 	DENDENT();
 }
@@ -842,13 +935,12 @@ conversation_set_addr2(conversation_t *conv, const address *addr)
  * {addr1, port1, addr2, port2} and set up before frame_num.
  */
 static conversation_t *
-conversation_lookup_hashtable(wmem_map_t *hashtable, const guint32 frame_num, const address *addr1, const address *addr2,
+conversation_lookup_hashtable(conversation_table_t *hashtable, const guint32 frame_num, const address *addr1, const address *addr2,
     const endpoint_type etype, const guint32 port1, const guint32 port2)
 {
-	conversation_t* convo=NULL;
-	conversation_t* match=NULL;
-	conversation_t* chain_head=NULL;
+	conversation_slot_t *slot;
 	struct conversation_key key;
+	guint32 lo, hi, mid;
 
 	/*
 	 * We don't make a copy of the address data, we just copy the
@@ -868,28 +960,22 @@ conversation_lookup_hashtable(wmem_map_t *hashtable, const guint32 frame_num, co
 	key.port1 = port1;
 	key.port2 = port2;
 
-	chain_head = (conversation_t *)wmem_map_lookup(hashtable, &key);
-
-	if (chain_head && (chain_head->setup_frame <= frame_num)) {
-		match = chain_head;
-
-		if ((chain_head->last)&&(chain_head->last->setup_frame<=frame_num))
-			return chain_head->last;
-
-		if ((chain_head->latest_found)&&(chain_head->latest_found->setup_frame<=frame_num))
-			match = chain_head->latest_found;
+	slot = conversation_table_find_slot(hashtable, &key, hashtable->hash_func(&key));
+	if (slot == NULL || slot->key == NULL)
+		return NULL;
 
-		for (convo = match; convo && convo->setup_frame <= frame_num; convo = convo->next) {
-			if (convo->setup_frame > match->setup_frame) {
-				match = convo;
-			}
-		}
+	/* Find the last conversation set up at or before frame_num. */
+	lo = 0;
+	hi = slot->num_convs;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (slot->convs[mid]->setup_frame <= frame_num)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
 
-	if (match)
-		chain_head->latest_found = match;
-
-	return match;
+	return (lo != 0) ? slot->convs[lo - 1] : NULL;
 }
 
 
@@ -947,19 +1033,11 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 		 */
 		DPRINT(("trying exact match: %s:%d -> %s:%d",
 		    addr_a_str, port_a, addr_b_str, port_b));
+		/* This also finds conversations in the other direction. */
 		conversation =
-		    conversation_lookup_hashtable(conversation_hashtable_exact,
+		    conversation_lookup_hashtable(&conversation_hashtable_exact,
 			frame_num, addr_a, addr_b, etype,
 			port_a, port_b);
-		/* Didn't work, try the other direction */
-		if (conversation == NULL) {
-			DPRINT(("trying exact match: %s:%d -> %s:%d",
-			    addr_b_str, port_b, addr_a_str, port_a));
-			conversation =
-			    conversation_lookup_hashtable(conversation_hashtable_exact,
-				frame_num, addr_b, addr_a, etype,
-				port_b, port_a);
-		}
 		if ((conversation == NULL) && (addr_a->type == AT_FC)) {
 			/* In Fibre channel, OXID & RXID are never swapped as
 			 * TCP/UDP ports are in TCP/IP.
@@ -967,7 +1045,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 			DPRINT(("trying exact match: %s:%d -> %s:%d",
 			    addr_b_str, port_a, addr_a_str, port_b));
 			conversation =
-			    conversation_lookup_hashtable(conversation_hashtable_exact,
+			    conversation_lookup_hashtable(&conversation_hashtable_exact,
 				frame_num, addr_b, addr_a, etype,
 				port_a, port_b);
 		}
@@ -993,7 +1071,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 		DPRINT(("trying wildcarded match: %s:%d -> *:%d",
 		    addr_a_str, port_a, port_b));
 		conversation =
-		    conversation_lookup_hashtable(conversation_hashtable_no_addr2,
+		    conversation_lookup_hashtable(&conversation_hashtable_no_addr2,
 			frame_num, addr_a, addr_b, etype, port_a, port_b);
 		if ((conversation == NULL) && (addr_a->type == AT_FC)) {
 			/* In Fibre channel, OXID & RXID are never swapped as
@@ -1002,7 +1080,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 			DPRINT(("trying wildcarded match: %s:%d -> *:%d",
 			    addr_b_str, port_a, port_b));
 			conversation =
-			    conversation_lookup_hashtable(conversation_hashtable_no_addr2,
+			    conversation_lookup_hashtable(&conversation_hashtable_no_addr2,
 				frame_num, addr_b, addr_a, etype,
 				port_a, port_b);
 		}
@@ -1048,7 +1126,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 			DPRINT(("trying wildcarded match: %s:%d -> *:%d",
 			    addr_b_str, port_b, port_a));
 			conversation =
-			    conversation_lookup_hashtable(conversation_hashtable_no_addr2,
+			    conversation_lookup_hashtable(&conversation_hashtable_no_addr2,
 				frame_num, addr_b, addr_a, etype, port_b, port_a);
 			if (conversation != NULL) {
 				/*
@@ -1093,7 +1171,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 		DPRINT(("trying wildcarded match: %s:%d -> %s:*",
 		    addr_a_str, port_a, addr_b_str));
 		conversation =
-		    conversation_lookup_hashtable(conversation_hashtable_no_port2,
+		    conversation_lookup_hashtable(&conversation_hashtable_no_port2,
 			frame_num, addr_a, addr_b, etype, port_a, port_b);
 		if ((conversation == NULL) && (addr_a->type == AT_FC)) {
 			/* In Fibre channel, OXID & RXID are never swapped as
@@ -1101,7 +1179,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 			 */
 			DPRINT(("trying wildcarded match: %s:%d -> %s:*", addr_b_str, port_a, addr_a_str));
 			conversation =
-			    conversation_lookup_hashtable(conversation_hashtable_no_port2,
+			    conversation_lookup_hashtable(&conversation_hashtable_no_port2,
 				frame_num, addr_b, addr_a, etype, port_a, port_b);
 		}
 		if (conversation != NULL) {
@@ -1146,7 +1224,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 			DPRINT(("trying wildcarded match: %s:%d -> %s:*",
 			    addr_b_str, port_b, addr_a_str));
 			conversation =
-			    conversation_lookup_hashtable(conversation_hashtable_no_port2,
+			    conversation_lookup_hashtable(&conversation_hashtable_no_port2,
 				frame_num, addr_b, addr_a, etype, port_b, port_a);
 			if (conversation != NULL) {
 				/*
@@ -1185,7 +1263,7 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 	 */
 	DPRINT(("trying wildcarded match: %s:%d -> *:*", addr_a_str, port_a));
 	conversation =
-	    conversation_lookup_hashtable(conversation_hashtable_no_addr2_or_port2,
+	    conversation_lookup_hashtable(&conversation_hashtable_no_addr2_or_port2,
 		frame_num, addr_a, addr_b, etype, port_a, port_b);
 	if (conversation != NULL) {
 		/*
@@ -1240,13 +1318,13 @@ find_conversation(const guint32 frame_num, const address *addr_a, const address
 			DPRINT(("trying wildcarded match: %s:%d -> *:*",
 			    addr_b_str, port_a));
 			conversation =
-			    conversation_lookup_hashtable(conversation_hashtable_no_addr2_or_port2,
+			    conversation_lookup_hashtable(&conversation_hashtable_no_addr2_or_port2,
 				frame_num, addr_b, addr_a, etype, port_a, port_b);
 		} else {
 			DPRINT(("trying wildcarded match: %s:%d -> *:*",
 			    addr_b_str, port_b));
 			conversation =
-			    conversation_lookup_hashtable(conversation_hashtable_no_addr2_or_port2,
+			    conversation_lookup_hashtable(&conversation_hashtable_no_addr2_or_port2,
 				frame_num, addr_b, addr_a, etype, port_b, port_a);
 		}
 		if (conversation != NULL) {
@@ -1564,28 +1642,42 @@ guint32 conversation_get_endpoint_by_id(struct _packet_info *pinfo, endpoint_typ
 	return pinfo->conv_endpoint->port1;
 }
 
-wmem_map_t *
-get_conversation_hashtable_exact(void)
+static wmem_list_t *
+conversation_table_get_keys(wmem_allocator_t *allocator, const conversation_table_t *table)
+{
+	wmem_list_t *keys = wmem_list_new(allocator);
+	guint32 i;
+
+	for (i = 0; i < table->num_slots; i++) {
+		if (table->slots[i].key != NULL)
+			wmem_list_prepend(keys, table->slots[i].key);
+	}
+
+	return keys;
+}
+
+wmem_list_t *
+get_conversation_keys_exact(wmem_allocator_t *allocator)
 {
-	return conversation_hashtable_exact;
+	return conversation_table_get_keys(allocator, &conversation_hashtable_exact);
 }
 
-wmem_map_t *
-get_conversation_hashtable_no_addr2(void)
+wmem_list_t *
+get_conversation_keys_no_addr2(wmem_allocator_t *allocator)
 {
-	return conversation_hashtable_no_addr2;
+	return conversation_table_get_keys(allocator, &conversation_hashtable_no_addr2);
 }
 
-wmem_map_t *
-get_conversation_hashtable_no_port2(void)
+wmem_list_t *
+get_conversation_keys_no_port2(wmem_allocator_t *allocator)
 {
-	return conversation_hashtable_no_port2;
+	return conversation_table_get_keys(allocator, &conversation_hashtable_no_port2);
 }
 
-wmem_map_t *
-get_conversation_hashtable_no_addr2_or_port2(void)
+wmem_list_t *
+get_conversation_keys_no_addr2_or_port2(wmem_allocator_t *allocator)
 {
-	return conversation_hashtable_no_addr2_or_port2;
+	return conversation_table_get_keys(allocator, &conversation_hashtable_no_addr2_or_port2);
 }
 
 address*
@@ -87,9 +87,6 @@ struct conversation_key;
 typedef struct conversation_key* conversation_key_t;
 
 typedef struct conversation {
-	struct conversation *next;	/** pointer to next conversation on hash chain */
-	struct conversation *last;	/** pointer to the last conversation on hash chain */
-	struct conversation *latest_found; /** pointer to the last conversation on hash chain */
 	guint32	conv_index;		/** unique ID for conversation */
 	guint32 setup_frame;		/** frame number that setup this conversation */
 					/* Assume that setup_frame is also the lowest frame number for now. */
@@ -241,17 +238,19 @@ void conversation_set_port2(conversation_t *conv, const guint32 port);
 WS_DLL_PUBLIC
 void conversation_set_addr2(conversation_t *conv, const address *addr);
 
+/* The keys in each of the conversation hash tables, in a list allocated
+   with the given allocator */
 WS_DLL_PUBLIC
-wmem_map_t *get_conversation_hashtable_exact(void);
+wmem_list_t *get_conversation_keys_exact(wmem_allocator_t *allocator);
 
 WS_DLL_PUBLIC
-wmem_map_t *get_conversation_hashtable_no_addr2(void);
+wmem_list_t *get_conversation_keys_no_addr2(wmem_allocator_t *allocator);
 
 WS_DLL_PUBLIC
-wmem_map_t * get_conversation_hashtable_no_port2(void);
+wmem_list_t *get_conversation_keys_no_port2(wmem_allocator_t *allocator);
 
 WS_DLL_PUBLIC
-wmem_map_t *get_conversation_hashtable_no_addr2_or_port2(void);
+wmem_list_t *get_conversation_keys_no_addr2_or_port2(wmem_allocator_t *allocator);
 
 /* Temporary function to handle port_type to endpoint_type conversion
    For now it's a 1-1 mapping, but the intention is to remove
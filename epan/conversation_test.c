@@ -0,0 +1,272 @@
+/* conversation_test.c
+ * Standalone program to test the conversation lookup tables, and to
+ * measure how long lookups take.
+ *
+ * The benchmark only runs in performance mode:
+ *     conversation_test -m perf --verbose
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <epan/address.h>
+#include <epan/conversation.h>
+#include <epan/epan.h>
+
+#define PERF_FLOWS (1000 * 1000)
+
+static epan_t *test_session;
+
+/*
+ * The conversation tables live in file scope, so each test works on a
+ * file of its own, which is what an epan session is.
+ */
+static void
+test_file_open(void)
+{
+    static const struct packet_provider_funcs funcs = {
+        NULL, NULL, NULL, NULL, NULL
+    };
+
+    test_session = epan_new(NULL, &funcs);
+}
+
+static void
+test_file_close(void)
+{
+    epan_free(test_session);
+    test_session = NULL;
+}
+
+static void
+set_ipv4(address *addr, guint32 *storage, guint32 ip)
+{
+    *storage = g_htonl(ip);
+    set_address(addr, AT_IPv4, 4, storage);
+}
+
+static void
+conversation_test_exact(void)
+{
+    address         a, b;
+    guint32         a_ip, b_ip;
+    conversation_t *conv, *later;
+
+    test_file_open();
+
+    set_ipv4(&a, &a_ip, 0xc0000201);
+    set_ipv4(&b, &b_ip, 0xc0000202);
+
+    g_assert(find_conversation(1, &a, &b, ENDPOINT_TCP, 1024, 80, 0) == NULL);
+
+    conv = conversation_new(1, &a, &b, ENDPOINT_TCP, 1024, 80, 0);
+    g_assert(find_conversation(1, &a, &b, ENDPOINT_TCP, 1024, 80, 0) == conv);
+    g_assert(find_conversation(5, &b, &a, ENDPOINT_TCP, 80, 1024, 0) == conv);
+    g_assert(find_conversation(5, &a, &b, ENDPOINT_UDP, 1024, 80, 0) == NULL);
+    g_assert(find_conversation(5, &a, &b, ENDPOINT_TCP, 1025, 80, 0) == NULL);
+
+    /* Not set up yet. */
+    g_assert(find_conversation(0, &a, &b, ENDPOINT_TCP, 1024, 80, 0) == NULL);
+
+    /* A new connection with the same addresses and ports. */
+    later = conversation_new(10, &b, &a, ENDPOINT_TCP, 80, 1024, 0);
+    g_assert(find_conversation(9, &a, &b, ENDPOINT_TCP, 1024, 80, 0) == conv);
+    g_assert(find_conversation(10, &a, &b, ENDPOINT_TCP, 1024, 80, 0) == later);
+    g_assert(find_conversation(20, &b, &a, ENDPOINT_TCP, 80, 1024, 0) == later);
+
+    test_file_close();
+
+    /* The tables are emptied along with the file scope. */
+    test_file_open();
+    g_assert(find_conversation(20, &a, &b, ENDPOINT_TCP, 1024, 80, 0) == NULL);
+    test_file_close();
+}
+
+static void
+conversation_test_setup_frames(void)
+{
+    address         a, b;
+    guint32         a_ip, b_ip;
+    conversation_t *convs[4];
+
+    test_file_open();
+
+    set_ipv4(&a, &a_ip, 0x0a000001);
+    set_ipv4(&b, &b_ip, 0x0a000002);
+
+    /* Conversations aren't necessarily created in frame order. */
+    convs[2] = conversation_new(30, &a, &b, ENDPOINT_UDP, 5060, 5060, 0);
+    convs[0] = conversation_new(10, &a, &b, ENDPOINT_UDP, 5060, 5060, 0);
+    convs[3] = conversation_new(40, &a, &b, ENDPOINT_UDP, 5060, 5060, 0);
+    convs[1] = conversation_new(20, &a, &b, ENDPOINT_UDP, 5060, 5060, 0);
+
+    g_assert(find_conversation(9, &a, &b, ENDPOINT_UDP, 5060, 5060, 0) == NULL);
+    g_assert(find_conversation(10, &a, &b, ENDPOINT_UDP, 5060, 5060, 0) == convs[0]);
+    g_assert(find_conversation(19, &a, &b, ENDPOINT_UDP, 5060, 5060, 0) == convs[0]);
+    g_assert(find_conversation(25, &a, &b, ENDPOINT_UDP, 5060, 5060, 0) == convs[1]);
+    g_assert(find_conversation(30, &a, &b, ENDPOINT_UDP, 5060, 5060, 0) == convs[2]);
+    g_assert(find_conversation(1000, &a, &b, ENDPOINT_UDP, 5060, 5060, 0) == convs[3]);
+
+    test_file_close();
+}
+
+static void
+conversation_test_wildcards(void)
+{
+    address         a, b, c;
+    guint32         a_ip, b_ip, c_ip;
+    conversation_t *conv;
+
+    test_file_open();
+
+    set_ipv4(&a, &a_ip, 0xc0a80001);
+    set_ipv4(&b, &b_ip, 0xc0a80002);
+    set_ipv4(&c, &c_ip, 0xc0a80003);
+
+    /* An expected TCP connection to a port we don't know yet. */
+    conv = conversation_new(1, &a, &b, ENDPOINT_TCP, 20, 0, NO_PORT2);
+    g_assert(find_conversation(2, &a, &b, ENDPOINT_TCP, 20, 3000, 0) == conv);
+    /* Finding it filled in the port, which moved it to the exact table. */
+    g_assert(!(conv->options & NO_PORT2));
+    g_assert(find_conversation(3, &b, &a, ENDPOINT_TCP, 3000, 20, 0) == conv);
+    g_assert(find_conversation(3, &a, &b, ENDPOINT_TCP, 20, 3001, 0) == NULL);
+
+    /* A listener for anyone. */
+    conv = conversation_new(1, &c, NULL, ENDPOINT_UDP, 69, 0, NO_ADDR2|NO_PORT2);
+    g_assert(find_conversation(2, &c, &a, ENDPOINT_UDP, 69, 4000, 0) == conv);
+    g_assert(find_conversation(2, &c, &b, ENDPOINT_UDP, 69, 4001, 0) == conv);
+    g_assert(find_conversation(2, &c, &b, ENDPOINT_UDP, 70, 4001, 0) == NULL);
+
+    /* Conversations by ID. */
+    conv = conversation_new_by_id(5, ENDPOINT_IBQP, 0x1234, 0);
+    g_assert(find_conversation_by_id(5, ENDPOINT_IBQP, 0x1234, 0) == conv);
+    g_assert(find_conversation_by_id(5, ENDPOINT_IBQP, 0x1235, 0) == NULL);
+
+    test_file_close();
+}
+
+/*
+ * Create enough conversations to make the tables grow, then move all of
+ * them between tables, which empties slots all over the old one.
+ */
+static void
+conversation_test_many(void)
+{
+    address          a, b;
+    guint32          a_ip, b_ip;
+    conversation_t **convs;
+    guint32          i;
+
+    test_file_open();
+
+    set_ipv4(&a, &a_ip, 0xac100001);
+    set_ipv4(&b, &b_ip, 0xac100002);
+
+    convs = g_new(conversation_t *, 10000);
+    for (i = 0; i < 10000; i++)
+        convs[i] = conversation_new(i + 1, &a, &b, ENDPOINT_TCP, i, 0, NO_PORT2);
+    for (i = 0; i < 10000; i++)
+        g_assert(find_conversation(10000, &a, &b, ENDPOINT_TCP, i, 1, NO_PORT_B) == convs[i]);
+
+    for (i = 0; i < 10000; i += 2)
+        conversation_set_port2(convs[i], 80);
+    for (i = 0; i < 10000; i++) {
+        if (i % 2 == 0)
+            g_assert(find_conversation(10000, &b, &a, ENDPOINT_TCP, 80, i, 0) == convs[i]);
+        else
+            g_assert(find_conversation(10000, &a, &b, ENDPOINT_TCP, i, 1, NO_PORT_B) == convs[i]);
+    }
+    g_free(convs);
+
+    test_file_close();
+}
+
+/* NOTE: You have to run "conversation_test -m perf --verbose" to see results. */
+static void
+conversation_test_lookup_perf(void)
+{
+    address         a, b;
+    guint32         a_ip, b_ip;
+    guint32         i;
+    double          elapsed;
+
+    test_file_open();
+
+    /* Lots of short UDP flows, as in DNS traffic. */
+    g_test_timer_start();
+    for (i = 0; i < PERF_FLOWS; i++) {
+        set_ipv4(&a, &a_ip, 0x0a000000 | (i >> 8));
+        set_ipv4(&b, &b_ip, 0xc0000200 | (i & 0xff));
+        conversation_new(i + 1, &a, &b, ENDPOINT_UDP, 1024 + (i & 0x7fff), 53, 0);
+    }
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "conversation_new %u flows: %.3f s", PERF_FLOWS, elapsed);
+
+    g_test_timer_start();
+    for (i = 0; i < PERF_FLOWS; i++) {
+        set_ipv4(&a, &a_ip, 0x0a000000 | (i >> 8));
+        set_ipv4(&b, &b_ip, 0xc0000200 | (i & 0xff));
+        /* The response, so in the other direction. */
+        g_assert(find_conversation(PERF_FLOWS, &b, &a, ENDPOINT_UDP, 53, 1024 + (i & 0x7fff), 0) != NULL);
+    }
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "find_conversation %u hits: %.3f s", PERF_FLOWS, elapsed);
+
+    g_test_timer_start();
+    for (i = 0; i < PERF_FLOWS; i++) {
+        set_ipv4(&a, &a_ip, 0x0b000000 | (i >> 8));
+        set_ipv4(&b, &b_ip, 0xc0000200 | (i & 0xff));
+        /* Misses go through all four tables. */
+        g_assert(find_conversation(PERF_FLOWS, &a, &b, ENDPOINT_UDP, 1024, 53, 0) == NULL);
+    }
+    elapsed = g_test_timer_elapsed();
+    g_test_minimized_result(elapsed, "find_conversation %u misses: %.3f s", PERF_FLOWS, elapsed);
+
+    test_file_close();
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    if (!epan_init(NULL, NULL, FALSE))
+        return 1;
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/conversation/exact",        conversation_test_exact);
+    g_test_add_func("/conversation/setup_frames", conversation_test_setup_frames);
+    g_test_add_func("/conversation/wildcards",    conversation_test_wildcards);
+    g_test_add_func("/conversation/many",         conversation_test_many);
+
+    if (g_test_perf()) {
+        g_test_add_func("/conversation/lookup_perf", conversation_test_lookup_perf);
+    }
+
+    ret = g_test_run();
+
+    epan_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
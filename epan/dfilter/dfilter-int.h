@@ -42,6 +42,7 @@ typedef struct {
 	int		next_const_id;
 	int		next_register;
 	int		first_constant; /* first register used as a constant */
+	gboolean	specialize;	/* generate specialized instructions */
 } dfwork_t;
 
 /*
@@ -28,6 +28,9 @@
 /* Holds the singular instance of our Lemon parser object */
 static void*	ParserObj = NULL;
 
+/* Whether gencode may emit specialized instructions */
+static gboolean	dfilter_specialize = TRUE;
+
 /*
  * XXX - if we're using a version of Flex that supports reentrant lexical
  * analyzers, we should put this into the lexical analyzer's state.
@@ -153,6 +156,11 @@ dfilter_free(dfilter_t *df)
 	g_free(df);
 }
 
+void
+dfilter_set_specialize(gboolean enable)
+{
+	dfilter_specialize = enable;
+}
 
 static dfwork_t*
 dfwork_new(void)
@@ -161,6 +169,7 @@ dfwork_new(void)
 
 	dfw = g_new0(dfwork_t, 1);
 	dfw->first_constant = -1;
+	dfw->specialize = dfilter_specialize;
 
 	return dfw;
 }
@@ -410,6 +419,20 @@ dfilter_apply_edt(dfilter_t *df, epan_dissect_t* edt)
 	return dfvm_apply(df, edt->tree);
 }
 
+gboolean
+dfilter_can_apply_source(const dfilter_t *df,
+		gboolean (*can_supply)(void *data, int hfid, gboolean values),
+		void *data)
+{
+	return dfvm_can_apply_source(df, can_supply, data);
+}
+
+gboolean
+dfilter_apply_source(dfilter_t *df, const dfilter_field_source_t *source)
+{
+	return dfvm_apply_source(df, source);
+}
+
 
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
@@ -427,6 +450,58 @@ dfilter_has_interesting_fields(const dfilter_t *df)
 	return (df->num_interesting_fields > 0);
 }
 
+gboolean
+dfilter_interested_in_field(const dfilter_t *df, int hfid)
+{
+	int i;
+
+	for (i = 0; i < df->num_interesting_fields; i++) {
+		if (df->interesting_fields[i] == hfid)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+int *
+dfilter_interesting_protocols(const dfilter_t *df, int *num_protos)
+{
+	GHashTable	*protos;
+	GHashTableIter	iter;
+	gpointer	key;
+	int		*proto_ids;
+	int		i, hfid, proto_id;
+
+	protos = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (i = 0; i < df->num_interesting_fields; i++) {
+		hfid = df->interesting_fields[i];
+		if (proto_registrar_is_protocol(hfid))
+			proto_id = hfid;
+		else
+			proto_id = proto_registrar_get_parent(hfid);
+
+		/* frame.protocols lists every layer, and the _ws.* pseudo
+		 * protocols (expert info, malformed packets) are added to
+		 * by any dissector. */
+		if (hfid == proto_registrar_get_id_byname("frame.protocols") ||
+		    g_str_has_prefix(proto_get_protocol_filter_name(proto_id), "_ws.")) {
+			g_hash_table_destroy(protos);
+			*num_protos = -1;
+			return NULL;
+		}
+		g_hash_table_add(protos, GINT_TO_POINTER(proto_id));
+	}
+
+	*num_protos = g_hash_table_size(protos);
+	proto_ids = g_new(int, *num_protos);
+	i = 0;
+	g_hash_table_iter_init(&iter, protos);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		proto_ids[i++] = GPOINTER_TO_INT(key);
+	}
+	g_hash_table_destroy(protos);
+	return proto_ids;
+}
+
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df) {
 	if (df->deprecated && df->deprecated->len > 0) {
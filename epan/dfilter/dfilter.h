@@ -49,6 +49,13 @@ WS_DLL_PUBLIC
 gboolean
 dfilter_compile(const gchar *text, dfilter_t **dfp, gchar **err_msg);
 
+/* Enables or disables the generation of specialized byte-code for
+ * relations with constants (enabled by default). Only affects filters
+ * compiled afterwards; used for benchmarking the generic interpreter. */
+WS_DLL_PUBLIC
+void
+dfilter_set_specialize(gboolean enable);
+
 /* Frees all memory used by dfilter, and frees
  * the dfilter itself. */
 WS_DLL_PUBLIC
@@ -64,6 +71,33 @@ dfilter_apply_edt(dfilter_t *df, struct epan_dissect *edt);
 gboolean
 dfilter_apply(dfilter_t *df, proto_tree *tree);
 
+/* Supplies field values to dfilter_apply_source() in place of a
+ * proto_tree. */
+typedef struct {
+	/* Returns TRUE if the field or protocol with id hfid is present. */
+	gboolean (*exists)(void *data, int hfid);
+	/* Returns a list of the values of the field with id hfid, or NULL if
+	 * it isn't present.  The list is freed by the dfilter; the fvalue_t's
+	 * belong to the source and must stay valid until the filter has been
+	 * applied. */
+	GList *(*read)(void *data, int hfid);
+	void *data;
+} dfilter_field_source_t;
+
+/* Check whether a field source can supply every field that dfilter tests.
+ * can_supply() is called for each of them, with values TRUE if the filter
+ * needs the field's values and not just whether it's present. */
+WS_DLL_PUBLIC
+gboolean
+dfilter_can_apply_source(const dfilter_t *df,
+		gboolean (*can_supply)(void *data, int hfid, gboolean values),
+		void *data);
+
+/* Apply compiled dfilter to the fields supplied by a field source */
+WS_DLL_PUBLIC
+gboolean
+dfilter_apply_source(dfilter_t *df, const dfilter_field_source_t *source);
+
 /* Prime a proto_tree using the fields/protocols used in a dfilter. */
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
@@ -72,6 +106,19 @@ dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree);
 gboolean
 dfilter_has_interesting_fields(const dfilter_t *df);
 
+/* Check if dfilter tests the field with the given id */
+WS_DLL_PUBLIC
+gboolean
+dfilter_interested_in_field(const dfilter_t *df, int hfid);
+
+/* Get the ids of the protocols whose fields the dfilter tests. Returns a
+ * g_malloc()ed array and sets num_protos to its length, or returns NULL and
+ * sets num_protos to -1 if the result may depend on any protocol in the
+ * packet (e.g. the filter tests frame.protocols or expert info). */
+WS_DLL_PUBLIC
+int *
+dfilter_interesting_protocols(const dfilter_t *df, int *num_protos);
+
 WS_DLL_PUBLIC
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df);
@@ -12,6 +12,8 @@
 
 #include <ftypes/ftypes-int.h>
 
+#include <string.h>
+
 dfvm_insn_t*
 dfvm_insn_new(dfvm_opcode_t op)
 {
@@ -26,6 +28,13 @@ dfvm_insn_new(dfvm_opcode_t op)
 	return insn;
 }
 
+static void
+free_set_member(gpointer data)
+{
+	fvalue_t *fv = (fvalue_t *)data;
+	FVALUE_FREE(fv);
+}
+
 static void
 dfvm_value_free(dfvm_value_t *v)
 {
@@ -36,6 +45,15 @@ dfvm_value_free(dfvm_value_t *v)
 		case DRANGE:
 			drange_free(v->value.drange);
 			break;
+		case INT_KEY_SET:
+			g_ptr_array_free(v->value.int_set->fvalues, TRUE);
+			g_free(v->value.int_set->keys);
+			g_free(v->value.int_set);
+			break;
+		case BYTE_PATTERN:
+			g_free(v->value.pattern->bytes);
+			g_free(v->value.pattern);
+			break;
 		default:
 			/* nothing */
 			;
@@ -72,6 +90,171 @@ dfvm_value_new(dfvm_value_type_t type)
 	return v;
 }
 
+#define SIGNED_KEY(v)	((guint64)(gint64)(v) ^ G_GUINT64_CONSTANT(0x8000000000000000))
+
+/* Gets the integer key of a value, if it has one. The comparison functions
+ * of all of these types compare exactly what ends up in the key. */
+gboolean
+dfvm_int_key(const fvalue_t *fv, dfvm_int_key_t *ik)
+{
+	switch (fv->ftype->ftype) {
+		case FT_CHAR:
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_IPXNET:
+		case FT_FRAMENUM:
+			ik->key_class = DFVM_KEY_UNSIGNED;
+			ik->key = fv->value.uinteger;
+			return TRUE;
+
+		case FT_UINT40:
+		case FT_UINT48:
+		case FT_UINT56:
+		case FT_UINT64:
+		case FT_EUI64:
+			ik->key_class = DFVM_KEY_UNSIGNED;
+			ik->key = fv->value.uinteger64;
+			return TRUE;
+
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			ik->key_class = DFVM_KEY_SIGNED;
+			ik->key = SIGNED_KEY(fv->value.sinteger);
+			return TRUE;
+
+		case FT_INT40:
+		case FT_INT48:
+		case FT_INT56:
+		case FT_INT64:
+			ik->key_class = DFVM_KEY_SIGNED;
+			ik->key = SIGNED_KEY(fv->value.sinteger64);
+			return TRUE;
+
+		case FT_IPv4:
+			/* Subnets compare under the smaller of both masks. */
+			if (fv->value.ipv4.nmask != 0xffffffff)
+				return FALSE;
+			ik->key_class = DFVM_KEY_IPV4;
+			ik->key = fv->value.ipv4.addr;
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
+
+static gint
+cmp_keys(gconstpointer a, gconstpointer b)
+{
+	guint64 key_a = *(const guint64 *)a;
+	guint64 key_b = *(const guint64 *)b;
+
+	return key_a < key_b ? -1 : (key_a > key_b ? 1 : 0);
+}
+
+/* Builds a lookup set from the members of an "in" set. On success the set
+ * takes ownership of the fvalues array; NULL is returned if not every member
+ * has a key of the same class. */
+dfvm_int_set_t*
+dfvm_int_set_new(GPtrArray *fvalues)
+{
+	dfvm_int_set_t	*set;
+	dfvm_int_key_t	ik;
+	dfvm_key_class_t key_class = DFVM_KEY_NONE;
+	guint64		*keys;
+	guint		i, count;
+
+	if (fvalues->len == 0)
+		return NULL;
+
+	keys = g_new(guint64, fvalues->len);
+	for (i = 0; i < fvalues->len; i++) {
+		if (!dfvm_int_key((fvalue_t *)g_ptr_array_index(fvalues, i), &ik) ||
+		    (key_class != DFVM_KEY_NONE && ik.key_class != key_class)) {
+			g_free(keys);
+			return NULL;
+		}
+		key_class = ik.key_class;
+		keys[i] = ik.key;
+	}
+
+	qsort(keys, fvalues->len, sizeof(guint64), cmp_keys);
+	for (i = 1, count = 1; i < fvalues->len; i++) {
+		if (keys[i] != keys[count - 1])
+			keys[count++] = keys[i];
+	}
+
+	g_ptr_array_set_free_func(fvalues, free_set_member);
+
+	set = g_new(dfvm_int_set_t, 1);
+	set->key_class = key_class;
+	set->count = count;
+	set->keys = keys;
+	set->fvalues = fvalues;
+	return set;
+}
+
+/* Gets the bytes that cmp_contains() looks at, for the types where that is
+ * a plain memory search. */
+static gboolean
+contains_bytes(const fvalue_t *fv, const guint8 **data, guint *len, gboolean *is_string)
+{
+	switch (fv->ftype->ftype) {
+		case FT_BYTES:
+		case FT_UINT_BYTES:
+		case FT_AX25:
+		case FT_VINES:
+		case FT_ETHER:
+		case FT_OID:
+		case FT_REL_OID:
+		case FT_SYSTEM_ID:
+		case FT_FCWWN:
+			*data = fv->value.bytes->data;
+			*len = fv->value.bytes->len;
+			*is_string = FALSE;
+			return TRUE;
+
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+			*data = (const guint8 *)fv->value.string;
+			*len = (guint)strlen(fv->value.string);
+			*is_string = TRUE;
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
+
+/* Precompiles the constant operand of "contains". */
+dfvm_byte_pattern_t*
+dfvm_byte_pattern_new(const fvalue_t *fv)
+{
+	dfvm_byte_pattern_t	*pattern;
+	const guint8	*data;
+	guint		len, i;
+	gboolean	is_string;
+
+	if (!contains_bytes(fv, &data, &len, &is_string))
+		return NULL;
+
+	pattern = g_new(dfvm_byte_pattern_t, 1);
+	pattern->is_string = is_string;
+	pattern->len = len;
+	pattern->bytes = (guint8 *)g_memdup(data, len);
+	for (i = 0; i < 256; i++)
+		pattern->skip[i] = len;
+	for (i = 0; i + 1 < len; i++)
+		pattern->skip[data[i]] = len - 1 - i;
+	return pattern;
+}
+
 
 void
 dfvm_dump(FILE *f, dfilter_t *df)
@@ -119,6 +302,14 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
+			case ANY_EQ_INT:
+			case ANY_NE_INT:
+			case ANY_GT_INT:
+			case ANY_GE_INT:
+			case ANY_LT_INT:
+			case ANY_LE_INT:
+			case ANY_CONTAINS_BYTES:
+			case ANY_IN_INT_SET:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -259,6 +450,48 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					arg3->value.numeric);
 				break;
 
+			case ANY_EQ_INT:
+				fprintf(f, "%05d ANY_EQ_INT\treg#%u == reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_NE_INT:
+				fprintf(f, "%05d ANY_NE_INT\treg#%u != reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_GT_INT:
+				fprintf(f, "%05d ANY_GT_INT\treg#%u > reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_GE_INT:
+				fprintf(f, "%05d ANY_GE_INT\treg#%u >= reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_LT_INT:
+				fprintf(f, "%05d ANY_LT_INT\treg#%u < reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_LE_INT:
+				fprintf(f, "%05d ANY_LE_INT\treg#%u <= reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_CONTAINS_BYTES:
+				fprintf(f, "%05d ANY_CONTAINS_BYTES\treg#%u contains reg#%u (%u bytes)\n",
+					id, arg1->value.numeric, arg2->value.numeric,
+					arg3->value.pattern->len);
+				break;
+
+			case ANY_IN_INT_SET:
+				fprintf(f, "%05d ANY_IN_INT_SET\treg#%u in set of %u\n",
+					id, arg1->value.numeric,
+					arg2->value.int_set->count);
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -284,10 +517,12 @@ dfvm_dump(FILE *f, dfilter_t *df)
 	}
 }
 
-/* Reads a field from the proto_tree and loads the fvalues into a register,
- * if that field has not already been read. */
+/* Reads a field from the proto_tree, or from the field source if there is
+ * one, and loads the fvalues into a register, if that field has not already
+ * been read. */
 static gboolean
-read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
+read_tree(dfilter_t *df, proto_tree *tree, const dfilter_field_source_t *source,
+		header_field_info *hfinfo, int reg)
 {
 	GPtrArray	*finfos;
 	field_info	*finfo;
@@ -307,6 +542,21 @@ read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 
 	df->attempted_load[reg] = TRUE;
 
+	if (source) {
+		while (hfinfo) {
+			fvalues = g_list_concat(fvalues,
+					source->read(source->data, hfinfo->id));
+			hfinfo = hfinfo->same_name_next;
+		}
+		if (!fvalues) {
+			return FALSE;
+		}
+		df->registers[reg] = fvalues;
+		// The source owns the values.
+		df->owns_memory[reg] = FALSE;
+		return TRUE;
+	}
+
 	while (hfinfo) {
 		finfos = proto_get_finfo_ptr_array(tree, hfinfo->id);
 		if ((finfos == NULL) || (g_ptr_array_len(finfos) == 0)) {
@@ -369,6 +619,132 @@ any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
 	return FALSE;
 }
 
+static gboolean
+int_key_test(dfvm_opcode_t op, guint64 a, guint64 b)
+{
+	switch (op) {
+		case ANY_EQ_INT:	return a == b;
+		case ANY_NE_INT:	return a != b;
+		case ANY_GT_INT:	return a > b;
+		case ANY_GE_INT:	return a >= b;
+		case ANY_LT_INT:	return a < b;
+		case ANY_LE_INT:	return a <= b;
+		default:
+			g_assert_not_reached();
+			return FALSE;
+	}
+}
+
+/* any_test() against a constant with an integer key. Values of a different
+ * key class (same-name fields of another type) take the generic path. */
+static gboolean
+any_int_test(dfilter_t *df, dfvm_opcode_t op, FvalueCmpFunc cmp, int reg1,
+		int reg2, const dfvm_int_key_t *ik)
+{
+	GList		*list_a;
+	fvalue_t	*fv_b;
+	dfvm_int_key_t	ik_a;
+
+	fv_b = (fvalue_t *)df->registers[reg2]->data;
+
+	for (list_a = df->registers[reg1]; list_a; list_a = g_list_next(list_a)) {
+		if (dfvm_int_key((fvalue_t *)list_a->data, &ik_a) &&
+		    ik_a.key_class == ik->key_class) {
+			if (int_key_test(op, ik_a.key, ik->key)) {
+				return TRUE;
+			}
+		}
+		else if (cmp((fvalue_t *)list_a->data, fv_b)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+pattern_search(const dfvm_byte_pattern_t *pattern, const guint8 *data, guint len)
+{
+	const guint8	*last_possible;
+	guint		last;
+
+	/* Like the generic functions, an empty pattern never matches. */
+	if (pattern->len == 0 || pattern->len > len) {
+		return FALSE;
+	}
+
+	last = pattern->len - 1;
+	last_possible = data + len - pattern->len;
+	while (data <= last_possible) {
+		if (data[last] == pattern->bytes[last] &&
+		    memcmp(data, pattern->bytes, last) == 0) {
+			return TRUE;
+		}
+		data += pattern->skip[data[last]];
+	}
+	return FALSE;
+}
+
+static gboolean
+any_contains_bytes(dfilter_t *df, int reg1, int reg2,
+		const dfvm_byte_pattern_t *pattern)
+{
+	GList		*list_a;
+	fvalue_t	*fv_b;
+	const guint8	*data;
+	guint		len;
+	gboolean	is_string;
+
+	fv_b = (fvalue_t *)df->registers[reg2]->data;
+
+	for (list_a = df->registers[reg1]; list_a; list_a = g_list_next(list_a)) {
+		if (contains_bytes((fvalue_t *)list_a->data, &data, &len, &is_string) &&
+		    is_string == pattern->is_string) {
+			if (pattern_search(pattern, data, len)) {
+				return TRUE;
+			}
+		}
+		else if (fvalue_contains((fvalue_t *)list_a->data, fv_b)) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static gboolean
+any_in_int_set(dfilter_t *df, int reg1, const dfvm_int_set_t *set)
+{
+	GList		*list_a;
+	dfvm_int_key_t	ik_a;
+	guint		lo, hi, mid, i;
+
+	for (list_a = df->registers[reg1]; list_a; list_a = g_list_next(list_a)) {
+		if (dfvm_int_key((fvalue_t *)list_a->data, &ik_a) &&
+		    ik_a.key_class == set->key_class) {
+			lo = 0;
+			hi = set->count;
+			while (lo < hi) {
+				mid = lo + (hi - lo) / 2;
+				if (set->keys[mid] < ik_a.key)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			if (lo < set->count && set->keys[lo] == ik_a.key) {
+				return TRUE;
+			}
+		}
+		else {
+			for (i = 0; i < set->fvalues->len; i++) {
+				if (fvalue_eq((fvalue_t *)list_a->data,
+				    (fvalue_t *)g_ptr_array_index(set->fvalues, i))) {
+					return TRUE;
+				}
+			}
+		}
+	}
+	return FALSE;
+}
+
 static gboolean
 any_in_range(dfilter_t *df, int reg1, int reg2, int reg3)
 {
@@ -459,7 +835,31 @@ mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 
 
 gboolean
-dfvm_apply(dfilter_t *df, proto_tree *tree)
+dfvm_can_apply_source(const dfilter_t *df,
+		gboolean (*can_supply)(void *data, int hfid, gboolean values),
+		void *data)
+{
+	guint			i;
+	dfvm_insn_t		*insn;
+	header_field_info	*hfinfo;
+
+	for (i = 0; i < df->insns->len; i++) {
+		insn = (dfvm_insn_t *)g_ptr_array_index(df->insns, i);
+		if (insn->op != CHECK_EXISTS && insn->op != READ_TREE) {
+			continue;
+		}
+		for (hfinfo = insn->arg1->value.hfinfo; hfinfo; hfinfo = hfinfo->same_name_next) {
+			if (!can_supply(data, hfinfo->id, insn->op == READ_TREE)) {
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/* Runs the filter against either a protocol tree or a field source. */
+static gboolean
+dfvm_run(dfilter_t *df, proto_tree *tree, const dfilter_field_source_t *source)
 {
 	int		id, length;
 	gboolean	accum = TRUE;
@@ -472,8 +872,6 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 	GList		*param1;
 	GList		*param2;
 
-	g_assert(tree);
-
 	length = df->insns->len;
 
 	for (id = 0; id < length; id++) {
@@ -487,8 +885,12 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 			case CHECK_EXISTS:
 				hfinfo = arg1->value.hfinfo;
 				while(hfinfo) {
-					accum = proto_check_for_protocol_or_field(tree,
-							hfinfo->id);
+					if (source)
+						accum = source->exists(source->data,
+								hfinfo->id);
+					else
+						accum = proto_check_for_protocol_or_field(tree,
+								hfinfo->id);
 					if (accum) {
 						break;
 					}
@@ -499,7 +901,7 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 				break;
 
 			case READ_TREE:
-				accum = read_tree(df, tree,
+				accum = read_tree(df, tree, source,
 						arg1->value.hfinfo, arg2->value.numeric);
 				break;
 
@@ -579,6 +981,53 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 						arg3->value.numeric);
 				break;
 
+			case ANY_EQ_INT:
+				accum = any_int_test(df, insn->op, fvalue_eq,
+						arg1->value.numeric, arg2->value.numeric,
+						&insn->arg3->value.int_key);
+				break;
+
+			case ANY_NE_INT:
+				accum = any_int_test(df, insn->op, fvalue_ne,
+						arg1->value.numeric, arg2->value.numeric,
+						&insn->arg3->value.int_key);
+				break;
+
+			case ANY_GT_INT:
+				accum = any_int_test(df, insn->op, fvalue_gt,
+						arg1->value.numeric, arg2->value.numeric,
+						&insn->arg3->value.int_key);
+				break;
+
+			case ANY_GE_INT:
+				accum = any_int_test(df, insn->op, fvalue_ge,
+						arg1->value.numeric, arg2->value.numeric,
+						&insn->arg3->value.int_key);
+				break;
+
+			case ANY_LT_INT:
+				accum = any_int_test(df, insn->op, fvalue_lt,
+						arg1->value.numeric, arg2->value.numeric,
+						&insn->arg3->value.int_key);
+				break;
+
+			case ANY_LE_INT:
+				accum = any_int_test(df, insn->op, fvalue_le,
+						arg1->value.numeric, arg2->value.numeric,
+						&insn->arg3->value.int_key);
+				break;
+
+			case ANY_CONTAINS_BYTES:
+				accum = any_contains_bytes(df, arg1->value.numeric,
+						arg2->value.numeric,
+						insn->arg3->value.pattern);
+				break;
+
+			case ANY_IN_INT_SET:
+				accum = any_in_int_set(df, arg1->value.numeric,
+						arg2->value.int_set);
+				break;
+
 			case NOT:
 				accum = !accum;
 				break;
@@ -619,6 +1068,19 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 	return FALSE; /* to appease the compiler */
 }
 
+gboolean
+dfvm_apply(dfilter_t *df, proto_tree *tree)
+{
+	g_assert(tree);
+	return dfvm_run(df, tree, NULL);
+}
+
+gboolean
+dfvm_apply_source(dfilter_t *df, const dfilter_field_source_t *source)
+{
+	return dfvm_run(df, NULL, source);
+}
+
 void
 dfvm_init_const(dfilter_t *df)
 {
@@ -654,6 +1116,14 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
 			case ANY_IN_RANGE:
+			case ANY_EQ_INT:
+			case ANY_NE_INT:
+			case ANY_GT_INT:
+			case ANY_GE_INT:
+			case ANY_LT_INT:
+			case ANY_LE_INT:
+			case ANY_CONTAINS_BYTES:
+			case ANY_IN_INT_SET:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -23,9 +23,43 @@ typedef enum {
 	REGISTER,
 	INTEGER,
 	DRANGE,
-	FUNCTION_DEF
+	FUNCTION_DEF,
+	INT_KEY,
+	INT_KEY_SET,
+	BYTE_PATTERN
 } dfvm_value_type_t;
 
+/* Integer-like values (integers, IPX networks, frame numbers and unmasked
+ * IPv4 addresses) are mapped onto a guint64 that sorts in the same order as
+ * the value itself. Keys are only comparable if they have the same class. */
+typedef enum {
+	DFVM_KEY_NONE,
+	DFVM_KEY_UNSIGNED,
+	DFVM_KEY_SIGNED,
+	DFVM_KEY_IPV4
+} dfvm_key_class_t;
+
+typedef struct {
+	dfvm_key_class_t	key_class;
+	guint64			key;
+} dfvm_int_key_t;
+
+/* Constant set of the "in" operator when all members have a key. */
+typedef struct {
+	dfvm_key_class_t	key_class;
+	guint			count;
+	guint64			*keys;		/* sorted, without duplicates */
+	GPtrArray		*fvalues;	/* members, for values without a key */
+} dfvm_int_set_t;
+
+/* Constant operand of "contains", with its Horspool shift table. */
+typedef struct {
+	gboolean		is_string;
+	guint			len;
+	guint8			*bytes;
+	guint			skip[256];
+} dfvm_byte_pattern_t;
+
 typedef struct {
 	dfvm_value_type_t	type;
 
@@ -35,6 +69,9 @@ typedef struct {
 		drange_t		*drange;
 		header_field_info	*hfinfo;
         df_func_def_t   *funcdef;
+		dfvm_int_key_t		int_key;
+		dfvm_int_set_t		*int_set;
+		dfvm_byte_pattern_t	*pattern;
 	} value;
 
 } dfvm_value_t;
@@ -60,7 +97,22 @@ typedef enum {
 	ANY_MATCHES,
 	MK_RANGE,
 	CALL_FUNCTION,
-	ANY_IN_RANGE
+	ANY_IN_RANGE,
+
+	/* Specialized forms of the above, generated when one side of the
+	 * relation is a constant. arg1 is the field register, arg2 the
+	 * register of the constant (used for values that don't fit the fast
+	 * path) and arg3 the precomputed constant. */
+	ANY_EQ_INT,
+	ANY_NE_INT,
+	ANY_GT_INT,
+	ANY_GE_INT,
+	ANY_LT_INT,
+	ANY_LE_INT,
+	ANY_CONTAINS_BYTES,
+
+	/* arg1 is the field register, arg2 the INT_KEY_SET. */
+	ANY_IN_INT_SET
 
 } dfvm_opcode_t;
 
@@ -82,12 +134,29 @@ dfvm_insn_free(dfvm_insn_t *insn);
 dfvm_value_t*
 dfvm_value_new(dfvm_value_type_t type);
 
+gboolean
+dfvm_int_key(const fvalue_t *fv, dfvm_int_key_t *ik);
+
+dfvm_int_set_t*
+dfvm_int_set_new(GPtrArray *fvalues);
+
+dfvm_byte_pattern_t*
+dfvm_byte_pattern_new(const fvalue_t *fv);
+
 void
 dfvm_dump(FILE *f, dfilter_t *df);
 
 gboolean
 dfvm_apply(dfilter_t *df, proto_tree *tree);
 
+gboolean
+dfvm_can_apply_source(const dfilter_t *df,
+		gboolean (*can_supply)(void *data, int hfid, gboolean values),
+		void *data);
+
+gboolean
+dfvm_apply_source(dfilter_t *df, const dfilter_field_source_t *source);
+
 void
 dfvm_init_const(dfilter_t *df);
 
@@ -236,7 +236,7 @@ dfw_append_function(dfwork_t *dfw, stnode_t *node, dfvm_value_t **p_jmp)
  * Adds an instruction for a relation operator where the values are already
  * loaded in registers.
  */
-static void
+static dfvm_insn_t *
 gen_relation_regs(dfwork_t *dfw, dfvm_opcode_t op, int reg1, int reg2)
 {
 	dfvm_insn_t	*insn;
@@ -250,20 +250,65 @@ gen_relation_regs(dfwork_t *dfw, dfvm_opcode_t op, int reg1, int reg2)
 	insn->arg1 = val1;
 	insn->arg2 = val2;
 	dfw_append_insn(dfw, insn);
+	return insn;
+}
+
+/* If the RHS of a relation is a constant that allows it, returns the
+ * specialized opcode and the precomputed constant for it. Otherwise
+ * returns op unchanged. */
+static dfvm_opcode_t
+specialize_relation(dfvm_opcode_t op, const fvalue_t *fv, dfvm_value_t **p_val)
+{
+	dfvm_opcode_t		spec_op;
+	dfvm_int_key_t		ik;
+	dfvm_byte_pattern_t	*pattern;
+
+	switch (op) {
+		case ANY_EQ:	spec_op = ANY_EQ_INT; break;
+		case ANY_NE:	spec_op = ANY_NE_INT; break;
+		case ANY_GT:	spec_op = ANY_GT_INT; break;
+		case ANY_GE:	spec_op = ANY_GE_INT; break;
+		case ANY_LT:	spec_op = ANY_LT_INT; break;
+		case ANY_LE:	spec_op = ANY_LE_INT; break;
+
+		case ANY_CONTAINS:
+			pattern = dfvm_byte_pattern_new(fv);
+			if (!pattern)
+				return op;
+			*p_val = dfvm_value_new(BYTE_PATTERN);
+			(*p_val)->value.pattern = pattern;
+			return ANY_CONTAINS_BYTES;
+
+		default:
+			return op;
+	}
+
+	if (!dfvm_int_key(fv, &ik))
+		return op;
+	*p_val = dfvm_value_new(INT_KEY);
+	(*p_val)->value.int_key = ik;
+	return spec_op;
 }
 
 static void
 gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2)
 {
+	dfvm_insn_t	*insn;
 	dfvm_value_t	*jmp1 = NULL, *jmp2 = NULL;
+	dfvm_value_t	*spec_val = NULL;
 	int		reg1 = -1, reg2 = -1;
 
+	if (dfw->specialize && stnode_type_id(st_arg2) == STTYPE_FVALUE) {
+		op = specialize_relation(op, (fvalue_t *)stnode_data(st_arg2), &spec_val);
+	}
+
 	/* Create code for the LHS and RHS of the relation */
 	reg1 = gen_entity(dfw, st_arg1, &jmp1);
 	reg2 = gen_entity(dfw, st_arg2, &jmp2);
 
 	/* Then combine them in a DFVM insruction */
-	gen_relation_regs(dfw, op, reg1, reg2);
+	insn = gen_relation_regs(dfw, op, reg1, reg2);
+	insn->arg3 = spec_val;
 
 	/* If either of the relation arguments need an "exit" instruction
 	 * to jump to (on failure), mark them */
@@ -287,6 +332,51 @@ fixup_jumps(gpointer data, gpointer user_data)
 	}
 }
 
+/* If every member of the set is a constant with an integer key, generate a
+ * single lookup in a sorted array instead of a chain of == tests. */
+static gboolean
+gen_relation_in_int_set(dfwork_t *dfw, int reg1, GSList *nodelist)
+{
+	dfvm_insn_t	*insn;
+	dfvm_value_t	*val1, *val2;
+	dfvm_int_set_t	*set;
+	GPtrArray	*fvalues;
+	GSList		*l;
+	stnode_t	*node1, *node2;
+
+	fvalues = g_ptr_array_new();
+	for (l = nodelist; l; l = g_slist_next(g_slist_next(l))) {
+		node1 = (stnode_t*)l->data;
+		node2 = (stnode_t*)g_slist_next(l)->data;
+		if (node2 || stnode_type_id(node1) != STTYPE_FVALUE) {
+			g_ptr_array_free(fvalues, TRUE);
+			return FALSE;
+		}
+		g_ptr_array_add(fvalues, stnode_data(node1));
+	}
+
+	set = dfvm_int_set_new(fvalues);
+	if (!set) {
+		g_ptr_array_free(fvalues, TRUE);
+		return FALSE;
+	}
+
+	/* The set owns the values now. */
+	for (l = nodelist; l; l = g_slist_next(g_slist_next(l))) {
+		stnode_steal_data((stnode_t*)l->data);
+	}
+
+	insn = dfvm_insn_new(ANY_IN_INT_SET);
+	val1 = dfvm_value_new(REGISTER);
+	val1->value.numeric = reg1;
+	val2 = dfvm_value_new(INT_KEY_SET);
+	val2->value.int_set = set;
+	insn->arg1 = val1;
+	insn->arg2 = val2;
+	dfw_append_insn(dfw, insn);
+	return TRUE;
+}
+
 /* Generate the code for the in operator.  It behaves much like an OR-ed
  * series of == tests, but without the redundant existence checks. */
 static void
@@ -305,6 +395,9 @@ gen_relation_in(dfwork_t *dfw, stnode_t *st_arg1, stnode_t *st_arg2)
 
 	/* Create code for the set on the RHS of the relation */
 	nodelist_head = nodelist = (GSList*)stnode_steal_data(st_arg2);
+	if (dfw->specialize && gen_relation_in_int_set(dfw, reg1, nodelist)) {
+		nodelist = NULL;
+	}
 	while (nodelist) {
 		node1 = (stnode_t*)nodelist->data;
 		nodelist = g_slist_next(nodelist);
@@ -475,6 +475,9 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 			proto_tree_add_int(fh_tree, hf_frame_wtap_encap, tvb, 0, 0, pinfo->rec->rec_header.packet_header.pkt_encap);
 
 		if (pinfo->presence_flags & PINFO_HAS_TS) {
+			const nstime_t *shift_offset;
+			nstime_t        no_shift_offset;
+
 			proto_tree_add_time(fh_tree, hf_frame_arrival_time, tvb,
 					    0, 0, &(pinfo->abs_ts));
 			if (pinfo->abs_ts.nsecs < 0 || pinfo->abs_ts.nsecs >= 1000000000) {
@@ -483,8 +486,13 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 								  " the valid range is 0-1000000000",
 								  (long) pinfo->abs_ts.nsecs);
 			}
+			shift_offset = epan_get_shift_offset(pinfo->epan, pinfo->fd);
+			if (shift_offset == NULL) {
+				nstime_set_zero(&no_shift_offset);
+				shift_offset = &no_shift_offset;
+			}
 			item = proto_tree_add_time(fh_tree, hf_frame_shift_offset, tvb,
-					    0, 0, &(pinfo->fd->shift_offset));
+					    0, 0, shift_offset);
 			proto_item_set_generated(item);
 
 			if (generate_epoch_time) {
@@ -41,6 +41,7 @@
 #include "addr_resolv.h"
 #include "oids.h"
 #include "wmem/wmem.h"
+#include "app_mem_usage.h"
 #include "expert.h"
 #include "print.h"
 #include "capture_dissectors.h"
@@ -96,6 +97,32 @@ static GSList *epan_plugin_register_all_handoffs = NULL;
 
 static wmem_allocator_t *pinfo_pool_cache = NULL;
 
+static gsize
+file_scope_get_mem_used(void)
+{
+	wmem_allocator_stats_t stats;
+
+	wmem_allocator_get_stats(wmem_file_scope(), &stats);
+	return (gsize)stats.bytes_in_use;
+}
+
+static gsize
+epan_scope_get_mem_used(void)
+{
+	wmem_allocator_stats_t stats;
+
+	wmem_allocator_get_stats(wmem_epan_scope(), &stats);
+	return (gsize)stats.bytes_in_use;
+}
+
+static const ws_mem_usage_t file_scope_mem_usage = {
+	"File scope", file_scope_get_mem_used, NULL
+};
+
+static const ws_mem_usage_t epan_scope_mem_usage = {
+	"Epan scope", epan_scope_get_mem_used, NULL
+};
+
 /* Global variables holding the content of the corresponding environment variable
  * to save fetching it repeatedly.
  */
@@ -221,6 +248,8 @@ epan_init(register_cb cb, gpointer client_data, gboolean load_plugins)
 	 */
 	/* initialize memory allocation subsystem */
 	wmem_init();
+	memory_usage_component_register(&file_scope_mem_usage);
+	memory_usage_component_register(&epan_scope_mem_usage);
 
 	/* initialize the GUID to name mapping table */
 	guids_init();
@@ -429,6 +458,15 @@ epan_get_user_comment(const epan_t *session, const frame_data *fd)
 	return NULL;
 }
 
+const nstime_t *
+epan_get_shift_offset(const epan_t *session, const frame_data *fd)
+{
+	if (fd->has_shift_offset && session->funcs.get_shift_offset)
+		return session->funcs.get_shift_offset(session->prov, fd);
+
+	return NULL;
+}
+
 const char *
 epan_get_interface_name(const epan_t *session, guint32 interface_id)
 {
@@ -507,6 +545,7 @@ epan_dissect_init(epan_dissect_t *edt, epan_t *session, const gboolean create_pr
 	}
 	else {
 		edt->pi.pool = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
+		wmem_allocator_set_name(edt->pi.pool, "Packet info");
 	}
 
 	if (create_proto_tree) {
@@ -674,6 +713,12 @@ epan_dissect_prime_with_dfilter(epan_dissect_t *edt, const dfilter_t* dfcode)
 	dfilter_prime_proto_tree(dfcode, edt->tree);
 }
 
+void
+epan_dissect_restrict_protocols(epan_dissect_t *edt, GHashTable *protos)
+{
+	edt->pi.dissect_protocols = protos;
+}
+
 void
 epan_dissect_prime_with_hfid(epan_dissect_t *edt, int hfid)
 {
@@ -50,6 +50,7 @@ struct packet_provider_funcs {
 	const char *(*get_interface_name)(struct packet_provider_data *prov, guint32 interface_id);
 	const char *(*get_interface_description)(struct packet_provider_data *prov, guint32 interface_id);
 	const char *(*get_user_comment)(struct packet_provider_data *prov, const frame_data *fd);
+	const nstime_t *(*get_shift_offset)(struct packet_provider_data *prov, const frame_data *fd);
 };
 
 #ifdef HAVE_PLUGINS
@@ -153,6 +154,11 @@ WS_DLL_PUBLIC epan_t *epan_new(struct packet_provider_data *prov,
 
 WS_DLL_PUBLIC const char *epan_get_user_comment(const epan_t *session, const frame_data *fd);
 
+/**
+ * How much a frame's time stamp has been shifted, or NULL if it hasn't.
+ */
+WS_DLL_PUBLIC const nstime_t *epan_get_shift_offset(const epan_t *session, const frame_data *fd);
+
 WS_DLL_PUBLIC const char *epan_get_interface_name(const epan_t *session, guint32 interface_id);
 
 WS_DLL_PUBLIC const char *epan_get_interface_description(const epan_t *session, guint32 interface_id);
@@ -228,6 +234,14 @@ WS_DLL_PUBLIC
 void
 epan_dissect_prime_with_dfilter(epan_dissect_t *edt, const struct epan_dfilter *dfcode);
 
+/** Only call the dissectors of the given protocols (a set of protocol ids,
+ * see dissector_protocols_leading_to()) when dissecting the next packet.
+ * Like priming, this has to be done again after every reset. NULL
+ * dissects everything. */
+WS_DLL_PUBLIC
+void
+epan_dissect_restrict_protocols(epan_dissect_t *edt, GHashTable *protos);
+
 /** Prime an epan_dissect_t's proto_tree with a field/protocol specified by its hfid */
 WS_DLL_PUBLIC
 void
@@ -0,0 +1,407 @@
+/* field_index.c
+ * Routines for an index of the values of selected fields in each frame
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/packet.h>
+#include <epan/proto.h>
+#include <epan/ftypes/ftypes.h>
+
+#include "field_index.h"
+
+/*
+ * Each indexed field is a column.  Columns with values have, for each
+ * frame, the offset in the values array just past that frame's values,
+ * so the values for frame n are between the ends of frames n - 1 and n.
+ * Values that fit in 32 bits are stored in 32 bits.  Columns without
+ * values just have a bit for each frame.
+ */
+typedef struct {
+    header_field_info *hfinfo;
+    gboolean    has_values;
+    gboolean    wide;           /* values are guint64, not guint32 */
+    GArray     *ends;           /* guint32 for each frame, if has_values */
+    GArray     *values;         /* guint32 or guint64, if has_values */
+    GByteArray *present;        /* a bit for each frame, if !has_values */
+    GArray     *scratch;        /* fvalue_t's handed to the display filter */
+} field_index_column_t;
+
+struct _field_index {
+    GPtrArray  *columns;        /* field_index_column_t */
+    GHashTable *by_hfid;        /* hfid -> field_index_column_t */
+    guint32     num_frames;
+    GArray     *dep_ends;       /* guint32 for each frame */
+    GArray     *deps;           /* guint32 frame numbers */
+    guint32     framenum;       /* frame being filtered */
+};
+
+static gboolean
+field_index_type_has_values(ftenum_t type, gboolean *wide)
+{
+    switch (type) {
+
+    case FT_CHAR:
+    case FT_UINT8:
+    case FT_UINT16:
+    case FT_UINT24:
+    case FT_UINT32:
+    case FT_FRAMENUM:
+    case FT_IPv4:
+    case FT_INT8:
+    case FT_INT16:
+    case FT_INT24:
+    case FT_INT32:
+        *wide = FALSE;
+        return TRUE;
+
+    case FT_UINT40:
+    case FT_UINT48:
+    case FT_UINT56:
+    case FT_UINT64:
+    case FT_BOOLEAN:
+    case FT_INT40:
+    case FT_INT48:
+    case FT_INT56:
+    case FT_INT64:
+        *wide = TRUE;
+        return TRUE;
+
+    default:
+        return FALSE;
+    }
+}
+
+static void
+field_index_add_column(field_index_t *index, header_field_info *hfinfo)
+{
+    field_index_column_t *column;
+
+    if (g_hash_table_contains(index->by_hfid, GINT_TO_POINTER(hfinfo->id)))
+        return;
+
+    column = g_new0(field_index_column_t, 1);
+    column->hfinfo = hfinfo;
+    column->has_values = field_index_type_has_values(hfinfo->type, &column->wide);
+    if (column->has_values) {
+        column->ends = g_array_new(FALSE, FALSE, sizeof(guint32));
+        column->values = g_array_new(FALSE, FALSE, column->wide ? sizeof(guint64) : sizeof(guint32));
+        column->scratch = g_array_new(FALSE, FALSE, sizeof(fvalue_t));
+    } else {
+        column->present = g_byte_array_new();
+    }
+    g_ptr_array_add(index->columns, column);
+    g_hash_table_insert(index->by_hfid, GINT_TO_POINTER(hfinfo->id), column);
+}
+
+field_index_t *
+field_index_new(const char *fields)
+{
+    field_index_t *index;
+    gchar **names;
+    header_field_info *hfinfo;
+    int i;
+
+    index = g_new0(field_index_t, 1);
+    index->columns = g_ptr_array_new();
+    index->by_hfid = g_hash_table_new(g_direct_hash, g_direct_equal);
+    index->dep_ends = g_array_new(FALSE, FALSE, sizeof(guint32));
+    index->deps = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+    names = g_strsplit_set(fields ? fields : "", ", \t", -1);
+    for (i = 0; names[i] != NULL; i++) {
+        if (names[i][0] == '\0')
+            continue;
+        /* Filters test all the fields with a name, so index all of them. */
+        for (hfinfo = proto_registrar_get_byname(names[i]); hfinfo != NULL;
+             hfinfo = hfinfo->same_name_next)
+            field_index_add_column(index, hfinfo);
+    }
+    g_strfreev(names);
+
+    if (index->columns->len == 0) {
+        field_index_free(index);
+        return NULL;
+    }
+    return index;
+}
+
+static void
+field_index_free_column(field_index_column_t *column)
+{
+    if (column->has_values) {
+        g_array_free(column->ends, TRUE);
+        g_array_free(column->values, TRUE);
+        g_array_free(column->scratch, TRUE);
+    } else {
+        g_byte_array_free(column->present, TRUE);
+    }
+    g_free(column);
+}
+
+void
+field_index_free(field_index_t *index)
+{
+    guint i;
+
+    for (i = 0; i < index->columns->len; i++)
+        field_index_free_column((field_index_column_t *)g_ptr_array_index(index->columns, i));
+    g_ptr_array_free(index->columns, TRUE);
+    g_hash_table_destroy(index->by_hfid);
+    g_array_free(index->dep_ends, TRUE);
+    g_array_free(index->deps, TRUE);
+    g_free(index);
+}
+
+void
+field_index_clear(field_index_t *index)
+{
+    field_index_column_t *column;
+    guint i;
+
+    for (i = 0; i < index->columns->len; i++) {
+        column = (field_index_column_t *)g_ptr_array_index(index->columns, i);
+        if (column->has_values) {
+            g_array_set_size(column->ends, 0);
+            g_array_set_size(column->values, 0);
+        } else {
+            g_byte_array_set_size(column->present, 0);
+        }
+    }
+    g_array_set_size(index->dep_ends, 0);
+    g_array_set_size(index->deps, 0);
+    index->num_frames = 0;
+}
+
+void
+field_index_prime_edt(field_index_t *index, epan_dissect_t *edt)
+{
+    guint i;
+
+    for (i = 0; i < index->columns->len; i++)
+        epan_dissect_prime_with_hfid(edt,
+            ((field_index_column_t *)g_ptr_array_index(index->columns, i))->hfinfo->id);
+}
+
+static void
+field_index_add_values(field_index_column_t *column, proto_tree *tree)
+{
+    GPtrArray *finfos;
+    fvalue_t *fv;
+    guint32 value32, end;
+    guint64 value64;
+    guint i;
+
+    finfos = proto_get_finfo_ptr_array(tree, column->hfinfo->id);
+    for (i = 0; finfos != NULL && i < finfos->len; i++) {
+        fv = &((field_info *)g_ptr_array_index(finfos, i))->value;
+        switch (column->hfinfo->type) {
+
+        case FT_INT8:
+        case FT_INT16:
+        case FT_INT24:
+        case FT_INT32:
+            value32 = (guint32)fvalue_get_sinteger(fv);
+            g_array_append_val(column->values, value32);
+            break;
+
+        case FT_INT40:
+        case FT_INT48:
+        case FT_INT56:
+        case FT_INT64:
+            value64 = (guint64)fvalue_get_sinteger64(fv);
+            g_array_append_val(column->values, value64);
+            break;
+
+        default:
+            if (column->wide) {
+                value64 = fvalue_get_uinteger64(fv);
+                g_array_append_val(column->values, value64);
+            } else {
+                value32 = fvalue_get_uinteger(fv);
+                g_array_append_val(column->values, value32);
+            }
+            break;
+        }
+    }
+    end = column->values->len;
+    g_array_append_val(column->ends, end);
+}
+
+void
+field_index_add(field_index_t *index, guint32 framenum, epan_dissect_t *edt)
+{
+    field_index_column_t *column;
+    GSList *dep;
+    guint32 dependent_frame, end;
+    guint i;
+
+    if (framenum != index->num_frames + 1 || edt->tree == NULL)
+        return;
+
+    for (i = 0; i < index->columns->len; i++) {
+        column = (field_index_column_t *)g_ptr_array_index(index->columns, i);
+        if (column->has_values) {
+            field_index_add_values(column, edt->tree);
+        } else {
+            if (index->num_frames % 8 == 0)
+                g_byte_array_append(column->present, (const guint8 *)"", 1);
+            if (proto_check_for_protocol_or_field(edt->tree, column->hfinfo->id))
+                column->present->data[index->num_frames / 8] |= 1 << (index->num_frames % 8);
+        }
+    }
+
+    for (dep = edt->pi.dependent_frames; dep != NULL; dep = g_slist_next(dep)) {
+        dependent_frame = GPOINTER_TO_UINT(dep->data);
+        g_array_append_val(index->deps, dependent_frame);
+    }
+    end = index->deps->len;
+    g_array_append_val(index->dep_ends, end);
+
+    index->num_frames++;
+}
+
+guint32
+field_index_frame_count(const field_index_t *index)
+{
+    return index->num_frames;
+}
+
+static gboolean
+field_index_can_supply(void *data, int hfid, gboolean values)
+{
+    field_index_t *index = (field_index_t *)data;
+    field_index_column_t *column;
+
+    column = (field_index_column_t *)g_hash_table_lookup(index->by_hfid, GINT_TO_POINTER(hfid));
+    return column != NULL && (column->has_values || !values);
+}
+
+gboolean
+field_index_can_filter(field_index_t *index, const dfilter_t *dfcode)
+{
+    return dfilter_can_apply_source(dfcode, field_index_can_supply, index);
+}
+
+/* Get the range of values of frame framenum in a values array. */
+static void
+field_index_range(GArray *ends, guint32 framenum, guint *start, guint *end)
+{
+    *start = framenum > 1 ? g_array_index(ends, guint32, framenum - 2) : 0;
+    *end = g_array_index(ends, guint32, framenum - 1);
+}
+
+static gboolean
+field_index_exists(void *data, int hfid)
+{
+    field_index_t *index = (field_index_t *)data;
+    field_index_column_t *column;
+    guint32 bit = index->framenum - 1;
+    guint start, end;
+
+    column = (field_index_column_t *)g_hash_table_lookup(index->by_hfid, GINT_TO_POINTER(hfid));
+    if (!column->has_values)
+        return (column->present->data[bit / 8] & (1 << (bit % 8))) != 0;
+    field_index_range(column->ends, index->framenum, &start, &end);
+    return end > start;
+}
+
+static GList *
+field_index_read(void *data, int hfid)
+{
+    field_index_t *index = (field_index_t *)data;
+    field_index_column_t *column;
+    fvalue_t *fv;
+    GList *fvalues = NULL;
+    guint start, end, i, old_len;
+
+    column = (field_index_column_t *)g_hash_table_lookup(index->by_hfid, GINT_TO_POINTER(hfid));
+    field_index_range(column->ends, index->framenum, &start, &end);
+    if (end == start)
+        return NULL;
+
+    if (column->scratch->len < end - start) {
+        old_len = column->scratch->len;
+        g_array_set_size(column->scratch, end - start);
+        for (i = old_len; i < end - start; i++)
+            fvalue_init(&g_array_index(column->scratch, fvalue_t, i), column->hfinfo->type);
+    }
+
+    for (i = start; i < end; i++) {
+        fv = &g_array_index(column->scratch, fvalue_t, i - start);
+        switch (column->hfinfo->type) {
+
+        case FT_INT8:
+        case FT_INT16:
+        case FT_INT24:
+        case FT_INT32:
+            fvalue_set_sinteger(fv, (gint32)g_array_index(column->values, guint32, i));
+            break;
+
+        case FT_INT40:
+        case FT_INT48:
+        case FT_INT56:
+        case FT_INT64:
+            fvalue_set_sinteger64(fv, (gint64)g_array_index(column->values, guint64, i));
+            break;
+
+        default:
+            if (column->wide)
+                fvalue_set_uinteger64(fv, g_array_index(column->values, guint64, i));
+            else
+                fvalue_set_uinteger(fv, g_array_index(column->values, guint32, i));
+            break;
+        }
+        fvalues = g_list_prepend(fvalues, fv);
+    }
+    return fvalues;
+}
+
+gboolean
+field_index_filter(field_index_t *index, dfilter_t *dfcode, guint32 framenum)
+{
+    dfilter_field_source_t source;
+
+    g_assert(framenum >= 1 && framenum <= index->num_frames);
+
+    source.exists = field_index_exists;
+    source.read = field_index_read;
+    source.data = index;
+    index->framenum = framenum;
+    return dfilter_apply_source(dfcode, &source);
+}
+
+const guint32 *
+field_index_dependent_frames(field_index_t *index, guint32 framenum, guint *count)
+{
+    guint start, end;
+
+    g_assert(framenum >= 1 && framenum <= index->num_frames);
+
+    field_index_range(index->dep_ends, framenum, &start, &end);
+    *count = end - start;
+    return &g_array_index(index->deps, guint32, start);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,102 @@
+/* field_index.h
+ * Definitions for an index of the values of selected fields in each frame
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __FIELD_INDEX_H__
+#define __FIELD_INDEX_H__
+
+#include "ws_symbol_export.h"
+
+#include <epan/epan_dissect.h>
+#include <epan/dfilter/dfilter.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A field index records, for each frame, the values of a set of fields,
+ * so that display filters that only test those fields can be applied
+ * without dissecting the frames again.
+ *
+ * Integer, boolean and IPv4 address fields are stored with their values;
+ * for fields of any other type, and for protocols, only whether they're
+ * present is stored.  The frames on which each frame depends are stored
+ * as well.
+ */
+typedef struct _field_index field_index_t;
+
+/*
+ * Create an index of the fields named in a comma- or space-separated
+ * list.  Names that aren't fields or protocols are ignored.  Returns
+ * NULL if no fields are named.
+ */
+WS_DLL_PUBLIC field_index_t *field_index_new(const char *fields);
+
+WS_DLL_PUBLIC void field_index_free(field_index_t *index);
+
+/* Forget all the frames that have been added. */
+WS_DLL_PUBLIC void field_index_clear(field_index_t *index);
+
+/* Prime an epan_dissect_t so that its tree has the indexed fields. */
+WS_DLL_PUBLIC void field_index_prime_edt(field_index_t *index, epan_dissect_t *edt);
+
+/*
+ * Add the indexed fields in an epan_dissect_t primed with
+ * field_index_prime_edt() and run on frame framenum.  Frames have to be
+ * added in order; a frame other than the one after the last one added is
+ * ignored, which leaves the index stopped at that one.
+ *
+ * Only add frames that have been dissected before: some fields, such as
+ * those referring to a response, are only known once later frames have
+ * been dissected, so the first pass doesn't have the values that every
+ * later pass will.
+ */
+WS_DLL_PUBLIC void field_index_add(field_index_t *index, guint32 framenum,
+    epan_dissect_t *edt);
+
+/* The number of frames that have been added. */
+WS_DLL_PUBLIC guint32 field_index_frame_count(const field_index_t *index);
+
+/* Returns TRUE if the index has every field that a filter tests. */
+WS_DLL_PUBLIC gboolean field_index_can_filter(field_index_t *index,
+    const dfilter_t *dfcode);
+
+/*
+ * Apply a filter for which field_index_can_filter() returned TRUE to
+ * frame framenum, which has to have been added.
+ */
+WS_DLL_PUBLIC gboolean field_index_filter(field_index_t *index,
+    dfilter_t *dfcode, guint32 framenum);
+
+/*
+ * Get the frames on which frame framenum depends, as a pointer to
+ * *count frame numbers.
+ */
+WS_DLL_PUBLIC const guint32 *field_index_dependent_frames(field_index_t *index,
+    guint32 framenum, guint *count);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __FIELD_INDEX_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
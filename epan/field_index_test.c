@@ -0,0 +1,303 @@
+/* field_index_test.c
+ * Standalone program to check that filtering with a field index gives
+ * the same results as filtering dissected frames.
+ *
+ * Usage:
+ *     field_index_test <capture file with DNS requests and responses>
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <wiretap/wtap.h>
+
+#include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/field_index.h>
+#include <epan/frame_data.h>
+#include <epan/tvbuff.h>
+#include <epan/dfilter/dfilter.h>
+
+#define INDEXED_FIELDS "dns dns.flags.response dns.response_in ip.ttl icmp"
+
+static const char *filters[] = {
+    "dns.response_in",
+    "dns.response_in && dns.flags.response == 0",
+    "dns && !dns.response_in",
+    "dns.flags.response == 1 || icmp",
+    "ip.ttl > 64",
+};
+
+#define NUM_FILTERS G_N_ELEMENTS(filters)
+
+static const char *capture_path;
+
+typedef struct {
+    wtap          *wth;
+    epan_t        *session;
+    epan_dissect_t edt;
+    wtap_rec       rec;
+    Buffer         buf;
+    GPtrArray     *frames;          /* frame_data */
+} test_file_t;
+
+static void
+test_file_open(test_file_t *tf)
+{
+    static const struct packet_provider_funcs funcs = {
+        NULL, NULL, NULL, NULL, NULL
+    };
+    int err;
+    gchar *err_info = NULL;
+    gint64 offset;
+    guint32 cum_bytes = 0;
+    frame_data *fdata;
+
+    tf->wth = wtap_open_offline(capture_path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    if (tf->wth == NULL)
+        g_error("Can't open %s: %s", capture_path, g_strerror(err));
+    tf->session = epan_new(NULL, &funcs);
+    epan_dissect_init(&tf->edt, tf->session, TRUE, FALSE);
+    wtap_rec_init(&tf->rec);
+    ws_buffer_init(&tf->buf, 1514);
+    tf->frames = g_ptr_array_new();
+
+    while (wtap_read(tf->wth, &tf->rec, &tf->buf, &err, &err_info, &offset)) {
+        fdata = g_new(frame_data, 1);
+        frame_data_init(fdata, tf->frames->len + 1, &tf->rec, offset, cum_bytes);
+        g_ptr_array_add(tf->frames, fdata);
+    }
+    g_assert_cmpint(err, ==, 0);
+    g_assert_cmpuint(tf->frames->len, >, 0);
+}
+
+static void
+test_file_close(test_file_t *tf)
+{
+    guint i;
+
+    for (i = 0; i < tf->frames->len; i++) {
+        frame_data_destroy((frame_data *)g_ptr_array_index(tf->frames, i));
+        g_free(g_ptr_array_index(tf->frames, i));
+    }
+    g_ptr_array_free(tf->frames, TRUE);
+    ws_buffer_free(&tf->buf);
+    wtap_rec_cleanup(&tf->rec);
+    epan_dissect_cleanup(&tf->edt);
+    epan_free(tf->session);
+    wtap_close(tf->wth);
+}
+
+/*
+ * Dissect a frame, as file.c does; the epan_dissect_t has to have been
+ * primed with whatever the caller wants from it.
+ */
+static void
+test_file_dissect(test_file_t *tf, frame_data *fdata, nstime_t *elapsed_time,
+    const frame_data **ref, const frame_data **prev_dis, guint32 *cum_bytes)
+{
+    int err;
+    gchar *err_info = NULL;
+
+    if (!wtap_seek_read(tf->wth, fdata->file_off, &tf->rec, &tf->buf, &err, &err_info))
+        g_error("Can't read frame %u: %s", fdata->num, g_strerror(err));
+
+    frame_data_set_before_dissect(fdata, elapsed_time, ref, *prev_dis);
+    epan_dissect_run(&tf->edt, wtap_file_type_subtype(tf->wth), &tf->rec,
+                     tvb_new_real_data(ws_buffer_start_ptr(&tf->buf), fdata->cap_len, fdata->pkt_len),
+                     fdata, NULL);
+    frame_data_set_after_dissect(fdata, cum_bytes);
+    *prev_dis = fdata;
+}
+
+static void
+test_file_start_pass(nstime_t *elapsed_time, const frame_data **ref,
+    const frame_data **prev_dis, guint32 *cum_bytes)
+{
+    nstime_set_zero(elapsed_time);
+    *ref = NULL;
+    *prev_dis = NULL;
+    *cum_bytes = 0;
+}
+
+/*
+ * Fields such as dns.response_in are only known once the frames they
+ * refer to have been dissected, so the index is filled on the second
+ * pass, as file.c does, and has to agree with every pass after that.
+ */
+static void
+field_index_test_later_passes(void)
+{
+    test_file_t tf;
+    field_index_t *index;
+    dfilter_t *dfcodes[NUM_FILTERS];
+    guint passed_count[NUM_FILTERS];
+    gchar *err_msg = NULL;
+    nstime_t elapsed_time;
+    const frame_data *ref, *prev_dis;
+    guint32 cum_bytes;
+    frame_data *fdata;
+    gboolean passed;
+    guint num_deps;
+    guint i, f;
+
+    test_file_open(&tf);
+
+    index = field_index_new(INDEXED_FIELDS);
+    g_assert(index != NULL);
+    for (f = 0; f < NUM_FILTERS; f++) {
+        if (!dfilter_compile(filters[f], &dfcodes[f], &err_msg))
+            g_error("Can't compile \"%s\": %s", filters[f], err_msg);
+        g_assert(field_index_can_filter(index, dfcodes[f]));
+        passed_count[f] = 0;
+    }
+
+    /* First pass: frames not yet visited aren't indexed. */
+    test_file_start_pass(&elapsed_time, &ref, &prev_dis, &cum_bytes);
+    for (i = 0; i < tf.frames->len; i++) {
+        fdata = (frame_data *)g_ptr_array_index(tf.frames, i);
+        g_assert(!fdata->visited);
+        test_file_dissect(&tf, fdata, &elapsed_time, &ref, &prev_dis, &cum_bytes);
+        epan_dissect_reset(&tf.edt);
+    }
+
+    /* Second pass: fill the index. */
+    test_file_start_pass(&elapsed_time, &ref, &prev_dis, &cum_bytes);
+    for (i = 0; i < tf.frames->len; i++) {
+        fdata = (frame_data *)g_ptr_array_index(tf.frames, i);
+        g_assert(fdata->visited);
+        field_index_prime_edt(index, &tf.edt);
+        test_file_dissect(&tf, fdata, &elapsed_time, &ref, &prev_dis, &cum_bytes);
+        field_index_add(index, fdata->num, &tf.edt);
+        epan_dissect_reset(&tf.edt);
+    }
+    g_assert_cmpuint(field_index_frame_count(index), ==, tf.frames->len);
+
+    /* Third pass: filter the dissected frames and compare. */
+    test_file_start_pass(&elapsed_time, &ref, &prev_dis, &cum_bytes);
+    for (i = 0; i < tf.frames->len; i++) {
+        fdata = (frame_data *)g_ptr_array_index(tf.frames, i);
+        for (f = 0; f < NUM_FILTERS; f++)
+            epan_dissect_prime_with_dfilter(&tf.edt, dfcodes[f]);
+        test_file_dissect(&tf, fdata, &elapsed_time, &ref, &prev_dis, &cum_bytes);
+        for (f = 0; f < NUM_FILTERS; f++) {
+            passed = dfilter_apply_edt(dfcodes[f], &tf.edt);
+            if (field_index_filter(index, dfcodes[f], fdata->num) != passed)
+                g_error("Frame %u: \"%s\" is %s with the index", fdata->num,
+                        filters[f], passed ? "FALSE" : "TRUE");
+            if (passed)
+                passed_count[f]++;
+        }
+        field_index_dependent_frames(index, fdata->num, &num_deps);
+        g_assert_cmpuint(num_deps, ==, g_slist_length(tf.edt.pi.dependent_frames));
+        epan_dissect_reset(&tf.edt);
+    }
+
+    /* Make sure the capture has requests with responses. */
+    g_assert_cmpuint(passed_count[0], >, 0);
+
+    for (f = 0; f < NUM_FILTERS; f++)
+        dfilter_free(dfcodes[f]);
+    field_index_free(index);
+    test_file_close(&tf);
+}
+
+/* Frames that haven't been dissected before aren't indexed by file.c. */
+static void
+field_index_test_first_pass(void)
+{
+    test_file_t tf;
+    field_index_t *index;
+    dfilter_t *dfcode;
+    gchar *err_msg = NULL;
+    nstime_t elapsed_time;
+    const frame_data *ref, *prev_dis;
+    guint32 cum_bytes;
+    frame_data *fdata;
+    guint first_pass_count = 0, later_count = 0;
+    guint i;
+
+    test_file_open(&tf);
+
+    index = field_index_new(INDEXED_FIELDS);
+    if (!dfilter_compile("dns.response_in", &dfcode, &err_msg))
+        g_error("Can't compile \"dns.response_in\": %s", err_msg);
+
+    /* An index filled on the first pass would miss response_in... */
+    test_file_start_pass(&elapsed_time, &ref, &prev_dis, &cum_bytes);
+    for (i = 0; i < tf.frames->len; i++) {
+        fdata = (frame_data *)g_ptr_array_index(tf.frames, i);
+        field_index_prime_edt(index, &tf.edt);
+        test_file_dissect(&tf, fdata, &elapsed_time, &ref, &prev_dis, &cum_bytes);
+        field_index_add(index, fdata->num, &tf.edt);
+        epan_dissect_reset(&tf.edt);
+        if (field_index_filter(index, dfcode, fdata->num))
+            first_pass_count++;
+    }
+
+    /* ...which the same frames have once they've been visited. */
+    field_index_clear(index);
+    test_file_start_pass(&elapsed_time, &ref, &prev_dis, &cum_bytes);
+    for (i = 0; i < tf.frames->len; i++) {
+        fdata = (frame_data *)g_ptr_array_index(tf.frames, i);
+        field_index_prime_edt(index, &tf.edt);
+        test_file_dissect(&tf, fdata, &elapsed_time, &ref, &prev_dis, &cum_bytes);
+        field_index_add(index, fdata->num, &tf.edt);
+        epan_dissect_reset(&tf.edt);
+        if (field_index_filter(index, dfcode, fdata->num))
+            later_count++;
+    }
+    g_assert_cmpuint(first_pass_count, <, later_count);
+
+    dfilter_free(dfcode);
+    field_index_free(index);
+    test_file_close(&tf);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    if (argc != 2) {
+        g_printerr("Usage: field_index_test <capture file>\n");
+        return 2;
+    }
+    capture_path = argv[1];
+
+    wtap_init(FALSE);
+    if (!epan_init(NULL, NULL, FALSE))
+        return 1;
+
+    g_test_add_func("/field_index/later_passes", field_index_test_later_passes);
+    g_test_add_func("/field_index/first_pass",   field_index_test_first_pass);
+
+    ret = g_test_run();
+
+    epan_cleanup();
+    wtap_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -56,6 +56,10 @@ typedef enum {
    Try to keep it close to, and less than or equal to, a power of 2.
    "Smaller than a power of 2" is OK for ILP32 platforms.
 
+   Information that only a few frames have, such as user comments and
+   time shift offsets, is kept by the packet provider in tables keyed
+   by frame, with a bit here saying whether the frame has an entry.
+
    XXX - shuffle the fields to try to keep the most commonly-accessed
    fields within the first 16 or 32 bytes, so they all fit in a cache
    line? */
@@ -88,8 +92,8 @@ typedef struct _frame_data {
   unsigned int has_user_comment : 1; /** 1 = user set (also deleted) comment for this packet */
   unsigned int need_colorize    : 1; /**< 1 = need to (re-)calculate packet color */
   unsigned int tsprec           : 4; /**< Time stamp precision -2^tsprec gives up to femtoseconds */
+  unsigned int has_shift_offset : 1; /**< 1 = the time stamp has been shifted */
   nstime_t     abs_ts;       /**< Absolute timestamp */
-  nstime_t     shift_offset; /**< How much the abs_tm of the frame is shifted */
   guint32      frame_ref_num; /**< Previous reference frame (0 if this is one) */
   guint32      prev_dis_num; /**< Previous displayed frame (0 if first one) */
 } frame_data;
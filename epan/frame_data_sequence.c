@@ -13,6 +13,7 @@
 #include <glib.h>
 
 #include <epan/packet.h>
+#include <epan/app_mem_usage.h>
 
 #include "frame_data_sequence.h"
 
@@ -34,6 +35,39 @@ struct _frame_data_sequence {
   void        *ptree_root;      /* Pointer to the root node */
 };
 
+/*
+ * Memory used by all the frame_data_sequences, reported through
+ * app_mem_usage.
+ */
+#define LEAF_SIZE               ((sizeof (frame_data))*NODES_PER_LEVEL)
+#define NODE_SIZE               ((sizeof (void *))*NODES_PER_LEVEL)
+
+static gsize frame_data_sequence_mem_used;
+
+static gsize
+frame_data_sequence_get_mem_used(void)
+{
+  return frame_data_sequence_mem_used;
+}
+
+static const ws_mem_usage_t frame_data_sequence_mem_usage = {
+  "Frames", frame_data_sequence_get_mem_used, NULL
+};
+
+static void *
+alloc_leaf(void)
+{
+  frame_data_sequence_mem_used += LEAF_SIZE;
+  return g_malloc(LEAF_SIZE);
+}
+
+static void *
+alloc_node(void)
+{
+  frame_data_sequence_mem_used += NODE_SIZE;
+  return g_malloc0(NODE_SIZE);
+}
+
 /*
  * For a given frame number, calculate the indices into a level 3
  * node, a level 2 node, a level 1 node, and a leaf node.
@@ -50,8 +84,14 @@ struct _frame_data_sequence {
 frame_data_sequence *
 new_frame_data_sequence(void)
 {
+  static gboolean mem_usage_registered = FALSE;
   frame_data_sequence *fds;
 
+  if (!mem_usage_registered) {
+    memory_usage_component_register(&frame_data_sequence_mem_usage);
+    mem_usage_registered = TRUE;
+  }
+
   fds = (frame_data_sequence *)g_malloc(sizeof *fds);
   fds->count = 0;
   fds->ptree_root = NULL;
@@ -80,7 +120,7 @@ frame_data_sequence_add(frame_data_sequence *fds, frame_data *fdata)
   if (fds->count == 0) {
     /* The tree is empty; allocate the first leaf node, which will be
        the root node. */
-    leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
+    leaf = (frame_data *)alloc_leaf();
     node = &leaf[0];
     fds->ptree_root = leaf;
   } else if (fds->count < NODES_PER_LEVEL) {
@@ -89,9 +129,9 @@ frame_data_sequence_add(frame_data_sequence *fds, frame_data *fdata)
     node = &leaf[fds->count];
   } else if (fds->count == NODES_PER_LEVEL) {
     /* It's a 1-level tree that will turn into a 2-level tree. */
-    level1 = (frame_data **)g_malloc0((sizeof *level1)*NODES_PER_LEVEL);
+    level1 = (frame_data **)alloc_node();
     level1[0] = (frame_data *)fds->ptree_root;
-    leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
+    leaf = (frame_data *)alloc_leaf();
     level1[1] = leaf;
     node = &leaf[0];
     fds->ptree_root = level1;
@@ -100,17 +140,17 @@ frame_data_sequence_add(frame_data_sequence *fds, frame_data *fdata)
     level1 = (frame_data **)fds->ptree_root;
     leaf = level1[fds->count >> LOG2_NODES_PER_LEVEL];
     if (leaf == NULL) {
-      leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
+      leaf = (frame_data *)alloc_leaf();
       level1[fds->count >> LOG2_NODES_PER_LEVEL] = leaf;
     }
     node = &leaf[LEAF_INDEX(fds->count)];
   } else if (fds->count == NODES_PER_LEVEL*NODES_PER_LEVEL) {
     /* It's a 2-level tree that will turn into a 3-level tree */
-    level2 = (frame_data ***)g_malloc0((sizeof *level2)*NODES_PER_LEVEL);
+    level2 = (frame_data ***)alloc_node();
     level2[0] = (frame_data **)fds->ptree_root;
-    level1 = (frame_data **)g_malloc0((sizeof *level1)*NODES_PER_LEVEL);
+    level1 = (frame_data **)alloc_node();
     level2[1] = level1;
-    leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
+    leaf = (frame_data *)alloc_leaf();
     level1[0] = leaf;
     node = &leaf[0];
     fds->ptree_root = level2;
@@ -119,24 +159,24 @@ frame_data_sequence_add(frame_data_sequence *fds, frame_data *fdata)
     level2 = (frame_data ***)fds->ptree_root;
     level1 = level2[fds->count >> (LOG2_NODES_PER_LEVEL+LOG2_NODES_PER_LEVEL)];
     if (level1 == NULL) {
-      level1 = (frame_data **)g_malloc0((sizeof *level1)*NODES_PER_LEVEL);
+      level1 = (frame_data **)alloc_node();
       level2[fds->count >> (LOG2_NODES_PER_LEVEL+LOG2_NODES_PER_LEVEL)] = level1;
     }
     leaf = level1[LEVEL_1_INDEX(fds->count)];
     if (leaf == NULL) {
-      leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
+      leaf = (frame_data *)alloc_leaf();
       level1[LEVEL_1_INDEX(fds->count)] = leaf;
     }
     node = &leaf[LEAF_INDEX(fds->count)];
   } else if (fds->count == NODES_PER_LEVEL*NODES_PER_LEVEL*NODES_PER_LEVEL) {
     /* It's a 3-level tree that will turn into a 4-level tree */
-    level3 = (frame_data ****)g_malloc0((sizeof *level3)*NODES_PER_LEVEL);
+    level3 = (frame_data ****)alloc_node();
     level3[0] = (frame_data ***)fds->ptree_root;
-    level2 = (frame_data ***)g_malloc0((sizeof *level2)*NODES_PER_LEVEL);
+    level2 = (frame_data ***)alloc_node();
     level3[1] = level2;
-    level1 = (frame_data **)g_malloc0((sizeof *level1)*NODES_PER_LEVEL);
+    level1 = (frame_data **)alloc_node();
     level2[0] = level1;
-    leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
+    leaf = (frame_data *)alloc_leaf();
     level1[0] = leaf;
     node = &leaf[0];
     fds->ptree_root = level3;
@@ -152,17 +192,17 @@ frame_data_sequence_add(frame_data_sequence *fds, frame_data *fdata)
     level3 = (frame_data ****)fds->ptree_root;
     level2 = level3[LEVEL_3_INDEX(fds->count)];
     if (level2 == NULL) {
-      level2 = (frame_data ***)g_malloc0((sizeof *level2)*NODES_PER_LEVEL);
+      level2 = (frame_data ***)alloc_node();
       level3[LEVEL_3_INDEX(fds->count)] = level2;
     }
     level1 = level2[LEVEL_2_INDEX(fds->count)];
     if (level1 == NULL) {
-      level1 = (frame_data **)g_malloc0((sizeof *level1)*NODES_PER_LEVEL);
+      level1 = (frame_data **)alloc_node();
       level2[LEVEL_2_INDEX(fds->count)] = level1;
     }
     leaf = level1[LEVEL_1_INDEX(fds->count)];
     if (leaf == NULL) {
-      leaf = (frame_data *)g_malloc((sizeof *leaf)*NODES_PER_LEVEL);
+      leaf = (frame_data *)alloc_leaf();
       level1[LEVEL_1_INDEX(fds->count)] = leaf;
     }
     node = &leaf[LEAF_INDEX(fds->count)];
@@ -270,6 +310,7 @@ free_frame_data_array(void *array, guint count, guint level, gboolean last)
   }
 
   /* free the array itself */
+  frame_data_sequence_mem_used -= (level > 1) ? NODE_SIZE : LEAF_SIZE;
   g_free(array);
 }
 
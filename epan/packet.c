@@ -755,6 +755,17 @@ call_dissector_work(dissector_handle_t handle, tvbuff_t *tvb, packet_info *pinfo
 		return 0;
 	}
 
+	if (pinfo->dissect_protocols != NULL && handle->protocol != NULL &&
+	    !g_hash_table_contains(pinfo->dissect_protocols,
+	        GINT_TO_POINTER(proto_get_id(handle->protocol)))) {
+		/*
+		 * Neither this protocol nor anything it leads to is
+		 * wanted; claim the data so that the caller doesn't go
+		 * on to try other dissectors for it.
+		 */
+		return tvb_captured_length(tvb);
+	}
+
 	saved_proto = pinfo->current_proto;
 	saved_can_desegment = pinfo->can_desegment;
 	saved_layers_len = wmem_list_count(pinfo->layers);
@@ -2789,6 +2800,19 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 			continue;
 		}
 
+		if (pinfo->dissect_protocols != NULL && hdtbl_entry->protocol != NULL &&
+			!g_hash_table_contains(pinfo->dissect_protocols,
+			    GINT_TO_POINTER(proto_get_id(hdtbl_entry->protocol)))) {
+			/*
+			 * Nothing the filter wants can be found under this
+			 * protocol, so treat it as if it were disabled.
+			 * Unlike a dissector called through a handle, we
+			 * can't claim the data for it without knowing
+			 * whether it would have accepted it.
+			 */
+			continue;
+		}
+
 		if (hdtbl_entry->protocol != NULL) {
 			proto_id = proto_get_id(hdtbl_entry->protocol);
 			/* do NOT change this behavior - wslua uses the protocol short name set here in order
@@ -3366,6 +3390,56 @@ depend_dissector_list_t find_depend_dissector_list(const char* name)
 	return (depend_dissector_list_t)g_hash_table_lookup(depend_dissector_lists, name);
 }
 
+typedef struct {
+	GHashTable *protos;
+	gboolean    changed;
+} leading_to_data_t;
+
+/* Adds parent to the set if one of its dependents is in it. */
+static void
+add_parent_leading_to(gpointer key, gpointer value, gpointer user_data)
+{
+	const char              *parent         = (const char *)key;
+	depend_dissector_list_t  sub_dissectors = (depend_dissector_list_t)value;
+	leading_to_data_t       *data           = (leading_to_data_t *)user_data;
+	GSList                  *entry;
+	int                      parent_id, proto_id;
+
+	parent_id = proto_get_id_by_short_name(parent);
+	if (parent_id == -1 || g_hash_table_contains(data->protos, GINT_TO_POINTER(parent_id)))
+		return;
+
+	for (entry = sub_dissectors->dissectors; entry; entry = g_slist_next(entry)) {
+		proto_id = proto_get_id_by_short_name((const char *)entry->data);
+		if (proto_id != -1 && g_hash_table_contains(data->protos, GINT_TO_POINTER(proto_id))) {
+			g_hash_table_add(data->protos, GINT_TO_POINTER(parent_id));
+			data->changed = TRUE;
+			return;
+		}
+	}
+}
+
+GHashTable *
+dissector_protocols_leading_to(const int *proto_ids, int num_protos)
+{
+	leading_to_data_t data;
+	int i;
+
+	data.protos = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for (i = 0; i < num_protos; i++) {
+		g_hash_table_add(data.protos, GINT_TO_POINTER(proto_ids[i]));
+	}
+
+	/* Walk the dependencies backwards until nothing is added; the depth
+	 * of the protocol graph bounds the number of passes. */
+	do {
+		data.changed = FALSE;
+		g_hash_table_foreach(depend_dissector_lists, add_parent_leading_to, &data);
+	} while (data.changed);
+
+	return data.protos;
+}
+
 /*
  * Dumps the "layer type"/"decode as" associations to stdout, similar
  * to the proto_registrar_dump_*() routines.
@@ -648,6 +648,19 @@ WS_DLL_PUBLIC gboolean deregister_depend_dissector(const char* parent, const cha
  */
 WS_DLL_PUBLIC depend_dissector_list_t find_depend_dissector_list(const char* name);
 
+/** Find the protocols whose dissectors have to run for any of the given
+ * protocols to be dissected, following the dependencies registered
+ * through dissector tables, heuristic tables and
+ * find_dissector_add_dependency(). Dissectors that call others without
+ * registering the dependency aren't accounted for.
+ *
+ *   @param proto_ids the protocols that are wanted
+ *   @param num_protos number of entries in proto_ids
+ *   @return set of protocol ids, including proto_ids; free it with
+ *   g_hash_table_destroy()
+ */
+WS_DLL_PUBLIC GHashTable *dissector_protocols_leading_to(const int *proto_ids, int num_protos);
+
 
 /* Do all one-time initialization. */
 extern void dissect_init(void);
@@ -150,6 +150,7 @@ typedef struct _packet_info {
   wmem_allocator_t *pool;      /**< Memory pool scoped to the pinfo struct */
   struct epan_session *epan;
   const gchar *heur_list_name;    /**< name of heur list if this packet is being heuristically dissected */
+  GHashTable *dissect_protocols;  /**< if set, only the dissectors of these protocols are called */
 } packet_info;
 
 /** @} */
@@ -3342,6 +3342,22 @@ prefs_register_modules(void)
                                    10,
                                    &prefs.gui_max_export_objects);
 
+    prefs_register_uint_preference(gui_module, "filter_workers",
+                                   "Display filter worker processes",
+                                   "When a display filter is applied to a capture file that has been read in"
+                                   " full, split the filtering across this many worker processes, started by"
+                                   " a TShark helper that reads the file along with Wireshark (not available"
+                                   " on Windows); 0 or 1 filters the packets in the main process",
+                                   10,
+                                   &prefs.gui_filter_workers);
+
+    register_string_like_preference(gui_module, "field_index", "Indexed fields",
+        "Comma-separated list of fields and protocols whose values are recorded for each packet"
+        " as a capture file is read, so that display filters that only test those fields can be"
+        " applied without dissecting the packets again, e.g."
+        " \"frame.len,ip.addr,ip.src,ip.dst,tcp.port,tcp.srcport,tcp.dstport,udp.port,udp.srcport,udp.dstport,ip,tcp,udp,dns\"",
+        &prefs.gui_field_index, PREF_STRING, NULL, TRUE);
+
 
     /* User Interface : Layout */
     gui_layout_module = prefs_register_subtree(gui_module, "Layout", "Layout", gui_layout_callback);
@@ -3680,6 +3696,23 @@ prefs_register_modules(void)
                                    "Currently only ICMP and ICMPv6 use this preference to add VLAN ID to conversation tracking",
                                    &prefs.strict_conversation_tracking_heuristics);
 
+    prefs_register_uint_preference(protocols_module, "reassembly_max_pending_mb",
+                                   "Maximum unfinished reassembly data (MB)",
+                                   "The most fragment data, in megabytes, that each reassembly table "
+                                   "keeps for reassemblies that are still waiting for fragments. "
+                                   "When there is more, the reassemblies that have waited longest "
+                                   "are discarded. 0 means no limit.",
+                                   10,
+                                   &prefs.reassembly_max_pending_mb);
+
+    prefs_register_uint_preference(protocols_module, "reassembly_max_age",
+                                   "Maximum unfinished reassembly age (frames)",
+                                   "Discard reassemblies that have had no fragments added to them "
+                                   "for this many frames. 0 means they are kept until the end of "
+                                   "the capture.",
+                                   10,
+                                   &prefs.reassembly_max_age);
+
     /* Obsolete preferences
      * These "modules" were reorganized/renamed to correspond to their GUI
      * configuration screen within the preferences dialog
@@ -4137,6 +4170,9 @@ pre_init_prefs(void)
     prefs.gui_qt_show_selected_packet = FALSE;
     prefs.gui_qt_show_file_load_time = FALSE;
     prefs.gui_max_export_objects     = 1000;
+    prefs.gui_filter_workers         = 0;
+    g_free(prefs.gui_field_index);
+    prefs.gui_field_index            = g_strdup("");
 
     if (prefs.col_list) {
         free_col_info(prefs.col_list);
@@ -4191,6 +4227,8 @@ pre_init_prefs(void)
     prefs.st_sort_showfullname = FALSE;
     prefs.display_hidden_proto_items = FALSE;
     prefs.display_byte_fields_with_spaces = FALSE;
+    prefs.reassembly_max_pending_mb = 0;
+    prefs.reassembly_max_age = 0;
 }
 
 /*
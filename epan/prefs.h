@@ -172,6 +172,8 @@ typedef struct _e_prefs {
   gchar       *gui_start_title;
   version_info_e gui_version_placement;
   guint        gui_max_export_objects;
+  guint        gui_filter_workers;
+  gchar       *gui_field_index;
   layout_type_e gui_layout_type;
   layout_pane_content_e gui_layout_content_1;
   layout_pane_content_e gui_layout_content_2;
@@ -203,6 +205,8 @@ typedef struct _e_prefs {
   gboolean     enable_incomplete_dissectors_check;
   gboolean     incomplete_dissectors_check_debug;
   gboolean     strict_conversation_tracking_heuristics;
+  guint        reassembly_max_pending_mb;
+  guint        reassembly_max_age;
   gboolean     filter_expressions_old;  /* TRUE if old filter expressions preferences were loaded. */
   gboolean     gui_update_enabled;
   software_update_channel_e gui_update_channel;
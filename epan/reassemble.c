@@ -14,8 +14,10 @@
 
 #include <epan/packet.h>
 #include <epan/exceptions.h>
+#include <epan/prefs.h>
 #include <epan/reassemble.h>
 #include <epan/tvbuff-int.h>
+#include <epan/wmem/wmem.h>
 
 #include <wsutil/str_util.h>
 
@@ -315,6 +317,119 @@ reassembled_key_free(gpointer ptr)
 	g_slice_free(reassembled_key, (reassembled_key *)ptr);
 }
 
+/*
+ * Index of the fragments of a reassembly by byte offset.
+ *
+ * Dissectors walk the list of fragments, so it's still kept sorted;
+ * the index finds where in the list a new fragment goes, and keeps
+ * track of how much data, from offset 0, the fragments cover without
+ * a gap, so that adding a fragment doesn't have to walk the list.
+ */
+typedef struct _fragment_offset_index {
+	wmem_tree_t *by_offset;		/* offset -> last fragment in the list with that offset */
+	guint32 contiguous;		/* end of the data covered without a gap */
+} fragment_offset_index;
+
+/*
+ * Extend the contiguous data with fd_i and the fragments after it that
+ * start within it.
+ */
+static void
+fragment_offset_index_extend(fragment_offset_index *fd_index, fragment_item *fd_i)
+{
+	for (; fd_i && fd_i->offset <= fd_index->contiguous; fd_i = fd_i->next) {
+		if (fd_i->offset + fd_i->len > fd_index->contiguous)
+			fd_index->contiguous = fd_i->offset + fd_i->len;
+	}
+}
+
+/*
+ * Get the index of a reassembly by byte offset, building it from the
+ * list of fragments if it doesn't exist yet.
+ */
+static fragment_offset_index *
+fragment_get_offset_index(fragment_head *fd_head)
+{
+	fragment_offset_index *fd_index = fd_head->offset_index;
+	fragment_item *fd_i;
+
+	if (fd_index == NULL) {
+		fd_index = g_slice_new(fragment_offset_index);
+		fd_index->by_offset = wmem_tree_new(NULL);
+		fd_index->contiguous = 0;
+		for (fd_i = fd_head->next; fd_i; fd_i = fd_i->next)
+			wmem_tree_insert32(fd_index->by_offset, fd_i->offset, fd_i);
+		fragment_offset_index_extend(fd_index, fd_head->next);
+		fd_head->offset_index = fd_index;
+	}
+	return fd_index;
+}
+
+static void
+fragment_free_offset_index(fragment_head *fd_head)
+{
+	if (fd_head->offset_index != NULL) {
+		wmem_tree_destroy(fd_head->offset_index->by_offset, FALSE, FALSE);
+		g_slice_free(fragment_offset_index, fd_head->offset_index);
+		fd_head->offset_index = NULL;
+	}
+}
+
+/*
+ * Add a fragment to the list of a reassembly by byte offset, after any
+ * fragments with the same offset, as LINK_FRAG() would.
+ */
+static void
+fragment_link_by_offset(fragment_head *fd_head, fragment_item *fd)
+{
+	fragment_offset_index *fd_index = fragment_get_offset_index(fd_head);
+	fragment_item *fd_prev;
+	guint32 old_contiguous;
+
+	fd_prev = (fragment_item *)wmem_tree_lookup32_le(fd_index->by_offset, fd->offset);
+	if (fd_prev == NULL)
+		fd_prev = fd_head;
+	fd->next = fd_prev->next;
+	fd_prev->next = fd;
+	wmem_tree_insert32(fd_index->by_offset, fd->offset, fd);
+
+	if (fd->offset <= fd_index->contiguous) {
+		/*
+		 * The fragments that start within the old contiguous data
+		 * are already part of it, so only the new fragment and
+		 * the ones that start after the old end need looking at.
+		 */
+		old_contiguous = fd_index->contiguous;
+		if (fd->offset + fd->len > fd_index->contiguous)
+			fd_index->contiguous = fd->offset + fd->len;
+		fd_prev = (fragment_item *)wmem_tree_lookup32_le(fd_index->by_offset, old_contiguous);
+		fragment_offset_index_extend(fd_index, fd_prev->next);
+	}
+}
+
+/*
+ * Has a fragment with this offset been added to a reassembly by byte
+ * offset in this frame?
+ */
+static gboolean
+fragment_offset_already_added(fragment_head *fd_head, const guint32 frame,
+			      const guint32 frag_offset)
+{
+	fragment_offset_index *fd_index = fragment_get_offset_index(fd_head);
+	fragment_item *fd_i = NULL;
+
+	/* Find the first fragment with this offset. */
+	if (frag_offset != 0)
+		fd_i = (fragment_item *)wmem_tree_lookup32_le(fd_index->by_offset, frag_offset - 1);
+	fd_i = fd_i ? fd_i->next : fd_head->next;
+
+	for (; fd_i && fd_i->offset == frag_offset; fd_i = fd_i->next) {
+		if (fd_i->frame == frame)
+			return TRUE;
+	}
+	return FALSE;
+}
+
 /*
  * For a fragment hash table entry, free the associated fragments.
  * The entry value (fd_chain) is freed herein and the entry is freed
@@ -330,6 +445,7 @@ free_all_fragments(gpointer key_arg _U_, gpointer value, gpointer user_data _U_)
 	/* g_hash_table_new_full() was used to supply a function
 	 * to free the key and anything to which it points
 	 */
+	fragment_free_offset_index((fragment_head *)value);
 	for (fd_head = (fragment_head *)value; fd_head != NULL; fd_head = tmp_fd) {
 		tmp_fd=fd_head->next;
 
@@ -392,11 +508,152 @@ free_fragments(gpointer data, gpointer user_data _U_)
 {
 	fragment_item *fd_head = (fragment_item *) data;
 
+	fragment_free_offset_index(fd_head);
 	if (fd_head->tvb_data)
 		tvb_free(fd_head->tvb_data);
 	g_slice_free(fragment_item, fd_head);
 }
 
+/*
+ * Reassemblies in progress, in the order in which fragments were last
+ * added to them, so that the ones that have waited longest for their
+ * remaining fragments can be discarded when the table holds more
+ * fragment data than the "protocols.reassembly_max_pending_mb"
+ * preference allows, or when no fragment has been added to them for
+ * more than "protocols.reassembly_max_age" frames.
+ *
+ * Only fragment data added while a reassembly is in progress is
+ * counted; a completed reassembly that's extended with
+ * FD_PARTIAL_REASSEMBLY isn't tracked again.
+ */
+typedef struct {
+	gpointer key;			/* the fragment table's key for the reassembly */
+	fragment_head *fd_head;
+	guint32 last_frame;		/* frame in which a fragment was last added */
+	guint32 bytes;			/* fragment data added so far */
+} pending_reassembly;
+
+static void
+pending_reassembly_add(reassembly_table *table, gpointer key,
+		       fragment_head *fd_head, const packet_info *pinfo)
+{
+	pending_reassembly *pending;
+
+	pending = g_slice_new(pending_reassembly);
+	pending->key = key;
+	pending->fd_head = fd_head;
+	pending->last_frame = pinfo->num;
+	pending->bytes = 0;
+	g_queue_push_tail(table->pending_queue, pending);
+	g_hash_table_insert(table->pending_heads, fd_head,
+			    g_queue_peek_tail_link(table->pending_queue));
+	table->stats.pending_reassemblies++;
+}
+
+static void
+pending_reassembly_remove(reassembly_table *table, fragment_head *fd_head)
+{
+	GList *link;
+	pending_reassembly *pending;
+
+	link = (GList *)g_hash_table_lookup(table->pending_heads, fd_head);
+	if (link == NULL)
+		return;
+	pending = (pending_reassembly *)link->data;
+	table->stats.pending_reassemblies--;
+	table->stats.pending_bytes -= pending->bytes;
+	g_hash_table_remove(table->pending_heads, fd_head);
+	g_queue_delete_link(table->pending_queue, link);
+	g_slice_free(pending_reassembly, pending);
+}
+
+static void
+pending_reassembly_free(gpointer data, gpointer user_data _U_)
+{
+	g_slice_free(pending_reassembly, (pending_reassembly *)data);
+}
+
+/*
+ * Forget all the reassemblies in progress and reset the statistics;
+ * the reassemblies themselves are freed by the caller.
+ */
+static void
+pending_reassemblies_clear(reassembly_table *table)
+{
+	if (table->pending_queue != NULL) {
+		g_queue_foreach(table->pending_queue, pending_reassembly_free, NULL);
+		g_queue_clear(table->pending_queue);
+		g_hash_table_remove_all(table->pending_heads);
+	}
+	memset(&table->stats, 0, sizeof(table->stats));
+}
+
+/*
+ * Discard a reassembly in progress, fragments and all.
+ */
+static void
+pending_reassembly_evict(reassembly_table *table, pending_reassembly *pending)
+{
+	fragment_head *fd_head = pending->fd_head;
+	gpointer key = pending->key;
+	guint32 bytes = pending->bytes;
+
+	pending_reassembly_remove(table, fd_head);
+
+	/*
+	 * A reassembly that was completed, but whose completion threw
+	 * an exception before it was removed from the queue, has to be
+	 * kept for later passes.
+	 */
+	if (fd_head->flags & FD_DEFRAGMENTED)
+		return;
+
+	table->stats.evicted_reassemblies++;
+	table->stats.evicted_bytes += bytes;
+	g_hash_table_remove(table->fragment_table, key);
+	free_all_fragments(NULL, fd_head, NULL);
+}
+
+/*
+ * Note that a fragment with frag_data_len bytes of data has been added
+ * to a reassembly that isn't complete yet, and discard the reassemblies
+ * in progress that the limits no longer leave room for.  The reassembly
+ * that was added to is never discarded.  Fragments that were rejected,
+ * or that completed the reassembly, aren't counted.
+ */
+static void
+pending_reassembly_update(reassembly_table *table, fragment_head *fd_head,
+			  const packet_info *pinfo, const guint32 frag_data_len)
+{
+	guint64 max_bytes = (guint64)prefs.reassembly_max_pending_mb * 1024 * 1024;
+	guint32 max_age = prefs.reassembly_max_age;
+	GList *link;
+	pending_reassembly *pending;
+
+	link = (GList *)g_hash_table_lookup(table->pending_heads, fd_head);
+	if (link == NULL)
+		return;
+	pending = (pending_reassembly *)link->data;
+	pending->last_frame = pinfo->num;
+	pending->bytes += frag_data_len;
+	table->stats.pending_bytes += frag_data_len;
+	g_queue_unlink(table->pending_queue, link);
+	g_queue_push_tail_link(table->pending_queue, link);
+
+	if (max_bytes == 0 && max_age == 0)
+		return;
+
+	while ((link = g_queue_peek_head_link(table->pending_queue)) != NULL) {
+		pending = (pending_reassembly *)link->data;
+		if (pending->fd_head == fd_head)
+			break;
+		if (!(max_bytes != 0 && table->stats.pending_bytes > max_bytes) &&
+		    !(max_age != 0 && pinfo->num - pending->last_frame > max_age))
+			break;
+		pending_reassembly_evict(table, pending);
+	}
+}
+
 typedef struct register_reassembly_table {
 	reassembly_table *table;
 	const reassembly_table_functions *funcs;
@@ -435,6 +692,11 @@ reassembly_table_init(reassembly_table *table,
 		table->persistent_key_func = funcs->persistent_key_func;
 	if (table->free_temporary_key_func == NULL)
 		table->free_temporary_key_func = funcs->free_temporary_key_func;
+	if (table->pending_queue == NULL) {
+		table->pending_queue = g_queue_new();
+		table->pending_heads = g_hash_table_new(g_direct_hash, g_direct_equal);
+	}
+	pending_reassemblies_clear(table);
 	if (table->fragment_table != NULL) {
 		/*
 		 * The fragment hash table exists.
@@ -488,6 +750,13 @@ reassembly_table_destroy(reassembly_table *table)
 	table->temporary_key_func = NULL;
 	table->persistent_key_func = NULL;
 	table->free_temporary_key_func = NULL;
+	pending_reassemblies_clear(table);
+	if (table->pending_queue != NULL) {
+		g_queue_free(table->pending_queue);
+		table->pending_queue = NULL;
+		g_hash_table_destroy(table->pending_heads);
+		table->pending_heads = NULL;
+	}
 	if (table->fragment_table != NULL) {
 		/*
 		 * The fragment hash table exists.
@@ -532,6 +801,38 @@ reassembly_table_destroy(reassembly_table *table)
 	}
 }
 
+/*
+ * Get the statistics for one reassembly table.
+ */
+void
+reassembly_table_get_stats(const reassembly_table *table,
+			   reassembly_stats *stats)
+{
+	*stats = table->stats;
+}
+
+static void
+reassembly_table_add_stats(gpointer p, gpointer user_data)
+{
+	register_reassembly_table_t* reg_table = (register_reassembly_table_t*)p;
+	reassembly_stats *stats = (reassembly_stats *)user_data;
+
+	stats->pending_reassemblies += reg_table->table->stats.pending_reassemblies;
+	stats->pending_bytes += reg_table->table->stats.pending_bytes;
+	stats->evicted_reassemblies += reg_table->table->stats.evicted_reassemblies;
+	stats->evicted_bytes += reg_table->table->stats.evicted_bytes;
+}
+
+/*
+ * Get the sum of the statistics for all registered reassembly tables.
+ */
+void
+reassembly_tables_get_stats(reassembly_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	g_list_foreach(reassembly_table_list, reassembly_table_add_stats, stats);
+}
+
 /*
  * Look up an fd_head in the fragment table, optionally returning the key
  * for it.
@@ -573,6 +874,7 @@ insert_fd_head(reassembly_table *table, fragment_head *fd_head,
 	 */
 	key = table->persistent_key_func(pinfo, id, data);
 	g_hash_table_insert(table->fragment_table, key, fd_head);
+	pending_reassembly_add(table, key, fd_head, pinfo);
 	return key;
 }
 
@@ -603,6 +905,9 @@ fragment_delete(reassembly_table *table, const packet_info *pinfo,
 		return NULL;
 	}
 
+	pending_reassembly_remove(table, fd_head);
+	fragment_free_offset_index(fd_head);
+
 	fd_tvb_data=fd_head->tvb_data;
 	/* loop over all partial fragments and free any tvbuffs */
 	for(fd=fd_head->next;fd;){
@@ -857,6 +1162,8 @@ fragment_unhash(reassembly_table *table, gpointer key)
 	/*
 	 * Remove the entry from the fragment table.
 	 */
+	pending_reassembly_remove(table,
+	    (fragment_head *)g_hash_table_lookup(table->fragment_table, key));
 	g_hash_table_remove(table->fragment_table, key);
 }
 
@@ -894,6 +1201,8 @@ fragment_reassembled(reassembly_table *table, fragment_head *fd_head,
 				fd_head);
 		}
 	}
+	/* No more fragments will be added, so the index isn't needed. */
+	fragment_free_offset_index(fd_head);
 	fd_head->flags |= FD_DEFRAGMENTED;
 	fd_head->reassembled_in = pinfo->num;
 	fd_head->reas_in_layer_num = pinfo->curr_layer_num;
@@ -1010,6 +1319,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	fd->len  = frag_data_len;
 	fd->tvb_data = NULL;
 	fd->error = NULL;
+	fd->offset_index = NULL;
 
 	/*
 	 * Are we adding to an already-completed reassembly?
@@ -1127,7 +1437,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 			fd_head->flags |= FD_OVERLAPCONFLICT;
 		}
 		/* it was just an overlap, link it and return */
-		LINK_FRAG(fd_head,fd);
+		fragment_link_by_offset(fd_head,fd);
 		return TRUE;
 	}
 
@@ -1141,7 +1451,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 		THROW(BoundsError);
 	}
 	fd->tvb_data = tvb_clone_offset_len(tvb, offset, fd->len);
-	LINK_FRAG(fd_head,fd);
+	fragment_link_by_offset(fd_head,fd);
 
 
 	if( !(fd_head->flags & FD_DATALEN_SET) ){
@@ -1154,21 +1464,14 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 
 	/*
 	 * Check if we have received the entire fragment.
-	 * This is easy since the list is sorted and the head is faked.
 	 *
-	 * First, we compute the amount of contiguous data that's
-	 * available.  (The check for fd_i->offset <= max rules out
-	 * fragments that don't start before or at the end of the
-	 * previous fragment, i.e. fragments that have a gap between
-	 * them and the previous fragment.)
+	 * First, we get the amount of contiguous data that's
+	 * available, which the index keeps track of as fragments
+	 * are added.  (Fragments that don't start before or at the
+	 * end of the previous fragment, i.e. fragments that have a
+	 * gap between them and the previous fragment, don't count.)
 	 */
-	max = 0;
-	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
-		if ( ((fd_i->offset)<=max) &&
-			((fd_i->offset+fd_i->len)>max) ){
-			max = fd_i->offset+fd_i->len;
-		}
-	}
+	max = fragment_get_offset_index(fd_head)->contiguous;
 
 	if (max < (fd_head->datalen)) {
 		/*
@@ -1192,7 +1495,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	for (dfpos=0,fd_i=fd_head;fd_i;fd_i=fd_i->next) {
 		if (fd_i->len) {
 			/*
-			 * The loop above that calculates max also
+			 * The contiguous data check above also
 			 * ensures that the only gaps that exist here
 			 * are ones where a fragment starts past the
 			 * end of the reassembled datagram, and there's
@@ -1234,7 +1537,7 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 					 * already rejected fragments that
 					 * start past the end of the
 					 * reassembled datagram, and
-					 * the loop that calculated max
+					 * the contiguous data check
 					 * should have ruled out gaps,
 					 * but could fd_i->offset +
 					 * fd_i->len overflow?
@@ -1330,7 +1633,6 @@ fragment_add_common(reassembly_table *table, tvbuff_t *tvb, const int offset,
 		    const gboolean check_already_added)
 {
 	fragment_head *fd_head;
-	fragment_item *fd_item;
 	gboolean already_added;
 
 
@@ -1352,6 +1654,7 @@ fragment_add_common(reassembly_table *table, tvbuff_t *tvb, const int offset,
 		printf("proto:%s num:%u id:%u offset:%u len:%u more:%u visited:%u\n",
 			pinfo->current_proto, pinfo->num, id, frag_offset, frag_data_len, more_frags, pinfo->fd->visited);
 		if(fd_head != NULL) {
+			fragment_item *fd_item;
 			for(fd_item=fd_head->next;fd_item;fd_item=fd_item->next){
 				printf("fd_frame:%u fd_offset:%u len:%u datalen:%u\n",
 					fd_item->frame, fd_item->offset, fd_item->len, fd_item->datalen);
@@ -1386,21 +1689,8 @@ fragment_add_common(reassembly_table *table, tvbuff_t *tvb, const int offset,
 			 * frame, we know it hasn't been added yet.
 			 */
 			if (pinfo->num <= fd_head->frame) {
-				already_added = FALSE;
-				/*
-				 * The first item in the reassembly list
-				 * is not a fragment, it's a data structure
-				 * for the reassembled packet, so we
-				 * start checking with the next item.
-				 */
-				for (fd_item = fd_head->next; fd_item;
-				    fd_item = fd_item->next) {
-					if (pinfo->num == fd_item->frame &&
-					    frag_offset == fd_item->offset) {
-						already_added = TRUE;
-						break;
-					}
-				}
+				already_added = fragment_offset_already_added(
+				    fd_head, pinfo->num, frag_offset);
 				if (already_added) {
 					/*
 					 * Have we already finished
@@ -1503,11 +1793,13 @@ fragment_add_common(reassembly_table *table, tvbuff_t *tvb, const int offset,
 		/*
 		 * Reassembly is complete.
 		 */
+		pending_reassembly_remove(table, fd_head);
 		return fd_head;
 	} else {
 		/*
 		 * Reassembly isn't complete.
 		 */
+		pending_reassembly_update(table, fd_head, pinfo, frag_data_len);
 		return NULL;
 	}
 }
@@ -1605,6 +1897,7 @@ fragment_add_check(reassembly_table *table, tvbuff_t *tvb, const int offset,
 		/*
 		 * Reassembly isn't complete.
 		 */
+		pending_reassembly_update(table, fd_head, pinfo, frag_data_len);
 		return NULL;
 	}
 }
@@ -1741,6 +2034,7 @@ fragment_add_seq_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	fd->len  = frag_data_len;
 	fd->tvb_data = NULL;
 	fd->error = NULL;
+	fd->offset_index = NULL;
 
 	/* fd_head->frame is the maximum of the frame numbers of all the
 	 * fragments added to the reassembly. */
@@ -2019,11 +2313,15 @@ fragment_add_seq_common(reassembly_table *table, tvbuff_t *tvb,
 		/*
 		 * Reassembly is complete.
 		 */
+		pending_reassembly_remove(table, fd_head);
 		return fd_head;
 	} else {
 		/*
-		 * Reassembly isn't complete.
+		 * Reassembly isn't complete.  A fragment cut short by
+		 * the snapshot length wasn't added to it.
 		 */
+		if (frag_data_len == 0 || tvb_bytes_exist(tvb, offset, frag_data_len))
+			pending_reassembly_update(table, fd_head, pinfo, frag_data_len);
 		return NULL;
 	}
 }
@@ -2498,6 +2796,7 @@ fragment_start_seq_check(reassembly_table *table, const packet_info *pinfo,
 		fd_head->flags = FD_BLOCKSEQUENCE|FD_DATALEN_SET;
 		fd_head->tvb_data = NULL;
 		fd_head->error = NULL;
+		fd_head->offset_index = NULL;
 
 		insert_fd_head(table, fd_head, pinfo, id, data);
 	}
@@ -83,6 +83,12 @@ typedef struct _fragment_item {
 	 * reassembly and for the fragments in a reassembly.
 	 */
 	const char *error;
+	/**
+	 * In the head of a reassembly by byte offset, an index of the
+	 * fragments by offset, so that adding a fragment doesn't walk
+	 * the whole list; NULL otherwise.  Private to reassemble.c.
+	 */
+	struct _fragment_offset_index *offset_index;
 } fragment_item, fragment_head;
 
 
@@ -121,6 +127,19 @@ typedef gpointer (*fragment_temporary_key)(const packet_info *pinfo,
 typedef gpointer (*fragment_persistent_key)(const packet_info *pinfo,
     const guint32 id, const void *data);
 
+/*
+ * Statistics for reassemblies that are in progress, and for those that
+ * were discarded unfinished because of the "protocols.reassembly_max_pending_mb"
+ * and "protocols.reassembly_max_age" preferences.  The counts start
+ * again from zero when a reassembly table is initialized.
+ */
+typedef struct {
+	guint   pending_reassemblies;	/* reassemblies in progress */
+	guint64 pending_bytes;		/* fragment data held by them */
+	guint64 evicted_reassemblies;	/* reassemblies discarded unfinished */
+	guint64 evicted_bytes;		/* fragment data held by those */
+} reassembly_stats;
+
 /*
  * Data structure to keep track of fragments and reassemblies.
  */
@@ -130,6 +149,14 @@ typedef struct {
 	fragment_temporary_key temporary_key_func;
 	fragment_persistent_key persistent_key_func;
 	GDestroyNotify free_temporary_key_func;		/* temporary key destruction function */
+	/*
+	 * Reassemblies in progress, least recently added to first,
+	 * and a map from their heads to their links in that queue.
+	 * Private to reassemble.c.
+	 */
+	GQueue *pending_queue;
+	GHashTable *pending_heads;
+	reassembly_stats stats;
 } reassembly_table;
 
 /*
@@ -175,6 +202,16 @@ reassembly_table_init(reassembly_table *table,
 WS_DLL_PUBLIC void
 reassembly_table_destroy(reassembly_table *table);
 
+/*
+ * Get the statistics for one reassembly table, or the sum of the
+ * statistics for all registered tables.
+ */
+WS_DLL_PUBLIC void
+reassembly_table_get_stats(const reassembly_table *table,
+			   reassembly_stats *stats);
+WS_DLL_PUBLIC void
+reassembly_tables_get_stats(reassembly_stats *stats);
+
 /*
  * This function adds a new fragment to the reassembly table
  * If this is the first fragment seen for this datagram, a new entry
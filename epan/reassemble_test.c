@@ -2,7 +2,7 @@
  * Standalone program to test functionality of reassemble.h API
  *
  * These aren't particularly complete - they just test a few corners of
- * functionality which I was interested in. In particular, they only test the
+ * functionality which I was interested in. In particular, they mostly test the
  * fragment_add_seq_* (ie, FD_BLOCKSEQUENCE) family of routines. However,
  * hopefully they will inspire people to write additional tests, and provide a
  * useful basis on which to do so.
@@ -44,6 +44,7 @@
 
 #include <epan/packet.h>
 #include <epan/packet_info.h>
+#include <epan/prefs.h>
 #include <epan/proto.h>
 #include <epan/tvbuff.h>
 #include <epan/reassemble.h>
@@ -1511,6 +1512,192 @@ test_missing_data_fragment_add_seq_next_3(void)
 #endif
 
 
+/**********************************************************************************
+ *
+ * fragment_add
+ *
+ *********************************************************************************/
+
+/* Adds the fragments of a datagram by byte offset in reverse order, plus a
+ * duplicate of one of them, and checks that the fragment list is kept
+ * sorted and that the datagram is reassembled when the gap at its start
+ * is filled.
+ */
+static void
+test_fragment_add_reverse_order(void)
+{
+    fragment_head *fd_head;
+    fragment_item *fd;
+    guint32 frag_offset, prev_offset, n_frags;
+
+    printf("Starting test test_fragment_add_reverse_order\n");
+
+    /* ten fragments of 20 bytes, the last one first */
+    for (frag_offset = 180, pinfo.num = 1; frag_offset > 0; frag_offset -= 20, pinfo.num++) {
+        fd_head = fragment_add(&test_reassembly_table, tvb, frag_offset, &pinfo, 12, NULL,
+                               frag_offset, 20, frag_offset != 180);
+        ASSERT_EQ_POINTER(NULL,fd_head);
+    }
+
+    /* a duplicate of the fragment at offset 100 */
+    pinfo.num = 10;
+    fd_head = fragment_add(&test_reassembly_table, tvb, 100, &pinfo, 12, NULL,
+                           100, 20, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    /* the first fragment completes it */
+    pinfo.num = 11;
+    fd_head = fragment_add(&test_reassembly_table, tvb, 0, &pinfo, 12, NULL,
+                           0, 20, TRUE);
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_NE_POINTER(NULL,fd_head);
+    ASSERT_EQ(11,fd_head->frame);
+    ASSERT_EQ(200,fd_head->datalen);
+    ASSERT_EQ(11,fd_head->reassembled_in);
+    ASSERT_EQ(FD_DEFRAGMENTED|FD_DATALEN_SET|FD_OVERLAP,fd_head->flags);
+
+    /* the fragments are in order, with the duplicate after the original */
+    n_frags = 0;
+    prev_offset = 0;
+    for (fd = fd_head->next; fd != NULL; fd = fd->next) {
+        ASSERT(fd->offset >= prev_offset);
+        if (fd->offset == 100 && fd->next->offset == 100) {
+            ASSERT_EQ(5,fd->frame);
+            ASSERT_EQ(10,fd->next->frame);
+        }
+        prev_offset = fd->offset;
+        n_frags++;
+    }
+    ASSERT_EQ(11,n_frags);
+
+    /* test the actual reassembly */
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,data,200));
+}
+
+/* Checks that a reassembly that hasn't had a fragment added for more than
+ * "protocols.reassembly_max_age" frames is discarded, and the statistics.
+ */
+static void
+test_fragment_add_max_age(void)
+{
+    fragment_head *fd_head;
+    reassembly_stats stats;
+
+    printf("Starting test test_fragment_add_max_age\n");
+
+    prefs.reassembly_max_age = 2;
+
+    pinfo.num = 1;
+    fd_head = fragment_add(&test_reassembly_table, tvb, 0, &pinfo, 12, NULL,
+                           0, 50, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    pinfo.num = 2;
+    fd_head = fragment_add(&test_reassembly_table, tvb, 0, &pinfo, 13, NULL,
+                           0, 60, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    reassembly_table_get_stats(&test_reassembly_table, &stats);
+    ASSERT_EQ(2,stats.pending_reassemblies);
+    ASSERT_EQ(110,stats.pending_bytes);
+    ASSERT_EQ(0,stats.evicted_reassemblies);
+
+    /* datagram 12 was last added to three frames ago, so it goes */
+    pinfo.num = 4;
+    fd_head = fragment_add(&test_reassembly_table, tvb, 60, &pinfo, 13, NULL,
+                           60, 10, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+
+    reassembly_table_get_stats(&test_reassembly_table, &stats);
+    ASSERT_EQ(1,stats.pending_reassemblies);
+    ASSERT_EQ(70,stats.pending_bytes);
+    ASSERT_EQ(1,stats.evicted_reassemblies);
+    ASSERT_EQ(50,stats.evicted_bytes);
+
+    /* completing datagram 13 leaves nothing pending */
+    pinfo.num = 5;
+    fd_head = fragment_add(&test_reassembly_table, tvb, 70, &pinfo, 13, NULL,
+                           70, 10, FALSE);
+    ASSERT_NE_POINTER(NULL,fd_head);
+    ASSERT(!tvb_memeql(fd_head->tvb_data,0,data,80));
+
+    reassembly_table_get_stats(&test_reassembly_table, &stats);
+    ASSERT_EQ(0,stats.pending_reassemblies);
+    ASSERT_EQ(0,stats.pending_bytes);
+    ASSERT_EQ(1,stats.evicted_reassemblies);
+
+    prefs.reassembly_max_age = 0;
+}
+
+/* Checks that when the unfinished reassemblies in a table hold more than
+ * "protocols.reassembly_max_pending_mb" of fragment data, the one that has
+ * waited longest is discarded, and that fragments that weren't added to
+ * a reassembly aren't counted.
+ */
+static void
+test_fragment_add_max_pending(void)
+{
+    fragment_head *fd_head;
+    reassembly_stats stats;
+    const guint32 big_len = 600 * 1024;
+    char *big_data;
+    tvbuff_t *big_tvb;
+
+    printf("Starting test test_fragment_add_max_pending\n");
+
+    prefs.reassembly_max_pending_mb = 1;
+    big_data = (char *)g_malloc0(big_len);
+    big_tvb = tvb_new_real_data(big_data, big_len, big_len);
+
+    pinfo.num = 1;
+    fd_head = fragment_add(&test_reassembly_table, big_tvb, 0, &pinfo, 12, NULL,
+                           0, big_len, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    /* the same fragment again in the same frame isn't added */
+    fd_head = fragment_add(&test_reassembly_table, big_tvb, 0, &pinfo, 12, NULL,
+                           0, big_len, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    /* nor is one that was cut short by the snapshot length */
+    pinfo.num = 2;
+    fd_head = fragment_add_seq(&test_reassembly_table, tvb, 200, &pinfo, 13, NULL,
+                               0, 100, TRUE, 0);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+
+    reassembly_table_get_stats(&test_reassembly_table, &stats);
+    ASSERT_EQ(2,stats.pending_reassemblies);
+    ASSERT_EQ(big_len,stats.pending_bytes);
+    ASSERT_EQ(0,stats.evicted_reassemblies);
+
+    /* datagram 14 takes the total over 1 MB, so datagram 12 goes */
+    pinfo.num = 3;
+    fd_head = fragment_add(&test_reassembly_table, big_tvb, 0, &pinfo, 14, NULL,
+                           0, big_len, TRUE);
+    ASSERT_EQ_POINTER(NULL,fd_head);
+    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.fragment_table));
+
+    reassembly_table_get_stats(&test_reassembly_table, &stats);
+    ASSERT_EQ(2,stats.pending_reassemblies);
+    ASSERT_EQ(big_len,stats.pending_bytes);
+    ASSERT_EQ(1,stats.evicted_reassemblies);
+    ASSERT_EQ(big_len,stats.evicted_bytes);
+
+    /* datagram 12 starts again from scratch */
+    pinfo.num = 4;
+    fd_head = fragment_add(&test_reassembly_table, tvb, 0, &pinfo, 12, NULL,
+                           0, 20, FALSE);
+    ASSERT_NE_POINTER(NULL,fd_head);
+    ASSERT_EQ(20,fd_head->datalen);
+
+    prefs.reassembly_max_pending_mb = 0;
+    tvb_free(big_tvb);
+    g_free(big_data);
+}
+
+
+
 /**********************************************************************************
  *
  * main
@@ -1535,6 +1722,9 @@ main(int argc _U_, char **argv _U_)
         test_fragment_add_seq_802_11_0,
         test_fragment_add_seq_802_11_1,
         test_simple_fragment_add_seq_next,
+        test_fragment_add_reverse_order,
+        test_fragment_add_max_age,
+        test_fragment_add_max_pending,
 #if 0
         test_missing_data_fragment_add_seq_next,
         test_missing_data_fragment_add_seq_next_2,
@@ -18,6 +18,8 @@
 #include "tvbuff.h"
 #include "exceptions.h"
 #include "wsutil/pint.h"
+#include "wsutil/ws_memsearch.h"
+#include "wsutil/ws_multimatch.h"
 
 gboolean failed = FALSE;
 
@@ -485,6 +487,341 @@ run_tests(void)
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
 }
 
+/* Tests the search routines on a tvbuff holding search_data, and
+ * returns TRUE if all of them succeed. */
+static const gchar search_data[] =
+	"0123456789012345678901234567890123456789"
+	"GET /index.html HTTP/1.1\r\n"
+	"Host: www.example.com\r\n"
+	"\r\n";
+
+static gboolean
+test_searches(tvbuff_t *tvb, const gchar *name)
+{
+	const gint	request_offset = (gint)(strstr(search_data, "GET") - search_data);
+	const gint	index_offset = (gint)(strstr(search_data, "index.htm") - search_data);
+	const gint	version_offset = (gint)(strstr(search_data, "HTTP/1.1") - search_data);
+	const gint	crlf_offset = (gint)(strstr(search_data, "\r\n") - search_data);
+	const gint	host_offset = (gint)(strstr(search_data, "Host:") - search_data);
+	const gint	host_crlf_offset = (gint)(strstr(search_data + host_offset, "\r\n") - search_data);
+	tvbuff_t	*needle_tvb;
+	ws_multimatch	*patterns;
+	guint		pattern_id, match_len;
+	gint		offset, next_offset;
+	gboolean	ok = TRUE;
+
+	/* tvb_find_guint16() */
+	offset = tvb_find_guint16(tvb, 0, -1, 0x0d0a);
+	if (offset != crlf_offset) {
+		printf("03: Failed TVB=%s CRLF found at %d instead of %d\n",
+				name, offset, crlf_offset);
+		ok = FALSE;
+	}
+	offset = tvb_find_guint16(tvb, crlf_offset + 1, -1, 0x0d0a);
+	if (offset != host_crlf_offset) {
+		printf("03: Failed TVB=%s next CRLF found at %d instead of %d\n",
+				name, offset, host_crlf_offset);
+		ok = FALSE;
+	}
+	/* Only the CR is within the searched bytes. */
+	offset = tvb_find_guint16(tvb, request_offset, crlf_offset - request_offset + 1, 0x0d0a);
+	if (offset != -1) {
+		printf("03: Failed TVB=%s CRLF found at %d past the maximum length\n",
+				name, offset);
+		ok = FALSE;
+	}
+
+	/* tvb_find_line_end() */
+	offset = tvb_find_line_end(tvb, request_offset, -1, &next_offset, FALSE);
+	if (offset != crlf_offset - request_offset || next_offset != crlf_offset + 2) {
+		printf("04: Failed TVB=%s line length %d and next offset %d instead of %d and %d\n",
+				name, offset, next_offset, crlf_offset - request_offset, crlf_offset + 2);
+		ok = FALSE;
+	}
+
+	/* tvb_find_tvb() */
+	needle_tvb = tvb_new_real_data((const guint8 *)"HTTP/1.1", 8, 8);
+	offset = tvb_find_tvb(tvb, needle_tvb, 0);
+	if (offset != version_offset) {
+		printf("05: Failed TVB=%s version found at %d instead of %d\n",
+				name, offset, version_offset);
+		ok = FALSE;
+	}
+	tvb_free(needle_tvb);
+
+	/* tvb_find_multimatch() */
+	patterns = ws_multimatch_new(TRUE);
+	ws_multimatch_add(patterns, "index.htm", 9);
+	ws_multimatch_add(patterns, "host:", 5);
+	ws_multimatch_add(patterns, "HTTP/1.0", 8);
+	ws_multimatch_compile(patterns);
+
+	offset = tvb_find_multimatch(tvb, 0, -1, patterns, &pattern_id, &match_len);
+	if (offset != index_offset || pattern_id != 0 || match_len != 9) {
+		printf("06: Failed TVB=%s pattern %u found at %d instead of pattern 0 at %d\n",
+				name, pattern_id, offset, index_offset);
+		ok = FALSE;
+	}
+	offset = tvb_find_multimatch(tvb, index_offset + 1, -1, patterns, &pattern_id, &match_len);
+	if (offset != host_offset || pattern_id != 1 || match_len != 5) {
+		printf("06: Failed TVB=%s pattern %u found at %d instead of pattern 1 at %d\n",
+				name, pattern_id, offset, host_offset);
+		ok = FALSE;
+	}
+	/* The match doesn't fit in the searched bytes. */
+	offset = tvb_find_multimatch(tvb, index_offset + 1, host_offset + 4 - index_offset - 1, patterns, NULL, NULL);
+	if (offset != -1) {
+		printf("06: Failed TVB=%s pattern found at %d past the maximum length\n",
+				name, offset);
+		ok = FALSE;
+	}
+	ws_multimatch_free(patterns);
+
+	if (!ok) {
+		failed = TRUE;
+		return FALSE;
+	}
+
+	printf("Passed searches TVB=%s\n", name);
+
+	return TRUE;
+}
+
+/* Haystack lengths up to here cover one, two and four vector steps of
+ * the SSE2 and AVX2 searches, and the tails after them. */
+#define MEMSEARCH_MAX_HAYSTACK	70
+
+static const guint8 memsearch_needle[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+/* Searches for needles of several lengths placed at every position of
+ * haystacks of every length, and for needles cut short by the end of
+ * the haystack.  Each haystack is allocated at exactly its length, so
+ * that valgrind reports a search that reads past it. */
+static gboolean
+test_memmem(void)
+{
+	static const size_t	needle_lengths[] = { 1, 2, 3, 15, 16, 17, 32, 33 };
+	static const guint8	fillers[] = { '.', '0' };
+	const guint8	*found;
+	guint8		*haystack;
+	size_t		haystacklen, needlelen, pos, expected_pos;
+	guint		i, j;
+	gboolean	ok = TRUE;
+
+	for (i = 0; i < G_N_ELEMENTS(needle_lengths); i++) {
+		needlelen = needle_lengths[i];
+		for (haystacklen = 1; haystacklen <= MEMSEARCH_MAX_HAYSTACK; haystacklen++) {
+			haystack = (guint8 *)g_malloc(haystacklen);
+			/* A filler of '0' matches the first byte of the needle
+			 * everywhere, so only the other bytes rule positions out. */
+			for (j = 0; j < G_N_ELEMENTS(fillers); j++) {
+				/* A match at each position, up to the last possible one. */
+				for (pos = 0; pos + needlelen <= haystacklen; pos++) {
+					memset(haystack, fillers[j], haystacklen);
+					memcpy(haystack + pos, memsearch_needle, needlelen);
+					found = ws_memmem(haystack, haystacklen, memsearch_needle, needlelen);
+					/* With a filler of '0' a one byte needle
+					 * is found at the start. */
+					expected_pos = needlelen == 1 && fillers[j] == '0' ? 0 : pos;
+					if (found != haystack + expected_pos) {
+						printf("07: Failed ws_memmem needle length %u haystack length %u match at %u, found at %d\n",
+								(guint)needlelen, (guint)haystacklen, (guint)expected_pos,
+								found ? (gint)(found - haystack) : -1);
+						ok = FALSE;
+					}
+				}
+				if (needlelen == 1 && fillers[j] == '0')
+					continue;
+
+				/* The needle longer than the tail it starts in. */
+				for (pos = haystacklen >= needlelen ? haystacklen - needlelen + 1 : 0; pos < haystacklen; pos++) {
+					memset(haystack, fillers[j], haystacklen);
+					memcpy(haystack + pos, memsearch_needle, haystacklen - pos);
+					found = ws_memmem(haystack, haystacklen, memsearch_needle, needlelen);
+					if (found != NULL) {
+						printf("07: Failed ws_memmem needle length %u haystack length %u cut at %u, found at %d\n",
+								(guint)needlelen, (guint)haystacklen, (guint)pos,
+								(gint)(found - haystack));
+						ok = FALSE;
+					}
+				}
+			}
+			g_free(haystack);
+		}
+	}
+
+	/*
+	 * The SSE2 and AVX2 loops step past the last place the needle fits
+	 * when that is 15 or 31 bytes in; they used to search the tail
+	 * anyway, with a haystack shorter than the needle.
+	 */
+	for (i = 0; i < 2; i++) {
+		haystacklen = 2 + (i == 0 ? 15 : 31);
+		haystack = (guint8 *)g_malloc(haystacklen);
+		memset(haystack, '.', haystacklen);
+		haystack[haystacklen - 1] = memsearch_needle[0];
+		found = ws_memmem(haystack, haystacklen, memsearch_needle, 2);
+		if (found != NULL) {
+			printf("07: Failed ws_memmem tail shorter than the needle, found at %d\n",
+					(gint)(found - haystack));
+			ok = FALSE;
+		}
+		g_free(haystack);
+	}
+
+	/* The needle longer than the whole haystack. */
+	if (ws_memmem(memsearch_needle, 16, memsearch_needle, 17) != NULL) {
+		printf("07: Failed ws_memmem needle longer than the haystack\n");
+		ok = FALSE;
+	}
+
+	if (!ok)
+		failed = TRUE;
+	return ok;
+}
+
+/* Searches for either of two bytes, with one of them at every position
+ * of haystacks of every length. */
+static gboolean
+test_memchr2(void)
+{
+	const guint8	*found;
+	guint8		*haystack;
+	size_t		haystacklen, pos;
+	gboolean	ok = TRUE;
+
+	for (haystacklen = 1; haystacklen <= MEMSEARCH_MAX_HAYSTACK; haystacklen++) {
+		haystack = (guint8 *)g_malloc(haystacklen);
+		memset(haystack, '.', haystacklen);
+		found = ws_memchr2(haystack, haystacklen, '\r', '\n');
+		if (found != NULL) {
+			printf("08: Failed ws_memchr2 haystack length %u found at %d in filler\n",
+					(guint)haystacklen, (gint)(found - haystack));
+			ok = FALSE;
+		}
+		for (pos = 0; pos < haystacklen; pos++) {
+			memset(haystack, '.', haystacklen);
+			haystack[pos] = pos % 2 ? '\r' : '\n';
+			found = ws_memchr2(haystack, haystacklen, '\r', '\n');
+			if (found != haystack + pos) {
+				printf("08: Failed ws_memchr2 haystack length %u match at %u, found at %d\n",
+						(guint)haystacklen, (guint)pos,
+						found ? (gint)(found - haystack) : -1);
+				ok = FALSE;
+			}
+		}
+		g_free(haystack);
+	}
+
+	if (!ok)
+		failed = TRUE;
+	return ok;
+}
+
+static gboolean
+check_multimatch(const ws_multimatch *patterns, const gchar *haystack,
+		gint expected_offset, guint expected_id, size_t expected_len)
+{
+	const guint8	*found;
+	guint		pattern_id = G_MAXUINT;
+	size_t		match_len = 0;
+	gint		offset;
+
+	found = ws_multimatch_exec(patterns, (const guint8 *)haystack, strlen(haystack),
+			&pattern_id, &match_len);
+	offset = found ? (gint)(found - (const guint8 *)haystack) : -1;
+	if (offset != expected_offset ||
+	    (found && (pattern_id != expected_id || match_len != expected_len))) {
+		printf("09: Failed ws_multimatch in \"%s\" pattern %u length %u found at %d instead of pattern %u length %u at %d\n",
+				haystack, pattern_id, (guint)match_len, offset,
+				expected_id, (guint)expected_len, expected_offset);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* The textbook he/she/his/hers set, whose patterns overlap and share
+ * suffixes, so the search has to follow the failure links. */
+static gboolean
+test_multimatch(void)
+{
+	static const gchar	*const words[] = { "he", "she", "his", "hers" };
+	ws_multimatch	*patterns;
+	ws_multimatch	*nocase_patterns;
+	guint		i;
+	gboolean	ok = TRUE;
+
+	patterns = ws_multimatch_new(FALSE);
+	nocase_patterns = ws_multimatch_new(TRUE);
+	for (i = 0; i < G_N_ELEMENTS(words); i++) {
+		ws_multimatch_add(patterns, words[i], strlen(words[i]));
+		ws_multimatch_add(nocase_patterns, words[i], strlen(words[i]));
+	}
+	ws_multimatch_compile(patterns);
+	ws_multimatch_compile(nocase_patterns);
+
+	/* "she" and "he" end at the same byte; the longer one is reported. */
+	ok &= check_multimatch(patterns, "ushers", 1, 1, 3);
+	/* "he" ends before "hers". */
+	ok &= check_multimatch(patterns, "hers", 0, 0, 2);
+	/* After "sh" fails on 'i', the search continues from "h". */
+	ok &= check_multimatch(patterns, "shis", 1, 2, 3);
+	/* After "sh" fails on 'h', the search continues from the root. */
+	ok &= check_multimatch(patterns, "shhe", 2, 0, 2);
+	/* A match in the last bytes, after partial matches. */
+	ok &= check_multimatch(patterns, "sshhhiihx he", 10, 0, 2);
+	ok &= check_multimatch(patterns, "shx hix hhx", -1, 0, 0);
+	ok &= check_multimatch(patterns, "", -1, 0, 0);
+
+	/* Other cases only match a set created with nocase. */
+	ok &= check_multimatch(patterns, "USHERS", -1, 0, 0);
+	ok &= check_multimatch(patterns, "uSHers", -1, 0, 0);
+	ok &= check_multimatch(nocase_patterns, "USHERS", 1, 1, 3);
+	ok &= check_multimatch(nocase_patterns, "uSHers", 1, 1, 3);
+	ok &= check_multimatch(nocase_patterns, "ShIs", 1, 2, 3);
+	ok &= check_multimatch(nocase_patterns, "sHhE", 2, 0, 2);
+
+	ws_multimatch_free(patterns);
+	ws_multimatch_free(nocase_patterns);
+
+	if (!ok)
+		failed = TRUE;
+	return ok;
+}
+
+static void
+run_search_tests(void)
+{
+	const guint	search_length = (guint)strlen(search_data);
+	const guint	split = (guint)(strstr(search_data, "HTTP/1.1\r") - search_data) + 4;
+	tvbuff_t	*tvb_parent;
+	tvbuff_t	*tvb_real;
+	tvbuff_t	*tvb_comp;
+
+	tvb_parent = tvb_new_real_data("", 0, 0);
+
+	tvb_real = tvb_new_child_real_data(tvb_parent, (const guint8 *)search_data,
+			search_length, search_length);
+	test_searches(tvb_real, "Search Real");
+
+	/* The same data, split in the middle of the request line. */
+	tvb_comp = tvb_new_composite();
+	tvb_composite_append(tvb_comp, tvb_new_subset_length(tvb_real, 0, split));
+	tvb_composite_append(tvb_comp, tvb_new_subset_length(tvb_real, split, search_length - split));
+	tvb_composite_finalize(tvb_comp);
+	test_searches(tvb_comp, "Search Composite");
+
+	tvb_free(tvb_comp);
+	tvb_free_chain(tvb_parent);
+
+	if (test_memmem())
+		printf("Passed ws_memmem searches\n");
+	if (test_memchr2())
+		printf("Passed ws_memchr2 searches\n");
+	if (test_multimatch())
+		printf("Passed ws_multimatch searches\n");
+}
+
 /* Note: valgrind can be used to check for tvbuff memory leaks */
 int
 main(void)
@@ -495,6 +832,7 @@ main(void)
 
 	except_init();
 	run_tests();
+	run_search_tests();
 	except_deinit();
 	exit(failed?1:0);
 }
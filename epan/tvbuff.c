@@ -32,6 +32,7 @@
 #include "wsutil/unicode-utils.h"
 #include "wsutil/nstime.h"
 #include "wsutil/time_util.h"
+#include "wsutil/ws_memsearch.h"
 #include "tvbuff.h"
 #include "tvbuff-int.h"
 #include "strutil.h"
@@ -2132,46 +2133,45 @@ tvb_find_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const gu
 	return tvb_find_guint8_generic(tvb, offset, limit, needle);
 }
 
-/* Same as tvb_find_guint8() with 16bit needle. */
+/* Same as tvb_find_guint8() with 16bit needle; both bytes of the
+ * needle must lie within the searched range. */
 gint
 tvb_find_guint16(tvbuff_t *tvb, const gint offset, const gint maxlength,
 		 const guint16 needle)
 {
-	const guint8 needle1 = ((needle & 0xFF00) >> 8);
-	const guint8 needle2 = ((needle & 0x00FF) >> 0);
-	gint searched_bytes = 0;
-	gint pos = offset;
-
-	do {
-		gint offset1 =
-			tvb_find_guint8(tvb, pos, maxlength - searched_bytes, needle1);
-		gint offset2 = -1;
-
-		if (offset1 == -1) {
-			return -1;
-		}
+	const guint8  needle_bytes[2] = {
+		(guint8) ((needle & 0xFF00) >> 8),
+		(guint8) ((needle & 0x00FF) >> 0)
+	};
+	const guint8 *ptr;
+	const guint8 *result;
+	guint	      abs_offset = 0;
+	guint	      limit = 0;
+	int           exception;
 
-		searched_bytes = offset - pos + 1;
+	DISSECTOR_ASSERT(tvb && tvb->initialized);
 
-		if ((maxlength != -1) && (searched_bytes >= maxlength)) {
-			return -1;
-		}
+	exception = compute_offset_and_remaining(tvb, offset, &abs_offset, &limit);
+	if (exception)
+		THROW(exception);
 
-		offset2 = tvb_find_guint8(tvb, offset1 + 1, 1, needle2);
+	/* Only search to end of tvbuff, w/o throwing exception. */
+	if (maxlength >= 0 && limit > (guint) maxlength) {
+		/* Maximum length doesn't go past end of tvbuff; search
+		   to that value. */
+		limit = (guint) maxlength;
+	}
 
-		searched_bytes += 1;
+	if (limit < 2)
+		return -1;
 
-		if (offset2 != -1) {
-			if ((maxlength != -1) && (searched_bytes > maxlength)) {
-				return -1;
-			}
-			return offset1;
-		}
+	ptr = ensure_contiguous(tvb, abs_offset, limit);
 
-		pos = offset1 + 1;
-	} while (searched_bytes < maxlength);
+	result = ws_memmem(ptr, limit, needle_bytes, 2);
+	if (!result)
+		return -1;
 
-	return -1;
+	return (gint) ((result - ptr) + abs_offset);
 }
 
 static inline gint
@@ -4046,6 +4046,47 @@ tvb_find_tvb(tvbuff_t *haystack_tvb, tvbuff_t *needle_tvb, const gint haystack_o
 	return -1;
 }
 
+/* Find the first match of any of the patterns of a compiled set in tvbuff,
+ * starting at offset. */
+gint
+tvb_find_multimatch(tvbuff_t *tvb, const gint offset, const gint maxlength,
+		    const ws_multimatch *patterns, guint *pattern_id, guint *match_len)
+{
+	const guint8 *ptr;
+	const guint8 *result;
+	guint	      abs_offset = 0;
+	guint	      limit = 0;
+	size_t        len;
+	int           exception;
+
+	DISSECTOR_ASSERT(tvb && tvb->initialized);
+
+	exception = compute_offset_and_remaining(tvb, offset, &abs_offset, &limit);
+	if (exception)
+		THROW(exception);
+
+	/* Only search to end of tvbuff, w/o throwing exception. */
+	if (maxlength >= 0 && limit > (guint) maxlength) {
+		/* Maximum length doesn't go past end of tvbuff; search
+		   to that value. */
+		limit = (guint) maxlength;
+	}
+
+	if (limit == 0)
+		return -1;
+
+	ptr = ensure_contiguous(tvb, abs_offset, limit);
+
+	result = ws_multimatch_exec(patterns, ptr, limit, pattern_id, &len);
+	if (!result)
+		return -1;
+
+	if (match_len)
+		*match_len = (guint) len;
+
+	return (gint) ((result - ptr) + abs_offset);
+}
+
 gint
 tvb_raw_offset(tvbuff_t *tvb)
 {
@@ -28,6 +28,7 @@
 
 #include <wsutil/nstime.h>
 #include "wsutil/ws_mempbrk.h"
+#include "wsutil/ws_multimatch.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -497,7 +498,9 @@ WS_DLL_PUBLIC const guint8 *tvb_get_ptr(tvbuff_t *tvb, const gint offset,
 WS_DLL_PUBLIC gint tvb_find_guint8(tvbuff_t *tvb, const gint offset,
     const gint maxlength, const guint8 needle);
 
-/** Same as tvb_find_guint8() with 16bit needle. */
+/** Same as tvb_find_guint8() with 16bit needle, which is looked for in
+ * network byte order. Both of its bytes must be within the maxlength bytes
+ * searched. */
 WS_DLL_PUBLIC gint tvb_find_guint16(tvbuff_t *tvb, const gint offset,
     const gint maxlength, const guint16 needle);
 
@@ -896,6 +899,23 @@ WS_DLL_PUBLIC const gchar *tvb_bcd_dig_to_wmem_packet_str(tvbuff_t *tvb,
 WS_DLL_PUBLIC gint tvb_find_tvb(tvbuff_t *haystack_tvb, tvbuff_t *needle_tvb,
     const gint haystack_offset);
 
+/** Find the first match of any of the patterns of a compiled ws_multimatch
+ * set in tvbuff, starting at offset; see ws_multimatch_exec() for which match
+ * is reported when several patterns occur. The set is built once, typically
+ * in the dissector's registration routine, and each tvbuff is then looked at
+ * only once however many patterns the set has.
+ * Searches at most maxlength number of bytes; if maxlength is -1, searches
+ * to end of tvbuff; a match must be entirely within the searched bytes.
+ * Returns the offset of the start of the match, or -1 if there is none;
+ * if pattern_id and match_len are not NULL, they are set to the identifier
+ * returned by ws_multimatch_add() for the pattern found and to its length.
+ * Will not throw an exception, even if maxlength exceeds boundary of tvbuff;
+ * in that case, -1 will be returned if the boundary is reached before
+ * finding a match. */
+WS_DLL_PUBLIC gint tvb_find_multimatch(tvbuff_t *tvb, const gint offset,
+    const gint maxlength, const ws_multimatch *patterns, guint *pattern_id,
+    guint *match_len);
+
 /* From tvbuff_zlib.c */
 
 /**
@@ -15,12 +15,21 @@
 #include <glib.h>
 #include <string.h>
 
+#include "wmem_core.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
 struct _wmem_user_cb_container_t;
 
+/* The allocation statistics count sizes rounded up to a multiple of this, so
+ * that allocators which round requests up themselves can still report the
+ * size of an allocation exactly. */
+#define WMEM_STATS_GRANULARITY 16
+#define WMEM_STATS_SIZE(SIZE) ((~(gsize)(WMEM_STATS_GRANULARITY-1)) & \
+        ((SIZE) + (WMEM_STATS_GRANULARITY-1)))
+
 /* See section "4. Internal Design" of doc/README.wmem for details
  * on this structure */
 struct _wmem_allocator_t {
@@ -28,6 +37,7 @@ struct _wmem_allocator_t {
     void *(*walloc)(void *private_data, const size_t size);
     void  (*wfree)(void *private_data, void *ptr);
     void *(*wrealloc)(void *private_data, void *ptr, const size_t size);
+    gsize (*wsize)(void *private_data, void *ptr);
 
     /* Producer/Manager functions */
     void  (*free_all)(void *private_data);
@@ -37,6 +47,10 @@ struct _wmem_allocator_t {
     /* Callback List */
     struct _wmem_user_cb_container_t *callbacks;
 
+    /* Statistics */
+    char                        *name;
+    wmem_allocator_stats_t       stats;
+
     /* Implementation details */
     void                        *private_data;
     enum _wmem_allocator_type_t  type;
@@ -144,6 +144,9 @@
 /* The header for an entire OS-level 'block' of memory */
 typedef struct _wmem_block_hdr_t {
     struct _wmem_block_hdr_t *prev, *next;
+
+    /* the size requested by the caller, if this is a jumbo block */
+    gsize jumbo_size;
 } wmem_block_hdr_t;
 
 /* The header for a single 'chunk' of memory as returned from alloc/realloc.
@@ -785,6 +788,7 @@ wmem_block_alloc_jumbo(wmem_block_allocator_t *allocator, const size_t size)
 
     /* add it to the block list */
     wmem_block_add_to_block_list(allocator, block);
+    block->jumbo_size = size;
 
     /* the new block contains a single jumbo chunk */
     chunk = WMEM_BLOCK_TO_CHUNK(block);
@@ -837,6 +841,8 @@ wmem_block_realloc_jumbo(wmem_block_allocator_t *allocator,
         allocator->block_list = block;
     }
 
+    block->jumbo_size = size;
+
     return WMEM_CHUNK_TO_DATA(WMEM_BLOCK_TO_CHUNK(block));
 }
 
@@ -1000,6 +1006,23 @@ wmem_block_realloc(void *private_data, void *ptr, const size_t size)
     return ptr;
 }
 
+/* The statistics count the space set aside for a chunk, which is at least
+ * what was asked for, rather than keeping the requested size in every chunk
+ * header. */
+static gsize
+wmem_block_size(void *private_data _U_, void *ptr)
+{
+    wmem_block_chunk_t *chunk;
+
+    chunk = WMEM_DATA_TO_CHUNK(ptr);
+
+    if (chunk->jumbo) {
+        return WMEM_STATS_SIZE(WMEM_CHUNK_TO_BLOCK(chunk)->jumbo_size);
+    }
+
+    return WMEM_STATS_SIZE(WMEM_CHUNK_DATA_LEN(chunk));
+}
+
 static void
 wmem_block_free_all(void *private_data)
 {
@@ -1099,6 +1122,7 @@ wmem_block_allocator_init(wmem_allocator_t *allocator)
     allocator->walloc   = &wmem_block_alloc;
     allocator->wrealloc = &wmem_block_realloc;
     allocator->wfree    = &wmem_block_free;
+    allocator->wsize    = &wmem_block_size;
 
     allocator->free_all = &wmem_block_free_all;
     allocator->gc       = &wmem_block_gc;
@@ -57,6 +57,8 @@ typedef struct {
 #define JUMBO_MAGIC 0xFFFFFFFF
 typedef struct _wmem_block_fast_jumbo {
     struct _wmem_block_fast_jumbo *prev, *next;
+
+    gsize size;
 } wmem_block_fast_jumbo_t;
 #define WMEM_JUMBO_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_block_fast_jumbo_t))
 
@@ -98,6 +100,7 @@ wmem_block_fast_alloc(void *private_data, const size_t size)
 
         block->next = allocator->jumbo_list;
         block->prev = NULL;
+        block->size = size;
         allocator->jumbo_list = block;
 
         chunk = ((wmem_block_fast_chunk_t*)((guint8*)(block) + WMEM_JUMBO_HEADER_SIZE));
@@ -143,6 +146,7 @@ wmem_block_fast_realloc(void *private_data, void *ptr, const size_t size)
         block = ((wmem_block_fast_jumbo_t*)((guint8*)(chunk) - WMEM_JUMBO_HEADER_SIZE));
         block =  (wmem_block_fast_jumbo_t*)wmem_realloc(NULL, block,
                 size + WMEM_JUMBO_HEADER_SIZE + WMEM_CHUNK_HEADER_SIZE);
+        block->size = size;
         if (block->prev) {
             block->prev->next = block;
         }
@@ -166,10 +170,29 @@ wmem_block_fast_realloc(void *private_data, void *ptr, const size_t size)
         return newptr;
     }
 
-    /* shrink or same space - great we can do nothing */
+    /* shrink or same space - great we can do nothing but remember the new
+     * size for wmem_block_fast_size() */
+    chunk->len = (guint32) size;
     return ptr;
 }
 
+static gsize
+wmem_block_fast_size(void *private_data _U_, void *ptr)
+{
+    wmem_block_fast_chunk_t *chunk;
+
+    chunk = WMEM_DATA_TO_CHUNK(ptr);
+
+    if (chunk->len == JUMBO_MAGIC) {
+        wmem_block_fast_jumbo_t *block;
+
+        block = ((wmem_block_fast_jumbo_t*)((guint8*)(chunk) - WMEM_JUMBO_HEADER_SIZE));
+        return WMEM_STATS_SIZE(block->size);
+    }
+
+    return WMEM_STATS_SIZE(chunk->len);
+}
+
 static void
 wmem_block_fast_free_all(void *private_data)
 {
@@ -233,6 +256,7 @@ wmem_block_fast_allocator_init(wmem_allocator_t *allocator)
     allocator->walloc   = &wmem_block_fast_alloc;
     allocator->wrealloc = &wmem_block_fast_realloc;
     allocator->wfree    = &wmem_block_fast_free;
+    allocator->wsize    = &wmem_block_fast_size;
 
     allocator->free_all = &wmem_block_fast_free_all;
     allocator->gc       = &wmem_block_fast_gc;
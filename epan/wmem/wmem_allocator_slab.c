@@ -0,0 +1,451 @@
+/* wmem_allocator_slab.c
+ * Wireshark Memory Manager Slab Allocator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "wmem_core.h"
+#include "wmem_allocator.h"
+#include "wmem_allocator_slab.h"
+
+/* This allocator is meant for pools that hold a great many small objects of
+ * a few fixed sizes for a long time, like the conversations, their keys and
+ * the tree nodes in file scope.
+ *
+ * Small requests are rounded up to a size class (a multiple of 16 bytes) and
+ * served from a slab, a 64 KB piece of memory that holds objects of only one
+ * class. Objects have no header at all: the slab an object belongs to is
+ * found by rounding its address down to the slab size, since slabs are
+ * aligned to their size. Freed objects go on a free list for their class and
+ * are handed out again before the slab is carved any further. Slabs are only
+ * returned by free_all, which puts them all back on the list of free slabs.
+ *
+ * Slabs are taken from arenas of several slabs, to make up for the slack
+ * needed to align them. Larger requests are simply malloced with a header,
+ * like the jumbo allocations of the block allocators.
+ */
+
+/* See wmem_allocator_block.c for where this comes from */
+#define WMEM_ALIGN_AMOUNT (2 * sizeof (gsize))
+#define WMEM_ALIGN_SIZE(SIZE) ((~(WMEM_ALIGN_AMOUNT-1)) & \
+        ((SIZE) + (WMEM_ALIGN_AMOUNT-1)))
+
+#define WMEM_SLAB_SIZE          (64 * 1024)
+#define WMEM_SLABS_PER_ARENA    16
+#define WMEM_ARENA_SIZE         (WMEM_SLABS_PER_ARENA * WMEM_SLAB_SIZE)
+
+/* The size classes are the sizes counted by the allocation statistics, so
+ * that the size of an object is also the size the statistics counted for it. */
+#define WMEM_SLAB_CLASS_STEP        WMEM_STATS_GRANULARITY
+#define WMEM_SLAB_MAX_ALLOC_SIZE    256
+#define WMEM_SLAB_NUM_CLASSES       (WMEM_SLAB_MAX_ALLOC_SIZE / WMEM_SLAB_CLASS_STEP)
+#define WMEM_SLAB_CLASS(SIZE)       (((SIZE) - 1) / WMEM_SLAB_CLASS_STEP)
+#define WMEM_SLAB_CLASS_SIZE(CLASS) (((CLASS) + 1) * WMEM_SLAB_CLASS_STEP)
+
+/* The header at the start of every slab */
+typedef struct _wmem_slab_t {
+    /* the next slab on the list of free slabs */
+    struct _wmem_slab_t *next;
+
+    /* the size of the objects in the slab, or 0 if the slab is free */
+    guint32 object_size;
+
+    /* the offset of the first object that has never been handed out */
+    guint32 pos;
+} wmem_slab_t;
+#define WMEM_SLAB_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_slab_t))
+
+#define WMEM_SLAB_OF(PTR) ((wmem_slab_t*)GSIZE_TO_POINTER(GPOINTER_TO_SIZE(PTR) & ~(gsize)(WMEM_SLAB_SIZE-1)))
+
+typedef struct _wmem_slab_arena_t {
+    struct _wmem_slab_arena_t *next;
+
+    /* the memory as malloced, and the first slab in it */
+    void   *mem;
+    guint8 *slabs;
+} wmem_slab_arena_t;
+
+#define WMEM_ARENA_SLAB(ARENA, IDX) ((wmem_slab_t*)((ARENA)->slabs + (IDX) * WMEM_SLAB_SIZE))
+
+typedef struct _wmem_slab_jumbo_t {
+    struct _wmem_slab_jumbo_t *prev, *next;
+
+    gsize size;
+} wmem_slab_jumbo_t;
+#define WMEM_JUMBO_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_slab_jumbo_t))
+
+#define WMEM_JUMBO_TO_DATA(JUMBO) ((void*)((guint8*)(JUMBO) + WMEM_JUMBO_HEADER_SIZE))
+#define WMEM_DATA_TO_JUMBO(DATA) ((wmem_slab_jumbo_t*)((guint8*)(DATA) - WMEM_JUMBO_HEADER_SIZE))
+
+typedef struct _wmem_slab_allocator_t {
+    /* per size class, the objects that have been freed (linked through their
+     * first bytes) and the slab that new objects are carved from */
+    void        *free_objects[WMEM_SLAB_NUM_CLASSES];
+    wmem_slab_t *current[WMEM_SLAB_NUM_CLASSES];
+
+    wmem_slab_t       *free_slabs;
+    wmem_slab_arena_t *arenas;
+    wmem_slab_jumbo_t *jumbo_list;
+
+    /* every slab we own, to tell slab objects from jumbo allocations */
+    GHashTable        *slabs;
+} wmem_slab_allocator_t;
+
+/* SLABS */
+
+/* Puts the free slabs of an arena on the list of free slabs, in address
+ * order. */
+static void
+wmem_slab_push_free_slabs(wmem_slab_allocator_t *allocator,
+                          wmem_slab_arena_t *arena)
+{
+    wmem_slab_t *slab;
+    int          i;
+
+    for (i = WMEM_SLABS_PER_ARENA - 1; i >= 0; i--) {
+        slab = WMEM_ARENA_SLAB(arena, i);
+        if (slab->object_size == 0) {
+            slab->next = allocator->free_slabs;
+            allocator->free_slabs = slab;
+        }
+    }
+}
+
+static void
+wmem_slab_new_arena(wmem_slab_allocator_t *allocator)
+{
+    wmem_slab_arena_t *arena;
+    wmem_slab_t       *slab;
+    int                i;
+
+    arena = wmem_new(NULL, wmem_slab_arena_t);
+
+    /* allocate enough to be able to align the slabs to their size */
+    arena->mem   = wmem_alloc(NULL, WMEM_ARENA_SIZE + WMEM_SLAB_SIZE - 1);
+    arena->slabs = (guint8 *)WMEM_SLAB_OF((guint8 *)arena->mem + WMEM_SLAB_SIZE - 1);
+
+    for (i = 0; i < WMEM_SLABS_PER_ARENA; i++) {
+        slab = WMEM_ARENA_SLAB(arena, i);
+        slab->object_size = 0;
+        g_hash_table_add(allocator->slabs, slab);
+    }
+
+    arena->next = allocator->arenas;
+    allocator->arenas = arena;
+
+    wmem_slab_push_free_slabs(allocator, arena);
+}
+
+static wmem_slab_t *
+wmem_slab_new_slab(wmem_slab_allocator_t *allocator, guint32 object_size)
+{
+    wmem_slab_t *slab;
+
+    if (!allocator->free_slabs) {
+        wmem_slab_new_arena(allocator);
+    }
+
+    slab = allocator->free_slabs;
+    allocator->free_slabs = slab->next;
+
+    slab->next        = NULL;
+    slab->object_size = object_size;
+    slab->pos         = WMEM_SLAB_HEADER_SIZE;
+
+    return slab;
+}
+
+/* Returns the slab the pointer was allocated from, or NULL if it is a jumbo
+ * allocation. */
+static inline wmem_slab_t *
+wmem_slab_find(wmem_slab_allocator_t *allocator, void *ptr)
+{
+    return (wmem_slab_t *)g_hash_table_lookup(allocator->slabs, WMEM_SLAB_OF(ptr));
+}
+
+static inline void
+wmem_slab_free_object(wmem_slab_allocator_t *allocator, wmem_slab_t *slab,
+                      void *ptr)
+{
+    guint cls = WMEM_SLAB_CLASS(slab->object_size);
+
+    *(void **)ptr = allocator->free_objects[cls];
+    allocator->free_objects[cls] = ptr;
+}
+
+/* JUMBO ALLOCATIONS */
+
+static void *
+wmem_slab_alloc_jumbo(wmem_slab_allocator_t *allocator, const size_t size)
+{
+    wmem_slab_jumbo_t *jumbo;
+
+    jumbo = (wmem_slab_jumbo_t *)wmem_alloc(NULL, size + WMEM_JUMBO_HEADER_SIZE);
+
+    jumbo->size = size;
+    jumbo->prev = NULL;
+    jumbo->next = allocator->jumbo_list;
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo;
+    }
+    allocator->jumbo_list = jumbo;
+
+    return WMEM_JUMBO_TO_DATA(jumbo);
+}
+
+static void
+wmem_slab_free_jumbo(wmem_slab_allocator_t *allocator, void *ptr)
+{
+    wmem_slab_jumbo_t *jumbo;
+
+    jumbo = WMEM_DATA_TO_JUMBO(ptr);
+
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo->prev;
+    }
+    if (jumbo->prev) {
+        jumbo->prev->next = jumbo->next;
+    }
+    else {
+        allocator->jumbo_list = jumbo->next;
+    }
+
+    wmem_free(NULL, jumbo);
+}
+
+static void *
+wmem_slab_realloc_jumbo(wmem_slab_allocator_t *allocator, void *ptr,
+                        const size_t size)
+{
+    wmem_slab_jumbo_t *jumbo;
+
+    jumbo = (wmem_slab_jumbo_t *)wmem_realloc(NULL, WMEM_DATA_TO_JUMBO(ptr),
+            size + WMEM_JUMBO_HEADER_SIZE);
+
+    jumbo->size = size;
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo;
+    }
+    if (jumbo->prev) {
+        jumbo->prev->next = jumbo;
+    }
+    else {
+        allocator->jumbo_list = jumbo;
+    }
+
+    return WMEM_JUMBO_TO_DATA(jumbo);
+}
+
+/* API */
+
+static void *
+wmem_slab_alloc(void *private_data, const size_t size)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_t           *slab;
+    void                  *ptr;
+    guint                  cls;
+
+    if (size > WMEM_SLAB_MAX_ALLOC_SIZE) {
+        return wmem_slab_alloc_jumbo(allocator, size);
+    }
+
+    cls = WMEM_SLAB_CLASS(size);
+
+    /* reuse the most recently freed object of the class, if there is one */
+    ptr = allocator->free_objects[cls];
+    if (ptr) {
+        allocator->free_objects[cls] = *(void **)ptr;
+        return ptr;
+    }
+
+    slab = allocator->current[cls];
+    if (!slab || slab->pos + WMEM_SLAB_CLASS_SIZE(cls) > WMEM_SLAB_SIZE) {
+        slab = wmem_slab_new_slab(allocator, WMEM_SLAB_CLASS_SIZE(cls));
+        allocator->current[cls] = slab;
+    }
+
+    ptr = (guint8 *)slab + slab->pos;
+    slab->pos += WMEM_SLAB_CLASS_SIZE(cls);
+
+    return ptr;
+}
+
+static void
+wmem_slab_free(void *private_data, void *ptr)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_t           *slab;
+
+    slab = wmem_slab_find(allocator, ptr);
+
+    if (!slab) {
+        wmem_slab_free_jumbo(allocator, ptr);
+        return;
+    }
+
+    wmem_slab_free_object(allocator, slab, ptr);
+}
+
+static void *
+wmem_slab_realloc(void *private_data, void *ptr, const size_t size)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_t           *slab;
+    void                  *newptr;
+
+    slab = wmem_slab_find(allocator, ptr);
+
+    if (!slab) {
+        return wmem_slab_realloc_jumbo(allocator, ptr, size);
+    }
+
+    /* An object stays where it is only if it stays in the same class, so
+     * that its size is always its class size */
+    if (size <= WMEM_SLAB_MAX_ALLOC_SIZE &&
+            WMEM_SLAB_CLASS_SIZE(WMEM_SLAB_CLASS(size)) == slab->object_size) {
+        return ptr;
+    }
+
+    newptr = wmem_slab_alloc(private_data, size);
+    memcpy(newptr, ptr, MIN(size, slab->object_size));
+    wmem_slab_free_object(allocator, slab, ptr);
+
+    return newptr;
+}
+
+static gsize
+wmem_slab_size(void *private_data, void *ptr)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_t           *slab;
+
+    slab = wmem_slab_find(allocator, ptr);
+
+    if (!slab) {
+        return WMEM_STATS_SIZE(WMEM_DATA_TO_JUMBO(ptr)->size);
+    }
+
+    return slab->object_size;
+}
+
+static void
+wmem_slab_free_all(void *private_data)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_arena_t     *arena;
+    wmem_slab_jumbo_t     *jumbo, *next;
+    int                    i;
+
+    memset(allocator->free_objects, 0, sizeof(allocator->free_objects));
+    memset(allocator->current, 0, sizeof(allocator->current));
+
+    /* every slab is free again */
+    allocator->free_slabs = NULL;
+    for (arena = allocator->arenas; arena; arena = arena->next) {
+        for (i = 0; i < WMEM_SLABS_PER_ARENA; i++) {
+            WMEM_ARENA_SLAB(arena, i)->object_size = 0;
+        }
+        wmem_slab_push_free_slabs(allocator, arena);
+    }
+
+    /* and the jumbo allocations are simply freed */
+    jumbo = allocator->jumbo_list;
+    while (jumbo) {
+        next = jumbo->next;
+        wmem_free(NULL, jumbo);
+        jumbo = next;
+    }
+    allocator->jumbo_list = NULL;
+}
+
+static void
+wmem_slab_gc(void *private_data)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_arena_t     *arena, **arena_ptr;
+    int                    i;
+
+    /* Return the arenas none of whose slabs are in use to the OS, and
+     * rebuild the list of free slabs from the others */
+    allocator->free_slabs = NULL;
+
+    arena_ptr = &allocator->arenas;
+    while ((arena = *arena_ptr) != NULL) {
+        for (i = 0; i < WMEM_SLABS_PER_ARENA; i++) {
+            if (WMEM_ARENA_SLAB(arena, i)->object_size != 0) {
+                break;
+            }
+        }
+
+        if (i < WMEM_SLABS_PER_ARENA) {
+            wmem_slab_push_free_slabs(allocator, arena);
+            arena_ptr = &arena->next;
+            continue;
+        }
+
+        for (i = 0; i < WMEM_SLABS_PER_ARENA; i++) {
+            g_hash_table_remove(allocator->slabs, WMEM_ARENA_SLAB(arena, i));
+        }
+        *arena_ptr = arena->next;
+        wmem_free(NULL, arena->mem);
+        wmem_free(NULL, arena);
+    }
+}
+
+static void
+wmem_slab_allocator_cleanup(void *private_data)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+
+    /* wmem guarantees that free_all() is called directly before this, so
+     * calling gc will return all our arenas to the OS automatically */
+    wmem_slab_gc(private_data);
+
+    g_hash_table_destroy(allocator->slabs);
+    wmem_free(NULL, allocator);
+}
+
+void
+wmem_slab_allocator_init(wmem_allocator_t *allocator)
+{
+    wmem_slab_allocator_t *slab_allocator;
+
+    slab_allocator = wmem_new0(NULL, wmem_slab_allocator_t);
+
+    allocator->walloc   = &wmem_slab_alloc;
+    allocator->wrealloc = &wmem_slab_realloc;
+    allocator->wfree    = &wmem_slab_free;
+    allocator->wsize    = &wmem_slab_size;
+
+    allocator->free_all = &wmem_slab_free_all;
+    allocator->gc       = &wmem_slab_gc;
+    allocator->cleanup  = &wmem_slab_allocator_cleanup;
+
+    allocator->private_data = (void*) slab_allocator;
+
+    slab_allocator->slabs = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
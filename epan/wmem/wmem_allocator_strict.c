@@ -152,6 +152,12 @@ wmem_strict_realloc(void *private_data, void *ptr, const size_t size)
     return new_ptr;
 }
 
+static gsize
+wmem_strict_size(void *private_data _U_, void *ptr)
+{
+    return WMEM_STATS_SIZE(WMEM_DATA_TO_BLOCK(ptr)->data_len);
+}
+
 void
 wmem_strict_check_canaries(wmem_allocator_t *allocator)
 {
@@ -206,6 +212,7 @@ wmem_strict_allocator_init(wmem_allocator_t *allocator)
     allocator->walloc   = &wmem_strict_alloc;
     allocator->wrealloc = &wmem_strict_realloc;
     allocator->wfree    = &wmem_strict_free;
+    allocator->wsize    = &wmem_strict_size;
 
     allocator->free_all = &wmem_strict_free_all;
     allocator->gc       = &wmem_strict_gc;
@@ -22,15 +22,42 @@
 #include "wmem_allocator_block.h"
 #include "wmem_allocator_block_fast.h"
 #include "wmem_allocator_strict.h"
+#include "wmem_allocator_slab.h"
 
 /* Set according to the WIRESHARK_DEBUG_WMEM_OVERRIDE environment variable in
  * wmem_init. Should not be set again. */
 static gboolean do_override = FALSE;
 static wmem_allocator_type_t override_type;
 
+/* The pools that have been given a name, in the order they were named. */
+static GSList *named_allocators = NULL;
+
+/* The size counted for an allocation of size bytes at ptr: what the allocator
+ * says it is, if it can tell, so that it's the same when the allocation is
+ * freed. */
+static inline gsize
+wmem_stats_size(wmem_allocator_t *allocator, void *ptr, const size_t size)
+{
+    if (allocator->wsize) {
+        return allocator->wsize(allocator->private_data, ptr);
+    }
+    return WMEM_STATS_SIZE(size);
+}
+
+static inline void
+wmem_stats_add(wmem_allocator_t *allocator, gsize size)
+{
+    allocator->stats.bytes_in_use += size;
+    if (allocator->stats.bytes_in_use > allocator->stats.peak_bytes_in_use) {
+        allocator->stats.peak_bytes_in_use = allocator->stats.bytes_in_use;
+    }
+}
+
 void *
 wmem_alloc(wmem_allocator_t *allocator, const size_t size)
 {
+    void *ptr;
+
     if (allocator == NULL) {
         return g_malloc(size);
     }
@@ -41,7 +68,11 @@ wmem_alloc(wmem_allocator_t *allocator, const size_t size)
         return NULL;
     }
 
-    return allocator->walloc(allocator->private_data, size);
+    allocator->stats.alloc_count++;
+    ptr = allocator->walloc(allocator->private_data, size);
+    wmem_stats_add(allocator, wmem_stats_size(allocator, ptr, size));
+
+    return ptr;
 }
 
 void *
@@ -72,6 +103,11 @@ wmem_free(wmem_allocator_t *allocator, void *ptr)
         return;
     }
 
+    allocator->stats.free_count++;
+    if (allocator->wsize) {
+        allocator->stats.bytes_in_use -= allocator->wsize(allocator->private_data, ptr);
+    }
+
     allocator->wfree(allocator->private_data, ptr);
 }
 
@@ -93,7 +129,16 @@ wmem_realloc(wmem_allocator_t *allocator, void *ptr, const size_t size)
 
     g_assert(allocator->in_scope);
 
-    return allocator->wrealloc(allocator->private_data, ptr, size);
+    allocator->stats.realloc_count++;
+    /* Without wsize we can't tell how much was there before, so the new
+     * size is counted on top of it. */
+    if (allocator->wsize) {
+        allocator->stats.bytes_in_use -= allocator->wsize(allocator->private_data, ptr);
+    }
+    ptr = allocator->wrealloc(allocator->private_data, ptr, size);
+    wmem_stats_add(allocator, wmem_stats_size(allocator, ptr, size));
+
+    return ptr;
 }
 
 static void
@@ -102,6 +147,8 @@ wmem_free_all_real(wmem_allocator_t *allocator, gboolean final)
     wmem_call_callbacks(allocator,
             final ? WMEM_CB_DESTROY_EVENT : WMEM_CB_FREE_EVENT);
     allocator->free_all(allocator->private_data);
+    allocator->stats.free_all_count++;
+    allocator->stats.bytes_in_use = 0;
 }
 
 void
@@ -122,6 +169,10 @@ wmem_destroy_allocator(wmem_allocator_t *allocator)
 
     wmem_free_all_real(allocator, TRUE);
     allocator->cleanup(allocator->private_data);
+    if (allocator->name) {
+        named_allocators = g_slist_remove(named_allocators, allocator);
+        wmem_free(NULL, allocator->name);
+    }
     wmem_free(NULL, allocator);
 }
 
@@ -142,6 +193,9 @@ wmem_allocator_new(const wmem_allocator_type_t type)
     allocator->type      = real_type;
     allocator->callbacks = NULL;
     allocator->in_scope  = TRUE;
+    allocator->wsize     = NULL;
+    allocator->name      = NULL;
+    memset(&allocator->stats, 0, sizeof(allocator->stats));
 
     switch (real_type) {
         case WMEM_ALLOCATOR_SIMPLE:
@@ -156,6 +210,9 @@ wmem_allocator_new(const wmem_allocator_type_t type)
         case WMEM_ALLOCATOR_STRICT:
             wmem_strict_allocator_init(allocator);
             break;
+        case WMEM_ALLOCATOR_SLAB:
+            wmem_slab_allocator_init(allocator);
+            break;
         default:
             g_assert_not_reached();
             /* This is necessary to squelch MSVC errors; is there
@@ -167,6 +224,40 @@ wmem_allocator_new(const wmem_allocator_type_t type)
     return allocator;
 }
 
+void
+wmem_allocator_set_name(wmem_allocator_t *allocator, const char *name)
+{
+    if (allocator->name) {
+        wmem_free(NULL, allocator->name);
+    }
+    else {
+        named_allocators = g_slist_append(named_allocators, allocator);
+    }
+    allocator->name = g_strdup(name);
+}
+
+const char *
+wmem_allocator_get_name(wmem_allocator_t *allocator)
+{
+    return allocator->name;
+}
+
+void
+wmem_allocator_get_stats(wmem_allocator_t *allocator, wmem_allocator_stats_t *stats)
+{
+    *stats = allocator->stats;
+}
+
+void
+wmem_foreach_named_allocator(wmem_allocator_func func, void *user_data)
+{
+    GSList *cur;
+
+    for (cur = named_allocators; cur; cur = cur->next) {
+        func((wmem_allocator_t *)cur->data, user_data);
+    }
+}
+
 void
 wmem_init(void)
 {
@@ -195,6 +286,9 @@ wmem_init(void)
         else if (strncmp(override_env, "block_fast", strlen("block_fast")) == 0) {
             override_type = WMEM_ALLOCATOR_BLOCK_FAST;
         }
+        else if (strncmp(override_env, "slab", strlen("slab")) == 0) {
+            override_type = WMEM_ALLOCATOR_SLAB;
+        }
         else {
             g_warning("Unrecognized wmem override");
             do_override = FALSE;
@@ -54,13 +54,32 @@ typedef enum _wmem_allocator_type_t {
                 memory usage via things like canaries and scrubbing freed
                 memory. Valgrind is the better choice on platforms that support
                 it. */
-    WMEM_ALLOCATOR_BLOCK_FAST /**< A block allocator like WMEM_ALLOCATOR_BLOCK
+    WMEM_ALLOCATOR_BLOCK_FAST, /**< A block allocator like WMEM_ALLOCATOR_BLOCK
                 but even faster by tracking absolutely minimal metadata and
                 making 'free' a no-op. Useful only for very short-lived scopes
                 where there's no reason to free individual allocations because
                 the next free_all is always just around the corner. */
+    WMEM_ALLOCATOR_SLAB /**< An allocator that serves small requests (256
+                bytes or less) from slabs of equally-sized objects, one size
+                class per multiple of 16 bytes, with no per-allocation header.
+                Freed objects are reused by later requests of the same class.
+                Designed for long-lived scopes full of small fixed-size
+                objects like conversations and their keys. */
 } wmem_allocator_type_t;
 
+/** Allocation statistics of a pool. Sizes are counted rounded up to a
+ * multiple of 16 bytes. Allocators that can't tell the size of an allocation
+ * (currently only WMEM_ALLOCATOR_SIMPLE) don't take freed memory off
+ * bytes_in_use until the next wmem_free_all(). */
+typedef struct _wmem_allocator_stats_t {
+    guint64 alloc_count;       /**< Calls to wmem_alloc() */
+    guint64 realloc_count;     /**< Calls to wmem_realloc() */
+    guint64 free_count;        /**< Calls to wmem_free() */
+    guint64 free_all_count;    /**< Calls to wmem_free_all() */
+    guint64 bytes_in_use;      /**< Bytes currently allocated */
+    guint64 peak_bytes_in_use; /**< Highest value of bytes_in_use so far */
+} wmem_allocator_stats_t;
+
 /** Allocate the requested amount of memory in the given pool.
  *
  * @param allocator The allocator object to use to allocate the memory.
@@ -195,6 +214,47 @@ WS_DLL_PUBLIC
 wmem_allocator_t *
 wmem_allocator_new(const wmem_allocator_type_t type);
 
+/** Give a pool a name, which makes its statistics available through
+ * wmem_foreach_named_allocator(). Pools are unnamed when they are created.
+ *
+ * @param allocator The allocator to name.
+ * @param name The name, which is copied.
+ */
+WS_DLL_PUBLIC
+void
+wmem_allocator_set_name(wmem_allocator_t *allocator, const char *name);
+
+/** Get the name of a pool.
+ *
+ * @param allocator The allocator.
+ * @return The name given with wmem_allocator_set_name(), or NULL.
+ */
+WS_DLL_PUBLIC
+const char *
+wmem_allocator_get_name(wmem_allocator_t *allocator);
+
+/** Get the allocation statistics of a pool.
+ *
+ * @param allocator The allocator.
+ * @param stats Filled in with the statistics.
+ */
+WS_DLL_PUBLIC
+void
+wmem_allocator_get_stats(wmem_allocator_t *allocator, wmem_allocator_stats_t *stats);
+
+/** Function called by wmem_foreach_named_allocator(). */
+typedef void (*wmem_allocator_func)(wmem_allocator_t *allocator, void *user_data);
+
+/** Call a function for every pool that has been given a name, in the order
+ * they were named. The function must not name or destroy pools.
+ *
+ * @param func The function to call.
+ * @param user_data Passed to func.
+ */
+WS_DLL_PUBLIC
+void
+wmem_foreach_named_allocator(wmem_allocator_func func, void *user_data);
+
 /** Initialize the wmem subsystem. This must be called before any other wmem
  * function, usually at the very beginning of your program.
  */
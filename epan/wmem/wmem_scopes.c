@@ -124,9 +124,13 @@ wmem_init_scopes(void)
     g_assert(epan_scope   == NULL);
 
     packet_scope = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
-    file_scope   = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+    file_scope   = wmem_allocator_new(WMEM_ALLOCATOR_SLAB);
     epan_scope   = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
 
+    wmem_allocator_set_name(packet_scope, "Packet scope");
+    wmem_allocator_set_name(file_scope,   "File scope");
+    wmem_allocator_set_name(epan_scope,   "Epan scope");
+
     /* Scopes are initialized to TRUE by default on creation */
     packet_scope->in_scope = FALSE;
     file_scope->in_scope   = FALSE;
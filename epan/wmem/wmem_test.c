@@ -21,6 +21,7 @@
 #include "wmem_allocator_block_fast.h"
 #include "wmem_allocator_simple.h"
 #include "wmem_allocator_strict.h"
+#include "wmem_allocator_slab.h"
 
 #include <wsutil/time_util.h>
 
@@ -43,6 +44,9 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
     allocator->type = type;
     allocator->callbacks = NULL;
     allocator->in_scope = TRUE;
+    allocator->wsize = NULL;
+    allocator->name = NULL;
+    memset(&allocator->stats, 0, sizeof(allocator->stats));
 
     switch (type) {
         case WMEM_ALLOCATOR_SIMPLE:
@@ -57,6 +61,9 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
         case WMEM_ALLOCATOR_STRICT:
             wmem_strict_allocator_init(allocator);
             break;
+        case WMEM_ALLOCATOR_SLAB:
+            wmem_slab_allocator_init(allocator);
+            break;
         default:
             g_assert_not_reached();
             /* This is necessary to squelch MSVC errors; is there
@@ -217,6 +224,16 @@ wmem_test_allocator_det(wmem_allocator_t *allocator, wmem_verify_func verify,
         wmem_free(allocator, ptrs[i]);
     }
 
+    /* everything has been freed, so the statistics must say so if the
+     * allocator can tell the size of its allocations */
+    if (allocator->wsize) {
+        wmem_allocator_stats_t stats;
+
+        wmem_allocator_get_stats(allocator, &stats);
+        g_assert_cmpuint(stats.bytes_in_use, ==, 0);
+        g_assert_cmpuint(stats.peak_bytes_in_use, >=, MAX_SIMULTANEOUS_ALLOCS*4*len);
+    }
+
     if (verify) (*verify)(allocator);
     wmem_free_all(allocator);
     wmem_gc(allocator);
@@ -369,6 +386,113 @@ wmem_test_allocator_strict(void)
     wmem_test_allocator_jumbo(WMEM_ALLOCATOR_STRICT, &wmem_strict_check_canaries);
 }
 
+static void
+wmem_test_allocator_slab(void)
+{
+    wmem_allocator_t       *allocator;
+    wmem_allocator_stats_t  stats;
+    char                   *ptrs[MAX_SIMULTANEOUS_ALLOCS];
+    int                     i, j;
+
+    wmem_test_allocator(WMEM_ALLOCATOR_SLAB, NULL,
+            MAX_SIMULTANEOUS_ALLOCS*64);
+    wmem_test_allocator_jumbo(WMEM_ALLOCATOR_SLAB, NULL);
+
+    /* The random tests above are mostly too big to land in a slab, so mix
+     * and resize small objects of every size class as well, checking that
+     * nothing overlaps. */
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_SLAB);
+
+    for (j=0; j<8; j++) {
+        for (i=0; i<MAX_SIMULTANEOUS_ALLOCS; i++) {
+            ptrs[i] = (char *)wmem_alloc(allocator, 1 + (i+j) % 300);
+            memset(ptrs[i], i & 0xFF, 1 + (i+j) % 300);
+        }
+        for (i=0; i<MAX_SIMULTANEOUS_ALLOCS; i+=3) {
+            ptrs[i] = (char *)wmem_realloc(allocator, ptrs[i], 1 + (i*7+j) % 300);
+            memset(ptrs[i], i & 0xFF, 1 + (i*7+j) % 300);
+        }
+        for (i=0; i<MAX_SIMULTANEOUS_ALLOCS; i++) {
+            g_assert(ptrs[i][0] == (char)(i & 0xFF));
+        }
+        for (i=0; i<MAX_SIMULTANEOUS_ALLOCS; i+=2) {
+            wmem_free(allocator, ptrs[i]);
+        }
+        for (i=1; i<MAX_SIMULTANEOUS_ALLOCS; i+=2) {
+            wmem_free(allocator, ptrs[i]);
+        }
+        wmem_allocator_get_stats(allocator, &stats);
+        g_assert_cmpuint(stats.bytes_in_use, ==, 0);
+
+        if (j % 2) {
+            wmem_free_all(allocator);
+            wmem_gc(allocator);
+        }
+    }
+
+    wmem_destroy_allocator(allocator);
+}
+
+static void
+wmem_test_name_cb(wmem_allocator_t *allocator, void *user_data)
+{
+    if (strcmp(wmem_allocator_get_name(allocator), "test pool") == 0) {
+        *(wmem_allocator_t **)user_data = allocator;
+    }
+}
+
+static void
+wmem_test_allocator_stats(void)
+{
+    wmem_allocator_t       *allocator, *found;
+    wmem_allocator_stats_t  stats;
+    void                   *ptr;
+
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_BLOCK);
+    g_assert(wmem_allocator_get_name(allocator) == NULL);
+
+    found = NULL;
+    wmem_foreach_named_allocator(wmem_test_name_cb, &found);
+    g_assert(found == NULL);
+
+    wmem_allocator_set_name(allocator, "test pool");
+    g_assert_cmpstr(wmem_allocator_get_name(allocator), ==, "test pool");
+    wmem_foreach_named_allocator(wmem_test_name_cb, &found);
+    g_assert(found == allocator);
+
+    /* zero-sized and NULL requests don't count */
+    wmem_alloc(allocator, 0);
+    wmem_free(allocator, NULL);
+
+    ptr = wmem_alloc(allocator, 20);
+    wmem_alloc(allocator, 100);
+    ptr = wmem_realloc(allocator, ptr, 60);
+    wmem_allocator_get_stats(allocator, &stats);
+    g_assert_cmpuint(stats.alloc_count, ==, 2);
+    g_assert_cmpuint(stats.realloc_count, ==, 1);
+    g_assert_cmpuint(stats.free_count, ==, 0);
+    g_assert_cmpuint(stats.bytes_in_use, ==, 64 + 112);
+    g_assert_cmpuint(stats.peak_bytes_in_use, ==, 64 + 112);
+
+    wmem_free(allocator, ptr);
+    wmem_allocator_get_stats(allocator, &stats);
+    g_assert_cmpuint(stats.free_count, ==, 1);
+    g_assert_cmpuint(stats.bytes_in_use, ==, 112);
+    g_assert_cmpuint(stats.peak_bytes_in_use, ==, 64 + 112);
+
+    wmem_free_all(allocator);
+    wmem_allocator_get_stats(allocator, &stats);
+    g_assert_cmpuint(stats.free_all_count, ==, 1);
+    g_assert_cmpuint(stats.bytes_in_use, ==, 0);
+    g_assert_cmpuint(stats.peak_bytes_in_use, ==, 64 + 112);
+
+    wmem_destroy_allocator(allocator);
+
+    found = NULL;
+    wmem_foreach_named_allocator(wmem_test_name_cb, &found);
+    g_assert(found == NULL);
+}
+
 /* UTILITY TESTING FUNCTIONS (/wmem/utils/) */
 
 static void
@@ -1438,6 +1562,8 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/allocator/blk_fast",  wmem_test_allocator_block_fast);
     g_test_add_func("/wmem/allocator/simple",    wmem_test_allocator_simple);
     g_test_add_func("/wmem/allocator/strict",    wmem_test_allocator_strict);
+    g_test_add_func("/wmem/allocator/slab",      wmem_test_allocator_slab);
+    g_test_add_func("/wmem/allocator/stats",     wmem_test_allocator_stats);
     g_test_add_func("/wmem/allocator/callbacks", wmem_test_allocator_callbacks);
 
     g_test_add_func("/wmem/utils/misc",    wmem_test_miscutls);
@@ -34,6 +34,7 @@
 #include <epan/prefs.h>
 #include <epan/dfilter/dfilter.h>
 #include <epan/epan_dissect.h>
+#include <epan/field_index.h>
 #include <epan/tap.h>
 #include <epan/dissectors/packet-ber.h>
 #include <epan/timestamp.h>
@@ -51,6 +52,7 @@
 #include "ui/alert_box.h"
 #include "ui/simple_dialog.h"
 #include "ui/main_statusbar.h"
+#include "ui/packet_search.h"
 #include "ui/progress_dlg.h"
 #include "ui/ws_ui_util.h"
 
@@ -68,11 +70,22 @@
 #ifdef _WIN32
 # include <winsock2.h>
 # include <ws2tcpip.h>
+#else
+# include <fcntl.h>
+# include <poll.h>
+# include <signal.h>
+# include <unistd.h>
+# include <sys/wait.h>
 #endif
 
 static gboolean read_record(capture_file *cf, wtap_rec *rec, Buffer *buf,
     dfilter_t *dfcode, epan_dissect_t *edt, column_info *cinfo, gint64 offset);
 
+#ifndef _WIN32
+static void filter_helper_start(capture_file *cf);
+static void filter_helper_stop(capture_file *cf);
+#endif
+
 static void rescan_packets(capture_file *cf, const char *action, const char *action_item, gboolean redissect);
 
 typedef enum {
@@ -87,15 +100,7 @@ static match_result match_protocol_tree(capture_file *cf, frame_data *fdata,
 static void match_subtree_text(proto_node *node, gpointer data);
 static match_result match_summary_line(capture_file *cf, frame_data *fdata,
     wtap_rec *, Buffer *, void *criterion);
-static match_result match_narrow_and_wide(capture_file *cf, frame_data *fdata,
-    wtap_rec *, Buffer *, void *criterion);
-static match_result match_narrow(capture_file *cf, frame_data *fdata,
-    wtap_rec *, Buffer *, void *criterion);
-static match_result match_wide(capture_file *cf, frame_data *fdata,
-    wtap_rec *, Buffer *, void *criterion);
-static match_result match_binary(capture_file *cf, frame_data *fdata,
-    wtap_rec *, Buffer *, void *criterion);
-static match_result match_regex(capture_file *cf, frame_data *fdata,
+static match_result match_bytes(capture_file *cf, frame_data *fdata,
     wtap_rec *, Buffer *, void *criterion);
 static match_result match_dfilter(capture_file *cf, frame_data *fdata,
     wtap_rec *, Buffer *, void *criterion);
@@ -232,7 +237,8 @@ ws_epan_new(capture_file *cf)
     ws_get_frame_ts,
     cap_file_provider_get_interface_name,
     cap_file_provider_get_interface_description,
-    cap_file_provider_get_user_comment
+    cap_file_provider_get_user_comment,
+    cap_file_provider_get_shift_offset
   };
 
   return epan_new(&cf->provider, &funcs);
@@ -294,6 +300,9 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   /* Allocate a frame_data_sequence for the frames in this file */
   cf->provider.frames = new_frame_data_sequence();
 
+  /* Index the fields the user wants to filter on quickly, if any */
+  cf->field_index = field_index_new(prefs.gui_field_index);
+
   nstime_set_zero(&cf->elapsed_time);
   cf->provider.ref = NULL;
   cf->provider.prev_dis = NULL;
@@ -387,10 +396,21 @@ cf_close(capture_file *cf)
     free_frame_data_sequence(cf->provider.frames);
     cf->provider.frames = NULL;
   }
+  if (cf->field_index != NULL) {
+    field_index_free(cf->field_index);
+    cf->field_index = NULL;
+  }
+#ifndef _WIN32
+  filter_helper_stop(cf);
+#endif
   if (cf->provider.frames_user_comments) {
     g_tree_destroy(cf->provider.frames_user_comments);
     cf->provider.frames_user_comments = NULL;
   }
+  if (cf->provider.frames_shift_offsets) {
+    g_tree_destroy(cf->provider.frames_shift_offsets);
+    cf->provider.frames_shift_offsets = NULL;
+  }
   cf_unselect_packet(cf);   /* nothing to select */
   cf->first_displayed = 0;
   cf->last_displayed = 0;
@@ -537,6 +557,11 @@ cf_read(capture_file *cf, gboolean reloading)
 
   reset_tap_listeners();
 
+#ifndef _WIN32
+  /* Have the helper read the file while we do. */
+  filter_helper_start(cf);
+#endif
+
   name_ptr = g_filename_display_basename(cf->filename);
 
   if (reloading)
@@ -1145,13 +1170,24 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
     epan_dissect_t *edt, dfilter_t *dfcode, column_info *cinfo,
     wtap_rec *rec, Buffer *buf, gboolean add_to_packet_list)
 {
+  gboolean index_frame;
+
   frame_data_set_before_dissect(fdata, &cf->elapsed_time,
                                 &cf->provider.ref, cf->provider.prev_dis);
   cf->provider.prev_cap = fdata;
 
+  /* Only index frames that have been dissected before; fields such as
+     dns.response_in refer to later frames, so on the first pass they're
+     missing from frames in which later passes will have them. */
+  index_frame = cf->field_index != NULL && fdata->visited &&
+                fdata->num == field_index_frame_count(cf->field_index) + 1;
+
   if (dfcode != NULL) {
       epan_dissect_prime_with_dfilter(edt, dfcode);
   }
+  if (index_frame) {
+      field_index_prime_edt(cf->field_index, edt);
+  }
 #if 0
   /* Prepare coloring rules, this ensures that display filter rules containing
    * frame.color_rule references are still processed.
@@ -1170,9 +1206,12 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
 
   /* Dissect the frame. */
   epan_dissect_run_with_taps(edt, cf->cd_t, rec,
-                             frame_tvbuff_new_buffer(&cf->provider, fdata, buf),
+                             frame_tvbuff_new(&cf->provider, fdata, wtap_rec_data(rec, buf)),
                              fdata, cinfo);
 
+  if (index_frame)
+    field_index_add(cf->field_index, fdata->num, edt);
+
   /* If we don't have a display filter, set "passed_dfilter" to 1. */
   if (dfcode != NULL) {
     fdata->passed_dfilter = dfilter_apply_edt(dfcode, edt) ? 1 : 0;
@@ -1211,6 +1250,42 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
   epan_dissect_reset(edt);
 }
 
+/*
+ * The equivalent of add_packet_to_packet_list() for a frame that we know
+ * the filter result for without dissecting it, along with the frames on
+ * which it depends.
+ */
+static void
+add_filtered_packet_to_packet_list(frame_data *fdata, capture_file *cf,
+    gboolean passed, const guint32 *depended_upon, guint num_depended_upon)
+{
+  guint i;
+
+  frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                &cf->provider.ref, cf->provider.prev_dis);
+  cf->provider.prev_cap = fdata;
+
+  fdata->passed_dfilter = passed ? 1 : 0;
+  if (fdata->passed_dfilter) {
+    for (i = 0; i < num_depended_upon; i++)
+      find_and_mark_frame_depended_upon(GUINT_TO_POINTER(depended_upon[i]), cf->provider.frames);
+  }
+
+  if (fdata->passed_dfilter || fdata->ref_time)
+  {
+    cf->displayed_count++;
+    frame_data_set_after_dissect(fdata, &cf->cum_bytes);
+    cf->provider.prev_dis = fdata;
+
+    /* If we haven't yet seen the first frame, this is it. */
+    if (cf->first_displayed == 0)
+      cf->first_displayed = fdata->num;
+
+    /* This is the last frame we've seen so far. */
+    cf->last_displayed = fdata->num;
+  }
+}
+
 /*
  * Read in a new record.
  * Returns TRUE if the packet was added to the packet (record) list,
@@ -1245,7 +1320,7 @@ read_record(capture_file *cf, wtap_rec *rec, Buffer *buf, dfilter_t *dfcode,
     epan_dissect_init(&rf_edt, cf->epan, TRUE, FALSE);
     epan_dissect_prime_with_dfilter(&rf_edt, cf->rfcode);
     epan_dissect_run(&rf_edt, cf->cd_t, rec,
-                     frame_tvbuff_new_buffer(&cf->provider, &fdlocal, buf),
+                     frame_tvbuff_new(&cf->provider, &fdlocal, wtap_rec_data(rec, buf)),
                      &fdlocal, NULL);
     passed = dfilter_apply_edt(cf->rfcode, &rf_edt);
     epan_dissect_cleanup(&rf_edt);
@@ -1395,6 +1470,7 @@ cf_merge_files_to_tempfile(gpointer pd_window, char **out_filenamep,
                                    in_filenames,
                                    in_file_count, do_append,
                                    IDB_MERGE_MODE_ALL_SAME, 0 /* snaplen */,
+                                   0 /* read_ahead */,
                                    "Wireshark", &cb, &err, &err_info,
                                    &err_fileno, &err_framenum);
 
@@ -1570,6 +1646,256 @@ cf_read_current_record(capture_file *cf)
   return cf_read_record(cf, cf->current_frame, &cf->rec, &cf->buf);
 }
 
+#ifndef _WIN32
+/*
+ * Filtering with a helper process.
+ *
+ * Once every frame has been dissected, the dissectors mostly look up the
+ * state they built the first time round, so when only the display filter
+ * has changed, frames can be filtered independently of each other.  The
+ * dissection engine keeps too much global state for us to do that in
+ * threads, and a process with as many threads as ours can't safely fork
+ * and go on dissecting in the child.  Instead, as we start reading a file,
+ * we spawn TShark with --filter-server on it; it reads the file alongside
+ * us, building the same state, and can then fork workers to filter
+ * contiguous ranges of frames.  It sends us, for each frame in order,
+ * whether it passed and which frames it depends on, and we do everything
+ * else as if we'd filtered the frames ourselves.
+ *
+ * The helper gets its settings from the current profile on disk, so once
+ * we've had to redissect the frames, which means something that affects
+ * the dissection has changed, we stop using it.
+ */
+
+/* Don't bother with the helper for fewer frames per worker than this. */
+#define FILTER_WORKER_MIN_FRAMES 10000
+
+struct filter_helper {
+  GPid        pid;
+  int         to_fd;            /* its standard input */
+  int         from_fd;          /* its standard output */
+  gboolean    ready;            /* TRUE once it has read the file */
+  guint32     count;            /* number of frames it read */
+  gboolean    failed;           /* TRUE if we have to filter the frames ourselves */
+  GByteArray *results;          /* results read from it */
+  guint       pos;              /* offset in results of the next one */
+  gboolean    passed;           /* result for the frame just taken */
+  GArray     *depended_upon;    /* guint32 frame numbers for the frame just taken */
+};
+
+static void
+filter_helper_stop(capture_file *cf)
+{
+  struct filter_helper *helper = cf->filter_helper;
+
+  if (helper == NULL)
+    return;
+  close(helper->to_fd);
+  close(helper->from_fd);
+  kill(helper->pid, SIGKILL);
+  waitpid(helper->pid, NULL, 0);
+  g_spawn_close_pid(helper->pid);
+  g_byte_array_free(helper->results, TRUE);
+  g_array_free(helper->depended_upon, TRUE);
+  g_free(helper);
+  cf->filter_helper = NULL;
+}
+
+/*
+ * Start the helper for the file we're about to read, if we've been asked
+ * to filter with workers and can.
+ */
+static void
+filter_helper_start(capture_file *cf)
+{
+  struct filter_helper *helper;
+  GPtrArray *args;
+  GString   *resolve;
+  gchar     *exename;
+  GPid       pid;
+  int        to_fd, from_fd;
+  gboolean   spawned;
+
+  filter_helper_stop(cf);
+
+  /* The frame numbers have to be the same as ours. */
+  if (prefs.gui_filter_workers < 2 || cf->rfcode != NULL || cf->is_tempfile)
+    return;
+
+  /* Seeking in a compressed file from scratch in each worker is slow. */
+  if (wtap_get_compression_type(cf->provider.wth) != WTAP_UNCOMPRESSED)
+    return;
+
+  exename = g_strdup_printf("%s" G_DIR_SEPARATOR_S "tshark", get_progfile_dir());
+  args = g_ptr_array_new_with_free_func(g_free);
+  g_ptr_array_add(args, exename);
+  if (!is_default_profile()) {
+    g_ptr_array_add(args, g_strdup("-C"));
+    g_ptr_array_add(args, g_strdup(get_profile_name()));
+  }
+  /* Our name resolution settings might not be those of the profile. */
+  resolve = g_string_new("");
+  if (gbl_resolv_flags.mac_name)
+    g_string_append_c(resolve, 'm');
+  if (gbl_resolv_flags.network_name)
+    g_string_append_c(resolve, 'n');
+  if (gbl_resolv_flags.use_external_net_name_resolver)
+    g_string_append_c(resolve, 'N');
+  if (gbl_resolv_flags.transport_name)
+    g_string_append_c(resolve, 't');
+  if (gbl_resolv_flags.dns_pkt_addr_resolution)
+    g_string_append_c(resolve, 'd');
+  if (gbl_resolv_flags.vlan_name)
+    g_string_append_c(resolve, 'v');
+  if (resolve->len != 0) {
+    g_ptr_array_add(args, g_strdup("-N"));
+    g_ptr_array_add(args, g_string_free(resolve, FALSE));
+  } else {
+    g_ptr_array_add(args, g_strdup("-n"));
+    g_string_free(resolve, TRUE);
+  }
+  g_ptr_array_add(args, g_strdup("-r"));
+  g_ptr_array_add(args, g_strdup(cf->filename));
+  g_ptr_array_add(args, g_strdup("--filter-server"));
+  g_ptr_array_add(args, NULL);
+
+  spawned = g_spawn_async_with_pipes(NULL, (gchar **)args->pdata, NULL,
+                                     (GSpawnFlags)(G_SPAWN_DO_NOT_REAP_CHILD|G_SPAWN_STDERR_TO_DEV_NULL),
+                                     NULL, NULL, &pid, &to_fd, &from_fd, NULL, NULL);
+  g_ptr_array_free(args, TRUE);
+  if (!spawned)
+    return;
+
+  /* Don't let anything else we start hold on to its pipes. */
+  fcntl(to_fd, F_SETFD, FD_CLOEXEC);
+  fcntl(from_fd, F_SETFD, FD_CLOEXEC);
+
+  helper = g_new0(struct filter_helper, 1);
+  helper->pid = pid;
+  helper->to_fd = to_fd;
+  helper->from_fd = from_fd;
+  helper->results = g_byte_array_new();
+  helper->depended_upon = g_array_new(FALSE, FALSE, sizeof(guint32));
+  cf->filter_helper = helper;
+}
+
+/*
+ * Read from the helper until we have at least len bytes of results we
+ * haven't taken.  Returns FALSE if it stopped before sending that much.
+ */
+static gboolean
+filter_helper_read(struct filter_helper *helper, guint len)
+{
+  guint8  chunk[65536];
+  ssize_t nread;
+
+  if (helper->pos > 1024 * 1024) {
+    g_byte_array_remove_range(helper->results, 0, helper->pos);
+    helper->pos = 0;
+  }
+
+  while (helper->results->len - helper->pos < len) {
+    nread = read(helper->from_fd, chunk, sizeof chunk);
+    if (nread > 0)
+      g_byte_array_append(helper->results, chunk, (guint)nread);
+    else if (nread == 0 || errno != EINTR)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/*
+ * Ask the helper to filter the frames of cf with dfcode, if it can.
+ * Returns FALSE if we have to filter them ourselves.
+ */
+static gboolean
+filter_helper_request(capture_file *cf, dfilter_t *dfcode, guint32 frames_count)
+{
+  struct filter_helper *helper = cf->filter_helper;
+  struct pollfd pfd;
+  guint32       request[2];
+  guint         num_workers;
+  size_t        len;
+
+  num_workers = MIN(prefs.gui_filter_workers, frames_count / FILTER_WORKER_MIN_FRAMES);
+  if (helper == NULL || num_workers < 2 || dfcode == NULL ||
+      cf->dfilter == NULL || cf->state != FILE_READ_DONE)
+    return FALSE;
+
+  /*
+   * Taps see every frame, in order, and frame.time_delta_displayed
+   * depends on the filter results for the frames before.  The helper
+   * doesn't know about the frames we've marked, ignored or made time
+   * references, or about comments and time shifts we haven't saved.
+   */
+  if (tap_listeners_require_dissection() ||
+      dfilter_interested_in_field(dfcode, proto_registrar_get_id_byname("frame.time_delta_displayed")) ||
+      dfilter_interested_in_field(dfcode, proto_registrar_get_id_byname("frame.marked")) ||
+      cf->ignored_count != 0 || cf->ref_time_count != 0 || cf->unsaved_changes)
+    return FALSE;
+
+  /* Don't wait for it to finish reading the file. */
+  if (!helper->ready) {
+    pfd.fd = helper->from_fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, 0) != 1)
+      return FALSE;
+    if (!filter_helper_read(helper, sizeof helper->count)) {
+      filter_helper_stop(cf);
+      return FALSE;
+    }
+    memcpy(&helper->count, helper->results->data + helper->pos, sizeof helper->count);
+    helper->pos += sizeof helper->count;
+    helper->ready = TRUE;
+  }
+  if (helper->count != frames_count) {
+    filter_helper_stop(cf);
+    return FALSE;
+  }
+
+  len = strlen(cf->dfilter);
+  request[0] = num_workers;
+  request[1] = (guint32)len;
+  if (ws_write(helper->to_fd, request, sizeof request) != (int)sizeof request ||
+      ws_write(helper->to_fd, cf->dfilter, (unsigned int)len) != (int)len) {
+    filter_helper_stop(cf);
+    return FALSE;
+  }
+  helper->failed = FALSE;
+  return TRUE;
+}
+
+/*
+ * Take the result for frame framenum from the helper.  Returns FALSE if
+ * there isn't one, in which case we have to filter the frame ourselves.
+ */
+static gboolean
+filter_helper_take(struct filter_helper *helper, guint32 framenum)
+{
+  guint32 result[3];
+
+  if (helper->failed)
+    return FALSE;
+
+  if (filter_helper_read(helper, sizeof result)) {
+    memcpy(result, helper->results->data + helper->pos, sizeof result);
+    if (result[0] == framenum &&
+        filter_helper_read(helper, sizeof result + result[2] * sizeof(guint32))) {
+      g_array_set_size(helper->depended_upon, result[2]);
+      memcpy(helper->depended_upon->data, helper->results->data + helper->pos + sizeof result,
+             result[2] * sizeof(guint32));
+      helper->pos += (guint)(sizeof result + result[2] * sizeof(guint32));
+      helper->passed = result[1] != 0;
+      return TRUE;
+    }
+  }
+
+  /* It failed; do the rest of the frames ourselves. */
+  helper->failed = TRUE;
+  return FALSE;
+}
+#endif /* _WIN32 */
+
 /* Rescan the list of packets, reconstructing the CList.
 
    "action" describes why we're doing this; it's used in the progress
@@ -1608,6 +1934,14 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
   gboolean    compiled;
   guint32     frames_count;
   gboolean    queued_rescan_type = RESCAN_NONE;
+  gboolean    use_index = FALSE;
+  gboolean    have_result;
+  gboolean    passed;
+  const guint32 *depended_upon;
+  guint       num_depended_upon;
+#ifndef _WIN32
+  gboolean    use_helper = FALSE;
+#endif
 
   /* Rescan in progress, clear pending actions. */
   cf->redissection_queued = RESCAN_NONE;
@@ -1641,12 +1975,17 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
    *    one of the tap listeners requires a protocol tree;
    *
    *    we're redissecting and a postdissector wants field
-   *    values or protocols on the first pass.
+   *    values or protocols on the first pass;
+   *
+   *    we're not redissecting and there are frames that haven't
+   *    been added to the field index yet.
    */
   create_proto_tree =
     (dfcode != NULL || have_filtering_tap_listeners() ||
      (tap_flags & TL_REQUIRES_PROTO_TREE) ||
-     (redissect && postdissectors_want_hfids()));
+     (redissect && postdissectors_want_hfids()) ||
+     (!redissect && cf->field_index != NULL &&
+      field_index_frame_count(cf->field_index) < cf->count));
 
   reset_tap_listeners();
   /* Which frame, if any, is the currently selected frame?
@@ -1672,6 +2011,11 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
        want to dissect those before their time. */
     cf->redissecting = TRUE;
 
+#ifndef _WIN32
+    /* The helper's dissection state no longer matches ours. */
+    filter_helper_stop(cf);
+#endif
+
     /* 'reset' dissection session */
     epan_free(cf->epan);
     if (cf->edt && cf->edt->pi.fd) {
@@ -1689,6 +2033,10 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
       create_proto_tree = TRUE;
     }
 
+    /* The indexed values may change along with the dissection. */
+    if (cf->field_index != NULL)
+      field_index_clear(cf->field_index);
+
     /* We need to redissect the packets so we have to discard our old
      * packet list store. */
     packet_list_clear();
@@ -1746,7 +2094,18 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
      * read secrets.
      */
     wtap_set_cb_new_secrets(cf->provider.wth, secrets_wtap_callback);
+  } else if (cf->field_index != NULL &&
+             field_index_frame_count(cf->field_index) >= frames_count &&
+             !tap_listeners_require_dissection() &&
+             (dfcode == NULL || field_index_can_filter(cf->field_index, dfcode))) {
+    /* Every field the filter tests is in the index; no need to dissect. */
+    use_index = TRUE;
   }
+#ifndef _WIN32
+  else {
+    use_helper = filter_helper_request(cf, dfcode, frames_count);
+  }
+#endif
 
   for (framenum = 1; framenum <= frames_count; framenum++) {
     fdata = frame_data_sequence_find(cf->provider.frames, framenum);
@@ -1820,7 +2179,28 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     /* Frame dependencies from the previous dissection/filtering are no longer valid. */
     fdata->dependent_of_displayed = 0;
 
-    if (!cf_read_record(cf, fdata, &rec, &buf))
+    /* Do we know the result without dissecting the frame? */
+    have_result = FALSE;
+    if (use_index) {
+      if (dfcode != NULL) {
+        passed = field_index_filter(cf->field_index, dfcode, framenum);
+        depended_upon = field_index_dependent_frames(cf->field_index, framenum, &num_depended_upon);
+      } else {
+        passed = TRUE;
+        depended_upon = NULL;
+        num_depended_upon = 0;
+      }
+      have_result = TRUE;
+    }
+#ifndef _WIN32
+    else if (use_helper && filter_helper_take(cf->filter_helper, framenum)) {
+      passed = cf->filter_helper->passed;
+      depended_upon = (const guint32 *)(void *)cf->filter_helper->depended_upon->data;
+      num_depended_upon = cf->filter_helper->depended_upon->len;
+      have_result = TRUE;
+    }
+#endif
+    if (!have_result && !cf_read_record(cf, fdata, &rec, &buf))
       break; /* error reading the frame */
 
     /* If the previous frame is displayed, and we haven't yet seen the
@@ -1831,9 +2211,13 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
       preceding_frame = prev_frame;
     }
 
-    add_packet_to_packet_list(fdata, cf, &edt, dfcode,
-                                    cinfo, &rec, &buf,
-                                    add_to_packet_list);
+    if (have_result)
+      add_filtered_packet_to_packet_list(fdata, cf, passed, depended_upon,
+                                         num_depended_upon);
+    else
+      add_packet_to_packet_list(fdata, cf, &edt, dfcode,
+                                cinfo, &rec, &buf,
+                                add_to_packet_list);
 
     /* If this frame is displayed, and this is the first frame we've
        seen displayed after the selected frame, remember this frame -
@@ -1855,6 +2239,11 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, gb
     prev_frame = fdata;
   }
 
+#ifndef _WIN32
+  /* If we stopped early, or it failed, we can't tell where it's got to. */
+  if (use_helper && (framenum <= frames_count || cf->filter_helper->failed))
+    filter_helper_stop(cf);
+#endif
   epan_dissect_cleanup(&edt);
   wtap_rec_cleanup(&rec);
   ws_buffer_free(&buf);
@@ -3208,215 +3597,137 @@ match_summary_line(capture_file *cf, frame_data *fdata,
 }
 
 typedef struct {
-    const guint8 *data;
-    size_t        data_len;
-} cbs_t;    /* "Counted byte string" */
-
+  packet_search_t       search;
+  packet_search_scan_t *scan;   /* block scan of the file, if we can do one */
+} search_bytes_t;
 
 /*
- * The current match_* routines only support ASCII case insensitivity and don't
- * convert UTF-8 inputs to UTF-16 for matching.
- *
- * We could modify them to use the GLib Unicode routines or the International
- * Components for Unicode library but it's not apparent that we could do so
- * without consuming a lot more CPU and memory or that searching would be
- * significantly better.
+ * Can a block scan of the file find the search string in the record data?
+ * It can if the file isn't compressed and stores each record's data
+ * unchanged after the record's offset and before the next record's;
+ * pcap and pcapng do, except where their readers rewrite byte-swapped
+ * pseudo-headers in the data.
  */
+static gboolean
+search_can_scan_file(capture_file *cf)
+{
+  if (cf->provider.wth == NULL ||
+      wtap_get_compression_type(cf->provider.wth) != WTAP_UNCOMPRESSED)
+    return FALSE;
+
+  switch (wtap_file_type_subtype(cf->provider.wth)) {
+
+  case WTAP_FILE_TYPE_SUBTYPE_PCAP:
+  case WTAP_FILE_TYPE_SUBTYPE_PCAPNG:
+  case WTAP_FILE_TYPE_SUBTYPE_PCAP_NSEC:
+  case WTAP_FILE_TYPE_SUBTYPE_PCAP_AIX:
+  case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS991029:
+  case WTAP_FILE_TYPE_SUBTYPE_PCAP_NOKIA:
+  case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS990417:
+  case WTAP_FILE_TYPE_SUBTYPE_PCAP_SS990915:
+    break;
+
+  default:
+    return FALSE;
+  }
+
+  switch (wtap_file_encap(cf->provider.wth)) {
+
+  case WTAP_ENCAP_PER_PACKET:
+  case WTAP_ENCAP_SLL:
+  case WTAP_ENCAP_USB_LINUX:
+  case WTAP_ENCAP_USB_LINUX_MMAPPED:
+  case WTAP_ENCAP_NFLOG:
+    return FALSE;
+
+  default:
+    return TRUE;
+  }
+}
 
 gboolean
 cf_find_packet_data(capture_file *cf, const guint8 *string, size_t string_size,
                     search_direction dir)
 {
-  cbs_t info;
+  search_bytes_t info;
+  gboolean       result;
 
-  info.data = string;
-  info.data_len = string_size;
+  if (string_size == 0)
+    return FALSE;
 
   /* Regex, String or hex search? */
   if (cf->regex) {
     /* Regular Expression search */
-    return find_packet(cf, match_regex, NULL, dir);
+    packet_search_init_regex(&info.search, cf->regex);
   } else if (cf->string) {
     /* String search - what type of string? */
     switch (cf->scs_type) {
 
     case SCS_NARROW_AND_WIDE:
-      return find_packet(cf, match_narrow_and_wide, &info, dir);
+      packet_search_init(&info.search, PACKET_SEARCH_NARROW_AND_WIDE,
+                         string, string_size, cf->case_type);
+      break;
 
     case SCS_NARROW:
-      return find_packet(cf, match_narrow, &info, dir);
+      packet_search_init(&info.search, PACKET_SEARCH_NARROW,
+                         string, string_size, cf->case_type);
+      break;
 
     case SCS_WIDE:
-      return find_packet(cf, match_wide, &info, dir);
+      packet_search_init(&info.search, PACKET_SEARCH_WIDE,
+                         string, string_size, cf->case_type);
+      break;
 
     default:
       g_assert_not_reached();
       return FALSE;
     }
   } else
-    return find_packet(cf, match_binary, &info, dir);
-}
-
-static match_result
-match_narrow_and_wide(capture_file *cf, frame_data *fdata,
-                      wtap_rec *rec, Buffer *buf, void *criterion)
-{
-  cbs_t        *info       = (cbs_t *)criterion;
-  const guint8 *ascii_text = info->data;
-  size_t        textlen    = info->data_len;
-  match_result  result;
-  guint32       buf_len;
-  guint8       *pd;
-  guint32       i;
-  guint8        c_char;
-  size_t        c_match    = 0;
+    packet_search_init(&info.search, PACKET_SEARCH_BINARY,
+                       string, string_size, FALSE);
 
-  /* Load the frame's data. */
-  if (!cf_read_record(cf, fdata, rec, buf)) {
-    /* Attempt to get the packet failed. */
-    return MR_ERROR;
-  }
+  /*
+   * Rather than reading and matching every record, read the file in
+   * large blocks and skip the records that don't have the string.
+   */
+  info.scan = NULL;
+  if (search_can_scan_file(cf))
+    info.scan = packet_search_scan_new(&info.search, cf->filename,
+                                       dir == SD_BACKWARD);
 
-  result = MR_NOTMATCHED;
-  buf_len = fdata->cap_len;
-  pd = ws_buffer_start_ptr(buf);
-  i = 0;
-  while (i < buf_len) {
-    c_char = pd[i];
-    if (cf->case_type)
-      c_char = g_ascii_toupper(c_char);
-    if (c_char != '\0') {
-      if (c_char == ascii_text[c_match]) {
-        c_match += 1;
-        if (c_match == textlen) {
-          result = MR_MATCHED;
-          cf->search_pos = i; /* Save the position of the last character
-                                 for highlighting the field. */
-          cf->search_len = (guint32)textlen;
-          break;
-        }
-      }
-      else {
-        g_assert(i>=c_match);
-        i -= (guint32)c_match;
-        c_match = 0;
-      }
-    }
-    i += 1;
-  }
+  result = find_packet(cf, match_bytes, &info, dir);
+  packet_search_scan_free(info.scan);
   return result;
 }
 
-static match_result
-match_narrow(capture_file *cf, frame_data *fdata,
-             wtap_rec *rec, Buffer *buf, void *criterion)
+/*
+ * Could the data of a record be in the block scan's hits?  A record's
+ * data is somewhere between its offset and the next record's; we don't
+ * know where the last record ends, so it's always looked at.
+ */
+static gboolean
+match_bytes_may_match(capture_file *cf, frame_data *fdata,
+                      packet_search_scan_t *scan)
 {
-  cbs_t        *info       = (cbs_t *)criterion;
-  const guint8 *ascii_text = info->data;
-  size_t        textlen    = info->data_len;
-  match_result  result;
-  guint32       buf_len;
-  guint8       *pd;
-  guint32       i;
-  guint8        c_char;
-  size_t        c_match    = 0;
-
-  /* Load the frame's data. */
-  if (!cf_read_record(cf, fdata, rec, buf)) {
-    /* Attempt to get the packet failed. */
-    return MR_ERROR;
-  }
+  frame_data *next_fd;
 
-  result = MR_NOTMATCHED;
-  buf_len = fdata->cap_len;
-  pd = ws_buffer_start_ptr(buf);
-  i = 0;
-  while (i < buf_len) {
-    c_char = pd[i];
-    if (cf->case_type)
-      c_char = g_ascii_toupper(c_char);
-    if (c_char == ascii_text[c_match]) {
-      c_match += 1;
-      if (c_match == textlen) {
-        result = MR_MATCHED;
-        cf->search_pos = i; /* Save the position of the last character
-                               for highlighting the field. */
-        cf->search_len = (guint32)textlen;
-        break;
-      }
-    }
-    else {
-      g_assert(i>=c_match);
-      i -= (guint32)c_match;
-      c_match = 0;
-    }
-    i += 1;
-  }
-
-  return result;
+  if (fdata->num >= cf->count)
+    return TRUE;
+  next_fd = frame_data_sequence_find(cf->provider.frames, fdata->num + 1);
+  if (next_fd == NULL)
+    return TRUE;
+  return packet_search_scan_may_match(scan, fdata->file_off, next_fd->file_off);
 }
 
 static match_result
-match_wide(capture_file *cf, frame_data *fdata,
-           wtap_rec *rec, Buffer *buf, void *criterion)
+match_bytes(capture_file *cf, frame_data *fdata,
+            wtap_rec *rec, Buffer *buf, void *criterion)
 {
-  cbs_t        *info       = (cbs_t *)criterion;
-  const guint8 *ascii_text = info->data;
-  size_t        textlen    = info->data_len;
-  match_result  result;
-  guint32       buf_len;
-  guint8       *pd;
-  guint32       i;
-  guint8        c_char;
-  size_t        c_match    = 0;
+  search_bytes_t *info = (search_bytes_t *)criterion;
+  guint32         last, match_len;
 
-  /* Load the frame's data. */
-  if (!cf_read_record(cf, fdata, rec, buf)) {
-    /* Attempt to get the packet failed. */
-    return MR_ERROR;
-  }
-
-  result = MR_NOTMATCHED;
-  buf_len = fdata->cap_len;
-  pd = ws_buffer_start_ptr(buf);
-  i = 0;
-  while (i < buf_len) {
-    c_char = pd[i];
-    if (cf->case_type)
-      c_char = g_ascii_toupper(c_char);
-    if (c_char == ascii_text[c_match]) {
-      c_match += 1;
-      if (c_match == textlen) {
-        result = MR_MATCHED;
-        cf->search_pos = i; /* Save the position of the last character
-                               for highlighting the field. */
-        cf->search_len = (guint32)textlen;
-        break;
-      }
-      i += 1;
-    }
-    else {
-      g_assert(i>=(c_match*2));
-      i -= (guint32)c_match*2;
-      c_match = 0;
-    }
-    i += 1;
-  }
-  return result;
-}
-
-static match_result
-match_binary(capture_file *cf, frame_data *fdata,
-             wtap_rec *rec, Buffer *buf, void *criterion)
-{
-  cbs_t        *info        = (cbs_t *)criterion;
-  const guint8 *binary_data = info->data;
-  size_t        datalen     = info->data_len;
-  match_result  result;
-  guint32       buf_len;
-  guint8       *pd;
-  guint32       i;
-  size_t        c_match     = 0;
+  if (info->scan != NULL && !match_bytes_may_match(cf, fdata, info->scan))
+    return MR_NOTMATCHED;
 
   /* Load the frame's data. */
   if (!cf_read_record(cf, fdata, rec, buf)) {
@@ -3424,54 +3735,14 @@ match_binary(capture_file *cf, frame_data *fdata,
     return MR_ERROR;
   }
 
-  result = MR_NOTMATCHED;
-  buf_len = fdata->cap_len;
-  pd = ws_buffer_start_ptr(buf);
-  i = 0;
-  while (i < buf_len) {
-    if (pd[i] == binary_data[c_match]) {
-      c_match += 1;
-      if (c_match == datalen) {
-        result = MR_MATCHED;
-        cf->search_pos = i; /* Save the position of the last character
-                               for highlighting the field. */
-        cf->search_len = (guint32)datalen;
-        break;
-      }
-    }
-    else {
-      g_assert(i>=c_match);
-      i -= (guint32)c_match;
-      c_match = 0;
-    }
-    i += 1;
-  }
-  return result;
-}
-
-static match_result
-match_regex(capture_file *cf, frame_data *fdata,
-            wtap_rec *rec, Buffer *buf, void *criterion _U_)
-{
-    match_result  result = MR_NOTMATCHED;
-    GMatchInfo   *match_info = NULL;
+  if (!packet_search_match(&info->search, ws_buffer_start_ptr(buf),
+                           fdata->cap_len, &last, &match_len))
+    return MR_NOTMATCHED;
 
-    /* Load the frame's data. */
-    if (!cf_read_record(cf, fdata, rec, buf)) {
-        /* Attempt to get the packet failed. */
-        return MR_ERROR;
-    }
-
-    if (g_regex_match_full(cf->regex, (const gchar *)ws_buffer_start_ptr(buf), fdata->cap_len,
-                           0, (GRegexMatchFlags) 0, &match_info, NULL))
-    {
-        gint start_pos = 0, end_pos = 0;
-        g_match_info_fetch_pos (match_info, 0, &start_pos, &end_pos);
-        cf->search_pos = end_pos - 1;
-        cf->search_len = end_pos - start_pos;
-        result = MR_MATCHED;
-    }
-    return result;
+  cf->search_pos = last; /* Save the position of the last character
+                            for highlighting the field. */
+  cf->search_len = match_len;
+  return MR_MATCHED;
 }
 
 gboolean
@@ -90,3 +90,30 @@ cap_file_provider_set_user_comment(struct packet_provider_data *prov, frame_data
 
   fd->has_user_comment = TRUE;
 }
+
+const nstime_t *
+cap_file_provider_get_shift_offset(struct packet_provider_data *prov, const frame_data *fd)
+{
+  if (fd->has_shift_offset && prov->frames_shift_offsets)
+    return (const nstime_t *)g_tree_lookup(prov->frames_shift_offsets, fd);
+
+  return NULL;
+}
+
+void
+cap_file_provider_set_shift_offset(struct packet_provider_data *prov, frame_data *fd, const nstime_t *offset)
+{
+  if (offset->secs == 0 && offset->nsecs == 0) {
+    if (fd->has_shift_offset)
+      g_tree_remove(prov->frames_shift_offsets, fd);
+    fd->has_shift_offset = FALSE;
+    return;
+  }
+
+  if (!prov->frames_shift_offsets)
+    prov->frames_shift_offsets = g_tree_new_full(frame_cmp, NULL, NULL, g_free);
+
+  g_tree_replace(prov->frames_shift_offsets, fd, g_memdup(offset, sizeof *offset));
+
+  fd->has_shift_offset = TRUE;
+}
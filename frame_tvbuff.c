@@ -74,6 +74,20 @@ frame_cache(struct tvb_frame *frame_tvb)
 
 		if (!frame_read(frame_tvb, &rec, frame_tvb->buf))
 			{ /* TODO: THROW(???); */ }
+
+		if (rec.data != NULL) {
+			/*
+			 * The data was left in the mapped file, where it
+			 * stays until the file is closed, so we don't need
+			 * the buffer.
+			 */
+			frame_tvb->tvb.real_data = rec.data + frame_tvb->offset;
+			ws_buffer_free(frame_tvb->buf);
+			g_ptr_array_add(buffer_cache, frame_tvb->buf);
+			frame_tvb->buf = NULL;
+			wtap_rec_cleanup(&rec);
+			return;
+		}
 	}
 
 	frame_tvb->tvb.real_data = ws_buffer_start_ptr(frame_tvb->buf) + frame_tvb->offset;
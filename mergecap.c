@@ -50,6 +50,8 @@
 
 #include "ui/failure_message.h"
 
+#define LONGOPT_READ_AHEAD LONGOPT_BASE_APPLICATION+1
+
 /*
  * Show the usage
  */
@@ -73,6 +75,11 @@ print_usage(FILE *output)
   fprintf(output, "  -I <IDB merge mode> set the merge mode for Interface Description Blocks; default is 'all'.\n");
   fprintf(output, "                    an empty \"-I\" option will list the merge modes.\n");
   fprintf(output, "\n");
+  fprintf(output, "Processing:\n");
+  fprintf(output, "  --read-ahead <records>\n");
+  fprintf(output, "                    read up to <records> records ahead from each input\n");
+  fprintf(output, "                    file on a separate thread per file.\n");
+  fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
   fprintf(output, "  -h                display this help and exit.\n");
   fprintf(output, "  -v                verbose output.\n");
@@ -234,12 +241,14 @@ main(int argc, char *argv[])
   static const struct option long_options[] = {
       {"help", no_argument, NULL, 'h'},
       {"version", no_argument, NULL, 'V'},
+      {"read-ahead", required_argument, NULL, LONGOPT_READ_AHEAD},
       {0, 0, 0, 0 }
   };
   gboolean            do_append          = FALSE;
   gboolean            verbose            = FALSE;
   int                 in_file_count      = 0;
   guint32             snaplen            = 0;
+  guint32             read_ahead         = 0;
 #ifdef PCAP_NG_DEFAULT
   int                 file_type          = WTAP_FILE_TYPE_SUBTYPE_PCAPNG; /* default to pcapng format */
 #else
@@ -338,6 +347,10 @@ main(int argc, char *argv[])
       out_filename = optarg;
       break;
 
+    case LONGOPT_READ_AHEAD:
+      read_ahead = get_guint32(optarg, "read-ahead record count");
+      break;
+
     case '?':              /* Bad options if GNU getopt */
       switch(optopt) {
       case'F':
@@ -391,14 +404,15 @@ main(int argc, char *argv[])
     status = merge_files_to_stdout(file_type,
                                    (const char *const *) &argv[optind],
                                    in_file_count, do_append, mode, snaplen,
-                                   get_appname_and_version(),
+                                   read_ahead, get_appname_and_version(),
                                    verbose ? &cb : NULL,
                                    &err, &err_info, &err_fileno, &err_framenum);
   } else {
     /* merge the files to the outfile */
     status = merge_files(out_filename, file_type,
                          (const char *const *) &argv[optind], in_file_count,
-                         do_append, mode, snaplen, get_appname_and_version(),
+                         do_append, mode, snaplen, read_ahead,
+                         get_appname_and_version(),
                          verbose ? &cb : NULL,
                          &err, &err_info, &err_fileno, &err_framenum);
   }
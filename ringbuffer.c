@@ -42,7 +42,9 @@
 #include <glib.h>
 
 #include "ringbuffer.h"
+#include "capture_writer.h"
 #include <wsutil/file_util.h>
+#include <wsutil/time_index.h>
 
 
 /* Ringbuffer file structure */
@@ -63,10 +65,28 @@ typedef struct _ringbuf_data {
   FILE         *pdh;
   char         *io_buffer;              /**< The IO buffer used to write to the file */
   gboolean      group_read_access;   /**< TRUE if files need to be opened with group read access */
+#ifdef HAVE_FOPENCOOKIE
+  capture_writer *writer;            /**< Thread writing the files, or NULL */
+  gint64        prealloc_size;       /**< Disk space to allocate for each new file, or 0 */
+  gchar        *spare_name;          /**< Name of the file the writer thread creates ahead of time */
+  gboolean      preallocated;        /**< TRUE if space was allocated for the current file */
+#endif
 } ringbuf_data;
 
 static ringbuf_data rb_data;
 
+/*
+ * remove the time index dumpcap may have saved next to a file
+ * (if any, so ignore error)
+ */
+static void ringbuf_unlink_time_index(const gchar *name)
+{
+  gchar *idx_name = g_strconcat(name, TIME_INDEX_SUFFIX, NULL);
+
+  ws_unlink(idx_name);
+  g_free(idx_name);
+}
+
 
 /*
  * create the next filename and open a new binary file with that name
@@ -77,14 +97,7 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
   char    timestr[14+1];
   time_t  current_time;
   struct tm *tm;
-
-  if (rfile->name != NULL) {
-    if (rb_data.unlimited == FALSE) {
-      /* remove old file (if any, so ignore error) */
-      ws_unlink(rfile->name);
-    }
-    g_free(rfile->name);
-  }
+  gchar  *old_name = rfile->name;
 
 #ifdef _WIN32
   _tzset();
@@ -100,12 +113,42 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
   rfile->name = g_strconcat(rb_data.fprefix, "_", filenum, "_", timestr,
                             rb_data.fsuffix, NULL);
 
+  if (old_name != NULL) {
+    if (rb_data.unlimited == FALSE) {
+      /* remove old file (if any, so ignore error) */
+#ifdef HAVE_FOPENCOOKIE
+      /* (in the background, unless we're about to reuse its name) */
+      if (rb_data.writer != NULL && rfile->name != NULL &&
+          strcmp(old_name, rfile->name) != 0)
+        capture_writer_unlink(rb_data.writer, old_name);
+      else
+#endif
+        ws_unlink(old_name);
+      ringbuf_unlink_time_index(old_name);
+    }
+    g_free(old_name);
+  }
+
   if (rfile->name == NULL) {
     if (err != NULL)
       *err = ENOMEM;
     return -1;
   }
 
+#ifdef HAVE_FOPENCOOKIE
+  if (rb_data.writer != NULL) {
+    /* use the file the writer thread created, if it's ready, and have
+       it create the one after that */
+    rb_data.fd = capture_writer_take_file(rb_data.writer, rfile->name,
+                                          &rb_data.preallocated);
+    capture_writer_prepare_file(rb_data.writer, rb_data.spare_name,
+                                rb_data.group_read_access, rb_data.prealloc_size);
+    if (rb_data.fd != -1)
+      return rb_data.fd;
+  }
+  rb_data.preallocated = FALSE;
+#endif
+
   rb_data.fd = ws_open(rfile->name, O_RDWR|O_BINARY|O_TRUNC|O_CREAT,
                             rb_data.group_read_access ? 0640 : 0600);
 
@@ -135,6 +178,12 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
   rb_data.pdh = NULL;
   rb_data.io_buffer = NULL;
   rb_data.group_read_access = group_read_access;
+#ifdef HAVE_FOPENCOOKIE
+  rb_data.writer = NULL;
+  rb_data.prealloc_size = 0;
+  rb_data.spare_name = NULL;
+  rb_data.preallocated = FALSE;
+#endif
 
   /* just to be sure ... */
   if (num_files <= RINGBUFFER_MAX_NUM_FILES) {
@@ -220,12 +269,62 @@ const gchar *ringbuf_current_filename(void)
   return rb_data.files[rb_data.curr_file_num % rb_data.num_files].name;
 }
 
+#ifdef HAVE_FOPENCOOKIE
+/*
+ * Have the files written by a writer thread, which also removes the old
+ * files and creates each next file ahead of time, allocating
+ * prealloc_size bytes of disk space for it if that's non-zero
+ */
+void
+ringbuf_set_writer(capture_writer *writer, gint64 prealloc_size)
+{
+  gchar *dir, *base;
+
+  rb_data.writer = writer;
+  rb_data.prealloc_size = prealloc_size;
+
+  /* a hidden file, so that it's not taken for one of the ringbuffer files */
+  dir = g_path_get_dirname(rb_data.fprefix);
+  base = g_path_get_basename(rb_data.fprefix);
+  g_free(rb_data.spare_name);
+  rb_data.spare_name = g_strconcat(dir, G_DIR_SEPARATOR_S, ".", base, "_next",
+                                   rb_data.fsuffix, NULL);
+  g_free(dir);
+  g_free(base);
+
+  capture_writer_prepare_file(writer, rb_data.spare_name,
+                              rb_data.group_read_access, prealloc_size);
+}
+#endif
+
+/*
+ * Close the current file's descriptor after fclose() failed on it; if
+ * there's a writer thread, it owns the descriptor and closes it itself
+ */
+static void
+ringbuf_close_fd(void)
+{
+#ifdef HAVE_FOPENCOOKIE
+  if (rb_data.writer != NULL)
+    return;
+#endif
+  ws_close(rb_data.fd);
+}
+
 /*
  * Calls ws_fdopen() for the current ringbuffer file
  */
 FILE *
 ringbuf_init_libpcap_fdopen(int *err)
 {
+#ifdef HAVE_FOPENCOOKIE
+  if (rb_data.writer != NULL) {
+    /* the writer thread does the buffering */
+    rb_data.pdh = capture_writer_fdopen(rb_data.writer, rb_data.fd,
+                                        rb_data.preallocated, err);
+    return rb_data.pdh;
+  }
+#endif
   rb_data.pdh = ws_fdopen(rb_data.fd, "wb");
   if (rb_data.pdh == NULL) {
     if (err != NULL) {
@@ -265,7 +364,7 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
     if (err != NULL) {
       *err = errno;
     }
-    ws_close(rb_data.fd);  /* XXX - the above should have closed this already */
+    ringbuf_close_fd();    /* XXX - the above should have closed this already */
     rb_data.pdh = NULL;    /* it's still closed, we just got an error while closing */
     rb_data.fd = -1;
     g_free(rb_data.io_buffer);
@@ -312,7 +411,7 @@ ringbuf_libpcap_dump_close(gchar **save_file, int *err)
       if (err != NULL) {
         *err = errno;
       }
-      ws_close(rb_data.fd);
+      ringbuf_close_fd();
       ret_val = FALSE;
     }
     rb_data.pdh = NULL;
@@ -353,6 +452,11 @@ ringbuf_free(void)
     g_free(rb_data.fsuffix);
     rb_data.fsuffix = NULL;
   }
+#ifdef HAVE_FOPENCOOKIE
+  g_free(rb_data.spare_name);
+  rb_data.spare_name = NULL;
+  rb_data.writer = NULL;
+#endif
 }
 
 /*
@@ -368,6 +472,12 @@ ringbuf_error_cleanup(void)
     if (fclose(rb_data.pdh) == 0) {
       rb_data.fd = -1;
     }
+#ifdef HAVE_FOPENCOOKIE
+    /* the writer thread closes it in any case */
+    if (rb_data.writer != NULL) {
+      rb_data.fd = -1;
+    }
+#endif
     rb_data.pdh = NULL;
   }
 
@@ -381,6 +491,7 @@ ringbuf_error_cleanup(void)
     for (i=0; i < rb_data.num_files; i++) {
       if (rb_data.files[i].name != NULL) {
         ws_unlink(rb_data.files[i].name);
+        ringbuf_unlink_time_index(rb_data.files[i].name);
       }
     }
   }
@@ -13,6 +13,7 @@
 
 #include <stdio.h>
 #include "wiretap/wtap.h"
+#include "capture_writer.h"
 
 #define RINGBUFFER_UNLIMITED_FILES 0
 /* Minimum number of ringbuffer files */
@@ -26,6 +27,9 @@
 int ringbuf_init(const char *capture_name, guint num_files, gboolean group_read_access);
 gboolean ringbuf_is_initialized(void);
 const gchar *ringbuf_current_filename(void);
+#ifdef HAVE_FOPENCOOKIE
+void ringbuf_set_writer(capture_writer *writer, gint64 prealloc_size);
+#endif
 FILE *ringbuf_init_libpcap_fdopen(int *err);
 gboolean ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd,
                              int *err);
@@ -576,7 +576,29 @@ sharkd_session_process_load(const char *buf, const jsmntok_t *tokens, int count)
  *   (m) duration - time difference between time of first frame, and last loaded frame
  *   (o) filename - capture filename
  *   (o) filesize - capture filesize
+ *   (m) wmem     - array of objects with the allocation statistics of the named wmem pools:
+ *                  (m) name   - pool name
+ *                  (m) in_use - bytes currently allocated
+ *                  (m) peak   - most bytes allocated at once
+ *                  (m) allocs - count of allocations
+ *                  (m) frees  - count of freed allocations
  */
+static void
+sharkd_session_process_status_wmem_cb(wmem_allocator_t *allocator, void *user_data _U_)
+{
+	wmem_allocator_stats_t stats;
+
+	wmem_allocator_get_stats(allocator, &stats);
+
+	json_dumper_begin_object(&dumper);
+	sharkd_json_value_string("name", wmem_allocator_get_name(allocator));
+	sharkd_json_value_anyf("in_use", "%" G_GUINT64_FORMAT, stats.bytes_in_use);
+	sharkd_json_value_anyf("peak", "%" G_GUINT64_FORMAT, stats.peak_bytes_in_use);
+	sharkd_json_value_anyf("allocs", "%" G_GUINT64_FORMAT, stats.alloc_count);
+	sharkd_json_value_anyf("frees", "%" G_GUINT64_FORMAT, stats.free_count);
+	json_dumper_end_object(&dumper);
+}
+
 static void
 sharkd_session_process_status(void)
 {
@@ -601,6 +623,10 @@ sharkd_session_process_status(void)
 			sharkd_json_value_anyf("filesize", "%" G_GINT64_FORMAT, file_size);
 	}
 
+	sharkd_json_array_open("wmem");
+	wmem_foreach_named_allocator(sharkd_session_process_status_wmem_cb, NULL);
+	sharkd_json_array_close();
+
 	json_dumper_end_object(&dumper);
 	json_dumper_finish(&dumper);
 }
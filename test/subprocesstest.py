@@ -14,6 +14,7 @@ import io
 import os
 import os.path
 import re
+import struct
 import subprocess
 import sys
 import unittest
@@ -47,6 +48,43 @@ def cat_cap_file_command(cap_files):
         return 'copy {} CON'.format(quoted_paths)
     return 'cat {}'.format(quoted_paths)
 
+def write_pcap(filename, packets):
+    '''Write a microsecond pcap file of Ethernet packets, given as
+    (seconds, microseconds, payload) tuples.'''
+    with open(filename, 'wb') as pcap_fd:
+        pcap_fd.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+        for ts_sec, ts_usec, payload in packets:
+            pcap_fd.write(struct.pack('<IIII', ts_sec, ts_usec, len(payload), len(payload)))
+            pcap_fd.write(payload)
+
+def write_pcapng(filename, packets):
+    '''Write a pcapng file of Ethernet packets, given as (interface_id,
+    seconds, microseconds, payload) tuples. The description of each
+    interface is written just before its first packet, so a file with
+    packets on more than one interface has one part way through. A packet
+    whose seconds are None is written as a simple packet block, which has
+    no time stamp and always belongs to the first interface.'''
+    def write_block(pcapng_fd, block_type, body):
+        body += bytes(-len(body) % 4)
+        total_length = len(body) + 12
+        pcapng_fd.write(struct.pack('<II', block_type, total_length))
+        pcapng_fd.write(body)
+        pcapng_fd.write(struct.pack('<I', total_length))
+    with open(filename, 'wb') as pcapng_fd:
+        # Section header with an unknown section length.
+        write_block(pcapng_fd, 0x0a0d0d0a, struct.pack('<IHHq', 0x1a2b3c4d, 1, 0, -1))
+        interface_count = 0
+        for interface_id, ts_sec, ts_usec, payload in packets:
+            while interface_count <= interface_id:
+                write_block(pcapng_fd, 1, struct.pack('<HHI', 1, 0, 65535))
+                interface_count += 1
+            if ts_sec is None:
+                write_block(pcapng_fd, 3, struct.pack('<I', len(payload)) + payload)
+                continue
+            ts = ts_sec * 1000000 + ts_usec
+            write_block(pcapng_fd, 6, struct.pack('<IIIII',
+                interface_id, ts >> 32, ts & 0xffffffff, len(payload), len(payload)) + payload)
+
 class LoggingPopen(subprocess.Popen):
     '''Run a process using subprocess.Popen. Capture and log its output.
 
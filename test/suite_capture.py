@@ -9,11 +9,15 @@
 #
 '''Capture tests'''
 
+import filecmp
 import fixtures
 import glob
 import hashlib
 import os
+import re
+import shutil
 import socket
+import struct
 import subprocess
 import subprocesstest
 import sys
@@ -230,7 +234,7 @@ def check_capture_snapshot_len(capture_interface, cmd_tshark, traffic_generator)
 
 @fixtures.fixture
 def check_dumpcap_autostop_stdin(cmd_dumpcap):
-    def check_dumpcap_autostop_stdin_real(self, packets=None, filesize=None):
+    def check_dumpcap_autostop_stdin_real(self, packets=None, filesize=None, extra_args=()):
         # Similar to check_capture_stdin.
         testout_file = self.filename_from_id(testout_pcap)
         cat100_dhcp_cmd = subprocesstest.cat_dhcp_command('cat100')
@@ -248,7 +252,7 @@ def check_dumpcap_autostop_stdin(cmd_dumpcap):
             '-i', '-',
             '-w', testout_file,
             '-a', condition,
-        ))
+        ) + tuple(extra_args))
         pipe_proc = self.assertRun(cat100_dhcp_cmd + ' | ' + capture_cmd, shell=True)
         self.assertTrue(os.path.isfile(testout_file))
 
@@ -257,12 +261,13 @@ def check_dumpcap_autostop_stdin(cmd_dumpcap):
         elif filesize is not None:
             capturekb = os.path.getsize(testout_file) / 1000
             self.assertGreaterEqual(capturekb, filesize)
+        return testout_file
     return check_dumpcap_autostop_stdin_real
 
 
 @fixtures.fixture
 def check_dumpcap_ringbuffer_stdin(cmd_dumpcap):
-    def check_dumpcap_ringbuffer_stdin_real(self, packets=None, filesize=None):
+    def check_dumpcap_ringbuffer_stdin_real(self, packets=None, filesize=None, extra_args=()):
         # Similar to check_capture_stdin.
         rb_unique = 'dhcp_rb_' + uuid.uuid4().hex[:6] # Random ID
         testout_file = '{}.{}.pcapng'.format(self.id(), rb_unique)
@@ -283,7 +288,7 @@ def check_dumpcap_ringbuffer_stdin(cmd_dumpcap):
             '-w', testout_file,
             '-a', 'files:2',
             '-b', condition,
-        ))
+        ) + tuple(extra_args))
         pipe_proc = self.assertRun(cat100_dhcp_cmd + ' | ' + capture_cmd, shell=True)
 
         rb_files = glob.glob(testout_glob)
@@ -299,6 +304,7 @@ def check_dumpcap_ringbuffer_stdin(cmd_dumpcap):
             elif filesize is not None:
                 capturekb = os.path.getsize(rbf) / 1000
                 self.assertGreaterEqual(capturekb, filesize)
+        return rb_files
     return check_dumpcap_ringbuffer_stdin_real
 
 
@@ -571,6 +577,114 @@ class case_dumpcap_ringbuffer(subprocesstest.SubprocessTestCase):
         check_dumpcap_ringbuffer_stdin(self, packets=47) # Last prime before 50. Arbitrary.
 
 
+def pcapng_data_size(filename):
+    '''Return the number of bytes taken up by the pcapng blocks at the start of a file.'''
+    with open(filename, 'rb') as pcapng_f:
+        contents = pcapng_f.read()
+    offset = 0
+    byte_order = '<'
+    while len(contents) - offset >= 12:
+        block_type, = struct.unpack_from(byte_order + 'I', contents, offset)
+        if block_type == 0x0a0d0d0a:
+            magic, = struct.unpack_from('<I', contents, offset + 8)
+            byte_order = '<' if magic == 0x1a2b3c4d else '>'
+        block_len, = struct.unpack_from(byte_order + 'I', contents, offset + 4)
+        if block_len < 12 or offset + block_len > len(contents):
+            break
+        offset += block_len
+    return offset
+
+
+@fixtures.mark_usefixtures('base_env')
+@fixtures.uses_fixtures
+class case_dumpcap_async_write(subprocesstest.SubprocessTestCase):
+    def setUp(self):
+        if not sys.platform.startswith('linux'):
+            self.skipTest('--async-write requires fopencookie()')
+        super().setUp()
+
+    def allocated_size(self, filename):
+        '''The disk space allocated to a file.'''
+        return os.stat(filename).st_blocks * 512
+
+    def check_data_size(self, filename):
+        '''Make sure that a file has been trimmed back to the data written to it.'''
+        data_size = pcapng_data_size(filename)
+        self.assertEqual(os.path.getsize(filename), data_size)
+        # Files are preallocated without changing their size, so only
+        # the space allocated to them shows whether the rest was released.
+        self.assertLessEqual(self.allocated_size(filename), data_size + os.stat(filename).st_blksize)
+
+    def test_dumpcap_async_write_autostop_packets(self, check_dumpcap_autostop_stdin):
+        '''Capture from stdin using Dumpcap with a writer thread until we reach a packet limit'''
+        testout_file = check_dumpcap_autostop_stdin(self, packets=97, extra_args=('--async-write',))
+        self.check_data_size(testout_file)
+
+    def test_dumpcap_async_write_ringbuffer_packets(self, check_dumpcap_ringbuffer_stdin):
+        '''Capture from stdin using Dumpcap with a writer thread into a ring buffer with a packet limit'''
+        rb_files = check_dumpcap_ringbuffer_stdin(self, packets=47, extra_args=('--async-write',))
+        for rbf in rb_files:
+            self.check_data_size(rbf)
+
+    def test_dumpcap_async_write_ringbuffer_filesize(self, check_dumpcap_ringbuffer_stdin):
+        '''Capture from stdin using Dumpcap with a writer thread into preallocated ring buffer files'''
+        rb_files = check_dumpcap_ringbuffer_stdin(self, filesize=15, extra_args=('--async-write',))
+        for rbf in rb_files:
+            self.check_data_size(rbf)
+
+    def test_dumpcap_async_write_short_file(self, cmd_dumpcap):
+        '''A ring buffer file that ends well short of its size limit is trimmed when it's closed'''
+        rb_unique = 'dhcp_rb_' + uuid.uuid4().hex[:6] # Random ID
+        testout_file = '{}.{}.pcapng'.format(self.id(), rb_unique)
+        testout_glob = '{}.{}_*.pcapng'.format(self.id(), rb_unique)
+        capture_cmd = ' '.join((cmd_dumpcap,
+            '-i', '-',
+            '-w', testout_file,
+            '-b', 'filesize:1000',
+            '--async-write',
+        ))
+        capture_proc = self.assertRun(subprocesstest.cat_dhcp_command('cat100') + ' | ' + capture_cmd, shell=True)
+        rb_files = glob.glob(testout_glob)
+        for rbf in rb_files:
+            self.cleanup_files.append(rbf)
+        self.assertEqual(len(rb_files), 1)
+        self.checkPacketCount(100, cap_file=rb_files[0])
+        self.check_data_size(rb_files[0])
+        self.assertLess(self.allocated_size(rb_files[0]), 1000 * 1000)
+        # Every packet has been reported, once the writer thread wrote it.
+        reported = re.findall(r'Packets: (\d+)', capture_proc.stderr_str)
+        self.assertTrue(reported)
+        self.assertEqual(int(reported[-1]), 100)
+
+
+@fixtures.mark_usefixtures('base_env')
+@fixtures.uses_fixtures
+class case_dumpcap_time_index(subprocesstest.SubprocessTestCase):
+    def test_dumpcap_time_index(self, check_dumpcap_autostop_stdin, cmd_editcap):
+        '''Capture from stdin using Dumpcap and save a time index that editcap uses'''
+        testout_file = check_dumpcap_autostop_stdin(self, packets=97, extra_args=('--time-index',))
+        self.assertTrue(os.path.isfile(testout_file + '.wstidx'))
+        # The index is for this file only, so a copy is read without it.
+        plain_file = self.filename_from_id('testout-plain.pcapng')
+        shutil.copyfile(testout_file, plain_file)
+        time_range = ('-A', '2000-01-01 00:00:00', '-B', '2038-01-01 00:00:00')
+        plain_out = self.filename_from_id('testout-plain-sliced.pcapng')
+        self.assertRun((cmd_editcap,) + time_range + (plain_file, plain_out))
+        indexed_out = self.filename_from_id('testout-sliced.pcapng')
+        self.assertRun((cmd_editcap,) + time_range + (testout_file, indexed_out))
+        self.checkPacketCount(97, cap_file=indexed_out)
+        self.assertTrue(filecmp.cmp(indexed_out, plain_out, shallow=False))
+
+    def test_dumpcap_time_index_ringbuffer(self, check_dumpcap_ringbuffer_stdin):
+        '''Capture from stdin using Dumpcap into a ring buffer with a time index for each file'''
+        rb_files = check_dumpcap_ringbuffer_stdin(self, packets=47, extra_args=('--time-index',))
+        for rbf in rb_files:
+            self.cleanup_files.append(rbf + '.wstidx')
+        # The index of the file that was removed goes with it.
+        index_files = glob.glob('{}.*.pcapng.wstidx'.format(self.id()))
+        self.assertEqual(sorted(index_files), sorted(rbf + '.wstidx' for rbf in rb_files))
+
+
 @fixtures.mark_usefixtures('base_env')
 @fixtures.uses_fixtures
 class case_dumpcap_pcapng_sections(subprocesstest.SubprocessTestCase):
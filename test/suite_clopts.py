@@ -12,10 +12,14 @@
 import json
 import sys
 import os.path
+import signal
+import stat
+import struct
 import subprocess
 import subprocesstest
 import fixtures
 import shutil
+import time
 
 #glossaries = ('fields', 'protocols', 'values', 'decodes', 'defaultprefs', 'currentprefs')
 
@@ -284,6 +288,262 @@ class case_tshark_z_expert(subprocesstest.SubprocessTestCase):
         self.assertFalse(self.grepOutput('Chats'))
 
 
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_z_reassembly(subprocesstest.SubprocessTestCase):
+    def test_tshark_z_reassembly_stat(self, cmd_tshark, capture_file):
+        self.assertRun((cmd_tshark, '-q', '-z', 'reassembly,stat',
+            '-r', capture_file('http-ooo.pcap')))
+        self.assertTrue(self.grepOutput('Reassembly Statistics'))
+        self.assertTrue(self.grepOutput('Limit of unfinished data per table: none'))
+        self.assertTrue(self.grepOutput('Discarded unfinished +0 +0'))
+
+    def test_tshark_z_reassembly_stat_limits(self, cmd_tshark, capture_file):
+        self.assertRun((cmd_tshark, '-q', '-z', 'reassembly,stat',
+            '-o', 'protocols.reassembly_max_pending_mb:64',
+            '-o', 'protocols.reassembly_max_age:1000',
+            '-r', capture_file('http-ooo.pcap')))
+        self.assertTrue(self.grepOutput('Limit of unfinished data per table: 64 MB'))
+        self.assertTrue(self.grepOutput('Limit of unfinished reassembly age: 1000 frames'))
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_z_wmem(subprocesstest.SubprocessTestCase):
+    def test_tshark_z_wmem_stat(self, cmd_tshark, capture_file):
+        self.assertRun((cmd_tshark, '-q', '-z', 'wmem,stat',
+            '-r', capture_file('dhcp.pcap')))
+        self.assertTrue(self.grepOutput('Memory Pool Statistics'))
+        self.assertTrue(self.grepOutput('^File scope +[0-9]+ +[0-9]+ +[0-9]+ +[0-9]+ +[0-9]+$'))
+        self.assertTrue(self.grepOutput('^Packet info +[0-9]+ +[0-9]+ +[0-9]+ +[0-9]+ +[0-9]+$'))
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_prune_dissection(subprocesstest.SubprocessTestCase):
+    def check_pruned_filter(self, cmd_tshark, capture_file, dfilter, num_packets, capture='dhcp.pcap'):
+        # The pruned and the full dissection must select the same packets,
+        # not just the same number of them.
+        fields = ('-Tfields', '-e', 'frame.time_epoch', '-e', 'frame.len',
+            '-e', 'frame.protocols', '-e', 'ip.src', '-e', 'ip.dst')
+        outputs = []
+        for prune in ((), ('--prune-dissection',)):
+            testout_file = self.filename_from_id('prune{}.pcap'.format(len(outputs)))
+            self.assertRun((cmd_tshark, '-r', capture_file(capture))
+                + prune + ('-Y', dfilter, '-w', testout_file))
+            self.checkPacketCount(num_packets, cap_file=testout_file)
+            outputs.append(self.assertRun((cmd_tshark, '-r', testout_file) + fields).stdout_str)
+        self.assertEqual(outputs[1], outputs[0])
+
+    def test_tshark_prune_dissection_network(self, cmd_tshark, capture_file):
+        self.check_pruned_filter(cmd_tshark, capture_file, 'ip.src == 0.0.0.0', 2)
+
+    def test_tshark_prune_dissection_transport(self, cmd_tshark, capture_file):
+        self.check_pruned_filter(cmd_tshark, capture_file, 'udp.srcport == 67', 2)
+
+    def test_tshark_prune_dissection_application(self, cmd_tshark, capture_file):
+        self.check_pruned_filter(cmd_tshark, capture_file, 'dhcp.option.dhcp == 3', 1)
+
+    def test_tshark_prune_dissection_frame_protocols(self, cmd_tshark, capture_file):
+        self.check_pruned_filter(cmd_tshark, capture_file, 'frame.protocols contains "dhcp"', 4)
+
+    def test_tshark_prune_dissection_dns(self, cmd_tshark, capture_file):
+        self.check_pruned_filter(cmd_tshark, capture_file, 'dns.flags.response == 1', 5,
+            capture='dns+icmp.pcapng.gz')
+
+    def test_tshark_prune_dissection_sip(self, cmd_tshark, capture_file):
+        # SIP is also registered as a heuristic dissector on UDP and TCP.
+        self.check_pruned_filter(cmd_tshark, capture_file, 'sip.Method == "INVITE"', 1,
+            capture='sip.pcapng')
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_parallel_workers(subprocesstest.SubprocessTestCase):
+    def check_parallel_output(self, cmd_tshark, capture_file, args):
+        if sys.platform == 'win32':
+            self.skipTest('--parallel-workers is not available on Windows')
+        args = ('-2', '-r', capture_file('dns+icmp.pcapng.gz')) + args
+        serial_proc = self.assertRun((cmd_tshark,) + args)
+        parallel_proc = self.assertRun((cmd_tshark, '--parallel-workers', '3') + args)
+        self.assertEqual(parallel_proc.stdout_str, serial_proc.stdout_str)
+
+    def test_tshark_parallel_workers_summary(self, cmd_tshark, capture_file):
+        self.check_parallel_output(cmd_tshark, capture_file, ())
+
+    def test_tshark_parallel_workers_fields(self, cmd_tshark, capture_file):
+        self.check_parallel_output(cmd_tshark, capture_file, ('-Tfields',
+            '-e', 'frame.number', '-e', 'frame.time_relative', '-e', 'frame.time_delta_displayed',
+            '-e', 'dns.response_in', '-e', 'icmp.resp_in'))
+
+    def test_tshark_parallel_workers_display_filter(self, cmd_tshark, capture_file):
+        self.check_parallel_output(cmd_tshark, capture_file, ('-Y', 'dns', '-Tfields',
+            '-e', 'frame.number', '-e', 'dns.response_in'))
+
+    def test_tshark_parallel_workers_requires_two_pass(self, cmd_tshark, capture_file):
+        if sys.platform == 'win32':
+            self.skipTest('--parallel-workers is not available on Windows')
+        self.assertRun((cmd_tshark, '--parallel-workers', '2',
+            '-r', capture_file('dhcp.pcap')),
+            expected_return=self.exit_command_line)
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_pipeline(subprocesstest.SubprocessTestCase):
+    def check_pipeline_output(self, cmd_tshark, capture_file, args):
+        args = ('-r', capture_file('dns+icmp.pcapng.gz')) + args
+        serial_proc = self.assertRun((cmd_tshark,) + args)
+        pipeline_proc = self.assertRun((cmd_tshark, '--pipeline') + args)
+        self.assertEqual(pipeline_proc.stdout_str, serial_proc.stdout_str)
+
+    def test_tshark_pipeline_summary(self, cmd_tshark, capture_file):
+        self.check_pipeline_output(cmd_tshark, capture_file, ())
+
+    def test_tshark_pipeline_ek(self, cmd_tshark, capture_file):
+        self.check_pipeline_output(cmd_tshark, capture_file, ('-Tek',))
+
+    def test_tshark_pipeline_json_line_buffered(self, cmd_tshark, capture_file):
+        self.check_pipeline_output(cmd_tshark, capture_file, ('-Tjson', '-l', '-c', '5'))
+
+    def test_tshark_pipeline_requires_one_pass(self, cmd_tshark, capture_file):
+        self.assertRun((cmd_tshark, '--pipeline', '-2',
+            '-r', capture_file('dhcp.pcap')),
+            expected_return=self.exit_command_line)
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_zero_copy(subprocesstest.SubprocessTestCase):
+    def check_zero_copy_output(self, cmd_tshark, capture_file, args):
+        args = ('-V',) + args
+        copy_proc = self.assertRun((cmd_tshark,) + args)
+        zero_copy_proc = self.assertRun((cmd_tshark, '--zero-copy') + args)
+        self.assertEqual(zero_copy_proc.stdout_str, copy_proc.stdout_str)
+
+    def test_tshark_zero_copy_pcap(self, cmd_tshark, capture_file):
+        self.check_zero_copy_output(cmd_tshark, capture_file,
+            ('-r', capture_file('dhcp.pcap')))
+
+    def test_tshark_zero_copy_pcapng_two_pass(self, cmd_tshark, capture_file):
+        self.check_zero_copy_output(cmd_tshark, capture_file,
+            ('-2', '-r', capture_file('sip.pcapng')))
+
+    def test_tshark_zero_copy_compressed(self, cmd_tshark, capture_file):
+        '''Compressed files can't be mapped and are read as usual.'''
+        self.check_zero_copy_output(cmd_tshark, capture_file,
+            ('-r', capture_file('dns+icmp.pcapng.gz')))
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_fork_server(subprocesstest.SubprocessTestCase):
+    def start_fork_server(self, cmd_tshark):
+        if sys.platform == 'win32':
+            self.skipTest('--fork-server is not available on Windows')
+        sock_path = self.filename_from_id('fork.sock')
+        self.startProcess((cmd_tshark, '--fork-server', sock_path))
+        for _ in range(300):
+            if os.path.exists(sock_path):
+                break
+            time.sleep(0.1)
+        self.assertTrue(os.path.exists(sock_path))
+        return sock_path
+
+    def test_tshark_fork_server_output(self, cmd_tshark, capture_file):
+        sock_path = self.start_fork_server(cmd_tshark)
+        args = ('-r', capture_file('dns+icmp.pcapng.gz'), '-V', '-Y', 'dns')
+        direct_proc = self.assertRun((cmd_tshark,) + args)
+        forked_proc = self.assertRun((cmd_tshark, '--fork-client', sock_path) + args)
+        self.assertEqual(forked_proc.stdout_str, direct_proc.stdout_str)
+
+    def test_tshark_fork_server_exit_status(self, cmd_tshark, capture_file):
+        sock_path = self.start_fork_server(cmd_tshark)
+        self.assertRun((cmd_tshark, '--fork-client', sock_path,
+            '-r', capture_file('dhcp.pcap'), '-Y', 'invalid filter'),
+            expected_return=self.exit_error)
+
+    def test_tshark_fork_server_socket_mode(self, cmd_tshark):
+        sock_path = self.start_fork_server(cmd_tshark)
+        self.assertEqual(stat.S_IMODE(os.stat(sock_path).st_mode) & 0o077, 0)
+
+    def test_tshark_fork_server_interrupt(self, cmd_tshark):
+        sock_path = self.start_fork_server(cmd_tshark)
+        # The run waits for a capture file on the client's standard input.
+        client_proc = self.startProcess((cmd_tshark, '--fork-client', sock_path,
+            '-r', '-'), stdin=subprocess.PIPE)
+        time.sleep(2)
+        client_proc.send_signal(signal.SIGINT)
+        self.waitProcess(client_proc)
+        # The run was interrupted, and we got its exit status.
+        self.assertEqual(client_proc.returncode, 128 + signal.SIGINT)
+
+    def test_tshark_fork_server_no_server(self, cmd_tshark):
+        if sys.platform == 'win32':
+            self.skipTest('--fork-server is not available on Windows')
+        self.assertRun((cmd_tshark, '--fork-client', self.filename_from_id('missing.sock'),
+            '-v'), expected_return=self.exit_error)
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_tshark_filter_server(subprocesstest.SubprocessTestCase):
+    def run_filter_server(self, cmd_tshark, capture, requests):
+        '''Send all the requests at once and return the exit status and the output.'''
+        if sys.platform == 'win32':
+            self.skipTest('--filter-server is not available on Windows')
+        request_data = b''.join(struct.pack('=II', workers, len(dfilter)) + dfilter.encode()
+            for workers, dfilter in requests)
+        proc = subprocess.run((cmd_tshark, '-r', capture, '--filter-server'),
+            input=request_data, stdout=subprocess.PIPE, env=self.injected_test_env)
+        return proc.returncode, proc.stdout
+
+    def check_filter_server(self, cmd_tshark, capture_file, capture, dfilters, workers):
+        capture = capture_file(capture)
+        returncode, data = self.run_filter_server(cmd_tshark, capture,
+            [(workers, dfilter) for dfilter in dfilters])
+        self.assertEqual(returncode, 0)
+        count, = struct.unpack_from('=I', data)
+        pos = 4
+        for dfilter in dfilters:
+            passed = []
+            for framenum in range(1, count + 1):
+                result_framenum, result_passed, num_depended_upon = struct.unpack_from('=III', data, pos)
+                self.assertEqual(result_framenum, framenum)
+                pos += 12 + 4 * num_depended_upon
+                if result_passed:
+                    passed.append(str(framenum))
+            # The frames have all been dissected once, as with -2.
+            expected = self.assertRun((cmd_tshark, '-r', capture, '-2', '-Y', dfilter,
+                '-Tfields', '-e', 'frame.number')).stdout_str.split()
+            self.assertEqual(passed, expected)
+        self.assertEqual(pos, len(data))
+
+    def test_tshark_filter_server_results(self, cmd_tshark, capture_file):
+        self.check_filter_server(cmd_tshark, capture_file, 'dns+icmp.pcapng.gz',
+            ('dns.flags.response == 0', 'icmp', 'frame.time_relative > 5'), 3)
+
+    def test_tshark_filter_server_later_frames(self, cmd_tshark, capture_file):
+        # response_in is only known once the response has been dissected.
+        self.check_filter_server(cmd_tshark, capture_file, 'dns+icmp.pcapng.gz',
+            ('dns.response_in',), 4)
+
+    def test_tshark_filter_server_more_workers_than_frames(self, cmd_tshark, capture_file):
+        self.check_filter_server(cmd_tshark, capture_file, 'dhcp.pcap', ('dhcp',), 8)
+
+    def test_tshark_filter_server_invalid_filter(self, cmd_tshark, capture_file):
+        returncode, data = self.run_filter_server(cmd_tshark, capture_file('dhcp.pcap'),
+            [(2, 'invalid filter')])
+        self.assertEqual(returncode, 2)
+        self.assertEqual(data, struct.pack('=I', 4))
+
+    def test_tshark_filter_server_requires_file(self, cmd_tshark):
+        if sys.platform == 'win32':
+            self.skipTest('--filter-server is not available on Windows')
+        self.assertRun((cmd_tshark, '--filter-server'),
+            expected_return=self.exit_command_line)
+
+
 @fixtures.mark_usefixtures('test_env')
 @fixtures.uses_fixtures
 class case_tshark_extcap(subprocesstest.SubprocessTestCase):
@@ -58,3 +58,20 @@ class case_membership(unittest.TestCase):
         dfilter = 'frame.number in {1 "foo"}'
         error = '"foo" cannot be converted to Unsigned integer, 4 bytes.'
         checkDFilterFail(dfilter, error)
+
+    def test_membership_12_integer_set(self, checkDFilterCount):
+        dfilter = 'tcp.srcport in {443 3267 8080}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_13_ip_set(self, checkDFilterCount):
+        dfilter = 'ip.addr in {192.168.0.1 207.46.134.94}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_14_ip_set_no_match(self, checkDFilterCount):
+        dfilter = 'ip.dst in {10.0.0.5 192.168.0.1}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_15_ip_subnet(self, checkDFilterCount):
+        # Subnets can't use the sorted lookup; check they still match.
+        dfilter = 'ip.src in {192.168.0.0/16 10.0.0.0/8}'
+        checkDFilterCount(dfilter, 1)
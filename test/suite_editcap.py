@@ -0,0 +1,135 @@
+#
+# -*- coding: utf-8 -*-
+# Wireshark tests
+# By Gerald Combs <gerald@wireshark.org>
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+#
+'''Editcap tests'''
+
+import filecmp
+import os.path
+import shutil
+import subprocesstest
+import fixtures
+
+testin_pcap = 'testin.pcap'
+testin_pcapng = 'testin.pcapng'
+testout_pcap = 'testout.pcap'
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_editcap_dedup(subprocesstest.SubprocessTestCase):
+    def make_duplicates(self, cmd_mergecap, capture_file):
+        '''Merge dhcp.pcap with itself, giving 8 packets, each one next to its duplicate.'''
+        testin_file = self.filename_from_id(testin_pcap)
+        self.assertRun((cmd_mergecap,
+            '-F', 'pcap',
+            '-w', testin_file,
+            capture_file('dhcp.pcap'), capture_file('dhcp.pcap'),
+        ))
+        return testin_file
+
+    def run_dedup(self, cmd_editcap, testin_file, editcap_args):
+        testout_file = self.filename_from_id(testout_pcap)
+        self.assertRun([cmd_editcap] + list(editcap_args) + [testin_file, testout_file])
+        return testout_file
+
+    def test_editcap_dedup_default_window(self, cmd_editcap, cmd_mergecap, capture_file):
+        '''Remove duplicates with -d'''
+        testin_file = self.make_duplicates(cmd_mergecap, capture_file)
+        testout_file = self.run_dedup(cmd_editcap, testin_file, ('-d',))
+        self.checkPacketCount(4, cap_file=testout_file)
+
+    def test_editcap_dedup_max_window(self, cmd_editcap, cmd_mergecap, capture_file):
+        '''Remove duplicates with the largest -D window'''
+        testin_file = self.make_duplicates(cmd_mergecap, capture_file)
+        testout_file = self.run_dedup(cmd_editcap, testin_file, ('-D', '1000000'))
+        self.checkPacketCount(4, cap_file=testout_file)
+
+    def test_editcap_dedup_window_1(self, cmd_editcap, cmd_mergecap, capture_file):
+        '''A -D window of 1 compares each packet with no others'''
+        testin_file = self.make_duplicates(cmd_mergecap, capture_file)
+        testout_file = self.run_dedup(cmd_editcap, testin_file, ('-D', '1'))
+        self.checkPacketCount(8, cap_file=testout_file)
+
+    def test_editcap_dedup_murmur3(self, cmd_editcap, cmd_mergecap, capture_file):
+        '''Remove duplicates with -d, using MurmurHash3 digests'''
+        testin_file = self.make_duplicates(cmd_mergecap, capture_file)
+        testout_file = self.run_dedup(cmd_editcap, testin_file, ('--dup-digest', 'murmur3', '-d'))
+        self.checkPacketCount(4, cap_file=testout_file)
+
+    def test_editcap_dedup_time_window(self, cmd_editcap, cmd_mergecap, capture_file):
+        '''Remove duplicates with the same time stamp with -w'''
+        testin_file = self.make_duplicates(cmd_mergecap, capture_file)
+        testout_file = self.run_dedup(cmd_editcap, testin_file, ('-w', '0'))
+        self.checkPacketCount(4, cap_file=testout_file)
+
+    def test_editcap_dedup_bad_digest(self, cmd_editcap, cmd_mergecap, capture_file):
+        '''Reject an unknown --dup-digest'''
+        testin_file = self.make_duplicates(cmd_mergecap, capture_file)
+        testout_file = self.filename_from_id(testout_pcap)
+        self.assertRun((cmd_editcap, '--dup-digest', 'crc', '-d', testin_file, testout_file),
+            expected_return=self.exit_command_line)
+
+
+timed_start = 1577836800 # 2020-01-01 00:00:00 UTC
+
+def timed_packets(packet_count):
+    '''One 1000-byte packet per second from 2020-01-01 00:00:00 UTC on,
+    enough of them to get several time index points.'''
+    payload = bytes(1000)
+    return [(timed_start + packet_num, 0, payload) for packet_num in range(packet_count)]
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_editcap_time_index(subprocesstest.SubprocessTestCase):
+    def test_editcap_time_index(self, cmd_editcap, cmd_capinfos):
+        '''-A and -B give the same packets with a time index as without one'''
+        testin_file = self.filename_from_id(testin_pcap)
+        subprocesstest.write_pcap(testin_file, timed_packets(4000))
+        self.assertRun((cmd_capinfos, '--save-time-index', testin_file))
+        self.check_time_index(cmd_editcap, testin_file,
+            '2020-01-01 00:40:00', '2020-01-01 00:45:00', 300)
+
+    def test_editcap_time_index_out_of_order(self, cmd_editcap, cmd_capinfos):
+        '''The time index copes with packets that are out of time order'''
+        packets = timed_packets(4000)
+        # A packet in the range well before its start, after the first
+        # index point, and one well after its end, which the index mustn't
+        # skip over.
+        packets[2000] = (timed_start + 2450, 0, packets[2000][2])
+        packets[3500] = (timed_start + 2500, 0, packets[3500][2])
+        testin_file = self.filename_from_id(testin_pcap)
+        subprocesstest.write_pcap(testin_file, packets)
+        self.assertRun((cmd_capinfos, '--save-time-index', testin_file))
+        self.check_time_index(cmd_editcap, testin_file,
+            '2020-01-01 00:40:00', '2020-01-01 00:45:00', 302)
+
+    def test_editcap_time_index_pcapng_interfaces(self, cmd_editcap, cmd_tshark):
+        '''The time index isn't used past an interface the reader hasn't seen'''
+        packets = [(0,) + packet for packet in timed_packets(4000)]
+        # A second interface description part way through the file.
+        packets[3000] = (1,) + packets[3000][1:]
+        testin_file = self.filename_from_id(testin_pcapng)
+        subprocesstest.write_pcapng(testin_file, packets)
+        self.assertRun((cmd_tshark, '-q', '--save-time-index', '-r', testin_file))
+        self.check_time_index(cmd_editcap, testin_file,
+            '2020-01-01 00:55:00', '2020-01-01 01:00:00', 300)
+
+    def check_time_index(self, cmd_editcap, testin_file, start, stop, packet_count):
+        '''Check that editcap -A and -B use the index of testin_file and
+        give the same packets as they do without it.'''
+        self.assertTrue(os.path.isfile(testin_file + '.wstidx'))
+        extension = os.path.splitext(testin_file)[1]
+        plain_file = self.filename_from_id('testin-plain' + extension)
+        shutil.copyfile(testin_file, plain_file)
+        time_range = ('-A', start, '-B', stop)
+        plain_out = self.filename_from_id('testout-plain' + extension)
+        self.assertRun((cmd_editcap,) + time_range + (plain_file, plain_out))
+        testout_file = self.filename_from_id('testout' + extension)
+        editcap_proc = self.assertRun((cmd_editcap, '-v') + time_range + (testin_file, testout_file))
+        self.assertTrue(self.grepOutput('using the time index', proc=editcap_proc))
+        self.checkPacketCount(packet_count, cap_file=testout_file)
+        self.assertTrue(filecmp.cmp(testout_file, plain_out, shallow=False))
@@ -10,8 +10,11 @@
 '''File format conversion tests'''
 
 import os.path
+import shutil
+import struct
 import subprocesstest
 import unittest
+import zlib
 import fixtures
 
 # XXX Currently unused. It would be nice to be able to use this below.
@@ -247,3 +250,104 @@ class case_fileformat_mime(subprocesstest.SubprocessTestCase):
                 '-Tfields', '-e', 'frame.len', '-e', 'pcapng.block.length',
             ))
         self.assertEqual(proc.stdout_str.strip(), '480\t128,128,88,88,132,132,132,132')
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_fileformat_compressed(subprocesstest.SubprocessTestCase):
+    def test_pcap_zstd(self, cmd_tshark, capture_file, features, fileformats_baseline_str):
+        '''Microsecond pcap direct vs zstd compressed microsecond pcap'''
+        if not features.have_zstd:
+            self.skipTest('Requires zstd.')
+        capture_proc = self.assertRun((cmd_tshark,
+                '-r', capture_file('dhcp.pcap.zst'),
+                '-Tfields',
+                '-e', 'frame.number', '-e', 'frame.time_epoch', '-e', 'frame.time_delta',
+                ),
+            )
+        self.assertTrue(self.diffOutput(capture_proc.stdout_str, fileformats_baseline_str, 'tshark', baseline_file))
+
+    def test_pcap_lz4(self, cmd_tshark, capture_file, features, fileformats_baseline_str):
+        '''Microsecond pcap direct vs lz4 compressed microsecond pcap'''
+        if not features.have_lz4:
+            self.skipTest('Requires lz4.')
+        capture_proc = self.assertRun((cmd_tshark,
+                '-r', capture_file('dhcp.pcap.lz4'),
+                '-Tfields',
+                '-e', 'frame.number', '-e', 'frame.time_epoch', '-e', 'frame.time_delta',
+                ),
+            )
+        self.assertTrue(self.diffOutput(capture_proc.stdout_str, fileformats_baseline_str, 'tshark', baseline_file))
+
+    def check_compressed_write(self, cmd_editcap, cmd_tshark, capture_file, fileformats_baseline_str, method, suffix, magic):
+        outfile = self.filename_from_id('dhcp.pcap.' + suffix)
+        self.assertRun((cmd_editcap, '--compress', method, capture_file('dhcp.pcap'), outfile))
+        with open(outfile, 'rb') as f:
+            self.assertEqual(f.read(len(magic)), magic)
+        capture_proc = self.assertRun((cmd_tshark,
+                '-r', outfile,
+                '-Tfields',
+                '-e', 'frame.number', '-e', 'frame.time_epoch', '-e', 'frame.time_delta',
+                ),
+            )
+        self.assertTrue(self.diffOutput(capture_proc.stdout_str, fileformats_baseline_str, 'tshark', baseline_file))
+
+    def test_pcap_zstd_write(self, cmd_editcap, cmd_tshark, capture_file, features, fileformats_baseline_str):
+        '''Microsecond pcap direct vs microsecond pcap written zstd compressed'''
+        if not features.have_zstd:
+            self.skipTest('Requires zstd.')
+        self.check_compressed_write(cmd_editcap, cmd_tshark, capture_file, fileformats_baseline_str,
+            'zstd', 'zst', b'\x28\xb5\x2f\xfd')
+
+    def test_pcap_lz4_write(self, cmd_editcap, cmd_tshark, capture_file, features, fileformats_baseline_str):
+        '''Microsecond pcap direct vs microsecond pcap written lz4 compressed'''
+        if not features.have_lz4:
+            self.skipTest('Requires lz4.')
+        self.check_compressed_write(cmd_editcap, cmd_tshark, capture_file, fileformats_baseline_str,
+            'lz4', 'lz4', b'\x04\x22\x4d\x18')
+
+    def test_seek_index(self, cmd_tshark, capture_file):
+        '''A saved seek index gives the same two-pass results'''
+        infile = self.filename_from_id('icmp.pcapng.gz')
+        shutil.copyfile(capture_file('icmp.pcapng.gz'), infile)
+        fields = ('-Tfields', '-e', 'frame.number', '-e', 'frame.len')
+        direct_proc = self.assertRun((cmd_tshark, '-2', '-r', infile) + fields)
+        self.assertRun((cmd_tshark, '--save-seek-index', '-r', infile) + fields)
+        idx_file = infile + '.wsidx'
+        self.assertTrue(os.path.isfile(idx_file))
+        # An index is written to a temporary file and renamed, so it's
+        # only replaced if the one that's there wasn't loaded.
+        saved_ino = os.stat(idx_file).st_ino
+        indexed_proc = self.assertRun((cmd_tshark, '--save-seek-index', '-2', '-r', infile) + fields)
+        self.assertEqual(indexed_proc.stdout_str, direct_proc.stdout_str)
+        self.assertEqual(os.stat(idx_file).st_ino, saved_ino)
+        # Once the capture has changed, the index is stale and is rebuilt.
+        capture_mtime = os.stat(infile).st_mtime + 100
+        os.utime(infile, (capture_mtime, capture_mtime))
+        rebuilt_proc = self.assertRun((cmd_tshark, '--save-seek-index', '-2', '-r', infile) + fields)
+        self.assertEqual(rebuilt_proc.stdout_str, direct_proc.stdout_str)
+        self.assertNotEqual(os.stat(idx_file).st_ino, saved_ino)
+
+    def test_seek_index_gzi(self, cmd_tshark, capture_file):
+        '''A BGZF index that doesn't match its capture is ignored'''
+        with open(capture_file('dhcp.pcap'), 'rb') as f:
+            data = f.read()
+        infile = self.filename_from_id('dhcp.pcap.gz')
+        block_size = 256
+        with open(infile, 'wb') as f:
+            # The last block is the empty BGZF end-of-file marker.
+            blocks = [data[start:start + block_size] for start in range(0, len(data), block_size)]
+            for block in blocks + [b'']:
+                compressor = zlib.compressobj(6, zlib.DEFLATED, -15)
+                cdata = compressor.compress(block) + compressor.flush()
+                f.write(struct.pack('<BBBBIBBHBBHH', 31, 139, 8, 4, 0, 0, 255,
+                    6, ord('B'), ord('C'), 2, 18 + len(cdata) + 8 - 1))
+                f.write(cdata)
+                f.write(struct.pack('<II', zlib.crc32(block) & 0xffffffff, len(block)))
+        fields = ('-Tfields', '-e', 'frame.number', '-e', 'frame.time_epoch', '-e', 'frame.len')
+        direct_proc = self.assertRun((cmd_tshark, '-2', '-r', infile) + fields)
+        # Offsets that aren't the starts of blocks.
+        with open(infile + '.gzi', 'wb') as f:
+            f.write(struct.pack('<QQQQQ', 2, 100, block_size, 200, 2 * block_size))
+        indexed_proc = self.assertRun((cmd_tshark, '-2', '-r', infile) + fields)
+        self.assertEqual(indexed_proc.stdout_str, direct_proc.stdout_str)
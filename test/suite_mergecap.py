@@ -10,6 +10,8 @@
 '''Mergecap tests'''
 
 import re
+import struct
+import time
 import subprocesstest
 import fixtures
 
@@ -286,3 +288,168 @@ class case_mergecap_pcapng(subprocesstest.SubprocessTestCase):
         ))
         # check for 11 IDBs, 88*3=264 total pkts, 86*3=258 in first IDB
         check_mergecap(self, mergecap_proc, 'pcapng', 'Per packet', 264, 11, 258)
+
+
+def write_synthetic_pcap(filename, file_index, file_count, packet_count):
+    '''Write a pcap file whose packets interleave with those of the other
+    synthetic inputs, so that a chronological merge has to switch input files
+    on every record.'''
+    payload = bytes(range(60))
+    packets = []
+    for packet_num in range(packet_count):
+        ts_usec = packet_num * file_count + file_index
+        packets.append((1500000000 + ts_usec // 1000000, ts_usec % 1000000, payload))
+    subprocesstest.write_pcap(filename, packets)
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_mergecap_many_inputs(subprocesstest.SubprocessTestCase):
+    '''Merge many synthetic inputs and log how long mergecap took.'''
+    total_packets = 32768
+
+    def merge_synthetic_inputs(self, cmd_mergecap, file_count, mergecap_args=()):
+        packet_count = self.total_packets // file_count
+        in_files = []
+        for file_index in range(file_count):
+            in_file = self.filename_from_id('testin.{}.pcap'.format(file_index))
+            write_synthetic_pcap(in_file, file_index, file_count, packet_count)
+            in_files.append(in_file)
+        testout_file = self.filename_from_id(testout_pcap)
+        start_time = time.perf_counter()
+        self.assertRun([cmd_mergecap, '-F', 'pcap', '-w', testout_file] + list(mergecap_args) + in_files)
+        elapsed = time.perf_counter() - start_time
+        self.log_fd.write('\nMerged {} inputs, {} packets in {:.3f}s\n'.format(
+            file_count, packet_count * file_count, elapsed))
+        capinfos_testout = self.getCaptureInfo(capinfos_args=('-c', '-o'), cap_file=testout_file)
+        self.assertTrue(re.search(r'Number of packets:\s+{}'.format(packet_count * file_count), capinfos_testout) is not None)
+        self.assertTrue(re.search(r'Strict time order:\s+True', capinfos_testout) is not None)
+
+    def test_mergecap_8_inputs(self, cmd_mergecap):
+        '''Merge 8 synthetic pcap files'''
+        self.merge_synthetic_inputs(cmd_mergecap, 8)
+
+    def test_mergecap_64_inputs(self, cmd_mergecap):
+        '''Merge 64 synthetic pcap files'''
+        self.merge_synthetic_inputs(cmd_mergecap, 64)
+
+    def test_mergecap_512_inputs(self, cmd_mergecap):
+        '''Merge 512 synthetic pcap files'''
+        self.merge_synthetic_inputs(cmd_mergecap, 512)
+
+    def test_mergecap_64_inputs_read_ahead(self, cmd_mergecap):
+        '''Merge 64 synthetic pcap files, reading ahead on a thread per file'''
+        self.merge_synthetic_inputs(cmd_mergecap, 64, ('--read-ahead', '32'))
+
+    def test_mergecap_64_inputs_append_read_ahead(self, cmd_mergecap):
+        '''Concatenate 64 synthetic pcap files, reading ahead on a thread per file'''
+        packet_count = self.total_packets // 64
+        in_files = []
+        for file_index in range(64):
+            in_file = self.filename_from_id('testin.{}.pcap'.format(file_index))
+            write_synthetic_pcap(in_file, file_index, 64, packet_count)
+            in_files.append(in_file)
+        testout_file = self.filename_from_id(testout_pcap)
+        self.assertRun([cmd_mergecap, '-a', '--read-ahead', '32', '-F', 'pcap', '-w', testout_file] + in_files)
+        self.checkPacketCount(packet_count * 64, cap_file=testout_file)
+
+
+def ordering_payload(file_index, packet_index):
+    '''Return an Ethernet-sized payload that names the input file and the
+    packet within it, so that the order of a merge can be read back.'''
+    return bytes((file_index, packet_index)) + bytes(58)
+
+
+def read_pcapng_origins(filename):
+    '''Return the (file_index, packet_index) pairs of the packets in a
+    pcapng file written by mergecap, in file order.'''
+    with open(filename, 'rb') as pcapng_fd:
+        data = pcapng_fd.read()
+    byte_order = '<' if struct.unpack_from('<I', data, 8)[0] == 0x1a2b3c4d else '>'
+    origins = []
+    offset = 0
+    while offset < len(data):
+        block_type, total_length = struct.unpack_from(byte_order + 'II', data, offset)
+        if block_type == 6:
+            # Enhanced packet block: the data follows the interface ID,
+            # the time stamp and the two lengths.
+            origins.append((data[offset + 28], data[offset + 29]))
+        elif block_type == 3:
+            origins.append((data[offset + 12], data[offset + 13]))
+        offset += total_length
+    return origins
+
+
+@fixtures.mark_usefixtures('test_env')
+@fixtures.uses_fixtures
+class case_mergecap_ordering(subprocesstest.SubprocessTestCase):
+    '''Check the order in which a chronological merge takes records that
+    it cannot order by time stamp alone.'''
+
+    def merge_and_read_origins(self, cmd_mergecap, in_files, mergecap_args=()):
+        testout_file = self.filename_from_id(testout_pcapng)
+        self.assertRun([cmd_mergecap, '-F', 'pcapng', '-w', testout_file] + list(mergecap_args) + in_files)
+        return read_pcapng_origins(testout_file)
+
+    def write_equal_time_inputs(self):
+        # Every file has two packets at one time and a third a second later.
+        in_files = []
+        for file_index in range(3):
+            in_file = self.filename_from_id('testin.{}.pcap'.format(file_index))
+            subprocesstest.write_pcap(in_file, [
+                (1500000000, 0, ordering_payload(file_index, 0)),
+                (1500000000, 0, ordering_payload(file_index, 1)),
+                (1500000001, 0, ordering_payload(file_index, 2)),
+            ])
+            in_files.append(in_file)
+        return in_files
+
+    # On equal time stamps the later input file goes first, as it always
+    # has, and a file keeps its own records in order.
+    equal_time_order = [
+        (2, 0), (2, 1), (1, 0), (1, 1), (0, 0), (0, 1),
+        (2, 2), (1, 2), (0, 2),
+    ]
+
+    def test_mergecap_equal_time_stamps(self, cmd_mergecap):
+        '''Merge records with equal time stamps'''
+        origins = self.merge_and_read_origins(cmd_mergecap, self.write_equal_time_inputs())
+        self.assertEqual(origins, self.equal_time_order)
+
+    def test_mergecap_equal_time_stamps_read_ahead(self, cmd_mergecap):
+        '''Merge records with equal time stamps, reading ahead'''
+        origins = self.merge_and_read_origins(cmd_mergecap, self.write_equal_time_inputs(), ('--read-ahead', '2'))
+        self.assertEqual(origins, self.equal_time_order)
+
+    def write_no_time_inputs(self):
+        # Simple packet blocks have no time stamp.
+        inputs = [
+            [(0, 1500000001, 0), (0, None, 0), (0, 1500000003, 0)],
+            [(0, None, 0), (0, 1500000002, 0)],
+            [(0, None, 0), (0, None, 0)],
+        ]
+        in_files = []
+        for file_index, packets in enumerate(inputs):
+            in_file = self.filename_from_id('testin.{}.pcapng'.format(file_index))
+            subprocesstest.write_pcapng(in_file, [
+                (interface_id, ts_sec, ts_usec, ordering_payload(file_index, packet_index))
+                for packet_index, (interface_id, ts_sec, ts_usec) in enumerate(packets)
+            ])
+            in_files.append(in_file)
+        return in_files
+
+    # A record without a time stamp goes before any record with one, and
+    # records without time stamps are taken in input file order.
+    no_time_order = [
+        (1, 0), (2, 0), (2, 1), (0, 0), (0, 1), (1, 1), (0, 2),
+    ]
+
+    def test_mergecap_no_time_stamps(self, cmd_mergecap):
+        '''Merge records without time stamps'''
+        origins = self.merge_and_read_origins(cmd_mergecap, self.write_no_time_inputs())
+        self.assertEqual(origins, self.no_time_order)
+
+    def test_mergecap_no_time_stamps_read_ahead(self, cmd_mergecap):
+        '''Merge records without time stamps, reading ahead'''
+        origins = self.merge_and_read_origins(cmd_mergecap, self.write_no_time_inputs(), ('--read-ahead', '2'))
+        self.assertEqual(origins, self.no_time_order)
@@ -9,8 +9,10 @@
 #
 '''Name resolution tests'''
 
+import os
 import os.path
 import shutil
+import sys
 import subprocesstest
 import fixtures
 
@@ -129,3 +131,54 @@ class case_name_resolution(subprocesstest.SubprocessTestCase):
                 ))
         self.assertTrue(self.grepOutput('fe80::6233:4bff:fe13:c558\tCrunch.local'))
         self.assertFalse(self.grepOutput('174.137.42.65\twww.wireshark.org'))
+
+    def test_manuf_names(self, cmd_tshark, capture_file):
+        # The global manuf file comes from the names database when it's
+        # there, and wka is always parsed.
+        self.assertRun((cmd_tshark,
+                '-r', capture_file('dhcp.pcap'),
+                '-N', 'm',
+                '-c', '1',
+                '-T', 'fields',
+                '-e', 'eth.src_resolved',
+                '-e', 'eth.dst_resolved',
+                ))
+        self.assertTrue(self.grepOutput('Grandstr_01:fc:42\tBroadcast'))
+
+    def test_manuf_names_db(self, cmd_tshark, capture_file, program_path, base_env):
+        # Pair the names database with a manuf file of the same size that
+        # names the source address's manufacturer differently, so that
+        # the name shows which of the two was used.
+        if sys.platform == 'win32':
+            self.skipTest('WIRESHARK_DATA_DIR is not used on Windows')
+        db_path = os.path.join(program_path, 'names.db')
+        if not os.path.isfile(db_path):
+            self.skipTest('names.db is not in ' + program_path)
+        with open(os.path.join(program_path, 'manuf'), 'rb') as manuf_f:
+            manuf = manuf_f.read()
+        self.assertIn(b'\tGrandstr\t', manuf)
+        data_dir = self.filename_from_id('data')
+        os.makedirs(data_dir)
+        shutil.copyfile(db_path, os.path.join(data_dir, 'names.db'))
+        manuf_path = os.path.join(data_dir, 'manuf')
+        with open(manuf_path, 'wb') as manuf_f:
+            manuf_f.write(manuf.replace(b'\tGrandstr\t', b'\tTextfile\t', 1))
+        db_mtime = os.stat(os.path.join(data_dir, 'names.db')).st_mtime
+        data_env = dict(base_env, WIRESHARK_DATA_DIR=data_dir)
+        tshark_args = (cmd_tshark,
+                '-r', capture_file('dhcp.pcap'),
+                '-N', 'm',
+                '-c', '1',
+                '-T', 'fields',
+                '-e', 'eth.src_resolved',
+                )
+
+        # A manuf file older than the database is looked up in it.
+        os.utime(manuf_path, (db_mtime - 60, db_mtime - 60))
+        self.assertRun(tshark_args, env=data_env)
+        self.assertTrue(self.grepOutput('^Grandstr_01:fc:42$'))
+
+        # One modified after it is parsed, even though its size is the same.
+        os.utime(manuf_path, (db_mtime + 60, db_mtime + 60))
+        self.assertRun(tshark_args, env=data_env)
+        self.assertTrue(self.grepOutput('^Textfile_01:fc:42$'))
@@ -73,7 +73,7 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
         check_sharkd_session((
             {"req": "status"},
         ), (
-            {"frames": 0, "duration": 0.0},
+            {"frames": 0, "duration": 0.0, "wmem": MatchAny(list)},
         ))
 
     def test_sharkd_req_status(self, check_sharkd_session, capture_file):
@@ -83,7 +83,28 @@ class case_sharkd(subprocesstest.SubprocessTestCase):
         ), (
             {"err": 0},
             {"frames": 4, "duration": 0.070345000,
-                "filename": "dhcp.pcap", "filesize": 1400},
+                "filename": "dhcp.pcap", "filesize": 1400, "wmem": MatchAny(list)},
+        ))
+
+    def test_sharkd_req_status_wmem(self, check_sharkd_session, capture_file):
+        matchPool = MatchObject({
+            "name": MatchAny(str),
+            "in_use": MatchAny(int),
+            "peak": MatchAny(int),
+            "allocs": MatchAny(int),
+            "frees": MatchAny(int),
+        })
+        check_sharkd_session((
+            {"req": "load", "file": capture_file('dhcp.pcap')},
+            {"req": "status"},
+        ), (
+            {"err": 0},
+            MatchObject({"wmem": MatchList(matchPool)}),
+        ))
+        check_sharkd_session((
+            {"req": "status"},
+        ), (
+            MatchObject({"wmem": MatchList(MatchObject({"name": "File scope"}), match_element=any)}),
         ))
 
     def test_sharkd_req_analyse(self, check_sharkd_session, capture_file):
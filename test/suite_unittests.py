@@ -20,14 +20,32 @@ import fixtures
 
 @fixtures.uses_fixtures
 class case_unittests(subprocesstest.SubprocessTestCase):
+    def test_unit_conversation_test(self, program, base_env):
+        '''conversation_test'''
+        self.assertRun(program('conversation_test'), env=base_env)
+
     def test_unit_exntest(self, program, base_env):
         '''exntest'''
         self.assertRun(program('exntest'), env=base_env)
 
+    def test_unit_field_index_test(self, program, capture_file, base_env):
+        '''field_index_test'''
+        self.assertRun((program('field_index_test'),
+            capture_file('dns+icmp.pcapng.gz')
+        ), env=base_env)
+
     def test_unit_oids_test(self, program, base_env):
         '''oids_test'''
         self.assertRun(program('oids_test'), env=base_env)
 
+    def test_unit_packet_search_test(self, program, base_env):
+        '''packet_search_test'''
+        self.assertRun(program('packet_search_test'), env=base_env)
+
+    def test_unit_read_batch_test(self, program, base_env):
+        '''read_batch_test'''
+        self.assertRun(program('read_batch_test'), env=base_env)
+
     def test_unit_reassemble_test(self, program, base_env):
         '''reassemble_test'''
         self.assertRun(program('reassemble_test'), env=base_env)
@@ -48,6 +66,10 @@ class case_unittests(subprocesstest.SubprocessTestCase):
             '--verbose'
         ), env=base_env)
 
+    def test_unit_zero_copy_test(self, program, base_env):
+        '''zero_copy_test'''
+        self.assertRun(program('zero_copy_test'), env=base_env)
+
     def test_unit_fieldcount(self, cmd_tshark, test_env):
         '''fieldcount'''
         self.assertRun((cmd_tshark, '-G', 'fieldcount'), env=test_env)
@@ -0,0 +1,260 @@
+#!/usr/bin/env python3
+#
+# Compiles the manuf, services and enterprises.tsv files into a database
+# that epan/addr_resolv_db.c can map into memory and query without parsing
+# anything.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+'''\
+Usage: make-names-db.py <manuf> <services> <enterprises.tsv> <output>
+
+The output is little-endian and laid out as follows. All offsets are from
+the start of the file.
+
+    header:     magic "WSND", version, number of tables, reserved (4 x u32)
+    directory:  per table: id, number of entries, number of buckets,
+                number of slots, size of the source file, offset of the
+                bucket seeds, offset of the slots (7 x u32)
+    seeds:      per bucket: u32
+    slots:      per slot: key (u64), offset of the name, offset of the
+                long name (2 x u32); a name offset of 0 marks an empty slot
+    strings:    NUL-terminated UTF-8
+
+Each table is a perfect hash ("hash and displace"): a key's bucket is
+mix(key, 0) % buckets, and its slot is mix(key, seed of its bucket) % slots.
+Keys are
+    manuf:       mask << 48 | address, where the mask is 0 for a
+                 manufacturer ID and the address is masked
+    services:    transport << 16 | port, with the transports numbered
+                 1 tcp, 2 udp, 3 sctp, 4 dccp
+    enterprises: the enterprise number
+'''
+
+import os
+import re
+import struct
+import sys
+
+MAGIC = b'WSND'
+VERSION = 1
+
+TABLE_MANUF = 1
+TABLE_SERVICES = 2
+TABLE_ENTERPRISES = 3
+
+# MAXNAMELEN in epan/addr_resolv.h, including the NUL.
+MAXNAMELEN = 64
+
+SERVICE_TRANSPORTS = { 'tcp': 1, 'udp': 2, 'sctp': 3, 'dccp': 4 }
+
+U64_MASK = 0xFFFFFFFFFFFFFFFF
+
+# Must match names_db_mix() in epan/addr_resolv_db.c.
+def mix(key, seed):
+    z = (key + (seed + 1) * 0x9E3779B97F4A7C15) & U64_MASK
+    z = ((z ^ (z >> 30)) * 0xBF58476D1CE4E5B9) & U64_MASK
+    z = ((z ^ (z >> 27)) * 0x94D049BB133111EB) & U64_MASK
+    return z ^ (z >> 31)
+
+def truncate_name(name):
+    # g_strlcpy(..., MAXNAMELEN) cuts the name at MAXNAMELEN - 1 bytes.
+    return name.encode('utf-8')[:MAXNAMELEN - 1]
+
+def parse_ether_address(addr_str):
+    '''Returns (address, mask) as parse_ether_address() in addr_resolv.c does,
+    or None.'''
+    m = re.fullmatch(r'([0-9A-Fa-f]{1,2}(?:([:.-])[0-9A-Fa-f]{1,2})*)(?:/([0-9]+))?', addr_str)
+    if not m:
+        return None
+    sep = m.group(2)
+    octet_strs = re.split(r'[:.-]', m.group(1))
+    if sep and any(c != sep for c in re.findall(r'[:.-]', m.group(1))):
+        return None
+    if len(octet_strs) > 6:
+        return None
+    addr = 0
+    for o in octet_strs + ['0'] * (6 - len(octet_strs)):
+        addr = addr << 8 | int(o, 16)
+    if m.group(3) is not None:
+        mask = int(m.group(3))
+        if mask == 0 or mask >= 48:
+            return None
+        addr &= (U64_MASK << (48 - mask)) & 0xFFFFFFFFFFFF
+        return (addr, mask)
+    if len(octet_strs) == 3:
+        # A manufacturer ID.
+        return (addr, 0)
+    if len(octet_strs) == 6:
+        return (addr, 48)
+    return None
+
+def parse_manuf(path):
+    entries = {}
+    with open(path, encoding='utf-8', errors='replace') as manuf_f:
+        for line in manuf_f:
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            line = line.split('#', 1)[0].rstrip()
+            fields = line.split(None, 1)
+            if len(fields) < 2:
+                continue
+            parsed = parse_ether_address(fields[0])
+            if parsed is None:
+                continue
+            addr, mask = parsed
+            # The short name ends at a space or tab, the long name at a tab.
+            rest = fields[1]
+            name_m = re.match(r'([^ \t]+)[ \t]*(.*)', rest)
+            name = name_m.group(1)
+            longname = name_m.group(2).lstrip('\t').split('\t', 1)[0]
+            if not longname:
+                longname = name
+            entries[mask << 48 | addr] = (truncate_name(name), truncate_name(longname))
+    return entries
+
+def parse_port_range(range_str):
+    ports = []
+    for part in range_str.split(','):
+        part = part.strip()
+        if not part:
+            continue
+        if '-' in part:
+            low, high = part.split('-', 1)
+            low = int(low) if low else 0
+            high = int(high) if high else 0xFFFF
+        else:
+            low = high = int(part)
+        if low > high or high > 0xFFFF:
+            raise ValueError(range_str)
+        ports.extend(range(low, high + 1))
+    return ports
+
+def parse_services(path):
+    entries = {}
+    with open(path, encoding='utf-8', errors='replace') as svc_f:
+        for line in svc_f:
+            line = line.rstrip('\r\n').split('#', 1)[0]
+            fields = line.split(None, 2)
+            if len(fields) < 2:
+                continue
+            service = fields[0]
+            port_fields = fields[1].split('/')
+            try:
+                ports = parse_port_range(port_fields[0])
+            except ValueError:
+                continue
+            for transport in port_fields[1:]:
+                if transport not in SERVICE_TRANSPORTS:
+                    break
+                for port in ports:
+                    # Port 0 is never named.
+                    if port:
+                        entries[SERVICE_TRANSPORTS[transport] << 16 | port] = (truncate_name(service), None)
+    return entries
+
+def parse_enterprises(path):
+    entries = {}
+    with open(path, encoding='utf-8', errors='replace') as ent_f:
+        for line in ent_f:
+            line = line.rstrip('\r\n').split('#', 1)[0]
+            fields = line.split(None, 1)
+            if len(fields) < 2 or not fields[1].strip():
+                continue
+            try:
+                dec = int(fields[0], 10)
+            except ValueError:
+                continue
+            if dec < 0 or dec > 0xFFFFFFFF:
+                continue
+            # Enterprise names aren't truncated.
+            entries[dec] = (fields[1].strip().encode('utf-8'), None)
+    return entries
+
+def build_perfect_hash(keys):
+    '''Returns (seeds, slots), where slots[i] is a key or None.'''
+    num_buckets = max(1, (len(keys) + 3) // 4)
+    num_slots = max(1, len(keys) * 5 // 4)
+    buckets = [[] for _ in range(num_buckets)]
+    for key in keys:
+        buckets[mix(key, 0) % num_buckets].append(key)
+
+    seeds = [0] * num_buckets
+    slots = [None] * num_slots
+    # Place the biggest buckets first, while there are lots of free slots.
+    for bucket_idx in sorted(range(num_buckets), key=lambda b: -len(buckets[b])):
+        bucket = buckets[bucket_idx]
+        if not bucket:
+            continue
+        seed = 1
+        while True:
+            positions = [mix(key, seed) % num_slots for key in bucket]
+            if len(set(positions)) == len(positions) and all(slots[p] is None for p in positions):
+                break
+            seed += 1
+        seeds[bucket_idx] = seed
+        for key, pos in zip(bucket, positions):
+            slots[pos] = key
+    return seeds, slots
+
+def write_db(path, tables):
+    header_len = 16
+    directory_len = 28 * len(tables)
+    offset = header_len + directory_len
+
+    built = []
+    for table_id, entries, source_size in tables:
+        seeds, slots = build_perfect_hash(list(entries.keys()))
+        seeds_offset = offset
+        offset += 4 * len(seeds)
+        slots_offset = offset
+        offset += 16 * len(slots)
+        built.append((table_id, entries, source_size, seeds, slots, seeds_offset, slots_offset))
+
+    strings = bytearray()
+    string_offsets = {}
+    def add_string(s):
+        if s not in string_offsets:
+            string_offsets[s] = offset + len(strings)
+            strings.extend(s + b'\0')
+        return string_offsets[s]
+
+    out = bytearray(struct.pack('<4sIII', MAGIC, VERSION, len(tables), 0))
+    for table_id, entries, source_size, seeds, slots, seeds_offset, slots_offset in built:
+        out += struct.pack('<7I', table_id, len(entries), len(seeds), len(slots),
+            source_size, seeds_offset, slots_offset)
+    for table_id, entries, source_size, seeds, slots, seeds_offset, slots_offset in built:
+        out += struct.pack('<%dI' % len(seeds), *seeds)
+        for key in slots:
+            if key is None:
+                out += struct.pack('<QII', 0, 0, 0)
+                continue
+            name, longname = entries[key]
+            name_off = add_string(name)
+            longname_off = add_string(longname) if longname is not None else name_off
+            out += struct.pack('<QII', key, name_off, longname_off)
+    out += strings
+
+    with open(path, 'wb') as db_f:
+        db_f.write(out)
+
+def main():
+    if len(sys.argv) != 5:
+        sys.stderr.write(__doc__)
+        sys.exit(1)
+    manuf_path, services_path, enterprises_path, db_path = sys.argv[1:]
+
+    tables = [
+        (TABLE_MANUF, parse_manuf(manuf_path), os.path.getsize(manuf_path)),
+        (TABLE_SERVICES, parse_services(services_path), os.path.getsize(services_path)),
+        (TABLE_ENTERPRISES, parse_enterprises(enterprises_path), os.path.getsize(enterprises_path)),
+    ]
+    write_db(db_path, tables)
+
+if __name__ == '__main__':
+    main()
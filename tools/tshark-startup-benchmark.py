@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+#
+# Measures how long short tshark runs take, started directly and through
+# a fork server ("tshark --fork-server"), which registers the dissectors
+# once instead of on every run.
+#
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+'''Time short tshark runs with and without a fork server.'''
+
+import argparse
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+def time_runs(cmd, runs):
+    times = []
+    for _ in range(runs):
+        start = time.perf_counter()
+        subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL)
+        times.append(time.perf_counter() - start)
+    return times
+
+def report(label, times):
+    print('{:<12} min {:8.1f} ms  median {:8.1f} ms  max {:8.1f} ms'.format(label,
+        min(times) * 1000, statistics.median(times) * 1000, max(times) * 1000))
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--program-path', required=True,
+        help='directory containing tshark')
+    parser.add_argument('--capture', required=True,
+        help='capture file read by each run')
+    parser.add_argument('--runs', type=int, default=20,
+        help='number of runs of each kind (default: 20)')
+    args = parser.parse_args()
+
+    tshark = os.path.join(args.program_path, 'tshark')
+    run_args = ('-r', os.path.abspath(args.capture), '-c', '1')
+
+    print('{} runs of "tshark {}"'.format(args.runs, ' '.join(run_args)))
+    report('direct', time_runs((tshark,) + run_args, args.runs))
+
+    if sys.platform == 'win32':
+        print('The fork server is not available on Windows.')
+        return
+
+    with tempfile.TemporaryDirectory() as tmp_dir:
+        sock_path = os.path.join(tmp_dir, 'fork.sock')
+        start = time.perf_counter()
+        server = subprocess.Popen((tshark, '--fork-server', sock_path))
+        try:
+            while not os.path.exists(sock_path):
+                if server.poll() is not None:
+                    sys.exit('The fork server exited with status {}.'.format(server.returncode))
+                time.sleep(0.01)
+            print('{:<12} {:8.1f} ms'.format('server up', (time.perf_counter() - start) * 1000))
+            report('fork client', time_runs((tshark, '--fork-client', sock_path) + run_args, args.runs))
+        finally:
+            server.terminate()
+            server.wait()
+
+if __name__ == '__main__':
+    main()
@@ -12,6 +12,10 @@
 
 #include <config.h>
 
+#ifdef __linux__
+#define _GNU_SOURCE /* Otherwise struct ucred won't be defined */
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -29,7 +33,14 @@
 #endif
 
 #ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #endif
 
 #ifdef HAVE_LIBCAP
@@ -117,6 +128,7 @@
 #include <wsutil/str_util.h>
 #include <wsutil/utf8_entities.h>
 #include <wsutil/json_dumper.h>
+#include <wsutil/pint.h>
 
 #include "extcap.h"
 
@@ -141,6 +153,14 @@
 #define LONGOPT_COLOR                   LONGOPT_BASE_APPLICATION+2
 #define LONGOPT_NO_DUPLICATE_KEYS       LONGOPT_BASE_APPLICATION+3
 #define LONGOPT_ELASTIC_MAPPING_FILTER  LONGOPT_BASE_APPLICATION+4
+#define LONGOPT_PRUNE_DISSECTION        LONGOPT_BASE_APPLICATION+5
+#define LONGOPT_SAVE_SEEK_INDEX         LONGOPT_BASE_APPLICATION+6
+#define LONGOPT_PARALLEL_WORKERS        LONGOPT_BASE_APPLICATION+7
+#define LONGOPT_PIPELINE                LONGOPT_BASE_APPLICATION+8
+#define LONGOPT_FORK_SERVER             LONGOPT_BASE_APPLICATION+9
+#define LONGOPT_SAVE_TIME_INDEX         LONGOPT_BASE_APPLICATION+10
+#define LONGOPT_FILTER_SERVER           LONGOPT_BASE_APPLICATION+11
+#define LONGOPT_ZERO_COPY               LONGOPT_BASE_APPLICATION+12
 
 #if 0
 #define tshark_debug(...) g_warning(__VA_ARGS__)
@@ -195,6 +215,62 @@ static pf_flags protocolfilter_flags = PF_NONE;
 static gboolean no_duplicate_keys = FALSE;
 static proto_node_children_grouper_func node_children_grouper = proto_node_group_children_by_unique;
 
+/* With --prune-dissection, the protocols that have to be dissected for the
+   display filter to see everything it tests; NULL to dissect everything. */
+static gboolean prune_dissection = FALSE;
+static GHashTable *dissect_protocols = NULL;
+
+/* With --parallel-workers, the number of worker processes that share the
+   two passes, each taking the conversations whose address pair hashes to
+   it.  In a worker, its index, the frames it's responsible for, and the
+   file to which it writes the frame number and end offset of the output
+   for each packet, so that the parent can put the workers' output back
+   in frame order. */
+static guint parallel_workers = 0;
+#ifndef _WIN32
+static int parallel_worker = -1;
+static GArray *parallel_worker_frames = NULL;
+static FILE *parallel_worker_index = NULL;
+
+typedef struct {
+  guint64 end;        /* offset just past the packet's output */
+  guint32 framenum;
+} parallel_output_t;
+#endif
+
+/* With --pipeline, records are read ahead on a thread of their own and,
+   where we can buffer the output in memory, written out on another, so
+   that the main thread only dissects and formats.  packet_output is
+   where print_packet() writes; it's the standard output unless the
+   output is being handed to the writer thread. */
+static gboolean pipeline = FALSE;
+static FILE *packet_output = NULL;
+
+/* With --zero-copy, packet data is left in a memory mapping of the input
+   file rather than copied; that's only safe if nothing truncates the
+   file while we read it, so it's not the default. */
+static gboolean zero_copy = FALSE;
+
+#ifndef _WIN32
+/* With --fork-server, the socket on which we wait for the arguments of
+   runs of tshark, each of which is done by a process forked after the
+   dissectors and taps have been registered, so that it doesn't have to
+   register them again.  A run is requested with "--fork-client", which
+   passes its arguments, working directory and standard input, output and
+   error, and gets back the exit status of the run. */
+static const char *fork_server_path = NULL;
+
+#define FORK_SERVER_MAX_REQUEST (1024 * 1024)
+
+/* With --fork-client, the connection to the fork server, on which we pass
+   on the signals that would otherwise stop only us and not the run. */
+static volatile int fork_client_conn = -1;
+
+/* With --filter-server, we're a helper that Wireshark runs to filter the
+   capture file it has open; see run_filter_server(). */
+static gboolean filter_server = FALSE;
+#endif
+
 static json_dumper jdumper;
 
 /* The line separator used between packets, changeable via the -S option */
@@ -238,6 +314,9 @@ typedef enum {
   PROCESS_FILE_INTERRUPTED
 } process_file_status_t;
 static process_file_status_t process_cap_file(capture_file *, char *, int, gboolean, int, gint64);
+#ifndef _WIN32
+static int run_filter_server(capture_file *cf);
+#endif
 
 static gboolean process_packet_single_pass(capture_file *cf,
     epan_dissect_t *edt, gint64 offset, wtap_rec *rec, Buffer *buf,
@@ -377,10 +456,24 @@ print_usage(FILE *output)
   fprintf(output, "Input file:\n");
   fprintf(output, "  -r <infile>, --read-file <infile>\n");
   fprintf(output, "                           set the filename to read from (or '-' for stdin)\n");
+  fprintf(output, "  --save-seek-index        save a seek index next to a compressed input file\n");
+  fprintf(output, "  --save-time-index        save a time index next to a pcap or pcapng input file\n");
+  fprintf(output, "  --zero-copy              read packet data from a memory mapping of the input\n");
+  fprintf(output, "                           file; it must not be truncated while being read\n");
 
   fprintf(output, "\n");
   fprintf(output, "Processing:\n");
   fprintf(output, "  -2                       perform a two-pass analysis\n");
+  fprintf(output, "  --parallel-workers <count>\n");
+  fprintf(output, "                           with -2, split the work by conversation across\n");
+  fprintf(output, "                           this many worker processes\n");
+  fprintf(output, "  --pipeline               without -2, read and write packets on separate\n");
+  fprintf(output, "                           threads from the one dissecting them\n");
+  fprintf(output, "  --fork-server <socket>   register the dissectors once, then do each run\n");
+  fprintf(output, "                           requested on this socket in a forked process\n");
+  fprintf(output, "  --fork-client <socket> [options]\n");
+  fprintf(output, "                           have the fork server on this socket do a run\n");
+  fprintf(output, "                           with these options (must be the first option)\n");
   fprintf(output, "  -M <packet count>        perform session auto reset\n");
   fprintf(output, "  -R <read filter>, --read-filter <read filter>\n");
   fprintf(output, "                           packet Read filter in Wireshark display filter syntax\n");
@@ -469,6 +562,8 @@ print_usage(FILE *output)
   fprintf(output, "                           values\n");
   fprintf(output, "  --elastic-mapping-filter <protocols> If -G elastic-mapping is specified, put only the\n");
   fprintf(output, "                           specified protocols within the mapping file\n");
+  fprintf(output, "  --prune-dissection       with -Y and no packet output, skip dissectors that\n");
+  fprintf(output, "                           can't lead to a protocol the filter tests\n");
 
   fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
@@ -691,6 +786,500 @@ must_do_dissection(dfilter_t *rfcode, dfilter_t *dfcode,
       tap_listeners_require_dissection() || dissect_color;
 }
 
+static void
+setup_dissection_pruning(dfilter_t *dfcode, gchar *volatile pdu_export_arg)
+{
+  int *proto_ids;
+  int  num_protos;
+
+  /* Pruning is only safe if the display filter is the only thing that
+     looks at the dissection: no packet output, no taps, no
+     postdissectors that want fields and no second pass. */
+  if (!prune_dissection || dfcode == NULL || print_packet_info ||
+      perform_two_pass_analysis || pdu_export_arg ||
+      tap_listeners_require_dissection() || postdissectors_want_hfids())
+    return;
+
+  proto_ids = dfilter_interesting_protocols(dfcode, &num_protos);
+  if (proto_ids == NULL)
+    return;
+  dissect_protocols = dissector_protocols_leading_to(proto_ids, num_protos);
+  g_free(proto_ids);
+}
+
+#ifndef _WIN32
+static gboolean
+fork_server_read_full(int fd, void *buf, size_t len)
+{
+  guint8  *p = (guint8 *)buf;
+  ssize_t  nread;
+
+  while (len != 0) {
+    nread = read(fd, p, len);
+    if (nread < 0 && errno == EINTR)
+      continue;
+    if (nread <= 0)
+      return FALSE;
+    p += nread;
+    len -= nread;
+  }
+  return TRUE;
+}
+
+static gboolean
+fork_server_write_full(int fd, const void *buf, size_t len)
+{
+  const guint8 *p = (const guint8 *)buf;
+  ssize_t       nwritten;
+
+  while (len != 0) {
+    nwritten = write(fd, p, len);
+    if (nwritten < 0 && errno == EINTR)
+      continue;
+    if (nwritten <= 0)
+      return FALSE;
+    p += nwritten;
+    len -= nwritten;
+  }
+  return TRUE;
+}
+
+static gboolean
+fork_server_sockaddr(const char *path, struct sockaddr_un *addr)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr->sun_path)) {
+    cmdarg_err("The fork server socket path \"%s\" is too long.", path);
+    return FALSE;
+  }
+  g_strlcpy(addr->sun_path, path, sizeof(addr->sun_path));
+  return TRUE;
+}
+
+/*
+ * A request is the length of the rest of it, sent along with the
+ * client's standard input, output and error, followed by NUL-terminated
+ * strings: the working directory, then the arguments.
+ */
+static gboolean
+fork_server_receive(int conn, int fds[3], gchar **cwd, int *argc, char ***argv)
+{
+  guint32          len;
+  struct iovec     iov;
+  struct msghdr    msg;
+  struct cmsghdr  *cmsg;
+  union {
+    char           buf[CMSG_SPACE(3 * sizeof(int))];
+    struct cmsghdr align;
+  } control;
+  gchar           *request, *p, *end;
+  GPtrArray       *args;
+  ssize_t          nread;
+
+  memset(&msg, 0, sizeof(msg));
+  iov.iov_base = &len;
+  iov.iov_len = sizeof(len);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  do {
+    nread = recvmsg(conn, &msg, 0);
+  } while (nread < 0 && errno == EINTR);
+  cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET ||
+      cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(3 * sizeof(int)))
+    return FALSE;
+  memcpy(fds, CMSG_DATA(cmsg), 3 * sizeof(int));
+  if (nread != sizeof(len) || len == 0 || len > FORK_SERVER_MAX_REQUEST)
+    goto fail;
+
+  request = (gchar *)g_malloc(len);
+  if (!fork_server_read_full(conn, request, len) || request[len - 1] != '\0') {
+    g_free(request);
+    goto fail;
+  }
+
+  args = g_ptr_array_new();
+  end = request + len;
+  *cwd = g_strdup(request);
+  for (p = request + strlen(request) + 1; p < end; p += strlen(p) + 1)
+    g_ptr_array_add(args, g_strdup(p));
+  g_free(request);
+  if (args->len == 0) {
+    g_ptr_array_free(args, TRUE);
+    g_free(*cwd);
+    goto fail;
+  }
+  *argc = args->len;
+  g_ptr_array_add(args, NULL);
+  *argv = (char **)g_ptr_array_free(args, FALSE);
+  return TRUE;
+
+fail:
+  close(fds[0]);
+  close(fds[1]);
+  close(fds[2]);
+  return FALSE;
+}
+
+/*
+ * Only take requests from processes running as our user; anyone else
+ * could otherwise have us read and write files with our permissions.
+ */
+static gboolean
+fork_server_peer_allowed(int conn)
+{
+#if defined(SO_PEERCRED)
+  struct ucred cred;
+  socklen_t    cred_len = sizeof(cred);
+
+  if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0)
+    return FALSE;
+  return cred.uid == geteuid();
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
+      defined(__NetBSD__) || defined(__DragonFly__)
+  uid_t peer_uid;
+  gid_t peer_gid;
+
+  if (getpeereid(conn, &peer_uid, &peer_gid) < 0)
+    return FALSE;
+  return peer_uid == geteuid();
+#else
+  /* Rely on the permissions of the socket. */
+  (void)conn;
+  return TRUE;
+#endif
+}
+
+/*
+ * In the intermediate process, wait for the worker to exit, passing on
+ * to it the signals the client sends us.  exit_fd is the read end of a
+ * pipe whose write end only the worker has open, so it becomes readable
+ * when the worker exits.  If the client goes away, stop the worker.
+ */
+static int
+fork_server_wait(int conn, pid_t worker, int exit_fd)
+{
+  struct pollfd pfds[2];
+  guint32       sig;
+  int           status;
+
+  pfds[0].fd = exit_fd;
+  pfds[0].events = POLLIN;
+  pfds[1].fd = conn;
+  pfds[1].events = POLLIN;
+  for (;;) {
+    if (poll(pfds, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    if (pfds[0].revents != 0)
+      break;
+    if (pfds[1].revents != 0) {
+      if (fork_server_read_full(conn, &sig, sizeof(sig))) {
+        if (sig == SIGINT || sig == SIGTERM || sig == SIGHUP)
+          kill(worker, (int)sig);
+      } else {
+        kill(worker, SIGTERM);
+        pfds[1].fd = -1;
+      }
+    }
+  }
+  while (waitpid(worker, &status, 0) < 0) {
+    if (errno != EINTR)
+      return INIT_FAILED;
+  }
+  if (WIFEXITED(status))
+    return WEXITSTATUS(status);
+  if (WIFSIGNALED(status))
+    return 128 + WTERMSIG(status);
+  return INIT_FAILED;
+}
+
+/*
+ * Wait for requests on the socket at path.  For each one, fork a process
+ * that forks the worker that does the run and, when the worker has
+ * exited, sends its exit status back to the client; the intermediate
+ * process means the server never has to reap the workers itself.
+ *
+ * Returns only in a worker, with the arguments of its run in *argc and
+ * *argv, or if the socket can't be set up.
+ */
+static gboolean
+run_fork_server(const char *path, int *argc, char ***argv)
+{
+  struct sockaddr_un addr;
+  int                listen_fd, conn, fds[3], exit_pipe[2], i;
+  gchar             *cwd;
+  int                req_argc;
+  char             **req_argv;
+  pid_t              monitor, worker;
+  guint32            exit_code;
+  mode_t             old_umask;
+
+  if (!fork_server_sockaddr(path, &addr))
+    return FALSE;
+  listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0) {
+    cmdarg_err("Can't create the fork server socket: %s.", g_strerror(errno));
+    return FALSE;
+  }
+  ws_unlink(path);
+  /* Don't let other users connect, where the permissions are checked. */
+  old_umask = umask(0077);
+  if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    cmdarg_err("Can't listen on the fork server socket \"%s\": %s.", path,
+               g_strerror(errno));
+    umask(old_umask);
+    close(listen_fd);
+    return FALSE;
+  }
+  umask(old_umask);
+  if (listen(listen_fd, SOMAXCONN) < 0) {
+    cmdarg_err("Can't listen on the fork server socket \"%s\": %s.", path,
+               g_strerror(errno));
+    close(listen_fd);
+    return FALSE;
+  }
+
+  /* Don't leave the intermediate processes as zombies. */
+  signal(SIGCHLD, SIG_IGN);
+
+  for (;;) {
+    conn = accept(listen_fd, NULL, NULL);
+    if (conn < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      cmdarg_err("Can't accept fork server connections: %s.", g_strerror(errno));
+      close(listen_fd);
+      return FALSE;
+    }
+    if (!fork_server_peer_allowed(conn) ||
+        !fork_server_receive(conn, fds, &cwd, &req_argc, &req_argv)) {
+      close(conn);
+      continue;
+    }
+
+    /* Don't let the children write out anything we've buffered. */
+    fflush(NULL);
+    monitor = fork();
+    if (monitor == 0) {
+      close(listen_fd);
+      signal(SIGCHLD, SIG_DFL);
+      if (pipe(exit_pipe) < 0) {
+        exit_code = INIT_FAILED;
+        fork_server_write_full(conn, &exit_code, sizeof(exit_code));
+        _exit(0);
+      }
+      worker = fork();
+      if (worker == 0) {
+        close(conn);
+        close(exit_pipe[0]);
+        /* Keep it open until we exit, but not in programs we run. */
+        fcntl(exit_pipe[1], F_SETFD, FD_CLOEXEC);
+        for (i = 0; i < 3; i++) {
+          if (fds[i] != i) {
+            dup2(fds[i], i);
+            close(fds[i]);
+          }
+        }
+        if (chdir(cwd) < 0) {
+          cmdarg_err("Can't change to the directory \"%s\": %s.", cwd,
+                     g_strerror(errno));
+          _exit(INIT_FAILED);
+        }
+        g_free(cwd);
+        *argc = req_argc;
+        *argv = req_argv;
+        return TRUE;
+      }
+      for (i = 0; i < 3; i++)
+        close(fds[i]);
+      close(exit_pipe[1]);
+      if (worker < 0)
+        exit_code = INIT_FAILED;
+      else
+        exit_code = fork_server_wait(conn, worker, exit_pipe[0]);
+      fork_server_write_full(conn, &exit_code, sizeof(exit_code));
+      _exit(0);
+    }
+    if (monitor < 0)
+      cmdarg_err("Can't fork a fork server worker: %s.", g_strerror(errno));
+
+    for (i = 0; i < 3; i++)
+      close(fds[i]);
+    close(conn);
+    g_free(cwd);
+    g_strfreev(req_argv);
+  }
+}
+
+/*
+ * Pass a signal that would stop us on to the run, which stops in its own
+ * way and lets us return its exit status.
+ */
+static void
+fork_client_forward_signal(int sig)
+{
+  guint32 sig_num = (guint32)sig;
+  int     saved_errno = errno;
+
+  if (fork_client_conn >= 0 &&
+      write(fork_client_conn, &sig_num, sizeof(sig_num)) < 0) {
+    /* The run has already finished. */
+  }
+  errno = saved_errno;
+}
+
+/*
+ * Have the fork server listening on path do a run with our arguments,
+ * and return its exit status.
+ */
+static int
+run_fork_client(const char *path, int argc, char *argv[])
+{
+  struct sockaddr_un addr;
+  int                conn, i;
+  gchar             *cwd;
+  GByteArray        *request;
+  guint32            len, exit_code;
+  struct iovec       iov;
+  struct msghdr      msg;
+  struct cmsghdr    *cmsg;
+  union {
+    char             buf[CMSG_SPACE(3 * sizeof(int))];
+    struct cmsghdr   align;
+  } control;
+  int                fds[3] = { 0, 1, 2 };
+  ssize_t            nwritten;
+  struct sigaction   action;
+
+  if (!fork_server_sockaddr(path, &addr))
+    return INVALID_OPTION;
+  conn = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (conn < 0 || connect(conn, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    cmdarg_err("Can't connect to the fork server at \"%s\": %s.", path,
+               g_strerror(errno));
+    if (conn >= 0)
+      close(conn);
+    return INIT_FAILED;
+  }
+
+  request = g_byte_array_new();
+  cwd = g_get_current_dir();
+  g_byte_array_append(request, (const guint8 *)cwd, (guint)strlen(cwd) + 1);
+  g_free(cwd);
+  for (i = 0; i < argc; i++)
+    g_byte_array_append(request, (const guint8 *)argv[i], (guint)strlen(argv[i]) + 1);
+  len = request->len;
+
+  memset(&msg, 0, sizeof(msg));
+  memset(&control, 0, sizeof(control));
+  iov.iov_base = &len;
+  iov.iov_len = sizeof(len);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  do {
+    nwritten = sendmsg(conn, &msg, 0);
+  } while (nwritten < 0 && errno == EINTR);
+
+  if (nwritten != sizeof(len) ||
+      !fork_server_write_full(conn, request->data, request->len)) {
+    cmdarg_err("The fork server at \"%s\" didn't complete the run.", path);
+    g_byte_array_free(request, TRUE);
+    close(conn);
+    return INIT_FAILED;
+  }
+
+  /* From now on, Ctrl-C and the like stop the run rather than us. */
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = fork_client_forward_signal;
+  sigemptyset(&action.sa_mask);
+  fork_client_conn = conn;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  sigaction(SIGHUP, &action, NULL);
+
+  if (!fork_server_read_full(conn, &exit_code, sizeof(exit_code))) {
+    cmdarg_err("The fork server at \"%s\" didn't complete the run.", path);
+    exit_code = INIT_FAILED;
+  }
+  fork_client_conn = -1;
+  g_byte_array_free(request, TRUE);
+  close(conn);
+  return (int)exit_code;
+}
+#endif
+
+/*
+ * Process the options that have to be handled before libwireshark is
+ * initialized.
+ */
+static gboolean
+process_early_options(int argc, char *argv[], const char *optstring,
+                      const struct option *long_options, gchar **output_only,
+                      const gchar **elastic_mapping_filter)
+{
+  int opt;
+
+  while ((opt = getopt_long(argc, argv, optstring, long_options, NULL)) != -1) {
+    switch (opt) {
+    case 'C':        /* Configuration Profile */
+      if (profile_exists (optarg, FALSE)) {
+        set_profile_name (optarg);
+      } else {
+        cmdarg_err("Configuration Profile \"%s\" does not exist", optarg);
+        return FALSE;
+      }
+      break;
+    case 'P':        /* Print packet summary info even when writing to a file */
+      print_packet_info = TRUE;
+      print_summary = TRUE;
+      break;
+    case 'O':        /* Only output these protocols */
+      g_free(*output_only);
+      *output_only = g_strdup(optarg);
+      /* FALLTHROUGH */
+    case 'V':        /* Verbose */
+      print_details = TRUE;
+      print_packet_info = TRUE;
+      break;
+    case 'x':        /* Print packet data in hex (and ASCII) */
+      print_hex = TRUE;
+      /*  The user asked for hex output, so let's ensure they get it,
+       *  even if they're writing to a file.
+       */
+      print_packet_info = TRUE;
+      break;
+    case 'X':
+      ex_opt_add(optarg);
+      break;
+    case LONGOPT_ELASTIC_MAPPING_FILTER:
+      *elastic_mapping_filter = optarg;
+      break;
+#ifndef _WIN32
+    case LONGOPT_FORK_SERVER:
+      fork_server_path = optarg;
+      break;
+#endif
+    default:
+      break;
+    }
+  }
+  return TRUE;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -706,6 +1295,14 @@ main(int argc, char *argv[])
     {"color", no_argument, NULL, LONGOPT_COLOR},
     {"no-duplicate-keys", no_argument, NULL, LONGOPT_NO_DUPLICATE_KEYS},
     {"elastic-mapping-filter", required_argument, NULL, LONGOPT_ELASTIC_MAPPING_FILTER},
+    {"prune-dissection", no_argument, NULL, LONGOPT_PRUNE_DISSECTION},
+    {"save-seek-index", no_argument, NULL, LONGOPT_SAVE_SEEK_INDEX},
+    {"save-time-index", no_argument, NULL, LONGOPT_SAVE_TIME_INDEX},
+    {"parallel-workers", required_argument, NULL, LONGOPT_PARALLEL_WORKERS},
+    {"pipeline", no_argument, NULL, LONGOPT_PIPELINE},
+    {"fork-server", required_argument, NULL, LONGOPT_FORK_SERVER},
+    {"filter-server", no_argument, NULL, LONGOPT_FILTER_SERVER},
+    {"zero-copy", no_argument, NULL, LONGOPT_ZERO_COPY},
     {0, 0, 0, 0 }
   };
   gboolean             arg_error = FALSE;
@@ -777,6 +1374,15 @@ main(int argc, char *argv[])
 
   cmdarg_err_init(failure_warning_message, failure_message_cont);
 
+#ifndef _WIN32
+  /*
+   * "tshark --fork-client <socket> [options]" has a fork server do the
+   * run, so there's nothing to initialize here.
+   */
+  if (argc >= 3 && strcmp(argv[1], "--fork-client") == 0)
+    return run_fork_client(argv[2], argc - 2, argv + 2);
+#endif
+
 #ifdef _WIN32
   create_app_running_mutex();
 #endif /* _WIN32 */
@@ -836,44 +1442,10 @@ main(int argc, char *argv[])
    */
   opterr = 0;
 
-  while ((opt = getopt_long(argc, argv, optstring, long_options, NULL)) != -1) {
-    switch (opt) {
-    case 'C':        /* Configuration Profile */
-      if (profile_exists (optarg, FALSE)) {
-        set_profile_name (optarg);
-      } else {
-        cmdarg_err("Configuration Profile \"%s\" does not exist", optarg);
-        exit_status = INVALID_OPTION;
-        goto clean_exit;
-      }
-      break;
-    case 'P':        /* Print packet summary info even when writing to a file */
-      print_packet_info = TRUE;
-      print_summary = TRUE;
-      break;
-    case 'O':        /* Only output these protocols */
-      output_only = g_strdup(optarg);
-      /* FALLTHROUGH */
-    case 'V':        /* Verbose */
-      print_details = TRUE;
-      print_packet_info = TRUE;
-      break;
-    case 'x':        /* Print packet data in hex (and ASCII) */
-      print_hex = TRUE;
-      /*  The user asked for hex output, so let's ensure they get it,
-       *  even if they're writing to a file.
-       */
-      print_packet_info = TRUE;
-      break;
-    case 'X':
-      ex_opt_add(optarg);
-      break;
-    case LONGOPT_ELASTIC_MAPPING_FILTER:
-      elastic_mapping_filter = optarg;
-      break;
-    default:
-      break;
-    }
+  if (!process_early_options(argc, argv, optstring, long_options,
+                             &output_only, &elastic_mapping_filter)) {
+    exit_status = INVALID_OPTION;
+    goto clean_exit;
   }
 
 /** Send All g_log messages to our own handler **/
@@ -947,6 +1519,46 @@ main(int argc, char *argv[])
   rtd_table_iterate_tables(register_rtd_tables, NULL);
   stat_tap_iterate_tables(register_simple_stat_tables, NULL);
 
+#ifndef _WIN32
+  if (fork_server_path != NULL) {
+    /*
+     * Everything from here on is done in a worker, with the arguments
+     * of its run, so the options that were processed before we
+     * initialized libwireshark have to be processed again.  Lua
+     * scripts have already been loaded, so the server's -X lua_script
+     * options are the ones that count.
+     */
+    if (!run_fork_server(fork_server_path, &argc, &argv)) {
+      exit_status = INIT_FAILED;
+      goto clean_exit;
+    }
+    fork_server_path = NULL;
+    print_packet_info = FALSE;
+    print_summary = FALSE;
+    print_details = FALSE;
+    print_hex = FALSE;
+    g_free(output_only);
+    output_only = NULL;
+    elastic_mapping_filter = NULL;
+#ifdef HAVE_OPTRESET
+    optreset = 1;
+    optind = 1;
+#else
+    optind = 0;
+#endif
+    if (!process_early_options(argc, argv, optstring, long_options,
+                               &output_only, &elastic_mapping_filter)) {
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+    if (fork_server_path != NULL) {
+      cmdarg_err("--fork-server can't be used in a run done by a fork server.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+  }
+#endif
+
   /* If invoked with the "-G" flag, we dump out information based on
      the argument to the "-G" flag; if no argument is specified,
      for backwards compatibility we dump out a glossary of display
@@ -1465,6 +2077,42 @@ main(int argc, char *argv[])
       no_duplicate_keys = TRUE;
       node_children_grouper = proto_node_group_children_by_json_key;
       break;
+    case LONGOPT_PRUNE_DISSECTION:
+      prune_dissection = TRUE;
+      break;
+    case LONGOPT_SAVE_SEEK_INDEX:
+      wtap_set_save_seek_index(TRUE);
+      break;
+    case LONGOPT_SAVE_TIME_INDEX:
+      wtap_set_save_time_index(TRUE);
+      break;
+    case LONGOPT_ZERO_COPY:
+      zero_copy = TRUE;
+      break;
+    case LONGOPT_PARALLEL_WORKERS:
+      parallel_workers = get_positive_int(optarg, "number of parallel workers");
+      break;
+    case LONGOPT_PIPELINE:
+      pipeline = TRUE;
+      break;
+    case LONGOPT_FORK_SERVER:
+#ifdef _WIN32
+      cmdarg_err("--fork-server isn't supported on Windows.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+#else
+      /* Handled before libwireshark was initialized. */
+      break;
+#endif
+    case LONGOPT_FILTER_SERVER:
+#ifdef _WIN32
+      cmdarg_err("--filter-server isn't supported on Windows.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+#else
+      filter_server = TRUE;
+      break;
+#endif
     default:
     case '?':        /* Bad flag - print usage message */
       switch(optopt) {
@@ -1622,6 +2270,77 @@ main(int argc, char *argv[])
     goto clean_exit;
   }
 
+#ifndef _WIN32
+  /* The frame numbers have to be those Wireshark has. */
+  if (filter_server) {
+    if (cf_name == NULL || strcmp(cf_name, "-") == 0) {
+      cmdarg_err("--filter-server requires a capture file (specify with -r).");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+    if (rfilter != NULL) {
+      cmdarg_err("--filter-server can't be used with a read filter.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+  }
+#endif
+
+  if (parallel_workers > 1) {
+#ifdef _WIN32
+    cmdarg_err("--parallel-workers isn't supported on Windows.");
+    exit_status = INVALID_OPTION;
+    goto clean_exit;
+#else
+    /*
+     * Each worker prints its packets independently of the others, so
+     * the output format can't carry state from one packet to the next,
+     * and the frame numbers only match those of a single process if
+     * every worker sees every packet, which rules out a read filter.
+     */
+    if (!perform_two_pass_analysis) {
+      cmdarg_err("--parallel-workers requires -2.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+    if (cf_name == NULL || strcmp(cf_name, "-") == 0) {
+      cmdarg_err("--parallel-workers requires a capture file (specify with -r).");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+    if (output_file_name != NULL || rfilter != NULL) {
+      cmdarg_err("--parallel-workers can't be used with -w or -R.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+    if (!((output_action == WRITE_TEXT && print_format == PR_FMT_TEXT) ||
+          output_action == WRITE_XML || output_action == WRITE_FIELDS ||
+          output_action == WRITE_EK)) {
+      cmdarg_err("--parallel-workers supports only the text, pdml, psml, fields and ek output formats.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+#endif
+  }
+
+  if (pipeline) {
+    /*
+     * Stopping early, because of -c or a signal, means waiting for the
+     * reader thread to finish the read it's doing, which might never
+     * happen when reading from a pipe.
+     */
+    if (perform_two_pass_analysis) {
+      cmdarg_err("--pipeline can't be used with -2.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+    if (cf_name == NULL || strcmp(cf_name, "-") == 0) {
+      cmdarg_err("--pipeline requires a capture file (specify with -r).");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
+  }
+
 #ifdef HAVE_LIBPCAP
   if (caps_queries) {
     /* We're supposed to list the link-layer/timestamp types for an interface;
@@ -1938,6 +2657,8 @@ main(int argc, char *argv[])
   cfile.dfcode = dfcode;
 
   if (print_packet_info) {
+    packet_output = stdout;
+
     /* If we're printing as text or PostScript, we have
        to create a print stream. */
     if (output_action == WRITE_TEXT) {
@@ -2030,6 +2751,13 @@ main(int argc, char *argv[])
       goto clean_exit;
     }
 
+#ifndef _WIN32
+    if (filter_server) {
+      exit_status = run_filter_server(&cfile);
+      goto clean_exit;
+    }
+#endif
+
     /* Start statistics taps; we do so after successfully opening the
        capture file, so we know we have something to compute stats
        on, and after registering all dissectors, so that MATE will
@@ -2042,6 +2770,14 @@ main(int argc, char *argv[])
        other things, what taps are listening, so determine that after
        starting the statistics taps. */
     do_dissection = must_do_dissection(rfcode, dfcode, pdu_export_arg);
+    setup_dissection_pruning(dfcode, pdu_export_arg);
+
+    /* The workers can't combine their statistics or exported PDUs. */
+    if (parallel_workers > 1 && tap_listeners_require_dissection()) {
+      cmdarg_err("--parallel-workers can't be used with statistics or other taps.");
+      exit_status = INVALID_OPTION;
+      goto clean_exit;
+    }
 
     /* Process the packets in the file */
     tshark_debug("tshark: invoking process_cap_file() to process the packets");
@@ -2224,6 +2960,7 @@ main(int argc, char *argv[])
        other things, what taps are listening, so determine that after
        starting the statistics taps. */
     do_dissection = must_do_dissection(rfcode, dfcode, pdu_export_arg);
+    setup_dissection_pruning(dfcode, pdu_export_arg);
 
     /*
      * XXX - this returns FALSE if an error occurred, but it also
@@ -2288,6 +3025,8 @@ clean_exit:
   free_progdirs();
   cf_close(&cfile);
   dfilter_free(dfcode);
+  if (dissect_protocols)
+    g_hash_table_destroy(dissect_protocols);
   return exit_status;
 }
 
@@ -2385,39 +3124,524 @@ pipe_input_set_handler(gint source, gpointer user_data, ws_process_id *child_pro
   pipe_input.user_data      = user_data;
   pipe_input.input_cb       = input_cb;
 
-#ifdef _WIN32
-  pipe_input.callback_running = g_malloc(sizeof(GMutex));
-  g_mutex_init(pipe_input.callback_running);
-  /* Tricky to use pipes in win9x, as no concept of wait.  NT can
-     do this but that doesn't cover all win32 platforms.  GTK can do
-     this but doesn't seem to work over processes.  Attempt to do
-     something similar here, start a timer and check for data on every
-     timeout. */
-  /*g_log(NULL, G_LOG_LEVEL_DEBUG, "pipe_input_set_handler: new");*/
-  pipe_input.pipe_input_id = g_timeout_add(200, pipe_timer_cb, &pipe_input);
-#endif
+#ifdef _WIN32
+  pipe_input.callback_running = g_malloc(sizeof(GMutex));
+  g_mutex_init(pipe_input.callback_running);
+  /* Tricky to use pipes in win9x, as no concept of wait.  NT can
+     do this but that doesn't cover all win32 platforms.  GTK can do
+     this but doesn't seem to work over processes.  Attempt to do
+     something similar here, start a timer and check for data on every
+     timeout. */
+  /*g_log(NULL, G_LOG_LEVEL_DEBUG, "pipe_input_set_handler: new");*/
+  pipe_input.pipe_input_id = g_timeout_add(200, pipe_timer_cb, &pipe_input);
+#endif
+}
+
+static const nstime_t *
+tshark_get_frame_ts(struct packet_provider_data *prov, guint32 frame_num)
+{
+  if (prov->ref && prov->ref->num == frame_num)
+    return &prov->ref->abs_ts;
+
+  if (prov->prev_dis && prov->prev_dis->num == frame_num)
+    return &prov->prev_dis->abs_ts;
+
+  if (prov->prev_cap && prov->prev_cap->num == frame_num)
+    return &prov->prev_cap->abs_ts;
+
+  if (prov->frames) {
+     frame_data *fd = frame_data_sequence_find(prov->frames, frame_num);
+
+     return (fd) ? &fd->abs_ts : NULL;
+  }
+
+  return NULL;
+}
+
+/*
+ * With --pipeline, a ring of records read ahead by the reader thread.
+ *
+ * The reader fills the slot after the last full one and the main thread
+ * takes the one at the head, swapping its own record and buffer into the
+ * slot for the reader to reuse.  Host names and secrets that wtap_read()
+ * reports go into the slot of the record they were read with, so that
+ * they're added on the main thread before that record is dissected, and
+ * the interface descriptions are published under idb_lock, since the
+ * wtap's own list of them may be reallocated while we're dissecting.
+ */
+#define PIPELINE_SLOTS 64
+
+typedef enum {
+  PIPELINE_EVENT_IPV4_NAME,
+  PIPELINE_EVENT_IPV6_NAME,
+  PIPELINE_EVENT_SECRETS
+} pipeline_event_type_e;
+
+typedef struct {
+  pipeline_event_type_e type;
+  guint32       ipv4_addr;
+  ws_in6_addr   ipv6_addr;
+  gchar        *name;
+  guint32       secrets_type;
+  void         *secrets;
+  guint         secrets_size;
+} pipeline_event_t;
+
+typedef struct {
+  wtap_rec      rec;
+  Buffer        buf;
+  gint64        data_offset;
+  gboolean      ok;             /* FALSE at EOF or on an error */
+  int           err;
+  gchar        *err_info;
+  GArray       *events;         /* pipeline_event_t, read with this record */
+} pipeline_slot_t;
+
+typedef struct {
+  wtap         *wth;
+  GThread      *thread;
+  GMutex        lock;
+  GCond         not_empty;
+  GCond         not_full;
+  pipeline_slot_t slots[PIPELINE_SLOTS];
+  guint         head;           /* next slot for the main thread to take */
+  guint         count;          /* number of full slots */
+  gboolean      stop;           /* set to make the reader thread exit */
+  GArray       *events;         /* events for the record being read; reader thread only */
+  GMutex        idb_lock;
+  GPtrArray    *idbs;           /* wtap_block_t interface descriptions read so far */
+} pipeline_reader_t;
+
+static pipeline_reader_t *pipeline_reader = NULL;
+
+static void
+pipeline_add_event(const pipeline_event_t *event)
+{
+  g_array_append_val(pipeline_reader->events, *event);
+}
+
+static void
+pipeline_new_ipv4(const guint addr, const gchar *name)
+{
+  pipeline_event_t event = { PIPELINE_EVENT_IPV4_NAME };
+
+  event.ipv4_addr = addr;
+  event.name = g_strdup(name);
+  pipeline_add_event(&event);
+}
+
+static void
+pipeline_new_ipv6(const void *addrp, const gchar *name)
+{
+  pipeline_event_t event = { PIPELINE_EVENT_IPV6_NAME };
+
+  memcpy(&event.ipv6_addr, addrp, sizeof event.ipv6_addr);
+  event.name = g_strdup(name);
+  pipeline_add_event(&event);
+}
+
+static void
+pipeline_new_secrets(guint32 secrets_type, const void *secrets, guint size)
+{
+  pipeline_event_t event = { PIPELINE_EVENT_SECRETS };
+
+  event.secrets_type = secrets_type;
+  event.secrets = g_memdup(secrets, size);
+  event.secrets_size = size;
+  pipeline_add_event(&event);
+}
+
+static void
+pipeline_free_events(GArray *events, gboolean apply)
+{
+  guint i;
+
+  for (i = 0; i < events->len; i++) {
+    pipeline_event_t *event = &g_array_index(events, pipeline_event_t, i);
+
+    if (apply) {
+      switch (event->type) {
+
+      case PIPELINE_EVENT_IPV4_NAME:
+        add_ipv4_name(event->ipv4_addr, event->name);
+        break;
+
+      case PIPELINE_EVENT_IPV6_NAME:
+        add_ipv6_name(&event->ipv6_addr, event->name);
+        break;
+
+      case PIPELINE_EVENT_SECRETS:
+        secrets_wtap_callback(event->secrets_type, event->secrets, event->secrets_size);
+        break;
+      }
+    }
+    g_free(event->name);
+    g_free(event->secrets);
+  }
+  g_array_set_size(events, 0);
+}
+
+static void
+pipeline_publish_idbs(pipeline_reader_t *pr)
+{
+  wtapng_iface_descriptions_t *idb_info;
+  guint i;
+
+  idb_info = wtap_file_get_idb_info(pr->wth);
+  if (idb_info->interface_data->len > pr->idbs->len) {
+    g_mutex_lock(&pr->idb_lock);
+    for (i = pr->idbs->len; i < idb_info->interface_data->len; i++)
+      g_ptr_array_add(pr->idbs, g_array_index(idb_info->interface_data, wtap_block_t, i));
+    g_mutex_unlock(&pr->idb_lock);
+  }
+  g_free(idb_info);
+}
+
+static gpointer
+pipeline_read_records(gpointer data)
+{
+  pipeline_reader_t *pr = (pipeline_reader_t *)data;
+  pipeline_slot_t *slot;
+  GArray *events;
+
+  for (;;) {
+    g_mutex_lock(&pr->lock);
+    while (pr->count == PIPELINE_SLOTS && !pr->stop)
+      g_cond_wait(&pr->not_full, &pr->lock);
+    if (pr->stop) {
+      g_mutex_unlock(&pr->lock);
+      break;
+    }
+    slot = &pr->slots[(pr->head + pr->count) % PIPELINE_SLOTS];
+    g_mutex_unlock(&pr->lock);
+
+    slot->err = 0;
+    slot->err_info = NULL;
+    slot->ok = wtap_read(pr->wth, &slot->rec, &slot->buf, &slot->err,
+                         &slot->err_info, &slot->data_offset);
+
+    pipeline_publish_idbs(pr);
+    events = slot->events;
+    slot->events = pr->events;
+    pr->events = events;
+
+    g_mutex_lock(&pr->lock);
+    pr->count++;
+    g_cond_signal(&pr->not_empty);
+    g_mutex_unlock(&pr->lock);
+
+    if (!slot->ok)
+      break;
+  }
+
+  return NULL;
+}
+
+static void
+pipeline_reader_start(wtap *wth)
+{
+  pipeline_reader_t *pr;
+  guint i;
+
+  pr = g_new0(pipeline_reader_t, 1);
+  pr->wth = wth;
+  g_mutex_init(&pr->lock);
+  g_cond_init(&pr->not_empty);
+  g_cond_init(&pr->not_full);
+  for (i = 0; i < PIPELINE_SLOTS; i++) {
+    wtap_rec_init(&pr->slots[i].rec);
+    ws_buffer_init(&pr->slots[i].buf, 1514);
+    pr->slots[i].events = g_array_new(FALSE, FALSE, sizeof(pipeline_event_t));
+  }
+  pr->events = g_array_new(FALSE, FALSE, sizeof(pipeline_event_t));
+  g_mutex_init(&pr->idb_lock);
+  pr->idbs = g_ptr_array_new();
+  pipeline_publish_idbs(pr);
+
+  wtap_set_cb_new_ipv4(wth, pipeline_new_ipv4);
+  wtap_set_cb_new_ipv6(wth, pipeline_new_ipv6);
+  wtap_set_cb_new_secrets(wth, pipeline_new_secrets);
+
+  pipeline_reader = pr;
+  pr->thread = g_thread_new("tshark_reader", pipeline_read_records, pr);
+}
+
+/*
+ * Take the next record from the reader thread, waiting for it if
+ * necessary.  Returns FALSE at EOF or on an error, as wtap_read() does.
+ */
+static gboolean
+pipeline_reader_take(pipeline_reader_t *pr, wtap_rec *rec, Buffer *buf,
+                     int *err, gchar **err_info, gint64 *data_offset)
+{
+  pipeline_slot_t *slot;
+  wtap_rec tmp_rec;
+  Buffer tmp_buf;
+
+  g_mutex_lock(&pr->lock);
+  while (pr->count == 0)
+    g_cond_wait(&pr->not_empty, &pr->lock);
+  slot = &pr->slots[pr->head];
+  g_mutex_unlock(&pr->lock);
+
+  pipeline_free_events(slot->events, TRUE);
+
+  if (!slot->ok) {
+    /* The reader thread has exited; leave the slot where it is. */
+    *err = slot->err;
+    *err_info = slot->err_info;
+    slot->err_info = NULL;
+    return FALSE;
+  }
+
+  tmp_rec = *rec;
+  *rec = slot->rec;
+  slot->rec = tmp_rec;
+  tmp_buf = *buf;
+  *buf = slot->buf;
+  slot->buf = tmp_buf;
+  *data_offset = slot->data_offset;
+
+  g_mutex_lock(&pr->lock);
+  pr->head = (pr->head + 1) % PIPELINE_SLOTS;
+  pr->count--;
+  g_cond_signal(&pr->not_full);
+  g_mutex_unlock(&pr->lock);
+
+  return TRUE;
+}
+
+static void
+pipeline_reader_stop(void)
+{
+  pipeline_reader_t *pr = pipeline_reader;
+  guint i;
+
+  g_mutex_lock(&pr->lock);
+  pr->stop = TRUE;
+  g_cond_signal(&pr->not_full);
+  g_mutex_unlock(&pr->lock);
+  g_thread_join(pr->thread);
+
+  wtap_set_cb_new_ipv4(pr->wth, add_ipv4_name);
+  wtap_set_cb_new_ipv6(pr->wth, (wtap_new_ipv6_callback_t) add_ipv6_name);
+  wtap_set_cb_new_secrets(pr->wth, secrets_wtap_callback);
+  pipeline_reader = NULL;
+
+  for (i = 0; i < PIPELINE_SLOTS; i++) {
+    wtap_rec_cleanup(&pr->slots[i].rec);
+    ws_buffer_free(&pr->slots[i].buf);
+    pipeline_free_events(pr->slots[i].events, FALSE);
+    g_array_free(pr->slots[i].events, TRUE);
+    g_free(pr->slots[i].err_info);
+  }
+  pipeline_free_events(pr->events, FALSE);
+  g_array_free(pr->events, TRUE);
+  g_ptr_array_free(pr->idbs, TRUE);
+  g_mutex_clear(&pr->idb_lock);
+  g_cond_clear(&pr->not_full);
+  g_cond_clear(&pr->not_empty);
+  g_mutex_clear(&pr->lock);
+  g_free(pr);
+}
+
+static wtap_block_t
+pipeline_get_idb(guint32 interface_id)
+{
+  wtap_block_t idb = NULL;
+
+  g_mutex_lock(&pipeline_reader->idb_lock);
+  if (interface_id < pipeline_reader->idbs->len)
+    idb = (wtap_block_t)g_ptr_array_index(pipeline_reader->idbs, interface_id);
+  g_mutex_unlock(&pipeline_reader->idb_lock);
+  return idb;
+}
+
+static const char *
+pipeline_get_interface_name(struct packet_provider_data *prov, guint32 interface_id)
+{
+  wtap_block_t idb;
+  char *interface_name;
+
+  if (pipeline_reader == NULL)
+    return cap_file_provider_get_interface_name(prov, interface_id);
+
+  idb = pipeline_get_idb(interface_id);
+  if (idb) {
+    if (wtap_block_get_string_option_value(idb, OPT_IDB_NAME, &interface_name) == WTAP_OPTTYPE_SUCCESS)
+      return interface_name;
+    if (wtap_block_get_string_option_value(idb, OPT_IDB_DESCR, &interface_name) == WTAP_OPTTYPE_SUCCESS)
+      return interface_name;
+    if (wtap_block_get_string_option_value(idb, OPT_IDB_HARDWARE, &interface_name) == WTAP_OPTTYPE_SUCCESS)
+      return interface_name;
+  }
+  return "unknown";
+}
+
+static const char *
+pipeline_get_interface_description(struct packet_provider_data *prov, guint32 interface_id)
+{
+  wtap_block_t idb;
+  char *interface_name;
+
+  if (pipeline_reader == NULL)
+    return cap_file_provider_get_interface_description(prov, interface_id);
+
+  idb = pipeline_get_idb(interface_id);
+  if (idb) {
+    if (wtap_block_get_string_option_value(idb, OPT_IDB_DESCR, &interface_name) == WTAP_OPTTYPE_SUCCESS)
+      return interface_name;
+  }
+  return NULL;
+}
+
+#ifdef HAVE_OPEN_MEMSTREAM
+/*
+ * With --pipeline, the packet output is written to memory in chunks of
+ * about PIPELINE_CHUNK_SIZE bytes, which are written to the standard
+ * output by the writer thread.  At most PIPELINE_CHUNKS chunks can be
+ * waiting for it; pipeline_chunk_credits holds one entry for each chunk
+ * that can still be queued.
+ */
+#define PIPELINE_CHUNK_SIZE (64 * 1024)
+#define PIPELINE_CHUNKS     16
+
+typedef struct {
+  char   *data;         /* NULL marks the end of the output */
+  size_t  len;
+} pipeline_chunk_t;
+
+static GThread *pipeline_writer = NULL;
+static GAsyncQueue *pipeline_chunks;
+static GAsyncQueue *pipeline_chunk_credits;
+static gint pipeline_write_errno;
+static char *pipeline_chunk_data;
+static size_t pipeline_chunk_len;
+static print_stream_t *pipeline_saved_print_stream;
+static FILE *pipeline_saved_json_output;
+
+static gpointer
+pipeline_write_chunks(gpointer data _U_)
+{
+  pipeline_chunk_t *chunk;
+
+  for (;;) {
+    chunk = (pipeline_chunk_t *)g_async_queue_pop(pipeline_chunks);
+    if (chunk->data == NULL) {
+      g_free(chunk);
+      break;
+    }
+    /* After an error, keep taking chunks so the main thread doesn't block. */
+    if (g_atomic_int_get(&pipeline_write_errno) == 0) {
+      if (fwrite(chunk->data, 1, chunk->len, stdout) != chunk->len ||
+          (line_buffered && fflush(stdout) != 0))
+        g_atomic_int_set(&pipeline_write_errno, errno != 0 ? errno : EIO);
+    }
+    free(chunk->data);
+    g_free(chunk);
+    g_async_queue_push(pipeline_chunk_credits, GINT_TO_POINTER(1));
+  }
+
+  return NULL;
+}
+
+static gboolean
+pipeline_open_chunk(void)
+{
+  packet_output = open_memstream(&pipeline_chunk_data, &pipeline_chunk_len);
+  if (packet_output == NULL)
+    return FALSE;
+  if (pipeline_saved_print_stream != NULL)
+    print_stream = print_stream_text_stdio_new(packet_output);
+  jdumper.output_file = packet_output;
+  return TRUE;
+}
+
+static void
+pipeline_queue_chunk(void)
+{
+  pipeline_chunk_t *chunk;
+
+  /* Destroying the text print stream closes its file, too. */
+  if (pipeline_saved_print_stream != NULL)
+    destroy_print_stream(print_stream);
+  else
+    fclose(packet_output);
+
+  chunk = g_new(pipeline_chunk_t, 1);
+  chunk->data = pipeline_chunk_data;
+  chunk->len = pipeline_chunk_len;
+  g_async_queue_pop(pipeline_chunk_credits);
+  g_async_queue_push(pipeline_chunks, chunk);
 }
 
-static const nstime_t *
-tshark_get_frame_ts(struct packet_provider_data *prov, guint32 frame_num)
+static void
+pipeline_writer_start(void)
 {
-  if (prov->ref && prov->ref->num == frame_num)
-    return &prov->ref->abs_ts;
+  int i;
 
-  if (prov->prev_dis && prov->prev_dis->num == frame_num)
-    return &prov->prev_dis->abs_ts;
+  /*
+   * PostScript output, and colored text output to a terminal, depend on
+   * the print stream they're written with; leave them to the main thread.
+   */
+  if (output_action == WRITE_TEXT && (print_format != PR_FMT_TEXT || dissect_color))
+    return;
 
-  if (prov->prev_cap && prov->prev_cap->num == frame_num)
-    return &prov->prev_cap->abs_ts;
+  pipeline_saved_print_stream = print_stream;
+  pipeline_saved_json_output = jdumper.output_file;
+  if (!pipeline_open_chunk()) {
+    packet_output = stdout;
+    return;
+  }
 
-  if (prov->frames) {
-     frame_data *fd = frame_data_sequence_find(prov->frames, frame_num);
+  pipeline_chunks = g_async_queue_new();
+  pipeline_chunk_credits = g_async_queue_new();
+  for (i = 0; i < PIPELINE_CHUNKS; i++)
+    g_async_queue_push(pipeline_chunk_credits, GINT_TO_POINTER(1));
+  pipeline_writer = g_thread_new("tshark_writer", pipeline_write_chunks, NULL);
+}
 
-     return (fd) ? &fd->abs_ts : NULL;
+static void
+pipeline_check_write_error(void)
+{
+  int err = g_atomic_int_get(&pipeline_write_errno);
+
+  if (err != 0) {
+    show_print_file_io_error(err);
+    exit(2);
   }
+}
 
-  return NULL;
+/* Called after each packet is printed. */
+static void
+pipeline_packet_printed(void)
+{
+  pipeline_check_write_error();
+  if (line_buffered || ftell(packet_output) >= PIPELINE_CHUNK_SIZE) {
+    pipeline_queue_chunk();
+    if (!pipeline_open_chunk()) {
+      show_print_file_io_error(errno);
+      exit(2);
+    }
+  }
+}
+
+static void
+pipeline_writer_stop(void)
+{
+  pipeline_queue_chunk();
+  g_async_queue_push(pipeline_chunks, g_new0(pipeline_chunk_t, 1));
+  g_thread_join(pipeline_writer);
+  pipeline_writer = NULL;
+  g_async_queue_unref(pipeline_chunks);
+  g_async_queue_unref(pipeline_chunk_credits);
+
+  packet_output = stdout;
+  print_stream = pipeline_saved_print_stream;
+  jdumper.output_file = pipeline_saved_json_output;
+  pipeline_check_write_error();
 }
+#endif /* HAVE_OPEN_MEMSTREAM */
 
 static epan_t *
 tshark_epan_new(capture_file *cf)
@@ -2428,8 +3652,14 @@ tshark_epan_new(capture_file *cf)
     cap_file_provider_get_interface_description,
     NULL,
   };
+  static const struct packet_provider_funcs pipeline_funcs = {
+    tshark_get_frame_ts,
+    pipeline_get_interface_name,
+    pipeline_get_interface_description,
+    NULL,
+  };
 
-  return epan_new(&cf->provider, &funcs);
+  return epan_new(&cf->provider, pipeline ? &pipeline_funcs : &funcs);
 }
 
 #ifdef HAVE_LIBPCAP
@@ -2982,7 +4212,7 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
     }
 
     epan_dissect_run(edt, cf->cd_t, rec,
-                     frame_tvbuff_new_buffer(&cf->provider, &fdlocal, buf),
+                     frame_tvbuff_new(&cf->provider, &fdlocal, wtap_rec_data(rec, buf)),
                      &fdlocal, NULL);
 
     /* Run the read filter if we have one. */
@@ -3019,6 +4249,129 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
   return passed;
 }
 
+#ifndef _WIN32
+/*
+ * Pick the parallel worker for a record from a light parse of its
+ * link-layer and IP headers.  The hash is of the unordered pair of IP
+ * addresses, so both directions of a conversation, and all the fragments
+ * of a datagram, go to the same worker; ports aren't used, as fragments
+ * after the first don't have them, and related flows such as FTP data
+ * connections don't share them.  Anything that isn't IP goes to the
+ * first worker.
+ */
+static guint
+packet_parallel_worker(const wtap_rec *rec, const guint8 *pd)
+{
+  guint32       len, off;
+  guint16       type = 0;
+  const guint8 *a, *b, *t;
+  size_t        addr_len, i;
+  guint32       hash;
+
+  if (rec->rec_type != REC_TYPE_PACKET)
+    return 0;
+  len = rec->rec_header.packet_header.caplen;
+
+  switch (rec->rec_header.packet_header.pkt_encap) {
+
+  case WTAP_ENCAP_ETHERNET:
+    if (len < 14)
+      return 0;
+    type = pntoh16(pd + 12);
+    off = 14;
+    while ((type == 0x8100 || type == 0x88a8) && len >= off + 4) {
+      type = pntoh16(pd + off + 2);
+      off += 4;
+    }
+    break;
+
+  case WTAP_ENCAP_SLL:
+    if (len < 16)
+      return 0;
+    type = pntoh16(pd + 14);
+    off = 16;
+    break;
+
+  case WTAP_ENCAP_NULL:
+  case WTAP_ENCAP_LOOP:
+    /* The address family is in a byte order we'd have to guess at;
+       go by the IP version instead. */
+    off = 4;
+    break;
+
+  case WTAP_ENCAP_RAW_IP:
+  case WTAP_ENCAP_RAW_IP4:
+  case WTAP_ENCAP_RAW_IP6:
+    off = 0;
+    break;
+
+  default:
+    return 0;
+  }
+
+  if (type == 0 && len > off) {
+    switch (pd[off] >> 4) {
+
+    case 4:
+      type = 0x0800;
+      break;
+
+    case 6:
+      type = 0x86dd;
+      break;
+    }
+  }
+  if (type == 0x0800 && len >= off + 20) {
+    a = pd + off + 12;
+    b = pd + off + 16;
+    addr_len = 4;
+  } else if (type == 0x86dd && len >= off + 40) {
+    a = pd + off + 8;
+    b = pd + off + 24;
+    addr_len = 16;
+  } else
+    return 0;
+
+  if (memcmp(a, b, addr_len) > 0) {
+    t = a;
+    a = b;
+    b = t;
+  }
+  /* FNV-1a */
+  hash = 2166136261U;
+  for (i = 0; i < addr_len; i++)
+    hash = (hash ^ a[i]) * 16777619U;
+  for (i = 0; i < addr_len; i++)
+    hash = (hash ^ b[i]) * 16777619U;
+  return hash % parallel_workers;
+}
+
+/*
+ * Add a frame that another parallel worker is responsible for, without
+ * dissecting it, so that frame numbers and times relative to the
+ * reference and previous frames come out as they would in one process.
+ */
+static void
+process_packet_first_pass_foreign(capture_file *cf, gint64 offset,
+                                  wtap_rec *rec)
+{
+  frame_data     fdlocal;
+
+  frame_data_init(&fdlocal, cf->count + 1, rec, offset, cum_bytes);
+
+  frame_data_set_before_dissect(&fdlocal, &cf->elapsed_time,
+                                &cf->provider.ref, cf->provider.prev_dis);
+  if (cf->provider.ref == &fdlocal) {
+    ref_frame = fdlocal;
+    cf->provider.ref = &ref_frame;
+  }
+
+  frame_data_set_after_dissect(&fdlocal, &cum_bytes);
+  cf->provider.prev_cap = cf->provider.prev_dis = frame_data_sequence_add(cf->provider.frames, &fdlocal);
+  cf->count++;
+}
+#endif
+
 /*
  * Set if reading a file was interrupted by a CTRL_ event on Windows or
  * a signal on UN*X.
@@ -3079,11 +4432,19 @@ process_cap_file_first_pass(capture_file *cf, int max_packet_count,
   Buffer          buf;
   epan_dissect_t *edt = NULL;
   gint64          data_offset;
+  gboolean        passed;
   pass_status_t   status = PASS_SUCCEEDED;
 
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
 
+  /* With --zero-copy, leave the packet data in the file, if it can be
+     mapped, rather than copying it; we only get at it with
+     wtap_rec_data(). */
+  if (zero_copy)
+    wtap_set_zero_copy(cf->provider.wth,
+                       WTAP_ZERO_COPY_SEQUENTIAL|WTAP_ZERO_COPY_RANDOM);
+
   /* Allocate a frame_data_sequence for all the frames. */
   cf->provider.frames = new_frame_data_sequence();
 
@@ -3118,7 +4479,21 @@ process_cap_file_first_pass(capture_file *cf, int max_packet_count,
       status = PASS_INTERRUPTED;
       break;
     }
-    if (process_packet_first_pass(cf, edt, data_offset, &rec, &buf)) {
+#ifndef _WIN32
+    if (parallel_worker >= 0) {
+      /* Every worker counts every frame, but only dissects its own. */
+      if (packet_parallel_worker(&rec, wtap_rec_data(&rec, &buf)) != (guint)parallel_worker) {
+        process_packet_first_pass_foreign(cf, data_offset, &rec);
+        passed = TRUE;
+      } else {
+        passed = process_packet_first_pass(cf, edt, data_offset, &rec, &buf);
+        if (passed)
+          g_array_append_val(parallel_worker_frames, cf->count);
+      }
+    } else
+#endif
+    passed = process_packet_first_pass(cf, edt, data_offset, &rec, &buf);
+    if (passed) {
       /* Stop reading if we have the maximum number of packets;
        * When the -c option has not been used, max_packet_count
        * starts at 0, which practically means, never stop reading.
@@ -3204,7 +4579,7 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
     }
 
     epan_dissect_run_with_taps(edt, cf->cd_t, rec,
-                               frame_tvbuff_new_buffer(&cf->provider, fdata, buf),
+                               frame_tvbuff_new(&cf->provider, fdata, wtap_rec_data(rec, buf)),
                                fdata, cinfo);
 
     /* Run the read/display filter if we have one. */
@@ -3241,6 +4616,218 @@ process_packet_second_pass(capture_file *cf, epan_dissect_t *edt,
   return passed || fdata->dependent_of_displayed;
 }
 
+#ifndef _WIN32
+/*
+ * In a parallel worker, note where the output for a packet ends, if it
+ * produced any, so that the parent can merge it in frame order.
+ */
+static void
+parallel_worker_note_output(guint32 framenum)
+{
+  static guint64    last_end = 0;
+  parallel_output_t entry;
+  gint64            end;
+
+  end = ws_ftell64(stdout);
+  if (end < 0 || (guint64)end == last_end)
+    return;
+  entry.end = (guint64)end;
+  entry.framenum = framenum;
+  if (fwrite(&entry, sizeof entry, 1, parallel_worker_index) != 1) {
+    show_print_file_io_error(errno);
+    _exit(2);
+  }
+  last_end = entry.end;
+}
+
+/*
+ * Leave a parallel worker once it's done both passes and reported any
+ * errors; the parent writes the finale, and reports the status we exit
+ * with.
+ */
+static void
+finish_parallel_worker(process_file_status_t status)
+{
+  if (fflush(stdout) != 0 || fflush(parallel_worker_index) != 0) {
+    show_print_file_io_error(errno);
+    _exit(2);
+  }
+  switch (status) {
+
+  case PROCESS_FILE_SUCCEEDED:
+    _exit(0);
+
+  case PROCESS_FILE_INTERRUPTED:
+    _exit(1);
+
+  default:
+    _exit(2);
+  }
+}
+
+/*
+ * Copy each worker's output for its packets to the standard output,
+ * in frame order.
+ */
+static gboolean
+merge_parallel_output(FILE **out, FILE **idx)
+{
+  parallel_output_t *next;
+  gboolean          *have;
+  guint64           *pos;
+  guint              w, min;
+  char               copybuf[65536];
+  size_t             want, got;
+  gboolean           ok = TRUE;
+
+  next = g_new(parallel_output_t, parallel_workers);
+  have = g_new(gboolean, parallel_workers);
+  pos = g_new0(guint64, parallel_workers);
+  for (w = 0; w < parallel_workers; w++) {
+    rewind(out[w]);
+    rewind(idx[w]);
+    have[w] = fread(&next[w], sizeof next[w], 1, idx[w]) == 1;
+  }
+
+  for (;;) {
+    /* There are few enough workers that a linear scan will do. */
+    min = parallel_workers;
+    for (w = 0; w < parallel_workers; w++) {
+      if (have[w] && (min == parallel_workers || next[w].framenum < next[min].framenum))
+        min = w;
+    }
+    if (min == parallel_workers)
+      break;
+
+    while (pos[min] < next[min].end) {
+      want = (size_t)MIN(next[min].end - pos[min], sizeof copybuf);
+      got = fread(copybuf, 1, want, out[min]);
+      if (got == 0 || fwrite(copybuf, 1, got, stdout) != got) {
+        ok = FALSE;
+        goto done;
+      }
+      pos[min] += got;
+    }
+    have[min] = fread(&next[min], sizeof next[min], 1, idx[min]) == 1;
+  }
+
+done:
+  g_free(pos);
+  g_free(have);
+  g_free(next);
+  return ok;
+}
+
+/*
+ * Run both passes over the file in parallel_workers worker processes.
+ * Dissection state - conversations, reassembly, the file's wmem scope -
+ * is global to a process, so each worker is a process with its own copy
+ * of it, handling the conversations that packet_parallel_worker() gives
+ * it, and reading the file through its own wtap.
+ *
+ * Returns FALSE in the workers, which go on to do the passes, and TRUE
+ * in the parent once the workers have finished and their output has been
+ * merged, with *status set from the workers' exit statuses; they report
+ * their own errors.
+ */
+static gboolean
+run_parallel_workers(capture_file *cf, process_file_status_t *status)
+{
+  FILE   **out, **idx;
+  pid_t   *pids;
+  guint    w, started;
+  int      err, wstatus;
+  gchar   *fname;
+
+  out = g_new0(FILE *, parallel_workers);
+  idx = g_new0(FILE *, parallel_workers);
+  pids = g_new0(pid_t, parallel_workers);
+
+  /* Don't have the workers write whatever we've buffered, too. */
+  fflush(stdout);
+
+  *status = PROCESS_FILE_SUCCEEDED;
+  for (started = 0; started < parallel_workers; started++) {
+    w = started;
+    out[w] = tmpfile();
+    idx[w] = tmpfile();
+    if (out[w] == NULL || idx[w] == NULL) {
+      cmdarg_err("Can't create a temporary file for a parallel worker: %s.",
+                 g_strerror(errno));
+      break;
+    }
+    pids[w] = fork();
+    if (pids[w] == -1) {
+      cmdarg_err("Can't start a parallel worker: %s.", g_strerror(errno));
+      break;
+    }
+    if (pids[w] == 0) {
+      /* We're worker w; write to our own output file, and read the
+         capture file through our own wtap, as the parent's shares its
+         file offset with us. */
+      parallel_worker = w;
+      if (dup2(fileno(out[w]), 1) == -1) {
+        cmdarg_err("Can't redirect a parallel worker's output: %s.",
+                   g_strerror(errno));
+        _exit(2);
+      }
+      parallel_worker_index = idx[w];
+      parallel_worker_frames = g_array_new(FALSE, FALSE, sizeof(guint32));
+      /* Only one of us should write a seek or time index. */
+      if (w != 0) {
+        wtap_set_save_seek_index(FALSE);
+        wtap_set_save_time_index(FALSE);
+      }
+      fname = cf->filename;
+      wtap_close(cf->provider.wth);
+      if (cf_open(cf, fname, cf->open_type, cf->is_tempfile, &err) != CF_OK)
+        _exit(2);
+      g_free(fname);
+      g_free(out);
+      g_free(idx);
+      g_free(pids);
+      return FALSE;
+    }
+  }
+
+  if (started < parallel_workers) {
+    /* Stop the workers we did start. */
+    for (w = 0; w < started; w++)
+      kill(pids[w], SIGTERM);
+    *status = PROCESS_FILE_ERROR;
+  }
+  for (w = 0; w < started; w++) {
+    while (waitpid(pids[w], &wstatus, 0) == -1) {
+      if (errno != EINTR) {
+        wstatus = -1;
+        break;
+      }
+    }
+    if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) > 1)
+      *status = PROCESS_FILE_ERROR;
+    else if (WEXITSTATUS(wstatus) == 1 && *status == PROCESS_FILE_SUCCEEDED)
+      *status = PROCESS_FILE_INTERRUPTED;
+  }
+
+  /* Whatever the workers managed to print is worth having. */
+  if (started == parallel_workers && !merge_parallel_output(out, idx)) {
+    show_print_file_io_error(errno);
+    *status = PROCESS_FILE_ERROR;
+  }
+
+  for (w = 0; w < parallel_workers; w++) {
+    if (out[w] != NULL)
+      fclose(out[w]);
+    if (idx[w] != NULL)
+      fclose(idx[w]);
+  }
+  g_free(out);
+  g_free(idx);
+  g_free(pids);
+  return TRUE;
+}
+#endif
+
 static pass_status_t
 process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
                              int *err, gchar **err_info,
@@ -3248,7 +4835,7 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
 {
   wtap_rec        rec;
   Buffer          buf;
-  guint32         framenum;
+  guint32         i, nframes, framenum;
   frame_data     *fdata;
   gboolean        filtering_tap_listeners;
   guint           tap_flags;
@@ -3299,11 +4886,28 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
    */
   set_resolution_synchrony(TRUE);
 
-  for (framenum = 1; framenum <= cf->count; framenum++) {
+  nframes = cf->count;
+#ifndef _WIN32
+  if (parallel_worker >= 0)
+    nframes = parallel_worker_frames->len;
+#endif
+  for (i = 0; i < nframes; i++) {
     if (read_interrupted) {
       status = PASS_INTERRUPTED;
       break;
     }
+    framenum = i + 1;
+#ifndef _WIN32
+    if (parallel_worker >= 0) {
+      framenum = g_array_index(parallel_worker_frames, guint32, i);
+
+      /* The frames we skipped are other workers'; unless there's a
+         display filter, the one before this was displayed. */
+      cf->provider.prev_cap = (framenum > 1) ? frame_data_sequence_find(cf->provider.frames, framenum - 1) : NULL;
+      if (cf->dfcode == NULL)
+        cf->provider.prev_dis = cf->provider.prev_cap;
+    }
+#endif
     fdata = frame_data_sequence_find(cf->provider.frames, framenum);
     if (!wtap_seek_read(cf->provider.wth, fdata->file_off, &rec, &buf, err,
                         err_info)) {
@@ -3318,7 +4922,7 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
          this packet out. */
       if (pdh != NULL) {
         tshark_debug("tshark: writing packet #%d to outfile", framenum);
-        if (!wtap_dump(pdh, &rec, ws_buffer_start_ptr(&buf), err, err_info)) {
+        if (!wtap_dump(pdh, &rec, wtap_rec_data(&rec, &buf), err, err_info)) {
           /* Error writing to the output file. */
           tshark_debug("tshark: error writing to a capture file (%d)", *err);
           *err_framenum = framenum;
@@ -3327,6 +4931,10 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
         }
       }
     }
+#ifndef _WIN32
+    if (parallel_worker >= 0)
+      parallel_worker_note_output(framenum);
+#endif
   }
 
   if (edt)
@@ -3357,6 +4965,11 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
   wtap_rec_init(&rec);
   ws_buffer_init(&buf, 1514);
 
+  /* As in the first pass of two, avoid copying the packet data; we
+     only read the file sequentially. */
+  if (zero_copy)
+    wtap_set_zero_copy(cf->provider.wth, WTAP_ZERO_COPY_SEQUENTIAL);
+
   framenum = 0;
 
   /* Do we have any tap listeners with filters? */
@@ -3407,8 +5020,18 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
    */
   set_resolution_synchrony(TRUE);
 
+  if (pipeline) {
+    pipeline_reader_start(cf->provider.wth);
+#ifdef HAVE_OPEN_MEMSTREAM
+    if (print_packet_info)
+      pipeline_writer_start();
+#endif
+  }
+
   *err = 0;
-  while (wtap_read(cf->provider.wth, &rec, &buf, err, err_info, &data_offset)) {
+  while (pipeline_reader != NULL ?
+           pipeline_reader_take(pipeline_reader, &rec, &buf, err, err_info, &data_offset) :
+           wtap_read(cf->provider.wth, &rec, &buf, err, err_info, &data_offset)) {
     if (read_interrupted) {
       status = PASS_INTERRUPTED;
       break;
@@ -3425,7 +5048,7 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
          this packet out. */
       if (pdh != NULL) {
         tshark_debug("tshark: writing packet #%d to outfile", framenum);
-        if (!wtap_dump(pdh, &rec, ws_buffer_start_ptr(&buf), err, err_info)) {
+        if (!wtap_dump(pdh, &rec, wtap_rec_data(&rec, &buf), err, err_info)) {
           /* Error writing to the output file. */
           tshark_debug("tshark: error writing to a capture file (%d)", *err);
           *err_framenum = framenum;
@@ -3446,6 +5069,14 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
       break;
     }
   }
+
+  if (pipeline_reader != NULL)
+    pipeline_reader_stop();
+#ifdef HAVE_OPEN_MEMSTREAM
+  if (pipeline_writer != NULL)
+    pipeline_writer_stop();
+#endif
+
   if (*err != 0 && status == PASS_SUCCEEDED) {
     /* Error reading from the input file. */
     status = PASS_READ_ERROR;
@@ -3460,6 +5091,273 @@ process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
   return status;
 }
 
+#ifndef _WIN32
+/*
+ * Filter server.
+ *
+ * Wireshark can't filter the frames of a capture file in parallel
+ * itself: the dissection engine keeps too much global state for threads,
+ * and a process with as many threads as Wireshark has can't safely fork.
+ * So it runs us with --filter-server on the file it has open.  We read
+ * the file once, as Wireshark does, so that the dissectors build the same
+ * state, and write the number of frames to the standard output.  Then,
+ * for each request on the standard input, which is the number of workers
+ * to use and the length of a display filter, followed by the filter, we
+ * fork that many workers, each of which filters a contiguous range of
+ * frames, and write to the standard output, for each frame in order, its
+ * number, whether it passed and the number of frames it depends on,
+ * followed by their numbers.  Everything is host-endian 32-bit integers.
+ *
+ * If anything goes wrong, we just exit, and Wireshark filters the frames
+ * we haven't done itself.
+ */
+
+#define FILTER_SERVER_MAX_FILTER (1024 * 1024)
+
+/*
+ * Run in a worker process: filter frames first through last and write
+ * the results to fd.
+ */
+static void
+filter_server_worker(capture_file *cf, dfilter_t *dfcode, guint32 first,
+                     guint32 last, int fd)
+{
+  wtap           *wth;
+  FILE           *results;
+  epan_dissect_t  edt;
+  wtap_rec        rec;
+  Buffer          buf;
+  frame_data     *fdata;
+  guint32         framenum;
+  guint32         result[3];
+  guint32         dependent_frame;
+  GSList         *dep;
+  int             err;
+  gchar          *err_info;
+
+  /* We share the file offset of the server's handle, so open our own. */
+  wth = wtap_open_offline(cf->filename, cf->open_type, &err, &err_info, TRUE);
+  results = fdopen(fd, "wb");
+  if (wth == NULL || results == NULL)
+    _exit(2);
+
+  /* Find the reference frame as of the first of our frames. */
+  cf->provider.ref = NULL;
+  for (framenum = 1; framenum < first; framenum++) {
+    fdata = frame_data_sequence_find(cf->provider.frames, framenum);
+    if (cf->provider.ref == NULL || fdata->ref_time)
+      cf->provider.ref = fdata;
+  }
+  cf->provider.prev_dis = NULL;
+
+  wtap_rec_init(&rec);
+  ws_buffer_init(&buf, 1514);
+  epan_dissect_init(&edt, cf->epan, TRUE, FALSE);
+
+  for (framenum = first; framenum <= last; framenum++) {
+    fdata = frame_data_sequence_find(cf->provider.frames, framenum);
+    if (!wtap_seek_read(wth, fdata->file_off, &rec, &buf, &err, &err_info))
+      _exit(2);
+
+    frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                                  &cf->provider.ref, NULL);
+    cf->provider.prev_cap = fdata;
+
+    epan_dissect_prime_with_dfilter(&edt, dfcode);
+    epan_dissect_run(&edt, cf->cd_t, &rec,
+                     frame_tvbuff_new(&cf->provider, fdata, wtap_rec_data(&rec, &buf)),
+                     fdata, NULL);
+
+    result[0] = framenum;
+    result[1] = dfilter_apply_edt(dfcode, &edt);
+    result[2] = result[1] ? g_slist_length(edt.pi.dependent_frames) : 0;
+    fwrite(result, sizeof result[0], 3, results);
+    if (result[1]) {
+      for (dep = edt.pi.dependent_frames; dep != NULL; dep = g_slist_next(dep)) {
+        dependent_frame = GPOINTER_TO_UINT(dep->data);
+        fwrite(&dependent_frame, sizeof dependent_frame, 1, results);
+      }
+    }
+    if (ferror(results))
+      _exit(2);
+
+    epan_dissect_reset(&edt);
+  }
+
+  _exit(fflush(results) == 0 ? 0 : 2);
+}
+
+/*
+ * Filter all the frames with dfcode in num_workers workers, and write
+ * their results to the standard output in frame order.  We read from all
+ * of the workers while we wait for the one whose results are next, so
+ * that none of them blocks on a full pipe.
+ */
+static gboolean
+filter_server_run_request(capture_file *cf, dfilter_t *dfcode, guint num_workers)
+{
+  pid_t         *pids;
+  int           *fds;
+  GByteArray   **pending;
+  struct pollfd *pfds;
+  guint8         chunk[65536];
+  ssize_t        nread;
+  guint          i, w, npfds, current;
+  guint32        first, last;
+  int            pipe_fds[2];
+  int            wstatus;
+  gboolean       ok = TRUE;
+
+  pids = g_new0(pid_t, num_workers);
+  fds = g_new(int, num_workers);
+  pending = g_new(GByteArray *, num_workers);
+  pfds = g_new(struct pollfd, num_workers);
+  for (w = 0; w < num_workers; w++) {
+    fds[w] = -1;
+    pending[w] = g_byte_array_new();
+  }
+
+  first = 1;
+  for (w = 0; w < num_workers && ok; w++) {
+    last = (w == num_workers - 1) ? cf->count : first + cf->count / num_workers - 1;
+    if (pipe(pipe_fds) == -1) {
+      ok = FALSE;
+      break;
+    }
+    pids[w] = fork();
+    if (pids[w] == 0) {
+      close(pipe_fds[0]);
+      for (i = 0; i < w; i++)
+        close(fds[i]);
+      filter_server_worker(cf, dfcode, first, last, pipe_fds[1]);
+    }
+    close(pipe_fds[1]);
+    if (pids[w] == -1) {
+      close(pipe_fds[0]);
+      ok = FALSE;
+      break;
+    }
+    fds[w] = pipe_fds[0];
+    first = last + 1;
+  }
+
+  current = 0;
+  while (ok && current < num_workers) {
+    /* Pass on whatever we have from the worker whose turn it is. */
+    if (pending[current]->len != 0) {
+      if (!fork_server_write_full(1, pending[current]->data, pending[current]->len)) {
+        ok = FALSE;
+        break;
+      }
+      g_byte_array_set_size(pending[current], 0);
+    }
+    if (fds[current] == -1) {
+      /* It's finished; make sure it got through all of its frames. */
+      if (waitpid(pids[current], &wstatus, 0) == -1 ||
+          !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) {
+        ok = FALSE;
+        break;
+      }
+      pids[current] = 0;
+      current++;
+      continue;
+    }
+
+    npfds = 0;
+    for (w = current; w < num_workers; w++) {
+      if (fds[w] != -1) {
+        pfds[npfds].fd = fds[w];
+        pfds[npfds].events = POLLIN;
+        npfds++;
+      }
+    }
+    if (poll(pfds, npfds, -1) == -1) {
+      if (errno == EINTR)
+        continue;
+      ok = FALSE;
+      break;
+    }
+    for (i = 0; i < npfds; i++) {
+      if (!(pfds[i].revents & (POLLIN|POLLHUP|POLLERR)))
+        continue;
+      for (w = current; fds[w] != pfds[i].fd; w++)
+        ;
+      nread = read(fds[w], chunk, sizeof chunk);
+      if (nread > 0) {
+        g_byte_array_append(pending[w], chunk, (guint)nread);
+      } else if (nread == 0 || errno != EINTR) {
+        close(fds[w]);
+        fds[w] = -1;
+      }
+    }
+  }
+
+  for (w = 0; w < num_workers; w++) {
+    if (fds[w] != -1)
+      close(fds[w]);
+    if (pids[w] > 0) {
+      kill(pids[w], SIGKILL);
+      waitpid(pids[w], NULL, 0);
+    }
+    g_byte_array_free(pending[w], TRUE);
+  }
+  g_free(pfds);
+  g_free(pending);
+  g_free(fds);
+  g_free(pids);
+  return ok;
+}
+
+static int
+run_filter_server(capture_file *cf)
+{
+  int        err;
+  gchar     *err_info = NULL;
+  guint32    count;
+  guint32    request[2];
+  gchar     *text;
+  gchar     *err_msg;
+  dfilter_t *dfcode;
+  gboolean   ok;
+
+  do_dissection = TRUE;
+  if (process_cap_file_first_pass(cf, 0, 0, &err, &err_info) != PASS_SUCCEEDED) {
+    g_free(err_info);
+    return 2;
+  }
+
+  count = cf->count;
+  if (!fork_server_write_full(1, &count, sizeof count))
+    return 2;
+
+  /* Wireshark closes our standard input when it's done with us. */
+  while (fork_server_read_full(0, request, sizeof request)) {
+    if (request[0] == 0 || request[1] > FILTER_SERVER_MAX_FILTER)
+      return 2;
+    text = (gchar *)g_malloc(request[1] + 1);
+    if (!fork_server_read_full(0, text, request[1])) {
+      g_free(text);
+      return 2;
+    }
+    text[request[1]] = '\0';
+    if (!dfilter_compile(text, &dfcode, &err_msg)) {
+      g_free(err_msg);
+      g_free(text);
+      return 2;
+    }
+    g_free(text);
+    if (dfcode == NULL)
+      return 2;
+
+    ok = filter_server_run_request(cf, dfcode, MIN(request[0], MAX(count, 1)));
+    dfilter_free(dfcode);
+    if (!ok)
+      return 2;
+  }
+  return 0;
+}
+#endif
+
 static process_file_status_t
 process_cap_file(capture_file *cf, char *save_file, int out_file_type,
     gboolean out_file_name_res, int max_packet_count, gint64 max_byte_count)
@@ -3541,6 +5439,13 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
     sigaction(SIGHUP, &action, NULL);
 #endif /* _WIN32 */
 
+#ifndef _WIN32
+  if (perform_two_pass_analysis && parallel_workers > 1 && parallel_worker < 0 &&
+      run_parallel_workers(cf, &status)) {
+    /* The workers did both passes, and reported their own errors. */
+    first_pass_status = second_pass_status = PASS_SUCCEEDED;
+  } else
+#endif
   if (perform_two_pass_analysis) {
     tshark_debug("tshark: perform_two_pass_analysis, do_dissection=%s", do_dissection ? "TRUE" : "FALSE");
 
@@ -3667,6 +5572,11 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
       break;
     }
   }
+#ifndef _WIN32
+  /* The parent writes the finale. */
+  if (parallel_worker >= 0)
+    finish_parallel_worker(status);
+#endif
   if (save_file != NULL) {
     if (second_pass_status != PASS_WRITE_ERROR) {
       if (pdh && out_file_name_res) {
@@ -3737,6 +5647,10 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
        with the hfids postdissectors want on the first pass. */
     prime_epan_dissect_with_postdissector_wanted_hfids(edt);
 
+    /* Skip dissectors that can't matter to the filter, if asked to. */
+    if (dissect_protocols)
+      epan_dissect_restrict_protocols(edt, dissect_protocols);
+
     col_custom_prime_edt(edt, &cf->cinfo);
 
     /* We only need the columns if either
@@ -3764,7 +5678,7 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
     }
 
     epan_dissect_run_with_taps(edt, cf->cd_t, rec,
-                               frame_tvbuff_new_buffer(&cf->provider, &fdata, buf),
+                               frame_tvbuff_new(&cf->provider, &fdata, wtap_rec_data(rec, buf)),
                                &fdata, cinfo);
 
     /* Run the filter if we have it. */
@@ -3786,12 +5700,16 @@ process_packet_single_pass(capture_file *cf, epan_dissect_t *edt, gint64 offset,
          after every packet.  See the comment above, for the "-l"
          option, for an explanation of why we do that. */
       if (line_buffered)
-        fflush(stdout);
+        fflush(packet_output);
 
-      if (ferror(stdout)) {
+      if (ferror(packet_output)) {
         show_print_file_io_error(errno);
         exit(2);
       }
+#ifdef HAVE_OPEN_MEMSTREAM
+      if (pipeline_writer != NULL)
+        pipeline_packet_printed();
+#endif
     }
 
     /* this must be set after print_packet() [bug #8160] */
@@ -4159,13 +6077,13 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
 
   case WRITE_XML:
     if (print_summary) {
-      write_psml_columns(edt, stdout, dissect_color);
-      return !ferror(stdout);
+      write_psml_columns(edt, packet_output, dissect_color);
+      return !ferror(packet_output);
     }
     if (print_details) {
-      write_pdml_proto_tree(output_fields, protocolfilter, protocolfilter_flags, edt, &cf->cinfo, stdout, dissect_color);
-      printf("\n");
-      return !ferror(stdout);
+      write_pdml_proto_tree(output_fields, protocolfilter, protocolfilter_flags, edt, &cf->cinfo, packet_output, dissect_color);
+      fputc('\n', packet_output);
+      return !ferror(packet_output);
     }
     break;
 
@@ -4175,9 +6093,9 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
       g_assert_not_reached();
     }
     if (print_details) {
-      write_fields_proto_tree(output_fields, edt, &cf->cinfo, stdout);
-      printf("\n");
-      return !ferror(stdout);
+      write_fields_proto_tree(output_fields, edt, &cf->cinfo, packet_output);
+      fputc('\n', packet_output);
+      return !ferror(packet_output);
     }
     break;
 
@@ -4188,7 +6106,7 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
       write_json_proto_tree(output_fields, print_dissections_expanded,
                             print_hex, protocolfilter, protocolfilter_flags,
                             edt, &cf->cinfo, node_children_grouper, &jdumper);
-      return !ferror(stdout);
+      return !ferror(packet_output);
     }
     break;
 
@@ -4199,14 +6117,14 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
       write_json_proto_tree(output_fields, print_dissections_none, TRUE,
                             protocolfilter, protocolfilter_flags,
                             edt, &cf->cinfo, node_children_grouper, &jdumper);
-      return !ferror(stdout);
+      return !ferror(packet_output);
     }
     break;
 
   case WRITE_EK:
     write_ek_proto_tree(output_fields, print_summary, print_hex, protocolfilter,
-                        protocolfilter_flags, edt, &cf->cinfo, stdout);
-    return !ferror(stdout);
+                        protocolfilter_flags, edt, &cf->cinfo, packet_output);
+    return !ferror(packet_output);
   }
 
   if (print_hex) {
@@ -0,0 +1,86 @@
+/* tap-reassembly.c
+ * Report on the memory held by unfinished reassemblies
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#include <epan/packet.h>
+#include <epan/prefs.h>
+#include <epan/reassemble.h>
+#include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
+
+#include <ui/cli/tshark-tap.h>
+
+void register_tap_listener_reassembly(void);
+
+static void
+reassembly_draw(void *tapdata _U_)
+{
+	reassembly_stats stats;
+
+	reassembly_tables_get_stats(&stats);
+
+	printf("\n");
+	printf("===================================================================\n");
+	printf("Reassembly Statistics:\n");
+	if (prefs.reassembly_max_pending_mb != 0)
+		printf("Limit of unfinished data per table: %u MB\n", prefs.reassembly_max_pending_mb);
+	else
+		printf("Limit of unfinished data per table: none\n");
+	if (prefs.reassembly_max_age != 0)
+		printf("Limit of unfinished reassembly age: %u frames\n", prefs.reassembly_max_age);
+	else
+		printf("Limit of unfinished reassembly age: none\n");
+	printf("\n");
+	printf("%-30s %12s %16s\n", "", "Reassemblies", "Bytes");
+	printf("%-30s %12u %16" G_GUINT64_FORMAT "\n", "Unfinished at end of capture",
+	       stats.pending_reassemblies, stats.pending_bytes);
+	printf("%-30s %12" G_GUINT64_FORMAT " %16" G_GUINT64_FORMAT "\n", "Discarded unfinished",
+	       stats.evicted_reassemblies, stats.evicted_bytes);
+	printf("===================================================================\n");
+}
+
+static void
+reassembly_init(const char *opt_arg _U_, void *userdata _U_)
+{
+	register_report_tap("reassembly,stat", reassembly_draw);
+}
+
+static stat_tap_ui reassembly_ui = {
+	REGISTER_STAT_GROUP_GENERIC,
+	NULL,
+	"reassembly,stat",
+	reassembly_init,
+	0,
+	NULL
+};
+
+void
+register_tap_listener_reassembly(void)
+{
+	register_stat_tap_ui(&reassembly_ui, NULL);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -0,0 +1,52 @@
+/* tap-report.c
+ * Helper for -z reports on statistics that are kept elsewhere and only
+ * have to be printed at the end of the run
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include <epan/tap.h>
+
+#include <ui/cmdarg_err.h>
+#include <ui/cli/tshark-tap.h>
+
+void
+register_report_tap(const char *report_name, tap_draw_cb draw)
+{
+	GString *error_string;
+
+	/*
+	 * Nothing is gathered per packet; listening to "frame" is just
+	 * a way to have draw called when the taps are drawn at the end.
+	 */
+	error_string = register_tap_listener("frame", NULL, NULL, TL_REQUIRES_NOTHING, NULL, NULL, draw, NULL);
+	if (error_string) {
+		cmdarg_err("Couldn't register %s tap: %s",
+			report_name, error_string->str);
+		g_string_free(error_string, TRUE);
+		exit(1);
+	}
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
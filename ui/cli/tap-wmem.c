@@ -0,0 +1,83 @@
+/* tap-wmem.c
+ * Report on the allocation statistics of the wmem pools
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#include <epan/packet.h>
+#include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
+#include <epan/wmem/wmem.h>
+
+#include <ui/cli/tshark-tap.h>
+
+void register_tap_listener_wmem(void);
+
+static void
+wmem_stat_print_pool(wmem_allocator_t *allocator, void *user_data _U_)
+{
+	wmem_allocator_stats_t stats;
+
+	wmem_allocator_get_stats(allocator, &stats);
+
+	printf("%-16s %14" G_GUINT64_FORMAT " %14" G_GUINT64_FORMAT " %12" G_GUINT64_FORMAT " %12" G_GUINT64_FORMAT " %10" G_GUINT64_FORMAT "\n",
+	       wmem_allocator_get_name(allocator),
+	       stats.bytes_in_use, stats.peak_bytes_in_use,
+	       stats.alloc_count, stats.free_count, stats.free_all_count);
+}
+
+static void
+wmem_stat_draw(void *tapdata _U_)
+{
+	printf("\n");
+	printf("===================================================================================\n");
+	printf("Memory Pool Statistics:\n");
+	printf("%-16s %14s %14s %12s %12s %10s\n",
+	       "Pool", "In use", "Peak", "Allocations", "Frees", "Free alls");
+	wmem_foreach_named_allocator(wmem_stat_print_pool, NULL);
+	printf("===================================================================================\n");
+}
+
+static void
+wmem_stat_init(const char *opt_arg _U_, void *userdata _U_)
+{
+	register_report_tap("wmem,stat", wmem_stat_draw);
+}
+
+static stat_tap_ui wmem_stat_ui = {
+	REGISTER_STAT_GROUP_GENERIC,
+	NULL,
+	"wmem,stat",
+	wmem_stat_init,
+	0,
+	NULL
+};
+
+void
+register_tap_listener_wmem(void)
+{
+	register_stat_tap_ui(&wmem_stat_ui, NULL);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -11,6 +11,7 @@
 #define __TSHARK_TAP_H__
 
 #include <epan/conversation_table.h>
+#include <epan/tap.h>
 
 extern void init_iousers(struct register_ct* ct, const char *filter);
 extern void init_hostlists(struct register_ct* ct, const char *filter);
@@ -18,4 +19,7 @@ extern gboolean register_srt_tables(const void *key, void *value, void *userdata
 extern gboolean register_rtd_tables(const void *key, void *value, void *userdata);
 extern gboolean register_simple_stat_tables(const void *key, void *value, void *userdata);
 
+/* For reports on statistics kept elsewhere, have draw called at the end of the run. */
+extern void register_report_tap(const char *report_name, tap_draw_cb draw);
+
 #endif /* __TSHARK_TAP_H__ */
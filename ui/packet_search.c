@@ -0,0 +1,369 @@
+/* packet_search.c
+ * Routines for searching packet bytes for strings, hex values and
+ * regular expressions (Edit > Find Packet)
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <fcntl.h>
+
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+#include <wsutil/ws_memsearch.h>
+
+#include "packet_search.h"
+
+/* Bytes of the capture file read at a time by a block scan */
+#define PACKET_SEARCH_SCAN_BLOCK_SIZE (4 * 1024 * 1024)
+
+struct _packet_search_scan {
+    const guint8 *needle;
+    size_t        needle_len;
+    gboolean      backward;
+    int           fd;
+    guint8       *block;
+    gint64        block_start;  /* file offset of block[0] */
+    gint64        block_end;    /* file offset just past the data in block */
+    GArray       *hits;         /* gint64 file offsets of the needle in block */
+};
+
+/*
+ * The match routines only support ASCII case insensitivity and don't
+ * convert UTF-8 inputs to UTF-16 for matching.
+ *
+ * We could modify them to use the GLib Unicode routines or the International
+ * Components for Unicode library but it's not apparent that we could do so
+ * without consuming a lot more CPU and memory or that searching would be
+ * significantly better.
+ */
+
+void
+packet_search_init(packet_search_t *ps, packet_search_type_e type,
+    const guint8 *data, size_t data_len, gboolean case_insensitive)
+{
+    gchar needles[3];
+
+    memset(ps, 0, sizeof *ps);
+    ps->type = type;
+    ps->data = data;
+    ps->data_len = data_len;
+    ps->case_insensitive = type != PACKET_SEARCH_BINARY && case_insensitive;
+
+    /* Look for either case of the first letter of the string. */
+    if (ps->case_insensitive && data_len != 0 && g_ascii_isalpha(data[0])) {
+        needles[0] = g_ascii_toupper(data[0]);
+        needles[1] = g_ascii_tolower(data[0]);
+        needles[2] = '\0';
+        ws_mempbrk_compile(&ps->first_bytes, needles);
+        ps->first_byte_caseless = TRUE;
+    }
+}
+
+void
+packet_search_init_regex(packet_search_t *ps, GRegex *regex)
+{
+    memset(ps, 0, sizeof *ps);
+    ps->type = PACKET_SEARCH_REGEX;
+    ps->regex = regex;
+}
+
+/*
+ * Find the first place at or after p, and before end, where the search
+ * string could start.  memchr() and ws_mempbrk_exec() look at several
+ * bytes at a time, so this skips most of a packet much faster than
+ * comparing each byte with the start of the string.
+ */
+static const guint8 *
+find_first_byte(const packet_search_t *ps, const guint8 *p, const guint8 *end)
+{
+    guchar found_needle;
+
+    if (p >= end)
+        return NULL;
+    if (ps->first_byte_caseless)
+        return ws_mempbrk_exec(p, end - p, &ps->first_bytes, &found_needle);
+    return (const guint8 *)memchr(p, ps->data[0], end - p);
+}
+
+static inline guint8
+search_char(const packet_search_t *ps, guint8 c_char)
+{
+    return ps->case_insensitive ? g_ascii_toupper(c_char) : c_char;
+}
+
+static gboolean
+match_narrow_and_wide(const packet_search_t *ps, const guint8 *pd,
+    const guint8 *end, guint32 *last)
+{
+    const guint8 *start;
+    const guint8 *p;
+    size_t        c_match;
+
+    for (start = pd; (start = find_first_byte(ps, start, end)) != NULL; start++) {
+        /* Match the rest of the string, ignoring any NULs between characters. */
+        c_match = 1;
+        for (p = start + 1; c_match < ps->data_len && p < end; p++) {
+            if (*p == '\0')
+                continue;
+            if (search_char(ps, *p) != ps->data[c_match])
+                break;
+            c_match++;
+        }
+        if (c_match == ps->data_len) {
+            *last = (guint32)(p - 1 - pd);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static gboolean
+match_narrow(const packet_search_t *ps, const guint8 *pd,
+    const guint8 *end, guint32 *last)
+{
+    const guint8 *start;
+    size_t        c_match;
+
+    if (!ps->case_insensitive) {
+        start = ws_memmem(pd, end - pd, ps->data, ps->data_len);
+        if (start == NULL)
+            return FALSE;
+        *last = (guint32)(start - pd + ps->data_len - 1);
+        return TRUE;
+    }
+
+    for (start = pd; (start = find_first_byte(ps, start, end)) != NULL; start++) {
+        if ((size_t)(end - start) < ps->data_len)
+            break;
+        for (c_match = 1; c_match < ps->data_len; c_match++) {
+            if (g_ascii_toupper(start[c_match]) != ps->data[c_match])
+                break;
+        }
+        if (c_match == ps->data_len) {
+            *last = (guint32)(start - pd + ps->data_len - 1);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static gboolean
+match_wide(const packet_search_t *ps, const guint8 *pd,
+    const guint8 *end, guint32 *last)
+{
+    const guint8 *start;
+    size_t        c_match;
+
+    for (start = pd; (start = find_first_byte(ps, start, end)) != NULL; start++) {
+        /* The characters are every other byte. */
+        if ((size_t)(end - start) < (ps->data_len - 1) * 2 + 1)
+            break;
+        for (c_match = 1; c_match < ps->data_len; c_match++) {
+            if (search_char(ps, start[c_match * 2]) != ps->data[c_match])
+                break;
+        }
+        if (c_match == ps->data_len) {
+            *last = (guint32)(start - pd + (ps->data_len - 1) * 2);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static gboolean
+match_regex(const packet_search_t *ps, const guint8 *pd, guint32 pd_len,
+    guint32 *last, guint32 *match_len)
+{
+    GMatchInfo *match_info = NULL;
+    gint        start_pos = 0, end_pos = 0;
+    gboolean    matched = FALSE;
+
+    if (g_regex_match_full(ps->regex, (const gchar *)pd, pd_len,
+                           0, (GRegexMatchFlags) 0, &match_info, NULL)) {
+        g_match_info_fetch_pos(match_info, 0, &start_pos, &end_pos);
+        *last = end_pos - 1;
+        *match_len = end_pos - start_pos;
+        matched = TRUE;
+    }
+    g_match_info_free(match_info);
+    return matched;
+}
+
+gboolean
+packet_search_match(const packet_search_t *ps, const guint8 *pd,
+    guint32 pd_len, guint32 *last, guint32 *match_len)
+{
+    const guint8 *end = pd + pd_len;
+    gboolean      matched;
+
+    if (ps->type == PACKET_SEARCH_REGEX)
+        return match_regex(ps, pd, pd_len, last, match_len);
+
+    if (ps->data_len == 0)
+        return FALSE;
+
+    switch (ps->type) {
+
+    case PACKET_SEARCH_NARROW_AND_WIDE:
+        matched = match_narrow_and_wide(ps, pd, end, last);
+        break;
+
+    case PACKET_SEARCH_NARROW:
+        matched = match_narrow(ps, pd, end, last);
+        break;
+
+    case PACKET_SEARCH_WIDE:
+        matched = match_wide(ps, pd, end, last);
+        break;
+
+    case PACKET_SEARCH_BINARY:
+        /* Exact bytes, as for a case-sensitive narrow string. */
+        matched = match_narrow(ps, pd, end, last);
+        break;
+
+    default:
+        g_assert_not_reached();
+        return FALSE;
+    }
+    if (matched)
+        *match_len = (guint32)ps->data_len;
+    return matched;
+}
+
+packet_search_scan_t *
+packet_search_scan_new(const packet_search_t *ps, const char *path,
+    gboolean backward)
+{
+    packet_search_scan_t *scan;
+    int fd;
+
+    /* Other searches don't look for a fixed string of bytes. */
+    if (ps->data_len == 0 ||
+        !(ps->type == PACKET_SEARCH_BINARY ||
+          (ps->type == PACKET_SEARCH_NARROW && !ps->case_insensitive)))
+        return NULL;
+
+    fd = ws_open(path, O_RDONLY|O_BINARY, 0000);
+    if (fd == -1)
+        return NULL;
+
+    scan = g_new(packet_search_scan_t, 1);
+    scan->needle = ps->data;
+    scan->needle_len = ps->data_len;
+    scan->backward = backward;
+    scan->fd = fd;
+    scan->block = (guint8 *)g_malloc(PACKET_SEARCH_SCAN_BLOCK_SIZE);
+    scan->block_start = 0;
+    scan->block_end = 0;
+    scan->hits = g_array_new(FALSE, FALSE, sizeof(gint64));
+    return scan;
+}
+
+/*
+ * Read the block of the file with the bytes from start up to end, going
+ * on from there in the direction of the search, and find the search
+ * string in it.
+ */
+static gboolean
+packet_search_scan_fill(packet_search_scan_t *scan, gint64 start, gint64 end)
+{
+    const guint8 *p;
+    const guint8 *block_data_end;
+    size_t        total = 0;
+    int           bytes_read;
+    gint64        hit;
+
+    if (scan->backward)
+        scan->block_start = MAX(end - PACKET_SEARCH_SCAN_BLOCK_SIZE, 0);
+    else
+        scan->block_start = start;
+    scan->block_end = scan->block_start;
+    g_array_set_size(scan->hits, 0);
+
+    if (ws_lseek64(scan->fd, scan->block_start, SEEK_SET) == -1)
+        return FALSE;
+    while (total < PACKET_SEARCH_SCAN_BLOCK_SIZE) {
+        bytes_read = (int)ws_read(scan->fd, scan->block + total,
+                                  (unsigned int)(PACKET_SEARCH_SCAN_BLOCK_SIZE - total));
+        if (bytes_read < 0)
+            return FALSE;
+        if (bytes_read == 0)
+            break;
+        total += bytes_read;
+    }
+    scan->block_end = scan->block_start + total;
+
+    block_data_end = scan->block + total;
+    for (p = scan->block;
+         (p = ws_memmem(p, block_data_end - p, scan->needle, scan->needle_len)) != NULL;
+         p++) {
+        hit = scan->block_start + (p - scan->block);
+        g_array_append_val(scan->hits, hit);
+    }
+    return TRUE;
+}
+
+gboolean
+packet_search_scan_may_match(packet_search_scan_t *scan, gint64 start,
+    gint64 end)
+{
+    guint  lo, hi, mid;
+    gint64 hit;
+
+    /* Leave records we can't fit in a block to the caller. */
+    if (start < 0 || end <= start || end - start > PACKET_SEARCH_SCAN_BLOCK_SIZE)
+        return TRUE;
+
+    if (start < scan->block_start || end > scan->block_end) {
+        if (!packet_search_scan_fill(scan, start, end) ||
+            start < scan->block_start || end > scan->block_end)
+            return TRUE;
+    }
+
+    /* Find the first hit at or after start; it has to end by end. */
+    lo = 0;
+    hi = scan->hits->len;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (g_array_index(scan->hits, gint64, mid) < start)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == scan->hits->len)
+        return FALSE;
+    hit = g_array_index(scan->hits, gint64, lo);
+    return hit + (gint64)scan->needle_len <= end;
+}
+
+void
+packet_search_scan_free(packet_search_scan_t *scan)
+{
+    if (scan == NULL)
+        return;
+    ws_close(scan->fd);
+    g_free(scan->block);
+    g_array_free(scan->hits, TRUE);
+    g_free(scan);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
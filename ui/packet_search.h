@@ -0,0 +1,104 @@
+/* packet_search.h
+ * Definitions for searching packet bytes for strings, hex values and
+ * regular expressions (Edit > Find Packet)
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __PACKET_SEARCH_H__
+#define __PACKET_SEARCH_H__
+
+#include <glib.h>
+
+#include <wsutil/ws_mempbrk.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef enum {
+    PACKET_SEARCH_BINARY,           /* the bytes as given */
+    PACKET_SEARCH_NARROW,           /* 8-bit characters */
+    PACKET_SEARCH_WIDE,             /* characters in every other byte */
+    PACKET_SEARCH_NARROW_AND_WIDE,  /* characters, ignoring NULs between them */
+    PACKET_SEARCH_REGEX             /* a regular expression */
+} packet_search_type_e;
+
+typedef struct {
+    packet_search_type_e type;
+    const guint8        *data;                  /* string or bytes to look for */
+    size_t               data_len;
+    gboolean             case_insensitive;      /* data has been converted to upper case */
+    GRegex              *regex;                 /* for PACKET_SEARCH_REGEX */
+    gboolean             first_byte_caseless;   /* data[0] is a letter to match in either case */
+    ws_mempbrk_pattern   first_bytes;           /* upper and lower case of data[0] */
+} packet_search_t;
+
+/*
+ * Set up a search for a string or bytes.  For a case-insensitive search,
+ * the string has to have been converted to upper case already.  data has
+ * to stay valid while the search is in use.
+ */
+extern void packet_search_init(packet_search_t *ps, packet_search_type_e type,
+    const guint8 *data, size_t data_len, gboolean case_insensitive);
+
+/* Set up a search for a regular expression. */
+extern void packet_search_init_regex(packet_search_t *ps, GRegex *regex);
+
+/*
+ * Look for the first match in a packet's bytes.  On a match, returns
+ * TRUE, sets *last to the offset of the last byte of the match, for
+ * highlighting it, and *match_len to its length in characters.
+ */
+extern gboolean packet_search_match(const packet_search_t *ps,
+    const guint8 *pd, guint32 pd_len, guint32 *last, guint32 *match_len);
+
+/*
+ * A block scan reads a capture file in large blocks and looks for the
+ * search string in them, so that records whose bytes in the file don't
+ * have it can be skipped without reading and matching each of them.
+ * It only works for searches that look for exact bytes, and for files
+ * in which every record's data is stored unchanged between its offset
+ * and the next record's; it's up to the caller to check the latter.
+ */
+typedef struct _packet_search_scan packet_search_scan_t;
+
+/*
+ * Start a block scan of a capture file, going towards its start if
+ * backward is TRUE.  Returns NULL if the search can't be done with one.
+ */
+extern packet_search_scan_t *packet_search_scan_new(const packet_search_t *ps,
+    const char *path, gboolean backward);
+
+/*
+ * Returns FALSE if the bytes of the file from offset start up to offset
+ * end don't have the search string, and TRUE if they do or if the scan
+ * can't tell.
+ */
+extern gboolean packet_search_scan_may_match(packet_search_scan_t *scan,
+    gint64 start, gint64 end);
+
+extern void packet_search_scan_free(packet_search_scan_t *scan);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __PACKET_SEARCH_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
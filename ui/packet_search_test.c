@@ -0,0 +1,247 @@
+/* packet_search_test.c
+ * Standalone program to test the Find Packet string, hex and regular
+ * expression matching, and the block scan of capture files.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <wsutil/file_util.h>
+
+#include "packet_search.h"
+
+static void
+check_match(const packet_search_t *ps, const char *pd, guint32 pd_len,
+    guint32 expected_last, guint32 expected_len)
+{
+    guint32 last = 0, match_len = 0;
+
+    g_assert(packet_search_match(ps, (const guint8 *)pd, pd_len, &last, &match_len));
+    g_assert_cmpuint(last, ==, expected_last);
+    g_assert_cmpuint(match_len, ==, expected_len);
+}
+
+static void
+check_no_match(const packet_search_t *ps, const char *pd, guint32 pd_len)
+{
+    guint32 last, match_len;
+
+    g_assert(!packet_search_match(ps, (const guint8 *)pd, pd_len, &last, &match_len));
+}
+
+static void
+packet_search_test_narrow(void)
+{
+    static const char pd[] = "GET /Index.html HTTP/1.1";
+    packet_search_t ps;
+
+    packet_search_init(&ps, PACKET_SEARCH_NARROW, (const guint8 *)"index", 5, FALSE);
+    check_no_match(&ps, pd, sizeof pd - 1);
+
+    packet_search_init(&ps, PACKET_SEARCH_NARROW, (const guint8 *)"Index", 5, FALSE);
+    check_match(&ps, pd, sizeof pd - 1, 9, 5);
+
+    /* Case-insensitive searches are given the string in upper case. */
+    packet_search_init(&ps, PACKET_SEARCH_NARROW, (const guint8 *)"INDEX", 5, TRUE);
+    check_match(&ps, pd, sizeof pd - 1, 9, 5);
+    packet_search_init(&ps, PACKET_SEARCH_NARROW, (const guint8 *)"HTTP/1.1", 8, TRUE);
+    check_match(&ps, pd, sizeof pd - 1, 23, 8);
+
+    /* A match has to be entirely in the packet. */
+    packet_search_init(&ps, PACKET_SEARCH_NARROW, (const guint8 *)"1.1!", 4, FALSE);
+    check_no_match(&ps, pd, sizeof pd - 1);
+    packet_search_init(&ps, PACKET_SEARCH_NARROW, (const guint8 *)"GET", 3, FALSE);
+    check_no_match(&ps, pd, 2);
+}
+
+static void
+packet_search_test_wide(void)
+{
+    static const char pd[] = "x\0W\0i\0n\0d\0o\0w\0s\0";
+    packet_search_t ps;
+
+    packet_search_init(&ps, PACKET_SEARCH_WIDE, (const guint8 *)"WIN", 3, TRUE);
+    check_match(&ps, pd, sizeof pd - 1, 6, 3);
+    packet_search_init(&ps, PACKET_SEARCH_WIDE, (const guint8 *)"WIN", 3, FALSE);
+    check_no_match(&ps, pd, sizeof pd - 1);
+    packet_search_init(&ps, PACKET_SEARCH_WIDE, (const guint8 *)"ows", 3, FALSE);
+    check_match(&ps, pd, sizeof pd - 1, 14, 3);
+
+    /* Narrow searches don't skip the NULs. */
+    packet_search_init(&ps, PACKET_SEARCH_NARROW, (const guint8 *)"WIN", 3, TRUE);
+    check_no_match(&ps, pd, sizeof pd - 1);
+}
+
+static void
+packet_search_test_narrow_and_wide(void)
+{
+    static const char narrow[] = "user=admin";
+    static const char wide[] = "u\0s\0e\0r\0=\0a\0d\0m\0i\0n\0";
+    packet_search_t ps;
+
+    packet_search_init(&ps, PACKET_SEARCH_NARROW_AND_WIDE, (const guint8 *)"ADMIN", 5, TRUE);
+    check_match(&ps, narrow, sizeof narrow - 1, 9, 5);
+    check_match(&ps, wide, sizeof wide - 1, 18, 5);
+
+    packet_search_init(&ps, PACKET_SEARCH_NARROW_AND_WIDE, (const guint8 *)"root", 4, FALSE);
+    check_no_match(&ps, narrow, sizeof narrow - 1);
+    check_no_match(&ps, wide, sizeof wide - 1);
+}
+
+static void
+packet_search_test_hex(void)
+{
+    static const char pd[] = "\x00\x01\xde\xad\xbe\xef\x02\xde\xad";
+    static const guint8 deadbeef[] = { 0xde, 0xad, 0xbe, 0xef };
+    static const guint8 dead02[] = { 0xde, 0xad, 0x02 };
+    static const guint8 zero[] = { 0x00, 0x01 };
+    packet_search_t ps;
+
+    packet_search_init(&ps, PACKET_SEARCH_BINARY, deadbeef, sizeof deadbeef, FALSE);
+    check_match(&ps, pd, sizeof pd - 1, 5, 4);
+
+    packet_search_init(&ps, PACKET_SEARCH_BINARY, dead02, sizeof dead02, FALSE);
+    check_no_match(&ps, pd, sizeof pd - 1);
+
+    /* NULs are bytes like any other in a hex search. */
+    packet_search_init(&ps, PACKET_SEARCH_BINARY, zero, sizeof zero, FALSE);
+    check_match(&ps, pd, sizeof pd - 1, 1, 2);
+
+    /* A partial match at the end isn't a match. */
+    packet_search_init(&ps, PACKET_SEARCH_BINARY, deadbeef, sizeof deadbeef, FALSE);
+    check_no_match(&ps, pd + 6, 3);
+}
+
+static void
+packet_search_test_regex(void)
+{
+    static const char pd[] = "abc\0Host: www.example.com\r\n";
+    packet_search_t ps;
+    GRegex *regex;
+
+    regex = g_regex_new("host: [a-z.]+\\.com", (GRegexCompileFlags)(G_REGEX_CASELESS | G_REGEX_RAW | G_REGEX_OPTIMIZE),
+                        (GRegexMatchFlags)0, NULL);
+    g_assert(regex != NULL);
+    packet_search_init_regex(&ps, regex);
+    /* The data after a NUL is searched too. */
+    check_match(&ps, pd, sizeof pd - 1, 24, 21);
+    check_no_match(&ps, pd, 20);
+    g_regex_unref(regex);
+}
+
+/*
+ * A file of several blocks, with the search string at a few places,
+ * including across a block boundary.
+ */
+#define SCAN_FILE_SIZE  (10 * 1024 * 1024)
+#define SCAN_BLOCK_SIZE (4 * 1024 * 1024)
+
+static const gint64 scan_hits[] = { 100, SCAN_BLOCK_SIZE - 2, 7 * 1024 * 1024, SCAN_FILE_SIZE - 4 };
+
+static void
+check_scan(const char *path, const packet_search_t *ps, gboolean backward)
+{
+    packet_search_scan_t *scan;
+    int i, order;
+    gint64 hit;
+
+    scan = packet_search_scan_new(ps, path, backward);
+    g_assert(scan != NULL);
+
+    for (order = 0; order < (int)G_N_ELEMENTS(scan_hits); order++) {
+        i = backward ? (int)G_N_ELEMENTS(scan_hits) - 1 - order : order;
+        hit = scan_hits[i];
+        /* Records around each hit have it only if they hold all of it. */
+        g_assert(packet_search_scan_may_match(scan, hit - 10, hit + 4));
+        g_assert(packet_search_scan_may_match(scan, hit, hit + 4));
+        g_assert(!packet_search_scan_may_match(scan, hit - 10, hit + 3));
+        g_assert(!packet_search_scan_may_match(scan, hit + 1, MIN(hit + 10, SCAN_FILE_SIZE)));
+    }
+
+    /* Records without it can be skipped. */
+    g_assert(!packet_search_scan_may_match(scan, 200, 300));
+    g_assert(!packet_search_scan_may_match(scan, 5 * 1024 * 1024, 5 * 1024 * 1024 + 1500));
+
+    /* Records too big for a block, or that we can't read, can't be. */
+    g_assert(packet_search_scan_may_match(scan, 0, SCAN_BLOCK_SIZE + 1));
+    g_assert(packet_search_scan_may_match(scan, SCAN_FILE_SIZE - 100, SCAN_FILE_SIZE + 100));
+
+    packet_search_scan_free(scan);
+}
+
+static void
+packet_search_test_scan(void)
+{
+    static const guint8 needle[] = { 'W', 'S', 0x00, 0xff };
+    packet_search_t ps;
+    guint8 *contents;
+    gchar *path;
+    GError *error = NULL;
+    int fd;
+    size_t i;
+
+    contents = (guint8 *)g_malloc0(SCAN_FILE_SIZE);
+    for (i = 0; i < G_N_ELEMENTS(scan_hits); i++)
+        memcpy(contents + scan_hits[i], needle, sizeof needle);
+    fd = g_file_open_tmp("packet_search_test_XXXXXX", &path, &error);
+    g_assert_no_error(error);
+    ws_close(fd);
+    g_assert(g_file_set_contents(path, (const gchar *)contents, SCAN_FILE_SIZE, &error));
+    g_free(contents);
+
+    packet_search_init(&ps, PACKET_SEARCH_BINARY, needle, sizeof needle, FALSE);
+    check_scan(path, &ps, FALSE);
+    check_scan(path, &ps, TRUE);
+
+    packet_search_init(&ps, PACKET_SEARCH_NARROW, needle, sizeof needle, FALSE);
+    check_scan(path, &ps, FALSE);
+
+    /* These don't look for exact bytes. */
+    packet_search_init(&ps, PACKET_SEARCH_NARROW, needle, sizeof needle, TRUE);
+    g_assert(packet_search_scan_new(&ps, path, FALSE) == NULL);
+    packet_search_init(&ps, PACKET_SEARCH_WIDE, needle, sizeof needle, FALSE);
+    g_assert(packet_search_scan_new(&ps, path, FALSE) == NULL);
+    packet_search_init(&ps, PACKET_SEARCH_NARROW_AND_WIDE, needle, sizeof needle, FALSE);
+    g_assert(packet_search_scan_new(&ps, path, FALSE) == NULL);
+
+    g_unlink(path);
+    g_free(path);
+}
+
+int
+main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/packet_search/narrow",          packet_search_test_narrow);
+    g_test_add_func("/packet_search/wide",            packet_search_test_wide);
+    g_test_add_func("/packet_search/narrow_and_wide", packet_search_test_narrow_and_wide);
+    g_test_add_func("/packet_search/hex",             packet_search_test_hex);
+    g_test_add_func("/packet_search/regex",           packet_search_test_regex);
+    g_test_add_func("/packet_search/scan",            packet_search_test_scan);
+
+    return g_test_run();
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -36,6 +36,8 @@
 #include <QFontMetrics>
 #include <QModelIndex>
 #include <QElapsedTimer>
+#include <QRunnable>
+#include <QThread>
 
 // Print timing information
 //#define DEBUG_PACKET_LIST_MODEL 1
@@ -71,6 +73,13 @@ PacketListModel::PacketListModel(QObject *parent, capture_file *cf) :
     number_to_row_(QVector<int>()),
     max_row_height_(0),
     max_line_count_(1),
+    sort_column_(-1),
+    sort_column_is_numeric_(false),
+    text_sort_column_(-1),
+    sort_order_(Qt::AscendingOrder),
+    sort_cap_file_(NULL),
+    sort_values_column_(-1),
+    sorting_(false),
     idle_dissection_row_(0)
 {
     Q_ASSERT(glbl_plist_model == Q_NULLPTR);
@@ -103,6 +112,7 @@ PacketListModel::PacketListModel(QObject *parent, capture_file *cf) :
 
 PacketListModel::~PacketListModel()
 {
+    clearSortValues();
     delete idle_dissection_timer_;
 }
 
@@ -163,6 +173,7 @@ guint PacketListModel::recreateVisibleRows()
 }
 
 void PacketListModel::clear() {
+    clearSortValues();
     emit beginResetModel();
     qDeleteAll(physical_rows_);
     physical_rows_.resize(0);
@@ -177,6 +188,7 @@ void PacketListModel::clear() {
 
 void PacketListModel::invalidateAllColumnStrings()
 {
+    clearSortValues();
     PacketListRecord::invalidateAllRecords();
     dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1),
             QVector<int>() << Qt::DisplayRole);
@@ -185,6 +197,7 @@ void PacketListModel::invalidateAllColumnStrings()
 void PacketListModel::resetColumns()
 {
     if (cap_file_) {
+        clearSortValues();
         emit beginResetModel();
         PacketListRecord::resetColumns(&cap_file_->cinfo);
         emit endResetModel();
@@ -299,6 +312,7 @@ void PacketListModel::toggleFrameRefTime(const QModelIndex &rt_index)
         fdata->ref_time=1;
         cap_file_->ref_time_count++;
     }
+    clearSortValues();
     cf_reftime_packets(cap_file_);
     if (!fdata->ref_time && !fdata->passed_dfilter) {
         cap_file_->displayed_count--;
@@ -320,6 +334,7 @@ void PacketListModel::unsetAllFrameRefTime()
         }
     }
     cap_file_->ref_time_count = 0;
+    clearSortValues();
     cf_reftime_packets(cap_file_);
     PacketListRecord::resetColumns(&cap_file_->cinfo);
     emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
@@ -334,62 +349,225 @@ void PacketListModel::setMaximumRowHeight(int height)
     emit dataChanged(index(0, 0), index(0, columnCount() - 1));
 }
 
-int PacketListModel::sort_column_;
-int PacketListModel::sort_column_is_numeric_;
-int PacketListModel::text_sort_column_;
-Qt::SortOrder PacketListModel::sort_order_;
-capture_file *PacketListModel::sort_cap_file_;
-
 QElapsedTimer busy_timer_;
 const int busy_timeout_ = 65; // ms, approximately 15 fps
+
+// Rows sorted by each thread before the sorted runs are merged. Small
+// enough that a cancelled sort stops quickly.
+static const int sort_chunk_size_ = 64 * 1024;
+
+// Sorts or merges part of the rows on a sort thread.
+class PacketListSortTask : public QRunnable
+{
+public:
+    PacketListSortTask(const PacketListModel *model, PacketListRecord **first, PacketListRecord **middle, PacketListRecord **last) :
+        model_(model),
+        first_(first),
+        middle_(middle),
+        last_(last)
+    {}
+
+    void run() {
+        if (model_->sort_cancelled_.load()) return;
+
+        if (middle_ == first_) {
+            std::sort(first_, last_, LessThan(model_));
+        } else {
+            std::inplace_merge(first_, middle_, last_, LessThan(model_));
+        }
+    }
+
+private:
+    struct LessThan {
+        LessThan(const PacketListModel *model) : model_(model) {}
+        bool operator()(PacketListRecord *r1, PacketListRecord *r2) const {
+            return model_->recordLessThan(r1, r2);
+        }
+        const PacketListModel *model_;
+    };
+
+    const PacketListModel *model_;
+    PacketListRecord **first_;
+    PacketListRecord **middle_;
+    PacketListRecord **last_;
+};
+
 void PacketListModel::sort(int column, Qt::SortOrder order)
 {
     if (!cap_file_ || visible_rows_.count() < 1) return;
     if (column < 0) return;
+    // The progress bar lets events through, including clicks on the header.
+    if (sorting_) return;
 
     sort_column_ = column;
     text_sort_column_ = PacketListRecord::textColumn(column);
     sort_order_ = order;
     sort_cap_file_ = cap_file_;
+    sort_column_is_numeric_ = isNumericColumn(sort_column_);
 
     QString col_title = get_column_title(column);
 
-    // XXX Use updateProgress instead. We'd have to switch from std::sort to
-    // something we can interrupt.
     if (!col_title.isEmpty()) {
         QString busy_msg = tr("Sorting \"%1\"").arg(col_title);
         wsApp->pushStatus(WiresharkApplication::BusyStatus, busy_msg);
     }
 
+    gboolean stop_flag = FALSE;
+    progdlg_t *progbar = delayed_create_progress_dlg(cap_file_->window, NULL, NULL, TRUE, &stop_flag, 0.0f);
+
+    // Packets can be appended while we sort. They stay at the end.
+    QVector<PacketListRecord *> sorted_rows = physical_rows_;
+    bool sorted;
+
+    sorting_ = true;
+    sort_cancelled_ = 0;
     busy_timer_.start();
-    sort_column_is_numeric_ = isNumericColumn(sort_column_);
-    std::sort(physical_rows_.begin(), physical_rows_.end(), recordLessThan);
+    sorted = (text_sort_column_ < 0 || cacheSortValues(sorted_rows, progbar, &stop_flag)) &&
+            sortRecords(sorted_rows, progbar, &stop_flag);
+    sorting_ = false;
 
-    emit beginResetModel();
-    visible_rows_.resize(0);
-    number_to_row_.fill(0);
-    foreach (PacketListRecord *record, physical_rows_) {
-        frame_data *fdata = record->frameData();
+    if (progbar) {
+        destroy_progress_dlg(progbar);
+    }
 
-        if (fdata->passed_dfilter || fdata->ref_time) {
-            visible_rows_ << record;
-            if (number_to_row_.size() <= (int)fdata->num) {
-                number_to_row_.resize(fdata->num + 10000);
+    // If the sort was stopped, leave the rows as they were.
+    if (sorted) {
+        sorted_rows += physical_rows_.mid(sorted_rows.count());
+        physical_rows_ = sorted_rows;
+
+        emit beginResetModel();
+        visible_rows_.resize(0);
+        number_to_row_.fill(0);
+        foreach (PacketListRecord *record, physical_rows_) {
+            frame_data *fdata = record->frameData();
+
+            if (fdata->passed_dfilter || fdata->ref_time) {
+                visible_rows_ << record;
+                if (number_to_row_.size() <= (int)fdata->num) {
+                    number_to_row_.resize(fdata->num + 10000);
+                }
+                number_to_row_[fdata->num] = visible_rows_.count();
             }
-            number_to_row_[fdata->num] = visible_rows_.count();
         }
+        emit endResetModel();
     }
-    emit endResetModel();
 
     if (!col_title.isEmpty()) {
         wsApp->popStatus(WiresharkApplication::BusyStatus);
     }
 
-    if (cap_file_->current_frame) {
+    if (sorted && cap_file_ && cap_file_->current_frame) {
         emit goToPacket(cap_file_->current_frame->num);
     }
 }
 
+// Getting a column's strings means dissecting the packets, which has to
+// happen here on the main thread. It only has to happen once per column
+// though; after that the sort threads compare the cached values.
+bool PacketListModel::cacheSortValues(const QVector<PacketListRecord *> &rows, progdlg_t *progbar, gboolean *stop_flag)
+{
+    if (sort_values_column_ != sort_column_) {
+        sort_values_.clear();
+        sort_values_column_ = sort_column_;
+    }
+
+    int count = rows.count();
+    for (int i = 0; i < count; i++) {
+        PacketListRecord *record = rows[i];
+        int num = (int) record->frameData()->num;
+
+        if (sort_values_.size() <= num) {
+            sort_values_.resize(num + 10000);
+        }
+        SortValue &value = sort_values_[num];
+        if (!value.cached) {
+            value.text = record->columnString(sort_cap_file_, sort_column_);
+            if (sort_column_is_numeric_) {
+                value.number = parseNumericColumn(value.text, &value.numeric);
+            }
+            value.cached = true;
+        }
+
+        if (busy_timer_.elapsed() > busy_timeout_) {
+            // Caching is the first half of the progress bar.
+            update_progress_dlg(progbar, (float) i / count / 2, NULL);
+            busy_timer_.restart();
+            if (*stop_flag || sort_cancelled_.load()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Sort chunks of the rows on the sort threads, then merge pairs of sorted
+// chunks until there is only one left.
+bool PacketListModel::sortRecords(QVector<PacketListRecord *> &rows, progdlg_t *progbar, gboolean *stop_flag)
+{
+    int count = rows.count();
+    int chunk_size = qMax(1, qMin(sort_chunk_size_, count / qMax(1, QThread::idealThreadCount())));
+    PacketListRecord **first = rows.data();
+    QVector<int> bounds;
+
+    for (int pos = 0; pos < count; pos += chunk_size) {
+        bounds << pos;
+        sort_pool_.start(new PacketListSortTask(this, first + pos, first + pos, first + qMin(pos + chunk_size, count)));
+    }
+    bounds << count;
+
+    int levels = 1;
+    for (int runs = bounds.count() - 1; runs > 1; runs = (runs + 1) / 2) {
+        levels++;
+    }
+
+    int level = 0;
+    while (true) {
+        // Sorting is the second half of the progress bar.
+        if (!waitForSortThreads(progbar, stop_flag, 0.5f + 0.5f * level / levels)) {
+            return false;
+        }
+        if (bounds.count() <= 2) {
+            break;
+        }
+
+        QVector<int> merged_bounds;
+        for (int i = 0; i + 1 < bounds.count(); i += 2) {
+            merged_bounds << bounds[i];
+            if (i + 2 < bounds.count()) {
+                sort_pool_.start(new PacketListSortTask(this, first + bounds[i], first + bounds[i + 1], first + bounds[i + 2]));
+            }
+        }
+        merged_bounds << count;
+        bounds = merged_bounds;
+        level++;
+    }
+    return true;
+}
+
+bool PacketListModel::waitForSortThreads(progdlg_t *progbar, gboolean *stop_flag, float progress)
+{
+    while (!sort_pool_.waitForDone(busy_timeout_)) {
+        update_progress_dlg(progbar, progress, NULL);
+        if (*stop_flag) {
+            // The tasks that haven't started yet won't do anything.
+            sort_cancelled_ = 1;
+        }
+    }
+    return !sort_cancelled_.load();
+}
+
+// Must be called before anything that changes the column strings, and
+// before the records go away.
+void PacketListModel::clearSortValues()
+{
+    if (sorting_) {
+        sort_cancelled_ = 1;
+        sort_pool_.waitForDone();
+    }
+    sort_values_.clear();
+    sort_values_column_ = -1;
+}
+
 bool PacketListModel::isNumericColumn(int column)
 {
     if (column < 0) {
@@ -457,7 +635,7 @@ bool PacketListModel::isNumericColumn(int column)
     return true;
 }
 
-bool PacketListModel::recordLessThan(PacketListRecord *r1, PacketListRecord *r2)
+bool PacketListModel::recordLessThan(PacketListRecord *r1, PacketListRecord *r2) const
 {
     int cmp_val = 0;
 
@@ -465,12 +643,8 @@ bool PacketListModel::recordLessThan(PacketListRecord *r1, PacketListRecord *r2)
     // _packet_list_compare_records, and packet_list_compare_custom from
     // gtk/packet_list_store.c into one function
 
-    if (busy_timer_.elapsed() > busy_timeout_) {
-        // What's the least amount of processing that we can do which will draw
-        // the busy indicator?
-        wsApp->processEvents(QEventLoop::ExcludeUserInputEvents | QEventLoop::ExcludeSocketNotifiers, 1);
-        busy_timer_.restart();
-    }
+    // This runs on the sort threads, so it mustn't dissect anything;
+    // cacheSortValues() has already done that.
     if (sort_column_ < 0) {
         // No column.
         cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), COL_NUMBER);
@@ -478,27 +652,24 @@ bool PacketListModel::recordLessThan(PacketListRecord *r1, PacketListRecord *r2)
         // Column comes directly from frame data
         cmp_val = frame_data_compare(sort_cap_file_->epan, r1->frameData(), r2->frameData(), sort_cap_file_->cinfo.columns[sort_column_].col_fmt);
     } else  {
-        if (r1->columnString(sort_cap_file_, sort_column_).constData() == r2->columnString(sort_cap_file_, sort_column_).constData()) {
+        const SortValue &v1 = sort_values_.at(r1->frameData()->num);
+        const SortValue &v2 = sort_values_.at(r2->frameData()->num);
+
+        if (v1.text.constData() == v2.text.constData()) {
             cmp_val = 0;
         } else if (sort_column_is_numeric_) {
             // Custom column with numeric data (or something like a port number).
-            // Attempt to convert to numbers.
-            // XXX This is slow. Can we avoid doing this?
-            bool ok_r1, ok_r2;
-            double num_r1 = parseNumericColumn(r1->columnString(sort_cap_file_, sort_column_), &ok_r1);
-            double num_r2 = parseNumericColumn(r2->columnString(sort_cap_file_, sort_column_), &ok_r2);
-
-            if (!ok_r1 && !ok_r2) {
+            if (!v1.numeric && !v2.numeric) {
                 cmp_val = 0;
-            } else if (!ok_r1 || (ok_r2 && num_r1 < num_r2)) {
+            } else if (!v1.numeric || (v2.numeric && v1.number < v2.number)) {
                 // either r1 is invalid (and sort it before others) or both
                 // r1 and r2 are valid (sort normally)
                 cmp_val = -1;
-            } else if (!ok_r2 || (ok_r1 && num_r1 > num_r2)) {
+            } else if (!v2.numeric || (v1.numeric && v1.number > v2.number)) {
                 cmp_val = 1;
             }
         } else {
-            cmp_val = r1->columnString(sort_cap_file_, sort_column_).compare(r2->columnString(sort_cap_file_, sort_column_));
+            cmp_val = v1.text.compare(v2.text);
         }
 
         if (cmp_val == 0) {
@@ -19,13 +19,17 @@
 #include <epan/packet.h>
 
 #include <QAbstractItemModel>
+#include <QAtomicInt>
 #include <QFont>
+#include <QThreadPool>
 #include <QVector>
 
 #include "packet_list_record.h"
 
 #include "cfile.h"
 
+#include "ui/progress_dlg.h"
+
 class QElapsedTimer;
 
 class PacketListModel : public QAbstractItemModel
@@ -93,13 +97,36 @@ private:
     int max_row_height_; // px
     int max_line_count_;
 
-    static int sort_column_;
-    static int sort_column_is_numeric_;
-    static int text_sort_column_;
-    static Qt::SortOrder sort_order_;
-    static capture_file *sort_cap_file_;
-    static bool recordLessThan(PacketListRecord *r1, PacketListRecord *r2);
+    // A column's value for sorting. Numeric columns are converted once,
+    // when the value is cached, instead of on every comparison.
+    struct SortValue {
+        SortValue() : cached(false), numeric(false), number(0.0) {}
+        bool cached;
+        bool numeric;
+        double number;
+        QString text;
+    };
+
+    int sort_column_;
+    bool sort_column_is_numeric_;
+    int text_sort_column_;
+    Qt::SortOrder sort_order_;
+    capture_file *sort_cap_file_;
+    // Sort values for sort_values_column_, indexed by frame number.
+    QVector<SortValue> sort_values_;
+    int sort_values_column_;
+    bool sorting_;
+    QAtomicInt sort_cancelled_;
+    QThreadPool sort_pool_;
+
+    bool recordLessThan(PacketListRecord *r1, PacketListRecord *r2) const;
     static double parseNumericColumn(const QString &val, bool *ok);
+    bool cacheSortValues(const QVector<PacketListRecord *> &rows, progdlg_t *progbar, gboolean *stop_flag);
+    bool sortRecords(QVector<PacketListRecord *> &rows, progdlg_t *progbar, gboolean *stop_flag);
+    bool waitForSortThreads(progdlg_t *progbar, gboolean *stop_flag, float progress);
+    void clearSortValues();
+
+    friend class PacketListSortTask;
 
     QElapsedTimer *idle_dissection_timer_;
     int idle_dissection_row_;
@@ -738,6 +738,24 @@ heuristic_uses_extension(unsigned int i, const char *extension)
 	return FALSE;	/* it's not one of them */
 }
 
+/* Whether to save a seek index for compressed files we read to the end. */
+static gboolean save_seek_index = FALSE;
+
+void
+wtap_set_save_seek_index(gboolean save)
+{
+	save_seek_index = save;
+}
+
+/* Whether to save a time index for pcap and pcapng files we read to the end. */
+static gboolean save_time_index = FALSE;
+
+void
+wtap_set_save_time_index(gboolean save)
+{
+	save_time_index = save;
+}
+
 /* Opens a file and prepares a wtap struct.
    If "do_random" is TRUE, it opens the file twice; the second open
    allows the application to do random-access I/O without moving
@@ -891,6 +909,23 @@ wtap_open_offline(const char *filename, unsigned int type, int *err, char **err_
 
 		file_set_random_access(wth->fh, FALSE, wth->fast_seek);
 		file_set_random_access(wth->random_fh, TRUE, wth->fast_seek);
+
+		/*
+		 * If there's an up-to-date seek index for the file, we
+		 * can seek anywhere in it right away; otherwise, we'll
+		 * build the fast seek points as we read it, and, if
+		 * asked to, save them when we reach the end.
+		 */
+		if (!file_seek_index_load(wth->fh, filename) && save_seek_index)
+			wth->seek_index_path = g_strdup(filename);
+	} else if (save_seek_index && !use_stdin && !ispipe) {
+		/*
+		 * We won't be seeking, but collect the fast seek points
+		 * anyway so that they can be saved for later opens.
+		 */
+		wth->fast_seek = g_ptr_array_new();
+		file_set_random_access(wth->fh, FALSE, wth->fast_seek);
+		wth->seek_index_path = g_strdup(filename);
 	}
 
 	/* 'type' is 1 greater than the array index */
@@ -1162,6 +1197,18 @@ success:
 		g_array_append_val(wth->interface_data, descr);
 
 	}
+
+	/*
+	 * Only the formats whose read routines return the offset of the
+	 * record, and can be seeked into at it, get time indexes.
+	 */
+	if (save_time_index && !use_stdin && !ispipe &&
+	    (wth->file_type_subtype == WTAP_FILE_TYPE_SUBTYPE_PCAP ||
+	     wth->file_type_subtype == WTAP_FILE_TYPE_SUBTYPE_PCAP_NSEC ||
+	     wth->file_type_subtype == WTAP_FILE_TYPE_SUBTYPE_PCAPNG)) {
+		wth->time_index_builder = time_index_builder_new(0);
+		wth->time_index_path = g_strdup(filename);
+	}
 	return wth;
 }
 
@@ -2241,7 +2288,7 @@ wtap_dump_can_open(int file_type_subtype)
 	return TRUE;
 }
 
-#ifdef HAVE_ZLIB
+#if defined(HAVE_ZLIB) || defined(HAVE_ZSTD) || defined(HAVE_LZ4FRAME_H)
 gboolean
 wtap_dump_can_compress(int file_type_subtype)
 {
@@ -2317,6 +2364,13 @@ wtap_dump_init_dumper(int file_type_subtype, wtap_compression_type compression_t
 	    (compression_type != WTAP_UNCOMPRESSED), err))
 		return NULL;
 
+	/* Check whether this build can write that type of compression. */
+	if (compression_type != WTAP_UNCOMPRESSED &&
+	    wtap_compression_type_extension(compression_type) == NULL) {
+		*err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
+		return NULL;
+	}
+
 	/* Allocate a data structure for the output stream. */
 	wdh = wtap_dump_alloc_wdh(file_type_subtype, params->encap,
 	    params->snaplen, compression_type, err);
@@ -2664,13 +2718,25 @@ wtap_dump(wtap_dumper *wdh, const wtap_rec *rec,
 void
 wtap_dump_flush(wtap_dumper *wdh)
 {
+	switch (wdh->compression_type) {
 #ifdef HAVE_ZLIB
-	if (wdh->compression_type == WTAP_GZIP_COMPRESSED) {
+	case WTAP_GZIP_COMPRESSED:
 		gzwfile_flush((GZWFILE_T)wdh->fh);
-	} else
+		break;
 #endif
-	{
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		zstdwfile_flush((ZSTDWFILE_T)wdh->fh);
+		break;
+#endif
+#ifdef HAVE_LZ4FRAME_H
+	case WTAP_LZ4_COMPRESSED:
+		lz4wfile_flush((LZ4WFILE_T)wdh->fh);
+		break;
+#endif
+	default:
 		fflush((FILE *)wdh->fh);
+		break;
 	}
 }
 
@@ -2759,42 +2825,48 @@ gboolean wtap_dump_get_needs_reload(wtap_dumper *wdh) {
 }
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_ZLIB
 static WFILE_T
 wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
 {
-	if (wdh->compression_type == WTAP_GZIP_COMPRESSED) {
+	switch (wdh->compression_type) {
+#ifdef HAVE_ZLIB
+	case WTAP_GZIP_COMPRESSED:
 		return gzwfile_open(filename);
-	} else {
+#endif
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return zstdwfile_open(filename);
+#endif
+#ifdef HAVE_LZ4FRAME_H
+	case WTAP_LZ4_COMPRESSED:
+		return lz4wfile_open(filename);
+#endif
+	default:
 		return ws_fopen(filename, "wb");
 	}
 }
-#else
-static WFILE_T
-wtap_dump_file_open(wtap_dumper *wdh _U_, const char *filename)
-{
-	return ws_fopen(filename, "wb");
-}
-#endif
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_ZLIB
 static WFILE_T
 wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
 {
-	if (wdh->compression_type == WTAP_GZIP_COMPRESSED) {
+	switch (wdh->compression_type) {
+#ifdef HAVE_ZLIB
+	case WTAP_GZIP_COMPRESSED:
 		return gzwfile_fdopen(fd);
-	} else {
+#endif
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return zstdwfile_fdopen(fd);
+#endif
+#ifdef HAVE_LZ4FRAME_H
+	case WTAP_LZ4_COMPRESSED:
+		return lz4wfile_fdopen(fd);
+#endif
+	default:
 		return ws_fdopen(fd, "wb");
 	}
 }
-#else
-static WFILE_T
-wtap_dump_file_fdopen(wtap_dumper *wdh _U_, int fd)
-{
-	return ws_fdopen(fd, "wb");
-}
-#endif
 
 /* internally writing raw bytes (compressed or not) */
 gboolean
@@ -2802,8 +2874,9 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 {
 	size_t nwritten;
 
+	switch (wdh->compression_type) {
 #ifdef HAVE_ZLIB
-	if (wdh->compression_type == WTAP_GZIP_COMPRESSED) {
+	case WTAP_GZIP_COMPRESSED:
 		nwritten = gzwfile_write((GZWFILE_T)wdh->fh, buf, (unsigned int) bufsize);
 		/*
 		 * gzwfile_write() returns 0 on error.
@@ -2812,9 +2885,27 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 			*err = gzwfile_geterr((GZWFILE_T)wdh->fh);
 			return FALSE;
 		}
-	} else
+		break;
 #endif
-	{
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		nwritten = zstdwfile_write((ZSTDWFILE_T)wdh->fh, buf, (unsigned int) bufsize);
+		if (nwritten == 0) {
+			*err = zstdwfile_geterr((ZSTDWFILE_T)wdh->fh);
+			return FALSE;
+		}
+		break;
+#endif
+#ifdef HAVE_LZ4FRAME_H
+	case WTAP_LZ4_COMPRESSED:
+		nwritten = lz4wfile_write((LZ4WFILE_T)wdh->fh, buf, (unsigned int) bufsize);
+		if (nwritten == 0) {
+			*err = lz4wfile_geterr((LZ4WFILE_T)wdh->fh);
+			return FALSE;
+		}
+		break;
+#endif
+	default:
 		errno = WTAP_ERR_CANT_WRITE;
 		nwritten = fwrite(buf, 1, bufsize, (FILE *)wdh->fh);
 		/*
@@ -2828,6 +2919,7 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 				*err = WTAP_ERR_SHORT_WRITE;
 			return FALSE;
 		}
+		break;
 	}
 	return TRUE;
 }
@@ -2836,23 +2928,31 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 static int
 wtap_dump_file_close(wtap_dumper *wdh)
 {
+	switch (wdh->compression_type) {
 #ifdef HAVE_ZLIB
-	if (wdh->compression_type == WTAP_GZIP_COMPRESSED)
+	case WTAP_GZIP_COMPRESSED:
 		return gzwfile_close((GZWFILE_T)wdh->fh);
-	else
 #endif
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return zstdwfile_close((ZSTDWFILE_T)wdh->fh);
+#endif
+#ifdef HAVE_LZ4FRAME_H
+	case WTAP_LZ4_COMPRESSED:
+		return lz4wfile_close((LZ4WFILE_T)wdh->fh);
+#endif
+	default:
 		return fclose((FILE *)wdh->fh);
+	}
 }
 
 gint64
 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err)
 {
-#ifdef HAVE_ZLIB
 	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
-#endif
 	{
 		if (-1 == ws_fseek64((FILE *)wdh->fh, offset, whence)) {
 			*err = errno;
@@ -2868,12 +2968,10 @@ gint64
 wtap_dump_file_tell(wtap_dumper *wdh, int *err)
 {
 	gint64 rval;
-#ifdef HAVE_ZLIB
 	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
-#endif
 	{
 		if (-1 == (rval = ws_ftell64((FILE *)wdh->fh))) {
 			*err = errno;
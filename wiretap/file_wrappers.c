@@ -21,12 +21,25 @@
 #include "wtap-int.h"
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 #ifdef HAVE_ZLIB
 #define ZLIB_CONST
 #include <zlib.h>
 #endif /* HAVE_ZLIB */
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4FRAME_H
+#include <lz4frame.h>
+#endif /* HAVE_LZ4FRAME_H */
+
 /*
  * See RFC 1952:
  *
@@ -34,6 +47,18 @@
  *
  * for a description of the gzip file format.
  *
+ * See RFC 8878:
+ *
+ *      https://tools.ietf.org/html/rfc8878
+ *
+ * for a description of the Zstandard file format, and
+ *
+ *      https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+ *
+ * for a description of the LZ4 frame format.  Both formats consist
+ * of a sequence of independently-decompressible frames; we use the
+ * start of each frame as a fast seek point.
+ *
  * Some other compressed file formats we might want to support:
  *
  *      XZ format: https://tukaani.org/xz/
@@ -53,6 +78,12 @@ static struct compression_type {
 } compression_types[] = {
 #ifdef HAVE_ZLIB
     { WTAP_GZIP_COMPRESSED, "gz", "gzip compressed" },
+#endif
+#ifdef HAVE_ZSTD
+    { WTAP_ZSTD_COMPRESSED, "zst", "zstd compressed" },
+#endif
+#ifdef HAVE_LZ4FRAME_H
+    { WTAP_LZ4_COMPRESSED, "lz4", "lz4 compressed" },
 #endif
     { WTAP_UNCOMPRESSED, NULL, NULL }
 };
@@ -60,10 +91,7 @@ static struct compression_type {
 wtap_compression_type
 wtap_get_compression_type(wtap *wth)
 {
-	gboolean is_compressed;
-
-	is_compressed = file_iscompressed((wth->fh == NULL) ? wth->random_fh : wth->fh);
-	return is_compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED;
+	return file_get_compression_type((wth->fh == NULL) ? wth->random_fh : wth->fh);
 }
 
 const char *
@@ -111,7 +139,13 @@ typedef enum {
     UNCOMPRESSED,  /* uncompressed - copy input directly */
 #ifdef HAVE_ZLIB
     ZLIB,          /* decompress a zlib stream */
-    GZIP_AFTER_HEADER
+    GZIP_AFTER_HEADER,
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD,          /* decompress a zstd frame */
+#endif
+#ifdef HAVE_LZ4FRAME_H
+    LZ4,           /* decompress an lz4 frame */
 #endif
 } compression_t;
 
@@ -135,6 +169,7 @@ struct wtap_reader {
     gint64 raw;                 /* where the raw data started, for seeking */
     compression_t compression;  /* type of compression, if any */
     gboolean is_compressed;     /* FALSE if completely uncompressed, TRUE otherwise */
+    wtap_compression_type compression_type; /* type of the last compressed data seen */
 
     /* seek request */
     gint64 skip;                /* amount to skip (already rewound if backwards) */
@@ -148,10 +183,23 @@ struct wtap_reader {
     /* zlib inflate stream */
     z_stream strm;              /* stream structure in-place (not a pointer) */
     gboolean dont_check_crc;    /* TRUE if we aren't supposed to check the CRC */
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstd_dctx;    /* zstd decompression stream, allocated on first use */
+#endif
+#ifdef HAVE_LZ4FRAME_H
+    LZ4F_decompressionContext_t lz4_dctx; /* lz4 decompression context, allocated on first use */
 #endif
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+
+    /* memory-mapped reading */
+    gboolean map_wanted;        /* TRUE if we should map the file once we know it's uncompressed */
+    gboolean mapped;            /* TRUE if the output buffer is a window on the mapping */
+    guint8 *map;                /* the mapped file, or NULL; kept until the file is closed */
+    gint64 map_size;            /* size of the mapping */
+    guint8 *map_saved_buf;      /* our own output buffer, while we're using the mapping */
 };
 
 /* Current read offset within a buffer. */
@@ -240,6 +288,28 @@ fill_in_buffer(FILE_T state)
     return 0;
 }
 
+/* Make sure at least min bytes are available in the input buffer,
+   unless we reach the end of the file first.  Unlike fill_in_buffer(),
+   this never discards unread input; if there's no room left after it,
+   the unread input is moved to the beginning of the buffer. */
+static int
+fill_in_buffer_min(FILE_T state, guint min)
+{
+    while (state->in.avail < min) {
+        if (state->err != 0)
+            return -1;
+        if (state->eof)
+            break;
+        if (state->in.next != state->in.buf) {
+            memmove(state->in.buf, state->in.next, state->in.avail);
+            state->in.next = state->in.buf;
+        }
+        if (buf_read(state, &state->in) < 0)
+            return -1;
+    }
+    return 0;
+}
+
 #define ZLIB_WINSIZE 32768
 
 struct fast_seek_point {
@@ -642,6 +712,217 @@ DIAG_ON(cast-qual)
 }
 #endif
 
+/*
+ * Magic numbers at the beginning of a zstd frame, an lz4 frame, and
+ * a skippable frame (which both formats share; the low 4 bits of the
+ * first byte can have any value), all little-endian.
+ */
+static const guint8 zstd_magic[4] = { 0x28, 0xB5, 0x2F, 0xFD };
+static const guint8 lz4_magic[4] = { 0x04, 0x22, 0x4D, 0x18 };
+static const guint8 skippable_magic[3] = { 0x2A, 0x4D, 0x18 };
+
+#ifdef HAVE_ZSTD
+/* Set up to decompress a zstd frame starting at the current input
+   position.  Return -1, and set state->err, on failure. */
+static int
+zstd_init(FILE_T state)
+{
+    size_t ret;
+
+    if (state->zstd_dctx == NULL) {
+        state->zstd_dctx = ZSTD_createDStream();
+        if (state->zstd_dctx == NULL) {
+            state->err = ENOMEM;
+            state->err_info = NULL;
+            return -1;
+        }
+    }
+    ret = ZSTD_initDStream(state->zstd_dctx);
+    if (ZSTD_isError(ret)) {
+        state->err = WTAP_ERR_DECOMPRESS;
+        state->err_info = ZSTD_getErrorName(ret);
+        return -1;
+    }
+    state->compression = ZSTD;
+    return 0;
+}
+
+static void
+zstd_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    ZSTD_outBuffer output = { buf, count, 0 };
+    ZSTD_inBuffer input;
+    size_t ret;
+
+    /* fill output buffer up to end of frame or error */
+    while (output.pos < output.size) {
+        /* get more input */
+        if (state->in.avail == 0 && fill_in_buffer(state) == -1)
+            break;
+        if (state->in.avail == 0) {
+            /* EOF */
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            break;
+        }
+
+        input.src = state->in.next;
+        input.size = state->in.avail;
+        input.pos = 0;
+        ret = ZSTD_decompressStream(state->zstd_dctx, &output, &input);
+        state->in.next += input.pos;
+        state->in.avail -= (guint)input.pos;
+        if (ZSTD_isError(ret)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = ZSTD_getErrorName(ret);
+            break;
+        }
+        if (ret == 0) {
+            /* end of frame; look for another one */
+            state->compression = UNKNOWN;
+            break;
+        }
+    }
+
+    state->out.next = buf;
+    state->out.avail = (guint)output.pos;
+}
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4FRAME_H
+/* Set up to decompress an lz4 frame starting at the current input
+   position.  Return -1, and set state->err, on failure. */
+static int
+lz4_init(FILE_T state)
+{
+    LZ4F_errorCode_t ret;
+
+    /* Older versions of liblz4 have no way to reset a decompression
+       context that was left in the middle of a frame, so just start
+       with a new one. */
+    if (state->lz4_dctx != NULL) {
+        LZ4F_freeDecompressionContext(state->lz4_dctx);
+        state->lz4_dctx = NULL;
+    }
+    ret = LZ4F_createDecompressionContext(&state->lz4_dctx, LZ4F_VERSION);
+    if (LZ4F_isError(ret)) {
+        state->lz4_dctx = NULL;
+        state->err = WTAP_ERR_DECOMPRESS;
+        state->err_info = LZ4F_getErrorName(ret);
+        return -1;
+    }
+    state->compression = LZ4;
+    return 0;
+}
+
+static void
+lz4_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+    unsigned int have = 0;
+    size_t in_size, out_size;
+    size_t ret;
+
+    /* fill output buffer up to end of frame or error */
+    while (have < count) {
+        /* get more input */
+        if (state->in.avail == 0 && fill_in_buffer(state) == -1)
+            break;
+        if (state->in.avail == 0) {
+            /* EOF */
+            state->err = WTAP_ERR_SHORT_READ;
+            state->err_info = NULL;
+            break;
+        }
+
+        in_size = state->in.avail;
+        out_size = count - have;
+        ret = LZ4F_decompress(state->lz4_dctx, buf + have, &out_size,
+                              state->in.next, &in_size, NULL);
+        state->in.next += in_size;
+        state->in.avail -= (guint)in_size;
+        have += (unsigned int)out_size;
+        if (LZ4F_isError(ret)) {
+            state->err = WTAP_ERR_DECOMPRESS;
+            state->err_info = LZ4F_getErrorName(ret);
+            break;
+        }
+        if (ret == 0) {
+            /* end of frame; look for another one */
+            state->compression = UNKNOWN;
+            break;
+        }
+    }
+
+    state->out.next = buf;
+    state->out.avail = have;
+}
+#endif /* HAVE_LZ4FRAME_H */
+
+/* Check for the start of a zstd or lz4 frame at the current input
+   position and, if we find one, set up to decompress it, leaving the
+   frame header in the input buffer for the decompressor.  Return 1
+   if we found one, 0 if we didn't, and -1, with state->err set, on
+   error. */
+static int
+frame_head(FILE_T state)
+{
+    wtap_compression_type type;
+    gint64 in_pos;
+
+    if (fill_in_buffer_min(state, 4) == -1)
+        return -1;
+    if (state->in.avail < 4)
+        return 0;
+
+    if (memcmp(state->in.next, zstd_magic, 4) == 0)
+        type = WTAP_ZSTD_COMPRESSED;
+    else if (memcmp(state->in.next, lz4_magic, 4) == 0)
+        type = WTAP_LZ4_COMPRESSED;
+    else if ((state->in.next[0] & 0xF0) == 0x50 &&
+             memcmp(state->in.next + 1, skippable_magic, 3) == 0 &&
+             state->is_compressed &&
+             state->compression_type != WTAP_GZIP_COMPRESSED) {
+        /* A skippable frame after zstd or lz4 data, such as the seek
+           table of the zstd seekable format; both decompressors know
+           how to skip it. */
+        type = state->compression_type;
+    } else
+        return 0;
+
+    in_pos = state->raw_pos - state->in.avail;
+    switch (type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        if (zstd_init(state) == -1)
+            return -1;
+        break;
+#endif
+
+#ifdef HAVE_LZ4FRAME_H
+    case WTAP_LZ4_COMPRESSED:
+        if (lz4_init(state) == -1)
+            return -1;
+        break;
+#endif
+
+    default:
+        state->err = WTAP_ERR_DECOMPRESSION_NOT_SUPPORTED;
+        state->err_info = (type == WTAP_ZSTD_COMPRESSED) ?
+            "reading zstd-compressed files isn't supported" :
+            "reading lz4-compressed files isn't supported";
+        return -1;
+    }
+    state->is_compressed = TRUE;
+    state->compression_type = type;
+
+    /* Each frame can be decompressed without reference to any earlier
+       ones, so the start of the frame is all we need to seek to. */
+    if (state->fast_seek)
+        fast_seek_header(state, in_pos, state->pos, state->compression);
+    return 1;
+}
+
 static int
 gz_head(FILE_T state)
 {
@@ -767,6 +1048,7 @@ gz_head(FILE_T state)
                 state->strm.adler = crc32(0L, Z_NULL, 0);
                 state->compression = ZLIB;
                 state->is_compressed = TRUE;
+                state->compression_type = WTAP_GZIP_COMPRESSED;
 #ifdef Z_BLOCK
                 if (state->fast_seek) {
                     struct zlib_cur_seek_point *cur = g_new(struct zlib_cur_seek_point,1);
@@ -804,6 +1086,17 @@ gz_head(FILE_T state)
             state->in.next--;
         }
     }
+
+    /* look for a zstd or lz4 frame */
+    switch (frame_head(state)) {
+
+    case -1:
+        return -1;
+
+    case 1:
+        return 0;
+    }
+
 #ifdef HAVE_LIBXZ
     /* { 0xFD, '7', 'z', 'X', 'Z', 0x00 } */
     /* FD 37 7A 58 5A 00 */
@@ -831,6 +1124,128 @@ gz_head(FILE_T state)
     return 0;
 }
 
+/*
+ * Memory-mapped reading.
+ *
+ * If the caller asks for it with file_set_mapped(), and the file turns
+ * out to be an uncompressed regular file, we map the whole file and make
+ * the output buffer a window onto the mapping instead of reading into it.
+ * Everything that takes data from the output buffer works unchanged, and
+ * file_read_mapped() can hand out pointers into the mapping instead of
+ * copying the data.  The window is at most MAP_WINDOW bytes long, as the
+ * number of bytes available in a buffer is an unsigned int.
+ *
+ * Pointers into the mapping must stay valid until the file is closed, so
+ * if we stop using the mapping (because the file has grown since we
+ * mapped it, or because the caller no longer wants it), we go back to
+ * reading into our own buffer but don't unmap the file until file_close().
+ *
+ * If the file is truncated while it's mapped, touching the pages past
+ * its new end gets a SIGBUS, so this should only be asked for by callers
+ * reading files that aren't being rewritten underneath them.
+ */
+#define MAP_WINDOW  (1U << 30)
+
+#ifdef HAVE_MMAP
+/* Make the output buffer a window on the mapping, starting at pos. */
+static void
+map_set_window(FILE_T state, gint64 pos)
+{
+    gint64 left;
+
+    left = state->map_size - (state->start + pos);
+    if (left < 0)
+        left = 0;
+    state->pos = pos;
+    /* The mapping is read-only, but nothing writes into the output
+       buffer of an uncompressed file once we've found it's uncompressed. */
+    state->out.buf = state->map + (state->map_size - left);
+    state->out.next = state->out.buf;
+    state->out.avail = left > MAP_WINDOW ? MAP_WINDOW : (guint)left;
+}
+
+/* Try to switch to reading from a mapping of the file. */
+static gboolean
+map_start(FILE_T state)
+{
+    ws_statb64 statb;
+    void *map;
+
+    if (state->mapped)
+        return TRUE;
+
+    /*
+     * We can only do this for an uncompressed file, where our position
+     * in the data is the same as our position in the file (raw_pos is
+     * where we've read up to, which is past whatever's left in the
+     * output buffer), and only once; if we've given up on a mapping,
+     * it's still around for the pointers we handed out.
+     */
+    if (state->compression != UNCOMPRESSED || state->is_compressed ||
+        state->raw_pos - state->out.avail - state->pos != state->start ||
+        state->map != NULL || state->fd == -1)
+        return FALSE;
+
+    if (ws_fstat64(state->fd, &statb) == -1 || !S_ISREG(statb.st_mode) ||
+        statb.st_size <= state->start || (guint64)statb.st_size > G_MAXSIZE)
+        return FALSE;
+    map = mmap(NULL, (size_t)statb.st_size, PROT_READ, MAP_SHARED, state->fd, 0);
+    if (map == MAP_FAILED)
+        return FALSE;
+
+    state->map = (guint8 *)map;
+    state->map_size = statb.st_size;
+    state->map_saved_buf = state->out.buf;
+    state->mapped = TRUE;
+    buf_reset(&state->in);
+    map_set_window(state, state->pos);
+    return TRUE;
+}
+
+/* Go back to reading into our own buffer, from the current position. */
+static void
+map_stop(FILE_T state)
+{
+    state->mapped = FALSE;
+    state->out.buf = state->map_saved_buf;
+    state->map_saved_buf = NULL;
+    buf_reset(&state->out);
+    state->eof = FALSE;
+    state->raw_pos = state->start + state->pos;
+    if (state->fd != -1 &&
+        ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+        state->err = errno;
+        state->err_info = NULL;
+    }
+}
+
+/* Move the window on to the current position. */
+static int
+map_fill(FILE_T state)
+{
+    ws_statb64 statb;
+
+    map_set_window(state, state->pos);
+    if (state->out.avail != 0)
+        return 0;
+
+    /*
+     * We're at the end of the mapping.  If the file has grown since
+     * we mapped it, read the rest of it the usual way; otherwise,
+     * we're at the end of the file.
+     */
+    if (state->fd != -1 && ws_fstat64(state->fd, &statb) == 0 &&
+        statb.st_size > state->map_size) {
+        map_stop(state);
+        if (state->err != 0)
+            return -1;
+        return buf_read(state, &state->out);
+    }
+    state->eof = TRUE;
+    return 0;
+}
+#endif /* HAVE_MMAP */
+
 static int /* gz_make */
 fill_out_buffer(FILE_T state)
 {
@@ -841,6 +1256,12 @@ fill_out_buffer(FILE_T state)
             return 0;
     }
     if (state->compression == UNCOMPRESSED) {           /* straight copy */
+#ifdef HAVE_MMAP
+        if (state->map_wanted && !state->mapped && !map_start(state))
+            state->map_wanted = FALSE;
+        if (state->mapped)
+            return map_fill(state);
+#endif
         if (buf_read(state, &state->out) < 0)
             return -1;
     }
@@ -848,6 +1269,16 @@ fill_out_buffer(FILE_T state)
     else if (state->compression == ZLIB) {      /* decompress */
         zlib_read(state, state->out.buf, state->size << 1);
     }
+#endif
+#ifdef HAVE_ZSTD
+    else if (state->compression == ZSTD) {
+        zstd_read(state, state->out.buf, state->size << 1);
+    }
+#endif
+#ifdef HAVE_LZ4FRAME_H
+    else if (state->compression == LZ4) {
+        lz4_read(state, state->out.buf, state->size << 1);
+    }
 #endif
     return 0;
 }
@@ -945,6 +1376,7 @@ file_fdopen(int fd)
 
     /* we don't yet know whether it's compressed */
     state->is_compressed = FALSE;
+    state->compression_type = WTAP_UNCOMPRESSED;
 
     /* save the current position for rewinding (only if reading) */
     state->start = ws_lseek64(state->fd, 0, SEEK_CUR);
@@ -1065,60 +1497,474 @@ file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
     stream->fast_seek = seek;
 }
 
-gint64
-file_seek(FILE_T file, gint64 offset, int whence, int *err)
+/*
+ * Seek indexes.
+ *
+ * The fast seek points for a compressed file can be saved to a sidecar
+ * file, named by appending SEEK_INDEX_SUFFIX to the name of the capture
+ * file, so that a later open of the same file can seek to any of them
+ * without first decompressing everything before it.  The index is itself
+ * gzip-compressed, as most of it is 32K zlib windows, and consists of
+ * a header:
+ *
+ *      4 bytes         magic "WSIX"
+ *      4 bytes         format version (1)
+ *      8 bytes         size of the capture file
+ *      8 bytes         modification time of the capture file
+ *      4 bytes         number of seek points
+ *
+ * followed by the seek points:
+ *
+ *      1 byte          type of seek point (SEEK_INDEX_POINT_ values)
+ *      1 byte          number of bits from the byte before the input
+ *                      offset, for deflate points
+ *      2 bytes         reserved, zero
+ *      8 bytes         offset in the capture file
+ *      8 bytes         offset in the uncompressed data
+ *
+ * deflate points are followed by the CRC and output length of the gzip
+ * stream so far, 4 bytes each, and the 32K window.  All integers are
+ * little-endian.  The size and modification time in the header are used
+ * to notice that the capture file has changed since the index was made.
+ *
+ * We can also read the ".gzi" indexes that "bgzip -i" writes for BGZF
+ * files, which are an 8-byte count followed by pairs of 8-byte offsets
+ * of the beginning of a gzip member in the file and in the uncompressed
+ * data.  They have no header to check, so they're used only if they're
+ * at least as new as the capture file and every offset in them is the
+ * start of a BGZF block whose trailer, at the end of the block before it,
+ * gives the uncompressed size that the index says it has.
+ */
+#define SEEK_INDEX_SUFFIX   ".wsidx"
+#define SEEK_INDEX_MAGIC    "WSIX"
+#define SEEK_INDEX_VERSION  1
+#define SEEK_INDEX_HDR_LEN  28
+#define SEEK_INDEX_POINT_LEN 20
+
+#define SEEK_INDEX_POINT_UNCOMPRESSED       1
+#define SEEK_INDEX_POINT_GZIP_MEMBER        2   /* start of a gzip header */
+#define SEEK_INDEX_POINT_GZIP_AFTER_HEADER  3
+#define SEEK_INDEX_POINT_DEFLATE            4
+#define SEEK_INDEX_POINT_ZSTD               5
+#define SEEK_INDEX_POINT_LZ4                6
+
+/* Map a seek point type in an index to a compression type, returning
+   FALSE if it's unknown or we don't support it. */
+static gboolean
+seek_index_point_compression(guint8 type, compression_t *compression)
 {
-    struct fast_seek_point *here;
-    guint n;
+    switch (type) {
 
-    if (whence != SEEK_SET && whence != SEEK_CUR && whence != SEEK_END) {
-        g_assert_not_reached();
-/*
- *err = EINVAL;
- return -1;
-*/
+    case SEEK_INDEX_POINT_UNCOMPRESSED:
+        *compression = UNCOMPRESSED;
+        return TRUE;
+
+    case SEEK_INDEX_POINT_GZIP_MEMBER:
+        /* gz_head() will look at the header when we seek here */
+        *compression = UNKNOWN;
+        return TRUE;
+
+#ifdef HAVE_ZLIB
+    case SEEK_INDEX_POINT_GZIP_AFTER_HEADER:
+        *compression = GZIP_AFTER_HEADER;
+        return TRUE;
+
+    case SEEK_INDEX_POINT_DEFLATE:
+        *compression = ZLIB;
+        return TRUE;
+#endif
+
+#ifdef HAVE_ZSTD
+    case SEEK_INDEX_POINT_ZSTD:
+        *compression = ZSTD;
+        return TRUE;
+#endif
+
+#ifdef HAVE_LZ4FRAME_H
+    case SEEK_INDEX_POINT_LZ4:
+        *compression = LZ4;
+        return TRUE;
+#endif
+
+    default:
+        return FALSE;
     }
+}
 
-    /* Normalize offset to a SEEK_CUR specification */
-    if (whence == SEEK_END) {
-        /* Seek relative to the end of the file; given that we might be
-           reading from a compressed file, we do that by seeking to the
-           end of the file, making an offset relative to the end of
-           the file an offset relative to the current position.
+static void
+seek_index_free_points(GPtrArray *points)
+{
+    for (guint i = 0; i < points->len; i++)
+        g_free(points->pdata[i]);
+    g_ptr_array_free(points, TRUE);
+}
 
-           XXX - we don't actually use this yet, but, for uncompressed
-           files, we could optimize it, if desired, by directly using
-           ws_lseek64(). */
-        if (gz_skip(file, G_MAXINT64) == -1) {
-            *err = file->err;
-            return -1;
+/* Read a Wireshark seek index; returns NULL if it isn't one, or isn't for
+   this version of the capture file. */
+static GPtrArray *
+seek_index_read_wsidx(FILE_T idx, const ws_statb64 *capture_statb)
+{
+    guint8 hdr[SEEK_INDEX_HDR_LEN];
+    guint8 rec[SEEK_INDEX_POINT_LEN];
+    guint32 count;
+    GPtrArray *points;
+    struct fast_seek_point *point;
+    gint64 prev_out = -1;
+
+    if (file_read(hdr, SEEK_INDEX_HDR_LEN, idx) != SEEK_INDEX_HDR_LEN)
+        return NULL;
+    if (memcmp(hdr, SEEK_INDEX_MAGIC, 4) != 0 ||
+        pletoh32(hdr + 4) != SEEK_INDEX_VERSION ||
+        pletoh64(hdr + 8) != (guint64)capture_statb->st_size ||
+        (gint64)pletoh64(hdr + 16) != (gint64)capture_statb->st_mtime)
+        return NULL;
+    count = pletoh32(hdr + 24);
+
+    points = g_ptr_array_new();
+    while (count-- != 0) {
+        compression_t compression;
+
+        if (file_read(rec, SEEK_INDEX_POINT_LEN, idx) != SEEK_INDEX_POINT_LEN ||
+            !seek_index_point_compression(rec[0], &compression)) {
+            seek_index_free_points(points);
+            return NULL;
         }
-        if (offset == 0) {
-            /* We are done */
-            return file->pos;
+        point = g_new(struct fast_seek_point, 1);
+        point->compression = compression;
+        point->in = (gint64)pletoh64(rec + 4);
+        point->out = (gint64)pletoh64(rec + 12);
+#ifdef HAVE_ZLIB
+        if (compression == ZLIB) {
+            guint8 crc_len[8];
+
+            if (file_read(crc_len, 8, idx) != 8 ||
+                file_read(point->data.zlib.window, ZLIB_WINSIZE, idx) != ZLIB_WINSIZE) {
+                g_free(point);
+                seek_index_free_points(points);
+                return NULL;
+            }
+            point->data.zlib.adler = pletoh32(crc_len);
+            point->data.zlib.total_out = pletoh32(crc_len + 4);
+#ifdef HAVE_INFLATEPRIME
+            point->data.zlib.bits = rec[1];
+#else
+            if (rec[1] != 0) {
+                /* we can't resume in the middle of a byte; skip this one */
+                g_free(point);
+                continue;
+            }
+#endif
         }
-    } else if (whence == SEEK_SET)
-        offset -= file->pos;
-    else if (file->seek_pending) {
-        /* There's a forward-skip pending, so file->pos doesn't reflect
-           the actual file position, it represents the position from
-           which we're skipping; update the offset to include that. */
-        offset += file->skip;
+#endif
+        /* fast_seek_find() requires them to be in order */
+        if (point->out <= prev_out) {
+            g_free(point);
+            seek_index_free_points(points);
+            return NULL;
+        }
+        prev_out = point->out;
+        g_ptr_array_add(points, point);
     }
-    file->seek_pending = FALSE;
+    return points;
+}
 
-    /*
-     * Are we moving at all?
-     */
-    if (offset == 0) {
-        /* No.  Just return the current position. */
-        return file->pos;
-    }
+/* Read a BGZF index, as written by "bgzip -i". */
+static GPtrArray *
+seek_index_read_gzi(FILE_T idx)
+{
+    guint8 buf[16];
+    guint64 count;
+    GPtrArray *points;
+    struct fast_seek_point *point;
 
-    /*
-     * Are we seeking backwards?
-     */
-    if (offset < 0) {
+    if (file_read(buf, 8, idx) != 8)
+        return NULL;
+    count = pletoh64(buf);
+
+    /* the first member, at offset 0, is implicit */
+    points = g_ptr_array_new();
+    point = g_new(struct fast_seek_point, 1);
+    point->compression = UNKNOWN;
+    point->in = 0;
+    point->out = 0;
+    g_ptr_array_add(points, point);
+    while (count-- != 0) {
+        if (file_read(buf, 16, idx) != 16) {
+            seek_index_free_points(points);
+            return NULL;
+        }
+        point = g_new(struct fast_seek_point, 1);
+        point->compression = UNKNOWN;
+        point->in = (gint64)pletoh64(buf);
+        point->out = (gint64)pletoh64(buf + 8);
+        if (point->out <= ((struct fast_seek_point *)points->pdata[points->len - 1])->out) {
+            g_free(point);
+            seek_index_free_points(points);
+            return NULL;
+        }
+        g_ptr_array_add(points, point);
+    }
+    return points;
+}
+
+/*
+ * Check that the points read from a BGZF index match the capture file,
+ * which has fd open and is capture_size bytes long.
+ */
+static gboolean
+seek_index_check_gzi(int fd, gint64 capture_size, const GPtrArray *points)
+{
+    const struct fast_seek_point *prev, *point;
+    guint8 buf[4 + 14];
+
+    for (guint i = 1; i < points->len; i++) {
+        prev = (const struct fast_seek_point *)points->pdata[i - 1];
+        point = (const struct fast_seek_point *)points->pdata[i];
+        /* the block before ends with ISIZE; a block can't be empty */
+        if (point->in <= prev->in + 4 ||
+            point->in + (gint64)sizeof buf - 4 > capture_size)
+            return FALSE;
+        if (ws_lseek64(fd, point->in - 4, SEEK_SET) == -1 ||
+            ws_read(fd, buf, sizeof buf) != (int)sizeof buf)
+            return FALSE;
+        if (pletoh32(buf) != (guint32)(point->out - prev->out))
+            return FALSE;
+        /* gzip header with FEXTRA and a "BC" subfield first */
+        if (buf[4] != 31 || buf[5] != 139 || buf[6] != 8 ||
+            (buf[7] & 4) == 0 || buf[16] != 'B' || buf[17] != 'C')
+            return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean
+file_seek_index_load(FILE_T stream, const char *path)
+{
+    ws_statb64 capture_statb, idx_statb;
+    char *idx_path;
+    FILE_T idx;
+    GPtrArray *points = NULL;
+
+    /* we can only add points to an empty list, as it has to stay sorted */
+    if (stream->fast_seek == NULL || stream->fast_seek->len != 0)
+        return FALSE;
+    if (ws_fstat64(stream->fd, &capture_statb) < 0)
+        return FALSE;
+
+    idx_path = g_strconcat(path, SEEK_INDEX_SUFFIX, NULL);
+    idx = file_open(idx_path);
+    g_free(idx_path);
+    if (idx != NULL) {
+        points = seek_index_read_wsidx(idx, &capture_statb);
+        file_close(idx);
+    }
+
+    if (points == NULL) {
+        idx_path = g_strconcat(path, ".gzi", NULL);
+        idx = file_open(idx_path);
+        g_free(idx_path);
+        if (idx != NULL) {
+            if (ws_fstat64(idx->fd, &idx_statb) == 0 &&
+                idx_statb.st_mtime >= capture_statb.st_mtime)
+                points = seek_index_read_gzi(idx);
+            file_close(idx);
+        }
+        if (points != NULL) {
+            int fd = ws_open(path, O_RDONLY|O_BINARY, 0000);
+
+            if (fd == -1 ||
+                !seek_index_check_gzi(fd, capture_statb.st_size, points)) {
+                seek_index_free_points(points);
+                points = NULL;
+            }
+            if (fd != -1)
+                ws_close(fd);
+        }
+    }
+
+    if (points == NULL)
+        return FALSE;
+    for (guint i = 0; i < points->len; i++)
+        g_ptr_array_add(stream->fast_seek, points->pdata[i]);
+    g_ptr_array_free(points, TRUE);
+    return TRUE;
+}
+
+#ifdef HAVE_ZLIB
+gboolean
+file_seek_index_save(FILE_T stream, const char *path)
+{
+    ws_statb64 capture_statb;
+    char *idx_path, *tmp_path;
+    GZWFILE_T idx;
+    guint8 hdr[SEEK_INDEX_HDR_LEN];
+    guint8 rec[SEEK_INDEX_POINT_LEN + 8];
+    struct fast_seek_point *point;
+    gboolean ok = TRUE;
+
+    if (!stream->is_compressed || stream->fast_seek == NULL ||
+        stream->fast_seek->len == 0)
+        return FALSE;
+    if (ws_fstat64(stream->fd, &capture_statb) < 0)
+        return FALSE;
+
+    /* write to a temporary file, so nobody sees a partial index */
+    idx_path = g_strconcat(path, SEEK_INDEX_SUFFIX, NULL);
+    tmp_path = g_strconcat(idx_path, ".tmp", NULL);
+    idx = gzwfile_open(tmp_path);
+    if (idx == NULL) {
+        g_free(tmp_path);
+        g_free(idx_path);
+        return FALSE;
+    }
+
+    memcpy(hdr, SEEK_INDEX_MAGIC, 4);
+    phtole32(hdr + 4, SEEK_INDEX_VERSION);
+    phtole64(hdr + 8, (guint64)capture_statb.st_size);
+    phtole64(hdr + 16, (guint64)capture_statb.st_mtime);
+    phtole32(hdr + 24, stream->fast_seek->len);
+    if (gzwfile_write(idx, hdr, SEEK_INDEX_HDR_LEN) == 0)
+        ok = FALSE;
+
+    for (guint i = 0; ok && i < stream->fast_seek->len; i++) {
+        guint rec_len = SEEK_INDEX_POINT_LEN;
+
+        point = (struct fast_seek_point *)stream->fast_seek->pdata[i];
+        memset(rec, 0, sizeof rec);
+        switch (point->compression) {
+
+        case UNCOMPRESSED:
+            rec[0] = SEEK_INDEX_POINT_UNCOMPRESSED;
+            break;
+
+        case UNKNOWN:
+            rec[0] = SEEK_INDEX_POINT_GZIP_MEMBER;
+            break;
+
+        case GZIP_AFTER_HEADER:
+            rec[0] = SEEK_INDEX_POINT_GZIP_AFTER_HEADER;
+            break;
+
+        case ZLIB:
+            rec[0] = SEEK_INDEX_POINT_DEFLATE;
+#ifdef HAVE_INFLATEPRIME
+            rec[1] = (guint8)point->data.zlib.bits;
+#endif
+            phtole32(rec + SEEK_INDEX_POINT_LEN, point->data.zlib.adler);
+            phtole32(rec + SEEK_INDEX_POINT_LEN + 4, point->data.zlib.total_out);
+            rec_len += 8;
+            break;
+
+#ifdef HAVE_ZSTD
+        case ZSTD:
+            rec[0] = SEEK_INDEX_POINT_ZSTD;
+            break;
+#endif
+
+#ifdef HAVE_LZ4FRAME_H
+        case LZ4:
+            rec[0] = SEEK_INDEX_POINT_LZ4;
+            break;
+#endif
+        }
+        phtole64(rec + 4, (guint64)point->in);
+        phtole64(rec + 12, (guint64)point->out);
+        if (gzwfile_write(idx, rec, rec_len) == 0)
+            ok = FALSE;
+        else if (point->compression == ZLIB &&
+                 gzwfile_write(idx, point->data.zlib.window, ZLIB_WINSIZE) == 0)
+            ok = FALSE;
+    }
+
+    if (gzwfile_close(idx) != 0)
+        ok = FALSE;
+    if (ok && ws_rename(tmp_path, idx_path) != 0)
+        ok = FALSE;
+    if (!ok)
+        ws_unlink(tmp_path);
+    g_free(tmp_path);
+    g_free(idx_path);
+    return ok;
+}
+#else
+gboolean
+file_seek_index_save(FILE_T stream _U_, const char *path _U_)
+{
+    return FALSE;
+}
+#endif
+
+gint64
+file_seek(FILE_T file, gint64 offset, int whence, int *err)
+{
+    struct fast_seek_point *here;
+    guint n;
+
+    if (whence != SEEK_SET && whence != SEEK_CUR && whence != SEEK_END) {
+        g_assert_not_reached();
+/*
+ *err = EINVAL;
+ return -1;
+*/
+    }
+
+    /* Normalize offset to a SEEK_CUR specification */
+    if (whence == SEEK_END) {
+        /* Seek relative to the end of the file; given that we might be
+           reading from a compressed file, we do that by seeking to the
+           end of the file, making an offset relative to the end of
+           the file an offset relative to the current position.
+
+           XXX - we don't actually use this yet, but, for uncompressed
+           files, we could optimize it, if desired, by directly using
+           ws_lseek64(). */
+        if (gz_skip(file, G_MAXINT64) == -1) {
+            *err = file->err;
+            return -1;
+        }
+        if (offset == 0) {
+            /* We are done */
+            return file->pos;
+        }
+    } else if (whence == SEEK_SET)
+        offset -= file->pos;
+    else if (file->seek_pending) {
+        /* There's a forward-skip pending, so file->pos doesn't reflect
+           the actual file position, it represents the position from
+           which we're skipping; update the offset to include that. */
+        offset += file->skip;
+    }
+    file->seek_pending = FALSE;
+
+    /*
+     * Are we moving at all?
+     */
+    if (offset == 0) {
+        /* No.  Just return the current position. */
+        return file->pos;
+    }
+
+#ifdef HAVE_MMAP
+    /*
+     * If we're reading from a mapping, we can go straight to any
+     * offset; reading past the end of the mapping is handled by
+     * fill_out_buffer().
+     */
+    if (file->mapped) {
+        if (file->pos + offset < 0) {
+            *err = EINVAL;
+            return -1;
+        }
+        map_set_window(file, file->pos + offset);
+        file->eof = FALSE;
+        return file->pos;
+    }
+#endif
+
+    /*
+     * Are we seeking backwards?
+     */
+    if (offset < 0) {
         /*
          * Yes.
          *
@@ -1200,6 +2046,11 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             off2 = here->out;
         } else
 #endif
+        if (here->compression != UNCOMPRESSED) {
+            /* start of a zstd or lz4 frame */
+            off = here->in;
+            off2 = here->out;
+        } else
         {
             off2 = (file->pos + offset);
             off = here->in + (off2 - here->out);
@@ -1251,6 +2102,22 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
             strm->adler = crc32(0L, Z_NULL, 0);
             file->compression = ZLIB;
         } else
+#endif
+#ifdef HAVE_ZSTD
+        if (here->compression == ZSTD) {
+            if (zstd_init(file) == -1) {
+                *err = file->err;
+                return -1;
+            }
+        } else
+#endif
+#ifdef HAVE_LZ4FRAME_H
+        if (here->compression == LZ4) {
+            if (lz4_init(file) == -1) {
+                *err = file->err;
+                return -1;
+            }
+        } else
 #endif
             file->compression = here->compression;
 
@@ -1361,6 +2228,10 @@ file_tell(FILE_T stream)
 gint64
 file_tell_raw(FILE_T stream)
 {
+#ifdef HAVE_MMAP
+    if (stream->mapped)
+        return stream->start + stream->pos;
+#endif
     return stream->raw_pos;
 }
 
@@ -1381,6 +2252,12 @@ file_iscompressed(FILE_T stream)
     return stream->is_compressed;
 }
 
+wtap_compression_type
+file_get_compression_type(FILE_T stream)
+{
+    return stream->compression_type;
+}
+
 int
 file_read(void *buf, unsigned int len, FILE_T file)
 {
@@ -1442,6 +2319,117 @@ file_read(void *buf, unsigned int len, FILE_T file)
     return (int)got;
 }
 
+#ifdef HAVE_MMAP
+/*
+ * Ask for the file to be read through a memory mapping, if it's an
+ * uncompressed regular file, or stop doing so.  If we don't know yet
+ * whether the file is compressed, the file is mapped once we find out.
+ */
+void
+file_set_mapped(FILE_T file, gboolean mapped)
+{
+    file->map_wanted = mapped;
+    if (mapped) {
+        if (file->compression == UNCOMPRESSED && !map_start(file))
+            file->map_wanted = FALSE;
+    } else if (file->mapped)
+        map_stop(file);
+}
+
+/*
+ * If the file is being read through a mapping, return a pointer to the
+ * next len bytes in the mapping and move past them, as file_read() would;
+ * the data stays valid until the file is closed, and must not be written
+ * to, as the mapping is read-only.  Otherwise, or if the
+ * data isn't all in the mapping, return NULL without moving, and the
+ * caller should use file_read().
+ */
+guint8 *
+file_read_mapped(unsigned int len, FILE_T file)
+{
+    guint8 *data;
+
+    if (!file->mapped || file->err != 0)
+        return NULL;
+
+    /* process a skip request */
+    if (file->seek_pending) {
+        file->seek_pending = FALSE;
+        if (gz_skip(file, file->skip) == -1 || !file->mapped)
+            return NULL;
+    }
+
+    if (file->out.avail < len) {
+        /* The data runs past the window; move the window up to it. */
+        map_set_window(file, file->pos);
+        if (file->out.avail < len)
+            return NULL;
+    }
+    data = file->out.next;
+    file->out.next += len;
+    file->out.avail -= len;
+    file->pos += len;
+    return data;
+}
+#else /* HAVE_MMAP */
+void
+file_set_mapped(FILE_T file _U_, gboolean mapped _U_)
+{
+}
+
+guint8 *
+file_read_mapped(unsigned int len _U_, FILE_T file _U_)
+{
+    return NULL;
+}
+#endif /* HAVE_MMAP */
+
+/*
+ * Return a pointer to the data that's been read into the output buffer
+ * and not yet consumed, filling the buffer first if it's empty, and set
+ * *avail to the number of bytes there; at the end of the file or on an
+ * error, return NULL with *avail set to 0, and leave it to file_read()
+ * to report which.  The data stays valid until the next call that reads
+ * from or moves around in the file, other than file_skip_buffered().
+ */
+const guint8 *
+file_peek_buffered(FILE_T file, unsigned int *avail)
+{
+    *avail = 0;
+
+    /* process a skip request */
+    if (file->seek_pending) {
+        file->seek_pending = FALSE;
+        if (gz_skip(file, file->skip) == -1)
+            return NULL;
+    }
+
+    /* as in file_peekc(), fill the buffer if there's nothing in it */
+    while (file->out.avail == 0) {
+        if (file->err != 0)
+            return NULL;
+        if (file->eof && file->in.avail == 0)
+            return NULL;
+        if (fill_out_buffer(file) == -1)
+            return NULL;
+    }
+    *avail = file->out.avail;
+    return file->out.next;
+}
+
+/*
+ * Move past len bytes of the data returned by file_peek_buffered(); len
+ * must be no more than the *avail it returned.
+ */
+void
+file_skip_buffered(FILE_T file, unsigned int len)
+{
+    g_assert(!file->seek_pending && len <= file->out.avail);
+    file->out.next += len;
+    file->out.avail -= len;
+    file->pos += len;
+}
+
 /*
  * XXX - this *peeks* at next byte, not a character.
  */
@@ -1644,10 +2632,24 @@ file_close(FILE_T file)
 {
     int fd = file->fd;
 
+#ifdef HAVE_MMAP
+    if (file->mapped)
+        file->out.buf = file->map_saved_buf;
+    if (file->map != NULL)
+        munmap(file->map, (size_t)file->map_size);
+#endif
+
     /* free memory and close file */
     if (file->size) {
 #ifdef HAVE_ZLIB
         inflateEnd(&(file->strm));
+#endif
+#ifdef HAVE_ZSTD
+        ZSTD_freeDStream(file->zstd_dctx);
+#endif
+#ifdef HAVE_LZ4FRAME_H
+        if (file->lz4_dctx != NULL)
+            LZ4F_freeDecompressionContext(file->lz4_dctx);
 #endif
         g_free(file->out.buf);
         g_free(file->in.buf);
@@ -1950,6 +2952,426 @@ gzwfile_geterr(GZWFILE_T state)
 }
 #endif
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4FRAME_H)
+/* Write out len bytes of compressed data from buf.  Return -1, and set
+   *err, on failure; return 0 on success. */
+static int
+frame_write_out(int fd, const unsigned char *buf, size_t len, int *err)
+{
+    ssize_t got;
+
+    if (len == 0)
+        return 0;
+    got = ws_write(fd, buf, (unsigned int)len);
+    if (got < 0) {
+        *err = errno;
+        return -1;
+    }
+    if ((size_t)got != len) {
+        *err = WTAP_ERR_SHORT_WRITE;
+        return -1;
+    }
+    return 0;
+}
+#endif
+
+/*
+ * The zstd and lz4 writers end the current frame, and start a new one,
+ * after every SPAN bytes of uncompressed data, so that the reader can
+ * use the frame boundaries as fast seek points.
+ */
+#ifdef HAVE_ZSTD
+/* internal zstd file state data structure for writing */
+struct zstd_writer {
+    int fd;                 /* file descriptor */
+    gint64 frame_len;       /* uncompressed data in the current frame */
+    gboolean in_frame;      /* TRUE if we've started a frame */
+    unsigned char *out;     /* output buffer */
+    size_t size;            /* output buffer size */
+    int level;              /* compression level */
+    int err;                /* error code */
+    ZSTD_CStream *cstream;  /* zstd compression stream */
+};
+
+ZSTDWFILE_T
+zstdwfile_open(const char *path)
+{
+    int fd;
+    ZSTDWFILE_T state;
+    int save_errno;
+
+    fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd == -1)
+        return NULL;
+    state = zstdwfile_fdopen(fd);
+    if (state == NULL) {
+        save_errno = errno;
+        ws_close(fd);
+        errno = save_errno;
+    }
+    return state;
+}
+
+ZSTDWFILE_T
+zstdwfile_fdopen(int fd)
+{
+    ZSTDWFILE_T state;
+
+    /* allocate zstd_writer structure to return */
+    state = (ZSTDWFILE_T)g_try_malloc(sizeof *state);
+    if (state == NULL)
+        return NULL;
+    state->size = ZSTD_CStreamOutSize();
+    state->out = (unsigned char *)g_try_malloc(state->size);
+    state->cstream = ZSTD_createCStream();
+    if (state->out == NULL || state->cstream == NULL) {
+        ZSTD_freeCStream(state->cstream);
+        g_free(state->out);
+        g_free(state);
+        errno = ENOMEM;
+        return NULL;
+    }
+    state->fd = fd;
+    state->frame_len = 0;
+    state->in_frame = FALSE;
+    state->level = 3;       /* zstd's default */
+    state->err = 0;
+
+    /* return stream */
+    return state;
+}
+
+/* Finish the current frame, if any.  Return -1, and set state->err, on
+   failure; return 0 on success. */
+static int
+zstd_end_frame(ZSTDWFILE_T state)
+{
+    ZSTD_outBuffer output;
+    size_t remaining;
+
+    if (!state->in_frame)
+        return 0;
+    do {
+        output.dst = state->out;
+        output.size = state->size;
+        output.pos = 0;
+        remaining = ZSTD_endStream(state->cstream, &output);
+        if (ZSTD_isError(remaining)) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        if (frame_write_out(state->fd, state->out, output.pos, &state->err) == -1)
+            return -1;
+    } while (remaining != 0);
+    state->in_frame = FALSE;
+    state->frame_len = 0;
+    return 0;
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes (in which case state->err
+   is 0); return the number of bytes written on success. */
+guint
+zstdwfile_write(ZSTDWFILE_T state, const void *buf, guint len)
+{
+    ZSTD_inBuffer input;
+    ZSTD_outBuffer output;
+    size_t ret;
+    guint done = 0;
+    guint chunk;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return 0;
+
+    while (done < len) {
+        if (!state->in_frame) {
+            ret = ZSTD_initCStream(state->cstream, state->level);
+            if (ZSTD_isError(ret)) {
+                /* This "shouldn't happen". */
+                state->err = WTAP_ERR_INTERNAL;
+                return 0;
+            }
+            state->in_frame = TRUE;
+        }
+
+        /* don't let this frame grow past SPAN bytes */
+        chunk = len - done;
+        if (chunk > SPAN - state->frame_len)
+            chunk = (guint)(SPAN - state->frame_len);
+
+        input.src = (const char *)buf + done;
+        input.size = chunk;
+        input.pos = 0;
+        while (input.pos < input.size) {
+            output.dst = state->out;
+            output.size = state->size;
+            output.pos = 0;
+            ret = ZSTD_compressStream(state->cstream, &output, &input);
+            if (ZSTD_isError(ret)) {
+                /* This "shouldn't happen". */
+                state->err = WTAP_ERR_INTERNAL;
+                return 0;
+            }
+            if (frame_write_out(state->fd, state->out, output.pos, &state->err) == -1)
+                return 0;
+        }
+        done += chunk;
+        state->frame_len += chunk;
+        if (state->frame_len >= SPAN && zstd_end_frame(state) == -1)
+            return 0;
+    }
+    return len;
+}
+
+/* Flush out what we've written so far.  Returns -1, and sets state->err,
+   on failure; returns 0 on success. */
+int
+zstdwfile_flush(ZSTDWFILE_T state)
+{
+    ZSTD_outBuffer output;
+    size_t remaining;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return -1;
+
+    if (!state->in_frame)
+        return 0;
+    do {
+        output.dst = state->out;
+        output.size = state->size;
+        output.pos = 0;
+        remaining = ZSTD_flushStream(state->cstream, &output);
+        if (ZSTD_isError(remaining)) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        if (frame_write_out(state->fd, state->out, output.pos, &state->err) == -1)
+            return -1;
+    } while (remaining != 0);
+    return 0;
+}
+
+/* Flush out all data written, and close the file.  Returns a Wiretap
+   error on failure; returns 0 on success. */
+int
+zstdwfile_close(ZSTDWFILE_T state)
+{
+    int ret = 0;
+
+    /* finish the last frame, free memory, and close file */
+    if (state->err != 0)
+        ret = state->err;
+    else if (zstd_end_frame(state) == -1)
+        ret = state->err;
+    ZSTD_freeCStream(state->cstream);
+    g_free(state->out);
+    if (ws_close(state->fd) == -1 && ret == 0)
+        ret = errno;
+    g_free(state);
+    return ret;
+}
+
+int
+zstdwfile_geterr(ZSTDWFILE_T state)
+{
+    return state->err;
+}
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4FRAME_H
+/* amount of uncompressed data handed to liblz4 at a time */
+#define LZ4_CHUNK_SIZE  65536
+
+/* internal lz4 file state data structure for writing */
+struct lz4_writer {
+    int fd;                 /* file descriptor */
+    gint64 frame_len;       /* uncompressed data in the current frame */
+    gboolean in_frame;      /* TRUE if we've started a frame */
+    unsigned char *out;     /* output buffer */
+    size_t size;            /* output buffer size */
+    int err;                /* error code */
+    LZ4F_compressionContext_t cctx; /* lz4 compression context */
+    LZ4F_preferences_t prefs;       /* frame parameters */
+};
+
+LZ4WFILE_T
+lz4wfile_open(const char *path)
+{
+    int fd;
+    LZ4WFILE_T state;
+    int save_errno;
+
+    fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd == -1)
+        return NULL;
+    state = lz4wfile_fdopen(fd);
+    if (state == NULL) {
+        save_errno = errno;
+        ws_close(fd);
+        errno = save_errno;
+    }
+    return state;
+}
+
+LZ4WFILE_T
+lz4wfile_fdopen(int fd)
+{
+    LZ4WFILE_T state;
+
+    /* allocate lz4_writer structure to return */
+    state = (LZ4WFILE_T)g_try_malloc0(sizeof *state);
+    if (state == NULL)
+        return NULL;
+    state->prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+
+    /* enough for the frame header, or for one chunk plus the end of the frame */
+    state->size = LZ4F_compressBound(LZ4_CHUNK_SIZE, &state->prefs);
+    state->out = (unsigned char *)g_try_malloc(state->size);
+    if (state->out == NULL ||
+        LZ4F_isError(LZ4F_createCompressionContext(&state->cctx, LZ4F_VERSION))) {
+        g_free(state->out);
+        g_free(state);
+        errno = ENOMEM;
+        return NULL;
+    }
+    state->fd = fd;
+    state->frame_len = 0;
+    state->in_frame = FALSE;
+    state->err = 0;
+
+    /* return stream */
+    return state;
+}
+
+/* Finish the current frame, if any.  Return -1, and set state->err, on
+   failure; return 0 on success. */
+static int
+lz4_end_frame(LZ4WFILE_T state)
+{
+    size_t ret;
+
+    if (!state->in_frame)
+        return 0;
+    ret = LZ4F_compressEnd(state->cctx, state->out, state->size, NULL);
+    if (LZ4F_isError(ret)) {
+        /* This "shouldn't happen". */
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+    if (frame_write_out(state->fd, state->out, ret, &state->err) == -1)
+        return -1;
+    state->in_frame = FALSE;
+    state->frame_len = 0;
+    return 0;
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes (in which case state->err
+   is 0); return the number of bytes written on success. */
+guint
+lz4wfile_write(LZ4WFILE_T state, const void *buf, guint len)
+{
+    size_t ret;
+    guint done = 0;
+    guint chunk;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return 0;
+
+    while (done < len) {
+        if (!state->in_frame) {
+            ret = LZ4F_compressBegin(state->cctx, state->out, state->size,
+                                     &state->prefs);
+            if (LZ4F_isError(ret)) {
+                /* This "shouldn't happen". */
+                state->err = WTAP_ERR_INTERNAL;
+                return 0;
+            }
+            if (frame_write_out(state->fd, state->out, ret, &state->err) == -1)
+                return 0;
+            state->in_frame = TRUE;
+        }
+
+        /* don't let this frame grow past SPAN bytes */
+        chunk = len - done;
+        if (chunk > LZ4_CHUNK_SIZE)
+            chunk = LZ4_CHUNK_SIZE;
+        if (chunk > SPAN - state->frame_len)
+            chunk = (guint)(SPAN - state->frame_len);
+
+        ret = LZ4F_compressUpdate(state->cctx, state->out, state->size,
+                                  (const char *)buf + done, chunk, NULL);
+        if (LZ4F_isError(ret)) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return 0;
+        }
+        if (frame_write_out(state->fd, state->out, ret, &state->err) == -1)
+            return 0;
+        done += chunk;
+        state->frame_len += chunk;
+        if (state->frame_len >= SPAN && lz4_end_frame(state) == -1)
+            return 0;
+    }
+    return len;
+}
+
+/* Flush out what we've written so far.  Returns -1, and sets state->err,
+   on failure; returns 0 on success. */
+int
+lz4wfile_flush(LZ4WFILE_T state)
+{
+    size_t ret;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return -1;
+
+    if (!state->in_frame)
+        return 0;
+    ret = LZ4F_flush(state->cctx, state->out, state->size, NULL);
+    if (LZ4F_isError(ret)) {
+        /* This "shouldn't happen". */
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+    if (frame_write_out(state->fd, state->out, ret, &state->err) == -1)
+        return -1;
+    return 0;
+}
+
+/* Flush out all data written, and close the file.  Returns a Wiretap
+   error on failure; returns 0 on success. */
+int
+lz4wfile_close(LZ4WFILE_T state)
+{
+    int ret = 0;
+
+    /* finish the last frame, free memory, and close file */
+    if (state->err != 0)
+        ret = state->err;
+    else if (lz4_end_frame(state) == -1)
+        ret = state->err;
+    LZ4F_freeCompressionContext(state->cctx);
+    g_free(state->out);
+    if (ws_close(state->fd) == -1 && ret == 0)
+        ret = errno;
+    g_free(state);
+    return ret;
+}
+
+int
+lz4wfile_geterr(LZ4WFILE_T state)
+{
+    return state->err;
+}
+#endif /* HAVE_LZ4FRAME_H */
+
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
  *
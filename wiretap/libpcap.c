@@ -47,11 +47,15 @@ static gboolean libpcap_read(wtap *wth, wtap_rec *rec, Buffer *buf,
 static gboolean libpcap_seek_read(wtap *wth, gint64 seek_off,
     wtap_rec *rec, Buffer *buf, int *err, gchar **err_info);
 static gboolean libpcap_read_packet(wtap *wth, FILE_T fh,
-    wtap_rec *rec, Buffer *buf, int *err, gchar **err_info);
+    wtap_rec *rec, Buffer *buf, gboolean skip_data, int *err,
+    gchar **err_info);
+static gboolean libpcap_read_batch(wtap *wth, wtap_rec_batch *batch,
+    int *err, gchar **err_info);
 static gboolean libpcap_dump(wtap_dumper *wdh, const wtap_rec *rec,
     const guint8 *pd, int *err, gchar **err_info);
 static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, gchar **err_info,
     struct pcaprec_ss990915_hdr *hdr);
+static void libpcap_fix_header(libpcap_t *libpcap, struct pcaprec_hdr *hdr);
 static void libpcap_close(wtap *wth);
 
 wtap_open_return_val libpcap_open(wtap *wth, int *err, gchar **err_info)
@@ -517,6 +521,18 @@ done:
 	    hdr.network == 13)
 		wth->file_encap = WTAP_ENCAP_ATM_PDUS;
 
+	/*
+	 * If the records have the standard header, and there's no
+	 * pseudo-header to read or packet data to rewrite, batches
+	 * can be read straight out of the file's buffer.
+	 */
+	if ((wth->file_type_subtype == WTAP_FILE_TYPE_SUBTYPE_PCAP ||
+	     wth->file_type_subtype == WTAP_FILE_TYPE_SUBTYPE_PCAP_NSEC) &&
+	    !wtap_encap_requires_phdr(wth->file_encap) &&
+	    !pcap_read_post_process_modifies_data(wth->file_encap,
+	      libpcap->byte_swapped))
+		wth->subtype_read_batch = libpcap_read_batch;
+
 	if (wth->file_encap == WTAP_ENCAP_ERF) {
 		/*Reset the ERF interface lookup table*/
 		libpcap->encap_priv = erf_priv_create();
@@ -719,7 +735,8 @@ static gboolean libpcap_read(wtap *wth, wtap_rec *rec, Buffer *buf,
 {
 	*data_offset = file_tell(wth->fh);
 
-	return libpcap_read_packet(wth, wth->fh, rec, buf, err, err_info);
+	return libpcap_read_packet(wth, wth->fh, rec, buf,
+	    wth->skip_packet_data, err, err_info);
 }
 
 static gboolean
@@ -729,7 +746,7 @@ libpcap_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec,
 	if (file_seek(wth->random_fh, seek_off, SEEK_SET, err) == -1)
 		return FALSE;
 
-	if (!libpcap_read_packet(wth, wth->random_fh, rec, buf, err,
+	if (!libpcap_read_packet(wth, wth->random_fh, rec, buf, FALSE, err,
 	    err_info)) {
 		if (*err == 0)
 			*err = WTAP_ERR_SHORT_READ;
@@ -740,12 +757,13 @@ libpcap_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec,
 
 static gboolean
 libpcap_read_packet(wtap *wth, FILE_T fh, wtap_rec *rec,
-    Buffer *buf, int *err, gchar **err_info)
+    Buffer *buf, gboolean skip_data, int *err, gchar **err_info)
 {
 	struct pcaprec_ss990915_hdr hdr;
 	guint packet_size;
 	guint orig_size;
 	int phdr_len;
+	guint8 *pd;
 	libpcap_t *libpcap;
 
 	libpcap = (libpcap_t *)wth->priv;
@@ -826,13 +844,113 @@ libpcap_read_packet(wtap *wth, FILE_T fh, wtap_rec *rec,
 	rec->rec_header.packet_header.len = orig_size;
 
 	/*
-	 * Read the packet data.
+	 * Read the packet data, leaving it in the file if the file
+	 * is mapped and we don't have to rewrite it, or skip over it
+	 * if our caller only wants the record headers.
+	 */
+	if (skip_data) {
+		if (!wtap_read_bytes(fh, NULL, packet_size, err, err_info))
+			return FALSE;	/* failed */
+		pd = NULL;
+	} else if (pcap_read_post_process_modifies_data(wth->file_encap,
+	    libpcap->byte_swapped)) {
+		if (!wtap_read_packet_bytes(fh, buf, packet_size, err, err_info))
+			return FALSE;	/* failed */
+		pd = ws_buffer_start_ptr(buf);
+	} else {
+		pd = wtap_read_packet_bytes_mapped(fh, rec, buf, packet_size,
+		    err, err_info);
+		if (pd == NULL)
+			return FALSE;	/* failed */
+	}
+
+	pcap_read_post_process(wth->file_type_subtype, wth->file_encap,
+	    rec, pd, libpcap->byte_swapped, -1);
+	return TRUE;
+}
+
+/* If the next record is all in the file's buffer, and it's one that
+   libpcap_read_packet() would read without an error, read it into the
+   batch straight from the buffer and return TRUE; otherwise, return
+   FALSE, without having moved in the file. */
+static gboolean
+libpcap_read_buffered_packet(wtap *wth, wtap_rec_batch *batch)
+{
+	libpcap_t *libpcap = (libpcap_t *)wth->priv;
+	struct pcaprec_hdr hdr;
+	const guint8 *data;
+	unsigned int avail;
+	gint64 offset;
+	wtap_rec *rec;
+	guint8 *pd;
+	int err;
+	gchar *err_info;
+
+	data = file_peek_buffered(wth->fh, &avail);
+	if (avail < sizeof hdr)
+		return FALSE;
+	memcpy(&hdr, data, sizeof hdr);
+	libpcap_fix_header(libpcap, &hdr);
+	if (hdr.incl_len > wtap_max_snaplen_for_encap(wth->file_encap) ||
+	    hdr.incl_len > avail - sizeof hdr)
+		return FALSE;
+
+	offset = file_tell(wth->fh);
+	file_skip_buffered(wth->fh, sizeof hdr);
+	data += sizeof hdr;
+
+	rec = wtap_batch_start_record(wth, batch);
+
+	/*
+	 * There's no pseudo-header in the file for this encapsulation,
+	 * so this just fills in the pseudo-header defaults.
+	 */
+	pcap_process_pseudo_header(wth->fh, wth->file_type_subtype,
+	    wth->file_encap, hdr.incl_len, rec, &err, &err_info);
+
+	rec->rec_type = REC_TYPE_PACKET;
+	rec->presence_flags = WTAP_HAS_TS|WTAP_HAS_CAP_LEN;
+	rec->ts.secs = hdr.ts_sec;
+	if (wth->file_tsprec == WTAP_TSPREC_NSEC)
+		rec->ts.nsecs = hdr.ts_usec;
+	else
+		rec->ts.nsecs = hdr.ts_usec * 1000;
+	rec->rec_header.packet_header.caplen = hdr.incl_len;
+	rec->rec_header.packet_header.len = hdr.orig_len;
+
+	/*
+	 * Leave the packet data in the file if the file is mapped,
+	 * otherwise copy it into the batch, or skip over it if our
+	 * caller only wants the record headers.
 	 */
-	if (!wtap_read_packet_bytes(fh, buf, packet_size, err, err_info))
-		return FALSE;	/* failed */
+	if (wth->skip_packet_data) {
+		pd = NULL;
+		file_skip_buffered(wth->fh, hdr.incl_len);
+	} else if ((pd = file_read_mapped(hdr.incl_len, wth->fh)) != NULL) {
+		rec->data = pd;
+	} else {
+		pd = wtap_batch_add_data(batch, data, hdr.incl_len);
+		file_skip_buffered(wth->fh, hdr.incl_len);
+	}
 
 	pcap_read_post_process(wth->file_type_subtype, wth->file_encap,
-	    rec, ws_buffer_start_ptr(buf), libpcap->byte_swapped, -1);
+	    rec, pd, libpcap->byte_swapped, -1);
+	wtap_batch_end_record(wth, batch, offset);
+	return TRUE;
+}
+
+/* Read records into a batch, parsing them straight out of the file's
+   buffer where we can, and reading the rest, such as those that
+   straddle the end of the buffer, with libpcap_read(). */
+static gboolean
+libpcap_read_batch(wtap *wth, wtap_rec_batch *batch, int *err,
+    gchar **err_info)
+{
+	while (batch->count < batch->size) {
+		if (!libpcap_read_buffered_packet(wth, batch) &&
+		    !wtap_batch_read_record(wth, batch, err, err_info))
+			return FALSE;
+	}
 	return TRUE;
 }
 
@@ -843,7 +961,6 @@ static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, gchar **err_info,
     struct pcaprec_ss990915_hdr *hdr)
 {
 	int bytes_to_read;
-	guint32 temp;
 	libpcap_t *libpcap;
 
 	switch (wth->file_type_subtype) {
@@ -875,12 +992,22 @@ static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, gchar **err_info,
 		return FALSE;
 
 	libpcap = (libpcap_t *)wth->priv;
+	libpcap_fix_header(libpcap, &hdr->hdr);
+	return TRUE;
+}
+
+/* Put the fields of a record header in host byte order, and the lengths
+   in the right fields. */
+static void libpcap_fix_header(libpcap_t *libpcap, struct pcaprec_hdr *hdr)
+{
+	guint32 temp;
+
 	if (libpcap->byte_swapped) {
 		/* Byte-swap the record header fields. */
-		hdr->hdr.ts_sec = GUINT32_SWAP_LE_BE(hdr->hdr.ts_sec);
-		hdr->hdr.ts_usec = GUINT32_SWAP_LE_BE(hdr->hdr.ts_usec);
-		hdr->hdr.incl_len = GUINT32_SWAP_LE_BE(hdr->hdr.incl_len);
-		hdr->hdr.orig_len = GUINT32_SWAP_LE_BE(hdr->hdr.orig_len);
+		hdr->ts_sec = GUINT32_SWAP_LE_BE(hdr->ts_sec);
+		hdr->ts_usec = GUINT32_SWAP_LE_BE(hdr->ts_usec);
+		hdr->incl_len = GUINT32_SWAP_LE_BE(hdr->incl_len);
+		hdr->orig_len = GUINT32_SWAP_LE_BE(hdr->orig_len);
 	}
 
 	/* Swap the "incl_len" and "orig_len" fields, if necessary. */
@@ -890,7 +1017,7 @@ static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, gchar **err_info,
 		break;
 
 	case MAYBE_SWAPPED:
-		if (hdr->hdr.incl_len <= hdr->hdr.orig_len) {
+		if (hdr->incl_len <= hdr->orig_len) {
 			/*
 			 * The captured length is <= the actual length,
 			 * so presumably they weren't swapped.
@@ -900,13 +1027,11 @@ static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, gchar **err_info,
 		/* FALLTHROUGH */
 
 	case SWAPPED:
-		temp = hdr->hdr.orig_len;
-		hdr->hdr.orig_len = hdr->hdr.incl_len;
-		hdr->hdr.incl_len = temp;
+		temp = hdr->orig_len;
+		hdr->orig_len = hdr->incl_len;
+		hdr->incl_len = temp;
 		break;
 	}
-
-	return TRUE;
 }
 
 /* Returns 0 if we could write the specified encapsulation type,
@@ -71,11 +71,223 @@ merge_idb_merge_mode_to_string(const int mode)
 }
 
 
+/*
+ * A record read ahead from an input file, along with any DSBs read
+ * from the file before it.
+ */
+typedef struct merge_read_ahead_slot_s {
+    wtap_rec        rec;
+    Buffer          frame_buffer;
+    GArray         *dsbs;           /* wtap_block_t DSBs read before this record */
+    in_file_state_e state;          /* RECORD_PRESENT, AT_EOF or GOT_ERROR */
+    int             err;
+    gchar          *err_info;
+} merge_read_ahead_slot_t;
+
+/*
+ * Bounded ring of records read ahead from one input file.  The reader
+ * thread fills the slot after the last full one, and the merge thread
+ * takes the slot at the head; a slot belongs to whichever thread is
+ * going to fill or take it next, so only head and count need locking.
+ */
+typedef struct merge_read_ahead_s {
+    GThread                 *thread;
+    GMutex                   mutex;
+    GCond                    not_empty;
+    GCond                    not_full;
+    merge_read_ahead_slot_t *slots;
+    guint                    num_slots;
+    guint                    head;      /* next slot for the merge thread to take */
+    guint                    count;     /* number of full slots */
+    gboolean                 stop;      /* set to make the reader thread exit */
+    guint                    dsbs_seen; /* elements of wth->dsbs handed out; reader thread only */
+    GArray                  *dsbs;      /* DSBs taken with the current record; merge thread only */
+} merge_read_ahead_t;
+
+static gpointer
+merge_read_ahead_worker(gpointer data)
+{
+    merge_in_file_t *in_file = (merge_in_file_t *)data;
+    merge_read_ahead_t *ra = in_file->read_ahead;
+    merge_read_ahead_slot_t *slot;
+    GArray *wth_dsbs;
+    gint64 data_offset;
+
+    for (;;) {
+        g_mutex_lock(&ra->mutex);
+        while (ra->count == ra->num_slots && !ra->stop)
+            g_cond_wait(&ra->not_full, &ra->mutex);
+        if (ra->stop) {
+            g_mutex_unlock(&ra->mutex);
+            break;
+        }
+        slot = &ra->slots[(ra->head + ra->count) % ra->num_slots];
+        g_mutex_unlock(&ra->mutex);
+
+        slot->err = 0;
+        slot->err_info = NULL;
+        if (wtap_read(in_file->wth, &slot->rec, &slot->frame_buffer,
+                      &slot->err, &slot->err_info, &data_offset))
+            slot->state = RECORD_PRESENT;
+        else if (slot->err != 0)
+            slot->state = GOT_ERROR;
+        else
+            slot->state = AT_EOF;
+
+        /*
+         * The merge thread mustn't look at wth->dsbs while we might be
+         * adding to it, so hand over any new DSBs along with the record.
+         */
+        wth_dsbs = in_file->wth->dsbs;
+        if (wth_dsbs) {
+            for (; ra->dsbs_seen < wth_dsbs->len; ra->dsbs_seen++) {
+                wtap_block_t wblock = g_array_index(wth_dsbs, wtap_block_t, ra->dsbs_seen);
+                g_array_append_val(slot->dsbs, wblock);
+            }
+        }
+
+        g_mutex_lock(&ra->mutex);
+        ra->count++;
+        g_cond_signal(&ra->not_empty);
+        g_mutex_unlock(&ra->mutex);
+
+        if (slot->state != RECORD_PRESENT)
+            break;
+    }
+
+    return NULL;
+}
+
+/*
+ * Start a thread reading records ahead from in_file into a ring of
+ * num_slots records.
+ */
+static void
+merge_read_ahead_start(merge_in_file_t *in_file, guint num_slots)
+{
+    merge_read_ahead_t *ra;
+    guint i;
+
+    g_assert(in_file->read_ahead == NULL);
+    g_assert(num_slots > 0);
+
+    ra = g_new0(merge_read_ahead_t, 1);
+    g_mutex_init(&ra->mutex);
+    g_cond_init(&ra->not_empty);
+    g_cond_init(&ra->not_full);
+    ra->slots = g_new0(merge_read_ahead_slot_t, num_slots);
+    ra->num_slots = num_slots;
+    for (i = 0; i < num_slots; i++) {
+        wtap_rec_init(&ra->slots[i].rec);
+        ws_buffer_init(&ra->slots[i].frame_buffer, 1514);
+        ra->slots[i].dsbs = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
+    }
+    ra->dsbs_seen = in_file->dsbs_seen;
+    ra->dsbs = g_array_new(FALSE, FALSE, sizeof(wtap_block_t));
+
+    in_file->read_ahead = ra;
+    ra->thread = g_thread_new("merge_read_ahead", merge_read_ahead_worker, in_file);
+}
+
+/*
+ * Stop the read-ahead thread for in_file, if any, and free the records
+ * it read that weren't used.
+ */
+static void
+merge_read_ahead_stop(merge_in_file_t *in_file)
+{
+    merge_read_ahead_t *ra = in_file->read_ahead;
+    guint i;
+
+    if (ra == NULL)
+        return;
+
+    g_mutex_lock(&ra->mutex);
+    ra->stop = TRUE;
+    g_cond_signal(&ra->not_full);
+    g_mutex_unlock(&ra->mutex);
+    g_thread_join(ra->thread);
+
+    for (i = 0; i < ra->num_slots; i++) {
+        wtap_rec_cleanup(&ra->slots[i].rec);
+        ws_buffer_free(&ra->slots[i].frame_buffer);
+        g_array_free(ra->slots[i].dsbs, TRUE);
+        g_free(ra->slots[i].err_info);
+    }
+    g_free(ra->slots);
+    g_array_free(ra->dsbs, TRUE);
+    g_cond_clear(&ra->not_full);
+    g_cond_clear(&ra->not_empty);
+    g_mutex_clear(&ra->mutex);
+    g_free(ra);
+    in_file->read_ahead = NULL;
+}
+
+/*
+ * Take the next record read ahead from in_file, waiting for the reader
+ * thread if necessary, and update the file's state accordingly.
+ *
+ * The record and its buffer are swapped with in_file->rec and
+ * in_file->frame_buffer, so the reader thread reuses the ones holding
+ * the previous record rather than allocating new ones.
+ *
+ * Returns FALSE on a read error.
+ */
+static gboolean
+merge_read_ahead_take(merge_in_file_t *in_file, int *err, gchar **err_info)
+{
+    merge_read_ahead_t *ra = in_file->read_ahead;
+    merge_read_ahead_slot_t *slot;
+    wtap_rec rec;
+    Buffer buf;
+
+    g_mutex_lock(&ra->mutex);
+    while (ra->count == 0)
+        g_cond_wait(&ra->not_empty, &ra->mutex);
+    slot = &ra->slots[ra->head];
+    g_mutex_unlock(&ra->mutex);
+
+    if (slot->state != RECORD_PRESENT) {
+        /*
+         * The reader thread has exited; leave the slot in the ring, so
+         * that we report EOF again if we're called again.
+         */
+        in_file->state = slot->state;
+        if (slot->state == GOT_ERROR) {
+            *err = slot->err;
+            *err_info = slot->err_info;
+            slot->err_info = NULL;
+            return FALSE;
+        }
+        return TRUE;
+    }
+
+    rec = in_file->rec;
+    in_file->rec = slot->rec;
+    slot->rec = rec;
+    buf = in_file->frame_buffer;
+    in_file->frame_buffer = slot->frame_buffer;
+    slot->frame_buffer = buf;
+    g_array_append_vals(ra->dsbs, slot->dsbs->data, slot->dsbs->len);
+    g_array_set_size(slot->dsbs, 0);
+
+    g_mutex_lock(&ra->mutex);
+    ra->head = (ra->head + 1) % ra->num_slots;
+    ra->count--;
+    g_cond_signal(&ra->not_full);
+    g_mutex_unlock(&ra->mutex);
+
+    in_file->state = RECORD_PRESENT;
+    return TRUE;
+}
+
 static void
 cleanup_in_file(merge_in_file_t *in_file)
 {
     g_assert(in_file != NULL);
 
+    merge_read_ahead_stop(in_file);
+
     wtap_close(in_file->wth);
     in_file->wth = NULL;
 
@@ -207,21 +419,127 @@ merge_select_frame_type(int in_file_count, merge_in_file_t in_files[])
 }
 
 /*
- * returns TRUE if first argument is earlier than second
+ * Min-heap of input files, keyed on the time stamp of the record each
+ * file currently has available.  The root is always the file whose
+ * record should be written next, so picking it is O(1) and replacing
+ * it with that file's next record is O(log N), rather than comparing
+ * the records of all N files for every record written.
+ */
+typedef struct merge_heap_s {
+    guint    *entries;  /* indices into the in_files array */
+    guint     count;    /* number of files with a record available */
+    gboolean  primed;   /* TRUE once every file has been read from */
+} merge_heap_t;
+
+static void
+merge_heap_init(merge_heap_t *heap, const guint in_file_count)
+{
+    heap->entries = g_new(guint, in_file_count);
+    heap->count   = 0;
+    heap->primed  = FALSE;
+}
+
+static void
+merge_heap_cleanup(merge_heap_t *heap)
+{
+    g_free(heap->entries);
+    heap->entries = NULL;
+    heap->count   = 0;
+}
+
+/*
+ * returns TRUE if the record available from file l should be written
+ * before the record available from file r
+ *
+ * Records with no time stamp are treated as earlier than all other
+ * records; yes, this means you won't get a chronological merge of those
+ * records, but you obviously *can't* get that.  Ties are broken on the
+ * file index so that the output doesn't depend on the shape of the heap:
+ * records without a time stamp come from the lowest-numbered file first,
+ * and records with equal time stamps from the highest-numbered file
+ * first, as the linear scan this replaced did.
  */
 static gboolean
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+merge_is_earlier(const merge_in_file_t in_files[], guint l, guint r)
 {
-    if (l->secs > r->secs) {  /* left is later */
-        return FALSE;
-    } else if (l->secs < r->secs) { /* left is earlier */
+    const wtap_rec *lrec = &in_files[l].rec;
+    const wtap_rec *rrec = &in_files[r].rec;
+    int cmp;
+
+    if (!(lrec->presence_flags & WTAP_HAS_TS)) {
+        if (!(rrec->presence_flags & WTAP_HAS_TS))
+            return l < r;
         return TRUE;
-    } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
+    }
+    if (!(rrec->presence_flags & WTAP_HAS_TS))
         return FALSE;
+
+    cmp = nstime_cmp(&lrec->ts, &rrec->ts);
+    if (cmp != 0)
+        return cmp < 0;
+    return l > r;
+}
+
+static void
+merge_heap_sift_up(merge_heap_t *heap, const merge_in_file_t in_files[],
+                   guint pos)
+{
+    guint entry = heap->entries[pos];
+
+    while (pos > 0) {
+        guint parent = (pos - 1) / 2;
+
+        if (!merge_is_earlier(in_files, entry, heap->entries[parent]))
+            break;
+        heap->entries[pos] = heap->entries[parent];
+        pos = parent;
     }
-    /* either one < two or one == two
-     * either way, return one
-     */
+    heap->entries[pos] = entry;
+}
+
+static void
+merge_heap_sift_down(merge_heap_t *heap, const merge_in_file_t in_files[],
+                     guint pos)
+{
+    guint entry = heap->entries[pos];
+
+    for (;;) {
+        guint child = 2 * pos + 1;
+
+        if (child >= heap->count)
+            break;
+        if (child + 1 < heap->count &&
+            merge_is_earlier(in_files, heap->entries[child + 1], heap->entries[child]))
+            child++;
+        if (!merge_is_earlier(in_files, heap->entries[child], entry))
+            break;
+        heap->entries[pos] = heap->entries[child];
+        pos = child;
+    }
+    heap->entries[pos] = entry;
+}
+
+/*
+ * Read the next record from in_file into its rec and frame_buffer, and
+ * update its state accordingly.  Returns FALSE on a read error.
+ */
+static gboolean
+merge_read_next_record(merge_in_file_t *in_file, int *err, gchar **err_info)
+{
+    gint64 data_offset;
+
+    if (in_file->read_ahead)
+        return merge_read_ahead_take(in_file, err, err_info);
+
+    if (!wtap_read(in_file->wth, &in_file->rec, &in_file->frame_buffer,
+                   err, err_info, &data_offset)) {
+        if (*err != 0) {
+            in_file->state = GOT_ERROR;
+            return FALSE;
+        }
+        in_file->state = AT_EOF;
+    } else
+        in_file->state = RECORD_PRESENT;
     return TRUE;
 }
 
@@ -239,6 +557,8 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  *
  * @param in_file_count number of entries in in_files
  * @param in_files input file array
+ * @param heap heap of files with a record available, initialized with
+ * merge_heap_init() and not modified by the caller between calls
  * @param err wiretap error, if failed
  * @param err_info wiretap error string, if failed
  * @return pointer to merge_in_file_t for file from which that packet
@@ -247,67 +567,53 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  */
 static merge_in_file_t *
 merge_read_packet(int in_file_count, merge_in_file_t in_files[],
-                  int *err, gchar **err_info)
+                  merge_heap_t *heap, int *err, gchar **err_info)
 {
     int i;
-    int ei = -1;
-    nstime_t tv = NSTIME_INIT_MAX;
-    wtap_rec *rec;
+    guint ei;
 
-    /*
-     * Make sure we have a record available from each file that's not at
-     * EOF, and search for the record with the earliest time stamp or
-     * with no time stamp (those records are treated as earlier than
-     * all other records).  Yes, this means you won't get a chronological
-     * merge of those records, but you obviously *can't* get that.
-     */
-    for (i = 0; i < in_file_count; i++) {
-        gint64 data_offset;
-
-        if (in_files[i].state == RECORD_NOT_PRESENT) {
-            /*
-             * No packet available, and we haven't seen an error or EOF yet,
-             * so try to read the next packet.
-             */
-            if (!wtap_read(in_files[i].wth, &in_files[i].rec,
-                           &in_files[i].frame_buffer, err, err_info,
-                           &data_offset)) {
-                if (*err != 0) {
-                    in_files[i].state = GOT_ERROR;
-                    return &in_files[i];
-                }
-                in_files[i].state = AT_EOF;
-            } else
-                in_files[i].state = RECORD_PRESENT;
-        }
-
-        if (in_files[i].state == RECORD_PRESENT) {
-            rec = &in_files[i].rec;
-            if (!(rec->presence_flags & WTAP_HAS_TS)) {
-                /*
-                 * No time stamp.  Pick this record, and stop looking.
-                 */
-                ei = i;
-                break;
+    if (!heap->primed) {
+        /*
+         * First call; get a record from each file, and build the heap
+         * from the files that aren't at EOF.
+         */
+        for (i = 0; i < in_file_count; i++) {
+            if (!merge_read_next_record(&in_files[i], err, err_info))
+                return &in_files[i];
+            if (in_files[i].state == RECORD_PRESENT) {
+                heap->entries[heap->count] = i;
+                merge_heap_sift_up(heap, in_files, heap->count);
+                heap->count++;
             }
-            if (is_earlier(&rec->ts, &tv)) {
-                /*
-                 * This record's time stamp is earlier than any of the
-                 * records we've seen so far.  Pick it, for now, but
-                 * keep looking.
-                 */
-                tv = rec->ts;
-                ei = i;
+        }
+        heap->primed = TRUE;
+    } else if (heap->count > 0) {
+        /*
+         * The file at the root is the one from which we returned a
+         * record last time; replace that record with the file's next
+         * one, or drop the file from the heap if it's at EOF.
+         */
+        ei = heap->entries[0];
+        if (in_files[ei].state == RECORD_NOT_PRESENT) {
+            if (!merge_read_next_record(&in_files[ei], err, err_info))
+                return &in_files[ei];
+            if (in_files[ei].state == AT_EOF) {
+                heap->count--;
+                heap->entries[0] = heap->entries[heap->count];
             }
+            if (heap->count > 0)
+                merge_heap_sift_down(heap, in_files, 0);
         }
     }
 
-    if (ei == -1) {
+    if (heap->count == 0) {
         /* All the streams are at EOF.  Return an EOF indication. */
         *err = 0;
         return NULL;
     }
 
+    ei = heap->entries[0];
+
     /* We'll need to read another packet from this file. */
     in_files[ei].state = RECORD_NOT_PRESENT;
 
@@ -347,7 +653,6 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
                          int *err, gchar **err_info)
 {
     int i;
-    gint64 data_offset;
 
     /*
      * Find the first file not at EOF, and read the next packet from it.
@@ -355,17 +660,13 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
     for (i = 0; i < in_file_count; i++) {
         if (in_files[i].state == AT_EOF)
             continue; /* This file is already at EOF */
-        if (wtap_read(in_files[i].wth, &in_files[i].rec,
-                      &in_files[i].frame_buffer, err, err_info,
-                      &data_offset))
-            break; /* We have a packet */
-        if (*err != 0) {
+        if (!merge_read_next_record(&in_files[i], err, err_info)) {
             /* Read error - quit immediately. */
-            in_files[i].state = GOT_ERROR;
             return &in_files[i];
         }
-        /* EOF - flag this file as being at EOF, and try the next one. */
-        in_files[i].state = AT_EOF;
+        if (in_files[i].state == RECORD_PRESENT)
+            break; /* We have a packet */
+        /* EOF - this file is now flagged as being at EOF; try the next one. */
     }
     if (i == in_file_count) {
         /* All the streams are at EOF.  Return an EOF indication. */
@@ -841,7 +1142,7 @@ static merge_result
 merge_process_packets(wtap_dumper *pdh, const int file_type,
                       merge_in_file_t *in_files, const guint in_file_count,
                       const gboolean do_append, guint snaplen,
-                      merge_progress_callback_t* cb,
+                      guint read_ahead, merge_progress_callback_t* cb,
                       GArray *dsb_combined,
                       int *err, gchar **err_info, guint *err_fileno,
                       guint32 *err_framenum)
@@ -851,6 +1152,14 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
     int                 count = 0;
     gboolean            stop_flag = FALSE;
     wtap_rec *rec,      snap_rec;
+    merge_heap_t        heap;
+
+    merge_heap_init(&heap, in_file_count);
+
+    if (read_ahead > 0) {
+        for (guint i = 0; i < in_file_count; i++)
+            merge_read_ahead_start(&in_files[i], read_ahead);
+    }
 
     for (;;) {
         *err = 0;
@@ -860,7 +1169,7 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
                                                err_info);
         }
         else {
-            in_file = merge_read_packet(in_file_count, in_files, err,
+            in_file = merge_read_packet(in_file_count, in_files, &heap, err,
                                         err_info);
         }
 
@@ -926,7 +1235,12 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
          * If any DSBs were read before this record, be sure to pass those now
          * such that wtap_dump can pick it up.
          */
-        if (dsb_combined && in_file->wth->dsbs) {
+        if (dsb_combined && in_file->read_ahead) {
+            GArray *in_dsb = in_file->read_ahead->dsbs;
+            g_array_append_vals(dsb_combined, in_dsb->data, in_dsb->len);
+            in_file->dsbs_seen += in_dsb->len;
+            g_array_set_size(in_dsb, 0);
+        } else if (dsb_combined && in_file->wth->dsbs) {
             GArray *in_dsb = in_file->wth->dsbs;
             for (guint i = in_file->dsbs_seen; i < in_dsb->len; i++) {
                 wtap_block_t wblock = g_array_index(in_dsb, wtap_block_t, i);
@@ -942,6 +1256,8 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
         }
     }
 
+    merge_heap_cleanup(&heap);
+
     if (cb)
         cb->callback_func(MERGE_EVENT_DONE, count, in_files, in_file_count, cb->data);
 
@@ -982,7 +1298,8 @@ merge_files_common(const gchar* out_filename, /* normal output mode */
                    const int file_type, const char *const *in_filenames,
                    const guint in_file_count, const gboolean do_append,
                    const idb_merge_mode mode, guint snaplen,
-                   const gchar *app_name, merge_progress_callback_t* cb,
+                   guint read_ahead, const gchar *app_name,
+                   merge_progress_callback_t* cb,
                    int *err, gchar **err_info, guint *err_fileno,
                    guint32 *err_framenum)
 {
@@ -1073,8 +1390,8 @@ merge_files_common(const gchar* out_filename, /* normal output mode */
         cb->callback_func(MERGE_EVENT_READY_TO_MERGE, 0, in_files, in_file_count, cb->data);
 
     status = merge_process_packets(pdh, file_type, in_files, in_file_count,
-                                   do_append, snaplen, cb, dsb_combined, err, err_info,
-                                   err_fileno, err_framenum);
+                                   do_append, snaplen, read_ahead, cb, dsb_combined,
+                                   err, err_info, err_fileno, err_framenum);
 
     g_free(in_files);
     wtap_block_array_free(shb_hdrs);
@@ -1095,7 +1412,8 @@ merge_result
 merge_files(const gchar* out_filename, const int file_type,
             const char *const *in_filenames, const guint in_file_count,
             const gboolean do_append, const idb_merge_mode mode,
-            guint snaplen, const gchar *app_name, merge_progress_callback_t* cb,
+            guint snaplen, guint read_ahead, const gchar *app_name,
+            merge_progress_callback_t* cb,
             int *err, gchar **err_info, guint *err_fileno,
             guint32 *err_framenum)
 {
@@ -1103,8 +1421,8 @@ merge_files(const gchar* out_filename, const int file_type,
 
     return merge_files_common(out_filename, NULL, NULL,
                               file_type, in_filenames, in_file_count,
-                              do_append, mode, snaplen, app_name, cb, err,
-                              err_info, err_fileno, err_framenum);
+                              do_append, mode, snaplen, read_ahead, app_name,
+                              cb, err, err_info, err_fileno, err_framenum);
 }
 
 /*
@@ -1117,7 +1435,8 @@ merge_files_to_tempfile(gchar **out_filenamep, const char *pfx,
                         const int file_type, const char *const *in_filenames,
                         const guint in_file_count, const gboolean do_append,
                         const idb_merge_mode mode, guint snaplen,
-                        const gchar *app_name, merge_progress_callback_t* cb,
+                        guint read_ahead, const gchar *app_name,
+                        merge_progress_callback_t* cb,
                         int *err, gchar **err_info, guint *err_fileno,
                         guint32 *err_framenum)
 {
@@ -1128,8 +1447,8 @@ merge_files_to_tempfile(gchar **out_filenamep, const char *pfx,
 
     return merge_files_common(NULL, out_filenamep, pfx,
                               file_type, in_filenames, in_file_count,
-                              do_append, mode, snaplen, app_name, cb, err,
-                              err_info, err_fileno, err_framenum);
+                              do_append, mode, snaplen, read_ahead, app_name,
+                              cb, err, err_info, err_fileno, err_framenum);
 }
 
 /*
@@ -1141,14 +1460,15 @@ merge_result
 merge_files_to_stdout(const int file_type, const char *const *in_filenames,
                       const guint in_file_count, const gboolean do_append,
                       const idb_merge_mode mode, guint snaplen,
-                      const gchar *app_name, merge_progress_callback_t* cb,
+                      guint read_ahead, const gchar *app_name,
+                      merge_progress_callback_t* cb,
                       int *err, gchar **err_info, guint *err_fileno,
                       guint32 *err_framenum)
 {
     return merge_files_common(NULL, NULL, NULL,
                               file_type, in_filenames, in_file_count,
-                              do_append, mode, snaplen, app_name, cb, err,
-                              err_info, err_fileno, err_framenum);
+                              do_append, mode, snaplen, read_ahead, app_name,
+                              cb, err, err_info, err_fileno, err_framenum);
 }
 
 /*
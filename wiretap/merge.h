@@ -24,6 +24,8 @@ typedef enum {
     GOT_ERROR
 } in_file_state_e;
 
+struct merge_read_ahead_s;
+
 /**
  * Structures to manage our input files.
  */
@@ -37,6 +39,7 @@ typedef struct merge_in_file_s {
     gint64          size;           /* file size */
     GArray         *idb_index_map;  /* used for mapping the old phdr interface_id values to new during merge */
     guint           dsbs_seen;      /* number of elements processed so far from wth->dsbs */
+    struct merge_read_ahead_s *read_ahead; /* reader thread state, or NULL if reading on the merge thread */
 } merge_in_file_t;
 
 /** Return values from merge_files(). */
@@ -122,6 +125,9 @@ typedef struct {
  * @param do_append Whether to append by file order instead of chronological order
  * @param mode The IDB_MERGE_MODE_XXX merge mode for interface data
  * @param snaplen The snaplen to limit it to, or 0 to leave as it is in the files
+ * @param read_ahead If non-zero, start a thread for each input file that
+ *   reads (and, for compressed files, decompresses) up to this many records
+ *   ahead of the merge; if zero, records are read on the thread doing the merge
  * @param app_name The application name performing the merge, used in SHB info
  * @param cb The callback information to use during execution
  * @param[out] err Set to the internal WTAP_ERR_XXX error code if it failed
@@ -138,7 +144,8 @@ WS_DLL_PUBLIC merge_result
 merge_files(const gchar* out_filename, const int file_type,
             const char *const *in_filenames, const guint in_file_count,
             const gboolean do_append, const idb_merge_mode mode,
-            guint snaplen, const gchar *app_name, merge_progress_callback_t* cb,
+            guint snaplen, guint read_ahead, const gchar *app_name,
+            merge_progress_callback_t* cb,
             int *err, gchar **err_info, guint *err_fileno,
             guint32 *err_framenum);
 
@@ -153,6 +160,9 @@ merge_files(const gchar* out_filename, const int file_type,
  * @param do_append Whether to append by file order instead of chronological order
  * @param mode The IDB_MERGE_MODE_XXX merge mode for interface data
  * @param snaplen The snaplen to limit it to, or 0 to leave as it is in the files
+ * @param read_ahead If non-zero, start a thread for each input file that
+ *   reads (and, for compressed files, decompresses) up to this many records
+ *   ahead of the merge; if zero, records are read on the thread doing the merge
  * @param app_name The application name performing the merge, used in SHB info
  * @param cb The callback information to use during execution
  * @param[out] err Set to the internal WTAP_ERR_XXX error code if it failed
@@ -170,7 +180,8 @@ merge_files_to_tempfile(gchar **out_filenamep, const char *pfx,
                         const int file_type, const char *const *in_filenames,
                         const guint in_file_count, const gboolean do_append,
                         const idb_merge_mode mode, guint snaplen,
-                        const gchar *app_name, merge_progress_callback_t* cb,
+                        guint read_ahead, const gchar *app_name,
+                        merge_progress_callback_t* cb,
                         int *err, gchar **err_info, guint *err_fileno,
                         guint32 *err_framenum);
 
@@ -182,6 +193,9 @@ merge_files_to_tempfile(gchar **out_filenamep, const char *pfx,
  * @param do_append Whether to append by file order instead of chronological order
  * @param mode The IDB_MERGE_MODE_XXX merge mode for interface data
  * @param snaplen The snaplen to limit it to, or 0 to leave as it is in the files
+ * @param read_ahead If non-zero, start a thread for each input file that
+ *   reads (and, for compressed files, decompresses) up to this many records
+ *   ahead of the merge; if zero, records are read on the thread doing the merge
  * @param app_name The application name performing the merge, used in SHB info
  * @param cb The callback information to use during execution
  * @param[out] err Set to the internal WTAP_ERR_XXX error code if it failed
@@ -198,7 +212,8 @@ WS_DLL_PUBLIC merge_result
 merge_files_to_stdout(const int file_type, const char *const *in_filenames,
                       const guint in_file_count, const gboolean do_append,
                       const idb_merge_mode mode, guint snaplen,
-                      const gchar *app_name, merge_progress_callback_t* cb,
+                      guint read_ahead, const gchar *app_name,
+                      merge_progress_callback_t* cb,
                       int *err, gchar **err_info, guint *err_fileno,
                       guint32 *err_framenum);
 
@@ -2254,6 +2254,10 @@ pcap_process_pseudo_header(FILE_T fh, int file_type, int wtap_encap,
 	return phdr_len;
 }
 
+/*
+ * pd is NULL if the caller skipped the packet data; the fixups that
+ * look at, or rewrite, the data are then left undone.
+ */
 void
 pcap_read_post_process(int file_type, int wtap_encap,
     wtap_rec *rec, guint8 *pd, gboolean bytes_swapped, int fcs_len)
@@ -2261,6 +2265,8 @@ pcap_read_post_process(int file_type, int wtap_encap,
 	switch (wtap_encap) {
 
 	case WTAP_ENCAP_ATM_PDUS:
+		if (pd == NULL)
+			break;
 		if (file_type == WTAP_FILE_TYPE_SUBTYPE_PCAP_NOKIA) {
 			/*
 			 * Nokia IPSO ATM.
@@ -2287,17 +2293,17 @@ pcap_read_post_process(int file_type, int wtap_encap,
 		break;
 
 	case WTAP_ENCAP_SLL:
-		if (bytes_swapped)
+		if (bytes_swapped && pd != NULL)
 			pcap_byteswap_linux_sll_pseudoheader(rec, pd);
 		break;
 
 	case WTAP_ENCAP_USB_LINUX:
-		if (bytes_swapped)
+		if (bytes_swapped && pd != NULL)
 			pcap_byteswap_linux_usb_pseudoheader(rec, pd, FALSE);
 		break;
 
 	case WTAP_ENCAP_USB_LINUX_MMAPPED:
-		if (bytes_swapped)
+		if (bytes_swapped && pd != NULL)
 			pcap_byteswap_linux_usb_pseudoheader(rec, pd, TRUE);
 		break;
 
@@ -2311,7 +2317,7 @@ pcap_read_post_process(int file_type, int wtap_encap,
 		break;
 
 	case WTAP_ENCAP_NFLOG:
-		if (bytes_swapped)
+		if (bytes_swapped && pd != NULL)
 			pcap_byteswap_nflog_pseudoheader(rec, pd);
 		break;
 
@@ -2330,6 +2336,27 @@ pcap_read_post_process(int file_type, int wtap_encap,
 	}
 }
 
+/*
+ * Does pcap_read_post_process() rewrite the packet data for this
+ * encapsulation type?  If so, the data has to be read into a buffer
+ * rather than left in a mapped file.
+ */
+gboolean
+pcap_read_post_process_modifies_data(int wtap_encap, gboolean bytes_swapped)
+{
+	switch (wtap_encap) {
+
+	case WTAP_ENCAP_SLL:
+	case WTAP_ENCAP_USB_LINUX:
+	case WTAP_ENCAP_USB_LINUX_MMAPPED:
+	case WTAP_ENCAP_NFLOG:
+		return bytes_swapped;
+
+	default:
+		return FALSE;
+	}
+}
+
 gboolean
 wtap_encap_requires_phdr(int wtap_encap)
 {
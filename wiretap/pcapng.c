@@ -41,6 +41,9 @@ static gboolean
 pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
             gchar **err_info, gint64 *data_offset);
 static gboolean
+pcapng_read_batch(wtap *wth, wtap_rec_batch *batch, int *err,
+                  gchar **err_info);
+static gboolean
 pcapng_seek_read(wtap *wth, gint64 seek_off,
                  wtap_rec *rec, Buffer *buf, int *err, gchar **err_info);
 static void
@@ -1132,6 +1135,7 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
     guint8 *option_content;
     int pseudo_header_len;
     int fcslen;
+    guint8 *pd;
 #ifdef HAVE_PLUGINS
     option_handler *handler;
 #endif
@@ -1308,10 +1312,26 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
     wblock->rec->ts.secs = (time_t)(ts / iface_info.time_units_per_second);
     wblock->rec->ts.nsecs = (int)(((ts % iface_info.time_units_per_second) * 1000000000) / iface_info.time_units_per_second);
 
-    /* "(Enhanced) Packet Block" read capture data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                packet.cap_len - pseudo_header_len, err, err_info))
-        return FALSE;
+    /*
+     * "(Enhanced) Packet Block" read capture data, leaving it in the
+     * file if the file is mapped and we don't have to rewrite it, or
+     * skipping it if our caller only wants the record headers.
+     */
+    if (wblock->skip_packet_data) {
+        if (!wtap_read_bytes(fh, NULL, packet.cap_len - pseudo_header_len, err, err_info))
+            return FALSE;
+        pd = NULL;
+    } else if (pcap_read_post_process_modifies_data(iface_info.wtap_encap, pn->byte_swapped)) {
+        if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+                                    packet.cap_len - pseudo_header_len, err, err_info))
+            return FALSE;
+        pd = ws_buffer_start_ptr(wblock->frame_buffer);
+    } else {
+        pd = wtap_read_packet_bytes_mapped(fh, wblock->rec, wblock->frame_buffer,
+                                           packet.cap_len - pseudo_header_len, err, err_info);
+        if (pd == NULL)
+            return FALSE;
+    }
     block_read += packet.cap_len - pseudo_header_len;
 
     /* jump over potential padding bytes at end of the packet data */
@@ -1453,7 +1473,7 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
     }
 
     pcap_read_post_process(WTAP_FILE_TYPE_SUBTYPE_PCAPNG, iface_info.wtap_encap,
-                           wblock->rec, ws_buffer_start_ptr(wblock->frame_buffer),
+                           wblock->rec, pd,
                            pn->byte_swapped, fcslen);
 
     /*
@@ -1474,6 +1494,7 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
     guint32 block_total_length;
     guint32 padding;
     int pseudo_header_len;
+    guint8 *pd;
 
     /*
      * Is this block long enough to be an SPB?
@@ -1594,9 +1615,21 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
     memset((void *)&wblock->rec->rec_header.packet_header.pseudo_header, 0, sizeof(union wtap_pseudo_header));
 
     /* "Simple Packet Block" read capture data */
-    if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
-                                simple_packet.cap_len, err, err_info))
-        return FALSE;
+    if (wblock->skip_packet_data) {
+        if (!wtap_read_bytes(fh, NULL, simple_packet.cap_len, err, err_info))
+            return FALSE;
+        pd = NULL;
+    } else if (pcap_read_post_process_modifies_data(iface_info.wtap_encap, pn->byte_swapped)) {
+        if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+                                    simple_packet.cap_len, err, err_info))
+            return FALSE;
+        pd = ws_buffer_start_ptr(wblock->frame_buffer);
+    } else {
+        pd = wtap_read_packet_bytes_mapped(fh, wblock->rec, wblock->frame_buffer,
+                                           simple_packet.cap_len, err, err_info);
+        if (pd == NULL)
+            return FALSE;
+    }
 
     /* jump over potential padding bytes at end of the packet data */
     if ((simple_packet.cap_len % 4) != 0) {
@@ -1605,7 +1638,7 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
     }
 
     pcap_read_post_process(WTAP_FILE_TYPE_SUBTYPE_PCAPNG, iface_info.wtap_encap,
-                           wblock->rec, ws_buffer_start_ptr(wblock->frame_buffer),
+                           wblock->rec, pd,
                            pn->byte_swapped, iface_info.fcslen);
 
     /*
@@ -2685,6 +2718,7 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
     /* we don't expect any packet blocks yet */
     wblock.frame_buffer = NULL;
     wblock.rec = NULL;
+    wblock.skip_packet_data = FALSE;
 
     pcapng_debug("pcapng_open: opening file");
     /* read first block */
@@ -2739,6 +2773,7 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
     pcapng->interfaces = g_array_new(FALSE, FALSE, sizeof(interface_info_t));
 
     wth->subtype_read = pcapng_read;
+    wth->subtype_read_batch = pcapng_read_batch;
     wth->subtype_seek_read = pcapng_seek_read;
     wth->subtype_close = pcapng_close;
     wth->file_type_subtype = WTAP_FILE_TYPE_SUBTYPE_PCAPNG;
@@ -2807,6 +2842,7 @@ pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 
     wblock.frame_buffer  = buf;
     wblock.rec = rec;
+    wblock.skip_packet_data = wth->skip_packet_data;
 
     pcapng->add_new_ipv4 = wth->add_new_ipv4;
     pcapng->add_new_ipv6 = wth->add_new_ipv6;
@@ -2925,6 +2961,144 @@ pcapng_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 }
 
 
+/*
+ * If the next block is an EPB without options, all in the file's buffer,
+ * for an interface whose packets have no pseudo-header in the file and
+ * don't need rewriting, and pcapng_read_packet_block() would read it
+ * without an error, read it into the batch straight from the buffer and
+ * return TRUE; otherwise, return FALSE, without having moved in the file.
+ */
+static gboolean
+pcapng_read_buffered_epb(wtap *wth, pcapng_t *pn, wtap_rec_batch *batch)
+{
+    const guint8 *data;
+    unsigned int avail;
+    pcapng_block_header_t bh;
+    pcapng_enhanced_packet_block_t epb;
+    guint32 block_total_length;
+    guint32 padding;
+    interface_info_t *iface_info;
+    guint64 ts;
+    gint64 offset;
+    wtap_rec *rec;
+    guint8 *pd;
+    int err;
+    gchar *err_info;
+
+    data = file_peek_buffered(wth->fh, &avail);
+    if (avail < MIN_EPB_SIZE)
+        return FALSE;
+    memcpy(&bh, data, sizeof bh);
+    memcpy(&epb, data + sizeof bh, sizeof epb);
+    if (pn->byte_swapped) {
+        bh.block_type         = GUINT32_SWAP_LE_BE(bh.block_type);
+        bh.block_total_length = GUINT32_SWAP_LE_BE(bh.block_total_length);
+        epb.interface_id      = GUINT32_SWAP_LE_BE(epb.interface_id);
+        epb.timestamp_high    = GUINT32_SWAP_LE_BE(epb.timestamp_high);
+        epb.timestamp_low     = GUINT32_SWAP_LE_BE(epb.timestamp_low);
+        epb.captured_len      = GUINT32_SWAP_LE_BE(epb.captured_len);
+        epb.packet_len        = GUINT32_SWAP_LE_BE(epb.packet_len);
+    }
+    if (bh.block_type != BLOCK_TYPE_EPB ||
+        bh.block_total_length > MAX_BLOCK_SIZE ||
+        bh.block_total_length > avail ||
+        epb.interface_id >= pn->interfaces->len)
+        return FALSE;
+    iface_info = &g_array_index(pn->interfaces, interface_info_t,
+                                epb.interface_id);
+    if (epb.captured_len > wtap_max_snaplen_for_encap(iface_info->wtap_encap) ||
+        wtap_encap_requires_phdr(iface_info->wtap_encap) ||
+        pcap_read_post_process_modifies_data(iface_info->wtap_encap, pn->byte_swapped))
+        return FALSE;
+
+    /* Anything after the padded packet data means there are options. */
+    if ((epb.captured_len % 4) != 0)
+        padding = 4 - (epb.captured_len % 4);
+    else
+        padding = 0;
+    if (bh.block_total_length != MIN_EPB_SIZE + epb.captured_len + padding)
+        return FALSE;
+    memcpy(&block_total_length, data + bh.block_total_length - sizeof block_total_length,
+           sizeof block_total_length);
+    if (pn->byte_swapped)
+        block_total_length = GUINT32_SWAP_LE_BE(block_total_length);
+    if (block_total_length != bh.block_total_length)
+        return FALSE;
+
+    offset = file_tell(wth->fh);
+    file_skip_buffered(wth->fh, (unsigned int)(sizeof bh + sizeof epb));
+    data += sizeof bh + sizeof epb;
+
+    rec = wtap_batch_start_record(wth, batch);
+    rec->rec_type = REC_TYPE_PACKET;
+    rec->presence_flags = WTAP_HAS_TS|WTAP_HAS_CAP_LEN|WTAP_HAS_INTERFACE_ID;
+    rec->rec_header.packet_header.interface_id = epb.interface_id;
+    rec->rec_header.packet_header.pkt_encap = iface_info->wtap_encap;
+    rec->tsprec = iface_info->tsprecision;
+
+    /*
+     * There's no pseudo-header in the file for this encapsulation,
+     * so this just fills in the pseudo-header defaults.
+     */
+    memset((void *)&rec->rec_header.packet_header.pseudo_header, 0, sizeof(union wtap_pseudo_header));
+    pcap_process_pseudo_header(wth->fh, WTAP_FILE_TYPE_SUBTYPE_PCAPNG,
+                               iface_info->wtap_encap, epb.captured_len,
+                               rec, &err, &err_info);
+    rec->rec_header.packet_header.caplen = epb.captured_len;
+    rec->rec_header.packet_header.len = epb.packet_len;
+
+    ts = (((guint64)epb.timestamp_high) << 32) | ((guint64)epb.timestamp_low);
+    rec->ts.secs = (time_t)(ts / iface_info->time_units_per_second);
+    rec->ts.nsecs = (int)(((ts % iface_info->time_units_per_second) * 1000000000) / iface_info->time_units_per_second);
+
+    /*
+     * Leave the packet data in the file if the file is mapped,
+     * otherwise copy it into the batch, or skip over it if our
+     * caller only wants the record headers.
+     */
+    if (wth->skip_packet_data) {
+        pd = NULL;
+        file_skip_buffered(wth->fh, epb.captured_len);
+    } else if ((pd = file_read_mapped(epb.captured_len, wth->fh)) != NULL) {
+        rec->data = pd;
+    } else {
+        pd = wtap_batch_add_data(batch, data, epb.captured_len);
+        file_skip_buffered(wth->fh, epb.captured_len);
+    }
+    /* Skip the padding and the trailing block length. */
+    file_skip_buffered(wth->fh, padding + (unsigned int)sizeof block_total_length);
+
+    /* Option defaults */
+    g_free(rec->opt_comment);   /* Free memory from an earlier read. */
+    rec->opt_comment = NULL;
+    rec->rec_header.packet_header.drop_count  = -1;
+    rec->rec_header.packet_header.pack_flags  = 0;
+
+    pcap_read_post_process(WTAP_FILE_TYPE_SUBTYPE_PCAPNG, iface_info->wtap_encap,
+                           rec, pd, pn->byte_swapped, iface_info->fcslen);
+    wtap_batch_end_record(wth, batch, offset);
+    return TRUE;
+}
+
+/*
+ * Read records into a batch, parsing EPBs straight out of the file's
+ * buffer where we can, and reading all other blocks, and EPBs with
+ * options or that straddle the end of the buffer, with pcapng_read().
+ */
+static gboolean
+pcapng_read_batch(wtap *wth, wtap_rec_batch *batch, int *err,
+                  gchar **err_info)
+{
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+
+    while (batch->count < batch->size) {
+        if (!pcapng_read_buffered_epb(wth, pcapng, batch) &&
+            !wtap_batch_read_record(wth, batch, err, err_info))
+            return FALSE;
+    }
+    return TRUE;
+}
+
 /* classic wtap: seek to file position and read packet */
 static gboolean
 pcapng_seek_read(wtap *wth, gint64 seek_off,
@@ -2943,6 +3117,7 @@ pcapng_seek_read(wtap *wth, gint64 seek_off,
 
     wblock.frame_buffer = buf;
     wblock.rec = rec;
+    wblock.skip_packet_data = FALSE;
 
     /* read the block */
     if (pcapng_read_block(wth, wth->random_fh, pcapng, &wblock, err, err_info) != PCAPNG_BLOCK_OK) {
@@ -46,6 +46,7 @@ typedef struct wtapng_block_s {
     wtap_block_t block;
     wtap_rec     *rec;
     Buffer       *frame_buffer;
+    gboolean     skip_packet_data; /* TRUE if packet data should be skipped rather than read */
 } wtapng_block_t;
 
 /*
@@ -0,0 +1,461 @@
+/* read_batch_test.c
+ * Standalone program to test reading records in batches with
+ * wtap_read_batch().
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "wtap.h"
+#include "test_capture_file.h"
+
+#define LINKTYPE_ETHERNET           1
+#define LINKTYPE_USB_LINUX          189
+
+#define NUM_RECORDS                 10
+
+/* Enough records to run past the end of the file's buffer many times. */
+#define MANY_RECORDS                2000
+
+/*
+ * Write a file with num_records records, setting offsets to where each
+ * of them starts, and, if truncate is TRUE, the start of one more.
+ */
+static gchar *
+create_file(test_file_format_e format, guint32 linktype, gboolean swapped,
+    gboolean truncate, guint num_records, gint64 *offsets)
+{
+    FILE *fp;
+    gchar *path;
+    guint i;
+
+    path = test_file_create("read_batch_test", &fp);
+    test_file_write_header(fp, format, linktype, swapped);
+    for (i = 0; i < num_records; i++) {
+        offsets[i] = ftell(fp);
+        test_file_write_record(fp, format, i, swapped, FALSE);
+    }
+    if (truncate)
+        test_file_write_record(fp, format, num_records, swapped, TRUE);
+    fclose(fp);
+    return path;
+}
+
+/*
+ * Check that slot i of the batch has record num, which starts at
+ * offset, and, unless headers_only is TRUE, its data.
+ */
+static void
+check_record(wtap_rec_batch *batch, guint i, guint num, gint64 offset,
+    gboolean headers_only)
+{
+    const wtap_rec *rec = &batch->recs[i];
+    guint8 expected[TEST_FILE_MAX_DATA_LEN];
+
+    g_assert_cmpuint(rec->rec_type, ==, REC_TYPE_PACKET);
+    g_assert_cmpint(rec->ts.secs, ==, num);
+    g_assert_cmpuint(rec->rec_header.packet_header.caplen, ==, test_file_record_len(num));
+    g_assert_cmpuint(rec->rec_header.packet_header.len, ==, test_file_record_len(num));
+    g_assert_cmpint(batch->offsets[i], ==, offset);
+    if (!headers_only) {
+        test_file_record_data(num, expected);
+        g_assert(memcmp(rec->data, expected, test_file_record_len(num)) == 0);
+    }
+}
+
+static void
+read_batch_eof(wtap *wth, wtap_rec_batch *batch)
+{
+    int err;
+    gchar *err_info = NULL;
+
+    g_assert(!wtap_read_batch(wth, batch, &err, &err_info));
+    g_assert_cmpint(err, ==, 0);
+    g_assert_cmpuint(batch->count, ==, 0);
+}
+
+/*
+ * Read a file with num_records records in batches of batch_size records,
+ * with the given wtap_set_zero_copy() flags, checking that each batch
+ * but the last is full, and that we get every record once, in order.
+ */
+static void
+check_boundaries(test_file_format_e format, gboolean swapped,
+    guint zero_copy, guint num_records, guint batch_size)
+{
+    gint64 *offsets;
+    gchar *path;
+    wtap *wth;
+    wtap_rec_batch batch;
+    int err;
+    gchar *err_info = NULL;
+    guint num = 0, i;
+
+    offsets = g_new(gint64, num_records);
+    path = create_file(format, LINKTYPE_ETHERNET, swapped, FALSE, num_records, offsets);
+    wth = test_file_open(path);
+    wtap_set_zero_copy(wth, zero_copy);
+    wtap_rec_batch_init(&batch, batch_size, 0);
+
+    while (num < num_records) {
+        if (!wtap_read_batch(wth, &batch, &err, &err_info))
+            g_error("Can't read record %u: %s", num, wtap_strerror(err));
+        g_assert_cmpint(err, ==, 0);
+        g_assert_cmpuint(batch.count, ==, MIN(batch_size, num_records - num));
+        for (i = 0; i < batch.count; i++, num++)
+            check_record(&batch, i, num, offsets[num], FALSE);
+    }
+    read_batch_eof(wth, &batch);
+    read_batch_eof(wth, &batch);
+
+    wtap_rec_batch_cleanup(&batch);
+    wtap_close(wth);
+    g_unlink(path);
+    g_free(path);
+    g_free(offsets);
+}
+
+static void
+read_batch_test_boundaries(gconstpointer data)
+{
+    test_file_format_e format = (test_file_format_e)GPOINTER_TO_INT(data);
+
+    check_boundaries(format, FALSE, 0, NUM_RECORDS, 1);
+    check_boundaries(format, FALSE, 0, NUM_RECORDS, 3);
+    check_boundaries(format, FALSE, 0, NUM_RECORDS, NUM_RECORDS - 1);
+    check_boundaries(format, FALSE, 0, NUM_RECORDS, NUM_RECORDS);
+    check_boundaries(format, FALSE, 0, NUM_RECORDS, NUM_RECORDS + 1);
+}
+
+/*
+ * Records that straddle the end of the file's buffer are read a record
+ * at a time, and the ones after them from the buffer again.
+ */
+static void
+read_batch_test_buffer_boundaries(gconstpointer data)
+{
+    test_file_format_e format = (test_file_format_e)GPOINTER_TO_INT(data);
+
+    check_boundaries(format, FALSE, 0, MANY_RECORDS, 1);
+    check_boundaries(format, FALSE, 0, MANY_RECORDS, 64);
+    check_boundaries(format, FALSE, 0, MANY_RECORDS, MANY_RECORDS);
+    check_boundaries(format, TRUE, 0, MANY_RECORDS, 64);
+}
+
+/*
+ * With WTAP_ZERO_COPY_SEQUENTIAL, the data of records in a mapped file
+ * is left there rather than copied into the batch.
+ */
+static void
+read_batch_test_zero_copy(gconstpointer data)
+{
+    test_file_format_e format = (test_file_format_e)GPOINTER_TO_INT(data);
+
+    check_boundaries(format, FALSE, WTAP_ZERO_COPY_SEQUENTIAL, NUM_RECORDS, 3);
+    check_boundaries(format, FALSE, WTAP_ZERO_COPY_SEQUENTIAL, MANY_RECORDS, 64);
+}
+
+/*
+ * With a truncated record after the last one, the batch with the last
+ * records is returned as usual, and the error only by the next call,
+ * which is when wtap_read() would have reported it.
+ */
+static void
+check_deferred_error(test_file_format_e format, guint batch_size)
+{
+    gint64 offsets[NUM_RECORDS];
+    gchar *path;
+    wtap *wth;
+    wtap_rec_batch batch;
+    int err;
+    gchar *err_info = NULL;
+    guint num = 0, i;
+
+    path = create_file(format, LINKTYPE_ETHERNET, FALSE, TRUE, NUM_RECORDS, offsets);
+    wth = test_file_open(path);
+    wtap_rec_batch_init(&batch, batch_size, 0);
+
+    while (num < NUM_RECORDS) {
+        if (!wtap_read_batch(wth, &batch, &err, &err_info))
+            g_error("Can't read record %u: %s", num, wtap_strerror(err));
+        g_assert_cmpint(err, ==, 0);
+        g_assert(err_info == NULL);
+        g_assert_cmpuint(batch.count, ==, MIN(batch_size, NUM_RECORDS - num));
+        for (i = 0; i < batch.count; i++, num++)
+            check_record(&batch, i, num, offsets[num], FALSE);
+    }
+    g_assert(!wtap_read_batch(wth, &batch, &err, &err_info));
+    g_assert_cmpint(err, ==, WTAP_ERR_SHORT_READ);
+    g_assert_cmpuint(batch.count, ==, 0);
+    g_free(err_info);
+
+    wtap_rec_batch_cleanup(&batch);
+    wtap_close(wth);
+    g_unlink(path);
+    g_free(path);
+}
+
+static void
+read_batch_test_deferred_error(gconstpointer data)
+{
+    test_file_format_e format = (test_file_format_e)GPOINTER_TO_INT(data);
+
+    /* The error ends a batch early... */
+    check_deferred_error(format, 3);
+    check_deferred_error(format, NUM_RECORDS + 1);
+    /* ...or comes at the start of one. */
+    check_deferred_error(format, NUM_RECORDS / 2);
+    check_deferred_error(format, NUM_RECORDS);
+}
+
+/*
+ * With WTAP_BATCH_HEADERS_ONLY, the headers are filled in but the data
+ * isn't read; the data is read again by wtap_read() after that.
+ */
+#define HEADERS_ONLY_BATCH_SIZE 4
+
+static void
+check_headers_only(test_file_format_e format, guint32 linktype, gboolean swapped)
+{
+    gint64 offsets[NUM_RECORDS];
+    gchar *path;
+    wtap *wth;
+    wtap_rec_batch batch;
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    gchar *err_info = NULL;
+    gint64 offset;
+    guint8 expected[TEST_FILE_MAX_DATA_LEN];
+    guint num = 0, i;
+
+    path = create_file(format, linktype, swapped, FALSE, NUM_RECORDS, offsets);
+    wth = test_file_open(path);
+    wtap_rec_batch_init(&batch, HEADERS_ONLY_BATCH_SIZE, WTAP_BATCH_HEADERS_ONLY);
+
+    if (!wtap_read_batch(wth, &batch, &err, &err_info))
+        g_error("Can't read record 0: %s", wtap_strerror(err));
+    g_assert_cmpuint(batch.count, ==, HEADERS_ONLY_BATCH_SIZE);
+    g_assert_cmpuint(ws_buffer_length(&batch.data), ==, 0);
+    for (i = 0; i < batch.count; i++, num++) {
+        check_record(&batch, i, num, offsets[num], TRUE);
+        g_assert(batch.recs[i].data == NULL);
+    }
+
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+    if (!wtap_read(wth, &rec, &buf, &err, &err_info, &offset))
+        g_error("Can't read record %u: %s", num, wtap_strerror(err));
+    g_assert_cmpint(offset, ==, offsets[num]);
+    g_assert_cmpuint(rec.rec_header.packet_header.caplen, ==, test_file_record_len(num));
+    test_file_record_data(num, expected);
+    if (swapped) {
+        /* Only the pseudo-header is rewritten. */
+        g_assert(memcmp(wtap_rec_data(&rec, &buf) + 64, expected + 64, test_file_record_len(num) - 64) == 0);
+    } else {
+        g_assert(memcmp(wtap_rec_data(&rec, &buf), expected, test_file_record_len(num)) == 0);
+    }
+    num++;
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+
+    while (wtap_read_batch(wth, &batch, &err, &err_info)) {
+        g_assert_cmpuint(ws_buffer_length(&batch.data), ==, 0);
+        for (i = 0; i < batch.count; i++, num++) {
+            check_record(&batch, i, num, offsets[num], TRUE);
+            g_assert(batch.recs[i].data == NULL);
+        }
+    }
+    g_assert_cmpint(err, ==, 0);
+    g_assert_cmpuint(num, ==, NUM_RECORDS);
+
+    wtap_rec_batch_cleanup(&batch);
+    wtap_close(wth);
+    g_unlink(path);
+    g_free(path);
+}
+
+static void
+read_batch_test_headers_only(gconstpointer data)
+{
+    test_file_format_e format = (test_file_format_e)GPOINTER_TO_INT(data);
+
+    check_headers_only(format, LINKTYPE_ETHERNET, FALSE);
+    /* Byte-swapped USB pseudo-headers are normally fixed up in the data. */
+    check_headers_only(format, LINKTYPE_USB_LINUX, TRUE);
+}
+
+/*
+ * A pcapng file with blocks that aren't read straight from the buffer
+ * mixed in with ones that are: EPBs with comments, and a second IDB
+ * half-way through, after which the records are on that interface.
+ */
+#define COMMENT_EVERY           3
+
+static void
+write_pcapng_idb(FILE *fp)
+{
+    test_file_put32(fp, 0x00000001, FALSE);
+    test_file_put32(fp, 20, FALSE);
+    test_file_put16(fp, LINKTYPE_ETHERNET, FALSE);
+    test_file_put16(fp, 0, FALSE);
+    test_file_put32(fp, TEST_FILE_SNAPLEN, FALSE);
+    test_file_put32(fp, 20, FALSE);
+}
+
+static void
+write_pcapng_record(FILE *fp, guint num, guint32 interface_id,
+    const char *comment)
+{
+    static const guint8 padding[3] = { 0, 0, 0 };
+    guint8 data[TEST_FILE_MAX_DATA_LEN];
+    guint len = test_file_record_len(num);
+    guint comment_len = comment != NULL ? (guint)strlen(comment) : 0;
+    guint32 block_len;
+    guint64 ts = (guint64)num * 1000000;
+
+    block_len = 32 + len + (4 - len % 4) % 4;
+    if (comment != NULL)
+        block_len += 4 + comment_len + (4 - comment_len % 4) % 4 + 4;
+
+    test_file_put32(fp, 0x00000006, FALSE);
+    test_file_put32(fp, block_len, FALSE);
+    test_file_put32(fp, interface_id, FALSE);
+    test_file_put32(fp, (guint32)(ts >> 32), FALSE);
+    test_file_put32(fp, (guint32)ts, FALSE);
+    test_file_put32(fp, len, FALSE);
+    test_file_put32(fp, len, FALSE);
+    test_file_record_data(num, data);
+    test_file_write(fp, data, len);
+    test_file_write(fp, padding, (4 - len % 4) % 4);
+    if (comment != NULL) {
+        test_file_put16(fp, 1, FALSE);          /* opt_comment */
+        test_file_put16(fp, comment_len, FALSE);
+        test_file_write(fp, comment, comment_len);
+        test_file_write(fp, padding, (4 - comment_len % 4) % 4);
+        test_file_put32(fp, 0, FALSE);          /* opt_endofopt */
+    }
+    test_file_put32(fp, block_len, FALSE);
+}
+
+static void
+check_mixed_blocks(guint batch_size)
+{
+    gint64 offsets[MANY_RECORDS];
+    gchar *path;
+    FILE *fp;
+    wtap *wth;
+    wtap_rec_batch batch;
+    const wtap_rec *rec;
+    gchar *comment;
+    int err;
+    gchar *err_info = NULL;
+    guint num = 0, i;
+
+    path = test_file_create("read_batch_test", &fp);
+    test_file_write_header(fp, TEST_FILE_PCAPNG, LINKTYPE_ETHERNET, FALSE);
+    for (i = 0; i < MANY_RECORDS; i++) {
+        if (i == MANY_RECORDS / 2)
+            write_pcapng_idb(fp);
+        offsets[i] = ftell(fp);
+        comment = i % COMMENT_EVERY == 0 ? g_strdup_printf("record %u", i) : NULL;
+        write_pcapng_record(fp, i, i < MANY_RECORDS / 2 ? 0 : 1, comment);
+        g_free(comment);
+    }
+    fclose(fp);
+
+    wth = test_file_open(path);
+    wtap_rec_batch_init(&batch, batch_size, 0);
+    while (wtap_read_batch(wth, &batch, &err, &err_info)) {
+        for (i = 0; i < batch.count; i++, num++) {
+            rec = &batch.recs[i];
+            check_record(&batch, i, num, offsets[num], FALSE);
+            g_assert_cmpuint(rec->rec_header.packet_header.interface_id, ==,
+                             num < MANY_RECORDS / 2 ? 0 : 1);
+            if (num % COMMENT_EVERY == 0) {
+                comment = g_strdup_printf("record %u", num);
+                g_assert_cmpstr(rec->opt_comment, ==, comment);
+                g_free(comment);
+            } else {
+                g_assert(rec->opt_comment == NULL);
+            }
+        }
+    }
+    g_assert_cmpint(err, ==, 0);
+    g_assert_cmpuint(num, ==, MANY_RECORDS);
+
+    wtap_rec_batch_cleanup(&batch);
+    wtap_close(wth);
+    g_unlink(path);
+    g_free(path);
+}
+
+static void
+read_batch_test_mixed_blocks(void)
+{
+    check_mixed_blocks(1);
+    /* Slots that had a comment get records that don't. */
+    check_mixed_blocks(COMMENT_EVERY + 1);
+    check_mixed_blocks(64);
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    wtap_init(FALSE);
+
+    g_test_add_data_func("/read_batch/pcap/boundaries",
+                         GINT_TO_POINTER(TEST_FILE_PCAP), read_batch_test_boundaries);
+    g_test_add_data_func("/read_batch/pcapng/boundaries",
+                         GINT_TO_POINTER(TEST_FILE_PCAPNG), read_batch_test_boundaries);
+    g_test_add_data_func("/read_batch/pcap/buffer_boundaries",
+                         GINT_TO_POINTER(TEST_FILE_PCAP), read_batch_test_buffer_boundaries);
+    g_test_add_data_func("/read_batch/pcapng/buffer_boundaries",
+                         GINT_TO_POINTER(TEST_FILE_PCAPNG), read_batch_test_buffer_boundaries);
+    g_test_add_func("/read_batch/pcapng/mixed_blocks", read_batch_test_mixed_blocks);
+    g_test_add_data_func("/read_batch/pcap/zero_copy",
+                         GINT_TO_POINTER(TEST_FILE_PCAP), read_batch_test_zero_copy);
+    g_test_add_data_func("/read_batch/pcapng/zero_copy",
+                         GINT_TO_POINTER(TEST_FILE_PCAPNG), read_batch_test_zero_copy);
+    g_test_add_data_func("/read_batch/pcap/deferred_error",
+                         GINT_TO_POINTER(TEST_FILE_PCAP), read_batch_test_deferred_error);
+    g_test_add_data_func("/read_batch/pcapng/deferred_error",
+                         GINT_TO_POINTER(TEST_FILE_PCAPNG), read_batch_test_deferred_error);
+    g_test_add_data_func("/read_batch/pcap/headers_only",
+                         GINT_TO_POINTER(TEST_FILE_PCAP), read_batch_test_headers_only);
+    g_test_add_data_func("/read_batch/pcapng/headers_only",
+                         GINT_TO_POINTER(TEST_FILE_PCAPNG), read_batch_test_headers_only);
+
+    ret = g_test_run();
+
+    wtap_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
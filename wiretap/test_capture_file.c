@@ -0,0 +1,198 @@
+/* test_capture_file.c
+ * Capture files written for the wiretap test programs
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+
+#include <wsutil/file_util.h>
+
+#include "test_capture_file.h"
+
+void
+test_file_write(FILE *fp, const void *data, size_t len)
+{
+    size_t written;
+
+    if (len == 0)
+        return;
+    written = fwrite(data, 1, len, fp);
+    g_assert_cmpuint(written, ==, len);
+}
+
+void
+test_file_put16(FILE *fp, guint16 v, gboolean swapped)
+{
+    if (swapped)
+        v = GUINT16_SWAP_LE_BE(v);
+    test_file_write(fp, &v, sizeof v);
+}
+
+void
+test_file_put32(FILE *fp, guint32 v, gboolean swapped)
+{
+    if (swapped)
+        v = GUINT32_SWAP_LE_BE(v);
+    test_file_write(fp, &v, sizeof v);
+}
+
+guint
+test_file_record_len(guint num)
+{
+    return 64 + (num * 13) % (TEST_FILE_MAX_DATA_LEN - 64);
+}
+
+void
+test_file_record_data(guint num, guint8 *data)
+{
+    guint i;
+
+    for (i = 0; i < test_file_record_len(num); i++)
+        data[i] = (guint8)(num * 5 + i);
+}
+
+void
+test_file_write_header(FILE *fp, test_file_format_e format, guint32 linktype,
+    gboolean swapped)
+{
+    if (format == TEST_FILE_PCAP) {
+        test_file_put32(fp, 0xa1b2c3d4, swapped);
+        test_file_put16(fp, 2, swapped);
+        test_file_put16(fp, 4, swapped);
+        test_file_put32(fp, 0, swapped);
+        test_file_put32(fp, 0, swapped);
+        test_file_put32(fp, TEST_FILE_SNAPLEN, swapped);
+        test_file_put32(fp, linktype, swapped);
+        return;
+    }
+
+    /* Section Header Block, with an unspecified section length */
+    test_file_put32(fp, 0x0A0D0D0A, swapped);
+    test_file_put32(fp, 28, swapped);
+    test_file_put32(fp, 0x1A2B3C4D, swapped);
+    test_file_put16(fp, 1, swapped);
+    test_file_put16(fp, 0, swapped);
+    test_file_put32(fp, 0xffffffff, swapped);
+    test_file_put32(fp, 0xffffffff, swapped);
+    test_file_put32(fp, 28, swapped);
+
+    /* Interface Description Block, with microsecond time stamps */
+    test_file_put32(fp, 0x00000001, swapped);
+    test_file_put32(fp, 20, swapped);
+    test_file_put16(fp, (guint16)linktype, swapped);
+    test_file_put16(fp, 0, swapped);
+    test_file_put32(fp, TEST_FILE_SNAPLEN, swapped);
+    test_file_put32(fp, 20, swapped);
+}
+
+static guint32
+epb_len(guint32 caplen)
+{
+    return 32 + caplen + (4 - caplen % 4) % 4;
+}
+
+void
+test_file_write_record_header(FILE *fp, test_file_format_e format,
+    guint32 secs, guint32 caplen, gboolean swapped)
+{
+    guint64 ts = (guint64)secs * 1000000;
+
+    if (format == TEST_FILE_PCAP) {
+        test_file_put32(fp, secs, swapped);
+        test_file_put32(fp, 0, swapped);
+        test_file_put32(fp, caplen, swapped);
+        test_file_put32(fp, caplen, swapped);
+        return;
+    }
+
+    /* Enhanced Packet Block */
+    test_file_put32(fp, 0x00000006, swapped);
+    test_file_put32(fp, epb_len(caplen), swapped);
+    test_file_put32(fp, 0, swapped);
+    test_file_put32(fp, (guint32)(ts >> 32), swapped);
+    test_file_put32(fp, (guint32)ts, swapped);
+    test_file_put32(fp, caplen, swapped);
+    test_file_put32(fp, caplen, swapped);
+}
+
+void
+test_file_write_record(FILE *fp, test_file_format_e format, guint num,
+    gboolean swapped, gboolean truncate)
+{
+    static const guint8 padding[3] = { 0, 0, 0 };
+    guint8 data[TEST_FILE_MAX_DATA_LEN];
+    guint len = test_file_record_len(num);
+
+    test_file_write_record_header(fp, format, num, len, swapped);
+    test_file_record_data(num, data);
+    if (truncate) {
+        test_file_write(fp, data, len / 2);
+        return;
+    }
+    test_file_write(fp, data, len);
+    if (format == TEST_FILE_PCAPNG) {
+        test_file_write(fp, padding, (4 - len % 4) % 4);
+        test_file_put32(fp, epb_len(len), swapped);
+    }
+}
+
+gchar *
+test_file_create(const char *prefix, FILE **fpp)
+{
+    gchar *tmpl;
+    gchar *path;
+    GError *error = NULL;
+    int fd;
+
+    tmpl = g_strdup_printf("%s_XXXXXX", prefix);
+    fd = g_file_open_tmp(tmpl, &path, &error);
+    g_assert_no_error(error);
+    g_free(tmpl);
+    ws_close(fd);
+    *fpp = ws_fopen(path, "wb");
+    g_assert(*fpp != NULL);
+    return path;
+}
+
+FILE *
+test_file_append(const char *path)
+{
+    FILE *fp;
+
+    fp = ws_fopen(path, "ab");
+    g_assert(fp != NULL);
+    return fp;
+}
+
+wtap *
+test_file_open(const char *path)
+{
+    wtap *wth;
+    int err;
+    gchar *err_info = NULL;
+
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, TRUE);
+    if (wth == NULL)
+        g_error("Can't open %s: %s", path, wtap_strerror(err));
+    return wth;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,95 @@
+/* test_capture_file.h
+ * Capture files written for the wiretap test programs
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __TEST_CAPTURE_FILE_H__
+#define __TEST_CAPTURE_FILE_H__
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#include "wtap.h"
+
+#define TEST_FILE_SNAPLEN       262144
+
+/* The most data in a record from test_file_record_data(). */
+#define TEST_FILE_MAX_DATA_LEN  256
+
+typedef enum {
+    TEST_FILE_PCAP,
+    TEST_FILE_PCAPNG
+} test_file_format_e;
+
+/* Write len bytes, failing the test if they can't all be written. */
+void test_file_write(FILE *fp, const void *data, size_t len);
+
+/*
+ * Write header fields in our byte order, or, if swapped is TRUE, in the
+ * other one.
+ */
+void test_file_put16(FILE *fp, guint16 v, gboolean swapped);
+void test_file_put32(FILE *fp, guint32 v, gboolean swapped);
+
+/*
+ * Records with different lengths and contents, so that we can tell if
+ * we get the wrong one.  Every record has at least 64 bytes, which is
+ * room for any pseudo-header that gets byte-swapped.
+ */
+guint test_file_record_len(guint num);
+void test_file_record_data(guint num, guint8 *data);
+
+/*
+ * Write the file header; for pcapng, that's a Section Header Block and
+ * an Interface Description Block with microsecond time stamps.
+ */
+void test_file_write_header(FILE *fp, test_file_format_e format,
+    guint32 linktype, gboolean swapped);
+
+/*
+ * Write the header of a record of caplen bytes, time stamped secs
+ * seconds after the epoch; for pcapng, the data has to be followed by
+ * padding and the block length, as test_file_write_record() does.
+ */
+void test_file_write_record_header(FILE *fp, test_file_format_e format,
+    guint32 secs, guint32 caplen, gboolean swapped);
+
+/*
+ * Write record num, time stamped num seconds after the epoch, or, if
+ * truncate is TRUE, only its header and half of its data.
+ */
+void test_file_write_record(FILE *fp, test_file_format_e format, guint num,
+    gboolean swapped, gboolean truncate);
+
+/*
+ * Create an empty temporary file, whose name starts with prefix, and
+ * open it for writing.  The path returned has to be freed.
+ */
+gchar *test_file_create(const char *prefix, FILE **fpp);
+
+/* Open a file made with test_file_create() to write more to it. */
+FILE *test_file_append(const char *path);
+
+/* Open a capture file for reading, failing the test if we can't. */
+wtap *test_file_open(const char *path);
+
+#endif /* __TEST_CAPTURE_FILE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
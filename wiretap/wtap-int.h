@@ -17,6 +17,7 @@
 #endif
 
 #include <wsutil/file_util.h>
+#include <wsutil/time_index.h>
 
 #include "wtap.h"
 #include "wtap_opttypes.h"
@@ -28,6 +29,8 @@ typedef gboolean (*subtype_read_func)(struct wtap*, wtap_rec *,
                                       Buffer *, int *, char **, gint64 *);
 typedef gboolean (*subtype_seek_read_func)(struct wtap*, gint64, wtap_rec *,
                                            Buffer *, int *, char **);
+typedef gboolean (*subtype_read_batch_func)(struct wtap*, wtap_rec_batch *,
+                                            int *, char **);
 
 /**
  * Struct holding data of the currently read file.
@@ -48,6 +51,7 @@ struct wtap {
 
     subtype_read_func           subtype_read;
     subtype_seek_read_func      subtype_seek_read;
+    subtype_read_batch_func     subtype_read_batch;     /**< NULL to read batches a record at a time */
     void                        (*subtype_sequential_close)(struct wtap*);
     void                        (*subtype_close)(struct wtap*);
     int                         file_encap;    /* per-file, for those
@@ -70,6 +74,13 @@ struct wtap {
     wtap_new_ipv6_callback_t    add_new_ipv6;
     wtap_new_secrets_callback_t add_new_secrets;
     GPtrArray                   *fast_seek;
+    gchar                       *seek_index_path;   /* capture file to save a seek index for, or NULL */
+    time_index_builder          *time_index_builder; /* time index being built, or NULL */
+    gchar                       *time_index_path;   /* capture file to save it for */
+    guint                       zero_copy;          /* WTAP_ZERO_COPY_ flags */
+    int                         batch_err;          /* error ending the last batch, reported with the next one */
+    gchar                       *batch_err_info;
+    gboolean                    skip_packet_data;   /* TRUE while reading a WTAP_BATCH_HEADERS_ONLY batch */
 };
 
 struct wtap_dumper;
@@ -312,6 +323,46 @@ gboolean
 wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
     gchar **err_info);
 
+/*
+ * Like wtap_read_packet_bytes(), but if the file is being read through
+ * a memory mapping, point rec->data at the packet data in the mapping
+ * rather than copying it into the Buffer.  Returns a pointer to the
+ * packet data, wherever it is, or NULL on an error.  Only for use by
+ * read routines that don't modify the packet data after reading it.
+ */
+guint8 *
+wtap_read_packet_bytes_mapped(FILE_T fh, wtap_rec *rec, Buffer *buf,
+    guint length, int *err, gchar **err_info);
+
+/*
+ * Routines for wth->subtype_read_batch implementations, which read
+ * records into the batch until it's full, returning TRUE, or until the
+ * end of the file or an error, returning FALSE with *err set to 0 or
+ * the error.
+ *
+ * wtap_batch_start_record() starts a record in the next slot of the
+ * batch, as wtap_read() does before calling subtype_read;
+ * wtap_batch_add_data() copies its data into batch->data, returning a
+ * pointer to the copy, which is valid until the next record's data is
+ * added; and wtap_batch_end_record(), given the offset of the record,
+ * finishes it as wtap_read() does after calling subtype_read.
+ *
+ * wtap_batch_read_record() reads the next record into the batch with
+ * subtype_read, for records the implementation doesn't handle itself.
+ */
+wtap_rec *
+wtap_batch_start_record(wtap *wth, wtap_rec_batch *batch);
+
+guint8 *
+wtap_batch_add_data(wtap_rec_batch *batch, const guint8 *data, guint len);
+
+void
+wtap_batch_end_record(wtap *wth, wtap_rec_batch *batch, gint64 offset);
+
+gboolean
+wtap_batch_read_record(wtap *wth, wtap_rec_batch *batch, int *err,
+    gchar **err_info);
+
 /*
  * Implementation of wth->subtype_read that reads the full file contents
  * as a single packet.
@@ -1192,6 +1192,53 @@ wtap_strerror(int err)
 		return g_strerror(err);
 }
 
+/*
+ * Get the number of blocks of each kind that a time index point has
+ * to agree with the reader on; see time_index.h.
+ */
+static void
+wtap_time_index_counts(wtap *wth, time_index_counts *counts)
+{
+	counts->sections = wth->shb_hdrs->len;
+	counts->interfaces = wth->interface_data->len;
+	counts->metadata = 0;
+	if (wth->nrb_hdrs != NULL)
+		counts->metadata += wth->nrb_hdrs->len;
+	if (wth->dsbs != NULL)
+		counts->metadata += wth->dsbs->len;
+}
+
+static void
+wtap_time_index_add(wtap *wth, const wtap_rec *rec, gint64 offset,
+    const time_index_counts *counts)
+{
+	time_index_builder_add(wth->time_index_builder, (guint64)offset,
+	    (rec->presence_flags & WTAP_HAS_TS) ? &rec->ts : NULL, counts);
+}
+
+static void
+wtap_time_index_save(wtap *wth)
+{
+	ws_statb64 statb;
+	int err;
+
+	/* As with seek indexes, failing to write one isn't an error. */
+	if (ws_stat64(wth->time_index_path, &statb) == 0)
+		time_index_builder_save(wth->time_index_builder,
+		    wth->time_index_path, (guint64)statb.st_size, &err);
+}
+
+static void
+wtap_time_index_discard(wtap *wth)
+{
+	if (wth->time_index_builder != NULL) {
+		time_index_builder_free(wth->time_index_builder);
+		wth->time_index_builder = NULL;
+	}
+	g_free(wth->time_index_path);
+	wth->time_index_path = NULL;
+}
+
 /* Close only the sequential side, freeing up memory it uses.
 
    Note that we do *not* want to call the subtype's close function,
@@ -1207,9 +1254,22 @@ wtap_sequential_close(wtap *wth)
 		(*wth->subtype_sequential_close)(wth);
 
 	if (wth->fh != NULL) {
+		/*
+		 * If we read all the way to the end, we have all the
+		 * fast seek points there are; save them if asked.
+		 */
+		if (wth->seek_index_path != NULL && file_eof(wth->fh))
+			file_seek_index_save(wth->fh, wth->seek_index_path);
+		if (wth->time_index_builder != NULL && file_eof(wth->fh))
+			wtap_time_index_save(wth);
 		file_close(wth->fh);
 		wth->fh = NULL;
 	}
+	g_free(wth->seek_index_path);
+	wth->seek_index_path = NULL;
+	wtap_time_index_discard(wth);
+	g_free(wth->batch_err_info);
+	wth->batch_err_info = NULL;
 }
 
 static void
@@ -1301,6 +1361,38 @@ wtapng_process_dsb(wtap *wth, wtap_block_t dsb)
 		wth->add_new_secrets(dsb_mand->secrets_type, dsb_mand->secrets_data, dsb_mand->secrets_len);
 }
 
+void
+wtap_set_zero_copy(wtap *wth, guint flags)
+{
+	wth->zero_copy = flags;
+	if (wth->fh != NULL)
+		file_set_mapped(wth->fh,
+		    (flags & WTAP_ZERO_COPY_SEQUENTIAL) != 0);
+	if (wth->random_fh != NULL)
+		file_set_mapped(wth->random_fh,
+		    (flags & WTAP_ZERO_COPY_RANDOM) != 0);
+}
+
+const guint8 *
+wtap_rec_data(const wtap_rec *rec, Buffer *buf)
+{
+	return rec->data != NULL ? rec->data : ws_buffer_start_ptr(buf);
+}
+
+/*
+ * If a read routine left the record data in the mapped file, but the
+ * caller didn't ask for that, copy it into the Buffer.
+ */
+static void
+wtap_rec_copy_mapped_data(wtap_rec *rec, Buffer *buf)
+{
+	guint32 length = rec->rec_header.packet_header.caplen;
+
+	ws_buffer_assure_space(buf, length);
+	memcpy(ws_buffer_start_ptr(buf), rec->data, length);
+	rec->data = NULL;
+}
+
 gboolean
 wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 	gchar **err_info, gint64 *offset)
@@ -1317,6 +1409,7 @@ wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 	 */
 	rec->rec_header.packet_header.pkt_encap = wth->file_encap;
 	rec->tsprec = wth->file_tsprec;
+	rec->data = NULL;
 
 	*err = 0;
 	*err_info = NULL;
@@ -1355,9 +1448,351 @@ wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
 		g_assert(rec->rec_header.packet_header.pkt_encap != WTAP_ENCAP_PER_PACKET);
 	}
 
+	if (rec->data != NULL && !(wth->zero_copy & WTAP_ZERO_COPY_SEQUENTIAL))
+		wtap_rec_copy_mapped_data(rec, buf);
+
+	if (wth->time_index_builder != NULL) {
+		time_index_counts counts;
+
+		wtap_time_index_counts(wth, &counts);
+		wtap_time_index_add(wth, rec, *offset, &counts);
+	}
+
 	return TRUE;	/* success */
 }
 
+/*
+ * Check that the record at a time index point is the one the index says
+ * it is, leaving the file positioned at it if so.
+ */
+static gboolean
+wtap_time_index_check_point(wtap *wth, const time_index_point *point,
+    gboolean *matched, int *err, gchar **err_info)
+{
+	wtap_rec rec;
+	Buffer buf;
+	time_index_counts before, after;
+	gint64 offset;
+	gboolean ok;
+
+	*matched = FALSE;
+	if (file_seek(wth->fh, (gint64)point->offset, SEEK_SET, err) == -1)
+		return FALSE;
+
+	wtap_time_index_counts(wth, &before);
+	wtap_rec_init(&rec);
+	ws_buffer_init(&buf, 1514);
+	rec.rec_header.packet_header.pkt_encap = wth->file_encap;
+	rec.tsprec = wth->file_tsprec;
+	rec.data = NULL;
+	*err = 0;
+	*err_info = NULL;
+	ok = wth->subtype_read(wth, &rec, &buf, err, err_info, &offset);
+	if (ok && offset == (gint64)point->offset &&
+	    ((rec.presence_flags & WTAP_HAS_TS) != 0) == point->has_ts &&
+	    (!point->has_ts || nstime_cmp(&rec.ts, &point->ts) == 0))
+		*matched = TRUE;
+	wtap_rec_cleanup(&rec);
+	ws_buffer_free(&buf);
+	g_free(*err_info);
+	*err = 0;
+	*err_info = NULL;
+
+	/*
+	 * If the read went through blocks that the read routine keeps,
+	 * the index is for some other file, and we can't go back.
+	 */
+	wtap_time_index_counts(wth, &after);
+	if (after.sections != before.sections ||
+	    after.interfaces != before.interfaces ||
+	    after.metadata != before.metadata) {
+		*err = WTAP_ERR_BAD_FILE;
+		*err_info = g_strdup("the capture file doesn't match its time index");
+		return FALSE;
+	}
+
+	/* Go back to the record, so that it's the next one read. */
+	if (*matched &&
+	    file_seek(wth->fh, (gint64)point->offset, SEEK_SET, err) == -1)
+		return FALSE;
+	return TRUE;
+}
+
+gboolean
+wtap_seek_to_time(wtap *wth, const char *filename, const nstime_t *start,
+    const nstime_t *stop, guint32 *skipped, gint64 *stop_offset,
+    int *err, gchar **err_info)
+{
+	ws_statb64 statb;
+	time_index *ti;
+	time_index_counts counts;
+	time_index_point start_point, stop_point;
+	gboolean have_start, have_stop, matched;
+	gint64 here;
+
+	*skipped = 0;
+	*stop_offset = -1;
+	*err = 0;
+	*err_info = NULL;
+
+	if (wth->fh == NULL || wth->ispipe ||
+	    (wth->file_type_subtype != WTAP_FILE_TYPE_SUBTYPE_PCAP &&
+	     wth->file_type_subtype != WTAP_FILE_TYPE_SUBTYPE_PCAP_NSEC &&
+	     wth->file_type_subtype != WTAP_FILE_TYPE_SUBTYPE_PCAPNG))
+		return TRUE;
+	if (ws_stat64(filename, &statb) != 0)
+		return TRUE;
+	ti = time_index_load(filename, (guint64)statb.st_size);
+	if (ti == NULL)
+		return TRUE;
+
+	wtap_time_index_counts(wth, &counts);
+	have_start = start != NULL &&
+	    time_index_find_start(ti, start, &counts, &start_point) &&
+	    start_point.frame_num > 1 && start_point.frame_num - 1 <= G_MAXUINT32;
+	have_stop = stop != NULL && time_index_find_stop(ti, stop, &stop_point);
+	time_index_free(ti);
+	if (!have_start && !have_stop)
+		return TRUE;
+
+	/*
+	 * The index matches the file's size; make sure it's really for
+	 * this file by looking at the records it points to, then go to
+	 * the first record we need.
+	 */
+	here = file_tell(wth->fh);
+	if (have_stop) {
+		if (!wtap_time_index_check_point(wth, &stop_point, &matched,
+		    err, err_info))
+			return FALSE;
+		if (!matched)
+			return file_seek(wth->fh, here, SEEK_SET, err) != -1;
+	}
+	if (have_start) {
+		if (!wtap_time_index_check_point(wth, &start_point, &matched,
+		    err, err_info))
+			return FALSE;
+		if (!matched)
+			return file_seek(wth->fh, here, SEEK_SET, err) != -1;
+
+		/* We won't see every record, so we can't index the file. */
+		wtap_time_index_discard(wth);
+		*skipped = (guint32)(start_point.frame_num - 1);
+	} else {
+		if (file_seek(wth->fh, here, SEEK_SET, err) == -1)
+			return FALSE;
+	}
+	if (have_stop)
+		*stop_offset = (gint64)stop_point.offset;
+	return TRUE;
+}
+
+/* data_starts value for a record with no data in batch->data */
+#define WTAP_BATCH_NO_DATA	G_MAXSIZE
+
+void
+wtap_rec_batch_init(wtap_rec_batch *batch, guint size, guint flags)
+{
+	guint i;
+
+	batch->size = size;
+	batch->count = 0;
+	batch->flags = flags;
+	batch->recs = g_new(wtap_rec, size);
+	batch->offsets = g_new(gint64, size);
+	batch->data_starts = g_new(gsize, size);
+	for (i = 0; i < size; i++)
+		wtap_rec_init(&batch->recs[i]);
+	ws_buffer_init(&batch->data, (flags & WTAP_BATCH_HEADERS_ONLY) ? 0 : size * 1514);
+	ws_buffer_init(&batch->buf, 1514);
+}
+
+void
+wtap_rec_batch_cleanup(wtap_rec_batch *batch)
+{
+	guint i;
+
+	for (i = 0; i < batch->size; i++)
+		wtap_rec_cleanup(&batch->recs[i]);
+	g_free(batch->recs);
+	g_free(batch->offsets);
+	g_free(batch->data_starts);
+	ws_buffer_free(&batch->data);
+	ws_buffer_free(&batch->buf);
+	batch->recs = NULL;
+	batch->offsets = NULL;
+	batch->data_starts = NULL;
+	batch->size = 0;
+	batch->count = 0;
+}
+
+wtap_rec *
+wtap_batch_start_record(wtap *wth, wtap_rec_batch *batch)
+{
+	wtap_rec *rec = &batch->recs[batch->count];
+
+	/* As in wtap_read(). */
+	rec->rec_header.packet_header.pkt_encap = wth->file_encap;
+	rec->tsprec = wth->file_tsprec;
+	rec->data = NULL;
+	batch->data_starts[batch->count] = WTAP_BATCH_NO_DATA;
+	return rec;
+}
+
+guint8 *
+wtap_batch_add_data(wtap_rec_batch *batch, const guint8 *data, guint len)
+{
+	gsize start = ws_buffer_length(&batch->data);
+
+	batch->data_starts[batch->count] = start;
+	ws_buffer_append(&batch->data, (guint8 *)data, len);
+	return ws_buffer_start_ptr(&batch->data) + start;
+}
+
+void
+wtap_batch_end_record(wtap *wth, wtap_rec_batch *batch, gint64 offset)
+{
+	wtap_rec *rec = &batch->recs[batch->count];
+
+	if (rec->rec_type == REC_TYPE_PACKET) {
+		/*
+		 * As in wtap_read(), the captured data length can't be
+		 * bigger than the actual data length, and the read
+		 * routine must have set the encapsulation type.
+		 */
+		if (rec->rec_header.packet_header.caplen > rec->rec_header.packet_header.len)
+			rec->rec_header.packet_header.caplen = rec->rec_header.packet_header.len;
+		g_assert(rec->rec_header.packet_header.pkt_encap != WTAP_ENCAP_PER_PACKET);
+	}
+
+	if (wth->time_index_builder != NULL) {
+		time_index_counts counts;
+
+		wtap_time_index_counts(wth, &counts);
+		wtap_time_index_add(wth, rec, offset, &counts);
+	}
+	batch->offsets[batch->count] = offset;
+	batch->count++;
+}
+
+/*
+ * The length of the data of a record read by subtype_read.
+ */
+static guint32
+wtap_rec_data_len(const wtap_rec *rec)
+{
+	switch (rec->rec_type) {
+
+	case REC_TYPE_PACKET:
+		return rec->rec_header.packet_header.caplen;
+
+	case REC_TYPE_FT_SPECIFIC_EVENT:
+	case REC_TYPE_FT_SPECIFIC_REPORT:
+		return rec->rec_header.ft_specific_header.record_len;
+
+	case REC_TYPE_SYSCALL:
+		return rec->rec_header.syscall_header.event_filelen;
+	}
+	return 0;
+}
+
+gboolean
+wtap_batch_read_record(wtap *wth, wtap_rec_batch *batch, int *err,
+    gchar **err_info)
+{
+	wtap_rec *rec;
+	gint64 offset;
+
+	rec = wtap_batch_start_record(wth, batch);
+	if (!wth->subtype_read(wth, rec, &batch->buf, err, err_info, &offset))
+		return FALSE;
+
+	/*
+	 * Copy the data into batch->data, unless it's been left in
+	 * the mapping and the caller asked for that.
+	 */
+	if (!(batch->flags & WTAP_BATCH_HEADERS_ONLY) &&
+	    (rec->data == NULL || !(wth->zero_copy & WTAP_ZERO_COPY_SEQUENTIAL))) {
+		wtap_batch_add_data(batch, wtap_rec_data(rec, &batch->buf),
+		    wtap_rec_data_len(rec));
+		rec->data = NULL;
+	}
+	wtap_batch_end_record(wth, batch, offset);
+	return TRUE;
+}
+
+gboolean
+wtap_read_batch(wtap *wth, wtap_rec_batch *batch, int *err,
+    gchar **err_info)
+{
+	guint8 *data;
+	guint i;
+
+	batch->count = 0;
+	ws_buffer_clean(&batch->data);
+	*err = 0;
+	*err_info = NULL;
+
+	/*
+	 * If the last batch was cut short by an error, report it now,
+	 * as wtap_read() would have on the read after the last record
+	 * it returned.
+	 */
+	if (wth->batch_err != 0) {
+		*err = wth->batch_err;
+		*err_info = wth->batch_err_info;
+		wth->batch_err = 0;
+		wth->batch_err_info = NULL;
+		return FALSE;
+	}
+
+	/*
+	 * The pcap and pcapng read routines look at skip_packet_data
+	 * and, if it's set, skip over the packet data rather than
+	 * reading it.
+	 */
+	wth->skip_packet_data = (batch->flags & WTAP_BATCH_HEADERS_ONLY) != 0;
+	if (wth->subtype_read_batch != NULL) {
+		wth->subtype_read_batch(wth, batch, err, err_info);
+	} else {
+		while (batch->count < batch->size) {
+			if (!wtap_batch_read_record(wth, batch, err, err_info))
+				break;
+		}
+	}
+	wth->skip_packet_data = FALSE;
+
+	/*
+	 * Now that batch->data won't move any more, point the records
+	 * at their data.
+	 */
+	data = ws_buffer_start_ptr(&batch->data);
+	for (i = 0; i < batch->count; i++) {
+		if (batch->data_starts[i] != WTAP_BATCH_NO_DATA)
+			batch->recs[i].data = data + batch->data_starts[i];
+	}
+
+	/*
+	 * If we stopped early without an error indication, we hit the
+	 * end of the file; see if there's any deferred error, as
+	 * wtap_read() does.
+	 */
+	if (batch->count < batch->size && *err == 0)
+		*err = file_error(wth->fh, err_info);
+
+	if (batch->count == 0)
+		return FALSE;
+
+	if (*err != 0) {
+		/* Return what we got, and the error next time. */
+		wth->batch_err = *err;
+		wth->batch_err_info = *err_info;
+		*err = 0;
+		*err_info = NULL;
+	}
+	return TRUE;
+}
+
 /*
  * Read a given number of bytes from a file into a buffer or, if
  * buf is NULL, just discard them.
@@ -1437,6 +1872,22 @@ wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
 	    err_info);
 }
 
+guint8 *
+wtap_read_packet_bytes_mapped(FILE_T fh, wtap_rec *rec, Buffer *buf,
+    guint length, int *err, gchar **err_info)
+{
+	guint8 *data;
+
+	data = file_read_mapped(length, fh);
+	if (data == NULL) {
+		if (!wtap_read_packet_bytes(fh, buf, length, err, err_info))
+			return NULL;
+		return ws_buffer_start_ptr(buf);
+	}
+	rec->data = data;
+	return data;
+}
+
 /*
  * Return an approximation of the amount of data we've read sequentially
  * from the file so far.  (gint64, in case that's 64 bits.)
@@ -1478,6 +1929,7 @@ wtap_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec, Buffer *buf,
 	 */
 	rec->rec_header.packet_header.pkt_encap = wth->file_encap;
 	rec->tsprec = wth->file_tsprec;
+	rec->data = NULL;
 
 	*err = 0;
 	*err_info = NULL;
@@ -1504,6 +1956,9 @@ wtap_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec, Buffer *buf,
 		g_assert(rec->rec_header.packet_header.pkt_encap != WTAP_ENCAP_PER_PACKET);
 	}
 
+	if (rec->data != NULL && !(wth->zero_copy & WTAP_ZERO_COPY_RANDOM))
+		wtap_rec_copy_mapped_data(rec, buf);
+
 	return TRUE;
 }
 
@@ -1401,6 +1401,12 @@ typedef struct {
      * a buffer for the options for each record.
      */
     Buffer    options_buf;      /* file-type specific data */
+
+    /*
+     * If the record data was left in a memory-mapped file rather than
+     * copied into the Buffer, a pointer to it; see wtap_set_zero_copy().
+     */
+    const guint8 *data;
 } wtap_rec;
 
 /*
@@ -1751,6 +1757,28 @@ WS_DLL_PUBLIC
 struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err,
     gchar **err_info, gboolean do_random);
 
+/**
+ * Save a seek index next to compressed capture files once they've been
+ * read to the end, so that later random-access opens of the same files
+ * can seek without decompressing everything first.  Indexes that are
+ * already there are always used; this only controls whether new ones
+ * get written.  It's off by default.
+ *
+ * @param save TRUE to save seek indexes, FALSE not to
+ */
+WS_DLL_PUBLIC
+void wtap_set_save_seek_index(gboolean save);
+
+/**
+ * Save a time index next to pcap and pcapng files once they've been read
+ * to the end, so that wtap_seek_to_time() can skip to a time range in
+ * them later.  It's off by default.
+ *
+ * @param save TRUE to save time indexes, FALSE not to
+ */
+WS_DLL_PUBLIC
+void wtap_set_save_time_index(gboolean save);
+
 /**
  * If we were compiled with zlib and we're at EOF, unset EOF so that
  * wtap_read/gzread has a chance to succeed. This is necessary if
@@ -1798,6 +1826,34 @@ WS_DLL_PUBLIC
 gboolean wtap_read(wtap *wth, wtap_rec *rec, Buffer *buf, int *err,
     gchar **err_info, gint64 *offset);
 
+/** Use the time index of a capture file, if it has an up-to-date one,
+ * to skip the records at the beginning of the file that are earlier than
+ * start, and to find where the records that are earlier than stop end.
+ * Records without a time stamp count as being outside the time range.
+ * This must be called before the first read, and if nothing can be
+ * skipped, the reads start at the beginning of the file as usual.
+ *
+ * @wth a wtap * returned by a call that opened a file for reading.
+ * @param filename the name the file was opened with.
+ * @param start the start of the time range, or NULL if it has none.
+ * @param stop the end of the time range, which isn't part of it, or
+ * NULL if it has none.
+ * @param skipped set to the number of records skipped; the frame number
+ * of the next record read is one more than that.
+ * @param stop_offset set to the offset, as returned by wtap_read(), of
+ * the first record from which on no record is in the time range, or -1
+ * if the index doesn't show one.
+ * @param err a positive "errno" value, or a negative number indicating
+ * the type of error, if seeking failed.
+ * @param err_info for some errors, a string giving more details of
+ * the error
+ * @return TRUE on success, FALSE on failure.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_seek_to_time(wtap *wth, const char *filename,
+    const nstime_t *start, const nstime_t *stop, guint32 *skipped,
+    gint64 *stop_offset, int *err, gchar **err_info);
+
 /** Read the record at a specified offset in a capture file, filling in
  * *phdr and *buf.
  *
@@ -1818,6 +1874,95 @@ WS_DLL_PUBLIC
 gboolean wtap_seek_read(wtap *wth, gint64 seek_off, wtap_rec *rec,
     Buffer *buf, int *err, gchar **err_info);
 
+/*
+ * A batch of records, read by wtap_read_batch().
+ */
+typedef struct {
+    guint     size;         /* number of records the batch can hold */
+    guint     count;        /* number of records read by the last wtap_read_batch() */
+    guint     flags;        /* WTAP_BATCH_ flags */
+    wtap_rec  *recs;        /* the records; each one's data is at its data pointer */
+    gint64    *offsets;     /* their offsets, for wtap_seek_read() */
+    Buffer    data;         /* the records' data, one after another */
+    gsize     *data_starts; /* where each record's data starts in data, while reading */
+    Buffer    buf;          /* for reading records one at a time */
+} wtap_rec_batch;
+
+/*
+ * Flags for wtap_rec_batch_init().
+ */
+#define WTAP_BATCH_HEADERS_ONLY     0x00000001  /* record data isn't needed */
+
+/** Initialize a batch that can hold up to size records.
+ *
+ * With WTAP_BATCH_HEADERS_ONLY, the records' data pointers are left NULL,
+ * and readers that can skip the data of packet records (currently pcap
+ * and pcapng) do so, leaving any pseudo-header information derived from
+ * it unset; that's for callers such as capinfos that look only at the
+ * record headers.
+ */
+WS_DLL_PUBLIC
+void wtap_rec_batch_init(wtap_rec_batch *batch, guint size, guint flags);
+
+/** Free what wtap_rec_batch_init() allocated. */
+WS_DLL_PUBLIC
+void wtap_rec_batch_cleanup(wtap_rec_batch *batch);
+
+/** Read up to batch->size records into batch, setting batch->count to
+ * the number read; the records are those that successive wtap_read()
+ * calls would have returned.  Each record's data pointer points to its
+ * data, which is in batch->data or, with WTAP_ZERO_COPY_SEQUENTIAL, may
+ * be in the file's mapping.  The records and their data are valid until
+ * the next call with the same batch.
+ *
+ * The pcap and pcapng readers parse as many records as they can straight
+ * out of the data the file has already buffered, copying their data into
+ * batch->data; other formats are read a record at a time, as with
+ * wtap_read().
+ *
+ * @return TRUE if any records were read, FALSE at the end of the file or
+ * on an error.  If an error ends a batch early, the records before it are
+ * returned, and the error is reported by the next call.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_read_batch(wtap *wth, wtap_rec_batch *batch, int *err,
+    gchar **err_info);
+
+/*
+ * Flags for wtap_set_zero_copy().
+ */
+#define WTAP_ZERO_COPY_SEQUENTIAL   0x00000001  /* wtap_read() */
+#define WTAP_ZERO_COPY_RANDOM       0x00000002  /* wtap_seek_read() */
+
+/** For the reads given by flags, read the file through a memory mapping,
+ * if it's an uncompressed file in a format that supports that (currently
+ * pcap and pcapng), and leave the record data in the mapping rather than
+ * copying it into the Buffer.  Only the sides of the file used by those
+ * reads are mapped; the others, and all of them with flags of 0, are read
+ * normally.
+ *
+ * Callers that set flags must get at the record data with wtap_rec_data().
+ * The data is valid until the side of the file it was read from is
+ * closed, i.e. until wtap_sequential_close() for data read by wtap_read()
+ * or wtap_close() for data read by either, so it need not be copied to
+ * be used after the next read.  Records that need rewriting as they're
+ * read, such as byte-swapped Linux cooked capture or USB headers, are
+ * still copied.
+ *
+ * The mapping shares the file's pages with the page cache, and the
+ * process gets a SIGBUS if it touches data past the end of a file that
+ * has been truncated, so this should only be used, at the user's request,
+ * on files that aren't being truncated or rewritten while they're read.
+ */
+WS_DLL_PUBLIC
+void wtap_set_zero_copy(wtap *wth, guint flags);
+
+/** Return a pointer to the data for a record read by wtap_read() or
+ * wtap_seek_read() into rec and buf: either the data left in the mapped
+ * file or the start of the Buffer. */
+WS_DLL_PUBLIC
+const guint8 *wtap_rec_data(const wtap_rec *rec, Buffer *buf);
+
 /*** initialize a wtap_rec structure ***/
 WS_DLL_PUBLIC
 void wtap_rec_init(wtap_rec *rec);
@@ -1831,7 +1976,9 @@ void wtap_rec_cleanup(wtap_rec *rec);
  */
 typedef enum {
     WTAP_UNCOMPRESSED,
-    WTAP_GZIP_COMPRESSED
+    WTAP_GZIP_COMPRESSED,
+    WTAP_ZSTD_COMPRESSED,
+    WTAP_LZ4_COMPRESSED
 } wtap_compression_type;
 
 WS_DLL_PUBLIC
@@ -0,0 +1,558 @@
+/* zero_copy_test.c
+ * Standalone program to test reading packet data from a memory mapping
+ * of the capture file with wtap_set_zero_copy().
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <wsutil/file_util.h>
+
+#include "wtap.h"
+#include "test_capture_file.h"
+
+/* Can reads leave the data in the file at all? */
+#ifdef HAVE_MMAP
+#define ZERO_COPY_SUPPORTED TRUE
+#else
+#define ZERO_COPY_SUPPORTED FALSE
+#endif
+
+#define LINKTYPE_ETHERNET           1
+#define LINKTYPE_LINUX_SLL          113
+#define LINKTYPE_USB_LINUX          189
+#define LINKTYPE_USB_LINUX_MMAPPED  220
+#define LINKTYPE_NFLOG              239
+
+static wtap *
+open_file(const char *path, guint flags)
+{
+    wtap *wth;
+
+    wth = test_file_open(path);
+    wtap_set_zero_copy(wth, flags);
+    return wth;
+}
+
+static void
+write_record(FILE *fp, guint num)
+{
+    test_file_write_record(fp, TEST_FILE_PCAP, num, FALSE, FALSE);
+}
+
+/*
+ * Check that we read record num, and that its data was left in the
+ * file if mapped is TRUE and copied into the Buffer otherwise.
+ */
+static void
+check_record(const wtap_rec *rec, Buffer *buf, guint num, gboolean mapped)
+{
+    guint8 expected[TEST_FILE_MAX_DATA_LEN];
+
+    g_assert_cmpuint(rec->rec_type, ==, REC_TYPE_PACKET);
+    g_assert_cmpuint(rec->rec_header.packet_header.caplen, ==, test_file_record_len(num));
+    test_file_record_data(num, expected);
+    g_assert(memcmp(wtap_rec_data(rec, buf), expected, test_file_record_len(num)) == 0);
+    g_assert((rec->data != NULL) == (mapped && ZERO_COPY_SUPPORTED));
+}
+
+static void
+read_record(wtap *wth, wtap_rec *rec, Buffer *buf, guint num,
+    gboolean mapped, gint64 *offset)
+{
+    int err;
+    gchar *err_info = NULL;
+
+    if (!wtap_read(wth, rec, buf, &err, &err_info, offset))
+        g_error("Can't read record %u: %s", num, wtap_strerror(err));
+    check_record(rec, buf, num, mapped);
+}
+
+static void
+read_eof(wtap *wth, wtap_rec *rec, Buffer *buf)
+{
+    int err;
+    gchar *err_info = NULL;
+    gint64 offset;
+
+    g_assert(!wtap_read(wth, rec, buf, &err, &err_info, &offset));
+    g_assert_cmpint(err, ==, 0);
+}
+
+#define NUM_RECORDS 10
+
+/*
+ * Read a file sequentially and then randomly, and check that only the
+ * reads asked for with flags leave the data in the file.
+ */
+static void
+check_flags(guint flags)
+{
+    FILE *fp;
+    gchar *path;
+    wtap *wth;
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    gchar *err_info = NULL;
+    gint64 offsets[NUM_RECORDS];
+    const guint8 *first = NULL;
+    guint8 expected[TEST_FILE_MAX_DATA_LEN];
+    guint i;
+
+    path = test_file_create("zero_copy_test", &fp);
+    test_file_write_header(fp, TEST_FILE_PCAP, LINKTYPE_ETHERNET, FALSE);
+    for (i = 0; i < NUM_RECORDS; i++)
+        write_record(fp, i);
+    fclose(fp);
+
+    wth = open_file(path, flags);
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+
+    for (i = 0; i < NUM_RECORDS; i++) {
+        read_record(wth, &rec, &buf, i,
+                    (flags & WTAP_ZERO_COPY_SEQUENTIAL) != 0, &offsets[i]);
+        if (i == 0)
+            first = rec.data;
+    }
+    read_eof(wth, &rec, &buf);
+
+    /* Data left in the file is still there after later reads. */
+    if (first != NULL) {
+        test_file_record_data(0, expected);
+        g_assert(memcmp(first, expected, test_file_record_len(0)) == 0);
+    }
+
+    for (i = NUM_RECORDS; i-- > 0; ) {
+        if (!wtap_seek_read(wth, offsets[i], &rec, &buf, &err, &err_info))
+            g_error("Can't seek to record %u: %s", i, wtap_strerror(err));
+        check_record(&rec, &buf, i, (flags & WTAP_ZERO_COPY_RANDOM) != 0);
+    }
+
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+    wtap_close(wth);
+    g_unlink(path);
+    g_free(path);
+}
+
+static void
+zero_copy_test_both(void)
+{
+    check_flags(WTAP_ZERO_COPY_SEQUENTIAL|WTAP_ZERO_COPY_RANDOM);
+}
+
+static void
+zero_copy_test_sequential(void)
+{
+    check_flags(WTAP_ZERO_COPY_SEQUENTIAL);
+}
+
+static void
+zero_copy_test_random(void)
+{
+    check_flags(WTAP_ZERO_COPY_RANDOM);
+}
+
+static void
+zero_copy_test_not_asked(void)
+{
+    check_flags(0);
+}
+
+/*
+ * Records whose headers pcap_read_post_process() byte-swaps; the bytes
+ * in each of the ranges are reversed when the file is byte-swapped.
+ */
+typedef struct {
+    guint offset;
+    guint len;
+} swap_range_t;
+
+typedef struct {
+    const char         *name;
+    guint32             linktype;
+    guint               len;
+    const swap_range_t *swaps;
+} swapped_record_t;
+
+static const swap_range_t sll_swaps[] = {
+    { 16, 4 },          /* CAN ID */
+    { 0, 0 }
+};
+
+static const swap_range_t usb_swaps[] = {
+    { 0, 8 }, { 12, 2 }, { 16, 8 }, { 24, 4 }, { 28, 4 }, { 32, 4 }, { 36, 4 },
+    { 0, 0 }
+};
+
+static const swap_range_t usb_mmapped_swaps[] = {
+    { 0, 8 }, { 12, 2 }, { 16, 8 }, { 24, 4 }, { 28, 4 }, { 32, 4 }, { 36, 4 },
+    { 40, 4 }, { 44, 4 }, { 48, 4 }, { 52, 4 },
+    { 0, 0 }
+};
+
+static const swap_range_t nflog_swaps[] = {
+    { 4, 2 }, { 6, 2 }, /* TLV length and type */
+    { 0, 0 }
+};
+
+static const swapped_record_t swapped_records[] = {
+    { "SLL",                LINKTYPE_LINUX_SLL,         24, sll_swaps },
+    { "USB",                LINKTYPE_USB_LINUX,         48, usb_swaps },
+    { "USB memory-mapped",  LINKTYPE_USB_LINUX_MMAPPED, 64, usb_mmapped_swaps },
+    { "NFLOG",              LINKTYPE_NFLOG,             12, nflog_swaps },
+};
+
+static void
+swapped_record_data(const swapped_record_t *sr, guint8 *data)
+{
+    guint i;
+
+    for (i = 0; i < sr->len; i++)
+        data[i] = (guint8)i;
+    switch (sr->linktype) {
+
+    case LINKTYPE_LINUX_SLL:
+        /* A CAN frame, the only one whose header gets swapped. */
+        data[14] = 0x00;
+        data[15] = 0x0c;
+        break;
+
+    case LINKTYPE_NFLOG:
+        /* Version 0, with one 8-byte TLV. */
+        data[1] = 0;
+        data[4] = 0x00;
+        data[5] = 0x08;
+        data[6] = 0x00;
+        data[7] = 0x01;
+        break;
+    }
+}
+
+static void
+check_swapped_record(const swapped_record_t *sr, gboolean swapped)
+{
+    FILE *fp;
+    gchar *path;
+    wtap *wth;
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    gchar *err_info = NULL;
+    gint64 offset;
+    guint8 data[TEST_FILE_MAX_DATA_LEN];
+    guint8 expected[TEST_FILE_MAX_DATA_LEN];
+    const swap_range_t *swap;
+    guint i;
+
+    swapped_record_data(sr, data);
+    memcpy(expected, data, sr->len);
+    if (swapped) {
+        for (swap = sr->swaps; swap->len != 0; swap++) {
+            for (i = 0; i < swap->len; i++)
+                expected[swap->offset + i] = data[swap->offset + swap->len - 1 - i];
+        }
+    }
+
+    path = test_file_create("zero_copy_test", &fp);
+    test_file_write_header(fp, TEST_FILE_PCAP, sr->linktype, swapped);
+    test_file_write_record_header(fp, TEST_FILE_PCAP, 0, sr->len, swapped);
+    test_file_write(fp, data, sr->len);
+    fclose(fp);
+
+    wth = open_file(path, WTAP_ZERO_COPY_SEQUENTIAL|WTAP_ZERO_COPY_RANDOM);
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+
+    /* Rewritten data has to be copied; anything else can stay put. */
+    if (!wtap_read(wth, &rec, &buf, &err, &err_info, &offset))
+        g_error("Can't read the %s record: %s", sr->name, wtap_strerror(err));
+    g_assert_cmpuint(rec.rec_header.packet_header.caplen, ==, sr->len);
+    g_assert(memcmp(wtap_rec_data(&rec, &buf), expected, sr->len) == 0);
+    g_assert((rec.data != NULL) == (!swapped && ZERO_COPY_SUPPORTED));
+
+    if (!wtap_seek_read(wth, offset, &rec, &buf, &err, &err_info))
+        g_error("Can't seek to the %s record: %s", sr->name, wtap_strerror(err));
+    g_assert(memcmp(wtap_rec_data(&rec, &buf), expected, sr->len) == 0);
+    g_assert((rec.data != NULL) == (!swapped && ZERO_COPY_SUPPORTED));
+
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+    wtap_close(wth);
+    g_unlink(path);
+    g_free(path);
+}
+
+static void
+zero_copy_test_byte_swapped(void)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(swapped_records); i++) {
+        check_swapped_record(&swapped_records[i], TRUE);
+        check_swapped_record(&swapped_records[i], FALSE);
+    }
+}
+
+/*
+ * A file that grows after we've read to the end of the mapping is read
+ * the usual way from there on.
+ */
+static void
+zero_copy_test_grow_at_end(void)
+{
+    FILE *fp;
+    gchar *path;
+    wtap *wth;
+    wtap_rec rec;
+    Buffer buf;
+    gint64 offset;
+    const guint8 *first;
+    guint8 expected[TEST_FILE_MAX_DATA_LEN];
+    guint i;
+
+    path = test_file_create("zero_copy_test", &fp);
+    test_file_write_header(fp, TEST_FILE_PCAP, LINKTYPE_ETHERNET, FALSE);
+    for (i = 0; i < 5; i++)
+        write_record(fp, i);
+    fclose(fp);
+
+    wth = open_file(path, WTAP_ZERO_COPY_SEQUENTIAL);
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+
+    read_record(wth, &rec, &buf, 0, TRUE, &offset);
+    first = rec.data;
+    for (i = 1; i < 5; i++)
+        read_record(wth, &rec, &buf, i, TRUE, &offset);
+    read_eof(wth, &rec, &buf);
+
+    fp = test_file_append(path);
+    for (i = 5; i < 8; i++)
+        write_record(fp, i);
+    fclose(fp);
+
+    wtap_cleareof(wth);
+    for (i = 5; i < 8; i++)
+        read_record(wth, &rec, &buf, i, FALSE, &offset);
+    read_eof(wth, &rec, &buf);
+
+    /* The mapping is still there for the data we handed out. */
+    if (first != NULL) {
+        test_file_record_data(0, expected);
+        g_assert(memcmp(first, expected, test_file_record_len(0)) == 0);
+    }
+
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+    wtap_close(wth);
+    g_unlink(path);
+    g_free(path);
+}
+
+/*
+ * A record that was only partly in the file when we mapped it runs
+ * past the end of the mapping, so it has to be copied, and so does
+ * everything after it.
+ */
+static void
+zero_copy_test_grow_mid_record(void)
+{
+    FILE *fp;
+    gchar *path;
+    wtap *wth;
+    wtap_rec rec;
+    Buffer buf;
+    gint64 offset;
+    guint8 data[TEST_FILE_MAX_DATA_LEN];
+    guint half;
+    guint i;
+
+    path = test_file_create("zero_copy_test", &fp);
+    test_file_write_header(fp, TEST_FILE_PCAP, LINKTYPE_ETHERNET, FALSE);
+    for (i = 0; i < 5; i++)
+        write_record(fp, i);
+    test_file_write_record_header(fp, TEST_FILE_PCAP, 5, test_file_record_len(5), FALSE);
+    test_file_record_data(5, data);
+    half = test_file_record_len(5) / 2;
+    test_file_write(fp, data, half);
+    fclose(fp);
+
+    wth = open_file(path, WTAP_ZERO_COPY_SEQUENTIAL);
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+
+    for (i = 0; i < 5; i++)
+        read_record(wth, &rec, &buf, i, TRUE, &offset);
+
+    fp = test_file_append(path);
+    test_file_write(fp, data + half, test_file_record_len(5) - half);
+    for (i = 6; i < 8; i++)
+        write_record(fp, i);
+    fclose(fp);
+
+    for (i = 5; i < 8; i++)
+        read_record(wth, &rec, &buf, i, FALSE, &offset);
+    read_eof(wth, &rec, &buf);
+
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+    wtap_close(wth);
+    g_unlink(path);
+    g_free(path);
+}
+
+#if defined(HAVE_MMAP) && GLIB_SIZEOF_VOID_P >= 8
+/*
+ * The output buffer is a window of at most 1 GiB on the mapping, so a
+ * file somewhat bigger than that has records that cross the end of the
+ * first window.  Only the record headers and the ends of the data are
+ * written, so the file is mostly holes.
+ */
+#define WINDOW_RECORD_LEN   TEST_FILE_SNAPLEN
+#define WINDOW_RECORDS      ((1U << 30) / (16 + WINDOW_RECORD_LEN) + 4)
+
+static void
+write_at(int fd, gint64 offset, const void *data, size_t len)
+{
+    gint64 pos;
+    int written;
+
+    pos = ws_lseek64(fd, offset, SEEK_SET);
+    g_assert_cmpint(pos, ==, offset);
+    written = ws_write(fd, data, (unsigned int)len);
+    g_assert_cmpint(written, ==, (int)len);
+}
+
+static void
+check_window_record(const wtap_rec *rec, Buffer *buf, guint32 num)
+{
+    const guint8 *pd;
+    guint32 marker;
+
+    g_assert_cmpuint(rec->rec_header.packet_header.caplen, ==, WINDOW_RECORD_LEN);
+    g_assert(rec->data != NULL);
+    pd = wtap_rec_data(rec, buf);
+    memcpy(&marker, pd, sizeof marker);
+    g_assert_cmpuint(marker, ==, num);
+    memcpy(&marker, pd + WINDOW_RECORD_LEN - sizeof marker, sizeof marker);
+    g_assert_cmpuint(marker, ==, ~num);
+}
+
+static void
+zero_copy_test_window(void)
+{
+    FILE *fp;
+    gchar *path;
+    int fd;
+    wtap *wth;
+    wtap_rec rec;
+    Buffer buf;
+    int err;
+    gchar *err_info = NULL;
+    gint64 offset, *offsets;
+    guint32 hdr[4], marker;
+    guint32 i;
+
+    path = test_file_create("zero_copy_test", &fp);
+    test_file_write_header(fp, TEST_FILE_PCAP, LINKTYPE_ETHERNET, FALSE);
+    fclose(fp);
+
+    fd = ws_open(path, O_WRONLY|O_BINARY, 0000);
+    g_assert(fd != -1);
+    offset = 24;
+    for (i = 0; i < WINDOW_RECORDS; i++) {
+        hdr[0] = i;
+        hdr[1] = 0;
+        hdr[2] = WINDOW_RECORD_LEN;
+        hdr[3] = WINDOW_RECORD_LEN;
+        write_at(fd, offset, hdr, sizeof hdr);
+        offset += sizeof hdr;
+        marker = i;
+        write_at(fd, offset, &marker, sizeof marker);
+        marker = ~i;
+        write_at(fd, offset + WINDOW_RECORD_LEN - sizeof marker, &marker, sizeof marker);
+        offset += WINDOW_RECORD_LEN;
+    }
+    ws_close(fd);
+
+    wth = open_file(path, WTAP_ZERO_COPY_SEQUENTIAL|WTAP_ZERO_COPY_RANDOM);
+    wtap_rec_init(&rec);
+    ws_buffer_init(&buf, 1514);
+    offsets = g_new(gint64, WINDOW_RECORDS);
+
+    for (i = 0; i < WINDOW_RECORDS; i++) {
+        if (!wtap_read(wth, &rec, &buf, &err, &err_info, &offsets[i]))
+            g_error("Can't read record %u: %s", i, wtap_strerror(err));
+        check_window_record(&rec, &buf, i);
+    }
+    read_eof(wth, &rec, &buf);
+
+    for (i = WINDOW_RECORDS; i-- > 0; ) {
+        if (!wtap_seek_read(wth, offsets[i], &rec, &buf, &err, &err_info))
+            g_error("Can't seek to record %u: %s", i, wtap_strerror(err));
+        check_window_record(&rec, &buf, i);
+    }
+
+    g_free(offsets);
+    ws_buffer_free(&buf);
+    wtap_rec_cleanup(&rec);
+    wtap_close(wth);
+    g_unlink(path);
+    g_free(path);
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    wtap_init(FALSE);
+
+    g_test_add_func("/zero_copy/both",            zero_copy_test_both);
+    g_test_add_func("/zero_copy/sequential",      zero_copy_test_sequential);
+    g_test_add_func("/zero_copy/random",          zero_copy_test_random);
+    g_test_add_func("/zero_copy/not_asked",       zero_copy_test_not_asked);
+    g_test_add_func("/zero_copy/byte_swapped",    zero_copy_test_byte_swapped);
+    g_test_add_func("/zero_copy/grow_at_end",     zero_copy_test_grow_at_end);
+    g_test_add_func("/zero_copy/grow_mid_record", zero_copy_test_grow_mid_record);
+#if defined(HAVE_MMAP) && GLIB_SIZEOF_VOID_P >= 8
+    g_test_add_func("/zero_copy/window",          zero_copy_test_window);
+#endif
+
+    ret = g_test_run();
+
+    wtap_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,404 @@
+/* time_index.c
+ * Sidecar index of record time stamps and offsets in a capture file,
+ * for skipping to a time range without reading everything before it
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "time_index.h"
+#include "file_util.h"
+#include "pint.h"
+
+/*
+ * The index file is a header of:
+ *
+ *      4 bytes         "WSTI"
+ *      4 bytes         version, 1
+ *      8 bytes         size of the capture file
+ *      4 bytes         number of points
+ *      4 bytes         reserved, zero
+ *
+ * followed by the points, in order of offset, each of which is:
+ *
+ *      8 bytes         offset of the record in the capture file
+ *      8 bytes         frame number of the record
+ *      8 bytes         seconds of the time stamp of the record
+ *      4 bytes         nanoseconds of the time stamp of the record
+ *      4 bytes         flags
+ *      8 bytes         seconds of the latest time stamp before the record
+ *      4 bytes         nanoseconds of the latest time stamp before the record
+ *      4 bytes         nanoseconds of the earliest time stamp from the record on
+ *      8 bytes         seconds of the earliest time stamp from the record on
+ *      4 bytes         number of section headers before the record
+ *      4 bytes         number of interface descriptions before the record
+ *      4 bytes         number of other metadata blocks before the record
+ *      4 bytes         reserved, zero
+ *
+ * All integers are little-endian.  A time stamp whose flag isn't set is
+ * zero and isn't meaningful.
+ */
+#define TIME_INDEX_MAGIC        "WSTI"
+#define TIME_INDEX_VERSION      1
+#define TIME_INDEX_HDR_LEN      24
+#define TIME_INDEX_POINT_LEN    72
+
+#define TIME_INDEX_HAS_TS       0x00000001  /* the record has a time stamp */
+#define TIME_INDEX_TIMED_BEFORE 0x00000002  /* some record before it has one */
+#define TIME_INDEX_TIMED_AFTER  0x00000004  /* it or some record after it has one */
+
+typedef struct {
+    time_index_point point;
+    gboolean timed_before;
+    nstime_t max_before;
+    gboolean timed_after;
+    nstime_t min_after;         /* while building, of the records up to the next point */
+} time_index_entry;
+
+struct _time_index_builder {
+    GArray *entries;            /* of time_index_entry */
+    guint64 spacing;
+    guint64 frame_num;
+    gboolean timed;
+    nstime_t max_ts;
+};
+
+struct _time_index {
+    GArray *entries;            /* of time_index_entry */
+};
+
+time_index_builder *
+time_index_builder_new(guint64 spacing)
+{
+    time_index_builder *tib = g_new0(time_index_builder, 1);
+
+    tib->entries = g_array_new(FALSE, FALSE, sizeof(time_index_entry));
+    tib->spacing = spacing != 0 ? spacing : TIME_INDEX_DEFAULT_SPACING;
+    return tib;
+}
+
+void
+time_index_builder_add(time_index_builder *tib, guint64 offset,
+                       const nstime_t *ts, const time_index_counts *counts)
+{
+    time_index_entry *last = NULL;
+
+    tib->frame_num++;
+    if (tib->entries->len != 0)
+        last = &g_array_index(tib->entries, time_index_entry, tib->entries->len - 1);
+
+    if (last == NULL || offset >= last->point.offset + tib->spacing) {
+        time_index_entry entry;
+
+        memset(&entry, 0, sizeof entry);
+        entry.point.offset = offset;
+        entry.point.frame_num = tib->frame_num;
+        if (ts != NULL) {
+            entry.point.has_ts = TRUE;
+            entry.point.ts = *ts;
+        }
+        entry.point.counts = *counts;
+        entry.timed_before = tib->timed;
+        entry.max_before = tib->max_ts;
+        g_array_append_val(tib->entries, entry);
+        last = &g_array_index(tib->entries, time_index_entry, tib->entries->len - 1);
+    }
+
+    if (ts == NULL)
+        return;
+    if (!last->timed_after || nstime_cmp(ts, &last->min_after) < 0) {
+        last->timed_after = TRUE;
+        last->min_after = *ts;
+    }
+    if (!tib->timed || nstime_cmp(ts, &tib->max_ts) > 0) {
+        tib->timed = TRUE;
+        tib->max_ts = *ts;
+    }
+}
+
+static void
+time_index_put_ts(guint8 *p, const nstime_t *ts)
+{
+    phtole64(p, (guint64)(gint64)ts->secs);
+    phtole32(p + 8, (guint32)ts->nsecs);
+}
+
+gboolean
+time_index_builder_save(time_index_builder *tib, const char *capture_path,
+                        guint64 capture_size, int *err)
+{
+    guint8 hdr[TIME_INDEX_HDR_LEN];
+    guint8 rec[TIME_INDEX_POINT_LEN];
+    time_index_entry *entries = (time_index_entry *)(void *)tib->entries->data;
+    guint n = tib->entries->len;
+    gboolean *timed_after;
+    nstime_t *min_after;
+    char *idx_path, *tmp_path;
+    FILE *idx;
+    gboolean ok = TRUE;
+
+    *err = 0;
+
+    /*
+     * While building, each point has the earliest time stamp of the
+     * records up to the next point; make it the earliest of all of the
+     * records from it on.
+     */
+    timed_after = g_new(gboolean, n + 1);
+    min_after = g_new(nstime_t, n + 1);
+    timed_after[n] = FALSE;
+    for (guint i = n; i-- != 0; ) {
+        timed_after[i] = entries[i].timed_after;
+        min_after[i] = entries[i].min_after;
+        if (timed_after[i + 1] &&
+            (!timed_after[i] || nstime_cmp(&min_after[i + 1], &min_after[i]) < 0)) {
+            timed_after[i] = TRUE;
+            min_after[i] = min_after[i + 1];
+        }
+    }
+
+    /* write to a temporary file, so nobody sees a partial index */
+    idx_path = g_strconcat(capture_path, TIME_INDEX_SUFFIX, NULL);
+    tmp_path = g_strconcat(idx_path, ".tmp", NULL);
+    idx = ws_fopen(tmp_path, "wb");
+    if (idx == NULL) {
+        *err = errno;
+        ok = FALSE;
+        goto done;
+    }
+
+    memcpy(hdr, TIME_INDEX_MAGIC, 4);
+    phtole32(hdr + 4, TIME_INDEX_VERSION);
+    phtole64(hdr + 8, capture_size);
+    phtole32(hdr + 16, n);
+    phtole32(hdr + 20, 0);
+    if (fwrite(hdr, 1, TIME_INDEX_HDR_LEN, idx) != TIME_INDEX_HDR_LEN)
+        ok = FALSE;
+
+    for (guint i = 0; ok && i < n; i++) {
+        const time_index_entry *entry = &entries[i];
+        guint32 flags = 0;
+
+        memset(rec, 0, sizeof rec);
+        phtole64(rec, entry->point.offset);
+        phtole64(rec + 8, entry->point.frame_num);
+        if (entry->point.has_ts) {
+            flags |= TIME_INDEX_HAS_TS;
+            time_index_put_ts(rec + 16, &entry->point.ts);
+        }
+        if (entry->timed_before) {
+            flags |= TIME_INDEX_TIMED_BEFORE;
+            time_index_put_ts(rec + 32, &entry->max_before);
+        }
+        if (timed_after[i]) {
+            flags |= TIME_INDEX_TIMED_AFTER;
+            phtole32(rec + 44, (guint32)min_after[i].nsecs);
+            phtole64(rec + 48, (guint64)(gint64)min_after[i].secs);
+        }
+        phtole32(rec + 28, flags);
+        phtole32(rec + 56, entry->point.counts.sections);
+        phtole32(rec + 60, entry->point.counts.interfaces);
+        phtole32(rec + 64, entry->point.counts.metadata);
+        if (fwrite(rec, 1, TIME_INDEX_POINT_LEN, idx) != TIME_INDEX_POINT_LEN)
+            ok = FALSE;
+    }
+    if (!ok)
+        *err = errno;
+
+    if (fclose(idx) != 0 && ok) {
+        *err = errno;
+        ok = FALSE;
+    }
+    if (ok && ws_rename(tmp_path, idx_path) != 0) {
+        *err = errno;
+        ok = FALSE;
+    }
+    if (!ok)
+        ws_unlink(tmp_path);
+
+done:
+    g_free(tmp_path);
+    g_free(idx_path);
+    g_free(min_after);
+    g_free(timed_after);
+    return ok;
+}
+
+void
+time_index_builder_free(time_index_builder *tib)
+{
+    g_array_free(tib->entries, TRUE);
+    g_free(tib);
+}
+
+static gboolean
+time_index_get_ts(const guint8 *secs, const guint8 *nsecs, nstime_t *ts)
+{
+    ts->secs = (time_t)(gint64)pletoh64(secs);
+    ts->nsecs = (int)pletoh32(nsecs);
+    return ts->nsecs >= 0 && ts->nsecs < 1000000000;
+}
+
+time_index *
+time_index_load(const char *capture_path, guint64 capture_size)
+{
+    guint8 hdr[TIME_INDEX_HDR_LEN];
+    guint8 rec[TIME_INDEX_POINT_LEN];
+    char *idx_path;
+    FILE *idx;
+    guint32 count;
+    time_index *ti;
+    time_index_entry entry, *prev = NULL;
+
+    idx_path = g_strconcat(capture_path, TIME_INDEX_SUFFIX, NULL);
+    idx = ws_fopen(idx_path, "rb");
+    g_free(idx_path);
+    if (idx == NULL)
+        return NULL;
+
+    if (fread(hdr, 1, TIME_INDEX_HDR_LEN, idx) != TIME_INDEX_HDR_LEN ||
+        memcmp(hdr, TIME_INDEX_MAGIC, 4) != 0 ||
+        pletoh32(hdr + 4) != TIME_INDEX_VERSION ||
+        pletoh64(hdr + 8) != capture_size) {
+        fclose(idx);
+        return NULL;
+    }
+    count = pletoh32(hdr + 16);
+
+    ti = g_new(time_index, 1);
+    ti->entries = g_array_new(FALSE, FALSE, sizeof(time_index_entry));
+    while (count-- != 0) {
+        guint32 flags;
+        gboolean ok = TRUE;
+
+        if (fread(rec, 1, TIME_INDEX_POINT_LEN, idx) != TIME_INDEX_POINT_LEN)
+            goto bad;
+        memset(&entry, 0, sizeof entry);
+        entry.point.offset = pletoh64(rec);
+        entry.point.frame_num = pletoh64(rec + 8);
+        flags = pletoh32(rec + 28);
+        if (flags & TIME_INDEX_HAS_TS) {
+            entry.point.has_ts = TRUE;
+            ok &= time_index_get_ts(rec + 16, rec + 24, &entry.point.ts);
+        }
+        if (flags & TIME_INDEX_TIMED_BEFORE) {
+            entry.timed_before = TRUE;
+            ok &= time_index_get_ts(rec + 32, rec + 40, &entry.max_before);
+        }
+        if (flags & TIME_INDEX_TIMED_AFTER) {
+            entry.timed_after = TRUE;
+            ok &= time_index_get_ts(rec + 48, rec + 44, &entry.min_after);
+        }
+        entry.point.counts.sections = pletoh32(rec + 56);
+        entry.point.counts.interfaces = pletoh32(rec + 60);
+        entry.point.counts.metadata = pletoh32(rec + 64);
+
+        /* the searches require them to be in order */
+        if (!ok || entry.point.offset >= capture_size ||
+            (prev != NULL && (entry.point.offset <= prev->point.offset ||
+                              entry.point.frame_num <= prev->point.frame_num)))
+            goto bad;
+        g_array_append_val(ti->entries, entry);
+        prev = &g_array_index(ti->entries, time_index_entry, ti->entries->len - 1);
+    }
+    fclose(idx);
+    return ti;
+
+bad:
+    fclose(idx);
+    time_index_free(ti);
+    return NULL;
+}
+
+static gboolean
+time_index_counts_le(const time_index_counts *a, const time_index_counts *b)
+{
+    return a->sections <= b->sections && a->interfaces <= b->interfaces &&
+           a->metadata <= b->metadata;
+}
+
+gboolean
+time_index_find_start(const time_index *ti, const nstime_t *start,
+                      const time_index_counts *counts, time_index_point *point)
+{
+    const time_index_entry *entries = (const time_index_entry *)(void *)ti->entries->data;
+    guint lo = 0, hi = ti->entries->len;
+
+    /*
+     * The latest time stamp before a point and the counts can only go
+     * up from one point to the next, so the points we can use are all
+     * before the ones we can't; find the last of them.
+     */
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        const time_index_entry *entry = &entries[mid];
+
+        if ((!entry->timed_before || nstime_cmp(&entry->max_before, start) < 0) &&
+            time_index_counts_le(&entry->point.counts, counts))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return FALSE;
+    *point = entries[lo - 1].point;
+    return TRUE;
+}
+
+gboolean
+time_index_find_stop(const time_index *ti, const nstime_t *stop,
+                     time_index_point *point)
+{
+    const time_index_entry *entries = (const time_index_entry *)(void *)ti->entries->data;
+    guint lo = 0, hi = ti->entries->len;
+
+    /*
+     * Likewise, the earliest time stamp from a point on can only go up,
+     * so the points we can stop at are all after the ones we can't;
+     * find the first of them.
+     */
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        const time_index_entry *entry = &entries[mid];
+
+        if (!entry->timed_after || nstime_cmp(&entry->min_after, stop) >= 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    if (lo == ti->entries->len)
+        return FALSE;
+    *point = entries[lo].point;
+    return TRUE;
+}
+
+void
+time_index_free(time_index *ti)
+{
+    g_array_free(ti->entries, TRUE);
+    g_free(ti);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,172 @@
+/* time_index.h
+ * Sidecar index of record time stamps and offsets in a capture file,
+ * for skipping to a time range without reading everything before it
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __TIME_INDEX_H__
+#define __TIME_INDEX_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+#include "nstime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ * A time index is a list of points, each of which is the offset and
+ * frame number of a record in a capture file, taken about every
+ * TIME_INDEX_DEFAULT_SPACING bytes, along with the latest time stamp of
+ * all of the records before the point and the earliest time stamp of
+ * the record at the point and all of the records after it.  It's kept
+ * in a file next to the capture file, named after it with
+ * TIME_INDEX_SUFFIX appended.
+ *
+ * Captures are usually, but not always, in time order, so the time
+ * stamps of the records themselves can't be used to find where a time
+ * range starts; the running maximum and minimum can.  If every record
+ * before a point is earlier than the start of the range, a reader can
+ * seek to the point instead of reading those records; if every record
+ * from a point on is at or after the end of the range, it can stop
+ * there.
+ *
+ * Skipping records also skips whatever else the file has between
+ * them, such as pcapng section headers and interface descriptions, so
+ * each point also has the number of those the file has before it; a
+ * reader must not use a point if those don't match what it has already
+ * read.  Records without a time stamp are treated as being outside any
+ * time range.
+ */
+
+/** Appended to the name of a capture file to get the name of its index */
+#define TIME_INDEX_SUFFIX ".wstidx"
+
+/** Default number of bytes of the capture file between points */
+#define TIME_INDEX_DEFAULT_SPACING (1024 * 1024)
+
+/** Metadata seen in the capture file before a point */
+typedef struct {
+    guint32 sections;           /**< section headers */
+    guint32 interfaces;         /**< interface descriptions */
+    guint32 metadata;           /**< other blocks a reader keeps, such as name resolution and decryption secrets */
+} time_index_counts;
+
+/** A place in the capture file to seek to or stop at */
+typedef struct {
+    guint64 offset;             /**< offset of the record in the capture file */
+    guint64 frame_num;          /**< its frame number, counting from 1 */
+    gboolean has_ts;            /**< TRUE if the record has a time stamp */
+    nstime_t ts;                /**< the time stamp of the record, if it has one */
+    time_index_counts counts;   /**< metadata before the record */
+} time_index_point;
+
+typedef struct _time_index_builder time_index_builder;
+typedef struct _time_index time_index;
+
+/** Start building an index.
+ *
+ * @param spacing The minimum number of bytes between points, or 0 for
+ * TIME_INDEX_DEFAULT_SPACING.
+ * @return The new builder.
+ */
+WS_DLL_PUBLIC time_index_builder *time_index_builder_new(guint64 spacing);
+
+/** Add a record to the index being built; every record in the file
+ * must be added, in order.
+ *
+ * @param tib The builder.
+ * @param offset The offset of the record in the capture file.
+ * @param ts The time stamp of the record, or NULL if it has none.
+ * @param counts The metadata in the file before the record.  A count
+ * that's too high only makes the point unusable, so if it's only known
+ * after reading several records, that's what can be passed for all of
+ * them.
+ */
+WS_DLL_PUBLIC void time_index_builder_add(time_index_builder *tib,
+    guint64 offset, const nstime_t *ts, const time_index_counts *counts);
+
+/** Write the index for a capture file.  The index is written to a
+ * temporary file that's renamed once it's complete.
+ *
+ * @param tib The builder.
+ * @param capture_path The name of the capture file.
+ * @param capture_size The size of the complete capture file; the index
+ * is only used for a file of that size.
+ * @param[out] err Set to an errno value on failure.
+ * @return TRUE on success, FALSE on failure.
+ */
+WS_DLL_PUBLIC gboolean time_index_builder_save(time_index_builder *tib,
+    const char *capture_path, guint64 capture_size, int *err);
+
+/** Free a builder.
+ *
+ * @param tib The builder.
+ */
+WS_DLL_PUBLIC void time_index_builder_free(time_index_builder *tib);
+
+/** Read the index for a capture file.
+ *
+ * @param capture_path The name of the capture file.
+ * @param capture_size Its current size.
+ * @return The index, or NULL if there isn't one, it's damaged, or it
+ * was written for a file of a different size.
+ */
+WS_DLL_PUBLIC time_index *time_index_load(const char *capture_path,
+    guint64 capture_size);
+
+/** Find the last point before which every record is earlier than
+ * start and has no more metadata before it than counts.
+ *
+ * @param ti The index.
+ * @param start The start of the time range.
+ * @param counts The metadata the reader has already seen.
+ * @param[out] point Set to the point found.
+ * @return TRUE if there is such a point, FALSE if not.
+ */
+WS_DLL_PUBLIC gboolean time_index_find_start(const time_index *ti,
+    const nstime_t *start, const time_index_counts *counts,
+    time_index_point *point);
+
+/** Find the first point at and after which every record is at or after
+ * stop.
+ *
+ * @param ti The index.
+ * @param stop The end of the time range, which isn't part of it.
+ * @param[out] point Set to the point found.
+ * @return TRUE if there is such a point, FALSE if not.
+ */
+WS_DLL_PUBLIC gboolean time_index_find_stop(const time_index *ti,
+    const nstime_t *stop, time_index_point *point);
+
+/** Free an index.
+ *
+ * @param ti The index.
+ */
+WS_DLL_PUBLIC void time_index_free(time_index *ti);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __TIME_INDEX_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
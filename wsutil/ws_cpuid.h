@@ -89,7 +89,7 @@ ws_cpuid(guint32 *CPUInfo _U_, int selector _U_)
 }
 #endif
 
-static int
+static inline int
 ws_cpuid_sse42(void)
 {
 	guint32 CPUInfo[4];
@@ -100,3 +100,59 @@ ws_cpuid_sse42(void)
 	/* in ECX bit 20 toggled on */
 	return (CPUInfo[2] & (1 << 20));
 }
+
+/*
+ * Read XCR0, to find out which register states the OS saves on a
+ * context switch; the AVX registers may only be used if it saves them.
+ * Only called once CPUID has reported that XGETBV is available.
+ */
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+static inline guint64
+ws_xgetbv0(void)
+{
+	return _xgetbv(0);
+}
+#elif defined(__GNUC__) && defined(__x86_64__)
+static inline guint64
+ws_xgetbv0(void)
+{
+	guint32 eax, edx;
+
+	__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" /* xgetbv */
+						: "=a" (eax), "=d" (edx)
+						: "c" (0));
+	return ((guint64)edx << 32) | eax;
+}
+#else
+static inline guint64
+ws_xgetbv0(void)
+{
+	return 0;
+}
+#endif
+
+static inline int
+ws_cpuid_avx2(void)
+{
+	guint32 CPUInfo[4];
+
+	if (!ws_cpuid(CPUInfo, 0) || CPUInfo[0] < 7)
+		return 0;
+
+	if (!ws_cpuid(CPUInfo, 1))
+		return 0;
+
+	/* in ECX bit 27 (OSXSAVE) and bit 28 (AVX) toggled on */
+	if ((CPUInfo[2] & ((1 << 27) | (1 << 28))) != ((1 << 27) | (1 << 28)))
+		return 0;
+
+	/* the OS saves the XMM and YMM registers */
+	if ((ws_xgetbv0() & 0x6) != 0x6)
+		return 0;
+
+	if (!ws_cpuid(CPUInfo, 7))
+		return 0;
+
+	/* in EBX bit 5 toggled on */
+	return (CPUInfo[1] & (1 << 5));
+}
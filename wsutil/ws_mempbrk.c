@@ -26,16 +26,23 @@
 #include "ws_symbol_export.h"
 #include "ws_mempbrk.h"
 #include "ws_mempbrk_int.h"
+#include "ws_memsearch.h"
 
 void
 ws_mempbrk_compile(ws_mempbrk_pattern* pattern, const gchar *needles)
 {
     const gchar *n = needles;
     while (*n) {
-        pattern->patt[(int)*n] = 1;
+        pattern->patt[(guint8)*n] = 1;
         n++;
     }
 
+    pattern->num_needles = (guint) (n - needles);
+    if (pattern->num_needles <= 2) {
+        pattern->needles[0] = needles[0];
+        pattern->needles[1] = pattern->num_needles == 2 ? needles[1] : needles[0];
+    }
+
 #ifdef HAVE_SSE4_2
     ws_mempbrk_sse42_compile(pattern, needles);
 #endif
@@ -63,6 +70,14 @@ ws_mempbrk_portable_exec(const guint8* haystack, size_t haystacklen, const ws_me
 WS_DLL_PUBLIC const guint8 *
 ws_mempbrk_exec(const guint8* haystack, size_t haystacklen, const ws_mempbrk_pattern* pattern, guchar *found_needle)
 {
+    if (pattern->num_needles != 0 && pattern->num_needles <= 2) {
+        const guint8 *result = ws_memchr2(haystack, haystacklen, pattern->needles[0], pattern->needles[1]);
+
+        if (result && found_needle)
+            *found_needle = *result;
+        return result;
+    }
+
 #ifdef HAVE_SSE4_2
     if (haystacklen >= 16 && pattern->use_sse42)
         return ws_mempbrk_sse42_exec(haystack, haystacklen, pattern, found_needle);
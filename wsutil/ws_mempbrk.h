@@ -20,6 +20,10 @@
  */
 typedef struct {
     gchar patt[256];
+    /* Patterns of one or two needles (such as CR and LF) are searched
+     * for with memchr() or ws_memchr2() instead. */
+    guint num_needles;
+    guchar needles[2];
 #ifdef HAVE_SSE4_2
     gboolean use_sse42;
     __m128i mask;
@@ -0,0 +1,190 @@
+/* ws_memsearch.c
+ * Byte and substring search in memory buffers
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "ws_memsearch.h"
+#include "ws_memsearch_int.h"
+#include "bits_ctz.h"
+
+#ifdef WS_MEMSEARCH_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef HAVE_AVX2
+#include "ws_cpuid.h"
+
+/*
+ * -1 until the first search, then whether the AVX2 versions may be
+ * used.  Finding that out more than once is harmless, so there's no
+ * locking.
+ */
+static int use_avx2 = -1;
+
+static inline gboolean
+ws_memsearch_use_avx2(void)
+{
+    if (use_avx2 == -1)
+        use_avx2 = ws_cpuid_avx2() ? 1 : 0;
+    return use_avx2;
+}
+#endif
+
+const guint8 *
+ws_memchr2_portable(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2)
+{
+    const guint8 *haystack_end = haystack + haystacklen;
+
+    while (haystack < haystack_end) {
+        if (*haystack == c1 || *haystack == c2)
+            return haystack;
+        haystack++;
+    }
+
+    return NULL;
+}
+
+/* Check each byte that matches the first byte of the needle with memcmp.
+ * Expects 0 < needlelen <= haystacklen. */
+const guint8 *
+ws_memmem_portable(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen)
+{
+    const guint8 *begin = haystack;
+    const guint8 *const last_possible = haystack + haystacklen - needlelen;
+
+    while (begin <= last_possible) {
+        begin = (const guint8 *)memchr(begin, needle[0], last_possible - begin + 1);
+        if (begin == NULL)
+            return NULL;
+        if (memcmp(begin + 1, needle + 1, needlelen - 1) == 0)
+            return begin;
+        begin++;
+    }
+
+    return NULL;
+}
+
+#ifdef WS_MEMSEARCH_SSE2
+#define cast_128__m128i(p) ((const __m128i *) (const void *) (p))
+
+static const guint8 *
+ws_memchr2_sse2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2)
+{
+    const __m128i v1 = _mm_set1_epi8((char)c1);
+    const __m128i v2 = _mm_set1_epi8((char)c2);
+    size_t i;
+
+    for (i = 0; i + 16 <= haystacklen; i += 16) {
+        __m128i block = _mm_loadu_si128(cast_128__m128i(haystack + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(block, v1), _mm_cmpeq_epi8(block, v2)));
+
+        if (mask != 0)
+            return haystack + i + ws_ctz(mask);
+    }
+
+    return ws_memchr2_portable(haystack + i, haystacklen - i, c1, c2);
+}
+
+/*
+ * Compare the first and the last byte of the needle against 16
+ * candidate positions at once, and only memcmp the rest of the needle
+ * at the positions where both match.  That rejects nearly every
+ * position in a couple of instructions, even for needles whose first
+ * byte is common in the data (a space, a CR or a NUL).
+ *
+ * Expects 2 <= needlelen <= haystacklen.
+ */
+static const guint8 *
+ws_memmem_sse2(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen)
+{
+    const __m128i first = _mm_set1_epi8((char)needle[0]);
+    const __m128i last = _mm_set1_epi8((char)needle[needlelen - 1]);
+    const size_t last_start = haystacklen - needlelen;
+    size_t i;
+
+    for (i = 0; i + 15 <= last_start; i += 16) {
+        __m128i block_first = _mm_loadu_si128(cast_128__m128i(haystack + i));
+        __m128i block_last = _mm_loadu_si128(cast_128__m128i(haystack + i + needlelen - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+
+        while (mask != 0) {
+            int bit = ws_ctz(mask);
+
+            if (memcmp(haystack + i + bit + 1, needle + 1, needlelen - 2) == 0)
+                return haystack + i + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    /* The last block may have gone past the last place the needle fits. */
+    if (i > last_start)
+        return NULL;
+    return ws_memmem_portable(haystack + i, haystacklen - i, needle, needlelen);
+}
+#endif /* WS_MEMSEARCH_SSE2 */
+
+const guint8 *
+ws_memchr2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2)
+{
+    if (c1 == c2)
+        return (const guint8 *)memchr(haystack, c1, haystacklen);
+
+#ifdef HAVE_AVX2
+    if (haystacklen >= 32 && ws_memsearch_use_avx2())
+        return ws_memchr2_avx2(haystack, haystacklen, c1, c2);
+#endif
+
+#ifdef WS_MEMSEARCH_SSE2
+    return ws_memchr2_sse2(haystack, haystacklen, c1, c2);
+#else
+    return ws_memchr2_portable(haystack, haystacklen, c1, c2);
+#endif
+}
+
+const guint8 *
+ws_memmem(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen)
+{
+    if (needlelen == 0 || needlelen > haystacklen)
+        return NULL;
+
+    /* The C library's memchr is already vectorized. */
+    if (needlelen == 1)
+        return (const guint8 *)memchr(haystack, needle[0], haystacklen);
+
+#ifdef HAVE_AVX2
+    if (haystacklen - needlelen >= 31 && ws_memsearch_use_avx2())
+        return ws_memmem_avx2(haystack, haystacklen, needle, needlelen);
+#endif
+
+#ifdef WS_MEMSEARCH_SSE2
+    return ws_memmem_sse2(haystack, haystacklen, needle, needlelen);
+#else
+    return ws_memmem_portable(haystack, haystacklen, needle, needlelen);
+#endif
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,51 @@
+/* ws_memsearch.h
+ * Byte and substring search in memory buffers
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_MEMSEARCH_H__
+#define __WS_MEMSEARCH_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** Find the first occurrence of either of two bytes.
+ *
+ * This is what memchr() is for a single byte; it is what the
+ * line-end search of text protocols (looking for CR or LF) needs.
+ *
+ * @param haystack The data to search.
+ * @param haystacklen The number of bytes of data.
+ * @param c1 The first byte to look for.
+ * @param c2 The second byte to look for.
+ * @return A pointer to the first byte equal to c1 or c2, or NULL
+ * if there is none.
+ */
+WS_DLL_PUBLIC const guint8 *ws_memchr2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2);
+
+/** Find the first occurrence of a byte string.
+ *
+ * @param haystack The data to search.
+ * @param haystacklen The number of bytes of data.
+ * @param needle The byte string to look for.
+ * @param needlelen The length of the byte string.
+ * @return A pointer to the start of the first occurrence of needle, or
+ * NULL if there is none or if needlelen is 0.
+ */
+WS_DLL_PUBLIC const guint8 *ws_memmem(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_MEMSEARCH_H__ */
@@ -0,0 +1,90 @@
+/* ws_memsearch_avx2.c
+ * AVX2 versions of the ws_memsearch.c searches; this file is built with
+ * the compiler flag that enables AVX2, and its functions are only
+ * called after ws_cpuid_avx2() has said the CPU and the OS support it.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#ifdef HAVE_AVX2
+
+#include <string.h>
+
+#include <glib.h>
+#include <immintrin.h>
+
+#include "ws_memsearch.h"
+#include "ws_memsearch_int.h"
+#include "bits_ctz.h"
+
+#define cast_256__m256i(p) ((const __m256i *) (const void *) (p))
+
+const guint8 *
+ws_memchr2_avx2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2)
+{
+    const __m256i v1 = _mm256_set1_epi8((char)c1);
+    const __m256i v2 = _mm256_set1_epi8((char)c2);
+    size_t i;
+
+    for (i = 0; i + 32 <= haystacklen; i += 32) {
+        __m256i block = _mm256_loadu_si256(cast_256__m256i(haystack + i));
+        guint32 mask = (guint32)_mm256_movemask_epi8(
+                _mm256_or_si256(_mm256_cmpeq_epi8(block, v1), _mm256_cmpeq_epi8(block, v2)));
+
+        if (mask != 0)
+            return haystack + i + ws_ctz(mask);
+    }
+
+    return ws_memchr2_portable(haystack + i, haystacklen - i, c1, c2);
+}
+
+/* Same as ws_memmem_sse2(), 32 candidate positions at a time. */
+const guint8 *
+ws_memmem_avx2(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen)
+{
+    const __m256i first = _mm256_set1_epi8((char)needle[0]);
+    const __m256i last = _mm256_set1_epi8((char)needle[needlelen - 1]);
+    const size_t last_start = haystacklen - needlelen;
+    size_t i;
+
+    for (i = 0; i + 31 <= last_start; i += 32) {
+        __m256i block_first = _mm256_loadu_si256(cast_256__m256i(haystack + i));
+        __m256i block_last = _mm256_loadu_si256(cast_256__m256i(haystack + i + needlelen - 1));
+        guint32 mask = (guint32)_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last)));
+
+        while (mask != 0) {
+            int bit = ws_ctz(mask);
+
+            if (memcmp(haystack + i + bit + 1, needle + 1, needlelen - 2) == 0)
+                return haystack + i + bit;
+            mask &= mask - 1;
+        }
+    }
+
+    /* The last block may have gone past the last place the needle fits. */
+    if (i > last_start)
+        return NULL;
+    return ws_memmem_portable(haystack + i, haystacklen - i, needle, needlelen);
+}
+
+#endif /* HAVE_AVX2 */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
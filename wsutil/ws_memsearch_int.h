@@ -0,0 +1,30 @@
+/* ws_memsearch_int.h
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_MEMSEARCH_INT_H__
+#define __WS_MEMSEARCH_INT_H__
+
+/*
+ * SSE2 is part of the x86-64 instruction set, so it needs no runtime
+ * check there; on 32-bit x86 we only use it if the compiler was told
+ * it may.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WS_MEMSEARCH_SSE2
+#endif
+
+const guint8 *ws_memchr2_portable(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2);
+const guint8 *ws_memmem_portable(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen);
+
+#ifdef HAVE_AVX2
+const guint8 *ws_memchr2_avx2(const guint8 *haystack, size_t haystacklen, guint8 c1, guint8 c2);
+const guint8 *ws_memmem_avx2(const guint8 *haystack, size_t haystacklen, const guint8 *needle, size_t needlelen);
+#endif
+
+#endif /* __WS_MEMSEARCH_INT_H__ */
@@ -0,0 +1,310 @@
+/* ws_multimatch.c
+ * Search for many byte strings in one pass over the data
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "ws_multimatch.h"
+#include "ws_mempbrk.h"
+#include "ws_memsearch.h"
+
+/*
+ * The patterns are compiled into a deterministic automaton: an
+ * Aho-Corasick trie whose missing transitions have been filled in by
+ * following the failure links, so that searching is one table lookup
+ * per byte of data.
+ *
+ * To keep the table small, bytes that behave the same way are mapped
+ * to the same class: every byte that occurs in a pattern (after case
+ * folding) gets a class of its own, and all other bytes share class 0.
+ * A table row has one entry per class rather than 256.
+ *
+ * Most data never gets past the root state, so when the automaton is
+ * in the root state and only a few bytes can leave it, we skip to the
+ * next such byte with memchr(), ws_memchr2() or ws_mempbrk_exec().
+ */
+
+typedef enum {
+    PREFILTER_NONE,     /* too many first bytes to be worth it */
+    PREFILTER_MEMCHR2,  /* one or two first bytes */
+    PREFILTER_MEMPBRK   /* up to 16 non-NUL first bytes */
+} prefilter_type_t;
+
+struct _ws_multimatch {
+    gboolean nocase;
+    gboolean compiled;
+    GPtrArray *patterns;        /* GByteArray per pattern, until compiled */
+
+    guint16 byte_class[256];
+    guint num_classes;
+    guint num_states;
+    guint32 *delta;             /* num_states rows of num_classes */
+    gint32 *match_id;           /* per state: longest pattern ending there, or -1 */
+    guint32 *match_len;         /* per state: the length of that pattern */
+
+    prefilter_type_t prefilter;
+    guint8 first_bytes[2];
+    ws_mempbrk_pattern first_pbrk;
+};
+
+static inline guint8
+fold_byte(const ws_multimatch *set, guint8 b)
+{
+    return set->nocase ? (guint8)g_ascii_tolower(b) : b;
+}
+
+ws_multimatch *
+ws_multimatch_new(gboolean nocase)
+{
+    ws_multimatch *set = g_new0(ws_multimatch, 1);
+
+    set->nocase = nocase;
+    set->patterns = g_ptr_array_new();
+    return set;
+}
+
+guint
+ws_multimatch_add(ws_multimatch *set, const void *pattern, size_t pattern_len)
+{
+    GByteArray *bytes;
+
+    g_assert(!set->compiled);
+    g_assert(pattern_len != 0 && pattern_len <= G_MAXUINT32);
+
+    bytes = g_byte_array_sized_new((guint)pattern_len);
+    g_byte_array_append(bytes, (const guint8 *)pattern, (guint)pattern_len);
+    g_ptr_array_add(set->patterns, bytes);
+
+    return set->patterns->len - 1;
+}
+
+static void
+compile_prefilter(ws_multimatch *set)
+{
+    gchar first[17];
+    guint num_first = 0;
+    gboolean has_nul = FALSE;
+    guint b;
+
+    set->prefilter = PREFILTER_NONE;
+
+    for (b = 0; b < 256; b++) {
+        if (set->delta[set->byte_class[b]] == 0)
+            continue;
+        if (num_first == 16)
+            return;
+        if (b == 0)
+            has_nul = TRUE;
+        first[num_first++] = (gchar)b;
+    }
+
+    if (num_first == 0) {
+        /* Can't happen with at least one non-empty pattern. */
+        return;
+    }
+
+    if (num_first <= 2) {
+        set->first_bytes[0] = (guint8)first[0];
+        set->first_bytes[1] = (guint8)first[num_first - 1];
+        set->prefilter = PREFILTER_MEMCHR2;
+    } else if (!has_nul) {
+        /* ws_mempbrk_compile() takes a NUL-terminated string. */
+        first[num_first] = '\0';
+        ws_mempbrk_compile(&set->first_pbrk, first);
+        set->prefilter = PREFILTER_MEMPBRK;
+    }
+}
+
+void
+ws_multimatch_compile(ws_multimatch *set)
+{
+    guint16 folded_class[256];
+    guint max_states = 1;
+    guint nc;
+    guint32 *fail;
+    guint32 *queue;
+    guint head, tail;
+    guint i, j, c;
+
+    g_assert(!set->compiled);
+
+    /* Assign the byte classes. */
+    memset(folded_class, 0, sizeof folded_class);
+    set->num_classes = 1;
+    for (i = 0; i < set->patterns->len; i++) {
+        GByteArray *pattern = (GByteArray *)g_ptr_array_index(set->patterns, i);
+
+        for (j = 0; j < pattern->len; j++) {
+            guint8 b = fold_byte(set, pattern->data[j]);
+
+            if (folded_class[b] == 0)
+                folded_class[b] = set->num_classes++;
+        }
+        max_states += pattern->len;
+    }
+    for (i = 0; i < 256; i++)
+        set->byte_class[i] = folded_class[fold_byte(set, (guint8)i)];
+    nc = set->num_classes;
+
+    /* Build the trie; 0 stands for "no edge", as no edge leads back to
+     * the root. */
+    set->delta = g_new0(guint32, (gsize)max_states * nc);
+    set->match_id = g_new(gint32, max_states);
+    set->match_len = g_new0(guint32, max_states);
+    set->match_id[0] = -1;
+    set->num_states = 1;
+
+    for (i = 0; i < set->patterns->len; i++) {
+        GByteArray *pattern = (GByteArray *)g_ptr_array_index(set->patterns, i);
+        guint32 state = 0;
+
+        for (j = 0; j < pattern->len; j++) {
+            guint32 *edge = &set->delta[(gsize)state * nc + set->byte_class[pattern->data[j]]];
+
+            if (*edge == 0) {
+                *edge = set->num_states;
+                set->match_id[set->num_states] = -1;
+                set->num_states++;
+            }
+            state = *edge;
+        }
+        if (set->match_id[state] == -1) {
+            set->match_id[state] = (gint32)i;
+            set->match_len[state] = pattern->len;
+        }
+        g_byte_array_free(pattern, TRUE);
+    }
+    g_ptr_array_free(set->patterns, TRUE);
+    set->patterns = NULL;
+
+    /*
+     * Walk the trie breadth first, computing the failure link of each
+     * state and replacing its missing edges by those of its failure
+     * state, which is shallower and so already done.  The root's
+     * missing edges lead back to the root, which 0 already says.
+     */
+    fail = g_new0(guint32, set->num_states);
+    queue = g_new(guint32, set->num_states);
+    head = tail = 0;
+    for (c = 0; c < nc; c++) {
+        guint32 child = set->delta[c];
+
+        if (child != 0)
+            queue[tail++] = child;
+    }
+    while (head < tail) {
+        guint32 state = queue[head++];
+        guint32 *row = &set->delta[(gsize)state * nc];
+        const guint32 *fail_row = &set->delta[(gsize)fail[state] * nc];
+
+        if (set->match_id[state] == -1) {
+            set->match_id[state] = set->match_id[fail[state]];
+            set->match_len[state] = set->match_len[fail[state]];
+        }
+
+        for (c = 0; c < nc; c++) {
+            if (row[c] != 0) {
+                fail[row[c]] = fail_row[c];
+                queue[tail++] = row[c];
+            } else {
+                row[c] = fail_row[c];
+            }
+        }
+    }
+    g_free(queue);
+    g_free(fail);
+
+    if (set->num_states < max_states) {
+        set->delta = g_renew(guint32, set->delta, (gsize)set->num_states * nc);
+        set->match_id = g_renew(gint32, set->match_id, set->num_states);
+        set->match_len = g_renew(guint32, set->match_len, set->num_states);
+    }
+
+    compile_prefilter(set);
+    set->compiled = TRUE;
+}
+
+const guint8 *
+ws_multimatch_exec(const ws_multimatch *set, const guint8 *haystack, size_t haystacklen, guint *pattern_id, size_t *match_len)
+{
+    const guint8 *p = haystack;
+    const guint8 *const end = haystack + haystacklen;
+    const guint32 *delta = set->delta;
+    const guint nc = set->num_classes;
+    guint32 state = 0;
+
+    g_assert(set->compiled);
+
+    while (p < end) {
+        if (state == 0) {
+            switch (set->prefilter) {
+
+            case PREFILTER_MEMCHR2:
+                p = ws_memchr2(p, end - p, set->first_bytes[0], set->first_bytes[1]);
+                break;
+
+            case PREFILTER_MEMPBRK:
+                p = ws_mempbrk_exec(p, end - p, &set->first_pbrk, NULL);
+                break;
+
+            case PREFILTER_NONE:
+                break;
+            }
+            if (p == NULL)
+                return NULL;
+        }
+
+        state = delta[(gsize)state * nc + set->byte_class[*p++]];
+        if (set->match_id[state] >= 0) {
+            if (pattern_id)
+                *pattern_id = (guint)set->match_id[state];
+            if (match_len)
+                *match_len = set->match_len[state];
+            return p - set->match_len[state];
+        }
+    }
+
+    return NULL;
+}
+
+void
+ws_multimatch_free(ws_multimatch *set)
+{
+    guint i;
+
+    if (set == NULL)
+        return;
+
+    if (set->patterns) {
+        for (i = 0; i < set->patterns->len; i++)
+            g_byte_array_free((GByteArray *)g_ptr_array_index(set->patterns, i), TRUE);
+        g_ptr_array_free(set->patterns, TRUE);
+    }
+    g_free(set->delta);
+    g_free(set->match_id);
+    g_free(set->match_len);
+    g_free(set);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,94 @@
+/* ws_multimatch.h
+ * Search for many byte strings in one pass over the data
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_MULTIMATCH_H__
+#define __WS_MULTIMATCH_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @file
+ * A set of byte strings ("patterns") compiled into an Aho-Corasick
+ * automaton, so that the data is only looked at once however many
+ * patterns there are.  Heuristic dissectors and content searches that
+ * would otherwise call ws_memmem() or tvb_find_tvb() once per signature
+ * can use it instead.
+ *
+ * A set is built once, usually when a dissector is registered:
+ *
+ *     ws_multimatch *set = ws_multimatch_new(TRUE);
+ *     ws_multimatch_add(set, "HTTP/1.", 7);
+ *     ws_multimatch_add(set, "RTSP/1.", 7);
+ *     ws_multimatch_compile(set);
+ *
+ * and can then be searched any number of times, including from several
+ * threads at once, since searching doesn't modify it.
+ */
+
+typedef struct _ws_multimatch ws_multimatch;
+
+/** Create an empty pattern set.
+ *
+ * @param nocase If TRUE, the ASCII letters of the patterns match both
+ * their upper and lower case forms in the data.
+ * @return The new pattern set.
+ */
+WS_DLL_PUBLIC ws_multimatch *ws_multimatch_new(gboolean nocase);
+
+/** Add a pattern to a set that has not been compiled yet.
+ *
+ * @param set The pattern set.
+ * @param pattern The bytes of the pattern; they are copied.
+ * @param pattern_len The number of bytes in the pattern; must not be 0.
+ * @return The identifier of the pattern, which is the number of
+ * patterns added before it.
+ */
+WS_DLL_PUBLIC guint ws_multimatch_add(ws_multimatch *set, const void *pattern, size_t pattern_len);
+
+/** Build the automaton; after this no more patterns can be added.
+ *
+ * @param set The pattern set.
+ */
+WS_DLL_PUBLIC void ws_multimatch_compile(ws_multimatch *set);
+
+/** Search for the patterns of a compiled set.
+ *
+ * The match reported is the one that ends first in the data; if more
+ * than one pattern ends there, the longest of them is reported, and
+ * among identical patterns, the one added first.
+ *
+ * @param set The compiled pattern set.
+ * @param haystack The data to search.
+ * @param haystacklen The number of bytes of data.
+ * @param[out] pattern_id If not NULL, set to the identifier of the
+ * pattern found.
+ * @param[out] match_len If not NULL, set to the length of the pattern
+ * found.
+ * @return A pointer to the start of the match, or NULL if none of the
+ * patterns occurs in the data.
+ */
+WS_DLL_PUBLIC const guint8 *ws_multimatch_exec(const ws_multimatch *set, const guint8 *haystack, size_t haystacklen, guint *pattern_id, size_t *match_len);
+
+/** Free a pattern set.
+ *
+ * @param set The pattern set; may be NULL.
+ */
+WS_DLL_PUBLIC void ws_multimatch_free(ws_multimatch *set);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_MULTIMATCH_H__ */